@@ -0,0 +1,496 @@
+#include "dfu_decoder.h"
+
+#include <stddef.h>
+#include <string.h>
+#include "crc32.h"
+
+#define TOKEN_LITERAL_MAX       (0x80)                          /**< Literal bytes of one token. */
+#define TOKEN_MATCH_EXTENDED    (18)                            /**< Copy length which has an extension byte. */
+#define TOKEN_BASE_EXTENDED     (67)                            /**< Base copy length which has an extension number. */
+
+typedef enum
+{
+    MODE_UNKNOWN,                                               /**< Received from offset 0, header not complete yet. */
+    MODE_PLAIN,
+    MODE_CODED
+} decoder_mode_t;
+
+typedef enum
+{
+    TOKEN_OP,
+    TOKEN_LITERAL,
+    TOKEN_DISTANCE,
+    TOKEN_MATCH_LENGTH,
+    TOKEN_BASE_LENGTH,
+    TOKEN_BASE_OFFSET
+} token_state_t;
+
+static dfu_pipeline_sink_t const * mp_sink;
+static dfu_decoder_base_get_t      m_base_get;
+static dfu_decoder_base_t const *  mp_base;
+static decoder_mode_t m_mode;
+static bool          m_coded;                                   /**< Coded image received since init. */
+static uint32_t      m_offset;                                  /**< Offset of received data. */
+static uint32_t      m_executed_offset;                         /**< Offset at the end of the latest executed object. */
+static bool          m_create_pending;                          /**< Create at offset 0 waits until the header is known. */
+static uint32_t      m_create_size;
+static uint8_t       m_header[DFU_DECODER_HEADER_SIZE];         /**< Data received from offset 0 while mode is unknown. */
+static dfu_decoder_header_t m_image;                            /**< Header of the coded image. */
+static uint32_t      m_pages_executed;                          /**< Pages of m_image executed by the request handler. */
+
+static token_state_t m_token;
+static uint32_t      m_length;                                  /**< Bytes left of the current token. */
+static uint32_t      m_value;                                   /**< Distance or number being decoded. */
+static uint8_t       m_shift;
+static uint8_t       m_window[DFU_DECODER_WINDOW_SIZE];         /**< Latest decoded bytes, index is plain offset modulo size. */
+static uint32_t      m_out;                                     /**< Offset of decoded data. */
+static uint32_t      m_flushed;                                 /**< Offset of decoded data passed to the request handler. */
+static uint32_t      m_page_start;
+static uint32_t      m_cursor;                                  /**< Position in the installed application following the previous token. */
+static uint32_t      m_crc;                                     /**< CRC of decoded data until m_flushed. */
+static bool          m_page_created;
+
+
+static uint32_t le32(uint8_t const * p_data)
+{
+    return ((uint32_t)p_data[0]) | ((uint32_t)p_data[1] << 8) |
+           ((uint32_t)p_data[2] << 16) | ((uint32_t)p_data[3] << 24);
+}
+
+
+static uint32_t page_end(void)
+{
+    uint32_t end = m_page_start + DFU_DECODER_PAGE_SIZE;
+    return (end < m_image.image_size) ? end : m_image.image_size;
+}
+
+
+/**@brief Function for passing decoded data of the current page to the request handler.
+ *
+ * @details Pages already executed by the request handler are only checked.
+ */
+static uint8_t page_flush(void)
+{
+    uint8_t const * p_data = &m_window[m_flushed % DFU_DECODER_WINDOW_SIZE];
+    uint32_t        len    = m_out - m_flushed;
+    uint8_t         result = DFU_PIPELINE_RES_SUCCESS;
+
+    m_crc = crc32_compute(p_data, len, (m_flushed == 0) ? NULL : &m_crc);
+
+    if ((m_page_start / DFU_DECODER_PAGE_SIZE) >= m_pages_executed)
+    {
+        if (!m_page_created)
+        {
+            result = mp_sink->create(page_end() - m_page_start);
+            m_page_created = (result == DFU_PIPELINE_RES_SUCCESS);
+        }
+        if (result == DFU_PIPELINE_RES_SUCCESS)
+        {
+            result = mp_sink->write(p_data, (uint16_t)len);
+        }
+    }
+    m_flushed = m_out;
+    return result;
+}
+
+
+/**@brief Function for adding a decoded byte.
+ *
+ * @details Flushes are chunk sized and aligned, so they do not wrap around the window. A complete
+ *          page is executed, except the last one, which is executed with the last object.
+ */
+static uint8_t out_byte(uint8_t byte)
+{
+    uint8_t result = DFU_PIPELINE_RES_SUCCESS;
+
+    m_window[m_out % DFU_DECODER_WINDOW_SIZE] = byte;
+    m_out++;
+    m_cursor++;
+
+    if ((m_out - m_flushed == DFU_PIPELINE_CHUNK_SIZE) || (m_out == page_end()))
+    {
+        result = page_flush();
+    }
+
+    if ((result == DFU_PIPELINE_RES_SUCCESS) && (m_out == page_end()) && (m_out != m_image.image_size))
+    {
+        if ((m_page_start / DFU_DECODER_PAGE_SIZE) >= m_pages_executed)
+        {
+            result = mp_sink->execute();
+            m_pages_executed++;
+        }
+        m_page_created = false;
+        m_page_start   = m_out;
+        m_cursor       = m_out;
+    }
+    return result;
+}
+
+
+static uint8_t match_copy(void)
+{
+    uint8_t result = DFU_PIPELINE_RES_SUCCESS;
+
+    if ((m_value > m_out - m_page_start) || (m_value > DFU_DECODER_WINDOW_SIZE) ||
+        (m_length > page_end() - m_out))
+    {
+        return DFU_DECODER_RES_INVALID_OBJECT;
+    }
+    while ((m_length > 0) && (result == DFU_PIPELINE_RES_SUCCESS))
+    {
+        result = out_byte(m_window[(m_out - m_value) % DFU_DECODER_WINDOW_SIZE]);
+        m_length--;
+    }
+    return result;
+}
+
+
+static uint8_t base_copy(void)
+{
+    uint8_t  result = DFU_PIPELINE_RES_SUCCESS;
+    // Zigzag, low bit is the sign.
+    uint32_t source = m_cursor + ((m_value & 1) ? ~(m_value >> 1) : (m_value >> 1));
+
+    if ((mp_base == NULL) || (source > mp_base->size) || (m_length > mp_base->size - source) ||
+        (m_length > page_end() - m_out))
+    {
+        return DFU_DECODER_RES_INVALID_OBJECT;
+    }
+    m_cursor = source;
+    while ((m_length > 0) && (result == DFU_PIPELINE_RES_SUCCESS))
+    {
+        result = out_byte(mp_base->p_data[m_cursor]);
+        m_length--;
+    }
+    return result;
+}
+
+
+/**@brief Function for adding a byte to a LEB128 number.
+ *
+ * @return True if the number is complete.
+ */
+static bool number_add(uint8_t byte)
+{
+    m_value |= (uint32_t)(byte & 0x7F) << m_shift;
+    m_shift += 7;
+    return (byte & 0x80) == 0;
+}
+
+
+static uint8_t token_decode(uint8_t byte)
+{
+    uint8_t result = DFU_PIPELINE_RES_SUCCESS;
+
+    switch (m_token)
+    {
+        case TOKEN_OP:
+            if (m_out == m_image.image_size)
+            {
+                return DFU_DECODER_RES_INVALID_OBJECT;
+            }
+            m_value = 0;
+            m_shift = 0;
+            if ((byte & 0x80) == 0)
+            {
+                m_length = (byte & 0x7F) + 1;
+                m_token  = TOKEN_LITERAL;
+                if (m_length > page_end() - m_out)
+                {
+                    result = DFU_DECODER_RES_INVALID_OBJECT;
+                }
+            }
+            else if ((byte & 0x40) == 0)
+            {
+                m_length = ((byte >> 2) & 0x0F) + 3;
+                m_value  = (uint32_t)(byte & 0x03) << 8;
+                m_token  = TOKEN_DISTANCE;
+            }
+            else
+            {
+                m_length = (byte & 0x3F) + 4;
+                m_token  = (m_length == TOKEN_BASE_EXTENDED) ? TOKEN_BASE_LENGTH : TOKEN_BASE_OFFSET;
+            }
+            break;
+
+        case TOKEN_LITERAL:
+            result = out_byte(byte);
+            if (--m_length == 0)
+            {
+                m_token = TOKEN_OP;
+            }
+            break;
+
+        case TOKEN_DISTANCE:
+            m_value = (m_value | byte) + 1;
+            if (m_length == TOKEN_MATCH_EXTENDED)
+            {
+                m_token = TOKEN_MATCH_LENGTH;
+                break;
+            }
+            result  = match_copy();
+            m_token = TOKEN_OP;
+            break;
+
+        case TOKEN_MATCH_LENGTH:
+            m_length += byte;
+            result    = match_copy();
+            m_token   = TOKEN_OP;
+            break;
+
+        case TOKEN_BASE_LENGTH:
+            if (number_add(byte))
+            {
+                m_length += m_value;
+                m_value   = 0;
+                m_shift   = 0;
+                m_token   = TOKEN_BASE_OFFSET;
+            }
+            break;
+
+        default:
+            if (number_add(byte))
+            {
+                result  = base_copy();
+                m_token = TOKEN_OP;
+            }
+            break;
+    }
+
+    if (m_shift > 28)
+    {
+        result = DFU_DECODER_RES_INVALID_OBJECT;
+    }
+    return result;
+}
+
+
+static uint8_t header_parse(void)
+{
+    dfu_decoder_header_t header;
+
+    header.magic      = le32(&m_header[0]);
+    header.version    = m_header[4];
+    header.mode       = m_header[5];
+    header.page_size  = (uint16_t)(m_header[6] | (m_header[7] << 8));
+    header.image_size = le32(&m_header[8]);
+    header.image_crc  = le32(&m_header[12]);
+    header.base_size  = le32(&m_header[16]);
+    header.base_crc   = le32(&m_header[20]);
+
+    if ((header.version != DFU_DECODER_VERSION) || (header.page_size != DFU_DECODER_PAGE_SIZE) ||
+        (header.image_size == 0))
+    {
+        return DFU_DECODER_RES_INVALID_OBJECT;
+    }
+
+    mp_base = NULL;
+    if (header.mode == DFU_DECODER_MODE_DELTA)
+    {
+        if (m_base_get != NULL)
+        {
+            mp_base = m_base_get(header.image_size);
+        }
+        if ((mp_base == NULL) || (mp_base->size != header.base_size) || (mp_base->crc != header.base_crc))
+        {
+            return DFU_DECODER_RES_INVALID_OBJECT;
+        }
+    }
+    else if (header.mode != DFU_DECODER_MODE_COMPRESSED)
+    {
+        return DFU_DECODER_RES_INVALID_OBJECT;
+    }
+
+    // Pages executed for the same image are not written again.
+    if (!m_coded || (memcmp(&header, &m_image, sizeof(header)) != 0))
+    {
+        m_pages_executed = 0;
+    }
+    m_image          = header;
+    m_coded          = true;
+    m_mode           = MODE_CODED;
+    m_create_pending = false;
+    m_token          = TOKEN_OP;
+    m_out            = 0;
+    m_flushed        = 0;
+    m_page_start     = 0;
+    m_cursor         = 0;
+    m_crc            = 0;
+    m_page_created   = false;
+    return DFU_PIPELINE_RES_SUCCESS;
+}
+
+
+/**@brief Function for passing data received from offset 0 to the request handler as it is. */
+static uint8_t plain_start(void)
+{
+    uint8_t result = DFU_PIPELINE_RES_SUCCESS;
+
+    m_mode = MODE_PLAIN;
+    if (m_create_pending)
+    {
+        m_create_pending = false;
+        result = mp_sink->create(m_create_size);
+    }
+    if ((result == DFU_PIPELINE_RES_SUCCESS) && (m_offset > 0))
+    {
+        result = mp_sink->write(m_header, (uint16_t)m_offset);
+    }
+    return result;
+}
+
+
+static uint8_t decoder_create(uint32_t object_size)
+{
+    switch (m_mode)
+    {
+        case MODE_UNKNOWN:
+            m_offset         = 0;
+            m_create_pending = true;
+            m_create_size    = object_size;
+            return DFU_PIPELINE_RES_SUCCESS;
+
+        case MODE_PLAIN:
+            m_offset = m_executed_offset;
+            return mp_sink->create(object_size);
+
+        default:
+            // Decoded data of the discarded object cannot be taken back.
+            if (m_offset != m_executed_offset)
+            {
+                return DFU_DECODER_RES_NOT_PERMITTED;
+            }
+            return DFU_PIPELINE_RES_SUCCESS;
+    }
+}
+
+
+static uint8_t decoder_write(uint8_t const * p_data, uint16_t len)
+{
+    uint8_t  result = DFU_PIPELINE_RES_SUCCESS;
+    uint16_t used   = 0;
+
+    if (m_mode == MODE_UNKNOWN)
+    {
+        while ((used < len) && (m_offset < DFU_DECODER_HEADER_SIZE))
+        {
+            m_header[m_offset++] = p_data[used++];
+            if ((m_offset == sizeof(uint32_t)) && (le32(m_header) != DFU_DECODER_MAGIC))
+            {
+                break;
+            }
+        }
+        if ((m_offset >= sizeof(uint32_t)) && (le32(m_header) != DFU_DECODER_MAGIC))
+        {
+            result = plain_start();
+        }
+        else if (m_offset == DFU_DECODER_HEADER_SIZE)
+        {
+            result = header_parse();
+        }
+    }
+
+    if (m_mode == MODE_PLAIN)
+    {
+        m_offset += len - used;
+        if ((result == DFU_PIPELINE_RES_SUCCESS) && (used < len))
+        {
+            result = mp_sink->write(&p_data[used], len - used);
+        }
+    }
+    else if (m_mode == MODE_CODED)
+    {
+        m_offset += len - used;
+        while ((used < len) && (result == DFU_PIPELINE_RES_SUCCESS))
+        {
+            result = token_decode(p_data[used++]);
+        }
+    }
+    return result;
+}
+
+
+static uint8_t decoder_execute(void)
+{
+    uint8_t result = DFU_PIPELINE_RES_SUCCESS;
+
+    if (m_mode == MODE_UNKNOWN)
+    {
+        result = plain_start();
+        if (result != DFU_PIPELINE_RES_SUCCESS)
+        {
+            return result;
+        }
+    }
+    m_executed_offset = m_offset;
+
+    if (m_mode == MODE_PLAIN)
+    {
+        return mp_sink->execute();
+    }
+    if (m_out != m_image.image_size)
+    {
+        return DFU_PIPELINE_RES_SUCCESS;
+    }
+
+    // Last object, the request handler validates the image when its last page is executed.
+    if ((m_token != TOKEN_OP) || (m_crc != m_image.image_crc))
+    {
+        return DFU_DECODER_RES_INVALID_OBJECT;
+    }
+    if ((m_page_start / DFU_DECODER_PAGE_SIZE) >= m_pages_executed)
+    {
+        result = mp_sink->execute();
+        if (result == DFU_PIPELINE_RES_SUCCESS)
+        {
+            m_pages_executed++;
+        }
+    }
+    return result;
+}
+
+
+static bool decoder_is_busy(void)
+{
+    return (mp_sink->is_busy != NULL) && mp_sink->is_busy();
+}
+
+
+static const dfu_pipeline_sink_t m_decoder_sink =
+{
+    .create  = decoder_create,
+    .write   = decoder_write,
+    .execute = decoder_execute,
+    .is_busy = decoder_is_busy
+};
+
+
+void dfu_decoder_init(dfu_pipeline_sink_t const * p_sink, dfu_decoder_base_get_t base_get)
+{
+    mp_sink          = p_sink;
+    m_base_get       = base_get;
+    m_coded          = false;
+    m_pages_executed = 0;
+    dfu_decoder_restart(0);
+}
+
+
+dfu_pipeline_sink_t const * dfu_decoder_sink(void)
+{
+    return &m_decoder_sink;
+}
+
+
+void dfu_decoder_restart(uint32_t offset)
+{
+    m_offset          = offset;
+    m_executed_offset = offset;
+    m_create_pending  = false;
+    m_mode            = (offset == 0) ? MODE_UNKNOWN : MODE_PLAIN;
+}
+
+
+bool dfu_decoder_is_coded(void)
+{
+    return m_coded;
+}
@@ -0,0 +1,114 @@
+/**@file
+ *
+ * @brief Streaming decoder of compressed and delta firmware images between the DFU pipeline and
+ *        the DFU request handler.
+ *
+ * @details The DFU Controller sends the firmware data of a coded image instead of the plain image,
+ *          the init packet is the one of the plain image. A coded image starts with a
+ *          @ref dfu_decoder_header_t, any other data is passed to the request handler as it is.
+ *
+ *          The plain image is coded in pages of @ref DFU_DECODER_PAGE_SIZE bytes, one data object
+ *          of the request handler each. Pages are decoded on their own, a page is created in the
+ *          request handler when its first byte is decoded and executed when its last one is, the
+ *          last page when the DFU Controller executes the last object of the coded image. Tokens:
+ *          - 0LLLLLLL: L + 1 literal bytes follow.
+ *          - 10LLLLDD DDDDDDDD [E]: copy of L + 3 bytes, E + 18 if L is 15, from D + 1 bytes back
+ *            in the same page. Decoder keeps the latest @ref DFU_DECODER_WINDOW_SIZE bytes.
+ *          - 11LLLLLL [N] A: copy of L + 4 bytes, N + 67 if L is 63, from the installed
+ *            application. Source is A bytes from the position in the installed application
+ *            following the previous token, or from the start of the page for the first token.
+ *            Delta images only. N is an unsigned, A a zigzag signed LEB128 number.
+ *
+ *          Delta images are decoded against the installed application, which must stay in place
+ *          while the new one is received, i.e. the request handler must use dual banks.
+ *
+ *          The decoder does not keep state across a reset. When the DFU Controller selects the
+ *          data object again after a disconnection, a coded image is sent again from its start
+ *          and pages that the request handler has already executed are decoded but not written.
+ *
+ *          The module has no dependencies on the SoftDevice and is tested on host in
+ *          tools/dfu_pack.
+ */
+
+#ifndef DFU_DECODER_H__
+#define DFU_DECODER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "dfu_pipeline.h"
+
+#define DFU_DECODER_MAGIC                       (0x5A464452)    /**< "RDFZ", not a valid initial stack pointer of a plain image. */
+#define DFU_DECODER_VERSION                     (1)
+#define DFU_DECODER_MODE_COMPRESSED             (1)
+#define DFU_DECODER_MODE_DELTA                  (2)
+#define DFU_DECODER_PAGE_SIZE                   (4096)  /**< Plain bytes per page, maximum data object size of the request handler. */
+#define DFU_DECODER_WINDOW_SIZE                 (1024)  /**< Longest distance of a copy within a page. */
+
+#define DFU_DECODER_RES_INVALID_OBJECT          (0x05)  /**< Same value as NRF_DFU_RES_CODE_INVALID_OBJECT. */
+#define DFU_DECODER_RES_NOT_PERMITTED           (0x08)  /**< Same value as NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED. */
+
+/**@brief Header of a coded image, little endian. */
+typedef struct
+{
+    uint32_t magic;                 /**< @ref DFU_DECODER_MAGIC. */
+    uint8_t  version;               /**< @ref DFU_DECODER_VERSION. */
+    uint8_t  mode;                  /**< @ref DFU_DECODER_MODE_COMPRESSED or @ref DFU_DECODER_MODE_DELTA. */
+    uint16_t page_size;             /**< @ref DFU_DECODER_PAGE_SIZE. */
+    uint32_t image_size;            /**< Size of the plain image. */
+    uint32_t image_crc;             /**< CRC32 of the plain image. */
+    uint32_t base_size;             /**< Size of the installed application of a delta image, 0 otherwise. */
+    uint32_t base_crc;              /**< CRC32 of the installed application of a delta image, 0 otherwise. */
+} dfu_decoder_header_t;
+
+#define DFU_DECODER_HEADER_SIZE                 (24)    /**< Size of @ref dfu_decoder_header_t in the image. */
+
+/**@brief Installed application to decode a delta image against. */
+typedef struct
+{
+    uint8_t const * p_data;
+    uint32_t        size;
+    uint32_t        crc;            /**< CRC32 of size bytes. */
+} dfu_decoder_base_t;
+
+/**@brief Function for getting the installed application.
+ *
+ * @param[in] image_size Size of the plain image to be received.
+ *
+ * @return Installed application or NULL if it would not stay in place while image_size bytes are
+ *         received.
+ */
+typedef dfu_decoder_base_t const * (*dfu_decoder_base_get_t)(uint32_t image_size);
+
+
+/**@brief Function for initializing the decoder.
+ *
+ * @param[in] p_sink   Data object operations of the request handler, must stay valid.
+ * @param[in] base_get Function for getting the installed application, NULL if delta images are
+ *                     not supported.
+ */
+void dfu_decoder_init(dfu_pipeline_sink_t const * p_sink, dfu_decoder_base_get_t base_get);
+
+
+/**@brief Function for getting the data object operations of the decoder, for @ref dfu_pipeline_init.
+ *
+ * @details Objects, offsets and results are the ones of the received data. is_busy is the one of
+ *          the request handler.
+ */
+dfu_pipeline_sink_t const * dfu_decoder_sink(void);
+
+
+/**@brief Function for setting the offset of received data after Select of the data object.
+ *
+ * @details Data received from offset 0 is checked for a header, data received from any other
+ *          offset is passed to the request handler as it is. The pipeline must be empty.
+ */
+void dfu_decoder_restart(uint32_t offset);
+
+
+/**@brief Function for checking if the data received since @ref dfu_decoder_init is a coded image.
+ *
+ * @details A coded image is resumed from its start, see @ref dfu_decoder_restart.
+ */
+bool dfu_decoder_is_coded(void);
+
+#endif // DFU_DECODER_H__
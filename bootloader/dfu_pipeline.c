@@ -0,0 +1,282 @@
+#include "dfu_pipeline.h"
+
+#include <stddef.h>
+#include <string.h>
+#include "crc32.h"
+
+typedef enum
+{
+    PIPELINE_OP_CREATE,
+    PIPELINE_OP_WRITE,
+    PIPELINE_OP_EXECUTE
+} pipeline_op_type_t;
+
+typedef struct
+{
+    pipeline_op_type_t type;
+    uint32_t           value;                                   /**< Object size of Create, bytes left in the buffer of Write. */
+} pipeline_op_t;
+
+static dfu_pipeline_sink_t const * mp_sink;
+static uint8_t       m_buffer[DFU_PIPELINE_BUFFER_SIZE];        /**< Ring buffer of firmware data of queued Writes. */
+static uint32_t      m_buffer_head;                             /**< Next byte to hand to the request handler. */
+static uint32_t      m_buffer_count;
+static pipeline_op_t m_ops[DFU_PIPELINE_OP_COUNT];
+static uint8_t       m_op_head;
+static uint8_t       m_op_count;
+static uint8_t       m_result;                                  /**< First failure of a queued operation, DFU_PIPELINE_RES_SUCCESS if none. */
+static uint32_t      m_offset;                                  /**< Offset of received firmware data. */
+static uint32_t      m_crc;                                     /**< CRC of received firmware data. */
+static uint32_t      m_executed_offset;                         /**< Offset at the end of the latest executed object. */
+static uint32_t      m_executed_crc;
+
+
+static pipeline_op_t * op_last(void)
+{
+    if (m_op_count == 0)
+    {
+        return NULL;
+    }
+    return &m_ops[(m_op_head + m_op_count - 1) % DFU_PIPELINE_OP_COUNT];
+}
+
+
+static bool op_push(pipeline_op_type_t type, uint32_t value)
+{
+    if (m_op_count == DFU_PIPELINE_OP_COUNT)
+    {
+        return false;
+    }
+    pipeline_op_t * p_op = &m_ops[(m_op_head + m_op_count) % DFU_PIPELINE_OP_COUNT];
+    p_op->type  = type;
+    p_op->value = value;
+    m_op_count++;
+    return true;
+}
+
+
+static void queue_clear(void)
+{
+    m_op_head      = 0;
+    m_op_count     = 0;
+    m_buffer_head  = 0;
+    m_buffer_count = 0;
+}
+
+
+/**@brief Function for running the oldest queued operation, one chunk of it for Write.
+ */
+static void op_run(void)
+{
+    pipeline_op_t * p_op = &m_ops[m_op_head];
+    uint8_t         result;
+
+    switch (p_op->type)
+    {
+        case PIPELINE_OP_CREATE:
+            result      = mp_sink->create(p_op->value);
+            p_op->value = 0;
+            break;
+
+        case PIPELINE_OP_EXECUTE:
+            result = mp_sink->execute();
+            break;
+
+        default:
+        {
+            // Chunks do not wrap around the end of the buffer.
+            uint32_t len = p_op->value;
+            if (len > DFU_PIPELINE_CHUNK_SIZE)
+            {
+                len = DFU_PIPELINE_CHUNK_SIZE;
+            }
+            if (len > DFU_PIPELINE_BUFFER_SIZE - m_buffer_head)
+            {
+                len = DFU_PIPELINE_BUFFER_SIZE - m_buffer_head;
+            }
+            result          = mp_sink->write(&m_buffer[m_buffer_head], (uint16_t)len);
+            m_buffer_head   = (m_buffer_head + len) % DFU_PIPELINE_BUFFER_SIZE;
+            m_buffer_count -= len;
+            p_op->value    -= len;
+        }
+            break;
+    }
+
+    if (p_op->type != PIPELINE_OP_WRITE || p_op->value == 0)
+    {
+        m_op_head = (m_op_head + 1) % DFU_PIPELINE_OP_COUNT;
+        m_op_count--;
+    }
+
+    if (result != DFU_PIPELINE_RES_SUCCESS)
+    {
+        // Rest of the queue depends on the failed operation.
+        m_result = result;
+        queue_clear();
+    }
+}
+
+
+static bool sink_is_busy(void)
+{
+    return (mp_sink->is_busy != NULL) && mp_sink->is_busy();
+}
+
+
+void dfu_pipeline_init(dfu_pipeline_sink_t const * p_sink)
+{
+    mp_sink = p_sink;
+    queue_clear();
+    dfu_pipeline_position_set(0, 0);
+}
+
+
+void dfu_pipeline_position_set(uint32_t offset, uint32_t crc)
+{
+    m_result          = DFU_PIPELINE_RES_SUCCESS;
+    m_offset          = offset;
+    m_crc             = crc;
+    m_executed_offset = offset;
+    m_executed_crc    = crc;
+}
+
+
+uint8_t dfu_pipeline_create(uint32_t object_size)
+{
+    if (m_result != DFU_PIPELINE_RES_SUCCESS)
+    {
+        return m_result;
+    }
+
+    m_offset = m_executed_offset;
+    m_crc    = m_executed_crc;
+
+    if (!op_push(PIPELINE_OP_CREATE, object_size))
+    {
+        if (dfu_pipeline_flush() != DFU_PIPELINE_RES_SUCCESS)
+        {
+            return m_result;
+        }
+        (void)op_push(PIPELINE_OP_CREATE, object_size);
+    }
+    dfu_pipeline_process();
+    return m_result;
+}
+
+
+uint8_t dfu_pipeline_write(uint8_t const * p_data, uint16_t len)
+{
+    pipeline_op_t * p_last;
+    uint32_t        tail;
+    uint32_t        first;
+
+    if (m_result != DFU_PIPELINE_RES_SUCCESS)
+    {
+        return m_result;
+    }
+
+    p_last = op_last();
+    if ((len > DFU_PIPELINE_BUFFER_SIZE - m_buffer_count) ||
+        ((m_op_count == DFU_PIPELINE_OP_COUNT) && (p_last->type != PIPELINE_OP_WRITE)))
+    {
+        if (dfu_pipeline_flush() != DFU_PIPELINE_RES_SUCCESS)
+        {
+            return m_result;
+        }
+        p_last = NULL;
+    }
+
+    tail  = (m_buffer_head + m_buffer_count) % DFU_PIPELINE_BUFFER_SIZE;
+    first = DFU_PIPELINE_BUFFER_SIZE - tail;
+    if (first > len)
+    {
+        first = len;
+    }
+    memcpy(&m_buffer[tail], p_data, first);
+    memcpy(&m_buffer[0], &p_data[first], len - first);
+    m_buffer_count += len;
+
+    if ((p_last != NULL) && (p_last->type == PIPELINE_OP_WRITE))
+    {
+        p_last->value += len;
+    }
+    else
+    {
+        (void)op_push(PIPELINE_OP_WRITE, len);
+    }
+
+    m_crc     = crc32_compute(p_data, len, (m_offset == 0) ? NULL : &m_crc);
+    m_offset += len;
+
+    return m_result;
+}
+
+
+uint8_t dfu_pipeline_execute(bool defer)
+{
+    if (m_result != DFU_PIPELINE_RES_SUCCESS)
+    {
+        return m_result;
+    }
+
+    if (!op_push(PIPELINE_OP_EXECUTE, 0))
+    {
+        if (dfu_pipeline_flush() != DFU_PIPELINE_RES_SUCCESS)
+        {
+            return m_result;
+        }
+        (void)op_push(PIPELINE_OP_EXECUTE, 0);
+    }
+    m_executed_offset = m_offset;
+    m_executed_crc    = m_crc;
+
+    if (!defer)
+    {
+        return dfu_pipeline_flush();
+    }
+    dfu_pipeline_process();
+    return m_result;
+}
+
+
+void dfu_pipeline_process(void)
+{
+    while ((m_op_count > 0) && !sink_is_busy())
+    {
+        op_run();
+    }
+}
+
+
+uint8_t dfu_pipeline_flush(void)
+{
+    while (m_op_count > 0)
+    {
+        op_run();
+    }
+    return m_result;
+}
+
+
+uint8_t dfu_pipeline_result(void)
+{
+    return m_result;
+}
+
+
+uint32_t dfu_pipeline_offset(void)
+{
+    return m_offset;
+}
+
+
+uint32_t dfu_pipeline_crc(void)
+{
+    return m_crc;
+}
+
+
+bool dfu_pipeline_is_empty(void)
+{
+    return m_op_count == 0;
+}
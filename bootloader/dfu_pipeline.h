@@ -0,0 +1,118 @@
+/**@file
+ *
+ * @brief Write-behind pipeline between the DFU Packet characteristic and the DFU request handler.
+ *
+ * @details Firmware data of data objects is copied into a ring buffer as it arrives and is handed
+ *          to the request handler in chunks while the flash can take it. Create and Execute of
+ *          data objects are queued behind the buffered data, so Execute of an object can be
+ *          acknowledged before its flash writes have completed and the DFU Controller can send
+ *          the next object meanwhile. Offset and CRC of received data are tracked here, Packet
+ *          Receipt Notifications and Calculate CRC are answered without waiting for the flash.
+ *
+ *          A failure of a queued operation is returned by every later call until
+ *          @ref dfu_pipeline_position_set, i.e. until the DFU Controller selects the data object
+ *          again. Command objects do not go through the pipeline, flush it before handling them.
+ *
+ *          The module has no dependencies on the SoftDevice and is tested on host in
+ *          tools/dfu_transfer.
+ */
+
+#ifndef DFU_PIPELINE_H__
+#define DFU_PIPELINE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DFU_PIPELINE_BUFFER_SIZE                (4096)  /**< Bytes of firmware data buffered, one data object of the request handler. */
+#define DFU_PIPELINE_CHUNK_SIZE                 (256)   /**< Largest write handed to the request handler at once. */
+#define DFU_PIPELINE_OP_COUNT                   (8)     /**< Queued Create, Write and Execute operations. */
+
+#define DFU_PIPELINE_RES_SUCCESS                (0x01)  /**< Same value as NRF_DFU_RES_CODE_SUCCESS. */
+#define DFU_PIPELINE_RES_OPERATION_FAILED       (0x0A)  /**< Same value as NRF_DFU_RES_CODE_OPERATION_FAILED. */
+
+/**@brief Data object operations of the request handler. Results are nrf_dfu_res_code_t values. */
+typedef struct
+{
+    uint8_t (*create)(uint32_t object_size);                 /**< Create data object, erases its flash. */
+    uint8_t (*write)(uint8_t const * p_data, uint16_t len);  /**< Write firmware data of current object. */
+    uint8_t (*execute)(void);                                /**< Execute current object, waits for its flash writes. */
+    bool    (*is_busy)(void);                                /**< Optional, true if the next operation would wait for the flash. */
+} dfu_pipeline_sink_t;
+
+
+/**@brief Function for initializing the pipeline. Buffered data is discarded.
+ *
+ * @param[in] p_sink Operations of the request handler, must stay valid.
+ */
+void dfu_pipeline_init(dfu_pipeline_sink_t const * p_sink);
+
+
+/**@brief Function for setting offset and CRC of received data, e.g. from Select of a data object.
+ *
+ * @details Clears a failure of a queued operation. The pipeline must be empty, see
+ *          @ref dfu_pipeline_flush.
+ */
+void dfu_pipeline_position_set(uint32_t offset, uint32_t crc);
+
+
+/**@brief Function for queuing Create of a data object.
+ *
+ * @details Data received after the latest executed object is discarded, as in the request handler.
+ *
+ * @return DFU_PIPELINE_RES_SUCCESS or result of a failed operation.
+ */
+uint8_t dfu_pipeline_create(uint32_t object_size);
+
+
+/**@brief Function for buffering firmware data of the current data object.
+ *
+ * @details Data is not passed on until @ref dfu_pipeline_process, so flash writes do not take
+ *          radio time while the DFU Controller streams packets. Waits for queued operations if
+ *          the buffer is full.
+ *
+ * @return DFU_PIPELINE_RES_SUCCESS or result of a failed operation.
+ */
+uint8_t dfu_pipeline_write(uint8_t const * p_data, uint16_t len);
+
+
+/**@brief Function for executing the current data object.
+ *
+ * @param[in] defer True to return once the object is queued, false to wait until it has been
+ *                  executed, e.g. for the last object whose Execute validates the image.
+ *
+ * @return DFU_PIPELINE_RES_SUCCESS or result of a failed operation.
+ */
+uint8_t dfu_pipeline_execute(bool defer);
+
+
+/**@brief Function for running queued operations until the request handler would wait for the flash.
+ */
+void dfu_pipeline_process(void);
+
+
+/**@brief Function for running all queued operations.
+ *
+ * @return DFU_PIPELINE_RES_SUCCESS or result of a failed operation.
+ */
+uint8_t dfu_pipeline_flush(void);
+
+
+/**@brief Function for getting the result of queued operations so far.
+ *
+ * @return DFU_PIPELINE_RES_SUCCESS or result of a failed operation.
+ */
+uint8_t dfu_pipeline_result(void);
+
+
+/**@brief Function for getting the offset of received firmware data. */
+uint32_t dfu_pipeline_offset(void);
+
+
+/**@brief Function for getting the CRC of received firmware data. */
+uint32_t dfu_pipeline_crc(void);
+
+
+/**@brief Function for checking if all queued operations have been run. */
+bool dfu_pipeline_is_empty(void);
+
+#endif // DFU_PIPELINE_H__
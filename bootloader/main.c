@@ -30,6 +30,9 @@
 #include "app_error.h"
 #include "app_error_weak.h"
 #include "nrf_bootloader_info.h"
+#include "nrf_dfu_settings.h"
+#include "nrf_dfu_types.h"
+#include "warm_boot.h"
 
 //  Set your own bootloader name at
 //  $(PROJECT_ROOT)/nrf_ble_dfu.c
@@ -89,6 +92,29 @@ static void sensors_init(void)
 }
 
 
+/**@brief Function for checking if the application can be started without validating it.
+ *
+ * @details The application was validated before a soft or watchdog reset, DFU is not requested
+ *          by button or by the application, and the settings page still describes the same
+ *          application with no update pending. CRC of the image is not computed again.
+ */
+static bool app_is_unchanged(void)
+{
+    nrf_dfu_settings_t const * p_settings = (nrf_dfu_settings_t const *)BOOTLOADER_SETTINGS_ADDRESS;
+
+    if ((nrf_gpio_pin_read(BOOTLOADER_BUTTON) == 0) ||
+        (NRF_POWER->GPREGRET == BOOTLOADER_DFU_START) ||
+        (p_settings->enter_buttonless_dfu != 0) ||
+        (p_settings->bank_current != NRF_DFU_CURRENT_BANK_0) ||
+        (p_settings->bank_0.bank_code != NRF_DFU_BANK_VALID_APP) ||
+        (p_settings->bank_1.bank_code != NRF_DFU_BANK_INVALID))
+    {
+        return false;
+    }
+    return warm_boot_app_is_validated(p_settings->bank_0.image_size, p_settings->bank_0.image_crc);
+}
+
+
 /**@brief Function for application main entry.
  */
 int main(void)
@@ -103,9 +129,18 @@ int main(void)
     buttons_init();
     sensors_init();
 
+    if (app_is_unchanged())
+    {
+        NRF_LOG_INFO("Warm boot, starting validated application\r\n");
+        nrf_bootloader_app_start(MAIN_APPLICATION_START_ADDR);
+    }
+
     ret_val = nrf_bootloader_init();
     APP_ERROR_CHECK(ret_val);
 
+    // Application may have been updated, its state of earlier boots is dropped
+    warm_boot_app_validated(s_dfu_settings.bank_0.image_size, s_dfu_settings.bank_0.image_crc);
+
     // Either there was no DFU functionality enabled in this project
     // or the DFU module detected no ongoing DFU operation
     // and found a valid main application.
@@ -43,6 +43,8 @@
 #include <stddef.h>
 #include "sdk_common.h"
 #include "nrf_dfu_req_handler.h"
+#include "nrf_dfu_settings.h"
+#include "nrf_dfu_utils.h"
 #include "nrf_dfu_transport.h"
 #include "nrf_dfu_mbr.h"
 #include "nrf_bootloader_info.h"
@@ -54,6 +56,8 @@
 #include "softdevice_handler_appsh.h"
 #include "nrf_log.h"
 #include "nrf_delay.h"
+#include "dfu_pipeline.h"
+#include "dfu_decoder.h"
 
 #define ADVERTISING_LED_PIN_NO               BSP_LED_0                                              /**< Is on when device is advertising. */
 #define CONNECTED_LED_PIN_NO                 BSP_LED_1                                              /**< Is on when device has connected. */
@@ -80,15 +84,26 @@
 
 #define APP_FEATURE_NOT_SUPPORTED            BLE_GATT_STATUS_ATTERR_APP_BEGIN + 2                   /**< Reply when unsupported features are requested. */
 
-#define MAX_DFU_PKT_LEN                     (20)                                                    /**< Maximum length (in bytes) of the DFU Packet characteristic. */
 #define PKT_CREATE_PARAM_LEN                (6)                                                     /**< Length (in bytes) of the parameters for Create Object request. */
 #define PKT_SET_PRN_PARAM_LEN               (3)                                                     /**< Length (in bytes) of the parameters for Set Packet Receipt Notification request. */
 #define PKT_READ_OBJECT_INFO_PARAM_LEN      (2)                                                     /**< Length (in bytes) of the parameters for Read Object Info request. */
 #define MAX_RESPONSE_LEN                    (15)                                                    /**< Maximum length (in bytes) of the response to a Control Point command. */
 
+#define FLASH_PAGE_ERASE_TICKS              APP_TIMER_TICKS(85, APP_TIMER_PRESCALER)               /**< Page erase time of nRF52832 flash. */
+#define FLASH_WORD_WRITE_US                 (41)                                                    /**< Word write time of nRF52832 flash. */
+#define FLASH_WRITE_TICKS(len)              CEIL_DIV(CEIL_DIV((len), 4) * FLASH_WORD_WRITE_US * 32768UL, 1000000UL) /**< Write time of len bytes in RTC1 ticks. */
+#define RTC_COUNTER_MASK                    (0x00FFFFFF)                                            /**< RTC1 counter is 24 bits. */
+#define RTC_COUNTER_HALF                    (0x00800000)                                            /**< Tick differences above this are negative. */
+
+
+#define ATT_WRITE_HEADER_LEN                (3)                                                     /**< Length (in bytes) of the opcode and handle of an ATT write. */
 
 #if (NRF_SD_BLE_API_VERSION == 3)
-#define NRF_BLE_MAX_MTU_SIZE            GATT_MTU_SIZE_DEFAULT                                       /**< MTU size used in the softdevice enabling and to reply to a BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST event. */
+#define NRF_BLE_MAX_MTU_SIZE                (247)                                                   /**< MTU size used in the softdevice enabling and to reply to a BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST event. A 247 byte ATT packet fits in one 251 byte LL packet. */
+#define L2CAP_HEADER_LEN                    (4)                                                     /**< Length (in bytes) of the L2CAP header, LL payload of a full ATT packet is ATT MTU plus this. */
+#define MAX_DFU_PKT_LEN                     (NRF_BLE_MAX_MTU_SIZE - ATT_WRITE_HEADER_LEN)           /**< Maximum length (in bytes) of the DFU Packet characteristic. */
+#else
+#define MAX_DFU_PKT_LEN                     (GATT_MTU_SIZE_DEFAULT - ATT_WRITE_HEADER_LEN)          /**< Maximum length (in bytes) of the DFU Packet characteristic. */
 #endif
 
 
@@ -96,6 +111,15 @@ static ble_dfu_t            m_dfu;
 static uint16_t             m_pkt_notif_target;                                                      /**< Number of packets of firmware data to be received before transmitting the next Packet Receipt Notification to the DFU Controller. */
 static uint16_t             m_pkt_notif_target_cnt;                                                  /**< Number of packets of firmware data received after sending last Packet Receipt Notification or since the receipt of a @ref BLE_DFU_PKT_RCPT_NOTIF_ENABLED event from the DFU service, which ever occurs later.*/
 static uint16_t             m_conn_handle            = BLE_CONN_HANDLE_INVALID;                      /**< Handle of the current connection. */
+#if (NRF_SD_BLE_API_VERSION == 3)
+static uint16_t             m_att_mtu                = GATT_MTU_SIZE_DEFAULT;                        /**< ATT MTU the SoftDevice was enabled with, NRF_BLE_MAX_MTU_SIZE if its buffers fit in RAM. */
+#endif
+static uint8_t              m_object_type;                                                           /**< Type of the object latest created or selected. */
+static uint32_t             m_object_size;                                                           /**< Size of the data object latest created. */
+static uint32_t             m_max_object_size;                                                       /**< Maximum size of a data object, from Select. Zero until selected. */
+static bool                 m_partial_object;                                                        /**< Select returned offset within a data object, offset and CRC of its start are not known. */
+static uint32_t             m_flash_idle_ticks;                                                      /**< Estimated RTC1 counter value when the flash has completed operations passed to the request handler. */
+APP_TIMER_DEF(m_pipeline_timer);                                                                     /**< Passes buffered firmware data to the request handler when the flash is estimated to be free. */
 
 #define DFU_BLE_FLAG_NONE                    (0)
 #define DFU_BLE_FLAG_SERVICE_INITIALIZED     (1 << 0)           /**< Flag to check if the DFU service was initialized by the application.*/
@@ -391,6 +415,174 @@ static uint32_t response_select_object_cmd_send(ble_dfu_t         * p_dfu,
 }
 
 
+/**@brief     Function for getting the estimated time until the flash has completed operations
+ *            passed to the request handler.
+ *
+ * @return    RTC1 ticks, 0 if the flash is estimated to be idle.
+ */
+static uint32_t flash_ticks_left(void)
+{
+    uint32_t now   = 0;
+    uint32_t ticks = 0;
+
+    (void)app_timer_cnt_get(&now);
+    (void)app_timer_cnt_diff_compute(m_flash_idle_ticks, now, &ticks);
+
+    return (ticks < RTC_COUNTER_HALF) ? ticks : 0;
+}
+
+
+static void flash_ticks_add(uint32_t ticks)
+{
+    uint32_t now = 0;
+
+    (void)app_timer_cnt_get(&now);
+    m_flash_idle_ticks = (now + flash_ticks_left() + ticks) & RTC_COUNTER_MASK;
+}
+
+
+/**@brief     Function for passing a data object operation of the pipeline to the request handler.
+ *
+ * @param[in] p_dfu_req Request with type and parameters set.
+ *
+ * @return    Result of the request handler.
+ */
+static uint8_t pipeline_req(nrf_dfu_req_t * p_dfu_req)
+{
+    nrf_dfu_res_t dfu_res = {{{0}}};
+
+    p_dfu_req->obj_type = NRF_DFU_OBJ_TYPE_DATA;
+
+    return (uint8_t)nrf_dfu_req_handler_on_req(NULL, p_dfu_req, &dfu_res);
+}
+
+
+static uint8_t pipeline_create(uint32_t object_size)
+{
+    nrf_dfu_req_t dfu_req;
+
+    memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
+    dfu_req.req_type    = NRF_DFU_OBJECT_OP_CREATE;
+    dfu_req.object_size = object_size;
+
+    uint8_t res_code = pipeline_req(&dfu_req);
+    if (res_code == NRF_DFU_RES_CODE_SUCCESS)
+    {
+        flash_ticks_add(CEIL_DIV(object_size, CODE_PAGE_SIZE) * FLASH_PAGE_ERASE_TICKS);
+    }
+    return res_code;
+}
+
+
+static uint8_t pipeline_write(uint8_t const * p_data, uint16_t len)
+{
+    nrf_dfu_req_t dfu_req;
+
+    memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
+    dfu_req.req_type = NRF_DFU_OBJECT_OP_WRITE;
+    dfu_req.p_req    = (uint8_t *)p_data;
+    dfu_req.req_len  = len;
+
+    uint8_t res_code = pipeline_req(&dfu_req);
+    if (res_code != NRF_DFU_RES_CODE_SUCCESS)
+    {
+        NRF_LOG_INFO("Failure to run packet write\r\n");
+    }
+    flash_ticks_add(FLASH_WRITE_TICKS(len));
+    return res_code;
+}
+
+
+static uint8_t pipeline_execute(void)
+{
+    nrf_dfu_req_t dfu_req;
+
+    memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
+    dfu_req.req_type = NRF_DFU_OBJECT_OP_EXECUTE;
+
+    return pipeline_req(&dfu_req);
+}
+
+
+/**@brief     Function for checking if the request handler would wait for the flash.
+ *
+ * @details   The request handler waits in Execute until its writes have completed, and in Write
+ *            when its buffers are full. One chunk can be queued behind the one being written.
+ *            The estimate does not need to be exact, the request handler waits if it is too short.
+ */
+static bool pipeline_is_busy(void)
+{
+    return flash_ticks_left() > FLASH_WRITE_TICKS(DFU_PIPELINE_CHUNK_SIZE);
+}
+
+
+/**@brief     Data object operations of the request handler.
+ */
+static const dfu_pipeline_sink_t m_pipeline_sink =
+{
+    .create  = pipeline_create,
+    .write   = pipeline_write,
+    .execute = pipeline_execute,
+    .is_busy = pipeline_is_busy
+};
+
+
+/**@brief     Function for passing buffered firmware data to the request handler now and again
+ *            once the flash is estimated to be free.
+ *
+ * @details   The SoftDevice writes the flash between radio events. Data buffered while the DFU
+ *            Controller streams packets is written while it waits for responses, when there are
+ *            no BLE events to run the pipeline.
+ */
+static void pipeline_schedule(void)
+{
+    uint32_t ticks;
+
+    dfu_pipeline_process();
+    if (dfu_pipeline_is_empty())
+    {
+        return;
+    }
+
+    ticks = flash_ticks_left();
+    ticks = (ticks > FLASH_WRITE_TICKS(DFU_PIPELINE_CHUNK_SIZE)) ? ticks - FLASH_WRITE_TICKS(DFU_PIPELINE_CHUNK_SIZE) : 0;
+
+    (void)app_timer_stop(m_pipeline_timer);
+    (void)app_timer_start(m_pipeline_timer, MAX(ticks, APP_TIMER_MIN_TIMEOUT_TICKS), NULL);
+}
+
+
+static void pipeline_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    pipeline_schedule();
+}
+
+
+/**@brief     Function for getting the installed application to decode a delta image against.
+ *
+ * @details   The request handler receives the new image into free flash above the installed
+ *            application if it fits there, otherwise it overwrites the installed application.
+ */
+static dfu_decoder_base_t const * delta_base_get(uint32_t image_size)
+{
+    static dfu_decoder_base_t base;
+    uint32_t                  address;
+
+    if ((s_dfu_settings.bank_0.bank_code != NRF_DFU_BANK_VALID_APP) ||
+        (nrf_dfu_find_cache(image_size, true, &address) != NRF_SUCCESS))
+    {
+        return NULL;
+    }
+
+    base.p_data = (uint8_t const *)CODE_REGION_1_START;
+    base.size   = s_dfu_settings.bank_0.image_size;
+    base.crc    = s_dfu_settings.bank_0.image_crc;
+    return &base;
+}
+
+
 /**@brief     Function for handling a Write event on the Control Point characteristic.
  *
  * @param[in] p_dfu             DFU Service Structure.
@@ -432,18 +624,55 @@ static uint32_t on_ctrl_pt_write(ble_dfu_t * p_dfu, ble_gatts_evt_write_t * p_bl
             dfu_req.object_size = uint32_decode(&(p_ble_write_evt->data[2]));
             //lint -restore
 
+            m_object_type = dfu_req.obj_type;
+            m_object_size = dfu_req.object_size;
+
+            if (dfu_req.obj_type == NRF_DFU_OBJ_TYPE_DATA && m_partial_object)
+            {
+                // Request handler discards the partial object and knows where the previous one ended.
+                (void)dfu_pipeline_flush();
+                res_code = (nrf_dfu_res_code_t)pipeline_create(dfu_req.object_size);
+                if (res_code == NRF_DFU_RES_CODE_SUCCESS)
+                {
+                    dfu_req.req_type = NRF_DFU_OBJECT_OP_CRC;
+                    res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
+                    dfu_decoder_restart(dfu_res.offset);
+                    dfu_pipeline_position_set(dfu_res.offset, dfu_res.crc);
+                    m_partial_object = false;
+                }
+                return response_send(p_dfu, BLE_DFU_OP_CODE_CREATE_OBJECT, res_code);
+            }
+
+            if (dfu_req.obj_type == NRF_DFU_OBJ_TYPE_DATA)
+            {
+                // Erase is queued behind the flash writes of the previous object.
+                res_code = (nrf_dfu_res_code_t)dfu_pipeline_create(dfu_req.object_size);
+                return response_send(p_dfu, BLE_DFU_OP_CODE_CREATE_OBJECT, res_code);
+            }
+
             // Set req type
             dfu_req.req_type        = NRF_DFU_OBJECT_OP_CREATE;
 
+            (void)dfu_pipeline_flush();
             res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
             return response_send(p_dfu, BLE_DFU_OP_CODE_CREATE_OBJECT, res_code);
 
         case BLE_DFU_OP_CODE_EXECUTE_OBJECT:
             NRF_LOG_INFO("Received execute object\r\n");
 
+            if (m_object_type == NRF_DFU_OBJ_TYPE_DATA)
+            {
+                // Only the last object is smaller than the maximum. The image is validated when it
+                // is executed, so the DFU Controller has to wait for that one.
+                res_code = (nrf_dfu_res_code_t)dfu_pipeline_execute(m_object_size == m_max_object_size);
+                m_partial_object = false;
+                return response_send(p_dfu, BLE_DFU_OP_CODE_EXECUTE_OBJECT, res_code);
+            }
+
             // Set req type
             dfu_req.req_type     =  NRF_DFU_OBJECT_OP_EXECUTE;
 
+            (void)dfu_pipeline_flush();
             res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
             return response_send(p_dfu, BLE_DFU_OP_CODE_EXECUTE_OBJECT, res_code);
 
@@ -466,6 +695,17 @@ static uint32_t on_ctrl_pt_write(ble_dfu_t * p_dfu, ble_gatts_evt_write_t * p_bl
         case BLE_DFU_OP_CODE_CALCULATE_CRC:
             NRF_LOG_INFO("Received calculate CRC\r\n");
 
+            if (m_object_type == NRF_DFU_OBJ_TYPE_DATA)
+            {
+                // Received data, which may still be waiting for the flash.
+                res_code = (nrf_dfu_res_code_t)dfu_pipeline_result();
+                if (res_code == NRF_DFU_RES_CODE_SUCCESS)
+                {
+                    return response_crc_cmd_send(p_dfu, dfu_pipeline_offset(), dfu_pipeline_crc());
+                }
+                return response_send(p_dfu, BLE_DFU_OP_CODE_CALCULATE_CRC, res_code);
+            }
+
             dfu_req.req_type     =  NRF_DFU_OBJECT_OP_CRC;
 
             res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
@@ -495,9 +735,26 @@ static uint32_t on_ctrl_pt_write(ble_dfu_t * p_dfu, ble_gatts_evt_write_t * p_bl
 
             dfu_req.req_type = NRF_DFU_OBJECT_OP_SELECT;
 
+            m_object_type = dfu_req.obj_type;
+
+            // Offset and CRC of the request handler are up to date once the pipeline is empty.
+            (void)dfu_pipeline_flush();
             res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
             if (res_code == NRF_DFU_RES_CODE_SUCCESS)
             {
+                if (dfu_req.obj_type == NRF_DFU_OBJ_TYPE_DATA)
+                {
+                    m_max_object_size = dfu_res.max_size;
+                    if (dfu_decoder_is_coded())
+                    {
+                        // Decoder state is not kept, a coded image is received again from its start.
+                        dfu_res.offset = 0;
+                        dfu_res.crc    = 0;
+                    }
+                    m_partial_object  = (dfu_res.max_size != 0) && ((dfu_res.offset % dfu_res.max_size) != 0);
+                    dfu_decoder_restart(dfu_res.offset);
+                    dfu_pipeline_position_set(dfu_res.offset, dfu_res.crc);
+                }
                 return response_select_object_cmd_send(p_dfu, dfu_res.max_size, dfu_res.offset, dfu_res.crc);
             }
             else
@@ -574,21 +831,9 @@ static void on_write(ble_dfu_t * p_dfu, ble_evt_t * p_ble_evt)
 {
     if (p_ble_evt->evt.gatts_evt.params.write.handle == p_dfu->dfu_pkt_handles.value_handle)
     {
-        nrf_dfu_res_code_t  res_code;
-        nrf_dfu_req_t       dfu_req;
-        nrf_dfu_res_t       dfu_res = {{{0}}};
-
-        memset(&dfu_req, 0, sizeof(nrf_dfu_req_t));
-
-        // Set req type
-        dfu_req.req_type =  NRF_DFU_OBJECT_OP_WRITE;
-
-        // Set data and length
-        dfu_req.p_req    =  p_ble_evt->evt.gatts_evt.params.write.data;
-        dfu_req.req_len  =  p_ble_evt->evt.gatts_evt.params.write.len;
-
-        res_code = nrf_dfu_req_handler_on_req(NULL, &dfu_req, &dfu_res);
-        if(res_code != NRF_DFU_RES_CODE_SUCCESS)
+        // Data is buffered and written to flash while the DFU Controller waits for a response.
+        if (dfu_pipeline_write(p_ble_evt->evt.gatts_evt.params.write.data,
+                               p_ble_evt->evt.gatts_evt.params.write.len) != DFU_PIPELINE_RES_SUCCESS)
         {
             NRF_LOG_INFO("Failure to run packet write\r\n");
         }
@@ -596,10 +841,16 @@ static void on_write(ble_dfu_t * p_dfu, ble_evt_t * p_ble_evt)
         // Check if a packet receipt notification is needed to be sent.
         if (m_pkt_notif_target != 0 && --m_pkt_notif_target_cnt == 0)
         {
-            (void)response_crc_cmd_send(p_dfu, dfu_res.offset, dfu_res.crc);
+            (void)response_crc_cmd_send(p_dfu, dfu_pipeline_offset(), dfu_pipeline_crc());
 
             // Reset the counter for the number of firmware packets.
             m_pkt_notif_target_cnt = m_pkt_notif_target;
+
+            pipeline_schedule();
+        }
+        else if (m_pkt_notif_target == 0)
+        {
+            pipeline_schedule();
         }
     }
 }
@@ -630,6 +881,8 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
 
             m_conn_handle = BLE_CONN_HANDLE_INVALID;
 
+            // Received firmware data is kept, the DFU Controller resumes from it with Select.
+            (void)dfu_pipeline_flush();
             break;
 
         case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
@@ -673,6 +926,7 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
                     // Swallow result
                     (void) err_code;
 #endif
+                    pipeline_schedule();
                 }
             }
             break;
@@ -694,7 +948,7 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
 #if (NRF_SD_BLE_API_VERSION == 3)
         case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
             err_code = sd_ble_gatts_exchange_mtu_reply(p_ble_evt->evt.gatts_evt.conn_handle, 
-                                                       NRF_BLE_MAX_MTU_SIZE);
+                                                       m_att_mtu);
             APP_ERROR_CHECK(err_code);
             break; // BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST
 #endif
@@ -825,6 +1079,34 @@ static uint32_t ble_stack_init(bool init_softdevice)
     
     // Enable BLE stack.
     err_code = softdevice_enable(&ble_enable_params);
+#if (NRF_SD_BLE_API_VERSION == 3)
+    if (err_code == NRF_ERROR_NO_MEM)
+    {
+        // Buffers of the large MTU do not fit below RAM origin of the linker script, softdevice_enable
+        // has logged the RAM start they need. Default MTU fits the layout, DFU works at lower speed.
+        NRF_LOG_WARNING("ATT MTU %d does not fit in RAM, using %d\r\n", NRF_BLE_MAX_MTU_SIZE, GATT_MTU_SIZE_DEFAULT);
+        ble_enable_params.gatt_enable_params.att_mtu = GATT_MTU_SIZE_DEFAULT;
+        err_code = softdevice_enable(&ble_enable_params);
+    }
+    m_att_mtu = ble_enable_params.gatt_enable_params.att_mtu;
+#endif
+    VERIFY_SUCCESS(err_code);
+
+#if (NRF_SD_BLE_API_VERSION == 3)
+    ble_opt_t opt;
+
+    // Accept data length update of the DFU Controller up to a full ATT packet per LL packet.
+    memset(&opt, 0, sizeof(opt));
+    opt.gap_opt.ext_len.rxtx_max_pdu_payload_size = m_att_mtu + L2CAP_HEADER_LEN;
+    err_code = sd_ble_opt_set(BLE_GAP_OPT_EXT_LEN, &opt);
+    VERIFY_SUCCESS(err_code);
+
+    // Let connection events run for the whole connection interval while there is data.
+    memset(&opt, 0, sizeof(opt));
+    opt.common_opt.conn_evt_ext.enable = 1;
+    err_code = sd_ble_opt_set(BLE_COMMON_OPT_CONN_EVT_EXT, &opt);
+#endif
+
     return err_code;
 }
 
@@ -964,6 +1246,13 @@ uint32_t ble_dfu_transport_init(void)
 
     leds_init();
 
+    // Coded images are decoded between the pipeline and the request handler.
+    dfu_decoder_init(&m_pipeline_sink, delta_base_get);
+    dfu_pipeline_init(dfu_decoder_sink());
+
+    err_code = app_timer_create(&m_pipeline_timer, APP_TIMER_MODE_SINGLE_SHOT, pipeline_timeout_handler);
+    VERIFY_SUCCESS(err_code);
+
     err_code = ble_stack_init(true);
     VERIFY_SUCCESS(err_code);
 
@@ -18,15 +18,38 @@
 #include "nrf_log_ctrl.h"
 
 #define ADC_REF_VOLTAGE_IN_MILLIVOLTS  600  //!< Reference voltage (in milli volts) used by ADC while doing conversion.
-#define ADC_RES_10BIT                  1024 //!< Maximum digital value for 10-bit ADC conversion.
-#define ADC_PRE_SCALING_COMPENSATION   6    //!< The ADC is configured to use VDD with 1/3 prescaling as input. And hence the result of conversion is to be multiplied by 3 to get the actual value of the battery voltage.
+#define ADC_RES_BITS                   (8 + 2 * SAADC_CONFIG_RESOLUTION) //!< 8, 10, 12 or 14 bits, see sdk_config.h.
+#define ADC_RES_MAX                    (1 << ADC_RES_BITS) //!< Maximum digital value for conversion.
+#define ADC_PRE_SCALING_COMPENSATION   6    //!< The ADC is configured to use VDD with 1/6 gain as input. And hence the result of conversion is to be multiplied by 6 to get the actual value of the battery voltage.
 #define ADC_RESULT_IN_MILLI_VOLTS(ADC_VALUE) \
-    ((((ADC_VALUE) *ADC_REF_VOLTAGE_IN_MILLIVOLTS) / ADC_RES_10BIT) * ADC_PRE_SCALING_COMPENSATION)
+    ((((ADC_VALUE) *ADC_REF_VOLTAGE_IN_MILLIVOLTS * ADC_PRE_SCALING_COMPENSATION) / ADC_RES_MAX))
+#define FILTER_FRACTION_BITS           4    //!< Filtered values are stored as mV * 16.
+#define FILTER_SHIFT                   2    //!< New sample has weight of 1/4.
 
 static nrf_saadc_value_t adc_buf;           //!< Buffer used for storing ADC values.
+static nrf_saadc_value_t async_buf;         //!< Buffer used for asynchronous conversion.
 static uint8_t battery_is_init = 0;
+static volatile battery_sample_t async_type; //!< Type of conversion in progress.
+static volatile uint32_t filtered_idle = 0; //!< Filtered voltage before radio activity, mV * 16.
+static volatile uint32_t filtered_load = 0; //!< Filtered voltage right after radio activity, mV * 16.
+
+static uint16_t to_millivolts(nrf_saadc_value_t value)
+{
+    if(value < 0) { value = 0; } // Noise around 0 can give small negative values
+    return ADC_RESULT_IN_MILLI_VOLTS((uint32_t)value) + REVERSE_PROT_VOLT_DROP_MILLIVOLTS;
+}
+
+/** Exponential moving average, first sample initialises the filter **/
+static void filter_update(volatile uint32_t* filtered, uint16_t millivolts)
+{
+    uint32_t sample = (uint32_t)millivolts << FILTER_FRACTION_BITS;
+    if(0 == *filtered) { *filtered = sample; }
+    else { *filtered = *filtered - (*filtered >> FILTER_SHIFT) + (sample >> FILTER_SHIFT); }
+}
 
 /**@brief Function handling events from 'nrf_drv_saadc.c'.
+ *
+ * Runs at SAADC interrupt priority once oversampled conversion is complete.
  *
  * @param[in] p_evt SAADC event.
  */
@@ -35,6 +58,8 @@ static void saadc_event_handler(nrf_drv_saadc_evt_t const * p_evt)
 
     if (p_evt->type == NRF_DRV_SAADC_EVT_DONE)
     {
+      uint16_t millivolts = to_millivolts(p_evt->data.done.p_buffer[0]);
+      filter_update((BATTERY_SAMPLE_IDLE == async_type) ? &filtered_idle : &filtered_load, millivolts);
       NRF_LOG_DEBUG("ADC done \r\n");
     }
 }
@@ -50,6 +75,12 @@ void battery_voltage_init(void)
     err_code = nrf_drv_saadc_channel_init(0, &config);
     APP_ERROR_CHECK(err_code);
 
+    // With oversampling one SAMPLE task runs all conversions and stores the average.
+    if(SAADC_CONFIG_OVERSAMPLE)
+    {
+      NRF_SAADC->CH[0].CONFIG |= (SAADC_CH_CONFIG_BURST_Enabled << SAADC_CH_CONFIG_BURST_Pos);
+    }
+
     battery_is_init = 1;
 }
 
@@ -64,9 +95,35 @@ uint16_t getBattery(void)
 
     if (!nrf_drv_saadc_is_busy())
     {
-        err_code = nrf_drv_saadc_sample_convert(NRF_SAADC_INPUT_VDD, &adc_buf);
+        err_code = nrf_drv_saadc_sample_convert(0, &adc_buf);
         APP_ERROR_CHECK(err_code);
-
+        // Seed filters so that asynchronous readings start from a valid value.
+        uint16_t millivolts = to_millivolts(adc_buf);
+        if(0 == filtered_idle) { filter_update(&filtered_idle, millivolts); }
+        if(0 == filtered_load) { filter_update(&filtered_load, millivolts); }
     }
-    return ADC_RESULT_IN_MILLI_VOLTS(adc_buf) + REVERSE_PROT_VOLT_DROP_MILLIVOLTS;
+    return to_millivolts(adc_buf);
+}
+
+ret_code_t battery_sample_start(battery_sample_t type)
+{
+    if(!battery_is_init)          { return NRF_ERROR_INVALID_STATE; }
+    if(nrf_drv_saadc_is_busy())   { return NRF_ERROR_BUSY; }
+
+    async_type = type;
+    ret_code_t err_code = nrf_drv_saadc_buffer_convert(&async_buf, 1);
+    if(NRF_SUCCESS != err_code) { return err_code; }
+    return nrf_drv_saadc_sample();
+}
+
+uint16_t battery_voltage_get(void)
+{
+    return filtered_load >> FILTER_FRACTION_BITS;
+}
+
+uint16_t battery_load_drop_get(void)
+{
+    uint32_t idle = filtered_idle;
+    uint32_t load = filtered_load;
+    return (idle > load) ? (idle - load) >> FILTER_FRACTION_BITS : 0;
 }
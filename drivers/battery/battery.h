@@ -14,6 +14,13 @@
 #define BATTERY_VOLTAGE_H__
 
 #include <stdint.h>
+#include "sdk_errors.h"
+
+/** Moment of asynchronous battery sample relative to radio activity */
+typedef enum{
+  BATTERY_SAMPLE_IDLE = 0,  /**< Battery has been resting, e.g. just before radio activity */
+  BATTERY_SAMPLE_LOAD = 1   /**< Battery is recovering from load, e.g. right after radio activity */
+}battery_sample_t;
 
 /**@brief Function for initializing the battery voltage module.
  */
@@ -29,4 +36,28 @@ void battery_voltage_init(void);
  */
 uint16_t getBattery(void);
 
+/**@brief Start asynchronous battery conversion.
+ *
+ * Returns immediately, conversion runs in background with resolution and
+ * oversampling of SAADC_CONFIG_RESOLUTION and SAADC_CONFIG_OVERSAMPLE. Result is
+ * filtered separately for each sample type. Safe to call from interrupt context,
+ * e.g. radio notification.
+ *
+ * @returns NRF_SUCCESS if conversion was started, NRF_ERROR_BUSY if SAADC is busy,
+ *          NRF_ERROR_INVALID_STATE if battery_voltage_init has not been called.
+ */
+ret_code_t battery_sample_start(battery_sample_t type);
+
+/**@brief Filtered battery voltage of BATTERY_SAMPLE_LOAD samples in millivolts.
+ *
+ * 0 until first sample has been taken.
+ */
+uint16_t battery_voltage_get(void);
+
+/**@brief Filtered difference of BATTERY_SAMPLE_IDLE and BATTERY_SAMPLE_LOAD samples in millivolts.
+ *
+ * Grows as internal resistance of the battery grows, i.e. towards end of life and in cold.
+ */
+uint16_t battery_load_drop_get(void);
+
 #endif
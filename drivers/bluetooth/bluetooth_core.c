@@ -141,6 +141,19 @@ static ble_gap_conn_params_t   gap_conn_params;
 static ble_gap_conn_sec_mode_t sec_mode;
 static ble_advdata_manuf_data_t m_manufacturer_data;
 
+/** Encoded advertisement of a rotator slot */
+typedef struct {
+  uint8_t  data[BLE_GAP_ADV_MAX_SIZE];
+  uint16_t length;
+  uint16_t duration_ms;                 // 0: slot is skipped
+}rotator_frame_t;
+
+APP_TIMER_DEF(rotator_timer_id);        // Single shot, fires when frame on air has had its duration.
+static rotator_frame_t rotator_frames[BLUETOOTH_ROTATOR_SLOTS];
+static uint8_t rotator_slot = 0;        // Slot on air while running
+static bool rotator_running = false;
+static bool rotator_timer_created = false;
+
 /**
  * Generate name "BASEXXXX", where Base is human-readable (i.e. Ruuvi) and XXXX is  last 4 chars of mac address
  *
@@ -429,14 +442,14 @@ void peer_manager_init(bool erase_bonds)
  * @brief Function to set BLE transmission power
  *  
  * @details set the BLE transmission power in dBm
- * @param int8_t power power in dBm, must be one of -40, -30, -20, -16, -12, -8, -4, 0, 4
- * @return error code, 0 if operation was success.
+ * @param int8_t power power in dBm, must be one of -40, -20, -16, -12, -8, -4, 0, 3, 4
+ * @return error code, 0 if operation was success. Power is kept on error.
  */
 ret_code_t bluetooth_tx_power_set(int8_t power)
 {
     uint32_t err_code = sd_ble_gap_tx_power_set(power);
     //APP_ERROR_CHECK(err_code);
-    tx_power = power;
+    if(NRF_SUCCESS == err_code) { tx_power = power; }
     return err_code;
 }
 
@@ -531,3 +544,116 @@ ret_code_t bluetooth_set_eddystone_url(char* url_buffer, size_t length)
   err_code |= ble_advdata_set(&advdata, &scanresp);
   return err_code;
 }
+
+/**
+ * Put encoded frame of slot on air, NULL scan response keeps current one.
+ */
+static ret_code_t rotator_apply(uint8_t slot)
+{
+  return sd_ble_gap_adv_data_set(rotator_frames[slot].data, rotator_frames[slot].length, NULL, 0);
+}
+
+/**
+ * Find next slot with a frame after given slot, given slot itself if it is the only one.
+ *
+ * @return slot, BLUETOOTH_ROTATOR_SLOTS if no slot has a frame
+ */
+static uint8_t rotator_next(uint8_t slot)
+{
+  for(uint8_t ii = 1; ii <= BLUETOOTH_ROTATOR_SLOTS; ii++)
+  {
+    uint8_t next = (slot + ii) % BLUETOOTH_ROTATOR_SLOTS;
+    if(rotator_frames[next].duration_ms) { return next; }
+  }
+  return BLUETOOTH_ROTATOR_SLOTS;
+}
+
+static ret_code_t rotator_timer_start(uint8_t slot)
+{
+  return app_timer_start(rotator_timer_id,
+                         APP_TIMER_TICKS(rotator_frames[slot].duration_ms, RUUVITAG_APP_TIMER_PRESCALER),
+                         NULL);
+}
+
+/**
+ * Swap next frame on air. App timer handlers run from scheduler, so frames are not
+ * encoded and swapped at the same time.
+ */
+static void rotator_timer_handler(void* p_context)
+{
+  if(!rotator_running) { return; }
+  ret_code_t err_code = NRF_SUCCESS;
+  uint8_t next = rotator_next(rotator_slot);
+  if(BLUETOOTH_ROTATOR_SLOTS == next)
+  {
+    rotator_running = false;
+    return;
+  }
+  if(next != rotator_slot) { err_code |= rotator_apply(next); }
+  rotator_slot = next;
+  err_code |= rotator_timer_start(next);
+  if(NRF_SUCCESS != err_code) { NRF_LOG_WARNING("Rotator swap failed: %d\r\n", err_code); }
+}
+
+ret_code_t bluetooth_rotator_set(uint8_t slot, const ble_advdata_t* p_advdata, uint16_t duration_ms)
+{
+  if(BLUETOOTH_ROTATOR_SLOTS <= slot) { return NRF_ERROR_INVALID_PARAM; }
+  rotator_frame_t* p_frame = &rotator_frames[slot];
+  if(NULL == p_advdata)
+  {
+    memset(p_frame, 0, sizeof(rotator_frame_t));
+    return NRF_SUCCESS;
+  }
+
+  uint16_t length = sizeof(p_frame->data);
+  ret_code_t err_code = adv_data_encode(p_advdata, p_frame->data, &length);
+  if(NRF_SUCCESS != err_code)
+  {
+    memset(p_frame, 0, sizeof(rotator_frame_t));
+    return err_code;
+  }
+  p_frame->length = length;
+  p_frame->duration_ms = duration_ms;
+  // Fresh data of frame on air goes out on next advertising event
+  if(rotator_running && slot == rotator_slot) { err_code |= rotator_apply(slot); }
+  return err_code;
+}
+
+ret_code_t bluetooth_rotator_set_manufacturer_data(uint8_t slot, uint8_t* data, size_t length, uint16_t duration_ms)
+{
+  if(24 < length || 0 == length) { return NRF_ERROR_INVALID_PARAM; }
+  ble_advdata_manuf_data_t manufacturer_data = { .company_identifier = BLE_COMPANY_IDENTIFIER,
+                                                 .data = { .size = length, .p_data = data } };
+  ble_advdata_t frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.p_manuf_specific_data = &manufacturer_data;
+  frame.flags = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+  return bluetooth_rotator_set(slot, &frame, duration_ms);
+}
+
+ret_code_t bluetooth_rotator_start(void)
+{
+  ret_code_t err_code = NRF_SUCCESS;
+  if(!rotator_timer_created)
+  {
+    err_code |= app_timer_create(&rotator_timer_id, APP_TIMER_MODE_SINGLE_SHOT, rotator_timer_handler);
+    rotator_timer_created = (NRF_SUCCESS == err_code);
+  }
+  uint8_t first = rotator_next(BLUETOOTH_ROTATOR_SLOTS - 1);
+  if(BLUETOOTH_ROTATOR_SLOTS == first) { return NRF_ERROR_INVALID_STATE; }
+  if(rotator_timer_created) { app_timer_stop(rotator_timer_id); }
+
+  rotator_slot = first;
+  err_code |= rotator_apply(first);
+  err_code |= rotator_timer_start(first);
+  rotator_running = (NRF_SUCCESS == err_code);
+  NRF_LOG_DEBUG("Rotator start status %d\r\n", err_code);
+  return err_code;
+}
+
+ret_code_t bluetooth_rotator_stop(void)
+{
+  rotator_running = false;
+  if(!rotator_timer_created) { return NRF_SUCCESS; }
+  return app_timer_stop(rotator_timer_id);
+}
@@ -60,7 +60,7 @@ ret_code_t bluetooth_advertising_stop(void);
  * @brief Function to setsBLE transmission power
  *  
  * @details set the BLE transmission power in dBm
- * @param int8_t power power in dBm, must be one of -40, -30, -20, -16, -12, -8, -4, 0, 4
+ * @param int8_t power power in dBm, must be one of -40, -20, -16, -12, -8, -4, 0, 3, 4
  * @return error code, 0 if operation was success.
  */
 ret_code_t bluetooth_tx_power_set(int8_t power);
@@ -109,4 +109,44 @@ ret_code_t bluetooth_configure_advertisement_type(uint8_t type);
  *        as long as https:// is written as 0x03
  */
 ret_code_t bluetooth_set_eddystone_url(char* url_buffer, size_t length);
+
+#define BLUETOOTH_ROTATOR_SLOTS 3   /**< Frames rotator can cycle, e.g. RAWv2, Eddystone URL and TLM */
+
+/**
+ * Encode advertisement data into a slot of advertisement rotator.
+ *
+ * Data is encoded here once, rotation only swaps encoded buffers in the SoftDevice.
+ * If slot is on air, new data goes out on next advertising event. Scan response is not changed.
+ *
+ * @param slot 0 ... BLUETOOTH_ROTATOR_SLOTS - 1
+ * @param p_advdata advertisement data, e.g. from eddystone_prepare_url_advertisement. NULL clears slot
+ * @param duration_ms time frame stays on air before next slot, at least advertising interval. 0 skips slot
+ * @return error code from encoding or BLE stack, NRF_SUCCESS if ok
+ */
+ret_code_t bluetooth_rotator_set(uint8_t slot, const ble_advdata_t* p_advdata, uint16_t duration_ms);
+
+/**
+ * Set manufacturer specific data into a slot of advertisement rotator, as bluetooth_set_manufacturer_data()
+ * but rotated with other slots.
+ *
+ * @param slot 0 ... BLUETOOTH_ROTATOR_SLOTS - 1
+ * @param data pointer to data to advertise, maximum length 24 bytes
+ * @param length length of data to advertise
+ * @param duration_ms time frame stays on air before next slot, 0 skips slot
+ */
+ret_code_t bluetooth_rotator_set_manufacturer_data(uint8_t slot, uint8_t* data, size_t length, uint16_t duration_ms);
+
+/**
+ * Start cycling slots of advertisement rotator, first slot with a frame goes on air.
+ * Advertising itself is started and configured as before. While rotator runs, data set with
+ * bluetooth_set_manufacturer_data() and bluetooth_set_eddystone_url() is replaced on next swap.
+ *
+ * @return NRF_ERROR_INVALID_STATE if no slot has a frame, error code from timer or BLE stack otherwise
+ */
+ret_code_t bluetooth_rotator_start(void);
+
+/**
+ * Stop cycling slots, frame on air stays in advertisement.
+ */
+ret_code_t bluetooth_rotator_stop(void);
 #endif
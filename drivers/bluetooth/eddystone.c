@@ -32,12 +32,35 @@
 #include "bluetooth_core.h"
 #include "bsp.h"
 #include "es.h"
+#include "sensortag.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 
 #include "bluetooth_core.h"
 #define EDDYSTONE_UUID 0xFEAA
+#define EDDYSTONE_TLM_VERSION 0x00   // Unencrypted TLM
+
+static ble_uuid_t adv_uuids[] = {{EDDYSTONE_UUID, BLE_UUID_TYPE_BLE}};
+
+/** Fill advdata with Eddystone service data of frame, frame must stay valid until advdata is encoded */
+static void prepare_service_data(ble_advdata_t* advdata, uint8_t* frame, size_t length)
+{
+    static ble_advdata_service_data_t service_data;                 // Structure to hold Service Data.
+    service_data.service_uuid = EDDYSTONE_UUID;                     // Eddystone UUID to allow discoverability on iOS devices.
+    service_data.data.p_data = frame;                               // Pointer to the data to advertise.
+    service_data.data.size = length;                                // Size of the data to advertise.
+
+    // Build and set advertising data.
+    memset(advdata, 0, sizeof(ble_advdata_t));
+
+    advdata->flags = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+    advdata->uuids_complete.uuid_cnt = sizeof(adv_uuids) / sizeof(adv_uuids[0]);
+    advdata->uuids_complete.p_uuids  = adv_uuids;
+    advdata->p_service_data_array    = &service_data;  // Pointer to Service Data structure.
+    advdata->service_data_count      = 1;
+}
+
 /**
  *  @brief Helper for advertising Eddystone URLs. 
  *
@@ -51,9 +74,6 @@ ret_code_t eddystone_prepare_url_advertisement(ble_advdata_t* advdata, char* url
 {
     //Scheme byte is not included in length
     if(length > 18) { return NRF_ERROR_INVALID_PARAM; }
-    static ble_uuid_t    adv_uuids[] = {{EDDYSTONE_UUID, BLE_UUID_TYPE_BLE}};
-
-    static uint8_array_t eddystone_data_array;                             // Array for Service Data structure.
     uint8_t rf_power[] = APP_CONFIG_CALIBRATED_RANGING_DATA;
 
     static char eddystone_url_data[21] = {0};
@@ -61,22 +81,38 @@ ret_code_t eddystone_prepare_url_advertisement(ble_advdata_t* advdata, char* url
     eddystone_url_data[1] = rf_power[7];                            // RSSI value at 0 m. at 0 dbm transmit. TODO
     memcpy(eddystone_url_data+2, url, length);                      // URL with a maximum length of 17 bytes.  
 
-    eddystone_data_array.p_data = (uint8_t *) eddystone_url_data;   // Pointer to the data to advertise.
-    eddystone_data_array.size = 2 + length;                         // Size of the data to advertise.
-
-
-    static ble_advdata_service_data_t service_data;                        // Structure to hold Service Data.
-    service_data.service_uuid = EDDYSTONE_UUID;                     // Eddystone UUID to allow discoverability on iOS devices.
-    service_data.data = eddystone_data_array;                       // Array for service advertisement data.
-
-    // Build and set advertising data.
-    memset(advdata, 0, sizeof(ble_advdata_t));
+    prepare_service_data(advdata, (uint8_t *) eddystone_url_data, 2 + length);
+    return NRF_SUCCESS;
+}
 
-    advdata->flags = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
-    advdata->uuids_complete.uuid_cnt = sizeof(adv_uuids) / sizeof(adv_uuids[0]);
-    advdata->uuids_complete.p_uuids  = adv_uuids;
-    advdata->p_service_data_array    = &service_data;  // Pointer to Service Data structure.
-    advdata->service_data_count      = 1;
+/**
+ *  @brief Helper for advertising unencrypted Eddystone TLM, fields are big-endian.
+ *
+ *  @param advdata Advertisement data which will be filled with Eddystone TLM
+ *  @param vbatt battery voltage, mV
+ *  @param temperature temperature in 1/100 C, TEMPERATURE_INVALID if unknown
+ *  @param adv_count advertising PDUs sent since boot
+ *  @param uptime time since boot, 0.1 s
+ *  @return Error code, 0 on success
+ */
+ret_code_t eddystone_prepare_tlm_advertisement(ble_advdata_t* advdata, uint16_t vbatt, int32_t temperature,
+                                               uint32_t adv_count, uint32_t uptime)
+{
+    static uint8_t tlm[14];
+    // Signed 8.8 fixed point, 0x8000 if not supported
+    int16_t temperature_8_8 = (TEMPERATURE_INVALID == temperature) ? -0x8000 : (temperature * 256) / 100;
+    tlm[0]  = ES_FRAME_TYPE_TLM;
+    tlm[1]  = EDDYSTONE_TLM_VERSION;
+    tlm[2]  = vbatt >> 8;
+    tlm[3]  = vbatt & 0xFF;
+    tlm[4]  = (uint16_t)temperature_8_8 >> 8;
+    tlm[5]  = temperature_8_8 & 0xFF;
+    for(uint8_t ii = 0; ii < 4; ii++)
+    {
+      tlm[6 + ii]  = adv_count >> (24 - 8 * ii);
+      tlm[10 + ii] = uptime >> (24 - 8 * ii);
+    }
 
+    prepare_service_data(advdata, tlm, sizeof(tlm));
     return NRF_SUCCESS;
 }
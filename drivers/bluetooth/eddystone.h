@@ -15,4 +15,17 @@
  */
  ret_code_t eddystone_prepare_url_advertisement(ble_advdata_t* advdata, char* url, size_t length);
 
+/**
+ *  @brief Helper for advertising unencrypted Eddystone TLM.
+ *
+ *  @param advdata Advertisement data which will be filled with Eddystone TLM
+ *  @param vbatt battery voltage, mV
+ *  @param temperature temperature in 1/100 C, TEMPERATURE_INVALID if unknown
+ *  @param adv_count advertising PDUs sent since boot
+ *  @param uptime time since boot, 0.1 s
+ *  @return Error code, 0 on success
+ */
+ ret_code_t eddystone_prepare_tlm_advertisement(ble_advdata_t* advdata, uint16_t vbatt, int32_t temperature,
+                                                uint32_t adv_count, uint32_t uptime);
+
 #endif
@@ -38,13 +38,23 @@
  *  2017-01-28 Otso Jousimaa Add comments.
  *  2017-04-06: Add t_sb register value. 
  *  2017-08-12 Otso Jousimaa (otso@ruuvi.com): Add Error checking, IIR filtering
+ *  2026-10-19: Track oversampling, add measurement time for forced mode scheduling.
+ *  2026-10-19: Skip reads of unfinished forced measurements, cache compensated values.
+ *  2026-10-19: Log setters through deferred binary trace.
+ *  2026-10-19: Add measurement read as queued SPI transaction.
+ *  2026-10-19: Add mode getter for sensor interface.
+ *  2026-10-19: Limit forced measurements to selected channels.
+ *  2026-10-19: Add init with calibration kept over warm reset.
+ *  2026-10-19: Read calibration in two bursts, confirm preloaded calibration with one short read.
  */
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "bme280.h"
 #include "init.h" //Timer ticks - todo: refactor
+#include "trace.h"
 
 #define NRF_LOG_MODULE_NAME "BME280"
 #include "nrf_log.h"
@@ -59,6 +69,69 @@ void timer_bme280_event_handler(void* p_context);
 /** state variable **/
 static uint8_t current_mode = BME280_MODE_SLEEP;
 static uint8_t current_interval = BME280_STANDBY_1000_MS;
+static uint8_t current_os_hum   = BME280_OVERSAMPLING_SKIP;
+static uint8_t current_os_temp  = BME280_OVERSAMPLING_SKIP;
+static uint8_t current_os_press = BME280_OVERSAMPLING_SKIP;
+static bool    forced_pending   = false;  // Forced measurement triggered but not read yet
+static uint8_t forced_channels  = BME280_CHANNEL_ALL;  // Channels of next forced measurements
+static uint8_t measured_channels = BME280_CHANNEL_ALL; // Channels whose data registers are being updated
+static uint8_t updated_channels = 0;      // Channels whose raw value changed on latest read
+static bme280_stats_t stats = {0};
+static uint8_t calibration_raw[BME280_CALIBRATION_LENGTH]; // Registers of latest calibration
+static bool    calibration_preloaded = false;   // calibration_raw was preloaded and confirmed by bme280_init()
+
+/** Buffers of queued measurement read, EasyDMA needs them in RAM for the whole transfer **/
+static uint8_t measurement_tx[BME280_BURST_READ_LENGTH];
+static uint8_t measurement_rx[BME280_BURST_READ_LENGTH];
+
+/** Compensated values and the raw values they were computed from **/
+static struct {
+  uint8_t  valid;           // BME280_CHANNEL_* bits
+  int32_t  adc_t;
+  int32_t  adc_p;
+  int32_t  adc_h;
+  int32_t  p_adc_t;         // Pressure and humidity depend on t_fine, i.e. adc_t
+  int32_t  h_adc_t;
+  int32_t  temperature;
+  uint32_t pressure;
+  uint32_t humidity;
+}cache;
+
+/** Read length consecutive registers from start in one transfer */
+static BME280_Ret read_registers(uint8_t start, uint8_t length, uint8_t* p_data)
+{
+  uint8_t tx[BME280_CALIBRATION_TP_LENGTH + 1] = {0};
+  uint8_t rx[BME280_CALIBRATION_TP_LENGTH + 1] = {0};
+  if(BME280_CALIBRATION_TP_LENGTH < length) { return BME280_RET_ERROR; }
+  tx[0] = start | 0x80;
+  SPI_Ret err_code = spi_transfer_bme280(tx, length + 1, rx);
+  memcpy(p_data, &rx[1], length);
+  return (SPI_RET_OK == err_code) ? BME280_RET_OK : BME280_RET_ERROR;
+}
+
+/** Decode calibration registers 0x88...0xA1, 0xE1...0xE7 into compensation parameters */
+static void calibration_parse(const uint8_t* p_raw)
+{
+  const uint8_t* h = &p_raw[BME280_CALIBRATION_TP_LENGTH];
+  bme280.cp.dig_T1 = (uint16_t)(p_raw[0]  | (p_raw[1]  << 8));
+  bme280.cp.dig_T2 = (int16_t) (p_raw[2]  | (p_raw[3]  << 8));
+  bme280.cp.dig_T3 = (int16_t) (p_raw[4]  | (p_raw[5]  << 8));
+  bme280.cp.dig_P1 = (uint16_t)(p_raw[6]  | (p_raw[7]  << 8));
+  bme280.cp.dig_P2 = (int16_t) (p_raw[8]  | (p_raw[9]  << 8));
+  bme280.cp.dig_P3 = (int16_t) (p_raw[10] | (p_raw[11] << 8));
+  bme280.cp.dig_P4 = (int16_t) (p_raw[12] | (p_raw[13] << 8));
+  bme280.cp.dig_P5 = (int16_t) (p_raw[14] | (p_raw[15] << 8));
+  bme280.cp.dig_P6 = (int16_t) (p_raw[16] | (p_raw[17] << 8));
+  bme280.cp.dig_P7 = (int16_t) (p_raw[18] | (p_raw[19] << 8));
+  bme280.cp.dig_P8 = (int16_t) (p_raw[20] | (p_raw[21] << 8));
+  bme280.cp.dig_P9 = (int16_t) (p_raw[22] | (p_raw[23] << 8));
+  bme280.cp.dig_H1 = p_raw[25];                           // 0xA1
+  bme280.cp.dig_H2 = (int16_t)(h[0] | (h[1] << 8));       // 0xE1, 0xE2
+  bme280.cp.dig_H3 = h[2];
+  bme280.cp.dig_H4 = (h[3] << 4) | (h[4] & 0x0f);         // 0xE4 11:4, 0xE5 3:0
+  bme280.cp.dig_H5 = (h[4] >> 4) | (h[5] << 4);           // 0xE5 7:4, 0xE6 11:4
+  bme280.cp.dig_H6 = (int8_t)h[6];
+}
 
 BME280_Ret bme280_init()
 {
@@ -82,49 +155,62 @@ BME280_Ret bme280_init()
 		return (0x00 == reg) ? BME280_RET_ERROR : BME280_RET_ERROR_SELFTEST;
   }
 
-  // load calibration data...
-  bme280.cp.dig_T1  = bme280_read_reg(BME280REG_CALIB_00);
-  bme280.cp.dig_T1 |= bme280_read_reg(BME280REG_CALIB_00+1) << 8;
-  bme280.cp.dig_T2  = bme280_read_reg(BME280REG_CALIB_00+2);
-  bme280.cp.dig_T2 |= bme280_read_reg(BME280REG_CALIB_00+3) << 8;
-  bme280.cp.dig_T3  = bme280_read_reg(BME280REG_CALIB_00+4);
-  bme280.cp.dig_T3 |= bme280_read_reg(BME280REG_CALIB_00+5) << 8;
-
-  bme280.cp.dig_P1  = bme280_read_reg(BME280REG_CALIB_00+6);
-  bme280.cp.dig_P1 |= bme280_read_reg(BME280REG_CALIB_00+7) << 8;
-  bme280.cp.dig_P2  = bme280_read_reg(BME280REG_CALIB_00+8);
-  bme280.cp.dig_P2 |= bme280_read_reg(BME280REG_CALIB_00+9) << 8;
-  bme280.cp.dig_P3  = bme280_read_reg(BME280REG_CALIB_00+10);
-  bme280.cp.dig_P3 |= bme280_read_reg(BME280REG_CALIB_00+11) << 8;
-  bme280.cp.dig_P4  = bme280_read_reg(BME280REG_CALIB_00+12);
-  bme280.cp.dig_P4 |= bme280_read_reg(BME280REG_CALIB_00+13) << 8;
-  bme280.cp.dig_P5  = bme280_read_reg(BME280REG_CALIB_00+14);
-  bme280.cp.dig_P5 |= bme280_read_reg(BME280REG_CALIB_00+15) << 8;
-  bme280.cp.dig_P6  = bme280_read_reg(BME280REG_CALIB_00+16);
-  bme280.cp.dig_P6 |= bme280_read_reg(BME280REG_CALIB_00+17) << 8;
-  bme280.cp.dig_P7  = bme280_read_reg(BME280REG_CALIB_00+18);
-  bme280.cp.dig_P7 |= bme280_read_reg(BME280REG_CALIB_00+19) << 8;
-  bme280.cp.dig_P8  = bme280_read_reg(BME280REG_CALIB_00+20);
-  bme280.cp.dig_P8 |= bme280_read_reg(BME280REG_CALIB_00+21) << 8;
-  bme280.cp.dig_P9  = bme280_read_reg(BME280REG_CALIB_00+22);
-  bme280.cp.dig_P9 |= bme280_read_reg(BME280REG_CALIB_00+23) << 8;
-
-  bme280.cp.dig_H1  = bme280_read_reg(0xA1);
-  bme280.cp.dig_H2  = bme280_read_reg(0xE1);
-  bme280.cp.dig_H2 |= bme280_read_reg(0xE2) << 8;
-  bme280.cp.dig_H3  = bme280_read_reg(0xE3);
-
-  bme280.cp.dig_H4  = bme280_read_reg(0xE4) << 4;		// 11:4
-  bme280.cp.dig_H4 |= bme280_read_reg(0xE5) & 0x0f;	// 3:0
-
-  bme280.cp.dig_H5  = bme280_read_reg(0xE5) >> 4;		// 3:0
-  bme280.cp.dig_H5 |= bme280_read_reg(0xE6) << 4;		// 11:4
-
-  bme280.cp.dig_H6  = bme280_read_reg(0xE7);
+  // Preloaded calibration is confirmed by its first bytes, one short burst instead of all registers
+  uint8_t check[BME280_CALIBRATION_CHECK_LENGTH];
+  calibration_preloaded = calibration_preloaded &&
+                          BME280_RET_OK == read_registers(BME280REG_CALIB_00, sizeof(check), check) &&
+                          0 == memcmp(check, calibration_raw, sizeof(check));
+  if(!calibration_preloaded)
+  {
+    BME280_Ret err_code = BME280_RET_OK;
+    err_code |= read_registers(BME280REG_CALIB_00, BME280_CALIBRATION_TP_LENGTH, calibration_raw);
+    err_code |= read_registers(BME280REG_CALIB_26, BME280_CALIBRATION_LENGTH - BME280_CALIBRATION_TP_LENGTH,
+                               &calibration_raw[BME280_CALIBRATION_TP_LENGTH]);
+    if(BME280_RET_OK != err_code) { return BME280_RET_ERROR; }
+  }
+  calibration_parse(calibration_raw);
+
+  // New calibration invalidates compensated values
+  cache.valid = 0;
  
   return BME280_RET_OK;
 }
 
+BME280_Ret bme280_init_calibrated(const struct comp_params* p_calibration)
+{
+  if(NULL == p_calibration) { return BME280_RET_NULL; }
+  if(BME280_MODE_SLEEP != current_mode){ return BME280_RET_ILLEGAL; }
+  if (!spi_isInitialized())
+  {
+    spi_init();
+  }
+  bme280.sensor_available = true;
+  bme280.cp = *p_calibration;
+  cache.valid = 0;
+  return BME280_RET_OK;
+}
+
+const struct comp_params* bme280_get_calibration(void)
+{
+  return &bme280.cp;
+}
+
+void bme280_preload_calibration(const uint8_t* p_raw)
+{
+  calibration_preloaded = (NULL != p_raw);
+  if(calibration_preloaded) { memcpy(calibration_raw, p_raw, sizeof(calibration_raw)); }
+}
+
+const uint8_t* bme280_get_calibration_raw(void)
+{
+  return calibration_raw;
+}
+
+bool bme280_calibration_is_preloaded(void)
+{
+  return calibration_preloaded;
+}
+
 
 /*
  *  TODO: Adjust timer frequency by BME280 sampling speed.
@@ -132,17 +218,21 @@ BME280_Ret bme280_init()
  */
 BME280_Ret bme280_set_mode(enum BME280_MODE mode)
 {
-  NRF_LOG_DEBUG("Setting BME mode: %x\r\n", mode);
+  TRACE_DEBUG("Setting BME mode: %x\r\n", mode);
   if(!bme280.sensor_available) { return BME280_RET_ERROR;  }
   uint8_t conf, reg;
   
-  BME280_Ret status = BME280_RET_ERROR;
+  BME280_Ret status = BME280_RET_OK;
   reg = bme280_read_reg(BME280REG_CTRL_HUM);
   conf = bme280_read_reg(BME280REG_CTRL_MEAS);
-  NRF_LOG_DEBUG("CONFIG before mode: %x\r\n", conf);
-  status |= bme280_write_reg(BME280REG_CTRL_HUM, reg);  //HUMIDITY must be written first
+  TRACE_DEBUG("CONFIG before mode: %x\r\n", conf);
   conf = conf & 0b11111100;
   conf |= mode;
+  // Oversampling of channels left out of forced measurement is skipped, configured value is restored otherwise
+  uint8_t channels = (BME280_MODE_FORCED == mode) ? forced_channels : BME280_CHANNEL_ALL;
+  reg  = (reg & ~0x07) | ((channels & BME280_CHANNEL_HUMIDITY) ? current_os_hum : BME280_OVERSAMPLING_SKIP);
+  conf = (conf & 0b11100011) | (((channels & BME280_CHANNEL_PRESSURE) ? current_os_press : BME280_OVERSAMPLING_SKIP) << 2);
+  status |= bme280_write_reg(BME280REG_CTRL_HUM, reg);  //HUMIDITY must be written first
 
   switch(mode)
   {
@@ -164,10 +254,26 @@ BME280_Ret bme280_set_mode(enum BME280_MODE mode)
       break;
   }
 
-  if(BME280_RET_OK == status) {current_mode = mode;}
+  // Sensor returns to sleep by itself after forced measurement
+  if(BME280_RET_OK == status && BME280_MODE_FORCED != mode) {current_mode = mode;}
+  forced_pending = (BME280_RET_OK == status && BME280_MODE_FORCED == mode);
+  if(BME280_RET_OK == status && BME280_MODE_SLEEP != mode) { measured_channels = channels; }
   return status;
 }
 
+BME280_Ret bme280_set_forced_channels(uint8_t channels)
+{
+  // Temperature is always measured, pressure and humidity compensation need it
+  channels = (channels & BME280_CHANNEL_ALL) | BME280_CHANNEL_TEMPERATURE;
+  forced_channels = channels;
+  return BME280_RET_OK;
+}
+
+enum BME280_MODE bme280_get_mode(void)
+{
+  return current_mode;
+}
+
 BME280_Ret bme280_set_interval(enum BME280_INTERVAL interval)
 {
   if(BME280_MODE_SLEEP != current_mode){ return BME280_RET_ILLEGAL; }
@@ -212,7 +318,9 @@ BME280_Ret bme280_set_oversampling_hum(uint8_t os)
   uint8_t meas;
   meas = bme280_read_reg(BME280REG_CTRL_MEAS);
   bme280_write_reg(BME280REG_CTRL_HUM, os);
-  return bme280_write_reg(BME280REG_CTRL_MEAS, meas); //Changes to humi take effect after write to meas
+  BME280_Ret status = bme280_write_reg(BME280REG_CTRL_MEAS, meas); //Changes to humi take effect after write to meas
+  if(BME280_RET_OK == status) { current_os_hum = os; }
+  return status;
 }
 
 
@@ -225,7 +333,9 @@ BME280_Ret bme280_set_oversampling_temp(uint8_t os)
   bme280_write_reg(BME280REG_CTRL_HUM, humi);
   meas &= 0b00011111;
   meas |= (os<<5);
-  return bme280_write_reg(BME280REG_CTRL_MEAS, meas);
+  BME280_Ret status = bme280_write_reg(BME280REG_CTRL_MEAS, meas);
+  if(BME280_RET_OK == status) { current_os_temp = os; }
+  return status;
 }
 
 
@@ -238,7 +348,53 @@ BME280_Ret bme280_set_oversampling_press(uint8_t os)
   bme280_write_reg(BME280REG_CTRL_HUM, humi);
   meas &= 0b11100011;
   meas |= (os<<2);
-  return bme280_write_reg(BME280REG_CTRL_MEAS, meas);
+  BME280_Ret status = bme280_write_reg(BME280REG_CTRL_MEAS, meas);
+  if(BME280_RET_OK == status) { current_os_press = os; }
+  return status;
+}
+
+uint8_t bme280_get_oversampling_hum(void)
+{
+  return current_os_hum;
+}
+
+uint8_t bme280_get_oversampling_temp(void)
+{
+  return current_os_temp;
+}
+
+uint8_t bme280_get_oversampling_press(void)
+{
+  return current_os_press;
+}
+
+/** Number of samples taken with given oversampling register value */
+static uint32_t oversampling_to_samples(uint8_t os)
+{
+  if(BME280_OVERSAMPLING_SKIP == os) { return 0; }
+  if(BME280_OVERSAMPLING_16 < os)    { os = BME280_OVERSAMPLING_16; }
+  return 1 << (os - 1);
+}
+
+/**
+ * Maximum measurement time, datasheet appendix B:
+ * 1.25 ms + 2.3 ms * T_os + (2.3 ms * P_os + 0.575 ms) + (2.3 ms * H_os + 0.575 ms)
+ */
+uint32_t bme280_measurement_time_us(uint8_t os_temp, uint8_t os_press, uint8_t os_hum)
+{
+  uint32_t time_us = 1250 + 2300 * oversampling_to_samples(os_temp);
+  if(BME280_OVERSAMPLING_SKIP != os_press) { time_us += 2300 * oversampling_to_samples(os_press) + 575; }
+  if(BME280_OVERSAMPLING_SKIP != os_hum)   { time_us += 2300 * oversampling_to_samples(os_hum) + 575; }
+  return time_us;
+}
+
+uint32_t bme280_get_measurement_time_us(void)
+{
+  // Forced measurements are started from sleep, normal mode measures all channels
+  uint8_t channels = (BME280_MODE_SLEEP == current_mode) ? forced_channels : BME280_CHANNEL_ALL;
+  return bme280_measurement_time_us(current_os_temp,
+                                    (channels & BME280_CHANNEL_PRESSURE) ? current_os_press : BME280_OVERSAMPLING_SKIP,
+                                    (channels & BME280_CHANNEL_HUMIDITY) ? current_os_hum : BME280_OVERSAMPLING_SKIP);
 }
 	
 BME280_Ret bme280_set_iir(uint8_t iir)
@@ -247,10 +403,59 @@ BME280_Ret bme280_set_iir(uint8_t iir)
    uint8_t conf = bme280_read_reg(BME280REG_CONFIG);
    conf &= ~BME280_IIR_MASK;
    conf |= BME280_IIR_MASK & iir;
-   NRF_LOG_DEBUG("Writing %d to %d\r\n", conf, BME280REG_CONFIG);
+   TRACE_DEBUG("Writing %d to %d\r\n", conf, BME280REG_CONFIG);
    return bme280_write_reg(BME280REG_CONFIG, conf);
 }
 
+/**
+ * @brief Check if a read would return the previous result.
+ */
+static bool measurement_skipped(void)
+{
+  // Data registers still hold the previous result which has been read already.
+  // In normal mode registers are shadowed during conversion, so reading is always safe.
+  if(forced_pending && bme280_is_measuring())
+  {
+    stats.reads_skipped++;
+    updated_channels = 0;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Store raw values of burst read, data[0] is the response to address byte.
+ */
+static void parse_measurements(const uint8_t* data)
+{
+  forced_pending = false;
+  stats.reads++;
+
+  int32_t adc_h = data[8] + ((uint32_t)data[7] << 8);
+
+  int32_t adc_t  = (uint32_t) data[6] >> 4;
+  adc_t |= (uint32_t) data[5] << 4;
+  adc_t |= (uint32_t) data[4] << 12;
+
+  int32_t adc_p  = (uint32_t) data[3] >> 4;
+  adc_p |= (uint32_t) data[2] << 4;
+  adc_p |= (uint32_t) data[1] << 12;
+
+  // Skipped channels read as 0x80000 / 0x8000, keep previous result
+  if(!(measured_channels & BME280_CHANNEL_PRESSURE)) { adc_p = bme280.adc_p; }
+  if(!(measured_channels & BME280_CHANNEL_HUMIDITY)) { adc_h = bme280.adc_h; }
+
+  updated_channels = 0;
+  if(adc_t != bme280.adc_t) { updated_channels |= BME280_CHANNEL_TEMPERATURE; }
+  if(adc_p != bme280.adc_p) { updated_channels |= BME280_CHANNEL_PRESSURE; }
+  if(adc_h != bme280.adc_h) { updated_channels |= BME280_CHANNEL_HUMIDITY; }
+  if(!updated_channels) { stats.reads_unchanged++; }
+
+  bme280.adc_t = adc_t;
+  bme280.adc_p = adc_p;
+  bme280.adc_h = adc_h;
+}
+
 /**
  * @brief Read new raw values.
  */
@@ -258,21 +463,54 @@ BME280_Ret bme280_read_measurements()
 {
 
   if(!bme280.sensor_available) { return BME280_RET_ERROR;  }
+  if(measurement_skipped())    { return BME280_INVALID; }
+
   uint8_t data[BME280_BURST_READ_LENGTH];
   
   BME280_Ret err_code = bme280_read_burst(BME280REG_PRESS_MSB, BME280_BURST_READ_LENGTH, data);
+  if(BME280_RET_OK != err_code) { return err_code; }
+  parse_measurements(data);
 
-  bme280.adc_h = data[8] + ((uint32_t)data[7] << 8);
+  return err_code;
+}
 
-  bme280.adc_t  = (uint32_t) data[6] >> 4;
-  bme280.adc_t |= (uint32_t) data[5] << 4;
-  bme280.adc_t |= (uint32_t) data[4] << 12;
+BME280_Ret bme280_measurement_transaction(spi_transaction_t* p_transaction, spi_transaction_handler_t handler, void* p_context)
+{
+  if(NULL == p_transaction)    { return BME280_RET_NULL; }
+  if(!bme280.sensor_available) { return BME280_RET_ERROR; }
+  if(measurement_skipped())    { return BME280_INVALID; }
+
+  memset(measurement_tx, 0, sizeof(measurement_tx));
+  measurement_tx[0] = BME280REG_PRESS_MSB | 0x80;
+  p_transaction->device    = SPI_DEVICE_BME280;
+  p_transaction->p_tx      = measurement_tx;
+  p_transaction->p_rx      = measurement_rx;
+  p_transaction->length    = BME280_BURST_READ_LENGTH;
+  p_transaction->handler   = handler;
+  p_transaction->p_context = p_context;
+  return BME280_RET_OK;
+}
 
-  bme280.adc_p  = (uint32_t) data[3] >> 4;
-  bme280.adc_p |= (uint32_t) data[2] << 4;
-  bme280.adc_p |= (uint32_t) data[1] << 12;
+BME280_Ret bme280_measurement_complete(const spi_transaction_t* p_transaction)
+{
+  if(NULL == p_transaction) { return BME280_RET_NULL; }
+  if(measurement_rx != p_transaction->p_rx || SPI_TRANSACTION_DONE != p_transaction->state ||
+     NRF_SUCCESS != p_transaction->result)
+  {
+    return BME280_RET_ERROR;
+  }
+  parse_measurements(measurement_rx);
+  return BME280_RET_OK;
+}
 
-  return err_code;
+uint8_t bme280_get_updated_channels(void)
+{
+  return updated_channels;
+}
+
+const bme280_stats_t* bme280_get_stats(void)
+{
+  return &stats;
 }
 
 
@@ -342,8 +580,16 @@ static int32_t compensate_T_int32(int32_t adc_T)
  */
 int32_t bme280_get_temperature(void)
 {
-	int32_t temp = compensate_T_int32(bme280.adc_t);
-	return temp;
+  if((cache.valid & BME280_CHANNEL_TEMPERATURE) && cache.adc_t == bme280.adc_t)
+  {
+    stats.compensations_skipped++;
+    return cache.temperature;
+  }
+  cache.temperature = compensate_T_int32(bme280.adc_t);
+  cache.adc_t = bme280.adc_t;
+  cache.valid |= BME280_CHANNEL_TEMPERATURE;
+  stats.compensations++;
+  return cache.temperature;
 }
 
 
@@ -354,8 +600,19 @@ int32_t bme280_get_temperature(void)
  */
 uint32_t bme280_get_pressure(void)
 {
-	uint32_t press = compensate_P_int64(bme280.adc_p);
-	return press;
+  // Updates t_fine if temperature has changed
+  bme280_get_temperature();
+  if((cache.valid & BME280_CHANNEL_PRESSURE) && cache.adc_p == bme280.adc_p && cache.p_adc_t == bme280.adc_t)
+  {
+    stats.compensations_skipped++;
+    return cache.pressure;
+  }
+  cache.pressure = compensate_P_int64(bme280.adc_p);
+  cache.adc_p   = bme280.adc_p;
+  cache.p_adc_t = bme280.adc_t;
+  cache.valid  |= BME280_CHANNEL_PRESSURE;
+  stats.compensations++;
+  return cache.pressure;
 }
 
 
@@ -366,8 +623,19 @@ uint32_t bme280_get_pressure(void)
  */
 uint32_t bme280_get_humidity(void)
 {
-	uint32_t humi = compensate_H_int32(bme280.adc_h);
-	return humi;
+  // Updates t_fine if temperature has changed
+  bme280_get_temperature();
+  if((cache.valid & BME280_CHANNEL_HUMIDITY) && cache.adc_h == bme280.adc_h && cache.h_adc_t == bme280.adc_t)
+  {
+    stats.compensations_skipped++;
+    return cache.humidity;
+  }
+  cache.humidity = compensate_H_int32(bme280.adc_h);
+  cache.adc_h   = bme280.adc_h;
+  cache.h_adc_t = bme280.adc_t;
+  cache.valid  |= BME280_CHANNEL_HUMIDITY;
+  stats.compensations++;
+  return cache.humidity;
 }
 
 uint8_t bme280_read_reg(uint8_t reg)
@@ -410,6 +678,6 @@ BME280_Ret bme280_write_reg(uint8_t reg, uint8_t value)
  */
 void timer_bme280_event_handler(void* p_context)
 {
-    NRF_LOG_DEBUG("BME280 event \r\n");
+    TRACE_DEBUG("BME280 event \r\n");
     bme280_read_measurements(); //read previous data
 }
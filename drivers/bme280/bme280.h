@@ -41,6 +41,12 @@
  *  2017-01-28 Otso Jousimaa Add comments.
  *  2017-04-06: Add t_sb register value. 
  *  2017-08-12 Otso Jousimaa (otso@ruuvi.com): Add Error checking, IIR filtering
+ *  2026-10-19: Track oversampling, add measurement time for forced mode scheduling.
+ *  2026-10-19: Skip reads of unfinished forced measurements, cache compensated values.
+ *  2026-10-19: Add measurement read as queued SPI transaction.
+ *  2026-10-19: Add mode getter for sensor interface.
+ *  2026-10-19: Limit forced measurements to selected channels.
+ *  2026-10-19: Add oversampling getters and measurement time of given oversampling.
  */
 
 
@@ -124,6 +130,10 @@ typedef enum
 
 #define BME280_ID_VALUE          (0x60)
 
+#define BME280_CALIBRATION_TP_LENGTH    (26) ///< Calibration registers 0x88...0xA1, temperature, pressure and H1
+#define BME280_CALIBRATION_LENGTH       (33) ///< All calibration registers, 0x88...0xA1 and 0xE1...0xE7
+#define BME280_CALIBRATION_CHECK_LENGTH (6)  ///< Temperature parameters, read to confirm preloaded calibration
+
 #define BME280_OVERSAMPLING_SKIP (0x00)
 #define BME280_OVERSAMPLING_1    (0x01)
 #define BME280_OVERSAMPLING_2    (0x02)
@@ -158,11 +168,50 @@ typedef struct {
   uint32_t pressure;
 }bme280_data_t;
 
+/** Bits of bme280_get_updated_channels() */
+#define BME280_CHANNEL_TEMPERATURE (1<<0)
+#define BME280_CHANNEL_PRESSURE    (1<<1)
+#define BME280_CHANNEL_HUMIDITY    (1<<2)
+#define BME280_CHANNEL_ALL         (BME280_CHANNEL_TEMPERATURE | BME280_CHANNEL_PRESSURE | BME280_CHANNEL_HUMIDITY)
+
+/** Counters of driver work, reset only on boot */
+typedef struct {
+  uint32_t reads;                 /**< Burst reads of data registers */
+  uint32_t reads_skipped;         /**< Reads skipped because forced measurement was still running */
+  uint32_t reads_unchanged;       /**< Burst reads where no raw value changed */
+  uint32_t compensations;         /**< Compensation formulas run */
+  uint32_t compensations_skipped; /**< Compensated values returned from cache */
+}bme280_stats_t;
+
 /**
  *  Initialises BME280 in sleep mode, all sensors enabled
  */
 BME280_Ret bme280_init();
 
+/**
+ *  Initialises driver of a BME280 whose calibration was read by bme280_init() before a warm
+ *  reset. Sensor is neither probed nor read, caller configures it as after bme280_init().
+ */
+BME280_Ret bme280_init_calibrated(const struct comp_params* p_calibration);
+
+/** Return calibration read by bme280_init(), to be kept over a warm reset **/
+const struct comp_params* bme280_get_calibration(void);
+
+/**
+ *  Preload calibration registers stored earlier, e.g. in flash. Following bme280_init()
+ *  confirms them with a read of BME280_CALIBRATION_CHECK_LENGTH bytes instead of reading
+ *  all calibration registers, and reads all of them if sensor has other values. NULL clears.
+ *
+ *  @param p_raw BME280_CALIBRATION_LENGTH bytes of bme280_get_calibration_raw()
+ */
+void bme280_preload_calibration(const uint8_t* p_raw);
+
+/** Return BME280_CALIBRATION_LENGTH bytes of calibration registers read or confirmed by bme280_init() **/
+const uint8_t* bme280_get_calibration_raw(void);
+
+/** Return true if bme280_init() used preloaded calibration **/
+bool bme280_calibration_is_preloaded(void);
+
 /**
  * Set mode of BME280: 
  *  - Sleep  (off)
@@ -171,6 +220,16 @@ BME280_Ret bme280_init();
  */
 BME280_Ret bme280_set_mode(enum BME280_MODE mode);
 
+/** Return current mode, sleep while a forced measurement runs **/
+enum BME280_MODE bme280_get_mode(void);
+
+/**
+ *  Select BME280_CHANNEL_* bits measured by following forced measurements, others are
+ *  skipped and keep their previous value. Temperature is always measured. Configured
+ *  oversampling is kept, normal mode measures all channels. Default is all channels.
+ */
+BME280_Ret bme280_set_forced_channels(uint8_t channels);
+
 /**
  * Set sampling interval of BME280 in normal mode
  * Note that interval is a standby time between measurements,
@@ -194,9 +253,43 @@ int  bme280_is_measuring(void);
  *  bme_set_mode(BME280_MODE_FORCED)
  *  while(bme280_is_measuroing());
  *  bme280_read_measurements();
+ *
+ *  Returns BME280_INVALID without reading if forced measurement is still in progress,
+ *  previous values are kept.
  */
 BME280_Ret bme280_read_measurements();
 
+/**
+ *  Prepare burst read of measurements as a transaction of spi_transaction.h, to be
+ *  queued by caller, e.g. in one sequence with other sensors. Buffers are owned by
+ *  the driver, only one measurement transaction can be in flight.
+ *  Call bme280_measurement_complete() when the transaction is done.
+ *
+ *  Returns BME280_INVALID if forced measurement is still in progress, transaction is
+ *  not prepared and previous values are kept. BME280_RET_ERROR if sensor is not available.
+ */
+BME280_Ret bme280_measurement_transaction(spi_transaction_t* p_transaction, spi_transaction_handler_t handler, void* p_context);
+
+/**
+ *  Take result of transaction from bme280_measurement_transaction() into use,
+ *  as bme280_read_measurements() would.
+ *
+ *  Returns BME280_RET_ERROR if transfer failed or transaction was not prepared by driver.
+ */
+BME280_Ret bme280_measurement_complete(const spi_transaction_t* p_transaction);
+
+/**
+ *  Return BME280_CHANNEL_* bits of channels whose raw value changed on latest
+ *  bme280_read_measurements(). 0 means that latest read did not bring new data.
+ *  Getters recompute only the channels which changed, others are returned from cache.
+ */
+uint8_t bme280_get_updated_channels(void);
+
+/**
+ *  Return read and compensation counters of the driver.
+ */
+const bme280_stats_t* bme280_get_stats(void);
+
 /**
  *  Set oversampling. 
  *  OFF - measurements are not done
@@ -209,6 +302,23 @@ BME280_Ret bme280_set_oversampling_hum(uint8_t os);
 BME280_Ret bme280_set_oversampling_temp(uint8_t os);
 BME280_Ret bme280_set_oversampling_press(uint8_t os);
 
+/** Return current oversampling, BME280_OVERSAMPLING_* */
+uint8_t bme280_get_oversampling_hum(void);
+uint8_t bme280_get_oversampling_temp(void);
+uint8_t bme280_get_oversampling_press(void);
+
+/**
+ *  Return maximum duration of one measurement in microseconds with given oversampling,
+ *  BME280_OVERSAMPLING_SKIP leaves channel out. Temperature is always measured.
+ */
+uint32_t bme280_measurement_time_us(uint8_t os_temp, uint8_t os_press, uint8_t os_hum);
+
+/**
+ *  Return maximum duration of one measurement in microseconds with current oversampling
+ *  settings. Forced mode result is ready at latest this long after bme280_set_mode(BME280_MODE_FORCED).
+ */
+uint32_t bme280_get_measurement_time_us(void);
+
 /**
  *  Set IIR filter to low pass measurements. off, 2, 4, 8, 16
  *  Noise / settling time tradeoff
@@ -0,0 +1,249 @@
+#include "bme280_sensor.h"
+
+#include <stddef.h>
+#include "bme280.h"
+#include "init.h"
+#include "nrf_error.h"
+#include "spi_transaction.h"
+
+#define NRF_LOG_MODULE_NAME "BME280_SENSOR"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+/** Average supply current while measuring and in sleep, datasheet 4.5 */
+#define BME280_MEASURING_CURRENT_UA 480
+#define BME280_SLEEP_CURRENT_NA     100
+
+/** Temperature resolution without IIR filter is 16 bits + 1 per doubling of oversampling, datasheet 3.4.3 */
+#define BME280_RESOLUTION_MIN       16
+#define BME280_RESOLUTION_MAX       20
+
+static const sensor_options_t options = {
+  .sample_rates = { 1, 2, 8, 16, 200, SAMPLE_RATE_SINGLE },
+  .resolutions  = { 16, 17, 18, 19, 20 },
+  .scales       = { 0 }
+};
+
+static spi_transaction_t  transaction;
+static ruuvi_sensor_t*    p_target = NULL;
+static sensor_complete_t  read_done = NULL;
+
+static ret_code_t init(void)
+{
+  return (INIT_SUCCESS == init_bme280()) ? NRF_SUCCESS : NRF_ERROR_NOT_FOUND;
+}
+
+/** Calibration is restored with bme280_init_calibrated() */
+static ret_code_t resume(void)
+{
+  return (INIT_SUCCESS == init_bme280_calibrated()) ? NRF_SUCCESS : NRF_ERROR_NOT_FOUND;
+}
+
+/** Round sample rate to standby interval of normal mode, false if rate is not supported */
+static bool rate_to_interval(uint8_t sample_rate, enum BME280_INTERVAL* p_interval)
+{
+  if(sample_rate == 1)        { *p_interval = BME280_STANDBY_1000_MS; }
+  else if(sample_rate == 2)   { *p_interval = BME280_STANDBY_500_MS; }
+  else if(sample_rate <= 8)   { *p_interval = BME280_STANDBY_125_MS; }
+  else if(sample_rate <= 16)  { *p_interval = BME280_STANDBY_62_5_MS; }
+  else if(sample_rate <= 200) { *p_interval = BME280_STANDBY_0_5_MS; }
+  else { return false; }
+  return true;
+}
+
+static ret_code_t set_sample_rate(uint8_t sample_rate)
+{
+  ret_code_t err_code = BME280_RET_OK;
+  if(SAMPLE_RATE_STOP == sample_rate)   { return bme280_set_mode(BME280_MODE_SLEEP); }
+  if(SAMPLE_RATE_SINGLE == sample_rate) { return bme280_set_mode(BME280_MODE_FORCED); }
+
+  enum BME280_INTERVAL interval;
+  if(rate_to_interval(sample_rate, &interval)) { err_code |= bme280_set_interval(interval); }
+  else { err_code |= BME280_RET_ILLEGAL; }
+  err_code |= bme280_set_mode(BME280_MODE_NORMAL);
+  return err_code;
+}
+
+/** Temperature oversampling of resolution, BME280_OVERSAMPLING_SKIP if resolution is not supported */
+static uint8_t resolution_to_oversampling(uint8_t resolution)
+{
+  if(RESOLUTION_NO_CHANGE == resolution) { return bme280_get_oversampling_temp(); }
+  if(RESOLUTION_MIN == resolution) { resolution = BME280_RESOLUTION_MIN; }
+  if(RESOLUTION_MAX == resolution) { resolution = BME280_RESOLUTION_MAX; }
+  if(BME280_RESOLUTION_MIN > resolution || BME280_RESOLUTION_MAX < resolution) { return BME280_OVERSAMPLING_SKIP; }
+  return BME280_OVERSAMPLING_1 + resolution - BME280_RESOLUTION_MIN;
+}
+
+/** Resolution is set through temperature oversampling, pressure and humidity keep theirs */
+static ret_code_t set_resolution(uint8_t resolution)
+{
+  if(RESOLUTION_NO_CHANGE == resolution) { return ENDPOINT_SUCCESS; }
+  uint8_t os = resolution_to_oversampling(resolution);
+  if(BME280_OVERSAMPLING_SKIP == os) { return ENDPOINT_NOT_SUPPORTED; }
+  return (BME280_RET_OK == bme280_set_oversampling_temp(os)) ? ENDPOINT_SUCCESS : ENDPOINT_INVALID;
+}
+
+/** BME280 has only one scale for each sensor, accept only MIN, MAX and no change */
+static ret_code_t check_fixed(uint8_t value, uint8_t min, uint8_t max, uint8_t no_change)
+{
+  if(min == value || max == value || no_change == value) { return ENDPOINT_SUCCESS; }
+  return ENDPOINT_NOT_SUPPORTED;
+}
+
+static void configure(const ruuvi_sensor_configuration_t* p_configuration, ruuvi_sensor_configuration_t* p_result)
+{
+  // Settings can be written only in sleep, restore normal mode if sample rate is not changed
+  enum BME280_MODE mode = bme280_get_mode();
+  bme280_set_mode(BME280_MODE_SLEEP);
+
+  p_result->transmission_rate = ENDPOINT_NOT_IMPLEMENTED; //TODO: implement
+  p_result->resolution = set_resolution(p_configuration->resolution);
+  p_result->scale = check_fixed(p_configuration->scale, SCALE_MIN, SCALE_MAX, SCALE_NO_CHANGE);
+
+  //Set sample rate last as this may bring sensor out of sleep
+  if(SAMPLE_RATE_NO_CHANGE == p_configuration->sample_rate)
+  {
+    p_result->sample_rate = ENDPOINT_SUCCESS;
+    if(BME280_MODE_NORMAL == mode) { bme280_set_mode(BME280_MODE_NORMAL); }
+  }
+  else
+  {
+    p_result->sample_rate = (BME280_RET_OK == set_sample_rate(p_configuration->sample_rate)) ?
+                            ENDPOINT_SUCCESS : ENDPOINT_INVALID;
+  }
+}
+
+/** Pressure and humidity are left out of forced measurement unless asked */
+static uint32_t start(uint8_t channels)
+{
+  if(BME280_MODE_SLEEP != bme280_get_mode()) { return 0; }
+  uint8_t bme_channels = BME280_CHANNEL_TEMPERATURE;
+  if(channels & SENSOR_CAPABILITY_PRESSURE) { bme_channels |= BME280_CHANNEL_PRESSURE; }
+  if(channels & SENSOR_CAPABILITY_HUMIDITY) { bme_channels |= BME280_CHANNEL_HUMIDITY; }
+  bme280_set_forced_channels(bme_channels);
+  if(BME280_RET_OK != bme280_set_mode(BME280_MODE_FORCED)) { return 0; }
+  return bme280_get_measurement_time_us();
+}
+
+static void store(ruuvi_sensor_t* p_data)
+{
+  p_data->temperature = bme280_get_temperature();
+  p_data->pressure    = bme280_get_pressure();
+  p_data->humidity    = bme280_get_humidity();
+}
+
+static void transaction_done(spi_transaction_t* p_transaction)
+{
+  ret_code_t result = NRF_ERROR_INTERNAL;
+  if(BME280_RET_OK == bme280_measurement_complete(p_transaction))
+  {
+    store(p_target);
+    result = NRF_SUCCESS;
+  }
+  p_transaction->state = SPI_TRANSACTION_IDLE;
+  read_done(result);
+}
+
+static ret_code_t read(ruuvi_sensor_t* p_data, sensor_complete_t complete)
+{
+  // Transaction returns to idle once its result is taken into use
+  if(SPI_TRANSACTION_IDLE != transaction.state) { return NRF_ERROR_BUSY; }
+
+  BME280_Ret status = bme280_measurement_transaction(&transaction, transaction_done, NULL);
+  // Forced measurement still running, previous values are the latest
+  if(BME280_INVALID == status)
+  {
+    store(p_data);
+    complete(NRF_SUCCESS);
+    return NRF_SUCCESS;
+  }
+  if(BME280_RET_OK != status) { return NRF_ERROR_INVALID_STATE; }
+
+  p_target = p_data;
+  read_done = complete;
+  return spi_transaction_put(&transaction);
+}
+
+static uint8_t capabilities(void)
+{
+  return SENSOR_CAPABILITY_TEMPERATURE | SENSOR_CAPABILITY_HUMIDITY | SENSOR_CAPABILITY_PRESSURE;
+}
+
+/** Standby time of normal mode in microseconds */
+static uint32_t standby_us(enum BME280_INTERVAL interval)
+{
+  switch(interval)
+  {
+    case BME280_STANDBY_0_5_MS:  return 500;
+    case BME280_STANDBY_62_5_MS: return 62500;
+    case BME280_STANDBY_125_MS:  return 125000;
+    case BME280_STANDBY_500_MS:  return 500000;
+    case BME280_STANDBY_1000_MS:
+    default:                     return 1000000;
+  }
+}
+
+/** Average current of measurements repeated every period, sleep current if period is 0 */
+static uint32_t model_na(uint64_t measurement_us, uint64_t period_us)
+{
+  if(0 == period_us) { return BME280_SLEEP_CURRENT_NA; }
+  if(measurement_us > period_us) { measurement_us = period_us; }
+  return BME280_SLEEP_CURRENT_NA + (uint32_t)(measurement_us * BME280_MEASURING_CURRENT_UA * 1000 / period_us);
+}
+
+static uint32_t current_na(uint32_t interval_ms)
+{
+  uint64_t measurement_us = bme280_get_measurement_time_us();
+  // Normal mode samples on its own, forced mode once per interval
+  uint64_t period_us = (BME280_MODE_NORMAL == bme280_get_mode()) ? measurement_us + standby_us(bme280_get_interval()) :
+                       (uint64_t)interval_ms * 1000;
+  return model_na(measurement_us, period_us);
+}
+
+/**
+ *  Measurements of all channels, as normal mode and sensor sweeps of application do.
+ *  Forced measurements, also current ones outside normal mode, are estimated once per second.
+ */
+static ret_code_t estimate(const ruuvi_sensor_configuration_t* p_proposed, sensor_estimate_t* p_estimate)
+{
+  ret_code_t result = check_fixed(p_proposed->scale, SCALE_MIN, SCALE_MAX, SCALE_NO_CHANGE);
+  uint8_t os_temp = resolution_to_oversampling(p_proposed->resolution);
+  if(BME280_OVERSAMPLING_SKIP == os_temp)
+  {
+    result |= ENDPOINT_NOT_SUPPORTED;
+    os_temp = bme280_get_oversampling_temp();
+  }
+  uint64_t measurement_us = bme280_measurement_time_us(os_temp, bme280_get_oversampling_press(),
+                                                       bme280_get_oversampling_hum());
+
+  uint8_t sample_rate = p_proposed->sample_rate;
+  enum BME280_INTERVAL interval = bme280_get_interval();
+  uint64_t period_us = 0;
+  if(SAMPLE_RATE_NO_CHANGE == sample_rate && BME280_MODE_NORMAL == bme280_get_mode())
+  {
+    period_us = measurement_us + standby_us(interval);
+  }
+  else if(SAMPLE_RATE_NO_CHANGE == sample_rate || SAMPLE_RATE_SINGLE == sample_rate) { period_us = 1000000; }
+  else if(SAMPLE_RATE_STOP == sample_rate) { period_us = 0; }
+  else if(rate_to_interval(sample_rate, &interval)) { period_us = measurement_us + standby_us(interval); }
+  else { result |= ENDPOINT_INVALID; }
+
+  p_estimate->rate_hz    = period_us ? (1000000 + period_us / 2) / period_us : 0;
+  p_estimate->resolution = BME280_RESOLUTION_MIN + os_temp - BME280_OVERSAMPLING_1;
+  p_estimate->scale      = 0;
+  p_estimate->current_na = model_na(measurement_us, period_us);
+  return result;
+}
+
+const sensor_t bme280_sensor = {
+  .name         = "BME280",
+  .init         = init,
+  .configure    = configure,
+  .start        = start,
+  .read         = read,
+  .capabilities = capabilities,
+  .current_na   = current_na,
+  .resume       = resume,
+  .p_options    = &options,
+  .estimate     = estimate
+};
@@ -0,0 +1,18 @@
+#ifndef BME280_SENSOR_H
+#define BME280_SENSOR_H
+
+/**
+ *  BME280 as sensor_t of sensor.h.
+ *
+ *  In sleep mode start() triggers a forced measurement of requested channels, in normal
+ *  mode sensor samples all channels on its own and start() returns 0. Read is a queued burst read of data registers.
+ *  If forced measurement is still running read completes right away with previous values.
+ *
+ *  License: BSD-3
+ */
+
+#include "sensor.h"
+
+extern const sensor_t bme280_sensor;
+
+#endif
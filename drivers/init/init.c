@@ -33,6 +33,10 @@
 //Libraries
 #include "ruuvi_endpoints.h"
 #include "chain_channels.h"
+#include "scheduler.h"
+#include "scheduler_handler.h"
+#include "trace.h"
+#include "trace_handler.h"
 
 
 #define NRF_LOG_MODULE_NAME "INIT"
@@ -58,6 +62,16 @@ init_err_code_t init_log(void)
     return (NRF_SUCCESS == err_code) ? INIT_SUCCESS : INIT_ERR_UNKNOWN;
 }
 
+/**
+ * Time source of scheduler statistics and budgets and of trace timestamps, RTC1 ticks of app_timer
+ */
+static uint32_t scheduler_ticks(void)
+{
+    uint32_t ticks = 0;
+    app_timer_cnt_get(&ticks);
+    return ticks;
+}
+
 /**
  * Initialize ble stack
  *
@@ -76,6 +90,10 @@ init_err_code_t init_ble(void)
     //Enable scheduler - required for BLE stack
     APP_SCHED_INIT(SCHED_MAX_EVENT_DATA_SIZE, SCHED_QUEUE_SIZE);
     APP_TIMER_APPSH_INIT(RUUVITAG_APP_TIMER_PRESCALER, SCHED_QUEUE_SIZE, true);
+    scheduler_priority_init(scheduler_ticks);
+    set_scheduler_handler(scheduler_handler);
+    trace_init(scheduler_ticks);
+    set_trace_handler(trace_handler);
 
     //Enable BLE STACK
     err_code =  bluetooth_stack_init();
@@ -194,15 +212,12 @@ init_err_code_t init_lis2dh12(void)
   return err_code;
 }
 
-init_err_code_t init_bme280(void)
+/**
+ * Put BME280 whose driver has calibration to sleep mode, all sensors in oversampling x1 mode
+ */
+static init_err_code_t configure_bme280(void)
 {
-    // Read calibration
     init_err_code_t err_code = INIT_SUCCESS;
-    err_code = bme280_init();
-    if (INIT_SUCCESS != err_code)
-    {
-      return (BME280_RET_ERROR_SELFTEST == (BME280_Ret)err_code) ? INIT_ERR_SELFTEST : INIT_ERR_NO_RESPONSE;
-    }
     //TODO: reset
     bme280_set_mode(BME280_MODE_SLEEP); //Set sleep mode to allow configuration, sensor might have old config in internal RAM
     err_code |= bme280_set_interval(BME280_STANDBY_1000_MS);
@@ -223,6 +238,25 @@ init_err_code_t init_bme280(void)
     return err_code;
 }
 
+init_err_code_t init_bme280(void)
+{
+    // Read calibration
+    init_err_code_t err_code = INIT_SUCCESS;
+    err_code = bme280_init();
+    if (INIT_SUCCESS != err_code)
+    {
+      return (BME280_RET_ERROR_SELFTEST == (BME280_Ret)err_code) ? INIT_ERR_SELFTEST : INIT_ERR_NO_RESPONSE;
+    }
+    return configure_bme280();
+}
+
+init_err_code_t init_bme280_calibrated(void)
+{
+    // Calibration is restored by bme280_init_calibrated(), sensor is not probed
+    if (!bme280.sensor_available) { return INIT_ERR_NO_RESPONSE; }
+    return configure_bme280();
+}
+
 /**
  * Initialize accelerometer
  *
@@ -14,6 +14,7 @@
 #include "app_scheduler.h"
 #include "app_timer_appsh.h"
 #include "ruuvi_endpoints.h"
+#include "scheduler.h"
 #include "watchdog.h"
 
 //Timers
@@ -140,6 +141,13 @@ init_err_code_t init_lis2dh12(void);
  */
 init_err_code_t init_bme280(void);
 
+/**
+ * Initialise BME280 as init_bme280() after a warm reset, without probing the sensor
+ * and reading its calibration. Calibration must be restored with bme280_init_calibrated().
+ *
+ */
+init_err_code_t init_bme280_calibrated(void);
+
 /**
  * Initialise PWM channels
  */
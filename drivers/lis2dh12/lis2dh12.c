@@ -25,6 +25,7 @@ For a detailed description see the detailed description in @ref LIS2DH12.h
 #include "bsp.h"
 #include "boards.h"
 #include "init.h" //Timer ticks - todo: refactor
+#include "trace.h"
 
 #define NRF_LOG_MODULE_NAME "LIS2DH12"
 #include "nrf_log.h"
@@ -57,6 +58,10 @@ static uint8_t scale_interrupt_threshold(int16_t threshold_mg);
 static lis2dh12_scale_t      state_scale = LIS2DH12_SCALE16G;
 static lis2dh12_resolution_t state_resolution = LIS2DH12_RES10BIT;
 
+/** Buffers of queued sample read, EasyDMA needs them in RAM for the whole transfer. Byte 0 is address. */
+static uint8_t samples_tx[1U + LIS2DH12_FIFO_MAX_LENGTH * SENSOR_DATA_SIZE];
+static uint8_t samples_rx[1U + LIS2DH12_FIFO_MAX_LENGTH * SENSOR_DATA_SIZE];
+
 
 
 /**
@@ -198,6 +203,11 @@ lis2dh12_ret_t lis2dh12_set_resolution(lis2dh12_resolution_t resolution)
     return err_code;
 }
 
+lis2dh12_resolution_t lis2dh12_get_resolution(void)
+{
+    return state_resolution;
+}
+
 /**
  *  
  * Note: By design, when the device from high-resolution configuration (HR) is set to power-down 
@@ -210,13 +220,13 @@ lis2dh12_ret_t lis2dh12_set_sample_rate(lis2dh12_sample_rate_t sample_rate)
     lis2dh12_ret_t err_code = LIS2DH12_RET_OK;
     uint8_t ctrl[1] = {0};
     err_code |= lis2dh12_read_register(LIS2DH12_CTRL_REG1, ctrl, 1);
-    NRF_LOG_DEBUG("Read samplerate %x, status %d\r\n", ctrl[0], err_code);
+    TRACE_DEBUG("Read samplerate %x, status %d\r\n", ctrl[0], err_code);
     // Clear sample rate bits
     ctrl[0] &= ~LIS2DH12_ODR_MASK;
     // Setup sample rate
     ctrl[0] |= sample_rate;
     err_code |= lis2dh12_write_register(LIS2DH12_CTRL_REG1, ctrl, 1);
-    NRF_LOG_DEBUG("Wrote samplerate %x, status %d\r\n", ctrl[0], err_code);
+    TRACE_DEBUG("Wrote samplerate %x, status %d\r\n", ctrl[0], err_code);
 
     //Always read REFERENCE register when powering down to reset filter.
     if(LIS2DH12_RATE_0 == sample_rate)
@@ -234,7 +244,7 @@ lis2dh12_ret_t lis2dh12_get_sample_rate(lis2dh12_sample_rate_t *sample_rate)
     lis2dh12_ret_t err_code = LIS2DH12_RET_OK;
     uint8_t ctrl[1] = {0};
     err_code |= lis2dh12_read_register(LIS2DH12_CTRL_REG1, ctrl, 1);
-    NRF_LOG_DEBUG("Read samplerate %x, status %d\r\n", ctrl[0], err_code);
+    TRACE_DEBUG("Read samplerate %x, status %d\r\n", ctrl[0], err_code);
     ctrl[0] &= LIS2DH12_ODR_MASK;
     *sample_rate = ctrl[0];
     return err_code;
@@ -295,8 +305,8 @@ lis2dh12_ret_t lis2dh12_read_samples(lis2dh12_sensor_buffer_t* buffer, size_t co
 {
      lis2dh12_ret_t err_code = LIS2DH12_RET_OK;
      size_t bytes_to_read = count*sizeof(lis2dh12_sensor_buffer_t);
-     NRF_LOG_DEBUG("Reading %d bytes \r\n", bytes_to_read);
-     err_code |= lis2dh12_read_register(LIS2DH12_OUT_X_L, (uint8_t*)buffer, count*sizeof(lis2dh12_sensor_buffer_t));
+     TRACE_DEBUG("Reading %d bytes \r\n", bytes_to_read);
+     err_code |= lis2dh12_read_register(LIS2DH12_OUT_X_L, (uint8_t*)buffer, bytes_to_read);
      // Use constant bitshift, so we don't have to adjust mgpb with resolution
      for(int ii = 0; ii < count; ii++)
      {
@@ -307,6 +317,44 @@ lis2dh12_ret_t lis2dh12_read_samples(lis2dh12_sensor_buffer_t* buffer, size_t co
      return err_code;
 }
 
+lis2dh12_ret_t lis2dh12_samples_transaction(spi_transaction_t* p_transaction, size_t count,
+                                            spi_transaction_handler_t handler, void* p_context)
+{
+    if (NULL == p_transaction) { return LIS2DH12_RET_NULL; }
+    if (0 == count || LIS2DH12_FIFO_MAX_LENGTH < count) { return LIS2DH12_RET_INVALID; }
+
+    size_t length = 1U + count * SENSOR_DATA_SIZE;
+    memset(samples_tx, 0, length);
+    samples_tx[0] = LIS2DH12_OUT_X_L | SPI_READ | SPI_ADR_INC;
+    p_transaction->device    = SPI_DEVICE_LIS2DH12;
+    p_transaction->p_tx      = samples_tx;
+    p_transaction->p_rx      = samples_rx;
+    p_transaction->length    = length;
+    p_transaction->handler   = handler;
+    p_transaction->p_context = p_context;
+    return LIS2DH12_RET_OK;
+}
+
+lis2dh12_ret_t lis2dh12_samples_complete(const spi_transaction_t* p_transaction,
+                                         lis2dh12_sensor_buffer_t* buffer, size_t count)
+{
+    if (NULL == p_transaction || NULL == buffer) { return LIS2DH12_RET_NULL; }
+    if (samples_rx != p_transaction->p_rx || SPI_TRANSACTION_DONE != p_transaction->state ||
+        NRF_SUCCESS != p_transaction->result || 1U + count * SENSOR_DATA_SIZE > p_transaction->length)
+    {
+        return LIS2DH12_RET_ERROR;
+    }
+
+    memcpy(buffer, &samples_rx[1], count * SENSOR_DATA_SIZE);
+    for (size_t ii = 0; ii < count; ii++)
+    {
+        buffer[ii].sensor.x = rawToMg(buffer[ii].sensor.x);
+        buffer[ii].sensor.y = rawToMg(buffer[ii].sensor.y);
+        buffer[ii].sensor.z = rawToMg(buffer[ii].sensor.z);
+    }
+    return LIS2DH12_RET_OK;
+}
+
 // put number of samples in HW FIFO to count
 lis2dh12_ret_t lis2dh12_get_fifo_sample_number(size_t* count)
 {
@@ -719,7 +767,7 @@ static uint8_t scale_interrupt_threshold(int16_t threshold_mg)
  */
 lis2dh12_ret_t lis2dh12_read_register(const uint8_t address, uint8_t* const p_toRead, const size_t count)
 {
-    NRF_LOG_DEBUG("LIS2DH12 Register read started'\r\n");
+    TRACE_DEBUG("Register %x read of %d bytes started\r\n", address, count);
     lis2dh12_ret_t err_code = LIS2DH12_RET_OK;
     uint8_t* write_buffer   = calloc(count+1, sizeof(uint8_t));
     //Separate buffer to read data, includes room for response to address byte. 
@@ -741,7 +789,7 @@ lis2dh12_ret_t lis2dh12_read_register(const uint8_t address, uint8_t* const p_to
             memcpy(p_toRead, &(read_buffer[1]), count);
         }
     }
-    NRF_LOG_DEBUG("LIS2DH12 Register read complete'\r\n");
+    TRACE_DEBUG("Register %x read complete, status %d\r\n", address, err_code);
     free(read_buffer);
     free(write_buffer);
     return err_code;
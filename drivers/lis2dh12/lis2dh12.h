@@ -18,6 +18,7 @@ Hardware Driver for the LIS2DH12 Acceleration Sensor
 #include "nordic_common.h"
 #include "app_timer_appsh.h"
 #include "lis2dh12_registers.h"
+#include "spi_transaction.h"
 
 /* CONSTANTS **************************************************************************************/
 #define LIS2DH12_FIFO_MAX_LENGTH 32
@@ -130,6 +131,11 @@ int lis2dh12_get_full_scale();
  */
 lis2dh12_ret_t lis2dh12_set_resolution(lis2dh12_resolution_t resolution);
 
+/**
+ * Return resolution set with lis2dh12_set_resolution()
+ */
+lis2dh12_resolution_t lis2dh12_get_resolution(void);
+
 /**
  *  Select sample rate. 
  *  Returns error code from SPI write
@@ -163,6 +169,26 @@ lis2dh12_ret_t lis2dh12_set_fifo_mode(lis2dh12_fifo_mode_t mode);
  */
 lis2dh12_ret_t lis2dh12_read_samples(lis2dh12_sensor_buffer_t* buffer, size_t count);
 
+/**
+ *  Prepare read of count samples, up to LIS2DH12_FIFO_MAX_LENGTH, as a transaction of
+ *  spi_transaction.h to be queued by caller, e.g. in one sequence with other sensors.
+ *  Buffers are owned by the driver, only one sample transaction can be in flight.
+ *  Call lis2dh12_samples_complete() when the transaction is done.
+ *
+ *  Returns LIS2DH12_RET_INVALID if count is 0 or too large.
+ */
+lis2dh12_ret_t lis2dh12_samples_transaction(spi_transaction_t* p_transaction, size_t count,
+                                            spi_transaction_handler_t handler, void* p_context);
+
+/**
+ *  Copy samples of transaction from lis2dh12_samples_transaction() into buffer in mg,
+ *  as lis2dh12_read_samples() would. count must not exceed count of the transaction.
+ *
+ *  Returns LIS2DH12_RET_ERROR if transfer failed or transaction was not prepared by driver.
+ */
+lis2dh12_ret_t lis2dh12_samples_complete(const spi_transaction_t* p_transaction,
+                                         lis2dh12_sensor_buffer_t* buffer, size_t count);
+
 /**
  *  Get number of samples waiting in buffer into count.
  *  Returns error code from SPI write
@@ -0,0 +1,189 @@
+#include "lis2dh12_capture.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "ble_bulk_transfer.h"
+#include "nrf_error.h"
+#include "scheduler.h"
+
+#define NRF_LOG_MODULE_NAME "LIS2DH12_CAPTURE"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+static lis2dh12_sample_rate_t rest_rate = LIS2DH12_RATE_10;
+
+static bool collecting(void)
+{
+  capture_state_t state = capture_state();
+  return CAPTURE_ARMED == state || CAPTURE_TRIGGERED == state;
+}
+
+/** Round rate up to output data rate of LIS2DH12 */
+static lis2dh12_sample_rate_t hz_to_rate(uint16_t sample_rate_hz)
+{
+  if(sample_rate_hz <= 1)   { return LIS2DH12_RATE_1; }
+  if(sample_rate_hz <= 10)  { return LIS2DH12_RATE_10; }
+  if(sample_rate_hz <= 25)  { return LIS2DH12_RATE_25; }
+  if(sample_rate_hz <= 50)  { return LIS2DH12_RATE_50; }
+  if(sample_rate_hz <= 100) { return LIS2DH12_RATE_100; }
+  if(sample_rate_hz <= 200) { return LIS2DH12_RATE_200; }
+  return LIS2DH12_RATE_400;
+}
+
+/**
+ * Stop draining FIFO and return to rest rate. FIFO is bypassed so that output registers
+ * read by lis2dh12_sensor hold the latest sample instead of the oldest one in FIFO.
+ */
+static void rest(void)
+{
+  lis2dh12_set_interrupts(LIS2DH12_NO_INTERRUPTS, 1);
+  lis2dh12_set_fifo_mode(LIS2DH12_MODE_BYPASS);
+  lis2dh12_set_sample_rate(rest_rate);
+}
+
+void lis2dh12_capture_rest_rate_set(lis2dh12_sample_rate_t sample_rate)
+{
+  rest_rate = sample_rate;
+  if(!collecting()) { lis2dh12_set_sample_rate(rest_rate); }
+}
+
+ret_code_t lis2dh12_capture_arm(uint16_t sample_rate_hz, uint16_t pre_samples, uint16_t post_samples)
+{
+  lis2dh12_sample_rate_t sample_rate = hz_to_rate(sample_rate_hz);
+  ret_code_t err_code = capture_arm(lis2dh12_odr_to_hz(sample_rate), pre_samples, post_samples);
+  if(NRF_SUCCESS != err_code) { return err_code; }
+
+  lis2dh12_ret_t lis_code = LIS2DH12_RET_OK;
+  lis_code |= lis2dh12_set_fifo_mode(LIS2DH12_MODE_STREAM);
+  lis_code |= lis2dh12_set_fifo_watermark(LIS2DH12_CAPTURE_WATERMARK);
+  lis_code |= lis2dh12_set_interrupts(LIS2DH12_I1_WTM, 1);
+  lis_code |= lis2dh12_set_sample_rate(sample_rate);
+  if(LIS2DH12_RET_OK != lis_code)
+  {
+    lis2dh12_capture_disarm();
+    return NRF_ERROR_INTERNAL;
+  }
+  return NRF_SUCCESS;
+}
+
+void lis2dh12_capture_disarm(void)
+{
+  capture_disarm();
+  rest();
+}
+
+void lis2dh12_capture_put(const lis2dh12_sensor_buffer_t* p_buffer, size_t count)
+{
+  if(!collecting()) { return; }
+  for(size_t ii = 0; ii < count; ii++)
+  {
+    if(capture_sample_put(p_buffer[ii].sensor.x, p_buffer[ii].sensor.y, p_buffer[ii].sensor.z))
+    {
+      rest();
+      break;
+    }
+  }
+}
+
+/** Samples still in FIFO were taken before the event, trigger is after them */
+static void trigger_task(void *p_event_data, uint16_t event_size)
+{
+  size_t pending = 0;
+  lis2dh12_get_fifo_sample_number(&pending);
+  if(capture_trigger(pending)) { NRF_LOG_INFO("Capture triggered\r\n"); }
+}
+
+ret_code_t lis2dh12_capture_int2_handler(const ruuvi_standard_message_t message)
+{
+  if(CAPTURE_ARMED != capture_state()) { return NRF_SUCCESS; }
+  return scheduler_event_put(NULL, 0, trigger_task, SCHEDULER_PRIORITY_REALTIME);
+}
+
+static void put_uint16(uint8_t* p_buffer, uint16_t value)
+{
+  p_buffer[0] = value & 0xFF;
+  p_buffer[1] = value >> 8;
+}
+
+static uint16_t get_uint16(const uint8_t* p_buffer)
+{
+  return p_buffer[0] | (p_buffer[1] << 8);
+}
+
+static ret_code_t transmit(const ruuvi_standard_message_t reply)
+{
+  message_handler p_reply_handler = get_reply_handler();
+  if(NULL == p_reply_handler) { return ENDPOINT_HANDLER_ERROR; }
+  return p_reply_handler(reply);
+}
+
+static ret_code_t configure(const ruuvi_standard_message_t message)
+{
+  ret_code_t result = ENDPOINT_SUCCESS;
+  uint16_t sample_rate = message.payload[0];
+  if(SAMPLE_RATE_STOP == sample_rate) { lis2dh12_capture_disarm(); }
+  else if(NRF_SUCCESS != lis2dh12_capture_arm(sample_rate, get_uint16(&message.payload[2]),
+                                              get_uint16(&message.payload[4])))
+  {
+    result = ENDPOINT_INVALID;
+  }
+  ruuvi_standard_message_t reply = { .destination_endpoint = message.source_endpoint,
+                                     .source_endpoint      = CAPTURE,
+                                     .type                 = ACKNOWLEDGEMENT,
+                                     .payload              = {0}};
+  reply.payload[0] = result;
+  return transmit(reply);
+}
+
+static ret_code_t status_query(const ruuvi_standard_message_t message)
+{
+  capture_info_t info = capture_info();
+  ruuvi_standard_message_t reply = { .destination_endpoint = message.source_endpoint,
+                                     .source_endpoint      = CAPTURE,
+                                     .type                 = UINT16,
+                                     .payload              = {0}};
+  put_uint16(&reply.payload[0], info.state);
+  put_uint16(&reply.payload[2], info.sample_rate_hz);
+  put_uint16(&reply.payload[4], info.samples);
+  put_uint16(&reply.payload[6], info.trigger_index);
+  return transmit(reply);
+}
+
+static ret_code_t log_query(const ruuvi_standard_message_t message)
+{
+  size_t first = get_uint16(&message.payload[0]);
+  size_t count = get_uint16(&message.payload[2]);
+  if(0 == count || LIS2DH12_CAPTURE_DOWNLOAD_SAMPLES < count) { count = LIS2DH12_CAPTURE_DOWNLOAD_SAMPLES; }
+  if(CAPTURE_FROZEN != capture_state() || first >= capture_info().samples) { return ENDPOINT_INVALID; }
+
+  // Bulk transfer frees the buffer once sent
+  uint8_t* p_data = malloc(count * CAPTURE_SAMPLE_SIZE);
+  if(NULL == p_data) { return ENDPOINT_HANDLER_ERROR; }
+  count = capture_read(p_data, first, count);
+  NRF_LOG_DEBUG("Downloading samples %d - %d\r\n", first, first + count - 1);
+  if(TX_SUCCESS != ble_bulk_transfer_asynchronous(CAPTURE, p_data, count * CAPTURE_SAMPLE_SIZE))
+  {
+    free(p_data);
+    return ENDPOINT_HANDLER_ERROR;
+  }
+  return ENDPOINT_SUCCESS;
+}
+
+ret_code_t lis2dh12_capture_handler(const ruuvi_standard_message_t message)
+{
+  if(CAPTURE != message.destination_endpoint) { return ENDPOINT_INVALID; }
+  switch(message.type)
+  {
+    case SENSOR_CONFIGURATION:
+      return configure(message);
+
+    case STATUS_QUERY:
+      return status_query(message);
+
+    case LOG_QUERY:
+      return log_query(message);
+
+    default:
+      return unknown_handler(message);
+  }
+}
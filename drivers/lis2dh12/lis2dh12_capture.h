@@ -0,0 +1,84 @@
+#ifndef LIS2DH12_CAPTURE_H
+#define LIS2DH12_CAPTURE_H
+
+/**
+ *  Activity triggered capture of LIS2DH12 samples, see capture.h.
+ *
+ *  While armed, accelerometer runs at capture rate and FIFO watermark on interrupt pin 1
+ *  drains every sample into the capture ring through lis2dh12_acceleration_handler.
+ *  Activity interrupt on pin 2 triggers the capture. Once post-trigger samples have been
+ *  collected, capture freezes, watermark interrupt is disabled and accelerometer returns
+ *  to rest rate, i.e. high rate sampling lasts only from arming until the event.
+ *
+ *  Endpoint CAPTURE, registered with set_capture_handler():
+ *
+ *  SENSOR_CONFIGURATION arms capture, payload:
+ *    [0] sample rate in Hz, rounded up to LIS2DH12 rate, 0 disarms. [1] reserved,
+ *    [2..3] pre-trigger samples, [4..5] post-trigger samples, uint16 little endian.
+ *    Reply is ACKNOWLEDGEMENT with ruuvi_endpoint_ret_t in payload[0].
+ *
+ *  STATUS_QUERY returns one message, type UINT16, little endian:
+ *    [0..1] capture_state_t, [2..3] sample rate in Hz, [4..5] samples in frozen capture,
+ *    [6..7] index of first post-trigger sample
+ *
+ *  LOG_QUERY downloads frozen capture with ble_bulk_transfer_asynchronous() to CAPTURE
+ *  endpoint. [0..1] of query is the first sample, [2..3] count of samples, 0 for
+ *  LIS2DH12_CAPTURE_DOWNLOAD_SAMPLES. Data is CAPTURE_SAMPLE_SIZE bytes per sample,
+ *  see capture_read(). Capture stays frozen until armed again.
+ *
+ *  License: BSD-3
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "capture.h"
+#include "lis2dh12.h"
+#include "ruuvi_endpoints.h"
+#include "sdk_errors.h"
+
+/** FIFO watermark, leaves 16 samples of the 32 in FIFO, 40 ms at 400 Hz, for scheduler latency */
+#ifndef LIS2DH12_CAPTURE_WATERMARK
+  #define LIS2DH12_CAPTURE_WATERMARK 16
+#endif
+
+/** Largest download in one bulk transfer, buffer is allocated from heap until sent */
+#ifndef LIS2DH12_CAPTURE_DOWNLOAD_SAMPLES
+  #define LIS2DH12_CAPTURE_DOWNLOAD_SAMPLES 512
+#endif
+
+/**
+ *  Set sample rate of accelerometer between captures. Applied now unless capture is
+ *  collecting samples, else once capture freezes or is disarmed.
+ */
+void lis2dh12_capture_rest_rate_set(lis2dh12_sample_rate_t sample_rate);
+
+/**
+ *  Arm capture, previous capture is discarded. Accelerometer starts sampling at capture rate.
+ *  Interrupt pin 1 of LIS2DH12 must call lis2dh12_int1_handler and pin 2
+ *  lis2dh12_capture_int2_handler.
+ *
+ *  @param sample_rate_hz rate of capture, rounded up to LIS2DH12 rate
+ *  @param pre_samples samples kept from before activity
+ *  @param post_samples samples collected after activity
+ *
+ *  @return NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if windows do not fit or NRF_ERROR_INTERNAL
+ */
+ret_code_t lis2dh12_capture_arm(uint16_t sample_rate_hz, uint16_t pre_samples, uint16_t post_samples);
+
+/** Stop capture and return to rest rate */
+void lis2dh12_capture_disarm(void);
+
+/** Store samples read from FIFO, called by lis2dh12_acceleration_handler */
+void lis2dh12_capture_put(const lis2dh12_sensor_buffer_t* p_buffer, size_t count);
+
+/**
+ *  Handle activity interrupt of pin 2, schedules trigger of capture.
+ *  Returns NRF_SUCCESS also if capture is not armed.
+ */
+ret_code_t lis2dh12_capture_int2_handler(const ruuvi_standard_message_t message);
+
+/** Handle messages to CAPTURE endpoint */
+ret_code_t lis2dh12_capture_handler(const ruuvi_standard_message_t message);
+
+#endif
@@ -0,0 +1,224 @@
+#include "lis2dh12_gesture.h"
+
+#include <stddef.h>
+#include "lis2dh12_registers.h"
+#include "nrf_error.h"
+#include "scheduler.h"
+
+#define NRF_LOG_MODULE_NAME "LIS2DH12_GESTURE"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+/** Pin 1 is shared by click and generator 1, reads repeat until neither has an event */
+#define PIN_1_MAX_READS 3
+/** Thresholds and durations are 7 bits */
+#define FIELD_MAX       0x7F
+
+static uint8_t gestures = 0;
+static lis2dh12_gesture_handler_t gesture_handler = NULL;
+static lis2dh12_gesture_counters_t counters = { 0 };
+
+/** Convert mg to 7-bit threshold at current scale, at least 1 LSB */
+static uint8_t threshold_bits(uint16_t threshold_mg)
+{
+  int bits = (128 * threshold_mg) / lis2dh12_get_full_scale();
+  if(bits > FIELD_MAX) { bits = FIELD_MAX; }
+  return (bits < 1) ? 1 : bits;
+}
+
+/** Convert ms to 7-bit duration in samples */
+static uint8_t duration_samples(uint16_t duration_ms, lis2dh12_sample_rate_t sample_rate)
+{
+  int samples = (duration_ms * lis2dh12_odr_to_hz(sample_rate)) / 1000;
+  return (samples > FIELD_MAX) ? FIELD_MAX : samples;
+}
+
+static lis2dh12_ret_t modify_register(uint8_t address, uint8_t clear, uint8_t set)
+{
+  uint8_t value = 0;
+  lis2dh12_ret_t err_code = lis2dh12_read_register(address, &value, 1);
+  value = (value & ~clear) | set;
+  err_code |= lis2dh12_write_register(address, &value, 1);
+  return err_code;
+}
+
+/** Position bits of INT1_SRC in 6D mode to face, unknown if no axis is above threshold */
+static lis2dh12_face_t face_decode(uint8_t source)
+{
+  if(source & LIS2DH12_ZH_MASK) { return LIS2DH12_FACE_Z_UP; }
+  if(source & LIS2DH12_ZL_MASK) { return LIS2DH12_FACE_Z_DOWN; }
+  if(source & LIS2DH12_YH_MASK) { return LIS2DH12_FACE_Y_UP; }
+  if(source & LIS2DH12_YL_MASK) { return LIS2DH12_FACE_Y_DOWN; }
+  if(source & LIS2DH12_XH_MASK) { return LIS2DH12_FACE_X_UP; }
+  if(source & LIS2DH12_XL_MASK) { return LIS2DH12_FACE_X_DOWN; }
+  return LIS2DH12_FACE_UNKNOWN;
+}
+
+static void publish(lis2dh12_gesture_type_t type, uint8_t detail)
+{
+  switch(type)
+  {
+    case LIS2DH12_GESTURE_TAP:
+      counters.taps++;
+      break;
+
+    case LIS2DH12_GESTURE_DOUBLE_TAP:
+      counters.double_taps++;
+      break;
+
+    case LIS2DH12_GESTURE_ORIENTATION:
+      counters.orientation_changes++;
+      counters.face = detail;
+      break;
+
+    case LIS2DH12_GESTURE_FREEFALL:
+      counters.freefalls++;
+      break;
+
+    default:
+      return;
+  }
+  counters.sequence++;
+  counters.latest.type = type;
+  counters.latest.detail = detail;
+  NRF_LOG_DEBUG("Gesture %d, detail %x\r\n", type, detail);
+  if(NULL != gesture_handler) { gesture_handler(&counters.latest, &counters); }
+}
+
+/** Read and publish click source, clears latched click. Return true if there was an event */
+static bool click_read(void)
+{
+  uint8_t source = 0;
+  if(LIS2DH12_RET_OK != lis2dh12_read_register(LIS2DH12_CLICK_SRC, &source, 1) ||
+     !(source & LIS2DH12_CLK_IA_MASK))
+  {
+    return false;
+  }
+  uint8_t detail = source & (LIS2DH12_SIGN_MASK | LIS2DH12_Z_CLICK_MASK | LIS2DH12_Y_CLICK_MASK | LIS2DH12_X_CLICK_MASK);
+  // Both are set if first tap of a double tap was not read before the second one
+  if((source & LIS2DH12_SCLICK_MASK) && (gestures & LIS2DH12_GESTURE_ENABLE_TAP))
+  {
+    publish(LIS2DH12_GESTURE_TAP, detail);
+  }
+  if((source & LIS2DH12_DCLICK_MASK) && (gestures & LIS2DH12_GESTURE_ENABLE_DOUBLE_TAP))
+  {
+    publish(LIS2DH12_GESTURE_DOUBLE_TAP, detail);
+  }
+  return true;
+}
+
+/** Read and publish orientation source, clears latched generator 1. Return true if there was an event */
+static bool orientation_read(void)
+{
+  uint8_t source = 0;
+  if(LIS2DH12_RET_OK != lis2dh12_read_register(LIS2DH12_INT1_SOURCE, &source, 1) ||
+     !(source & LIS2DH12_INT_IA_MASK))
+  {
+    return false;
+  }
+  lis2dh12_face_t face = face_decode(source);
+  if(LIS2DH12_FACE_UNKNOWN != face && face != counters.face)
+  {
+    publish(LIS2DH12_GESTURE_ORIENTATION, face);
+  }
+  return true;
+}
+
+/** Pin 1 stays high while either latch is set, read both until there is no rising edge pending */
+static void int1_task(void *p_event_data, uint16_t event_size)
+{
+  bool pending = true;
+  for(uint8_t ii = 0; pending && ii < PIN_1_MAX_READS; ii++)
+  {
+    pending = false;
+    if(gestures & (LIS2DH12_GESTURE_ENABLE_TAP | LIS2DH12_GESTURE_ENABLE_DOUBLE_TAP)) { pending |= click_read(); }
+    if(gestures & LIS2DH12_GESTURE_ENABLE_ORIENTATION) { pending |= orientation_read(); }
+  }
+}
+
+/** Free-fall is not latched, pin 2 is high for the whole fall and rises once per fall */
+static void int2_task(void *p_event_data, uint16_t event_size)
+{
+  publish(LIS2DH12_GESTURE_FREEFALL, 0);
+}
+
+lis2dh12_ret_t lis2dh12_gesture_init(const lis2dh12_gesture_config_t* p_config, lis2dh12_gesture_handler_t handler)
+{
+  if(NULL == p_config) { return LIS2DH12_RET_NULL; }
+  lis2dh12_ret_t err_code = LIS2DH12_RET_OK;
+  gestures = p_config->gestures;
+  gesture_handler = handler;
+  lis2dh12_gesture_counters_t cleared = { 0 };
+  counters = cleared;
+
+  // Tap timings are converted to samples at current rate
+  err_code |= lis2dh12_set_sample_rate(p_config->sample_rate);
+  // Orientation and free-fall need gravity, i.e. unfiltered data
+  err_code |= modify_register(LIS2DH12_CTRL_REG2, LIS2DH12_HPIS1_MASK | (gestures & LIS2DH12_GESTURE_ENABLE_FREEFALL ? LIS2DH12_HPIS2_MASK : 0), 0);
+
+  uint8_t pin_1 = 0;
+  uint8_t latch = 0;
+  uint8_t latch_clear = LIS2DH12_D4D_INT1_MASK | LIS2DH12_LIR_INT1_MASK;
+  uint8_t click_cfg = 0;
+  if(gestures & LIS2DH12_GESTURE_ENABLE_TAP)        { click_cfg |= LIS2DH12_XS_MASK | LIS2DH12_YS_MASK | LIS2DH12_ZS_MASK; }
+  if(gestures & LIS2DH12_GESTURE_ENABLE_DOUBLE_TAP) { click_cfg |= LIS2DH12_XD_MASK | LIS2DH12_YD_MASK | LIS2DH12_ZD_MASK; }
+  if(click_cfg)
+  {
+    err_code |= lis2dh12_set_tap_interrupt(click_cfg, p_config->tap_threshold_mg, p_config->tap_timelimit_ms,
+                                           p_config->tap_latency_ms, p_config->tap_window_ms, 1);
+    err_code |= modify_register(LIS2DH12_CLICK_THS, 0, LIS2DH12_LIR_CLICK_MASK);
+    pin_1 |= LIS2DH12_I1_CLICK;
+  }
+
+  if(gestures & LIS2DH12_GESTURE_ENABLE_ORIENTATION)
+  {
+    // 6D movement: interrupt when device moves from one known position to another
+    uint8_t cfg = LIS2DH12_6D_MASK | LIS2DH12_ZHIE_MASK | LIS2DH12_ZLIE_MASK |
+                  LIS2DH12_YHIE_MASK | LIS2DH12_YLIE_MASK | LIS2DH12_XHIE_MASK | LIS2DH12_XLIE_MASK;
+    err_code |= lis2dh12_set_interrupt_configuration(cfg, 1);
+    err_code |= lis2dh12_set_threshold(threshold_bits(p_config->orientation_threshold_mg), 1);
+    uint8_t duration = duration_samples(p_config->orientation_duration_ms, p_config->sample_rate);
+    err_code |= lis2dh12_write_register(LIS2DH12_INT1_DURATION, &duration, 1);
+    pin_1 |= LIS2DH12_I1_IA1;
+    latch |= LIS2DH12_LIR_INT1_MASK;
+  }
+
+  if(gestures & LIS2DH12_GESTURE_ENABLE_FREEFALL)
+  {
+    uint8_t duration = duration_samples(p_config->freefall_duration_ms, p_config->sample_rate);
+    err_code |= lis2dh12_set_interrupt_configuration(LIS2DH12_AOI_MASK | LIS2DH12_ZLIE_MASK |
+                                                     LIS2DH12_YLIE_MASK | LIS2DH12_XLIE_MASK, 2);
+    err_code |= lis2dh12_set_threshold(threshold_bits(p_config->freefall_threshold_mg), 2);
+    err_code |= lis2dh12_write_register(LIS2DH12_INT2_DURATION, &duration, 1);
+    err_code |= lis2dh12_set_interrupts(LIS2DH12_I2C_INT2_MASK, 2);
+    // Latched free-fall would latch again on every sample of a long fall once read
+    latch_clear |= LIS2DH12_D4D_INT2_MASK | LIS2DH12_LIR_INT2_MASK;
+  }
+
+  err_code |= modify_register(LIS2DH12_CTRL_REG5, latch_clear, latch);
+  // Tap interrupt set pin 1 to click only, route all functions of pin 1 at once
+  err_code |= lis2dh12_set_interrupts(pin_1, 1);
+
+  // Latched sources of a previous configuration would hold pins high without rising edge
+  uint8_t source = 0;
+  err_code |= lis2dh12_read_register(LIS2DH12_CLICK_SRC, &source, 1);
+  err_code |= lis2dh12_read_register(LIS2DH12_INT1_SOURCE, &source, 1);
+  NRF_LOG_INFO("Gestures %x enabled\r\n", gestures);
+  return err_code;
+}
+
+ret_code_t lis2dh12_gesture_int1_handler(const ruuvi_standard_message_t message)
+{
+  return scheduler_event_put(NULL, 0, int1_task, SCHEDULER_PRIORITY_REALTIME);
+}
+
+ret_code_t lis2dh12_gesture_int2_handler(const ruuvi_standard_message_t message)
+{
+  if(!(gestures & LIS2DH12_GESTURE_ENABLE_FREEFALL)) { return NRF_SUCCESS; }
+  return scheduler_event_put(NULL, 0, int2_task, SCHEDULER_PRIORITY_REALTIME);
+}
+
+lis2dh12_gesture_counters_t lis2dh12_gesture_counters(void)
+{
+  return counters;
+}
@@ -0,0 +1,108 @@
+#ifndef LIS2DH12_GESTURE_H
+#define LIS2DH12_GESTURE_H
+
+/**
+ *  Gesture and orientation events detected by embedded functions of LIS2DH12.
+ *
+ *  Accelerometer detects events on its own while MCU sleeps, MCU wakes up only to
+ *  read source register of the interrupt:
+ *    - Tap and double tap with click function, CLICK_SRC, interrupt pin 1.
+ *    - Orientation with 6D movement recognition of interrupt generator 1, INT1_SRC, pin 1.
+ *    - Free-fall with AND of low events of interrupt generator 2, pin 2.
+ *  Tap and orientation sources are latched until read, so events are not lost to scheduler
+ *  latency. Free-fall is not latched, pin 2 stays high during the fall and each rising
+ *  edge is one fall.
+ *  Interrupt generator 2 is left untouched unless free-fall is enabled, e.g. for
+ *  lis2dh12_set_activity_interrupt_pin_2. Pin 1 is taken by gestures, FIFO watermark
+ *  of capture and spectral analysis cannot be used at the same time.
+ *
+ *  Each event updates counters and is passed to handler given to lis2dh12_gesture_init
+ *  in scheduler context.
+ *
+ *  License: BSD-3
+ */
+
+#include <stdint.h>
+
+#include "lis2dh12.h"
+#include "ruuvi_endpoints.h"
+
+/** Bits of lis2dh12_gesture_config_t.gestures */
+#define LIS2DH12_GESTURE_ENABLE_TAP         (1<<0)
+#define LIS2DH12_GESTURE_ENABLE_DOUBLE_TAP  (1<<1)
+#define LIS2DH12_GESTURE_ENABLE_ORIENTATION (1<<2)
+#define LIS2DH12_GESTURE_ENABLE_FREEFALL    (1<<3)
+
+typedef enum {
+  LIS2DH12_GESTURE_NONE        = 0,
+  LIS2DH12_GESTURE_TAP         = 1,
+  LIS2DH12_GESTURE_DOUBLE_TAP  = 2,
+  LIS2DH12_GESTURE_ORIENTATION = 3,
+  LIS2DH12_GESTURE_FREEFALL    = 4
+}lis2dh12_gesture_type_t;
+
+/** Axis pointing up, i.e. measuring +1 g */
+typedef enum {
+  LIS2DH12_FACE_UNKNOWN = 0,
+  LIS2DH12_FACE_X_UP    = 1,
+  LIS2DH12_FACE_X_DOWN  = 2,
+  LIS2DH12_FACE_Y_UP    = 3,
+  LIS2DH12_FACE_Y_DOWN  = 4,
+  LIS2DH12_FACE_Z_UP    = 5,
+  LIS2DH12_FACE_Z_DOWN  = 6
+}lis2dh12_face_t;
+
+typedef struct {
+  uint8_t  gestures;                 // LIS2DH12_GESTURE_ENABLE_ bits
+  lis2dh12_sample_rate_t sample_rate; // Timings of detection are in samples at this rate
+  uint16_t tap_threshold_mg;
+  uint16_t tap_timelimit_ms;         // Longest tap
+  uint16_t tap_latency_ms;           // Dead time after first tap of double tap
+  uint16_t tap_window_ms;            // Time to start second tap after latency
+  uint16_t orientation_threshold_mg; // Gravity on axis to recognize position, above 707 mg
+  uint16_t orientation_duration_ms;  // Position must hold this long, filters out taps and shakes
+  uint16_t freefall_threshold_mg;    // All axes below this are in free-fall
+  uint16_t freefall_duration_ms;     // Shortest free-fall
+}lis2dh12_gesture_config_t;
+
+typedef struct {
+  lis2dh12_gesture_type_t type;
+  uint8_t detail;                    // Tap: sign and axis bits of CLICK_SRC, orientation: new face
+}lis2dh12_gesture_event_t;
+
+typedef struct {
+  uint16_t taps;
+  uint16_t double_taps;
+  uint16_t orientation_changes;
+  uint16_t freefalls;
+  uint16_t sequence;                 // Count of all events, wraps
+  lis2dh12_face_t face;              // Latest recognized orientation
+  lis2dh12_gesture_event_t latest;
+}lis2dh12_gesture_counters_t;
+
+/** Called in scheduler for each event, after counters have been updated */
+typedef void(*lis2dh12_gesture_handler_t)(const lis2dh12_gesture_event_t* p_event,
+                                          const lis2dh12_gesture_counters_t* p_counters);
+
+/**
+ *  Configure embedded functions of enabled gestures and set sample rate.
+ *  Interrupt pin 1 of LIS2DH12 must call lis2dh12_gesture_int1_handler and, if free-fall
+ *  is enabled, pin 2 lis2dh12_gesture_int2_handler. Counters are cleared.
+ *
+ *  @param p_config gestures to enable and their thresholds
+ *  @param handler called on each event, may be NULL
+ *
+ *  @return LIS2DH12_RET_OK or error code of SPI
+ */
+lis2dh12_ret_t lis2dh12_gesture_init(const lis2dh12_gesture_config_t* p_config, lis2dh12_gesture_handler_t handler);
+
+/** Handle interrupt of pin 1, schedules read of tap and orientation sources */
+ret_code_t lis2dh12_gesture_int1_handler(const ruuvi_standard_message_t message);
+
+/** Handle interrupt of pin 2, schedules free-fall event */
+ret_code_t lis2dh12_gesture_int2_handler(const ruuvi_standard_message_t message);
+
+/** Return counters of events since init */
+lis2dh12_gesture_counters_t lis2dh12_gesture_counters(void);
+
+#endif
@@ -191,6 +191,7 @@
 #define LIS2DH12_X_CLICK_MASK      0x01
 
 // CLICK_THS masks
+#define LIS2DH12_LIR_CLICK_MASK 0x80
 #define LIS2DH12_CLK_THS_MASK   0x7F
 
 // TIME_LIMIT masks
@@ -0,0 +1,348 @@
+#include "lis2dh12_sensor.h"
+
+#include <stddef.h>
+#include "init.h"
+#include "lis2dh12.h"
+#include "nrf_error.h"
+#include "spi_transaction.h"
+#include "capture.h"
+#include "vibration.h"
+
+#define NRF_LOG_MODULE_NAME "LIS2DH12_SENSOR"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+/** Supply current in power down */
+#define LIS2DH12_POWER_DOWN_CURRENT_NA 500
+
+/** 400 Hz is selected by any sample rate above 200 and cannot be listed */
+static const sensor_options_t options = {
+  .sample_rates = { 1, 10, 25, 50, 100, 200 },
+  .resolutions  = { 8, 10, 12 },
+  .scales       = { 2, 4, 8, 16 }
+};
+
+static spi_transaction_t  transaction;
+static ruuvi_sensor_t*    p_target = NULL;
+static sensor_complete_t  read_done = NULL;
+
+static ret_code_t init(void)
+{
+  return (INIT_SUCCESS == init_lis2dh12()) ? NRF_SUCCESS : NRF_ERROR_NOT_FOUND;
+}
+
+/** Driver errors are reported as ENDPOINT_INVALID */
+static ret_code_t driver_result(ret_code_t err_code)
+{
+  return (LIS2DH12_RET_OK == err_code) ? ENDPOINT_SUCCESS : ENDPOINT_INVALID;
+}
+
+/** Round sample rate to output data rate */
+static lis2dh12_sample_rate_t rate_to_odr(uint8_t sample_rate)
+{
+  if(sample_rate == 1)       { return LIS2DH12_RATE_1;  }
+  else if(sample_rate <= 10) { return LIS2DH12_RATE_10; }
+  else if(sample_rate <= 25) { return LIS2DH12_RATE_25; }
+  else if(sample_rate <= 50) { return LIS2DH12_RATE_50; }
+  else if(sample_rate <= 100){ return LIS2DH12_RATE_100; }
+  else if(sample_rate <= 200){ return LIS2DH12_RATE_200; }
+  return LIS2DH12_RATE_400;
+}
+
+/** Stream samples to FIFO at output data rate of sample rate */
+static ret_code_t set_sample_rate(uint8_t sample_rate)
+{
+  ret_code_t err_code = LIS2DH12_RET_OK;
+  NRF_LOG_DEBUG("Setting sample_rate %d\r\n", sample_rate);
+  if(SAMPLE_RATE_NO_CHANGE == sample_rate) { return ENDPOINT_SUCCESS; }
+  else if(SAMPLE_RATE_STOP == sample_rate)
+  {
+    err_code |= lis2dh12_set_sample_rate(LIS2DH12_RATE_0);
+    lis2dh12_set_fifo_mode(LIS2DH12_MODE_BYPASS);
+    return driver_result(err_code);
+  }
+
+  // TODO
+  else if(SAMPLE_RATE_SINGLE == sample_rate){ return ENDPOINT_NOT_IMPLEMENTED; }
+
+  err_code |= lis2dh12_set_fifo_mode(LIS2DH12_MODE_STREAM);
+  err_code |= lis2dh12_set_sample_rate(rate_to_odr(sample_rate));
+  return driver_result(err_code);
+}
+
+static ret_code_t set_transmission_rate(uint8_t transmission_rate)
+{
+  ret_code_t err_code = LIS2DH12_RET_OK;
+  NRF_LOG_DEBUG("Setting transmission_rate %d\r\n", transmission_rate);
+  switch(transmission_rate)
+  {
+    case TRANSMISSION_RATE_STOP:
+        err_code |= lis2dh12_set_interrupts(LIS2DH12_NO_INTERRUPTS, 1);
+        break;
+    // Both drain FIFO on watermark, handler transmits samples or DSP results
+    case TRANSMISSION_RATE_SAMPLERATE:
+    case TRANSMISSION_RATE_DSPRATE:
+        NRF_LOG_DEBUG("Enabling LIS interrupts\r\n");
+        err_code |= lis2dh12_set_fifo_watermark(30);
+        err_code |= lis2dh12_set_interrupts(LIS2DH12_I1_WTM, 1);
+        break;
+
+    case TRANSMISSION_RATE_NO_CHANGE:
+        break;
+
+    default:
+        return ENDPOINT_NOT_IMPLEMENTED;
+  }
+  return driver_result(err_code);
+}
+
+/** Resolution in bits, RESOLUTION_NO_CHANGE as current resolution. 0 if resolution is not supported */
+static uint8_t resolution_bits(uint8_t resolution)
+{
+  switch (resolution)
+  {
+    case RESOLUTION_MIN:
+    case 8:
+      return 8;
+
+    case 10:
+      return 10;
+
+    case RESOLUTION_MAX:
+    case 12:
+      return 12;
+
+    case RESOLUTION_NO_CHANGE:
+      switch(lis2dh12_get_resolution())
+      {
+        case LIS2DH12_RES8BIT:  return 8;
+        case LIS2DH12_RES12BIT: return 12;
+        default:                return 10;
+      }
+
+    default:
+      return 0;
+  }
+}
+
+static ret_code_t set_resolution(uint8_t resolution)
+{
+  NRF_LOG_DEBUG("Setting resolution %d\r\n", resolution);
+  if(RESOLUTION_NO_CHANGE == resolution) { return ENDPOINT_SUCCESS; }
+  switch (resolution_bits(resolution))
+  {
+    case 8:
+      return driver_result(lis2dh12_set_resolution(LIS2DH12_RES8BIT));
+
+    case 10:
+      return driver_result(lis2dh12_set_resolution(LIS2DH12_RES10BIT));
+
+    case 12:
+      return driver_result(lis2dh12_set_resolution(LIS2DH12_RES12BIT));
+
+    default:
+      return ENDPOINT_NOT_SUPPORTED;
+  }
+}
+
+/** Full scale in g, SCALE_NO_CHANGE as current scale. 0 if scale is not supported */
+static uint8_t scale_g(uint8_t scale)
+{
+  switch(scale)
+  {
+    case SCALE_MIN:
+    case 2:
+      return 2;
+
+    case 4:
+    case 8:
+      return scale;
+
+    case SCALE_MAX:
+    case 16:
+      return 16;
+
+    case SCALE_NO_CHANGE:
+      return lis2dh12_get_full_scale() / 1000;
+
+    default:
+      return 0;
+  }
+}
+
+static ret_code_t set_scale(uint8_t scale)
+{
+  NRF_LOG_DEBUG("Setting scale %d\r\n", scale);
+  if(SCALE_NO_CHANGE == scale) { return ENDPOINT_SUCCESS; }
+  switch(scale_g(scale))
+  {
+    case 2:
+      return driver_result(lis2dh12_set_scale(LIS2DH12_SCALE2G));
+
+    case 4:
+      return driver_result(lis2dh12_set_scale(LIS2DH12_SCALE4G));
+
+    case 8:
+      return driver_result(lis2dh12_set_scale(LIS2DH12_SCALE8G));
+
+    case 16:
+      return driver_result(lis2dh12_set_scale(LIS2DH12_SCALE16G));
+
+    default:
+      return ENDPOINT_NOT_SUPPORTED;
+  }
+}
+
+static void configure(const ruuvi_sensor_configuration_t* p_configuration, ruuvi_sensor_configuration_t* p_result)
+{
+  p_result->transmission_rate = set_transmission_rate(p_configuration->transmission_rate);
+  p_result->resolution = set_resolution(p_configuration->resolution);
+  p_result->scale = set_scale(p_configuration->scale);
+  //Call sample rate as last as this starts sampling
+  p_result->sample_rate = set_sample_rate(p_configuration->sample_rate);
+}
+
+static uint32_t start(uint8_t channels)
+{
+  return 0;
+}
+
+static void transaction_done(spi_transaction_t* p_transaction)
+{
+  lis2dh12_sensor_buffer_t buffer;
+  ret_code_t result = NRF_ERROR_INTERNAL;
+  if(LIS2DH12_RET_OK == lis2dh12_samples_complete(p_transaction, &buffer, 1))
+  {
+    p_target->accX = buffer.sensor.x;
+    p_target->accY = buffer.sensor.y;
+    p_target->accZ = buffer.sensor.z;
+    result = NRF_SUCCESS;
+  }
+  p_transaction->state = SPI_TRANSACTION_IDLE;
+  read_done(result);
+}
+
+static ret_code_t read(ruuvi_sensor_t* p_data, sensor_complete_t complete)
+{
+  // FIFO belongs to capture while it collects, its latest sample is the latest value
+  capture_state_t state = capture_state();
+  if((CAPTURE_ARMED == state || CAPTURE_TRIGGERED == state) &&
+     capture_latest(&p_data->accX, &p_data->accY, &p_data->accZ))
+  {
+    complete(NRF_SUCCESS);
+    return NRF_SUCCESS;
+  }
+
+  // Transaction returns to idle once its result is taken into use
+  if(SPI_TRANSACTION_IDLE != transaction.state) { return NRF_ERROR_BUSY; }
+  if(LIS2DH12_RET_OK != lis2dh12_samples_transaction(&transaction, 1, transaction_done, NULL))
+  {
+    return NRF_ERROR_INVALID_STATE;
+  }
+  p_target = p_data;
+  read_done = complete;
+  return spi_transaction_put(&transaction);
+}
+
+static uint8_t capabilities(void)
+{
+  return SENSOR_CAPABILITY_ACCELERATION;
+}
+
+/** Return output data rate in Hz, 0 in power down */
+static uint16_t sample_rate_hz(void)
+{
+  lis2dh12_sample_rate_t sample_rate = LIS2DH12_RATE_0;
+  if(LIS2DH12_RET_OK != lis2dh12_get_sample_rate(&sample_rate)) { return 0; }
+  return lis2dh12_odr_to_hz(sample_rate);
+}
+
+/**
+ *  Supply current at output data rate, datasheet table 12. 8-bit resolution is low-power mode,
+ *  10 and 12 bits draw the same.
+ */
+static uint32_t odr_current_na(uint16_t rate_hz, uint8_t resolution)
+{
+  bool low_power = (8 == resolution);
+  switch(rate_hz)
+  {
+    case 1:   return 2000;
+    case 10:  return low_power ? 3000  : 4000;
+    case 25:  return low_power ? 4000  : 6000;
+    case 50:  return low_power ? 6000  : 11000;
+    case 100: return low_power ? 10000 : 20000;
+    case 200: return low_power ? 18000 : 38000;
+    case 400: return low_power ? 36000 : 73000;
+    default:  return LIS2DH12_POWER_DOWN_CURRENT_NA;
+  }
+}
+
+/** Sampling is continuous, interval does not matter */
+static uint32_t current_na(uint32_t interval_ms)
+{
+  return odr_current_na(sample_rate_hz(), resolution_bits(RESOLUTION_NO_CHANGE));
+}
+
+/** Sensor samples continuously, single samples are not implemented as in configure() */
+static ret_code_t estimate(const ruuvi_sensor_configuration_t* p_proposed, sensor_estimate_t* p_estimate)
+{
+  ret_code_t result = ENDPOINT_SUCCESS;
+  uint8_t resolution = resolution_bits(p_proposed->resolution);
+  uint8_t scale = scale_g(p_proposed->scale);
+  if(0 == resolution)
+  {
+    result |= ENDPOINT_NOT_SUPPORTED;
+    resolution = resolution_bits(RESOLUTION_NO_CHANGE);
+  }
+  if(0 == scale)
+  {
+    result |= ENDPOINT_NOT_SUPPORTED;
+    scale = scale_g(SCALE_NO_CHANGE);
+  }
+
+  uint16_t rate_hz = 0;
+  switch(p_proposed->sample_rate)
+  {
+    case SAMPLE_RATE_NO_CHANGE: rate_hz = sample_rate_hz(); break;
+    case SAMPLE_RATE_STOP:      rate_hz = 0; break;
+    case SAMPLE_RATE_SINGLE:    result |= ENDPOINT_NOT_IMPLEMENTED; break;
+    default:                    rate_hz = lis2dh12_odr_to_hz(rate_to_odr(p_proposed->sample_rate)); break;
+  }
+
+  p_estimate->rate_hz    = rate_hz;
+  p_estimate->resolution = resolution;
+  p_estimate->scale      = scale;
+  p_estimate->current_na = odr_current_na(rate_hz, resolution);
+  return result;
+}
+
+/** Spectral analysis of FIFO samples, sample rate must be 100 Hz or more */
+static ret_code_t dsp(uint8_t function, uint8_t parameter)
+{
+  switch(function)
+  {
+    case DSP_LAST:
+      vibration_stop();
+      return ENDPOINT_SUCCESS;
+
+    case DSP_SPECTRUM:
+      if(100 > sample_rate_hz()) { return ENDPOINT_INVALID; }
+      return (NRF_SUCCESS == vibration_init(sample_rate_hz(), parameter)) ? ENDPOINT_SUCCESS : ENDPOINT_INVALID;
+
+    default:
+      return ENDPOINT_NOT_IMPLEMENTED;
+  }
+}
+
+const sensor_t lis2dh12_sensor = {
+  .name         = "LIS2DH12",
+  .init         = init,
+  .configure    = configure,
+  .start        = start,
+  .read         = read,
+  .capabilities = capabilities,
+  .current_na   = current_na,
+  .dsp          = dsp,
+  .p_options    = &options,
+  .estimate     = estimate
+};
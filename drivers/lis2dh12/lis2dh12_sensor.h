@@ -0,0 +1,19 @@
+#ifndef LIS2DH12_SENSOR_H
+#define LIS2DH12_SENSOR_H
+
+/**
+ *  LIS2DH12 as sensor_t of sensor.h.
+ *
+ *  Accelerometer samples on its own at configured rate, start() returns 0. Read is a
+ *  queued read of the latest sample. FIFO streaming to endpoints stays in
+ *  lis2dh12_acceleration_handler. While lis2dh12_capture collects, read returns
+ *  latest captured sample right away and leaves FIFO to capture.
+ *
+ *  License: BSD-3
+ */
+
+#include "sensor.h"
+
+extern const sensor_t lis2dh12_sensor;
+
+#endif
@@ -0,0 +1,25 @@
+#include "ecb.h"
+
+#include <string.h>
+
+#define NRF_LOG_MODULE_NAME "ECB"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+void ecb_init(ecb_t* p_ecb, const uint8_t* p_key)
+{
+  memcpy(p_ecb->data.key, p_key, SOC_ECB_KEY_LENGTH);
+}
+
+void ecb_encrypt(void* p_context, const uint8_t* p_in, uint8_t* p_out)
+{
+  ecb_t* p_ecb = p_context;
+  memcpy(p_ecb->data.cleartext, p_in, SOC_ECB_CLEARTEXT_LENGTH);
+  uint32_t err_code = sd_ecb_block_encrypt(&(p_ecb->data));
+  if(NRF_SUCCESS != err_code)
+  {
+    NRF_LOG_ERROR("ECB error %d\r\n", err_code);
+    memset(p_ecb->data.ciphertext, 0, SOC_ECB_CIPHERTEXT_LENGTH);
+  }
+  memcpy(p_out, p_ecb->data.ciphertext, SOC_ECB_CIPHERTEXT_LENGTH);
+}
@@ -0,0 +1,40 @@
+/**
+ * AES-128 block encryption with the ECB peripheral of nRF52.
+ *
+ * ECB is shared with the radio, encryption goes through SoftDevice which runs it
+ * between radio events. One block takes about 7 us of peripheral time.
+ * ecb_encrypt() has the signature of aes_block_cipher_t of libraries/adv_auth, context
+ * is an ecb_t keyed with ecb_init().
+ *
+ * SoftDevice must be enabled.
+ *
+ * License BSD-3
+ */
+
+#ifndef ECB_H
+#define ECB_H
+
+#include <stdint.h>
+#include "nrf_soc.h"
+
+typedef struct {
+  nrf_ecb_hal_data_t data;   /**< Key, cleartext and ciphertext, in RAM as ECB reads them with EasyDMA */
+}ecb_t;
+
+/**
+ * Set key of context
+ *
+ * @param p_ecb context
+ * @param p_key 16 bytes, most significant byte first
+ */
+void ecb_init(ecb_t* p_ecb, const uint8_t* p_key);
+
+/**
+ * Encrypt one block of 16 bytes. Input and output may be the same buffer.
+ * Output is zeroed if SoftDevice fails to run the encryption.
+ *
+ * @param p_context ecb_t keyed with ecb_init()
+ */
+void ecb_encrypt(void* p_context, const uint8_t* p_in, uint8_t* p_out);
+
+#endif
@@ -0,0 +1,72 @@
+#include "calibration_cache.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include "crc32.h"
+#include "flash.h"
+#include "nrf_error.h"
+
+#define NRF_LOG_MODULE_NAME "CALIBRATION"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+/** Record in flash, whole words */
+typedef struct
+{
+  uint8_t  version;
+  uint8_t  sensor_id;
+  uint8_t  length;
+  uint8_t  reserved;
+  uint8_t  data[CALIBRATION_CACHE_MAX_LENGTH];
+  uint32_t crc;                                  // CRC32 of fields above
+}calibration_record_t;
+
+static uint32_t record_crc(const calibration_record_t* p_record)
+{
+  return crc32_compute((const uint8_t*)p_record, offsetof(calibration_record_t, crc), NULL);
+}
+
+/** Read record of sensor, return true if it is valid and of current version */
+static bool record_load(uint8_t sensor_id, calibration_record_t* p_record)
+{
+  memset(p_record, 0, sizeof(*p_record));
+  if(NRF_SUCCESS != flash_record_get(CALIBRATION_CACHE_FILE_ID, sensor_id, sizeof(*p_record), p_record))
+  {
+    return false;
+  }
+  return CALIBRATION_CACHE_VERSION == p_record->version && sensor_id == p_record->sensor_id &&
+         CALIBRATION_CACHE_MAX_LENGTH >= p_record->length && record_crc(p_record) == p_record->crc;
+}
+
+ret_code_t calibration_cache_load(uint8_t sensor_id, void* p_data, size_t length)
+{
+  if(NULL == p_data) { return NRF_ERROR_NULL; }
+  if(CALIBRATION_CACHE_MAX_LENGTH < length) { return NRF_ERROR_INVALID_LENGTH; }
+  calibration_record_t record;
+  if(!record_load(sensor_id, &record) || length != record.length)
+  {
+    NRF_LOG_INFO("No calibration of sensor %x in flash\r\n", sensor_id);
+    return NRF_ERROR_NOT_FOUND;
+  }
+  memcpy(p_data, record.data, length);
+  return NRF_SUCCESS;
+}
+
+ret_code_t calibration_cache_store(uint8_t sensor_id, const void* p_data, size_t length)
+{
+  if(NULL == p_data) { return NRF_ERROR_NULL; }
+  if(CALIBRATION_CACHE_MAX_LENGTH < length) { return NRF_ERROR_INVALID_LENGTH; }
+  calibration_record_t record;
+  if(record_load(sensor_id, &record) && length == record.length && 0 == memcmp(record.data, p_data, length))
+  {
+    return NRF_SUCCESS;
+  }
+  memset(&record, 0, sizeof(record));
+  record.version = CALIBRATION_CACHE_VERSION;
+  record.sensor_id = sensor_id;
+  record.length = length;
+  memcpy(record.data, p_data, length);
+  record.crc = record_crc(&record);
+  NRF_LOG_INFO("Storing calibration of sensor %x\r\n", sensor_id);
+  return flash_record_set(CALIBRATION_CACHE_FILE_ID, sensor_id, sizeof(record), &record);
+}
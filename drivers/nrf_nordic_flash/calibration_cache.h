@@ -0,0 +1,51 @@
+/**
+ * Cache of sensor calibration in flash.
+ *
+ * Sensors with factory calibration in their registers, e.g. BME280, need not read
+ * all of it on every boot. Calibration is kept in one FDS record per sensor, keyed by
+ * the ID of the sensor. Record has a version and a CRC32 of its contents, a record of
+ * another layout or a corrupted record is treated as missing and written again.
+ * Driver confirms that the cached calibration belongs to the sensor on board with
+ * a short read, see bme280_preload_calibration().
+ *
+ * Flash must be initialised with flash_init() before use.
+ *
+ * License BSD-3
+ */
+
+#ifndef CALIBRATION_CACHE_H
+#define CALIBRATION_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdk_errors.h"
+
+/** FDS file of calibration records, record key is the ID of sensor */
+#define CALIBRATION_CACHE_FILE_ID    0x0CA1
+/** Layout of records, records of other versions are not loaded */
+#define CALIBRATION_CACHE_VERSION    1
+/** Largest calibration in bytes */
+#define CALIBRATION_CACHE_MAX_LENGTH 36
+
+/**
+ * Load cached calibration of sensor.
+ *
+ * @param sensor_id ID of sensor, e.g. value of WHO_AM_I register
+ * @param p_data    length bytes of calibration are copied here
+ * @param length    bytes of calibration, must be length of stored calibration
+ * @return NRF_SUCCESS if calibration was loaded
+ * @return NRF_ERROR_NOT_FOUND if there is no valid record of sensor with given length
+ * @return NRF_ERROR_NULL, NRF_ERROR_INVALID_LENGTH on invalid parameters
+ */
+ret_code_t calibration_cache_load(uint8_t sensor_id, void* p_data, size_t length);
+
+/**
+ * Store calibration of sensor. Flash is written only if cached calibration differs.
+ *
+ * @return NRF_SUCCESS if calibration is in flash
+ * @return NRF_ERROR_NULL, NRF_ERROR_INVALID_LENGTH on invalid parameters
+ * @return error code of flash_record_set() otherwise
+ */
+ret_code_t calibration_cache_store(uint8_t sensor_id, const void* p_data, size_t length);
+
+#endif
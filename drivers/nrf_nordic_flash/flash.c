@@ -219,6 +219,38 @@ ret_code_t flash_free_size_get(size_t* size)
   return err_code; 
  }
 
+/**
+ * Delete record in page. Space of the record is freed by next garbage collection.
+ *
+ * parameter page_id: ID of a page. Can be random number.
+ * parameter record_id: ID of a record. Can be a random number.
+ * return: NRF__SUCCESS on success
+ * return: NRF_ERROR_INVALID_STATE if flash storage is not initialized
+ * return: error code from stack on other error, e.g. if record does not exist
+ */
+ret_code_t flash_record_delete(const uint32_t page_id, const uint32_t record_id)
+{
+  if(false == m_fds_initialized) { return NRF_ERROR_INVALID_STATE; }
+
+  fds_record_desc_t desc = {0};
+  fds_find_token_t  tok  = {0};
+  ret_code_t err_code = fds_record_find(page_id, record_id, &desc, &tok);
+  if(FDS_SUCCESS != err_code) { return err_code; }
+
+  /* Start delete */
+  m_fds_processing = true;
+  err_code = fds_record_delete(&desc);
+  if(FDS_SUCCESS != err_code)
+  {
+    m_fds_processing = false;
+    return err_code;
+  }
+
+  /* Wait for process to complete */
+  while (m_fds_processing);
+  return err_code;
+}
+
 /**
  * Get data from record in page
  *
@@ -2,8 +2,10 @@
 #include "nfc.h"
 
 #include <stdint.h>
+#include <string.h>
 #include "nfc_t2t_lib.h"
 #include "nfc_ndef_msg.h"
+#include "nfc_ndef_record.h"
 #include "nfc_text_rec.h"
 //#include "nfc_uri_msg.h" for URLs, remember to adjust makefile
 #include "boards.h"
@@ -21,11 +23,50 @@
 //Do not compile RAM-consuming buffers if they're not used
 #if NFC_HAL_ENABLED
 
-uint8_t m_ndef_msg_buf[512];
+#define NDEF_MSG_BUF_SIZE 256
+
+// Payload is double buffered: next payload is encoded into spare buffer while T2T library uses active one.
+static uint8_t m_ndef_msg_buf[2][NDEF_MSG_BUF_SIZE];
+static uint8_t active_buf = 0;
+static uint32_t static_records_len = 0;  // ID, address and version records, identical in both buffers
+static uint32_t msg_len = 0;             // Length of payload in active buffer
+static volatile bool refresh_pending = false;
+static char data_string[2 * NFC_DATA_MAX_LENGTH];
+static const char hex_table[] = "0123456789abcdef";
 bool nfc_is_init = false;
 volatile bool field_on = false;
 nfc_callback_t app_callback = NULL;
 
+/**
+ * Print data as lowercase hex into data_string, return length of the string.
+ */
+static uint32_t data_string_set(const uint8_t* data, uint32_t data_length)
+{
+  if(data_length > NFC_DATA_MAX_LENGTH) { data_length = NFC_DATA_MAX_LENGTH; }
+  for (uint32_t ii = 0; ii < data_length; ii++){
+    data_string[2*ii]     = hex_table[data[ii] >> 4];
+    data_string[2*ii + 1] = hex_table[data[ii] & 0x0F];
+  }
+  return 2 * data_length;
+}
+
+/**
+ * Encode data record as the last record of a message.
+ */
+static ret_code_t data_record_encode(const uint8_t* data, uint32_t data_length, uint8_t* p_buffer, uint32_t* p_len)
+{
+  static const uint8_t data_code[] = {'d', 't'};
+  uint32_t string_length = data_string_set(data, data_length);
+
+  NFC_NDEF_TEXT_RECORD_DESC_DEF(data_text_rec,
+                                  UTF_8,
+                                  data_code,
+                                  sizeof(data_code),
+                                  (uint8_t*)data_string,
+                                  string_length);
+  return nfc_ndef_record_encode(&NFC_NDEF_TEXT_RECORD_DESC(data_text_rec), NDEF_LAST_RECORD, p_buffer, p_len);
+}
+
 /**
  * @brief Callback function for handling NFC events.
  */
@@ -42,6 +83,7 @@ void nfc_callback(void * p_context, nfc_t2t_event_t event, const uint8_t * p_dat
         case NFC_T2T_EVENT_FIELD_OFF:
             NRF_LOG_INFO("NFC Field lost \r\n");
             field_on = false;
+            refresh_pending = true;
             break;
         case NFC_T2T_EVENT_DATA_READ:
             NRF_LOG_INFO("Data read\r\n");
@@ -71,7 +113,7 @@ ret_code_t nfc_init(uint8_t* data, uint32_t data_length)
 {
     if(field_on) { return NRF_ERROR_INVALID_STATE; }
     NFC_NDEF_MSG_DEF(nfc_msg, MAX_REC_COUNT);
-    uint32_t  len = sizeof(m_ndef_msg_buf);
+    uint32_t  len = sizeof(m_ndef_msg_buf[0]);
     uint32_t  error_code = NRF_SUCCESS;
 
     //Deinit NFC if it has been previously initialized
@@ -92,13 +134,20 @@ ret_code_t nfc_init(uint8_t* data, uint32_t data_length)
     id_record_add(&NFC_NDEF_MSG(nfc_msg));
     address_record_add(&NFC_NDEF_MSG(nfc_msg));
     version_record_add(&NFC_NDEF_MSG(nfc_msg));
+    // Static records have the same length regardless of their position, store it for nfc_data_set
+    static_records_len = sizeof(m_ndef_msg_buf[0]);
+    error_code |= nfc_ndef_msg_encode(&NFC_NDEF_MSG(nfc_msg), NULL, &static_records_len);
     data_record_add(&NFC_NDEF_MSG(nfc_msg), data, data_length);
 
     /* Encode welcome message */
-    nfc_msg_encode(&NFC_NDEF_MSG(nfc_msg), m_ndef_msg_buf, &len);
+    active_buf = 0;
+    nfc_msg_encode(&NFC_NDEF_MSG(nfc_msg), m_ndef_msg_buf[active_buf], &len);
+    memcpy(m_ndef_msg_buf[!active_buf], m_ndef_msg_buf[active_buf], static_records_len);
+    msg_len = len;
+    refresh_pending = false;
 
     /* Set created message as the NFC payload */
-    error_code |= nfc_t2t_payload_set(m_ndef_msg_buf, len);
+    error_code |= nfc_t2t_payload_set(m_ndef_msg_buf[active_buf], len);
     NRF_LOG_INFO("Payload set status: %d\r\n", error_code);
 
     /* Start sensing NFC field */
@@ -110,6 +159,45 @@ ret_code_t nfc_init(uint8_t* data, uint32_t data_length)
     return error_code;
 }
 
+ret_code_t nfc_data_set(const uint8_t* data, uint32_t data_length)
+{
+  if(!nfc_is_init || field_on)             { return NRF_ERROR_INVALID_STATE; }
+  if(data_length > NFC_DATA_MAX_LENGTH)    { return NRF_ERROR_INVALID_LENGTH; }
+  if(NULL == data && data_length)          { return NRF_ERROR_NULL; }
+
+  uint8_t  next_buf = !active_buf;
+  uint32_t data_len = sizeof(m_ndef_msg_buf[0]) - static_records_len;
+  ret_code_t error_code = data_record_encode(data, data_length, m_ndef_msg_buf[next_buf] + static_records_len, &data_len);
+  if(NRF_SUCCESS != error_code) { return error_code; }
+
+  uint32_t len = static_records_len + data_len;
+  if(!refresh_pending && len == msg_len &&
+     !memcmp(m_ndef_msg_buf[next_buf], m_ndef_msg_buf[active_buf], len))
+  {
+    return NRF_SUCCESS;
+  }
+
+  // T2T library accepts new payload only while emulation is stopped.
+  // Stop and start are lightweight compared to nfc_t2t_done / nfc_t2t_setup.
+  refresh_pending = false;
+  error_code |= nfc_t2t_emulation_stop();
+  error_code |= nfc_t2t_payload_set(m_ndef_msg_buf[next_buf], len);
+  if(NRF_SUCCESS == error_code)
+  {
+    active_buf = next_buf;
+    msg_len = len;
+  }
+  else
+  {
+    // Keep previous payload, retry on next call
+    (void)nfc_t2t_payload_set(m_ndef_msg_buf[active_buf], msg_len);
+    refresh_pending = true;
+  }
+  error_code |= nfc_t2t_emulation_start();
+  NRF_LOG_DEBUG("Data update status: %d\r\n", error_code);
+  return error_code;
+}
+
 /**
  * Update NFC payload with given data. Data is converted to hex and printed as a string.
  * https://infocenter.nordicsemi.com/index.jsp?topic=%2Fcom.nordic.infocenter.sdk5.v12.0.0%2Fnfc_ndef_format_dox.html
@@ -118,13 +206,6 @@ ret_code_t nfc_init(uint8_t* data, uint32_t data_length)
 void data_record_add(nfc_ndef_msg_desc_t* nfc_msg, uint8_t* data, uint32_t data_length)
 {
   uint32_t error_code = NRF_SUCCESS;
-  uint8_t prefix[] = {'D', 'a', 't', 'a', ':'};
-  //TODO: #define data length
-  static char data_string[256] = { 0 };
-  memcpy(data_string, prefix, sizeof(prefix));
-  for (uint8_t ii = 0; ii < data_length; ii++){
-    sprintf(data_string+2*ii, "%02x", data[ii]);
-  }
   uint8_t* data_bytes = (void*)&data_string;
   static const uint8_t data_code[] = {'d', 't'};
 
@@ -133,7 +214,7 @@ void data_record_add(nfc_ndef_msg_desc_t* nfc_msg, uint8_t* data, uint32_t data_
                                   data_code,
                                   sizeof(data_code),
                                   data_bytes,
-                                  sizeof(prefix)+data_length*2);
+                                  data_string_set(data, data_length));
    /** @snippet [NFC text usage_1] */
   error_code = nfc_ndef_msg_record_add(nfc_msg, &NFC_NDEF_TEXT_RECORD_DESC(data_text_rec));
   APP_ERROR_CHECK(error_code);
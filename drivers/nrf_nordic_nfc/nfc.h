@@ -8,6 +8,7 @@
 #include "sdk_errors.h"
 
 #define MAX_REC_COUNT      4     /**< Maximum records count. */
+#define NFC_DATA_MAX_LENGTH 32   /**< Maximum length of binary data in data record, printed as 64 hex characters. */
 
 /**
  * Initializes NFC with ID , address and data message.
@@ -19,6 +20,20 @@
  */
 ret_code_t nfc_init(uint8_t* data, uint32_t data_length);
 
+/**
+ * Update data record of NFC payload without reinitializing NFC.
+ *
+ * ID, address and version records are encoded once in nfc_init, this function only
+ * encodes the data record into a spare payload buffer and swaps buffers while
+ * field is off. Unchanged data is not written, unless field has been lost since last
+ * update. Call outside of interrupt context.
+ *
+ * @return NRF_SUCCESS if payload was updated or data was unchanged
+ * @return NRF_ERROR_INVALID_STATE if NFC is not initialized or field is on. Call again after field is lost.
+ * @return NRF_ERROR_INVALID_LENGTH if data_length is over NFC_DATA_MAX_LENGTH
+ */
+ret_code_t nfc_data_set(const uint8_t* data, uint32_t data_length);
+
 /**
  * @brief Function for encoding the NFC message.
  */
@@ -0,0 +1,58 @@
+#include "temperature.h"
+
+#include "nrf_error.h"
+#include "nrf_soc.h"
+
+/** Charge of one conversion, about 1 mA for 36 us, product specification TEMP */
+#define TEMPERATURE_CONVERSION_PC 36000
+
+static ret_code_t init(void)
+{
+  return NRF_SUCCESS;
+}
+
+static void configure(const ruuvi_sensor_configuration_t* p_configuration, ruuvi_sensor_configuration_t* p_result)
+{
+  // Sampled on read only
+  p_result->sample_rate       = ENDPOINT_NOT_SUPPORTED;
+  p_result->transmission_rate = ENDPOINT_NOT_SUPPORTED;
+  p_result->resolution        = ENDPOINT_NOT_SUPPORTED;
+  p_result->scale             = ENDPOINT_NOT_SUPPORTED;
+}
+
+static uint32_t start(uint8_t channels)
+{
+  return 0;
+}
+
+static ret_code_t read(ruuvi_sensor_t* p_data, sensor_complete_t complete)
+{
+  int32_t temperature;
+  ret_code_t err_code = sd_temp_get(&temperature);
+  if(NRF_SUCCESS != err_code) { return err_code; }
+  // SD returns temp * 4. Ruuvi format expects temp * 100. 4*25 = 100.
+  p_data->temperature = temperature * 25;
+  complete(NRF_SUCCESS);
+  return NRF_SUCCESS;
+}
+
+static uint8_t capabilities(void)
+{
+  return SENSOR_CAPABILITY_TEMPERATURE;
+}
+
+static uint32_t current_na(uint32_t interval_ms)
+{
+  // pC per ms is nA
+  return interval_ms ? TEMPERATURE_CONVERSION_PC / interval_ms : 0;
+}
+
+const sensor_t temperature_sensor = {
+  .name         = "TEMPERATURE",
+  .init         = init,
+  .configure    = configure,
+  .start        = start,
+  .read         = read,
+  .capabilities = capabilities,
+  .current_na   = current_na
+};
@@ -0,0 +1,16 @@
+#ifndef TEMPERATURE_H
+#define TEMPERATURE_H
+
+/**
+ *  On-chip temperature of nRF52 as sensor_t of sensor.h, read through softdevice.
+ *  Register after BME280 as fallback, it is left out when BME280 provides temperature.
+ *  Resolution is 0.25 C, read is synchronous and completes before it returns.
+ *
+ *  License: BSD-3
+ */
+
+#include "sensor.h"
+
+extern const sensor_t temperature_sensor;
+
+#endif
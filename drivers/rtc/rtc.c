@@ -2,66 +2,116 @@
 
 #include <stdint.h>
 
-#include "nrf_drv_rtc.h"
-#include "nrf_drv_clock.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "init.h"
 
 #define NRF_LOG_MODULE_NAME "RTC"
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 
-#ifndef APP_RTC_INSTANCE
-#define APP_RTC_INSTANCE 2
+#define RTC_COUNTER_BITS      24
+#define RTC_COUNTER_MASK      ((1UL << RTC_COUNTER_BITS) - 1)
+#define RTC_TICKS_PER_SECOND  (APP_TIMER_CLOCK_FREQ / (RUUVITAG_APP_TIMER_PRESCALER + 1))
+#define RTC_KEEPALIVE_TICKS   (3600UL * RTC_TICKS_PER_SECOND)  // Once per hour, well within counter period
+
+// Milliseconds of full counter periods are exact only if tick rate is a power of two
+#if (RUUVITAG_APP_TIMER_PRESCALER + 1) & RUUVITAG_APP_TIMER_PRESCALER
+  #error "RUUVITAG_APP_TIMER_PRESCALER + 1 must be a power of two"
 #endif
+#define RTC_PERIOD_MS         ((1UL << RTC_COUNTER_BITS) / RTC_TICKS_PER_SECOND * 1000)
+
+APP_TIMER_DEF(rtc_keepalive_timer_id);
 
-const nrf_drv_rtc_t rtc = NRF_DRV_RTC_INSTANCE(APP_RTC_INSTANCE); /**< Declaring an instance of nrf_drv_rtc for RTC2. */
+static uint32_t overflows = 0;    // Counter periods since start
+static uint32_t last_counter = 0; // Counter at previous read
 
-static uint64_t overflows = 0;
+/** Read counter and count periods. Returns counter, number of periods to p_overflows. */
+static uint32_t counter_update(uint32_t* p_overflows)
+{
+  uint32_t counter;
+  CRITICAL_REGION_ENTER();
+  app_timer_cnt_get(&counter);
+  counter &= RTC_COUNTER_MASK;
+  if(counter < last_counter) { overflows++; }
+  last_counter = counter;
+  *p_overflows = overflows;
+  CRITICAL_REGION_EXIT();
+  return counter;
+}
 
-static void rtc_handler(nrf_drv_rtc_int_type_t int_type)
+static void rtc_keepalive_handler(void* p_context)
 {
-    if (int_type == NRF_DRV_RTC_INT_COMPARE0)
-    {
-      NRF_LOG_DEBUG("Compare event\r\n");
-    }
-    else if (int_type == NRF_DRV_RTC_INT_TICK)
-    {
-      NRF_LOG_DEBUG("Tick\r\n");
-    }
-    else if (int_type == NRF_DRV_RTC_INT_OVERFLOW)
-    {
-      overflows++;
-    }
+  uint32_t periods;
+  counter_update(&periods);
 }
 
 uint32_t init_rtc(void)
 {
-  uint32_t err_code;
+  uint32_t err_code = NRF_SUCCESS;
+  overflows = 0;
+  app_timer_cnt_get(&last_counter);
+  last_counter &= RTC_COUNTER_MASK;
+
+  // Repeated timer keeps app_timer from stopping and clearing RTC1 when no other timer is running
+  err_code |= app_timer_create(&rtc_keepalive_timer_id, APP_TIMER_MODE_REPEATED, rtc_keepalive_handler);
+  err_code |= app_timer_start(rtc_keepalive_timer_id, RTC_KEEPALIVE_TICKS, NULL);
+  return err_code;
+}
 
-  //Initialize RTC instance
-  nrf_drv_rtc_config_t config = NRF_DRV_RTC_DEFAULT_CONFIG;
-  config.prescaler = 32;
-  err_code = nrf_drv_rtc_init(&rtc, &config, rtc_handler);
-  APP_ERROR_CHECK(err_code);
+uint32_t rtc_ticks_get(void)
+{
+  uint32_t periods;
+  uint32_t counter = counter_update(&periods);
+  return (periods << RTC_COUNTER_BITS) | counter;
+}
 
-  //Enable tick event & interrupt - consumes horrendous amount of power on quick ticks
-  //nrf_drv_rtc_tick_enable(&rtc,true);
+uint64_t rtc_ticks64_get(void)
+{
+  uint32_t periods;
+  uint32_t counter = counter_update(&periods);
+  return ((uint64_t)periods << RTC_COUNTER_BITS) | counter;
+}
 
-  //Set compare channel to trigger interrupt after COMPARE_COUNTERTIME seconds
-  //err_code = nrf_drv_rtc_cc_set(&rtc,0, COMPARE_COUNTERTIME * 8,true);
-  //APP_ERROR_CHECK(err_code);
+uint32_t rtc_ticks_per_second(void)
+{
+  return RTC_TICKS_PER_SECOND;
+}
 
-  //Power on RTC instance
-  nrf_drv_rtc_enable(&rtc);
-  
-  return err_code;
+uint32_t rtc_ms_to_ticks(uint32_t ms)
+{
+  return (ms / 1000) * RTC_TICKS_PER_SECOND + ((ms % 1000) * RTC_TICKS_PER_SECOND + 999) / 1000;
+}
+
+uint32_t millis(void)
+{
+  uint32_t periods;
+  uint32_t counter = counter_update(&periods);
+  // Split counter to avoid 32-bit overflow of counter * 1000
+  return periods * RTC_PERIOD_MS
+         + (counter / RTC_TICKS_PER_SECOND) * 1000
+         + ((counter % RTC_TICKS_PER_SECOND) * 1000) / RTC_TICKS_PER_SECOND;
+}
+
+rtc_deadline_t rtc_deadline_ms(uint32_t ms)
+{
+  return rtc_ticks_get() + rtc_ms_to_ticks(ms);
+}
+
+bool rtc_deadline_passed(rtc_deadline_t deadline)
+{
+  return (int32_t)(rtc_ticks_get() - deadline) >= 0;
+}
+
+uint32_t rtc_deadline_remaining(rtc_deadline_t deadline)
+{
+  int32_t remaining = (int32_t)(deadline - rtc_ticks_get());
+  return (remaining > 0) ? remaining : 0;
 }
 
-uint64_t millis(void)
+uint32_t rtc_deadline_timer_start(app_timer_id_t timer_id, rtc_deadline_t deadline, void* p_context)
 {
-  uint64_t ms = nrf_drv_rtc_counter_get(&rtc);
-  ms += overflows<<24;
-  //Compensate tick roundoff
-  ms*=32000;
-  ms/=32768;
-  return ms;
+  uint32_t ticks = rtc_deadline_remaining(deadline);
+  if(APP_TIMER_MIN_TIMEOUT_TICKS > ticks) { ticks = APP_TIMER_MIN_TIMEOUT_TICKS; }
+  return app_timer_start(timer_id, ticks, p_context);
 }
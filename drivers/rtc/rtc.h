@@ -1,10 +1,72 @@
 #ifndef RTC_H
 #define RTC_H
 
+/**
+ *  Timebase of the application, shared with app_timer.
+ *
+ *  Time is read from the RTC1 counter which app_timer already runs, no other RTC
+ *  is needed. The 24-bit counter is extended in software to 32 bits on every read,
+ *  a 64-bit count is computed only when asked for. A repeated app_timer keeps RTC1
+ *  running and guarantees a read within every counter period (8192 s at 2048 Hz).
+ *
+ *  32-bit tick count wraps after 24 days at 2048 Hz, millis() after 49 days.
+ *  Compare times by unsigned difference or with deadlines, never by magnitude.
+ *
+ *  Deadlines are absolute tick counts. They can be polled with rtc_deadline_passed()
+ *  or handed to app_timer with rtc_deadline_timer_start(), so polled checks and
+ *  timer callbacks agree on when a deadline is.
+ */
+
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "app_timer.h"
+
+/** Absolute time in ticks */
+typedef uint32_t rtc_deadline_t;
+
+/**
+ *  Start timebase. app_timer must be initialized first, init_ble() does it.
+ *
+ *  @return 0 on success, error code from app_timer otherwise
+ */
 uint32_t init_rtc(void);
 
-uint64_t millis(void);
+/** Return ticks since RTC1 was started, 32 bits. */
+uint32_t rtc_ticks_get(void);
+
+/** Return ticks since RTC1 was started, 64 bits. More expensive, use for timestamps which must not wrap. */
+uint64_t rtc_ticks64_get(void);
+
+/** Return frequency of ticks */
+uint32_t rtc_ticks_per_second(void);
+
+/** Convert milliseconds to ticks, rounded up. */
+uint32_t rtc_ms_to_ticks(uint32_t ms);
+
+/** Return milliseconds since RTC1 was started, wraps at 32 bits. */
+uint32_t millis(void);
+
+/** Return deadline given milliseconds from now */
+rtc_deadline_t rtc_deadline_ms(uint32_t ms);
+
+/** Return true if deadline is now or in the past. Deadline must be less than 12 days away. */
+bool rtc_deadline_passed(rtc_deadline_t deadline);
+
+/** Return ticks until deadline, 0 if deadline has passed */
+uint32_t rtc_deadline_remaining(rtc_deadline_t deadline);
+
+/**
+ *  Start single shot app_timer which expires at deadline, or as soon as app_timer
+ *  allows if deadline has passed. Deadline must be within range of app_timer,
+ *  half of counter period, i.e. 68 minutes at 2048 Hz.
+ *
+ *  @param timer_id single shot timer created with app_timer_create
+ *  @param deadline time of expiry
+ *  @param p_context passed to timeout handler
+ *
+ *  @return error code from app_timer_start
+ */
+uint32_t rtc_deadline_timer_start(app_timer_id_t timer_id, rtc_deadline_t deadline, void* p_context);
 
 #endif
@@ -0,0 +1,155 @@
+#include "sensor.h"
+
+#include <stddef.h>
+#include "nrf_error.h"
+#include "spi_transaction.h"
+#include "trace.h"
+
+#define NRF_LOG_MODULE_NAME "SENSOR"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+static const sensor_t*      sensors[SENSOR_MAX_COUNT];
+static bool                 active[SENSOR_MAX_COUNT];
+static uint8_t              sensor_count = 0;
+
+static ruuvi_sensor_t*      sweep_data = NULL;
+static sensor_sweep_handler_t sweep_handler = NULL;
+static uint8_t              sweep_outstanding = 0;
+
+ret_code_t sensor_register(const sensor_t* p_sensor)
+{
+  if(NULL == p_sensor) { return NRF_ERROR_NULL; }
+  if(SENSOR_MAX_COUNT <= sensor_count) { return NRF_ERROR_NO_MEM; }
+  active[sensor_count] = false;
+  sensors[sensor_count++] = p_sensor;
+  return NRF_SUCCESS;
+}
+
+uint8_t sensor_init_all(void)
+{
+  uint8_t provided = 0;
+  for(uint8_t ii = 0; ii < sensor_count; ii++)
+  {
+    uint8_t capabilities = sensors[ii]->capabilities();
+    if(0 == (capabilities & ~provided))
+    {
+      TRACE_INFO("Sensor %s not needed\r\n", sensors[ii]->name);
+      continue;
+    }
+    ret_code_t err_code = sensors[ii]->init();
+    active[ii] = (NRF_SUCCESS == err_code);
+    if(active[ii]) { provided |= capabilities; }
+    else { TRACE_WARNING("Sensor %s init failed: %d\r\n", sensors[ii]->name, err_code); }
+  }
+  return provided;
+}
+
+uint8_t sensor_resume_all(uint8_t active_mask)
+{
+  uint8_t provided = 0;
+  for(uint8_t ii = 0; ii < sensor_count; ii++)
+  {
+    if(0 == (active_mask & (1 << ii))) { continue; }
+    ret_code_t err_code = (NULL != sensors[ii]->resume) ? sensors[ii]->resume() : sensors[ii]->init();
+    if(NRF_SUCCESS != err_code && NULL != sensors[ii]->resume)
+    {
+      TRACE_WARNING("Sensor %s resume failed: %d\r\n", sensors[ii]->name, err_code);
+      err_code = sensors[ii]->init();
+    }
+    active[ii] = (NRF_SUCCESS == err_code);
+    if(active[ii]) { provided |= sensors[ii]->capabilities(); }
+    else { TRACE_WARNING("Sensor %s init failed: %d\r\n", sensors[ii]->name, err_code); }
+  }
+  return provided;
+}
+
+uint8_t sensor_active_mask(void)
+{
+  uint8_t mask = 0;
+  for(uint8_t ii = 0; ii < sensor_count; ii++)
+  {
+    if(active[ii]) { mask |= (1 << ii); }
+  }
+  return mask;
+}
+
+bool sensor_is_active(const sensor_t* p_sensor)
+{
+  for(uint8_t ii = 0; ii < sensor_count; ii++)
+  {
+    if(p_sensor == sensors[ii]) { return active[ii]; }
+  }
+  return false;
+}
+
+/** Return true if sensor is active and provides any of channels */
+static bool selected(uint8_t index, uint8_t channels)
+{
+  return active[index] && (sensors[index]->capabilities() & channels);
+}
+
+uint32_t sensor_start_all(uint8_t channels)
+{
+  uint32_t ready_us = 0;
+  for(uint8_t ii = 0; ii < sensor_count; ii++)
+  {
+    if(!selected(ii, channels)) { continue; }
+    uint32_t sensor_us = sensors[ii]->start(channels);
+    if(sensor_us > ready_us) { ready_us = sensor_us; }
+  }
+  return ready_us;
+}
+
+/** Completion of one read, last one reports the sweep */
+static void read_complete(ret_code_t result)
+{
+  if(NRF_SUCCESS != result) { TRACE_WARNING("Sensor read failed: %d\r\n", result); }
+  if(0 == sweep_outstanding || 0 != --sweep_outstanding) { return; }
+
+  sensor_sweep_handler_t handler = sweep_handler;
+  sweep_handler = NULL;
+  handler(sweep_data);
+}
+
+ret_code_t sensor_sweep(ruuvi_sensor_t* p_data, uint8_t channels, sensor_sweep_handler_t handler)
+{
+  if(NULL == p_data || NULL == handler) { return NRF_ERROR_NULL; }
+  if(NULL != sweep_handler) { return NRF_ERROR_BUSY; }
+  sweep_data = p_data;
+  sweep_handler = handler;
+  // Guard count keeps synchronous completions from ending sweep before all reads are started
+  sweep_outstanding = 1;
+
+  spi_transaction_hold();
+  for(uint8_t ii = 0; ii < sensor_count; ii++)
+  {
+    if(!selected(ii, channels)) { continue; }
+    sweep_outstanding++;
+    ret_code_t err_code = sensors[ii]->read(p_data, read_complete);
+    if(NRF_SUCCESS != err_code)
+    {
+      TRACE_WARNING("Sensor %s read not started: %d\r\n", sensors[ii]->name, err_code);
+      sweep_outstanding--;
+    }
+  }
+  spi_transaction_release();
+
+  read_complete(NRF_SUCCESS);
+  return NRF_SUCCESS;
+}
+
+bool sensor_sweep_busy(void)
+{
+  return NULL != sweep_handler;
+}
+
+uint32_t sensor_current_na(uint32_t interval_ms)
+{
+  uint32_t current_na = 0;
+  for(uint8_t ii = 0; ii < sensor_count; ii++)
+  {
+    if(active[ii]) { current_na += sensors[ii]->current_na(interval_ms); }
+  }
+  return current_na;
+}
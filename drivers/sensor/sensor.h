@@ -0,0 +1,174 @@
+#ifndef SENSOR_H
+#define SENSOR_H
+
+/**
+ *  Common interface of sensor drivers.
+ *
+ *  Each driver exports one sensor_t which adapts it to the interface. Application
+ *  registers the sensors it uses in order of preference, sensor_init_all() then
+ *  initialises them and leaves out sensors whose channels are already provided, e.g.
+ *  on-chip temperature when BME280 is present.
+ *
+ *  Reads are asynchronous: read() starts the transfer and returns, the driver calls
+ *  completion handler in main context once data is in ruuvi_sensor_t. Drivers on SPI
+ *  queue transactions of spi_transaction.h, sensor_sweep() holds the queue while it
+ *  fans out the reads so that transfers of all sensors run as one chained sequence
+ *  and the sweep is reported with one wake-up.
+ *
+ *  License: BSD-3
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ruuvi_endpoints.h"
+#include "sdk_errors.h"
+#include "sensortag.h"
+
+/** Sensors which can be registered */
+#ifndef SENSOR_MAX_COUNT
+  #define SENSOR_MAX_COUNT 4
+#endif
+
+/** Bits of capabilities(), channels of ruuvi_sensor_t the sensor fills */
+#define SENSOR_CAPABILITY_TEMPERATURE  (1<<0)
+#define SENSOR_CAPABILITY_HUMIDITY     (1<<1)
+#define SENSOR_CAPABILITY_PRESSURE     (1<<2)
+#define SENSOR_CAPABILITY_ACCELERATION (1<<3)
+
+/** Called in main context when read has stored its channels or failed */
+typedef void(*sensor_complete_t)(ret_code_t result);
+
+/** Called in main context when all reads of sensor_sweep() are complete */
+typedef void(*sensor_sweep_handler_t)(ruuvi_sensor_t* p_data);
+
+/** Length of option lists of sensor_options_t, payload of one response message */
+#define SENSOR_OPTIONS_LENGTH 8
+
+/**
+ *  Settings sensor supports, answered to CAPABILITY_QUERY. Lists are ascending and end
+ *  at first 0 unless full, an empty list means that the setting is fixed.
+ */
+typedef struct {
+  uint8_t sample_rates[SENSOR_OPTIONS_LENGTH];  /**< Hz, SAMPLE_RATE_SINGLE last if sensor samples on demand */
+  uint8_t resolutions[SENSOR_OPTIONS_LENGTH];   /**< Bits */
+  uint8_t scales[SENSOR_OPTIONS_LENGTH];        /**< Full scale in unit of the channel, e.g. g */
+}sensor_options_t;
+
+/** Proposed configuration rounded to settings of sensor, and its estimated cost */
+typedef struct {
+  uint16_t rate_hz;        /**< Samples per second, 1 for SAMPLE_RATE_SINGLE, 0 when stopped */
+  uint8_t  resolution;     /**< Bits */
+  uint8_t  scale;          /**< Full scale, 0 if fixed */
+  uint32_t current_na;     /**< Average supply current of sensor */
+}sensor_estimate_t;
+
+typedef struct {
+  const char* name;
+
+  /** Bring up sensor and driver, NRF_SUCCESS if sensor responded */
+  ret_code_t (*init)(void);
+
+  /**
+   *  Apply sample rate, transmission rate, resolution and scale of configuration,
+   *  fields of ruuvi_sensor_configuration_t. Result of each field is stored to the same
+   *  field of p_result as ruuvi_endpoint_ret_t. DSP and target are handled by caller.
+   */
+  void (*configure)(const ruuvi_sensor_configuration_t* p_configuration, ruuvi_sensor_configuration_t* p_result);
+
+  /**
+   *  Start measurement of SENSOR_CAPABILITY_* channels if sensor samples on demand,
+   *  return microseconds until data is ready. Sensor may measure more channels than asked.
+   */
+  uint32_t (*start)(uint8_t channels);
+
+  /**
+   *  Start reading latest sample into channels of p_data. Returns error without calling
+   *  complete if read could not be started, else complete is called exactly once,
+   *  possibly before read returns.
+   */
+  ret_code_t (*read)(ruuvi_sensor_t* p_data, sensor_complete_t complete);
+
+  /** Return SENSOR_CAPABILITY_* bits */
+  uint8_t (*capabilities)(void);
+
+  /** Return estimated average current in nA with current settings, sampled every interval_ms */
+  uint32_t (*current_na)(uint32_t interval_ms);
+
+  /**
+   *  Optional, NULL if sensor has no DSP of its own. Apply ruuvi_dsp_function_t with
+   *  parameter, return ruuvi_endpoint_ret_t. Called after configure().
+   */
+  ret_code_t (*dsp)(uint8_t function, uint8_t parameter);
+
+  /**
+   *  Optional, NULL if init() is cheap. Bring up sensor which was active before a warm
+   *  reset without probing it, NRF_SUCCESS if driver is ready. State the driver needs,
+   *  e.g. calibration, is restored by application before.
+   */
+  ret_code_t (*resume)(void);
+
+  /** Optional, NULL if sensor does not answer CAPABILITY_QUERY. Supported settings. */
+  const sensor_options_t* p_options;
+
+  /**
+   *  Optional, NULL if sensor does not answer CAPABILITY_QUERY. Round sample rate,
+   *  resolution and scale of proposed configuration as configure() would, *_NO_CHANGE
+   *  meaning current setting, and estimate average current with them. Sensor is not
+   *  touched. Returns ruuvi_endpoint_ret_t, ENDPOINT_NOT_SUPPORTED if a setting cannot
+   *  be applied.
+   */
+  ret_code_t (*estimate)(const ruuvi_sensor_configuration_t* p_proposed, sensor_estimate_t* p_estimate);
+}sensor_t;
+
+/**
+ *  Add sensor to registry. Sensors are initialised and read in registration order.
+ *
+ *  @return NRF_SUCCESS, NRF_ERROR_NULL or NRF_ERROR_NO_MEM if registry is full
+ */
+ret_code_t sensor_register(const sensor_t* p_sensor);
+
+/**
+ *  Initialise registered sensors. Sensor is skipped if active sensors already provide
+ *  all of its channels. Returns SENSOR_CAPABILITY_* bits of active sensors.
+ */
+uint8_t sensor_init_all(void);
+
+/**
+ *  Bring up sensors after a warm reset. Bit n of active_mask is set if sensor registered
+ *  n:th was active on previous boot, see sensor_active_mask(). Sensors are resumed with
+ *  resume(), or init() if they have none, and initialised if resume fails. Others are
+ *  left out without probing. Returns SENSOR_CAPABILITY_* bits of active sensors.
+ */
+uint8_t sensor_resume_all(uint8_t active_mask);
+
+/** Return mask of active sensors by registration index, to be kept over a warm reset */
+uint8_t sensor_active_mask(void);
+
+/** Return true if sensor was initialised successfully */
+bool sensor_is_active(const sensor_t* p_sensor);
+
+/**
+ *  Start measurement of active sensors providing any of SENSOR_CAPABILITY_* channels,
+ *  return microseconds until all have data ready
+ */
+uint32_t sensor_start_all(uint8_t channels);
+
+/**
+ *  Read active sensors providing any of SENSOR_CAPABILITY_* channels into p_data.
+ *  Channels which were not read keep the values caller stored, e.g. invalid values of
+ *  sensortag.h. Handler is called once in main context after all reads are complete.
+ *
+ *  @return NRF_SUCCESS if sweep was started
+ *  @return NRF_ERROR_NULL if data or handler is NULL
+ *  @return NRF_ERROR_BUSY if previous sweep is still running
+ */
+ret_code_t sensor_sweep(ruuvi_sensor_t* p_data, uint8_t channels, sensor_sweep_handler_t handler);
+
+/** Return true if sweep is running */
+bool sensor_sweep_busy(void);
+
+/** Return estimated total current in nA of active sensors sampled every interval_ms */
+uint32_t sensor_current_na(uint32_t interval_ms);
+
+#endif
@@ -0,0 +1,175 @@
+#include "sensor_endpoint.h"
+
+#include <string.h>
+
+#define NRF_LOG_MODULE_NAME "SENSOR_ENDPOINT"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+ret_code_t sensor_endpoint_set_target(message_handler_state_t* p_state, uint8_t target)
+{
+  NRF_LOG_DEBUG("Setting targets %d\r\n", target);
+  if(TRANSMISSION_TARGET_NO_CHANGE == target) { return ENDPOINT_SUCCESS; }
+
+  //NULL handlers
+  p_state->p_ble_adv_handler = NULL;
+  p_state->p_ble_gatt_handler = NULL;
+  p_state->p_ble_mesh_handler = NULL;
+  p_state->p_proprietary_handler = NULL;
+  p_state->p_nfc_handler = NULL;
+  p_state->p_ram_handler = NULL;
+  p_state->p_flash_handler = NULL;
+  p_state->configuration.target = target;
+
+  if(TRANSMISSION_TARGET_STOP == target) { return ENDPOINT_SUCCESS; }
+
+  //Resetup handlers
+  if(TRANSMISSION_TARGET_BLE_GATT & target){ p_state->p_ble_gatt_handler = get_ble_gatt_handler(); }
+  if(TRANSMISSION_TARGET_BLE_ADV & target){ p_state->p_ble_adv_handler = get_ble_adv_handler(); }
+  if(TRANSMISSION_TARGET_BLE_MESH & target){ p_state->p_ble_mesh_handler = get_ble_mesh_handler(); }
+  if(TRANSMISSION_TARGET_PROPRIETARY & target){ p_state->p_proprietary_handler = get_proprietary_handler(); }
+  if(TRANSMISSION_TARGET_NFC & target){ p_state->p_nfc_handler = get_nfc_handler(); }
+  if(TRANSMISSION_TARGET_RAM == target){ p_state->p_ram_handler = get_ram_handler(); }
+  if(TRANSMISSION_TARGET_FLASH == target){ p_state->p_flash_handler = get_flash_handler(); }
+
+  return ENDPOINT_SUCCESS;
+}
+
+ret_code_t sensor_endpoint_transmit(const message_handler_state_t* p_state, const ruuvi_standard_message_t message)
+{
+  ret_code_t err_code = ENDPOINT_SUCCESS;
+  NRF_LOG_DEBUG("Transmitting to all data points\r\n");
+  if(p_state->p_ble_adv_handler)     { err_code |= p_state->p_ble_adv_handler(message); }
+  if(p_state->p_ble_gatt_handler)    { err_code |= p_state->p_ble_gatt_handler(message); }
+  if(p_state->p_proprietary_handler) { err_code |= p_state->p_proprietary_handler(message); }
+  if(p_state->p_nfc_handler)         { err_code |= p_state->p_nfc_handler(message); }
+  if(p_state->p_ram_handler)         { err_code |= p_state->p_ram_handler(message); }
+  if(p_state->p_flash_handler)       { err_code |= p_state->p_flash_handler(message); }
+  if(p_state->p_chain_handler)
+  {
+    ruuvi_standard_message_t chainmsg;
+    memcpy(&chainmsg, &message, sizeof(ruuvi_standard_message_t));
+    //Send message upstream to chain
+    chainmsg.destination_endpoint = p_state->downstream_endpoint;
+    NRF_LOG_DEBUG("Chaining to %d\r\n", chainmsg.destination_endpoint);
+    err_code |= p_state->p_chain_handler(chainmsg);
+  }
+  return err_code;
+}
+
+/** Sensor DSP handles the function if sensor has one, else only latest value is supported */
+static ret_code_t set_dsp_function(const sensor_t* p_sensor, message_handler_state_t* p_state,
+                                   uint8_t dsp_function, uint8_t dsp_parameter)
+{
+  ret_code_t result = ENDPOINT_NOT_IMPLEMENTED; //TODO
+  if(p_sensor->dsp) { result = p_sensor->dsp(dsp_function, dsp_parameter); }
+  else if(DSP_LAST == dsp_function) { result = ENDPOINT_SUCCESS; }
+  if(ENDPOINT_SUCCESS == result) { p_state->configuration.dsp_function = dsp_function; }
+  return result;
+}
+
+static ret_code_t set_dsp_parameter(message_handler_state_t* p_state, uint8_t dsp_parameter)
+{
+  p_state->configuration.dsp_parameter = 1;
+  return ENDPOINT_NOT_IMPLEMENTED; //TODO
+}
+
+/** Store field of request if sensor accepted it and it was a change */
+static void store_accepted(uint8_t* p_stored, uint8_t requested, uint8_t result, uint8_t no_change)
+{
+  if(ENDPOINT_SUCCESS == result && no_change != requested) { *p_stored = requested; }
+}
+
+ret_code_t sensor_endpoint_configure(const sensor_t* p_sensor, message_handler_state_t* p_state,
+                                     const ruuvi_standard_message_t message)
+{
+  NRF_LOG_DEBUG("Configuring sensor %s:", (uint32_t)p_sensor->name);
+  NRF_LOG_HEXDUMP_DEBUG((uint8_t*)&(message.destination_endpoint), sizeof(message));
+  NRF_LOG_DEBUG("\r\n");
+
+  //Return codes are truncated to 8 bits.
+  ruuvi_sensor_configuration_t result = {0};
+  ruuvi_sensor_configuration_t payload;
+  memcpy(&payload, message.payload, sizeof(payload));
+
+  p_sensor->configure(&payload, &result);
+  store_accepted(&p_state->configuration.sample_rate, payload.sample_rate, result.sample_rate, SAMPLE_RATE_NO_CHANGE);
+  store_accepted(&p_state->configuration.transmission_rate, payload.transmission_rate, result.transmission_rate,
+                 TRANSMISSION_RATE_NO_CHANGE);
+  store_accepted(&p_state->configuration.resolution, payload.resolution, result.resolution, RESOLUTION_NO_CHANGE);
+  store_accepted(&p_state->configuration.scale, payload.scale, result.scale, SCALE_NO_CHANGE);
+  result.dsp_function  = set_dsp_function(p_sensor, p_state, payload.dsp_function, payload.dsp_parameter);
+  if(p_sensor->dsp)
+  {
+    // Parameter belongs to the function
+    result.dsp_parameter = result.dsp_function;
+    if(ENDPOINT_SUCCESS == result.dsp_function) { p_state->configuration.dsp_parameter = payload.dsp_parameter; }
+  }
+  else { result.dsp_parameter = set_dsp_parameter(p_state, payload.dsp_parameter); }
+  result.target        = sensor_endpoint_set_target(p_state, payload.target);
+
+  NRF_LOG_DEBUG("Configuration result:");
+  NRF_LOG_HEXDUMP_DEBUG((uint8_t*)&(result.sample_rate), sizeof(result));
+  NRF_LOG_DEBUG("\r\n");
+
+  //Store endpoint request came from, even if message will not be processed due to error (TODO?)
+  p_state->destination_endpoint = message.source_endpoint;
+
+  ruuvi_standard_message_t reply = { .destination_endpoint = message.source_endpoint,
+                                     .source_endpoint      = message.destination_endpoint,
+                                     .type                 = ACKNOWLEDGEMENT,
+                                     .payload              = { 0 }};
+  memcpy(reply.payload, &result, sizeof(result));
+  //Return error if cannot reply
+  ret_code_t err_code = ENDPOINT_HANDLER_ERROR;
+  message_handler p_reply_handler = get_reply_handler();
+  if(p_reply_handler)
+  {
+    NRF_LOG_DEBUG("Sending reply from configuration\r\n");
+    err_code = p_reply_handler(reply);
+  }
+  return err_code; //Error codes from configuration are in payload of reply
+}
+
+/** Send reply of type with payload to reply handler */
+static ret_code_t reply_payload(const ruuvi_standard_message_t message, uint8_t type, const uint8_t* p_payload)
+{
+  ruuvi_standard_message_t reply = { .destination_endpoint = message.source_endpoint,
+                                     .source_endpoint      = message.destination_endpoint,
+                                     .type                 = type,
+                                     .payload              = { 0 }};
+  memcpy(reply.payload, p_payload, sizeof(reply.payload));
+  message_handler p_reply_handler = get_reply_handler();
+  if(NULL == p_reply_handler) { return ENDPOINT_HANDLER_ERROR; }
+  return p_reply_handler(reply);
+}
+
+ret_code_t sensor_endpoint_capability(const sensor_t* p_sensor, const ruuvi_standard_message_t message)
+{
+  if(NULL == p_sensor->estimate || NULL == p_sensor->p_options) { return unknown_handler(message); }
+
+  ruuvi_sensor_configuration_t proposed;
+  memcpy(&proposed, message.payload, sizeof(proposed));
+  sensor_estimate_t estimate = {0};
+  ret_code_t result = p_sensor->estimate(&proposed, &estimate);
+  NRF_LOG_DEBUG("Estimate of %s: %d Hz, %d nA, result %d\r\n", (uint32_t)p_sensor->name, estimate.rate_hz,
+                estimate.current_na, result);
+
+  ret_code_t err_code = ENDPOINT_SUCCESS;
+  err_code |= reply_payload(message, SAMPLERATE_RESPONSE, p_sensor->p_options->sample_rates);
+  err_code |= reply_payload(message, RESOLUTION_RESPONSE, p_sensor->p_options->resolutions);
+  err_code |= reply_payload(message, SCALE_RESPONSE, p_sensor->p_options->scales);
+
+  uint8_t payload[sizeof(message.payload)] = {0};
+  if(ENDPOINT_SUCCESS != result)
+  {
+    payload[0] = result;
+    return err_code | reply_payload(message, ERROR, payload);
+  }
+  payload[0] = estimate.rate_hz & 0xFF;
+  payload[1] = estimate.rate_hz >> 8;
+  payload[2] = estimate.resolution;
+  payload[3] = estimate.scale;
+  for(uint8_t ii = 0; ii < 4; ii++) { payload[4 + ii] = (estimate.current_na >> (8 * ii)) & 0xFF; }
+  return err_code | reply_payload(message, POWER_RESPONSE, payload);
+}
@@ -0,0 +1,55 @@
+#ifndef SENSOR_ENDPOINT_H
+#define SENSOR_ENDPOINT_H
+
+/**
+ *  Ruuvi endpoint functions shared by sensor handlers: targets, transmission to
+ *  targets and chain, and SENSOR_CONFIGURATION and CAPABILITY_QUERY through sensor_t
+ *  of sensor.h.
+ *  Handler keeps its message_handler_state_t and passes it in.
+ *
+ *  License: BSD-3
+ */
+
+#include "ruuvi_endpoints.h"
+#include "sensor.h"
+
+/**
+ *  Set data targets of handler to TRANSMISSION_TARGET_* bits, previous targets are
+ *  cleared. Returns ruuvi_endpoint_ret_t.
+ */
+ret_code_t sensor_endpoint_set_target(message_handler_state_t* p_state, uint8_t target);
+
+/**
+ *  Send message to all data targets of handler and to chain downstream if configured.
+ *  Returns OR'd errors of target handlers.
+ */
+ret_code_t sensor_endpoint_transmit(const message_handler_state_t* p_state, const ruuvi_standard_message_t message);
+
+/**
+ *  Configure sensor with ruuvi_sensor_configuration_t in payload of message.
+ *  Settings accepted by sensor are stored to configuration of state, result of each
+ *  field is sent as ACKNOWLEDGEMENT to reply handler.
+ *
+ *  Returns ENDPOINT_HANDLER_ERROR if reply cannot be sent, else error of reply handler.
+ */
+ret_code_t sensor_endpoint_configure(const sensor_t* p_sensor, message_handler_state_t* p_state,
+                                     const ruuvi_standard_message_t message);
+
+/**
+ *  Answer CAPABILITY_QUERY with ruuvi_sensor_configuration_t of proposed sample rate,
+ *  resolution and scale in payload, other fields are ignored. Settings are not applied.
+ *  Replies, lists as in sensor_options_t:
+ *    SAMPLERATE_RESPONSE supported sample rates
+ *    RESOLUTION_RESPONSE supported resolutions
+ *    SCALE_RESPONSE      supported scales
+ *    POWER_RESPONSE      proposal rounded as SENSOR_CONFIGURATION would apply it, little endian:
+ *                        [0..1] samples per second, [2] resolution, [3] scale,
+ *                        [4..7] estimated average current of sensor in nA
+ *  POWER_RESPONSE is replaced by ERROR with ruuvi_endpoint_ret_t in [0] if the proposal
+ *  cannot be applied. Sensor without estimate() is passed to unknown_handler().
+ *
+ *  Returns ENDPOINT_HANDLER_ERROR if reply cannot be sent, else OR'd errors of reply handler.
+ */
+ret_code_t sensor_endpoint_capability(const sensor_t* p_sensor, const ruuvi_standard_message_t message);
+
+#endif
@@ -0,0 +1,168 @@
+#include "sensor_pipeline.h"
+
+#include <stddef.h>
+#include "nrf_error.h"
+#include "trace.h"
+
+#define NRF_LOG_MODULE_NAME "SENSOR_PIPELINE"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+/** One channel for each SENSOR_CAPABILITY_* bit */
+#define SENSOR_PIPELINE_CHANNELS 4
+
+typedef struct {
+  uint32_t       interval_ms;  // 0 if disabled
+  rtc_deadline_t next;         // Deadline of next sample
+  uint32_t       stored;       // Tick of last valid value
+  bool           valid;        // Cache has a value
+}channel_t;
+
+static channel_t      channels[SENSOR_PIPELINE_CHANNELS];
+static ruuvi_sensor_t cache;
+
+static bool value_valid(const ruuvi_sensor_t* p_data, uint8_t index)
+{
+  switch(1 << index)
+  {
+    case SENSOR_CAPABILITY_TEMPERATURE:  return TEMPERATURE_INVALID != p_data->temperature;
+    case SENSOR_CAPABILITY_HUMIDITY:     return HUMIDITY_INVALID != p_data->humidity;
+    case SENSOR_CAPABILITY_PRESSURE:     return PRESSURE_INVALID != p_data->pressure;
+    case SENSOR_CAPABILITY_ACCELERATION: return ACCELERATION_INVALID != p_data->accX;
+    default:                             return false;
+  }
+}
+
+static void value_copy(ruuvi_sensor_t* p_to, const ruuvi_sensor_t* p_from, uint8_t index)
+{
+  switch(1 << index)
+  {
+    case SENSOR_CAPABILITY_TEMPERATURE:
+      p_to->temperature = p_from->temperature;
+      break;
+
+    case SENSOR_CAPABILITY_HUMIDITY:
+      p_to->humidity = p_from->humidity;
+      break;
+
+    case SENSOR_CAPABILITY_PRESSURE:
+      p_to->pressure = p_from->pressure;
+      break;
+
+    case SENSOR_CAPABILITY_ACCELERATION:
+      p_to->accX = p_from->accX;
+      p_to->accY = p_from->accY;
+      p_to->accZ = p_from->accZ;
+      break;
+
+    default:
+      break;
+  }
+}
+
+void sensor_pipeline_init(void)
+{
+  ruuvi_sensor_t invalid = { .accX = ACCELERATION_INVALID,
+                             .accY = ACCELERATION_INVALID,
+                             .accZ = ACCELERATION_INVALID,
+                             .humidity = HUMIDITY_INVALID,
+                             .pressure = PRESSURE_INVALID,
+                             .temperature = TEMPERATURE_INVALID
+                           };
+  cache = invalid;
+  for(uint8_t ii = 0; ii < SENSOR_PIPELINE_CHANNELS; ii++)
+  {
+    channels[ii].interval_ms = 0;
+    channels[ii].valid = false;
+  }
+}
+
+ret_code_t sensor_pipeline_interval_set(uint8_t channel_bits, uint32_t interval_ms)
+{
+  if(SENSOR_PIPELINE_MAX_INTERVAL_MS < interval_ms) { return NRF_ERROR_INVALID_PARAM; }
+  for(uint8_t ii = 0; ii < SENSOR_PIPELINE_CHANNELS; ii++)
+  {
+    if(!(channel_bits & (1 << ii))) { continue; }
+    channels[ii].interval_ms = interval_ms;
+    channels[ii].next = rtc_deadline_ms(0);
+  }
+  TRACE_DEBUG("Channels %x sampled every %d ms\r\n", channel_bits, interval_ms);
+  return NRF_SUCCESS;
+}
+
+uint32_t sensor_pipeline_interval_get(uint8_t channel_bits)
+{
+  for(uint8_t ii = 0; ii < SENSOR_PIPELINE_CHANNELS; ii++)
+  {
+    if(channel_bits & (1 << ii)) { return channels[ii].interval_ms; }
+  }
+  return 0;
+}
+
+uint8_t sensor_pipeline_due(void)
+{
+  uint8_t due = 0;
+  uint32_t window = rtc_ms_to_ticks(SENSOR_PIPELINE_GROUP_MS);
+  for(uint8_t ii = 0; ii < SENSOR_PIPELINE_CHANNELS; ii++)
+  {
+    if(channels[ii].interval_ms && window >= rtc_deadline_remaining(channels[ii].next)) { due |= (1 << ii); }
+  }
+  return due;
+}
+
+void sensor_pipeline_store(const ruuvi_sensor_t* p_data, uint8_t channel_bits)
+{
+  for(uint8_t ii = 0; ii < SENSOR_PIPELINE_CHANNELS; ii++)
+  {
+    channel_t* p_channel = &channels[ii];
+    if(!(channel_bits & (1 << ii)) || 0 == p_channel->interval_ms) { continue; }
+    if(value_valid(p_data, ii))
+    {
+      value_copy(&cache, p_data, ii);
+      p_channel->stored = rtc_ticks_get();
+      p_channel->valid = true;
+    }
+    else { TRACE_WARNING("Channel %x sample invalid\r\n", 1 << ii); }
+
+    // Keep cadence, start over if sample was late by more than an interval
+    p_channel->next += rtc_ms_to_ticks(p_channel->interval_ms);
+    if(rtc_deadline_passed(p_channel->next)) { p_channel->next = rtc_deadline_ms(p_channel->interval_ms); }
+  }
+}
+
+bool sensor_pipeline_next(rtc_deadline_t* p_deadline)
+{
+  bool enabled = false;
+  uint32_t earliest = UINT32_MAX;
+  for(uint8_t ii = 0; ii < SENSOR_PIPELINE_CHANNELS; ii++)
+  {
+    if(0 == channels[ii].interval_ms) { continue; }
+    uint32_t remaining = rtc_deadline_remaining(channels[ii].next);
+    if(!enabled || remaining < earliest)
+    {
+      earliest = remaining;
+      *p_deadline = channels[ii].next;
+    }
+    enabled = true;
+  }
+  return enabled;
+}
+
+void sensor_pipeline_latest(ruuvi_sensor_t* p_data)
+{
+  ruuvi_sensor_t invalid = { .accX = ACCELERATION_INVALID,
+                             .accY = ACCELERATION_INVALID,
+                             .accZ = ACCELERATION_INVALID,
+                             .humidity = HUMIDITY_INVALID,
+                             .pressure = PRESSURE_INVALID,
+                             .temperature = TEMPERATURE_INVALID
+                           };
+  uint32_t now = rtc_ticks_get();
+  for(uint8_t ii = 0; ii < SENSOR_PIPELINE_CHANNELS; ii++)
+  {
+    const channel_t* p_channel = &channels[ii];
+    uint32_t stale_ticks = rtc_ms_to_ticks(p_channel->interval_ms * SENSOR_PIPELINE_STALE_INTERVALS);
+    bool fresh = p_channel->interval_ms && p_channel->valid && (now - p_channel->stored) <= stale_ticks;
+    value_copy(p_data, fresh ? &cache : &invalid, ii);
+  }
+}
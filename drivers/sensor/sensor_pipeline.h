@@ -0,0 +1,77 @@
+#ifndef SENSOR_PIPELINE_H
+#define SENSOR_PIPELINE_H
+
+/**
+ *  Sampling schedule and latest value cache of sensor channels.
+ *
+ *  Each SENSOR_CAPABILITY_* channel has its own sampling interval, e.g. pressure once a
+ *  minute and temperature every few seconds. Application asks which channels are due,
+ *  sweeps only those with sensor_sweep() and stores the result here. Advertising and
+ *  other consumers encode from the cache at their own rate and never trigger a sample.
+ *
+ *  Deadlines of channels which fall within SENSOR_PIPELINE_GROUP_MS of each other are
+ *  taken together so that channels of one sensor share a measurement and a wake-up.
+ *  Channel whose sensor has not delivered a valid value within
+ *  SENSOR_PIPELINE_STALE_INTERVALS intervals reads as invalid.
+ *
+ *  License: BSD-3
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rtc.h"
+#include "sdk_errors.h"
+#include "sensor.h"
+#include "sensortag.h"
+
+/** Channels due within this many milliseconds are sampled together */
+#ifndef SENSOR_PIPELINE_GROUP_MS
+  #define SENSOR_PIPELINE_GROUP_MS 500u
+#endif
+
+/** Missed intervals after which cached value is reported invalid */
+#ifndef SENSOR_PIPELINE_STALE_INTERVALS
+  #define SENSOR_PIPELINE_STALE_INTERVALS 3u
+#endif
+
+/** Longest interval, next deadline must stay within range of app_timer */
+#define SENSOR_PIPELINE_MAX_INTERVAL_MS 3600000u
+
+/** Clear cache to invalid values and disable all channels */
+void sensor_pipeline_init(void);
+
+/**
+ *  Set sampling interval of SENSOR_CAPABILITY_* channels. Channel is due right away.
+ *
+ *  @param channels SENSOR_CAPABILITY_* bits
+ *  @param interval_ms time between samples, 0 disables channel
+ *
+ *  @return NRF_SUCCESS or NRF_ERROR_INVALID_PARAM if interval is too long
+ */
+ret_code_t sensor_pipeline_interval_set(uint8_t channels, uint32_t interval_ms);
+
+/** Return sampling interval of lowest channel in channels, 0 if disabled */
+uint32_t sensor_pipeline_interval_get(uint8_t channels);
+
+/** Return SENSOR_CAPABILITY_* bits of enabled channels due now or within SENSOR_PIPELINE_GROUP_MS */
+uint8_t sensor_pipeline_due(void);
+
+/**
+ *  Store valid values of channels from p_data to cache and schedule next samples of
+ *  channels. Next sample keeps the cadence of previous deadline unless that is
+ *  already in the past. Invalid values are not stored, the cache keeps last valid one.
+ */
+void sensor_pipeline_store(const ruuvi_sensor_t* p_data, uint8_t channels);
+
+/**
+ *  Get earliest deadline of enabled channels.
+ *
+ *  @return false if no channel is enabled
+ */
+bool sensor_pipeline_next(rtc_deadline_t* p_deadline);
+
+/** Copy cached channels to p_data, disabled and stale channels as invalid. Other fields are not touched. */
+void sensor_pipeline_latest(ruuvi_sensor_t* p_data);
+
+#endif
@@ -22,6 +22,7 @@ For a detailed description see the detailed description in @ref spi.h
 #include "nrf_delay.h"
 #include "app_util_platform.h"
 #include "boards.h"
+#include "trace.h"
 
 #define NRF_LOG_MODULE_NAME "SPI"
 #include "nrf_log.h"
@@ -37,12 +38,26 @@ For a detailed description see the detailed description in @ref spi.h
 /* PROTOTYPES *************************************************************************************/
 
 void spi_event_handler(nrf_drv_spi_evt_t const * p_event);
+static void spi_select(spi_device_t device, bool selected);
+static ret_code_t spi_start(const uint8_t* p_tx, uint8_t* p_rx, uint8_t length);
+static SPI_Ret spi_transfer(spi_device_t device, uint8_t* const p_toWrite, uint8_t count, uint8_t* const p_toRead);
 
 /* VARIABLES **************************************************************************************/
 static const nrf_drv_spi_t spi = NRF_DRV_SPI_INSTANCE(SPI_INSTANCE);  /**< SPI instance. */
-volatile bool spi_xfer_done; /**< Semaphore to indicate that SPI instance completed the transfer. */
 static bool initDone = false;       /**< Flag to indicate if this module is already initilized */
 
+/** Chip select pin of each device of spi_transaction.h */
+static const uint32_t chip_select_pins[SPI_DEVICE_COUNT] = {
+    [SPI_DEVICE_BME280]   = SPIM0_SS_HUMI_PIN,
+    [SPI_DEVICE_LIS2DH12] = SPIM0_SS_ACC_PIN
+};
+
+/** Bus access of transaction queue */
+static const spi_port_t port = {
+    .select = spi_select,
+    .start  = spi_start
+};
+
 /* EXTERNAL FUNCTIONS *****************************************************************************/
 
 extern void spi_init(void)
@@ -54,19 +69,17 @@ extern void spi_init(void)
     spi_config.mosi_pin = SPIM0_MOSI_PIN;
     spi_config.frequency = NRF_DRV_SPI_FREQ_8M;
 
-    /* Init chipselect for BME280 */
-    nrf_gpio_pin_dir_set(SPIM0_SS_HUMI_PIN, NRF_GPIO_PIN_DIR_OUTPUT);
-    nrf_gpio_cfg_output(SPIM0_SS_HUMI_PIN);
-    nrf_gpio_pin_set(SPIM0_SS_HUMI_PIN);
-
-    /* Init chipselect for LIS2DH12 */
-    nrf_gpio_pin_dir_set(SPIM0_SS_ACC_PIN, NRF_GPIO_PIN_DIR_OUTPUT);
-    nrf_gpio_cfg_output(SPIM0_SS_ACC_PIN);
-    nrf_gpio_pin_set(SPIM0_SS_ACC_PIN);
+    /* Init chipselects, driven per transaction by spi_select */
+    for (uint8_t ii = 0; ii < SPI_DEVICE_COUNT; ii++)
+    {
+        nrf_gpio_pin_dir_set(chip_select_pins[ii], NRF_GPIO_PIN_DIR_OUTPUT);
+        nrf_gpio_cfg_output(chip_select_pins[ii]);
+        nrf_gpio_pin_set(chip_select_pins[ii]);
+    }
 
+    spi_transaction_init(&port);
     APP_ERROR_CHECK(nrf_drv_spi_init(&spi, &spi_config, spi_event_handler));
 
-    spi_xfer_done = true;
     initDone = true;
 }
 
@@ -77,86 +90,82 @@ extern bool spi_isInitialized(void)
 }
 
 extern SPI_Ret spi_transfer_bme280(uint8_t* const p_toWrite, uint8_t count, uint8_t* const p_toRead)
-{	
-
-  NRF_LOG_DEBUG("Transferring to BME\r\n");
-
-	SPI_Ret retVal = SPI_RET_OK;
-
-	if ((NULL == p_toWrite) || (NULL == p_toRead))
-	{
-	    retVal = SPI_RET_ERROR;
-	}
-
-	
-  /* check if an other SPI transfer is running */
-  if ((true == spi_xfer_done) && (SPI_RET_OK == retVal))
-	{
-        spi_xfer_done = false;
-
-        nrf_gpio_pin_clear(SPIM0_SS_HUMI_PIN);
-        APP_ERROR_CHECK(nrf_drv_spi_transfer(&spi, p_toWrite, count, p_toRead, count));
-        //Locks if run in interrupt context
-        while (!spi_xfer_done)
-        {
-            //Requires initialized softdevice
-            uint32_t err_code = sd_app_evt_wait();
-            NRF_LOG_DEBUG("SPI status %d\r\n", err_code);
-        }
-        nrf_gpio_pin_set(SPIM0_SS_HUMI_PIN);
-        retVal = SPI_RET_OK;
-	}
-	else
-	{
-	    retVal = SPI_RET_BUSY;
-	}
-
-  return retVal;
+{
+    TRACE_DEBUG("Transferring to BME\r\n");
+    return spi_transfer(SPI_DEVICE_BME280, p_toWrite, count, p_toRead);
 }
 
 extern SPI_Ret spi_transfer_lis2dh12(uint8_t* const p_toWrite, uint8_t count, uint8_t* const p_toRead)
 {
-    SPI_Ret retVal = SPI_RET_OK;
+    return spi_transfer(SPI_DEVICE_LIS2DH12, p_toWrite, count, p_toRead);
+}
+
+
+/* INTERNAL FUNCTIONS *****************************************************************************/
+
+/**
+ * Queue transfer and wait until it is done
+ *
+ * Transaction lives on stack, it is not reported to scheduler as it has no handler.
+ */
+static SPI_Ret spi_transfer(spi_device_t device, uint8_t* const p_toWrite, uint8_t count, uint8_t* const p_toRead)
+{
     if ((NULL == p_toWrite) || (NULL == p_toRead))
     {
-        retVal = SPI_RET_ERROR;
+        return SPI_RET_ERROR;
     }
 
-    /* check if an other SPI transfer is running */
-    if ((true == spi_xfer_done) && (SPI_RET_OK == retVal))
+    spi_transaction_t transaction = { .device = device,
+                                      .p_tx = p_toWrite,
+                                      .p_rx = p_toRead,
+                                      .length = count,
+                                      .handler = NULL,
+                                      .state = SPI_TRANSACTION_IDLE };
+    ret_code_t err_code = spi_transaction_put(&transaction);
+    if (NRF_ERROR_NO_MEM == err_code)
     {
-        spi_xfer_done = false;
-
-        nrf_gpio_pin_clear(SPIM0_SS_ACC_PIN);
-        nrf_drv_spi_transfer(&spi, p_toWrite, count, p_toRead, count);
-        while (!spi_xfer_done)
-        {
-            //Requires initialized softdevice - TODO
-            sd_app_evt_wait();
-            //__WFE(); 
-        }
-        nrf_gpio_pin_set(SPIM0_SS_ACC_PIN);
-        retVal = SPI_RET_OK;
+        return SPI_RET_BUSY;
     }
-    else
+    if (NRF_SUCCESS != err_code)
     {
-        retVal = SPI_RET_BUSY;
+        return SPI_RET_ERROR;
     }
 
-    return retVal;
+    //Locks if run in interrupt context
+    while (SPI_TRANSACTION_DONE != transaction.state)
+    {
+        //Requires initialized softdevice
+        uint32_t wait_status = sd_app_evt_wait();
+        TRACE_DEBUG("SPI status %d\r\n", wait_status);
+    }
+    return (NRF_SUCCESS == transaction.result) ? SPI_RET_OK : SPI_RET_ERROR;
 }
 
+/**
+ * Drive chip select of device, active low
+ */
+static void spi_select(spi_device_t device, bool selected)
+{
+    if (selected) { nrf_gpio_pin_clear(chip_select_pins[device]); }
+    else          { nrf_gpio_pin_set(chip_select_pins[device]); }
+}
 
-/* INTERNAL FUNCTIONS *****************************************************************************/
-
+/**
+ * Start EasyDMA transfer. Buffers must be in RAM, driver returns NRF_ERROR_INVALID_ADDR otherwise.
+ */
+static ret_code_t spi_start(const uint8_t* p_tx, uint8_t* p_rx, uint8_t length)
+{
+    return nrf_drv_spi_transfer(&spi, p_tx, length, p_rx, length);
+}
 
 /**
  * SPI user event handler
  *
- * Callback for Softdevice SPI Driver. Release blocking semaphore for SPI Transfer
+ * Callback for Softdevice SPI Driver. Ends running transaction and starts the next queued one
+ * within the same interrupt, so a queued sequence needs no wake-up of main context.
  */
 void spi_event_handler(nrf_drv_spi_evt_t const * p_event)
 {
-    spi_xfer_done = true;
-    NRF_LOG_DEBUG("SPI Xfer done\r\n");
+    TRACE_DEBUG("SPI Xfer done\r\n");
+    spi_transaction_complete(NRF_SUCCESS);
 }
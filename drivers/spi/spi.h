@@ -5,6 +5,9 @@
 
 SPI Wrapper for Ruuvitag that provides a SPI Transfer function for the Sensors using the SPI bus.
 
+Transfers go through the transaction queue of spi_transaction.h. Blocking transfer functions
+queue their transfer behind any running sequence and wait for it.
+
 Note: SPI and SPI0 have to be enabled in sdk_config.h in the project, to use this driver.
 
 Vesa Koskinen
@@ -24,6 +27,7 @@ extern "C"
 #include <stdbool.h>
 #include <stdint.h>
 #include "app_error.h"
+#include "spi_transaction.h"
 
 /* CONSTANTS **************************************************************************************/
 
@@ -54,26 +58,30 @@ extern void spi_init(void);
 extern bool spi_isInitialized(void);
 
 /**
- * Send and receive bytes for bme280 environmental sensor
+ * Send and receive bytes for bme280 environmental sensor. Blocks until transfer is done,
+ * must not be called from interrupt context.
  *
- * @param[in] p_toWrite Data to transfer
+ * @param[in] p_toWrite Data to transfer, in RAM
  * @param[out] p_toRead Receive buffer
  * @param[in] count Size of p_toRead and p_toWrite
  *
  * @return SPI_RET_OK SPI transfer was successful
- * @return SPI_RET_BUSY SPI is busy with other transfer, please try again
+ * @return SPI_RET_BUSY Transaction queue is full, please try again
+ * @return SPI_RET_ERROR Buffers are NULL or transfer failed
  */
 extern SPI_Ret spi_transfer_bme280(uint8_t* const p_toWrite, uint8_t count, uint8_t* const p_toRead);
 
 /**
- * Send and receive bytes for lis2dh12 Acceleration Sensor
+ * Send and receive bytes for lis2dh12 Acceleration Sensor. Blocks until transfer is done,
+ * must not be called from interrupt context.
  *
- * @param[in] p_toWrite Data to transfer
+ * @param[in] p_toWrite Data to transfer, in RAM
  * @param[out] p_toRead Receive buffer
  * @param[in] count Size of p_toRead and p_toWrite
  *
  * @return SPI_RET_OK SPI transfer was successful
- * @return SPI_RET_BUSY SPI is busy with other transfer, please try again
+ * @return SPI_RET_BUSY Transaction queue is full, please try again
+ * @return SPI_RET_ERROR Buffers are NULL or transfer failed
  */
 extern SPI_Ret spi_transfer_lis2dh12(uint8_t* const p_toWrite, uint8_t count, uint8_t* const p_toRead);
 
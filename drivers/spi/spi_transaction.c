@@ -0,0 +1,212 @@
+#include "spi_transaction.h"
+
+#include <stddef.h>
+#include <string.h>
+#include "app_util_platform.h"
+#include "nrf_error.h"
+#include "scheduler.h"
+#include "trace.h"
+
+#define NRF_LOG_MODULE_NAME "SPI_TRANSACTION"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+/** Class of completion handlers, sensor results feed advertisement updates */
+#ifndef SPI_TRANSACTION_PRIORITY
+  #define SPI_TRANSACTION_PRIORITY SCHEDULER_PRIORITY_REALTIME
+#endif
+
+/** Ring of transaction pointers */
+typedef struct {
+  spi_transaction_t* items[SPI_TRANSACTION_QUEUE_SIZE];
+  uint8_t head;
+  uint8_t count;
+}transaction_ring_t;
+
+static const spi_port_t*     port = NULL;
+static transaction_ring_t    queued;
+static transaction_ring_t    completed;
+static spi_transaction_t*    active = NULL;
+static bool                  delivery_scheduled = false;
+static uint8_t               holds = 0;
+static spi_transaction_stats_t stats;
+
+static void ring_push(transaction_ring_t* ring, spi_transaction_t* p_transaction)
+{
+  ring->items[(ring->head + ring->count) % SPI_TRANSACTION_QUEUE_SIZE] = p_transaction;
+  ring->count++;
+}
+
+static spi_transaction_t* ring_pop(transaction_ring_t* ring)
+{
+  if(0 == ring->count) { return NULL; }
+  spi_transaction_t* p_transaction = ring->items[ring->head];
+  ring->head = (ring->head + 1) % SPI_TRANSACTION_QUEUE_SIZE;
+  ring->count--;
+  return p_transaction;
+}
+
+/** Transactions which hold a slot, i.e. queued, running or waiting for delivery */
+static uint8_t slots_used(void)
+{
+  return queued.count + completed.count + (NULL != active);
+}
+
+/** Run handlers of completed transactions, in main context */
+static void deliver(void* p_data, uint16_t length)
+{
+  spi_transaction_t* p_transaction;
+  CRITICAL_REGION_ENTER();
+  delivery_scheduled = false;
+  stats.deliveries++;
+  CRITICAL_REGION_EXIT();
+
+  do
+  {
+    CRITICAL_REGION_ENTER();
+    p_transaction = ring_pop(&completed);
+    CRITICAL_REGION_EXIT();
+    if(p_transaction) { p_transaction->handler(p_transaction); }
+  } while(p_transaction);
+}
+
+/** Queue delivery once bus is idle. Call in critical region. */
+static void schedule_delivery(void)
+{
+  if(delivery_scheduled || NULL != active || 0 == completed.count) { return; }
+  // If scheduler queue is full, delivery is retried on next completion or put
+  delivery_scheduled = (NRF_SUCCESS == scheduler_event_put(NULL, 0, deliver, SPI_TRANSACTION_PRIORITY));
+}
+
+/** Store result of transaction. Call in critical region. */
+static void finish(spi_transaction_t* p_transaction, ret_code_t result)
+{
+  p_transaction->result = result;
+  p_transaction->state = SPI_TRANSACTION_DONE;
+  stats.transactions++;
+  if(p_transaction->handler) { ring_push(&completed, p_transaction); }
+}
+
+/** Start queued transactions until one is running or queue is empty. Call in critical region. */
+static void start_next(void)
+{
+  while(NULL != (active = ring_pop(&queued)))
+  {
+    active->state = SPI_TRANSACTION_ACTIVE;
+    port->select(active->device, true);
+    ret_code_t err_code = port->start(active->p_tx, active->p_rx, active->length);
+    if(NRF_SUCCESS == err_code) { return; }
+
+    TRACE_WARNING("Transfer to %d not started: %d\r\n", active->device, err_code);
+    port->select(active->device, false);
+    finish(active, err_code);
+  }
+  schedule_delivery();
+}
+
+/** Start bus if it is idle and transactions are queued. Call in critical region. */
+static void start_sequence(void)
+{
+  if(NULL != active || 0 == queued.count) { return; }
+  stats.sequences++;
+  start_next();
+}
+
+void spi_transaction_init(const spi_port_t* p_port)
+{
+  CRITICAL_REGION_ENTER();
+  port = p_port;
+  queued.head = queued.count = 0;
+  completed.head = completed.count = 0;
+  active = NULL;
+  delivery_scheduled = false;
+  holds = 0;
+  memset(&stats, 0, sizeof(stats));
+  CRITICAL_REGION_EXIT();
+}
+
+ret_code_t spi_transaction_put_sequence(spi_transaction_t* const* p_transactions, uint8_t count)
+{
+  if(NULL == p_transactions) { return NRF_ERROR_NULL; }
+  for(uint8_t ii = 0; ii < count; ii++)
+  {
+    const spi_transaction_t* p_transaction = p_transactions[ii];
+    if(NULL == p_transaction || NULL == p_transaction->p_tx || NULL == p_transaction->p_rx) { return NRF_ERROR_NULL; }
+    if(SPI_DEVICE_COUNT <= p_transaction->device) { return NRF_ERROR_INVALID_PARAM; }
+  }
+
+  ret_code_t err_code = NRF_SUCCESS;
+  bool polled = false;
+  CRITICAL_REGION_ENTER();
+  for(uint8_t ii = 0; ii < count && NRF_SUCCESS == err_code; ii++)
+  {
+    spi_transaction_state_t state = p_transactions[ii]->state;
+    if(SPI_TRANSACTION_QUEUED == state || SPI_TRANSACTION_ACTIVE == state) { err_code = NRF_ERROR_INVALID_STATE; }
+  }
+  if(NULL == port) { err_code = NRF_ERROR_INVALID_STATE; }
+  if(NRF_SUCCESS == err_code && SPI_TRANSACTION_QUEUE_SIZE - slots_used() < count)
+  {
+    err_code = NRF_ERROR_NO_MEM;
+    stats.rejected += (UINT16_MAX - stats.rejected < count) ? UINT16_MAX - stats.rejected : count;
+  }
+  if(NRF_SUCCESS == err_code)
+  {
+    for(uint8_t ii = 0; ii < count; ii++)
+    {
+      p_transactions[ii]->state = SPI_TRANSACTION_QUEUED;
+      ring_push(&queued, p_transactions[ii]);
+      polled |= (NULL == p_transactions[ii]->handler);
+    }
+    if(slots_used() > stats.queue_peak) { stats.queue_peak = slots_used(); }
+    // Blocking callers wait for their transaction, they cannot be held
+    if(0 == holds || polled) { start_sequence(); }
+    schedule_delivery();
+  }
+  CRITICAL_REGION_EXIT();
+  return err_code;
+}
+
+ret_code_t spi_transaction_put(spi_transaction_t* p_transaction)
+{
+  return spi_transaction_put_sequence(&p_transaction, 1);
+}
+
+void spi_transaction_complete(ret_code_t result)
+{
+  CRITICAL_REGION_ENTER();
+  if(NULL != active)
+  {
+    port->select(active->device, false);
+    finish(active, result);
+    start_next();
+  }
+  CRITICAL_REGION_EXIT();
+}
+
+void spi_transaction_hold(void)
+{
+  CRITICAL_REGION_ENTER();
+  if(UINT8_MAX > holds) { holds++; }
+  CRITICAL_REGION_EXIT();
+}
+
+void spi_transaction_release(void)
+{
+  CRITICAL_REGION_ENTER();
+  if(holds && 0 == --holds)
+  {
+    stats.holds++;
+    start_sequence();
+  }
+  CRITICAL_REGION_EXIT();
+}
+
+bool spi_transaction_busy(void)
+{
+  return NULL != active || 0 != queued.count;
+}
+
+const spi_transaction_stats_t* spi_transaction_stats_get(void)
+{
+  return &stats;
+}
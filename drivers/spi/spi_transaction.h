@@ -0,0 +1,135 @@
+#ifndef SPI_TRANSACTION_H
+#define SPI_TRANSACTION_H
+
+/**
+ *  Queue of SPI transactions of several devices on one bus.
+ *
+ *  Transactions are queued by pointer, the caller owns the storage and buffers until
+ *  the transaction is done. The next transaction is started from the completion
+ *  interrupt of the previous one, so a sequence put with spi_transaction_put_sequence()
+ *  runs back to back as chained EasyDMA transfers without waking main context.
+ *  Chip select of each device is driven per transaction by the port.
+ *
+ *  Completion handlers run in main context through the scheduler. Handlers of all
+ *  transactions completed while the bus was busy are run from a single scheduler event
+ *  once the queue is empty, so a sensor sweep costs one wake-up. Transactions without
+ *  a handler are not reported, the caller polls state, e.g. blocking wrappers of spi.h.
+ *
+ *  Drivers which put their transactions independently can be joined into one sequence
+ *  by holding the queue with spi_transaction_hold() while they put.
+ *
+ *  Hardware is reached only through spi_port_t, which lets the queue run against a
+ *  fake bus on host, see tools/spi_sweep.
+ *
+ *  License: BSD-3
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+/** Transactions queued or completed but not yet reported */
+#ifndef SPI_TRANSACTION_QUEUE_SIZE
+  #define SPI_TRANSACTION_QUEUE_SIZE 8
+#endif
+
+/** Devices on the bus, port maps each to its chip select */
+typedef enum {
+  SPI_DEVICE_BME280 = 0,
+  SPI_DEVICE_LIS2DH12,
+  SPI_DEVICE_COUNT
+}spi_device_t;
+
+typedef enum {
+  SPI_TRANSACTION_IDLE = 0, /**< Not queued, may be modified */
+  SPI_TRANSACTION_QUEUED,   /**< Waiting for bus */
+  SPI_TRANSACTION_ACTIVE,   /**< Transfer running */
+  SPI_TRANSACTION_DONE      /**< Result is valid, handler may still be pending */
+}spi_transaction_state_t;
+
+typedef struct spi_transaction_s spi_transaction_t;
+
+/** Called in main context after transaction is done */
+typedef void(*spi_transaction_handler_t)(spi_transaction_t* p_transaction);
+
+struct spi_transaction_s {
+  spi_device_t              device;
+  const uint8_t*            p_tx;      /**< Bytes to send, length bytes */
+  uint8_t*                  p_rx;      /**< Bytes received, length bytes */
+  uint8_t                   length;    /**< Up to 255 bytes, EasyDMA limit of nRF52832 */
+  spi_transaction_handler_t handler;   /**< NULL if caller polls state */
+  void*                     p_context;
+  volatile spi_transaction_state_t state;
+  ret_code_t                result;    /**< Valid when state is done */
+};
+
+/** Access to the bus, implemented by spi.c on target */
+typedef struct {
+  /** Drive chip select of device, called before and after each transfer */
+  void (*select)(spi_device_t device, bool selected);
+  /** Start transfer, port calls spi_transaction_complete() when it ends */
+  ret_code_t (*start)(const uint8_t* p_tx, uint8_t* p_rx, uint8_t length);
+}spi_port_t;
+
+/** Statistics since init */
+typedef struct {
+  uint32_t transactions; /**< Transactions completed */
+  uint32_t sequences;    /**< Times bus went from idle to busy */
+  uint32_t deliveries;   /**< Scheduler events which reported completions */
+  uint32_t holds;        /**< Outermost holds released */
+  uint16_t rejected;     /**< Transactions not queued because queue was full */
+  uint8_t  queue_peak;   /**< Highest number of queued and unreported transactions */
+}spi_transaction_stats_t;
+
+/**
+ *  Clear queue and set port. Call before any transaction, queued transactions are lost.
+ */
+void spi_transaction_init(const spi_port_t* p_port);
+
+/**
+ *  Queue one transaction. Starts it right away if bus is idle.
+ *  Safe to call from interrupt context.
+ *
+ *  @return NRF_SUCCESS if transaction was queued
+ *  @return NRF_ERROR_NULL if transaction or its buffers are NULL
+ *  @return NRF_ERROR_INVALID_PARAM if device is not valid
+ *  @return NRF_ERROR_INVALID_STATE if transaction is already queued or port is not set
+ *  @return NRF_ERROR_NO_MEM if queue is full
+ */
+ret_code_t spi_transaction_put(spi_transaction_t* p_transaction);
+
+/**
+ *  Queue transactions atomically, they run back to back in given order. Either all
+ *  or none of the transactions are queued. Return values as spi_transaction_put().
+ */
+ret_code_t spi_transaction_put_sequence(spi_transaction_t* const* p_transactions, uint8_t count);
+
+/**
+ *  Do not start bus from idle until spi_transaction_release(), transactions put meanwhile
+ *  run as one sequence. A running sequence is not stopped, transactions put while it
+ *  runs join it as usual. Transactions without handler start the bus even while held,
+ *  as their caller waits for them. Calls nest. Call in main context.
+ */
+void spi_transaction_hold(void);
+
+/**
+ *  End hold of spi_transaction_hold(). Last release starts the queued transactions.
+ */
+void spi_transaction_release(void);
+
+/**
+ *  End of running transfer, called by port from its interrupt handler.
+ *  Starts the next queued transaction.
+ *
+ *  @param result NRF_SUCCESS or error of transfer
+ */
+void spi_transaction_complete(ret_code_t result);
+
+/** Return true if a transfer is running or queued */
+bool spi_transaction_busy(void);
+
+/** Return statistics since init */
+const spi_transaction_stats_t* spi_transaction_stats_get(void);
+
+#endif
@@ -0,0 +1,109 @@
+#include "warm_boot.h"
+
+#include <string.h>
+#include "crc32.h"
+#include "nrf.h"
+
+/** Mixed into check values, record of other firmware in the same RAM is not valid */
+#define WARM_BOOT_MAGIC 0x57524D42
+
+/** Resets which keep RAM and which the tag triggers itself */
+#define WARM_BOOT_RESET_MASK (POWER_RESETREAS_SREQ_Msk | POWER_RESETREAS_DOG_Msk)
+
+typedef struct
+{
+  uint32_t app_size;                          // Bank 0 of bootloader settings at validation
+  uint32_t app_crc;
+  uint32_t app_check;
+  uint16_t state_size;
+  uint8_t  count;                             // Consecutive warm boots
+  uint8_t  reserved;
+  uint8_t  state[WARM_BOOT_STATE_MAX_SIZE];
+  uint32_t state_check;                       // Covers state_size, count and state
+}warm_boot_record_t;
+
+/** Not initialised by startup code, see linker scripts */
+static warm_boot_record_t record __attribute__((section(".warm_boot")));
+static bool warm = false;
+static uint8_t count = 0;
+
+static uint32_t app_check(void)
+{
+  return crc32_compute((const uint8_t*)&record.app_size, 2 * sizeof(uint32_t), NULL) ^ WARM_BOOT_MAGIC;
+}
+
+static uint32_t state_check(void)
+{
+  return crc32_compute((const uint8_t*)&record.state_size, offsetof(warm_boot_record_t, state_check) - offsetof(warm_boot_record_t, state_size), NULL) ^ WARM_BOOT_MAGIC;
+}
+
+static bool state_is_valid(void)
+{
+  return WARM_BOOT_STATE_MAX_SIZE >= record.state_size && state_check() == record.state_check;
+}
+
+bool warm_boot_reset_is_warm(void)
+{
+  uint32_t reasons = NRF_POWER->RESETREAS;
+  // No reason flagged means power on or brownout
+  return 0 != reasons && 0 == (reasons & ~WARM_BOOT_RESET_MASK);
+}
+
+bool warm_boot_init(void)
+{
+  warm = warm_boot_reset_is_warm() && state_is_valid();
+  // Reasons are latched until cleared, next boot must see only its own
+  NRF_POWER->RESETREAS = NRF_POWER->RESETREAS;
+  count = warm ? record.count + 1 : 0;
+  if(WARM_BOOT_MAX_COUNT < count)
+  {
+    warm = false;
+    count = 0;
+  }
+  if(!warm) { warm_boot_state_clear(); }
+  return warm;
+}
+
+uint8_t warm_boot_count(void)
+{
+  return count;
+}
+
+bool warm_boot_state_load(void* p_state, size_t size)
+{
+  if(!warm || NULL == p_state || size != record.state_size) { return false; }
+  memcpy(p_state, record.state, size);
+  return true;
+}
+
+void warm_boot_state_store(const void* p_state, size_t size)
+{
+  if(NULL == p_state || WARM_BOOT_STATE_MAX_SIZE < size) { return; }
+  memcpy(record.state, p_state, size);
+  record.state_size = size;
+  record.count = count;
+  record.reserved = 0;
+  record.state_check = state_check();
+}
+
+void warm_boot_state_clear(void)
+{
+  record.state_size = 0;
+  record.count = 0;
+  // Check of an empty state would be valid
+  record.state_check = ~state_check();
+}
+
+bool warm_boot_app_is_validated(uint32_t size, uint32_t crc)
+{
+  return warm_boot_reset_is_warm() && app_check() == record.app_check &&
+         size == record.app_size && crc == record.app_crc;
+}
+
+void warm_boot_app_validated(uint32_t size, uint32_t crc)
+{
+  warm_boot_state_clear();
+  record.app_size = size;
+  record.app_crc = crc;
+  record.app_check = app_check();
+}
@@ -0,0 +1,72 @@
+#ifndef WARM_BOOT_H
+#define WARM_BOOT_H
+
+/**
+ *  Record of the previous boot in retained RAM, lets startup skip work on warm boots.
+ *
+ *  Soft reset and watchdog reset keep RAM contents. Tag resets itself this way on long
+ *  button press, after NFC field and on watchdog. Power on, reset pin, lockup and wake up
+ *  from System OFF are cold boots and the record is not trusted then.
+ *
+ *  Record is in section .warm_boot which both the application and the bootloader link to
+ *  region WARM_BOOT at the top of RAM, outside of their RAM region so that startup code
+ *  and stack leave it alone. It has two parts with check values of their own:
+ *   - Application which bootloader validated, bootloader starts it without computing the
+ *     CRC of the image again while bootloader settings still describe the same image.
+ *   - Opaque state of the application, e.g. sensors found on cold boot and their
+ *     calibration. Bootloader drops the state whenever it validates the application,
+ *     state of an updated application is never loaded by the new one.
+ *
+ *  Module uses RESETREAS of POWER and must be initialised before SoftDevice is enabled.
+ *
+ *  License: BSD-3
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Bytes of application state */
+#ifndef WARM_BOOT_STATE_MAX_SIZE
+  #define WARM_BOOT_STATE_MAX_SIZE 96
+#endif
+
+/** Consecutive warm boots, next boot is cold so that sensors are probed again now and then */
+#ifndef WARM_BOOT_MAX_COUNT
+  #define WARM_BOOT_MAX_COUNT 8
+#endif
+
+/** Return true if this boot was caused by soft reset or watchdog only. RESETREAS is not cleared. */
+bool warm_boot_reset_is_warm(void);
+
+/**
+ *  Read and clear reset reasons, count consecutive warm boots. Application calls this once
+ *  at startup, before SoftDevice is enabled.
+ *
+ *  @return true if boot is warm and state of the previous boot is valid
+ */
+bool warm_boot_init(void);
+
+/** Return number of consecutive warm boots including this one, 0 on cold boot */
+uint8_t warm_boot_count(void);
+
+/**
+ *  Load application state stored on previous boot.
+ *
+ *  @return true if boot is warm and a valid state of size bytes was stored
+ */
+bool warm_boot_state_load(void* p_state, size_t size);
+
+/** Store application state for the next warm boot. Size is at most WARM_BOOT_STATE_MAX_SIZE. */
+void warm_boot_state_store(const void* p_state, size_t size);
+
+/** Drop application state, next boot of the application is cold */
+void warm_boot_state_clear(void);
+
+/** Bootloader: return true if boot is warm and an application of size and CRC was validated earlier */
+bool warm_boot_app_is_validated(uint32_t size, uint32_t crc);
+
+/** Bootloader: record that application of size and CRC is valid, drops application state */
+void warm_boot_app_validated(uint32_t size, uint32_t crc);
+
+#endif
@@ -0,0 +1,50 @@
+#include "adv_auth.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+/** CMAC of address and packet up to tag */
+static void compute_tag(const aes_cmac_t* p_cmac, const uint8_t* p_address, const uint8_t* p_packet, uint8_t* p_tag)
+{
+  uint8_t message[ADV_AUTH_ADDRESS_LENGTH + ADV_AUTH_TAG_OFFSET];
+  memcpy(message, p_address, ADV_AUTH_ADDRESS_LENGTH);
+  memcpy(&message[ADV_AUTH_ADDRESS_LENGTH], p_packet, ADV_AUTH_TAG_OFFSET);
+  aes_cmac_compute(p_cmac, message, sizeof(message), p_tag);
+}
+
+uint32_t adv_auth_counter(const uint8_t* p_packet)
+{
+  const uint8_t* p = &p_packet[ADV_AUTH_COUNTER_OFFSET];
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+void adv_auth_sign(const aes_cmac_t* p_cmac, const uint8_t* p_address, uint8_t* p_packet, uint32_t counter)
+{
+  uint8_t mac[AES_BLOCK_SIZE];
+  p_packet[ADV_AUTH_COUNTER_OFFSET]     = counter >> 24;
+  p_packet[ADV_AUTH_COUNTER_OFFSET + 1] = (counter >> 16) & 0xFF;
+  p_packet[ADV_AUTH_COUNTER_OFFSET + 2] = (counter >> 8) & 0xFF;
+  p_packet[ADV_AUTH_COUNTER_OFFSET + 3] = counter & 0xFF;
+  compute_tag(p_cmac, p_address, p_packet, mac);
+  memcpy(&p_packet[ADV_AUTH_TAG_OFFSET], mac, ADV_AUTH_TAG_LENGTH);
+}
+
+adv_auth_result_t adv_auth_verify(const aes_cmac_t* p_cmac, const uint8_t* p_address, const uint8_t* p_packet,
+                                  uint8_t length, uint32_t* p_latest_counter)
+{
+  if(ADV_AUTH_LENGTH != length || ADV_AUTH_FORMAT != p_packet[0]) { return ADV_AUTH_INVALID; }
+
+  uint8_t mac[AES_BLOCK_SIZE];
+  compute_tag(p_cmac, p_address, p_packet, mac);
+  // Compare all bytes so that time does not tell how many matched
+  uint8_t difference = 0;
+  for(uint8_t ii = 0; ii < ADV_AUTH_TAG_LENGTH; ii++) { difference |= mac[ii] ^ p_packet[ADV_AUTH_TAG_OFFSET + ii]; }
+  if(difference) { return ADV_AUTH_FORGED; }
+
+  if(NULL == p_latest_counter) { return ADV_AUTH_VALID; }
+  uint32_t counter = adv_auth_counter(p_packet);
+  if(counter == *p_latest_counter) { return ADV_AUTH_DUPLICATE; }
+  if(counter < *p_latest_counter)  { return ADV_AUTH_REPLAY; }
+  *p_latest_counter = counter;
+  return ADV_AUTH_VALID;
+}
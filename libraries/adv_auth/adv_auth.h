@@ -0,0 +1,64 @@
+#ifndef ADV_AUTH_H
+#define ADV_AUTH_H
+
+/**
+ *  Authentication of advertisement payloads with a truncated AES-CMAC.
+ *
+ *  Tag of a packet is CMAC over the 6-byte device address, most significant byte first
+ *  as in RAWv2, followed by the packet up to the tag. The address binds a packet to the
+ *  tag it came from and the counter, which must never repeat for a key, lets receivers
+ *  reject replays. 26 bytes of message make two block encryptions per packet.
+ *
+ *  Tags sign with adv_auth_sign(), gateways check packets with adv_auth_verify() and
+ *  keep the latest accepted counter of each tag. Layout of AUTHENTICATED_FORMAT is in
+ *  sensortag.h.
+ *
+ *  Portable C99, no SDK dependencies.
+ *
+ *  License: BSD-3
+ */
+
+#include <stdint.h>
+#include "aes_cmac.h"
+
+#define ADV_AUTH_FORMAT         0xF2     /**< Experimental, authenticated RAWv2 */
+#define ADV_AUTH_LENGTH         24
+#define ADV_AUTH_COUNTER_OFFSET 16       /**< uint32_t, most significant byte first */
+#define ADV_AUTH_TAG_OFFSET     20
+#define ADV_AUTH_TAG_LENGTH     4
+#define ADV_AUTH_ADDRESS_LENGTH 6
+
+typedef enum {
+  ADV_AUTH_VALID     = 0,   /**< Tag matches and counter is newer than latest */
+  ADV_AUTH_DUPLICATE = 1,   /**< Tag matches and counter is latest, e.g. same packet on another channel */
+  ADV_AUTH_REPLAY    = 2,   /**< Tag matches but counter is older than latest */
+  ADV_AUTH_FORGED    = 3,   /**< Tag does not match */
+  ADV_AUTH_INVALID   = 4    /**< Not an authenticated packet */
+}adv_auth_result_t;
+
+/** Return counter of packet */
+uint32_t adv_auth_counter(const uint8_t* p_packet);
+
+/**
+ *  Write counter and tag to packet of ADV_AUTH_LENGTH bytes whose other fields are set
+ *
+ *  @param p_cmac    CMAC keyed with key of tag
+ *  @param p_address device address, ADV_AUTH_ADDRESS_LENGTH bytes
+ *  @param p_packet  packet to sign
+ *  @param counter   packet counter, larger than counter of any packet signed before with the key
+ */
+void adv_auth_sign(const aes_cmac_t* p_cmac, const uint8_t* p_address, uint8_t* p_packet, uint32_t counter);
+
+/**
+ *  Check packet received from address. Latest counter is updated if packet is valid.
+ *
+ *  @param p_cmac           CMAC keyed with key of tag
+ *  @param p_address        device address, ADV_AUTH_ADDRESS_LENGTH bytes
+ *  @param p_packet         received manufacturer data after company ID
+ *  @param length           bytes of packet
+ *  @param p_latest_counter latest accepted counter of tag, NULL to check tag only
+ */
+adv_auth_result_t adv_auth_verify(const aes_cmac_t* p_cmac, const uint8_t* p_address, const uint8_t* p_packet,
+                                  uint8_t length, uint32_t* p_latest_counter);
+
+#endif
@@ -0,0 +1,141 @@
+#include "aes_cmac.h"
+
+#include <string.h>
+
+/** Constant of subkey generation, RFC 4493 2.3 */
+#define CMAC_RB 0x87
+
+static const uint8_t sbox[256] = {
+  0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+  0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+  0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+  0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+  0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+  0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+  0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+  0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+  0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+  0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+  0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+  0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+  0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+  0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+  0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+  0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+/** Multiply by x in GF(2^8) */
+static uint8_t xtime(uint8_t value)
+{
+  return (value << 1) ^ ((value & 0x80) ? 0x1B : 0x00);
+}
+
+void aes128_init(aes128_t* p_aes, const uint8_t* p_key)
+{
+  uint8_t* w = p_aes->round_keys;
+  uint8_t rcon = 0x01;
+  memcpy(w, p_key, AES_KEY_SIZE);
+  for(uint8_t ii = 4; ii < 44; ii++)
+  {
+    uint8_t t[4] = { w[4 * ii - 4], w[4 * ii - 3], w[4 * ii - 2], w[4 * ii - 1] };
+    if(0 == ii % 4)
+    {
+      // RotWord, SubWord and round constant
+      uint8_t first = t[0];
+      t[0] = sbox[t[1]] ^ rcon;
+      t[1] = sbox[t[2]];
+      t[2] = sbox[t[3]];
+      t[3] = sbox[first];
+      rcon = xtime(rcon);
+    }
+    for(uint8_t jj = 0; jj < 4; jj++) { w[4 * ii + jj] = w[4 * ii - 16 + jj] ^ t[jj]; }
+  }
+}
+
+static void add_round_key(uint8_t* p_state, const uint8_t* p_key)
+{
+  for(uint8_t ii = 0; ii < AES_BLOCK_SIZE; ii++) { p_state[ii] ^= p_key[ii]; }
+}
+
+/** SubBytes and ShiftRows, state is column major */
+static void sub_shift(uint8_t* s)
+{
+  uint8_t t;
+  for(uint8_t ii = 0; ii < AES_BLOCK_SIZE; ii++) { s[ii] = sbox[s[ii]]; }
+  // Row 1 left by 1
+  t = s[1];  s[1] = s[5];   s[5] = s[9];   s[9] = s[13];  s[13] = t;
+  // Row 2 left by 2
+  t = s[2];  s[2] = s[10];  s[10] = t;
+  t = s[6];  s[6] = s[14];  s[14] = t;
+  // Row 3 left by 3
+  t = s[15]; s[15] = s[11]; s[11] = s[7];  s[7] = s[3];   s[3] = t;
+}
+
+static void mix_columns(uint8_t* s)
+{
+  for(uint8_t ii = 0; ii < AES_BLOCK_SIZE; ii += 4)
+  {
+    uint8_t a0 = s[ii], a1 = s[ii + 1], a2 = s[ii + 2], a3 = s[ii + 3];
+    uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+    s[ii]     ^= all ^ xtime(a0 ^ a1);
+    s[ii + 1] ^= all ^ xtime(a1 ^ a2);
+    s[ii + 2] ^= all ^ xtime(a2 ^ a3);
+    s[ii + 3] ^= all ^ xtime(a3 ^ a0);
+  }
+}
+
+void aes128_encrypt(void* p_context, const uint8_t* p_in, uint8_t* p_out)
+{
+  const aes128_t* p_aes = p_context;
+  uint8_t state[AES_BLOCK_SIZE];
+  memcpy(state, p_in, AES_BLOCK_SIZE);
+  add_round_key(state, p_aes->round_keys);
+  for(uint8_t round = 1; round < 10; round++)
+  {
+    sub_shift(state);
+    mix_columns(state);
+    add_round_key(state, &p_aes->round_keys[round * AES_BLOCK_SIZE]);
+  }
+  sub_shift(state);
+  add_round_key(state, &p_aes->round_keys[10 * AES_BLOCK_SIZE]);
+  memcpy(p_out, state, AES_BLOCK_SIZE);
+}
+
+/** Shift block left by one bit, XOR Rb if top bit fell out, RFC 4493 2.3 */
+static void subkey_double(const uint8_t* p_in, uint8_t* p_out)
+{
+  uint8_t carry = p_in[0] & 0x80;
+  for(uint8_t ii = 0; ii < AES_BLOCK_SIZE - 1; ii++) { p_out[ii] = (p_in[ii] << 1) | (p_in[ii + 1] >> 7); }
+  p_out[AES_BLOCK_SIZE - 1] = p_in[AES_BLOCK_SIZE - 1] << 1;
+  if(carry) { p_out[AES_BLOCK_SIZE - 1] ^= CMAC_RB; }
+}
+
+void aes_cmac_init(aes_cmac_t* p_cmac, aes_block_cipher_t cipher, void* p_context)
+{
+  uint8_t l[AES_BLOCK_SIZE] = {0};
+  p_cmac->cipher = cipher;
+  p_cmac->p_context = p_context;
+  cipher(p_context, l, l);
+  subkey_double(l, p_cmac->k1);
+  subkey_double(p_cmac->k1, p_cmac->k2);
+}
+
+void aes_cmac_compute(const aes_cmac_t* p_cmac, const uint8_t* p_message, size_t length, uint8_t* p_mac)
+{
+  uint8_t x[AES_BLOCK_SIZE] = {0};
+  // All but last block, last block is complete unless message is empty or ends mid-block
+  while(AES_BLOCK_SIZE < length)
+  {
+    for(uint8_t ii = 0; ii < AES_BLOCK_SIZE; ii++) { x[ii] ^= p_message[ii]; }
+    p_cmac->cipher(p_cmac->p_context, x, x);
+    p_message += AES_BLOCK_SIZE;
+    length -= AES_BLOCK_SIZE;
+  }
+  const uint8_t* p_subkey = (AES_BLOCK_SIZE == length) ? p_cmac->k1 : p_cmac->k2;
+  for(uint8_t ii = 0; ii < AES_BLOCK_SIZE; ii++)
+  {
+    uint8_t byte = (ii < length) ? p_message[ii] : ((ii == length) ? 0x80 : 0x00);
+    x[ii] ^= byte ^ p_subkey[ii];
+  }
+  p_cmac->cipher(p_cmac->p_context, x, p_mac);
+}
@@ -0,0 +1,56 @@
+#ifndef AES_CMAC_H
+#define AES_CMAC_H
+
+/**
+ *  AES-CMAC of RFC 4493 over a pluggable AES-128 block cipher.
+ *
+ *  Firmware passes the ECB peripheral as the cipher, gateways and host tools pass the
+ *  software AES-128 of this file. Both give the same MACs, software cipher is the
+ *  reference implementation. Only encryption is needed by CMAC.
+ *
+ *  Portable C99, no SDK dependencies.
+ *
+ *  License: BSD-3
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AES_BLOCK_SIZE 16
+#define AES_KEY_SIZE   16
+
+/** Encrypt one block with the key held in p_context. In and out may be the same buffer. */
+typedef void(*aes_block_cipher_t)(void* p_context, const uint8_t* p_in, uint8_t* p_out);
+
+/** Expanded key of software AES-128 */
+typedef struct {
+  uint8_t round_keys[11 * AES_BLOCK_SIZE];
+}aes128_t;
+
+/** CMAC state: cipher and subkeys derived from its key */
+typedef struct {
+  aes_block_cipher_t cipher;
+  void*              p_context;
+  uint8_t            k1[AES_BLOCK_SIZE];
+  uint8_t            k2[AES_BLOCK_SIZE];
+}aes_cmac_t;
+
+/** Expand key of software AES-128 */
+void aes128_init(aes128_t* p_aes, const uint8_t* p_key);
+
+/** Software AES-128 encryption of one block, aes_block_cipher_t with aes128_t as context */
+void aes128_encrypt(void* p_context, const uint8_t* p_in, uint8_t* p_out);
+
+/**
+ *  Derive subkeys, costs one block encryption. Call again when key of cipher changes.
+ *
+ *  @param p_cmac    state to initialise
+ *  @param cipher    block cipher
+ *  @param p_context context of cipher holding the key, must stay valid
+ */
+void aes_cmac_init(aes_cmac_t* p_cmac, aes_block_cipher_t cipher, void* p_context);
+
+/** Compute 16-byte MAC of message, one block encryption per started 16 bytes, at least one */
+void aes_cmac_compute(const aes_cmac_t* p_cmac, const uint8_t* p_message, size_t length, uint8_t* p_mac);
+
+#endif
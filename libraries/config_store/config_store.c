@@ -0,0 +1,282 @@
+#include "config_store.h"
+
+#include <stddef.h>
+#include <string.h>
+#include "crc32.h"
+#include "flash.h"
+#include "nrf_error.h"
+#include "scheduler.h"
+
+#define NRF_LOG_MODULE_NAME "CONFIG"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+/** Bytes of largest continuous free space of flash below which commit task runs garbage collection */
+#define CONFIG_STORE_GC_THRESHOLD 4000
+
+/** Record in flash, whole words */
+typedef struct
+{
+  uint8_t  version;
+  uint8_t  id;
+  uint8_t  type;
+  uint8_t  reserved;
+  int32_t  value;
+  uint32_t crc;                                  // CRC32 of fields above
+}config_record_t;
+
+/** Steps of commit task, continued as separate background runs if budget is used */
+typedef enum
+{
+  COMMIT_WRITE = 0,
+  COMMIT_GC    = 1
+}commit_step_t;
+
+static const config_item_t* p_table = NULL;
+static uint8_t  item_count = 0;
+static int32_t  values[CONFIG_STORE_MAX_ITEMS];
+static int32_t  stored_values[CONFIG_STORE_MAX_ITEMS];  // Value of record, valid if bit of stored_mask is set
+static uint32_t stored_mask = 0;
+static uint32_t pending_mask = 0;
+static config_store_change_handler_t change_handler = NULL;
+
+static uint32_t record_crc(const config_record_t* p_record)
+{
+  return crc32_compute((const uint8_t*)p_record, offsetof(config_record_t, crc), NULL);
+}
+
+/** Range of type, false for unknown type */
+static bool type_range(uint8_t type, int32_t* p_min, int32_t* p_max)
+{
+  switch(type)
+  {
+    case CONFIG_TYPE_UINT8:  *p_min = 0;         *p_max = UINT8_MAX;  return true;
+    case CONFIG_TYPE_INT8:   *p_min = INT8_MIN;  *p_max = INT8_MAX;   return true;
+    case CONFIG_TYPE_UINT16: *p_min = 0;         *p_max = UINT16_MAX; return true;
+    case CONFIG_TYPE_INT16:  *p_min = INT16_MIN; *p_max = INT16_MAX;  return true;
+    case CONFIG_TYPE_UINT32: *p_min = 0;         *p_max = INT32_MAX;  return true;
+    case CONFIG_TYPE_INT32:  *p_min = INT32_MIN; *p_max = INT32_MAX;  return true;
+    default: return false;
+  }
+}
+
+/** Value is within range of item and one of its values, if any */
+static bool value_is_allowed(const config_item_t* p_item, int32_t value)
+{
+  if(p_item->min > value || p_item->max < value) { return false; }
+  if(NULL == p_item->p_values) { return true; }
+  for(uint8_t ii = 0; ii < p_item->value_count; ii++)
+  {
+    if(p_item->p_values[ii] == value) { return true; }
+  }
+  return false;
+}
+
+static bool item_is_valid(const config_item_t* p_item)
+{
+  int32_t min, max;
+  return CONFIG_STORE_ALL != p_item->id && type_range(p_item->type, &min, &max) &&
+         min <= p_item->min && p_item->min <= p_item->max && p_item->max <= max &&
+         value_is_allowed(p_item, p_item->default_value);
+}
+
+/** Index of item in table, item_count if there is no such item */
+static uint8_t index_of(uint8_t id)
+{
+  uint8_t index = 0;
+  while(index < item_count && id != p_table[index].id) { index++; }
+  return index;
+}
+
+/** Read record of item, return true if it is valid for current table */
+static bool record_load(const config_item_t* p_item, int32_t* p_value)
+{
+  config_record_t record;
+  memset(&record, 0, sizeof(record));
+  if(NRF_SUCCESS != flash_record_get(CONFIG_STORE_FILE_ID, p_item->id + 1, sizeof(record), &record))
+  {
+    return false;
+  }
+  if(CONFIG_STORE_VERSION != record.version || p_item->id != record.id || p_item->type != record.type ||
+     record_crc(&record) != record.crc)
+  {
+    NRF_LOG_WARNING("Ignoring record of item %d\r\n", p_item->id);
+    return false;
+  }
+  // Range may have been narrowed by an update, record is rewritten on next change
+  if(!value_is_allowed(p_item, record.value)) { return false; }
+  *p_value = record.value;
+  return true;
+}
+
+static ret_code_t record_store(uint8_t index)
+{
+  config_record_t record;
+  memset(&record, 0, sizeof(record));
+  record.version = CONFIG_STORE_VERSION;
+  record.id = p_table[index].id;
+  record.type = p_table[index].type;
+  record.value = values[index];
+  record.crc = record_crc(&record);
+  return flash_record_set(CONFIG_STORE_FILE_ID, record.id + 1, sizeof(record), &record);
+}
+
+ret_code_t config_store_init(const config_item_t* p_items, uint8_t count, config_store_change_handler_t handler)
+{
+  if(NULL == p_items) { return NRF_ERROR_NULL; }
+  if(CONFIG_STORE_MAX_ITEMS < count) { return NRF_ERROR_INVALID_PARAM; }
+  for(uint8_t ii = 0; ii < count; ii++)
+  {
+    if(!item_is_valid(&p_items[ii])) { return NRF_ERROR_INVALID_PARAM; }
+    for(uint8_t jj = 0; jj < ii; jj++)
+    {
+      if(p_items[ii].id == p_items[jj].id) { return NRF_ERROR_INVALID_PARAM; }
+    }
+  }
+  p_table = p_items;
+  item_count = count;
+  change_handler = handler;
+  stored_mask = 0;
+  pending_mask = 0;
+  for(uint8_t ii = 0; ii < count; ii++)
+  {
+    values[ii] = p_items[ii].default_value;
+    if(record_load(&p_items[ii], &stored_values[ii]))
+    {
+      values[ii] = stored_values[ii];
+      stored_mask |= 1UL << ii;
+    }
+  }
+  NRF_LOG_INFO("Loaded %d of %d items\r\n", config_store_stored(), count);
+  return NRF_SUCCESS;
+}
+
+int32_t config_store_get(uint8_t id)
+{
+  uint8_t index = index_of(id);
+  return (index < item_count) ? values[index] : 0;
+}
+
+ret_code_t config_store_set(uint8_t id, int32_t value)
+{
+  uint8_t index = index_of(id);
+  if(index >= item_count) { return NRF_ERROR_NOT_FOUND; }
+  if(!value_is_allowed(&p_table[index], value)) { return NRF_ERROR_INVALID_PARAM; }
+  if(values[index] == value) { return NRF_SUCCESS; }
+  values[index] = value;
+  pending_mask |= 1UL << index;
+  if(change_handler) { change_handler(id, value); }
+  return NRF_SUCCESS;
+}
+
+void config_store_batch_complete(void)
+{
+  if(change_handler) { change_handler(CONFIG_STORE_ALL, 0); }
+}
+
+const config_item_t* config_store_item(uint8_t id)
+{
+  uint8_t index = index_of(id);
+  return (index < item_count) ? &p_table[index] : NULL;
+}
+
+const config_item_t* config_store_item_at(uint8_t index)
+{
+  return (index < item_count) ? &p_table[index] : NULL;
+}
+
+uint8_t config_store_count(void)
+{
+  return item_count;
+}
+
+uint8_t config_store_flags(uint8_t id)
+{
+  uint8_t index = index_of(id);
+  if(index >= item_count) { return 0; }
+  uint8_t flags = 0;
+  if(pending_mask & (1UL << index)) { flags |= CONFIG_STORE_FLAG_PENDING; }
+  if(stored_mask & (1UL << index))  { flags |= CONFIG_STORE_FLAG_STORED; }
+  if(p_table[index].default_value == values[index]) { flags |= CONFIG_STORE_FLAG_DEFAULT; }
+  if(p_table[index].secret)                         { flags |= CONFIG_STORE_FLAG_SECRET; }
+  if(p_table[index].read_only)                      { flags |= CONFIG_STORE_FLAG_READ_ONLY; }
+  return flags;
+}
+
+static uint8_t bits_set(uint32_t mask)
+{
+  uint8_t count = 0;
+  for(; mask; mask &= mask - 1) { count++; }
+  return count;
+}
+
+uint8_t config_store_pending(void)
+{
+  return bits_set(pending_mask);
+}
+
+uint8_t config_store_stored(void)
+{
+  return bits_set(stored_mask);
+}
+
+ret_code_t config_store_commit(uint8_t max_writes)
+{
+  uint8_t writes = 0;
+  for(uint8_t ii = 0; ii < item_count && pending_mask; ii++)
+  {
+    uint32_t bit = 1UL << ii;
+    if(!(pending_mask & bit)) { continue; }
+    // Value changed back to the one in flash, or to default of an item without record
+    bool stored = stored_mask & bit;
+    if((stored && stored_values[ii] == values[ii]) || (!stored && p_table[ii].default_value == values[ii]))
+    {
+      pending_mask &= ~bit;
+      continue;
+    }
+    if(max_writes && writes == max_writes) { break; }
+    ret_code_t err_code = record_store(ii);
+    if(NRF_SUCCESS != err_code) { return err_code; }
+    writes++;
+    stored_values[ii] = values[ii];
+    stored_mask |= bit;
+    pending_mask &= ~bit;
+  }
+  return NRF_SUCCESS;
+}
+
+void config_store_commit_task(void* p_data, uint16_t length)
+{
+  uint8_t step = (NULL == p_data) ? COMMIT_WRITE : *(uint8_t*)p_data;
+  if(COMMIT_WRITE == step)
+  {
+    // One record per round so that sensor and radio tasks are not delayed by a batch
+    while(config_store_pending())
+    {
+      ret_code_t err_code = config_store_commit(1);
+      if(NRF_SUCCESS != err_code)
+      {
+        // Likely out of space, changes stay pending until next commit
+        NRF_LOG_WARNING("Error in flash write %X\r\n", err_code);
+        break;
+      }
+      if(config_store_pending() && scheduler_budget_exceeded())
+      {
+        scheduler_continue(NULL, 0);
+        return;
+      }
+    }
+    size_t flash_space_remaining = 0;
+    flash_free_size_get(&flash_space_remaining);
+    NRF_LOG_INFO("Stored configuration in flash, Largest continuous space remaining %d bytes\r\n", flash_space_remaining);
+    if(CONFIG_STORE_GC_THRESHOLD <= flash_space_remaining) { return; }
+    step = COMMIT_GC;
+    if(scheduler_budget_exceeded())
+    {
+      scheduler_continue(&step, sizeof(step));
+      return;
+    }
+  }
+  NRF_LOG_INFO("Flash space is almost used, running gc\r\n");
+  flash_gc_run();
+}
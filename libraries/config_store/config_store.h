@@ -0,0 +1,136 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+/**
+ *  Typed runtime configuration with defaults, persisted in flash.
+ *
+ *  Application describes its tunables in a table of items: ID, type, default value and
+ *  allowed range, optionally narrowed to a set of allowed values. Values are read with config_store_get() and changed with
+ *  config_store_set(), which calls the change handler of application so that new value
+ *  takes effect right away. Changes are kept in RAM until committed, a batch of changes
+ *  is written by one commit.
+ *
+ *  Only changed values are persisted, one FDS record per item whose value differs from
+ *  its default or which has a record already. Commit writes only items changed since
+ *  last commit. Records have a layout version, type of item and CRC32; a record of other
+ *  layout or type, a value out of range of current table or a corrupted record is
+ *  ignored and the item has its default value. Items may be added to and removed from
+ *  the table in later firmware as long as ID of an item is not reused for another type.
+ *
+ *  Flash must be initialised with flash_init() before config_store_init(). Commits run
+ *  as background tasks of scheduler, see config_store_commit_task().
+ *
+ *  License: BSD-3
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdk_errors.h"
+
+/** FDS file of configuration records, record key is ID of item + 1 */
+#define CONFIG_STORE_FILE_ID   0x0C0F
+/** Layout of records, records of other versions are not loaded */
+#define CONFIG_STORE_VERSION   1
+/** Largest number of items */
+#define CONFIG_STORE_MAX_ITEMS 32
+/** ID which refers to all items */
+#define CONFIG_STORE_ALL       0xFF
+
+/** Types of items, same values as ruuvi_message_type_t */
+typedef enum {
+  CONFIG_TYPE_UINT8  = 0x80,
+  CONFIG_TYPE_INT8   = 0x81,
+  CONFIG_TYPE_UINT16 = 0x82,
+  CONFIG_TYPE_INT16  = 0x83,
+  CONFIG_TYPE_UINT32 = 0x84,
+  CONFIG_TYPE_INT32  = 0x85
+}config_type_t;
+
+typedef struct {
+  uint8_t id;              /**< 0 ... 254, unique in table */
+  uint8_t type;            /**< config_type_t */
+  int32_t default_value;
+  int32_t min;             /**< Allowed range, within range of type. UINT32 items are limited to INT32_MAX */
+  int32_t max;
+  bool    secret;          /**< Write-only over CONFIG endpoint, e.g. keys. Value is never sent */
+  bool    read_only;       /**< Read-only over CONFIG endpoint, e.g. counters. Set only by application */
+  const int32_t* p_values; /**< Allowed values within range, e.g. TX powers of radio. NULL allows all */
+  uint8_t value_count;     /**< Number of allowed values */
+}config_item_t;
+
+/**
+ *  Called when value of an item changes, in context of config_store_set(). Called with ID
+ *  CONFIG_STORE_ALL and value 0 as a batch of changes is complete, see
+ *  config_store_batch_complete(). Values which only make sense together, e.g. words of a
+ *  key, are applied then.
+ */
+typedef void(*config_store_change_handler_t)(uint8_t id, int32_t value);
+
+/** State of an item, see config_store_flags() */
+#define CONFIG_STORE_FLAG_PENDING 0x01   /**< Changed since last commit */
+#define CONFIG_STORE_FLAG_STORED  0x02   /**< Has a record in flash */
+#define CONFIG_STORE_FLAG_DEFAULT 0x04   /**< Value is default value */
+#define CONFIG_STORE_FLAG_SECRET  0x08   /**< Item is secret, value is not sent */
+#define CONFIG_STORE_FLAG_READ_ONLY 0x10 /**< Item cannot be changed over endpoint */
+
+/**
+ *  Load values of items from flash.
+ *
+ *  @param p_items table of items, must stay valid
+ *  @param count   number of items, at most CONFIG_STORE_MAX_ITEMS
+ *  @param handler called on changes, may be NULL. Not called for loaded values.
+ *  @return NRF_SUCCESS, NRF_ERROR_NULL or NRF_ERROR_INVALID_PARAM on invalid table
+ */
+ret_code_t config_store_init(const config_item_t* p_items, uint8_t count, config_store_change_handler_t handler);
+
+/** Return value of item, 0 if there is no such item */
+int32_t config_store_get(uint8_t id);
+
+/**
+ *  Change value of item. Change is kept in RAM until committed.
+ *
+ *  @return NRF_SUCCESS, also if value did not change
+ *  @return NRF_ERROR_NOT_FOUND if there is no such item
+ *  @return NRF_ERROR_INVALID_PARAM if value is out of range of item or not one of its values
+ */
+ret_code_t config_store_set(uint8_t id, int32_t value);
+
+/** Return item of ID, NULL if there is no such item */
+const config_item_t* config_store_item(uint8_t id);
+
+/** Return item at index of table, NULL past the end */
+const config_item_t* config_store_item_at(uint8_t index);
+
+/** Return number of items */
+uint8_t config_store_count(void);
+
+/** Return CONFIG_STORE_FLAG_* of item, 0 if there is no such item */
+uint8_t config_store_flags(uint8_t id);
+
+/** Return number of items changed since last commit */
+uint8_t config_store_pending(void);
+
+/** Return number of items which have a record in flash */
+uint8_t config_store_stored(void);
+
+/** Tell change handler that a batch of changes is complete, e.g. on commit of endpoint */
+void config_store_batch_complete(void);
+
+/**
+ *  Write changed items to flash.
+ *
+ *  @param max_writes largest number of records to write, 0 for all
+ *  @return NRF_SUCCESS, items left pending are written by next commit
+ *  @return error of flash_record_set(), item stays pending
+ */
+ret_code_t config_store_commit(uint8_t max_writes);
+
+/**
+ *  Background task of scheduler which commits all changes and runs garbage collection of
+ *  flash once free space runs low. Continues itself if budget of background tasks is used.
+ *  Queue with data NULL, e.g. scheduler_event_put(NULL, 0, config_store_commit_task,
+ *  SCHEDULER_PRIORITY_BACKGROUND).
+ */
+void config_store_commit_task(void* p_data, uint16_t length);
+
+#endif
@@ -0,0 +1,125 @@
+#include "config_store_handler.h"
+#include "config_store.h"
+#include "scheduler.h"
+
+#include <string.h>
+
+#define NRF_LOG_MODULE_NAME "CONFIG_HANDLER"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+static void put_int32(uint8_t* p_buffer, int32_t value)
+{
+  uint32_t bits = (uint32_t)value;
+  for(uint8_t ii = 0; ii < 4; ii++) { p_buffer[ii] = (bits >> (8 * ii)) & 0xFF; }
+}
+
+static int32_t get_int32(const uint8_t* p_buffer)
+{
+  uint32_t bits = 0;
+  for(uint8_t ii = 0; ii < 4; ii++) { bits |= (uint32_t)p_buffer[ii] << (8 * ii); }
+  return (int32_t)bits;
+}
+
+static ret_code_t transmit(const ruuvi_standard_message_t reply)
+{
+  message_handler p_reply_handler = get_reply_handler();
+  if(NULL == p_reply_handler) { return ENDPOINT_HANDLER_ERROR; }
+  return p_reply_handler(reply);
+}
+
+static ret_code_t error(const ruuvi_standard_message_t message, uint8_t id)
+{
+  ruuvi_standard_message_t reply = { .destination_endpoint = message.source_endpoint,
+                                     .source_endpoint      = CONFIG,
+                                     .type                 = ERROR,
+                                     .payload              = {0}};
+  reply.payload[0] = id;
+  return transmit(reply);
+}
+
+static ret_code_t store_status(const ruuvi_standard_message_t message)
+{
+  ruuvi_standard_message_t reply = { .destination_endpoint = message.source_endpoint,
+                                     .source_endpoint      = CONFIG,
+                                     .type                 = UINT8,
+                                     .payload              = {0}};
+  reply.payload[0] = config_store_count();
+  reply.payload[1] = config_store_pending();
+  reply.payload[2] = config_store_stored();
+  reply.payload[3] = CONFIG_STORE_VERSION;
+  return transmit(reply);
+}
+
+static ret_code_t item_value(const ruuvi_standard_message_t message, const config_item_t* p_item)
+{
+  ruuvi_standard_message_t reply = { .destination_endpoint = message.source_endpoint,
+                                     .source_endpoint      = CONFIG,
+                                     .type                 = INT32,
+                                     .payload              = {0}};
+  reply.payload[0] = p_item->id;
+  reply.payload[1] = p_item->type;
+  reply.payload[2] = config_store_flags(p_item->id);
+  // Secret items can be written but not read back, reply tells only whether value is default
+  if(!p_item->secret) { put_int32(&reply.payload[4], config_store_get(p_item->id)); }
+  return transmit(reply);
+}
+
+static ret_code_t data_query(const ruuvi_standard_message_t message)
+{
+  ret_code_t err_code = ENDPOINT_SUCCESS;
+  uint8_t id = message.payload[0];
+  if(CONFIG_STORE_ALL == id)
+  {
+    for(uint8_t ii = 0; ii < config_store_count(); ii++)
+    {
+      err_code |= item_value(message, config_store_item_at(ii));
+    }
+    return err_code;
+  }
+  const config_item_t* p_item = config_store_item(id);
+  if(NULL == p_item) { return error(message, id); }
+  return item_value(message, p_item);
+}
+
+static ret_code_t configure(const ruuvi_standard_message_t message)
+{
+  ret_code_t err_code = ENDPOINT_SUCCESS;
+  uint8_t id = message.payload[0];
+  if(CONFIG_STORE_ALL != id)
+  {
+    const config_item_t* p_item = config_store_item(id);
+    if(NULL == p_item || p_item->read_only) { return error(message, id); }
+    if(NRF_SUCCESS != config_store_set(id, get_int32(&message.payload[4]))) { return error(message, id); }
+    err_code |= item_value(message, config_store_item(id));
+  }
+  if(!(CONFIG_STORE_HANDLER_COMMIT & message.payload[1])) { return err_code; }
+  config_store_batch_complete();
+  // Flash is written in background, replies are sent before it
+  if(config_store_pending())
+  {
+    NRF_LOG_INFO("Committing %d changes\r\n", config_store_pending());
+    err_code |= scheduler_event_put(NULL, 0, config_store_commit_task, SCHEDULER_PRIORITY_BACKGROUND);
+  }
+  return err_code;
+}
+
+ret_code_t config_store_handler(const ruuvi_standard_message_t message)
+{
+  if(CONFIG != message.destination_endpoint) { return ENDPOINT_INVALID; }
+  NRF_LOG_DEBUG("Configuration message %d\r\n", message.type);
+  switch(message.type)
+  {
+    case STATUS_QUERY:
+      return store_status(message);
+
+    case DATA_QUERY:
+      return data_query(message);
+
+    case SENSOR_CONFIGURATION:
+      return configure(message);
+
+    default:
+      return unknown_handler(message);
+  }
+}
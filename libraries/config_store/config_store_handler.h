@@ -0,0 +1,31 @@
+#ifndef CONFIG_STORE_HANDLER_H
+#define CONFIG_STORE_HANDLER_H
+
+/**
+ *  Endpoint for reading and changing runtime configuration, registered with
+ *  set_config_handler(). Values are little endian.
+ *
+ *  STATUS_QUERY returns one message of the whole store, type UINT8:
+ *    [0] items, [1] pending changes, [2] items stored in flash, [3] CONFIG_STORE_VERSION
+ *
+ *  DATA_QUERY with payload[0] as item ID, CONFIG_STORE_ALL for all items, returns one
+ *  message per item, type INT32:
+ *    [0] ID, [1] type of item, [2] CONFIG_STORE_FLAG_*, [3] 0, [4..7] value
+ *
+ *  SENSOR_CONFIGURATION with [0] ID, [1] CONFIG_STORE_HANDLER_COMMIT or 0, [4..7] value
+ *  changes value of item and returns it as DATA_QUERY does. Changes are kept in RAM and
+ *  a batch of them is written to flash by the last one with CONFIG_STORE_HANDLER_COMMIT,
+ *  which also completes the batch for change handler, see config_store_batch_complete().
+ *  ID CONFIG_STORE_ALL commits without a change. Invalid ID, read-only item or value which
+ *  is not allowed returns ERROR with [0] ID and is not stored.
+ */
+
+#include "ruuvi_endpoints.h"
+#include "sdk_errors.h"
+
+/** Flag of SENSOR_CONFIGURATION, write pending changes to flash */
+#define CONFIG_STORE_HANDLER_COMMIT 0x01
+
+ret_code_t config_store_handler(const ruuvi_standard_message_t message);
+
+#endif
@@ -0,0 +1,502 @@
+#include "crypto_bench.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "occ_chacha20_poly1305.h"
+#include "occ_curve25519.h"
+#include "occ_ecdh_p256.h"
+#include "occ_ecdsa_p256.h"
+#include "occ_ed25519.h"
+#include "occ_hkdf_sha256.h"
+#include "occ_hmac_sha256.h"
+#include "occ_sha256.h"
+#include "occ_sha512.h"
+#include "occ_srp.h"
+
+/** Bytes of message in timed runs of hashes and AEAD, a few advertisements or a DFU chunk */
+#define BENCH_MESSAGE_LENGTH 256
+/**
+ *  Bytes of hkdf_okm derived by known-answer test. occ documents at most one block,
+ *  implementations with the full expand of RFC 5869 check all of L = 42.
+ */
+#ifndef CRYPTO_BENCH_HKDF_LENGTH
+  #define CRYPTO_BENCH_HKDF_LENGTH occ_hkdf_sha256_LENGTH_MAX
+#endif
+
+/** FIPS 180-2, message "abc" */
+static const uint8_t sha256_abc[occ_sha256_BYTES] = {
+  0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+  0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+};
+static const uint8_t sha512_abc[occ_sha512_BYTES] = {
+  0xdd, 0xaf, 0x35, 0xa1, 0x93, 0x61, 0x7a, 0xba, 0xcc, 0x41, 0x73, 0x49, 0xae, 0x20, 0x41, 0x31,
+  0x12, 0xe6, 0xfa, 0x4e, 0x89, 0xa9, 0x7e, 0xa2, 0x0a, 0x9e, 0xee, 0xe6, 0x4b, 0x55, 0xd3, 0x9a,
+  0x21, 0x92, 0x99, 0x2a, 0x27, 0x4f, 0xc1, 0xa8, 0x36, 0xba, 0x3c, 0x23, 0xa3, 0xfe, 0xeb, 0xbd,
+  0x45, 0x4d, 0x44, 0x23, 0x64, 0x3c, 0xe8, 0x0e, 0x2a, 0x9a, 0xc9, 0x4f, 0xa5, 0x4c, 0xa4, 0x9f
+};
+
+/** RFC 4231 test case 2, key "Jefe" and message "what do ya want for nothing?" */
+static const uint8_t hmac_sha256_jefe[occ_hmac_sha256_BYTES] = {
+  0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+  0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83, 0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43
+};
+
+/** RFC 5869 test case 1, L = 42 */
+static const uint8_t hkdf_salt[13] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c
+};
+static const uint8_t hkdf_info[10] = {
+  0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9
+};
+static const uint8_t hkdf_okm[42] = {
+  0x3c, 0xb2, 0x5f, 0x25, 0xfa, 0xac, 0xd5, 0x7a, 0x90, 0x43, 0x4f, 0x64, 0xd0, 0x36, 0x2f, 0x2a,
+  0x2d, 0x2d, 0x0a, 0x90, 0xcf, 0x1a, 0x5a, 0x4c, 0x5d, 0xb0, 0x2d, 0x56, 0xec, 0xc4, 0xc5, 0xbf,
+  0x34, 0x00, 0x72, 0x08, 0xd5, 0xb8, 0x87, 0x18, 0x58, 0x65
+};
+
+/** RFC 8439 section 2.8.2 */
+static const uint8_t aead_key[occ_chacha20_poly1305_KEY_BYTES] = {
+  0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+  0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f
+};
+static const uint8_t aead_nonce[12] = {
+  0x07, 0x00, 0x00, 0x00, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47
+};
+static const uint8_t aead_aad[12] = {
+  0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7
+};
+static const uint8_t aead_ciphertext[114] = {
+  0xd3, 0x1a, 0x8d, 0x34, 0x64, 0x8e, 0x60, 0xdb, 0x7b, 0x86, 0xaf, 0xbc, 0x53, 0xef, 0x7e, 0xc2,
+  0xa4, 0xad, 0xed, 0x51, 0x29, 0x6e, 0x08, 0xfe, 0xa9, 0xe2, 0xb5, 0xa7, 0x36, 0xee, 0x62, 0xd6,
+  0x3d, 0xbe, 0xa4, 0x5e, 0x8c, 0xa9, 0x67, 0x12, 0x82, 0xfa, 0xfb, 0x69, 0xda, 0x92, 0x72, 0x8b,
+  0x1a, 0x71, 0xde, 0x0a, 0x9e, 0x06, 0x0b, 0x29, 0x05, 0xd6, 0xa5, 0xb6, 0x7e, 0xcd, 0x3b, 0x36,
+  0x92, 0xdd, 0xbd, 0x7f, 0x2d, 0x77, 0x8b, 0x8c, 0x98, 0x03, 0xae, 0xe3, 0x28, 0x09, 0x1b, 0x58,
+  0xfa, 0xb3, 0x24, 0xe4, 0xfa, 0xd6, 0x75, 0x94, 0x55, 0x85, 0x80, 0x8b, 0x48, 0x31, 0xd7, 0xbc,
+  0x3f, 0xf4, 0xde, 0xf0, 0x8e, 0x4b, 0x7a, 0x9d, 0xe5, 0x76, 0xd2, 0x65, 0x86, 0xce, 0xc6, 0x4b,
+  0x61, 0x16
+};
+static const uint8_t aead_tag[occ_chacha20_poly1305_TAG_BYTES] = {
+  0x1a, 0xe1, 0x0b, 0x59, 0x4f, 0x09, 0xe2, 0x6a, 0x7e, 0x90, 0x2e, 0xcb, 0xd0, 0x60, 0x06, 0x91
+};
+
+/** RFC 7748 section 6.1 */
+static const uint8_t x25519_alice_private[occ_curve25519_SCALAR_BYTES] = {
+  0x77, 0x07, 0x6d, 0x0a, 0x73, 0x18, 0xa5, 0x7d, 0x3c, 0x16, 0xc1, 0x72, 0x51, 0xb2, 0x66, 0x45,
+  0xdf, 0x4c, 0x2f, 0x87, 0xeb, 0xc0, 0x99, 0x2a, 0xb1, 0x77, 0xfb, 0xa5, 0x1d, 0xb9, 0x2c, 0x2a
+};
+static const uint8_t x25519_alice_public[occ_curve25519_BYTES] = {
+  0x85, 0x20, 0xf0, 0x09, 0x89, 0x30, 0xa7, 0x54, 0x74, 0x8b, 0x7d, 0xdc, 0xb4, 0x3e, 0xf7, 0x5a,
+  0x0d, 0xbf, 0x3a, 0x0d, 0x26, 0x38, 0x1a, 0xf4, 0xeb, 0xa4, 0xa9, 0x8e, 0xaa, 0x9b, 0x4e, 0x6a
+};
+static const uint8_t x25519_bob_private[occ_curve25519_SCALAR_BYTES] = {
+  0x5d, 0xab, 0x08, 0x7e, 0x62, 0x4a, 0x8a, 0x4b, 0x79, 0xe1, 0x7f, 0x8b, 0x83, 0x80, 0x0e, 0xe6,
+  0x6f, 0x3b, 0xb1, 0x29, 0x26, 0x18, 0xb6, 0xfd, 0x1c, 0x2f, 0x8b, 0x27, 0xff, 0x88, 0xe0, 0xeb
+};
+static const uint8_t x25519_bob_public[occ_curve25519_BYTES] = {
+  0xde, 0x9e, 0xdb, 0x7d, 0x7b, 0x7d, 0xc1, 0xb4, 0xd3, 0x5b, 0x61, 0xc2, 0xec, 0xe4, 0x35, 0x37,
+  0x3f, 0x83, 0x43, 0xc8, 0x5b, 0x78, 0x67, 0x4d, 0xad, 0xfc, 0x7e, 0x14, 0x6f, 0x88, 0x2b, 0x4f
+};
+static const uint8_t x25519_shared[occ_curve25519_BYTES] = {
+  0x4a, 0x5d, 0x9d, 0x5b, 0xa4, 0xce, 0x2d, 0xe1, 0x72, 0x8e, 0x3b, 0xf4, 0x80, 0x35, 0x0f, 0x25,
+  0xe0, 0x7e, 0x21, 0xc9, 0x47, 0xd1, 0x9e, 0x33, 0x76, 0xf0, 0x9b, 0x3c, 0x1e, 0x16, 0x17, 0x42
+};
+
+/** RFC 8032 section 7.1 test 1, empty message */
+static const uint8_t ed25519_secret[occ_ed25519_SECRET_KEY_BYTES] = {
+  0x9d, 0x61, 0xb1, 0x9d, 0xef, 0xfd, 0x5a, 0x60, 0xba, 0x84, 0x4a, 0xf4, 0x92, 0xec, 0x2c, 0xc4,
+  0x44, 0x49, 0xc5, 0x69, 0x7b, 0x32, 0x69, 0x19, 0x70, 0x3b, 0xac, 0x03, 0x1c, 0xae, 0x7f, 0x60
+};
+static const uint8_t ed25519_public[occ_ed25519_PUBLIC_KEY_BYTES] = {
+  0xd7, 0x5a, 0x98, 0x01, 0x82, 0xb1, 0x0a, 0xb7, 0xd5, 0x4b, 0xfe, 0xd3, 0xc9, 0x64, 0x07, 0x3a,
+  0x0e, 0xe1, 0x72, 0xf3, 0xda, 0xa6, 0x23, 0x25, 0xaf, 0x02, 0x1a, 0x68, 0xf7, 0x07, 0x51, 0x1a
+};
+static const uint8_t ed25519_signature[occ_ed25519_BYTES] = {
+  0xe5, 0x56, 0x43, 0x00, 0xc3, 0x60, 0xac, 0x72, 0x90, 0x86, 0xe2, 0xcc, 0x80, 0x6e, 0x82, 0x8a,
+  0x84, 0x87, 0x7f, 0x1e, 0xb8, 0xe5, 0xd9, 0x74, 0xd8, 0x73, 0xe0, 0x65, 0x22, 0x49, 0x01, 0x55,
+  0x5f, 0xb8, 0x82, 0x15, 0x90, 0xa3, 0x3b, 0xac, 0xc6, 0x1e, 0x39, 0x70, 0x1c, 0xf9, 0xb4, 0x6b,
+  0xd2, 0x5b, 0xf5, 0xf0, 0x59, 0x5b, 0xbe, 0x24, 0x65, 0x51, 0x41, 0x43, 0x8e, 0x7a, 0x10, 0x0b
+};
+
+/** Base point G of P-256 and 2G, SEC 2 */
+static const uint8_t p256_g[64] = {
+  0x6b, 0x17, 0xd1, 0xf2, 0xe1, 0x2c, 0x42, 0x47, 0xf8, 0xbc, 0xe6, 0xe5, 0x63, 0xa4, 0x40, 0xf2,
+  0x77, 0x03, 0x7d, 0x81, 0x2d, 0xeb, 0x33, 0xa0, 0xf4, 0xa1, 0x39, 0x45, 0xd8, 0x98, 0xc2, 0x96,
+  0x4f, 0xe3, 0x42, 0xe2, 0xfe, 0x1a, 0x7f, 0x9b, 0x8e, 0xe7, 0xeb, 0x4a, 0x7c, 0x0f, 0x9e, 0x16,
+  0x2b, 0xce, 0x33, 0x57, 0x6b, 0x31, 0x5e, 0xce, 0xcb, 0xb6, 0x40, 0x68, 0x37, 0xbf, 0x51, 0xf5
+};
+static const uint8_t p256_2g[64] = {
+  0x7c, 0xf2, 0x7b, 0x18, 0x8d, 0x03, 0x4f, 0x7e, 0x8a, 0x52, 0x38, 0x03, 0x04, 0xb5, 0x1a, 0xc3,
+  0xc0, 0x89, 0x69, 0xe2, 0x77, 0xf2, 0x1b, 0x35, 0xa6, 0x0b, 0x48, 0xfc, 0x47, 0x66, 0x99, 0x78,
+  0x07, 0x77, 0x55, 0x10, 0xdb, 0x8e, 0xd0, 0x40, 0x29, 0x3d, 0x9a, 0xc6, 0x9f, 0x74, 0x30, 0xdb,
+  0xba, 0x7d, 0xad, 0xe6, 0x3c, 0xe9, 0x82, 0x29, 0x9e, 0x04, 0xb7, 0x9d, 0x22, 0x78, 0x73, 0xd1
+};
+
+/** RFC 6979 appendix A.2.5, SHA-256 and message "sample" */
+static const uint8_t ecdsa_secret[32] = {
+  0xc9, 0xaf, 0xa9, 0xd8, 0x45, 0xba, 0x75, 0x16, 0x6b, 0x5c, 0x21, 0x57, 0x67, 0xb1, 0xd6, 0x93,
+  0x4e, 0x50, 0xc3, 0xdb, 0x36, 0xe8, 0x9b, 0x12, 0x7b, 0x8a, 0x62, 0x2b, 0x12, 0x0f, 0x67, 0x21
+};
+static const uint8_t ecdsa_public[64] = {
+  0x60, 0xfe, 0xd4, 0xba, 0x25, 0x5a, 0x9d, 0x31, 0xc9, 0x61, 0xeb, 0x74, 0xc6, 0x35, 0x6d, 0x68,
+  0xc0, 0x49, 0xb8, 0x92, 0x3b, 0x61, 0xfa, 0x6c, 0xe6, 0x69, 0x62, 0x2e, 0x60, 0xf2, 0x9f, 0xb6,
+  0x79, 0x03, 0xfe, 0x10, 0x08, 0xb8, 0xbc, 0x99, 0xa4, 0x1a, 0xe9, 0xe9, 0x56, 0x28, 0xbc, 0x64,
+  0xf2, 0xf1, 0xb2, 0x0c, 0x2d, 0x7e, 0x9f, 0x51, 0x77, 0xa3, 0xc2, 0x94, 0xd4, 0x46, 0x22, 0x99
+};
+static const uint8_t ecdsa_k[32] = {
+  0xa6, 0xe3, 0xc5, 0x7d, 0xd0, 0x1a, 0xbe, 0x90, 0x08, 0x65, 0x38, 0x39, 0x83, 0x55, 0xdd, 0x4c,
+  0x3b, 0x17, 0xaa, 0x87, 0x33, 0x82, 0xb0, 0xf2, 0x4d, 0x61, 0x29, 0x49, 0x3d, 0x8a, 0xad, 0x60
+};
+static const uint8_t ecdsa_signature[64] = {
+  0xef, 0xd4, 0x8b, 0x2a, 0xac, 0xb6, 0xa8, 0xfd, 0x11, 0x40, 0xdd, 0x9c, 0xd4, 0x5e, 0x81, 0xd6,
+  0x9d, 0x2c, 0x87, 0x7b, 0x56, 0xaa, 0xf9, 0x91, 0xc3, 0x4d, 0x0e, 0xa8, 0x4e, 0xaf, 0x37, 0x16,
+  0xf7, 0xcb, 0x1c, 0x94, 0x2d, 0x65, 0x7c, 0x41, 0xd4, 0x36, 0xc7, 0xa1, 0xb6, 0xe2, 0x9f, 0x65,
+  0xf3, 0xe9, 0x00, 0xdb, 0xb9, 0xaf, 0xf4, 0x06, 0x4d, 0xc4, 0xab, 0x2f, 0x84, 0x3a, 0xcd, 0xa8
+};
+
+static const char aead_plaintext[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the "
+                                     "future, sunscreen would be it.";
+
+/** Input of timed runs */
+static uint8_t message[BENCH_MESSAGE_LENGTH];
+static uint8_t output[BENCH_MESSAGE_LENGTH];
+static uint8_t tag[occ_chacha20_poly1305_TAG_BYTES];
+static uint8_t signature[occ_ed25519_BYTES];
+static uint8_t point[64];
+
+/** SRP numbers must be 32 bit aligned */
+static uint32_t srp_v[occ_srp_VERIFIER_BYTES / 4];
+static uint32_t srp_pub_a[occ_srp_PUBLIC_KEY_BYTES / 4];
+static uint32_t srp_pub_b[occ_srp_PUBLIC_KEY_BYTES / 4];
+static uint32_t srp_s[occ_srp_PREMASTER_SECRET_BYTES / 4];
+static const uint8_t srp_salt[occ_srp_SALT_BYTES] = { 0xbe, 0xb2, 0x53, 0x79, 0xd1, 0xa8, 0x58, 0x1e,
+                                                      0xb5, 0xa7, 0x27, 0x67, 0x3a, 0x24, 0x41, 0xee };
+static const char srp_user[] = "Pair-Setup";
+static const char srp_pass[] = "111-22-333";
+
+static bool sha256_kat(void)
+{
+  uint8_t r[occ_sha256_BYTES];
+  occ_sha256(r, (const uint8_t*)"abc", 3);
+  return 0 == memcmp(r, sha256_abc, sizeof(r));
+}
+
+static void sha256_run(void)
+{
+  occ_sha256(output, message, sizeof(message));
+}
+
+static bool sha512_kat(void)
+{
+  uint8_t r[occ_sha512_BYTES];
+  occ_sha512(r, (const uint8_t*)"abc", 3);
+  return 0 == memcmp(r, sha512_abc, sizeof(r));
+}
+
+static void sha512_run(void)
+{
+  occ_sha512(output, message, sizeof(message));
+}
+
+static bool hmac_sha256_kat(void)
+{
+  uint8_t r[occ_hmac_sha256_BYTES];
+  const char text[] = "what do ya want for nothing?";
+  occ_hmac_sha256(r, (const uint8_t*)"Jefe", 4, (const uint8_t*)text, sizeof(text) - 1);
+  return 0 == memcmp(r, hmac_sha256_jefe, sizeof(r));
+}
+
+/** Tag of one advertisement, 32 byte key */
+static void hmac_sha256_run(void)
+{
+  occ_hmac_sha256(output, aead_key, sizeof(aead_key), message, 32);
+}
+
+static bool hkdf_sha256_kat(void)
+{
+  uint8_t ikm[22];
+  uint8_t r[CRYPTO_BENCH_HKDF_LENGTH];
+  memset(ikm, 0x0b, sizeof(ikm));
+  occ_hkdf_sha256(r, sizeof(r), ikm, sizeof(ikm), hkdf_salt, sizeof(hkdf_salt), hkdf_info, sizeof(hkdf_info));
+  return 0 == memcmp(r, hkdf_okm, sizeof(r));
+}
+
+/** Session key from a shared secret */
+static void hkdf_sha256_run(void)
+{
+  occ_hkdf_sha256(output, 32, message, 32, hkdf_salt, sizeof(hkdf_salt), hkdf_info, sizeof(hkdf_info));
+}
+
+static bool chacha20_poly1305_kat(void)
+{
+  uint8_t c[sizeof(aead_ciphertext)];
+  uint8_t m[sizeof(aead_ciphertext)];
+  uint8_t t[occ_chacha20_poly1305_TAG_BYTES];
+  bool passed = true;
+  occ_chacha20_poly1305_encrypt_aad(t, c, (const uint8_t*)aead_plaintext, sizeof(c), aead_aad, sizeof(aead_aad),
+                                    aead_nonce, sizeof(aead_nonce), aead_key);
+  passed &= (0 == memcmp(c, aead_ciphertext, sizeof(c)));
+  passed &= (0 == memcmp(t, aead_tag, sizeof(t)));
+  passed &= (0 == occ_chacha20_poly1305_decrypt_aad(t, m, c, sizeof(c), aead_aad, sizeof(aead_aad),
+                                                    aead_nonce, sizeof(aead_nonce), aead_key));
+  passed &= (0 == memcmp(m, aead_plaintext, sizeof(m)));
+  c[0] ^= 0x01;
+  passed &= (0 != occ_chacha20_poly1305_decrypt_aad(t, m, c, sizeof(c), aead_aad, sizeof(aead_aad),
+                                                    aead_nonce, sizeof(aead_nonce), aead_key));
+  return passed;
+}
+
+static void chacha20_poly1305_run(void)
+{
+  occ_chacha20_poly1305_encrypt(tag, output, message, sizeof(message), aead_nonce, sizeof(aead_nonce), aead_key);
+}
+
+static bool curve25519_kat(void)
+{
+  uint8_t r[occ_curve25519_BYTES];
+  bool passed = true;
+  occ_curve25519_scalarmult_base(r, x25519_alice_private);
+  passed &= (0 == memcmp(r, x25519_alice_public, sizeof(r)));
+  occ_curve25519_scalarmult_base(r, x25519_bob_private);
+  passed &= (0 == memcmp(r, x25519_bob_public, sizeof(r)));
+  occ_curve25519_scalarmult(r, x25519_alice_private, x25519_bob_public);
+  passed &= (0 == memcmp(r, x25519_shared, sizeof(r)));
+  occ_curve25519_scalarmult(r, x25519_bob_private, x25519_alice_public);
+  passed &= (0 == memcmp(r, x25519_shared, sizeof(r)));
+  return passed;
+}
+
+/** Shared secret of a key exchange, as EID registration does */
+static void curve25519_run(void)
+{
+  occ_curve25519_scalarmult(output, x25519_alice_private, x25519_bob_public);
+}
+
+static bool ed25519_sign_kat(void)
+{
+  uint8_t pk[occ_ed25519_PUBLIC_KEY_BYTES];
+  uint8_t sig[occ_ed25519_BYTES];
+  occ_ed25519_public_key(pk, ed25519_secret);
+  occ_ed25519_sign(sig, NULL, 0, ed25519_secret, ed25519_public);
+  return 0 == memcmp(pk, ed25519_public, sizeof(pk)) && 0 == memcmp(sig, ed25519_signature, sizeof(sig));
+}
+
+static void ed25519_sign_run(void)
+{
+  occ_ed25519_sign(signature, message, 32, ed25519_secret, ed25519_public);
+}
+
+static bool ed25519_verify_kat(void)
+{
+  uint8_t sig[occ_ed25519_BYTES];
+  bool passed = (0 == occ_ed25519_verify(ed25519_signature, NULL, 0, ed25519_public));
+  memcpy(sig, ed25519_signature, sizeof(sig));
+  sig[10] ^= 0x40;
+  passed &= (0 != occ_ed25519_verify(sig, NULL, 0, ed25519_public));
+  // Signature of timed runs
+  occ_ed25519_sign(signature, message, 32, ed25519_secret, ed25519_public);
+  return passed;
+}
+
+static void ed25519_verify_run(void)
+{
+  occ_ed25519_verify(signature, message, 32, ed25519_public);
+}
+
+static bool ecdh_p256_kat(void)
+{
+  uint8_t s[32] = {0};
+  uint8_t r[64];
+  bool passed = true;
+  s[31] = 1;
+  passed &= (0 == occ_ecdh_p256_public_key(r, s));
+  passed &= (0 == memcmp(r, p256_g, sizeof(r)));
+  s[31] = 2;
+  passed &= (0 == occ_ecdh_p256_public_key(r, s));
+  passed &= (0 == memcmp(r, p256_2g, sizeof(r)));
+  // 2 * (1 * G) == 1 * (2 * G)
+  passed &= (0 == occ_ecdh_p256_common_secret(r, s, p256_g));
+  passed &= (0 == memcmp(r, p256_2g, sizeof(r)));
+  memset(s, 0, sizeof(s));
+  passed &= (0 != occ_ecdh_p256_public_key(r, s));
+  return passed;
+}
+
+static void ecdh_p256_run(void)
+{
+  occ_ecdh_p256_common_secret(point, ecdsa_secret, ecdsa_public);
+}
+
+static bool ecdsa_p256_sign_kat(void)
+{
+  uint8_t pk[64];
+  uint8_t sig[64];
+  bool passed = (0 == occ_ecdsa_p256_public_key(pk, ecdsa_secret));
+  passed &= (0 == memcmp(pk, ecdsa_public, sizeof(pk)));
+  passed &= (0 == occ_ecdsa_p256_sign(sig, (const uint8_t*)"sample", 6, ecdsa_secret, ecdsa_k));
+  passed &= (0 == memcmp(sig, ecdsa_signature, sizeof(sig)));
+  return passed;
+}
+
+static void ecdsa_p256_sign_run(void)
+{
+  occ_ecdsa_p256_sign(point, message, 32, ecdsa_secret, ecdsa_k);
+}
+
+static bool ecdsa_p256_verify_kat(void)
+{
+  uint8_t sig[64];
+  bool passed = (0 == occ_ecdsa_p256_verify(ecdsa_signature, (const uint8_t*)"sample", 6, ecdsa_public));
+  passed &= (0 != occ_ecdsa_p256_verify(ecdsa_signature, (const uint8_t*)"sampld", 6, ecdsa_public));
+  memcpy(sig, ecdsa_signature, sizeof(sig));
+  sig[40] ^= 0x02;
+  passed &= (0 != occ_ecdsa_p256_verify(sig, (const uint8_t*)"sample", 6, ecdsa_public));
+  // Signature of timed runs
+  passed &= (0 == occ_ecdsa_p256_sign(point, message, 32, ecdsa_secret, ecdsa_k));
+  return passed;
+}
+
+static void ecdsa_p256_verify_run(void)
+{
+  occ_ecdsa_p256_verify(point, message, 32, ecdsa_public);
+}
+
+static bool srp_verifier_kat(void)
+{
+  uint32_t other[occ_srp_VERIFIER_BYTES / 4];
+  uint8_t* p_v = (uint8_t*)srp_v;
+  occ_srp_verifier(p_v, srp_salt, (const uint8_t*)srp_user, sizeof(srp_user) - 1,
+                   (const uint8_t*)srp_pass, sizeof(srp_pass) - 1);
+  occ_srp_verifier((uint8_t*)other, srp_salt, (const uint8_t*)srp_user, sizeof(srp_user) - 1,
+                   (const uint8_t*)srp_pass, sizeof(srp_pass) - 2);
+  bool zero = true;
+  for(size_t ii = 0; ii < sizeof(srp_v); ii++) { zero &= (0 == p_v[ii]); }
+  return !zero && 0 != memcmp(other, srp_v, sizeof(other));
+}
+
+/** Setup code to verifier, once per pairing setup */
+static void srp_verifier_run(void)
+{
+  occ_srp_verifier((uint8_t*)srp_v, srp_salt, (const uint8_t*)srp_user, sizeof(srp_user) - 1,
+                   (const uint8_t*)srp_pass, sizeof(srp_pass) - 1);
+}
+
+static bool srp_public_key_kat(void)
+{
+  uint32_t other[occ_srp_PUBLIC_KEY_BYTES / 4];
+  srp_verifier_run();
+  occ_srp_public_key((uint8_t*)srp_pub_b, message, (const uint8_t*)srp_v);
+  occ_srp_public_key((uint8_t*)other, &message[1], (const uint8_t*)srp_v);
+  // Stand-in public key of client for the premaster case
+  occ_srp_public_key((uint8_t*)srp_pub_a, &message[2], (const uint8_t*)srp_v);
+  return 0 != memcmp(other, srp_pub_b, sizeof(other));
+}
+
+/** Ephemeral key of server */
+static void srp_public_key_run(void)
+{
+  occ_srp_public_key((uint8_t*)srp_pub_b, message, (const uint8_t*)srp_v);
+}
+
+/**
+ *  Checks relations of HAP SRP which do not need the group: client key of zero is
+ *  rejected, K = H(S) and M2 = H(A | M1 | K).
+ */
+static bool srp_session_kat(void)
+{
+  static uint8_t concat[occ_srp_PUBLIC_KEY_BYTES + occ_srp_PROOF_BYTES + occ_srp_SESSION_KEY_BYTES];
+  uint32_t zero[occ_srp_PUBLIC_KEY_BYTES / 4] = {0};
+  uint8_t u[occ_srp_SCRAMBLING_PARAMETER_BYTES];
+  uint8_t k[occ_srp_SESSION_KEY_BYTES];
+  uint8_t m1[occ_srp_PROOF_BYTES];
+  uint8_t m2[occ_srp_PROOF_BYTES];
+  uint8_t h[occ_sha512_BYTES];
+  bool passed = true;
+  srp_public_key_kat();
+  occ_srp_scrambling_parameter(u, (const uint8_t*)srp_pub_a, (const uint8_t*)srp_pub_b);
+  passed &= (0 != occ_srp_premaster_secret((uint8_t*)srp_s, (const uint8_t*)zero, message, u, (const uint8_t*)srp_v));
+  passed &= (0 == occ_srp_premaster_secret((uint8_t*)srp_s, (const uint8_t*)srp_pub_a, message, u, (const uint8_t*)srp_v));
+  occ_srp_session_key(k, (const uint8_t*)srp_s);
+  occ_sha512(h, (const uint8_t*)srp_s, sizeof(srp_s));
+  passed &= (0 == memcmp(k, h, sizeof(k)));
+  occ_srp_proof_m1(m1, (const uint8_t*)srp_user, sizeof(srp_user) - 1, srp_salt, (const uint8_t*)srp_pub_a,
+                   (const uint8_t*)srp_pub_b, k);
+  occ_srp_proof_m2(m2, (const uint8_t*)srp_pub_a, m1, k);
+  memcpy(concat, srp_pub_a, occ_srp_PUBLIC_KEY_BYTES);
+  memcpy(&concat[occ_srp_PUBLIC_KEY_BYTES], m1, sizeof(m1));
+  memcpy(&concat[occ_srp_PUBLIC_KEY_BYTES + sizeof(m1)], k, sizeof(k));
+  occ_sha512(h, concat, sizeof(concat));
+  passed &= (0 == memcmp(m2, h, sizeof(m2)));
+  return passed;
+}
+
+/** Work of server from client public key to session key and proofs */
+static void srp_session_run(void)
+{
+  uint8_t u[occ_srp_SCRAMBLING_PARAMETER_BYTES];
+  uint8_t k[occ_srp_SESSION_KEY_BYTES];
+  uint8_t m1[occ_srp_PROOF_BYTES];
+  occ_srp_scrambling_parameter(u, (const uint8_t*)srp_pub_a, (const uint8_t*)srp_pub_b);
+  occ_srp_premaster_secret((uint8_t*)srp_s, (const uint8_t*)srp_pub_a, message, u, (const uint8_t*)srp_v);
+  occ_srp_session_key(k, (const uint8_t*)srp_s);
+  occ_srp_proof_m1(m1, (const uint8_t*)srp_user, sizeof(srp_user) - 1, srp_salt, (const uint8_t*)srp_pub_a,
+                   (const uint8_t*)srp_pub_b, k);
+  occ_srp_proof_m2(output, (const uint8_t*)srp_pub_a, m1, k);
+}
+
+typedef struct {
+  const char* name;
+  uint32_t    bytes;
+  bool        (*kat)(void);  /**< Also prepares input of timed runs */
+  void        (*run)(void);
+}bench_case_t;
+
+static const bench_case_t cases[] = {
+  { "sha256",            BENCH_MESSAGE_LENGTH, sha256_kat,            sha256_run },
+  { "sha512",            BENCH_MESSAGE_LENGTH, sha512_kat,            sha512_run },
+  { "hmac_sha256",       32,                   hmac_sha256_kat,       hmac_sha256_run },
+  { "hkdf_sha256",       0,                    hkdf_sha256_kat,       hkdf_sha256_run },
+  { "chacha20_poly1305", BENCH_MESSAGE_LENGTH, chacha20_poly1305_kat, chacha20_poly1305_run },
+  { "curve25519",        0,                    curve25519_kat,        curve25519_run },
+  { "ed25519_sign",      0,                    ed25519_sign_kat,      ed25519_sign_run },
+  { "ed25519_verify",    0,                    ed25519_verify_kat,    ed25519_verify_run },
+  { "ecdh_p256",         0,                    ecdh_p256_kat,         ecdh_p256_run },
+  { "ecdsa_p256_sign",   0,                    ecdsa_p256_sign_kat,   ecdsa_p256_sign_run },
+  { "ecdsa_p256_verify", 0,                    ecdsa_p256_verify_kat, ecdsa_p256_verify_run },
+  { "srp_verifier",      0,                    srp_verifier_kat,      srp_verifier_run },
+  { "srp_public_key",    0,                    srp_public_key_kat,    srp_public_key_run },
+  { "srp_session",       0,                    srp_session_kat,       srp_session_run }
+};
+
+uint8_t crypto_bench_count(void)
+{
+  return sizeof(cases) / sizeof(cases[0]);
+}
+
+const char* crypto_bench_name(uint8_t index)
+{
+  return (index < crypto_bench_count()) ? cases[index].name : NULL;
+}
+
+bool crypto_bench_run(uint8_t index, crypto_bench_clock_t clock, uint32_t budget, crypto_bench_result_t* p_result)
+{
+  if(index >= crypto_bench_count() || NULL == clock || NULL == p_result) { return false; }
+  const bench_case_t* p_case = &cases[index];
+  for(size_t ii = 0; ii < sizeof(message); ii++) { message[ii] = ii * 7 + 1; }
+
+  p_result->name   = p_case->name;
+  p_result->bytes  = p_case->bytes;
+  p_result->passed = p_case->kat();
+
+  uint32_t runs = 0;
+  uint32_t elapsed;
+  uint32_t start = clock();
+  do {
+    p_case->run();
+    runs++;
+    elapsed = clock() - start;
+  } while(elapsed < budget && UINT32_MAX != runs);
+  p_result->runs  = runs;
+  p_result->ticks = elapsed / runs;
+  return true;
+}
@@ -0,0 +1,53 @@
+#ifndef CRYPTO_BENCH_H
+#define CRYPTO_BENCH_H
+
+/**
+ *  Known-answer tests and benchmark of the Oberon crypto primitives bundled in
+ *  ruuvi_examples/eddystone/occ, through their occ_* API.
+ *
+ *  Each case checks a primitive against a published test vector, then runs the same kind
+ *  of operation repeatedly and reports mean time per run in ticks of a clock given by
+ *  caller. Same source runs on tag against occ_lib_nrf52.a with the cycle counter as
+ *  clock, see ruuvi_examples/eddystone, and on host in tools/crypto_bench. Costs of
+ *  algorithms can so be compared before one is chosen for e.g. EID, authenticated
+ *  frames or signed DFU.
+ *
+ *  SRP has no published vector of the 3072 bit SHA-512 variant of occ, its cases check
+ *  consistency of the API only.
+ *
+ *  License: BSD-3
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Return free running ticks, differences are taken modulo 2^32 */
+typedef uint32_t(*crypto_bench_clock_t)(void);
+
+typedef struct {
+  const char* name;
+  uint32_t    bytes;     /**< Bytes processed by one run, 0 for operations of fixed size */
+  uint32_t    runs;      /**< Runs timed */
+  uint32_t    ticks;     /**< Mean ticks of one run */
+  bool        passed;    /**< Known-answer test passed */
+}crypto_bench_result_t;
+
+/** Return number of cases */
+uint8_t crypto_bench_count(void);
+
+/** Return name of case, NULL if there is no such case */
+const char* crypto_bench_name(uint8_t index);
+
+/**
+ *  Run known-answer test of case, then time runs of it until budget of ticks is used.
+ *  At least one run is timed, a run must take less than 2^31 ticks.
+ *
+ *  @param index    case, 0 ... crypto_bench_count() - 1
+ *  @param clock    clock of timing
+ *  @param budget   ticks to spend in timed runs
+ *  @param p_result result of case
+ *  @return false if there is no such case
+ */
+bool crypto_bench_run(uint8_t index, crypto_bench_clock_t clock, uint32_t budget, crypto_bench_result_t* p_result);
+
+#endif
@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <string.h>
 #include "ringbuffer.h" 
+#include "trace.h"
 
 //Debug logging
 #define NRF_LOG_MODULE_NAME "RINGBUFFER"
@@ -48,7 +49,7 @@ void ringbuffer_peek_at(ringbuffer_t* buffer, size_t index, void* element)
   //Calculate element position at X, relative to ringbuffer start
   size_t position = (buffer->start)+index;
   if(position >= buffer->element_max) { position = position - buffer->element_max; }
-  NRF_LOG_DEBUG("Copying %d bytes to %d\r\n", buffer->element_size, (uint32_t)((buffer->element) + (position * buffer->element_size)));
+  TRACE_DEBUG("Copying %d bytes to %d\r\n", buffer->element_size, (uint32_t)((buffer->element) + (position * buffer->element_size)));
   memcpy(element, (buffer->element) + (position * buffer->element_size), buffer->element_size);
 }
 
@@ -63,7 +64,7 @@ void ringbuffer_push(ringbuffer_t* buffer, void* data)
     index = index-(buffer->element_max);
   }
   void* target = buffer->element + (index * buffer->element_size);
-  NRF_LOG_DEBUG("Buffer starts at %d, pushing %d bytes to address %d\r\n", (uint32_t)buffer->element, (uint32_t)buffer->element_size, (uint32_t)target);
+  TRACE_DEBUG("Buffer starts at %d, pushing %d bytes to address %d\r\n", (uint32_t)buffer->element, (uint32_t)buffer->element_size, (uint32_t)target);
   memcpy(target, data, buffer->element_size);
   //Buffer overflow? pop element (this is actually newest element / same as input due to overflow
   if(buffer->count > buffer->element_max){ ringbuffer_popqueue(buffer, data); }
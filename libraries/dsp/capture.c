@@ -0,0 +1,101 @@
+#include "capture.h"
+
+#include "nrf_error.h"
+
+#define NRF_LOG_MODULE_NAME "CAPTURE"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+/** Ring is allocated at build time, capture never allocates at runtime */
+static int16_t  ring[CAPTURE_MAX_SAMPLES][3];
+static uint16_t head = 0;          // Index of next write
+static uint32_t written = 0;       // Samples put since arming
+static uint32_t trigger_at = 0;    // Value of written at first post-trigger sample
+static capture_info_t info = { .state = CAPTURE_IDLE };
+
+ret_code_t capture_arm(uint16_t sample_rate_hz, uint16_t pre_samples, uint16_t post_samples)
+{
+  if(0 == post_samples || CAPTURE_MAX_SAMPLES < (uint32_t)pre_samples + post_samples) { return NRF_ERROR_INVALID_PARAM; }
+  head = 0;
+  written = 0;
+  trigger_at = 0;
+  info.sample_rate_hz = sample_rate_hz;
+  info.pre_samples = pre_samples;
+  info.post_samples = post_samples;
+  info.samples = 0;
+  info.trigger_index = 0;
+  info.state = CAPTURE_ARMED;
+  NRF_LOG_INFO("Capture armed, %d + %d samples at %d Hz\r\n", pre_samples, post_samples, sample_rate_hz);
+  return NRF_SUCCESS;
+}
+
+void capture_disarm(void)
+{
+  info.state = CAPTURE_IDLE;
+}
+
+capture_state_t capture_state(void)
+{
+  return info.state;
+}
+
+bool capture_sample_put(int16_t x, int16_t y, int16_t z)
+{
+  if(CAPTURE_ARMED != info.state && CAPTURE_TRIGGERED != info.state) { return false; }
+  ring[head][0] = x;
+  ring[head][1] = y;
+  ring[head][2] = z;
+  head = (head + 1) % CAPTURE_MAX_SAMPLES;
+  written++;
+  if(CAPTURE_TRIGGERED != info.state || written < trigger_at + info.post_samples) { return false; }
+
+  // Pre-trigger window is shorter if trigger came before ring had enough samples
+  uint32_t pre = (trigger_at < info.pre_samples) ? trigger_at : info.pre_samples;
+  info.samples = pre + info.post_samples;
+  info.trigger_index = pre;
+  info.sequence++;
+  info.state = CAPTURE_FROZEN;
+  NRF_LOG_INFO("Capture frozen, %d samples\r\n", info.samples);
+  return true;
+}
+
+bool capture_trigger(uint16_t pending)
+{
+  if(CAPTURE_ARMED != info.state) { return false; }
+  trigger_at = written + pending;
+  info.state = CAPTURE_TRIGGERED;
+  return true;
+}
+
+bool capture_latest(int16_t* p_x, int16_t* p_y, int16_t* p_z)
+{
+  if(0 == written || CAPTURE_IDLE == info.state) { return false; }
+  uint16_t latest = (head + CAPTURE_MAX_SAMPLES - 1) % CAPTURE_MAX_SAMPLES;
+  *p_x = ring[latest][0];
+  *p_y = ring[latest][1];
+  *p_z = ring[latest][2];
+  return true;
+}
+
+capture_info_t capture_info(void)
+{
+  return info;
+}
+
+size_t capture_read(uint8_t* p_buffer, size_t first, size_t count)
+{
+  if(CAPTURE_FROZEN != info.state || first >= info.samples) { return 0; }
+  if(count > info.samples - first) { count = info.samples - first; }
+  // Last sample of capture is the one before head
+  uint16_t oldest = (head + CAPTURE_MAX_SAMPLES - info.samples) % CAPTURE_MAX_SAMPLES;
+  for(size_t ii = 0; ii < count; ii++)
+  {
+    const int16_t* p_sample = ring[(oldest + first + ii) % CAPTURE_MAX_SAMPLES];
+    for(uint8_t axis = 0; axis < 3; axis++)
+    {
+      *p_buffer++ = (uint16_t)p_sample[axis] & 0xFF;
+      *p_buffer++ = (uint16_t)p_sample[axis] >> 8;
+    }
+  }
+  return count;
+}
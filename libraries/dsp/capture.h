@@ -0,0 +1,103 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+/**
+ *  Pre- and post-trigger capture of acceleration into a RAM ring.
+ *
+ *  While armed, every sample of accelerometer FIFO is written to a ring of
+ *  CAPTURE_MAX_SAMPLES, oldest samples are overwritten. Trigger marks the event,
+ *  ring keeps collecting post-trigger samples and then freezes so that it holds
+ *  pre-trigger samples before the event and post-trigger samples after it.
+ *  Frozen capture is read out as 6-byte samples, int16 X, Y, Z in mg, little endian,
+ *  oldest first. Collection restarts only when capture is armed again.
+ *
+ *  License: BSD-3
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+/** Samples in ring, 6 bytes each */
+#ifndef CAPTURE_MAX_SAMPLES
+  #define CAPTURE_MAX_SAMPLES 1024
+#endif
+
+/** Bytes of one serialized sample */
+#define CAPTURE_SAMPLE_SIZE 6
+
+typedef enum {
+  CAPTURE_IDLE      = 0, // Not armed, samples are ignored
+  CAPTURE_ARMED     = 1, // Collecting pre-trigger samples
+  CAPTURE_TRIGGERED = 2, // Collecting post-trigger samples
+  CAPTURE_FROZEN    = 3  // Capture is complete, ready for readout
+}capture_state_t;
+
+typedef struct {
+  capture_state_t state;
+  uint16_t sample_rate_hz;
+  uint16_t pre_samples;       // Configured window before trigger
+  uint16_t post_samples;      // Configured window after trigger
+  uint16_t samples;           // Samples available for readout once frozen
+  uint16_t trigger_index;     // Index of first sample after trigger in readout
+  uint16_t sequence;          // Count of frozen captures, wraps
+}capture_info_t;
+
+/**
+ *  Arm capture. Previous capture is discarded.
+ *
+ *  @param sample_rate_hz output data rate of samples, reported with capture
+ *  @param pre_samples samples kept from before trigger
+ *  @param post_samples samples collected after trigger, at least 1
+ *
+ *  @return NRF_SUCCESS or NRF_ERROR_INVALID_PARAM if windows do not fit in ring
+ */
+ret_code_t capture_arm(uint16_t sample_rate_hz, uint16_t pre_samples, uint16_t post_samples);
+
+/** Stop collecting, capture becomes idle */
+void capture_disarm(void);
+
+/** Return current state of capture */
+capture_state_t capture_state(void);
+
+/**
+ *  Add sample of acceleration in mg. Ignored unless armed or triggered.
+ *
+ *  @return true if this sample completed the capture and it froze
+ */
+bool capture_sample_put(int16_t x, int16_t y, int16_t z);
+
+/**
+ *  Mark trigger event. Ignored unless armed.
+ *
+ *  @param pending samples taken before the event which have not been put yet,
+ *                 e.g. samples waiting in accelerometer FIFO
+ *
+ *  @return true if capture was triggered
+ */
+bool capture_trigger(uint16_t pending);
+
+/**
+ *  Get latest sample put to ring
+ *
+ *  @return false if no sample has been put since arming
+ */
+bool capture_latest(int16_t* p_x, int16_t* p_y, int16_t* p_z);
+
+/** Return state, windows and size of capture */
+capture_info_t capture_info(void);
+
+/**
+ *  Copy serialized samples of frozen capture.
+ *
+ *  @param p_buffer target of samples, CAPTURE_SAMPLE_SIZE bytes each
+ *  @param first index of first sample, 0 is oldest
+ *  @param count maximum number of samples to copy
+ *
+ *  @return number of samples copied, 0 if capture is not frozen or first is past the end
+ */
+size_t capture_read(uint8_t* p_buffer, size_t first, size_t count);
+
+#endif
@@ -0,0 +1,281 @@
+#include "vibration.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include "nrf_error.h"
+
+#define NRF_LOG_MODULE_NAME "VIBRATION"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+#define HALF_LENGTH (VIBRATION_BLOCK_LENGTH / 2)
+#define VIBRATION_AXES 3
+
+/** Largest sample fed to FFT, leaves one bit of headroom for windowing rounding */
+#define NORMALIZED_MAX 16383
+
+/** Q15 tables, computed once on first init */
+static bool     tables_ready = false;
+static int16_t  window[VIBRATION_BLOCK_LENGTH];
+static int16_t  twiddle_cos[HALF_LENGTH];
+static int16_t  twiddle_sin[HALF_LENGTH];
+
+/** Collected samples, one buffer is filled while the other waits for analysis */
+static int16_t  blocks[2][VIBRATION_BLOCK_LENGTH][VIBRATION_AXES];
+static uint8_t  fill_block = 0;
+static uint16_t fill_count = 0;
+static bool     block_ready = false;
+static bool     running = false;
+
+static uint16_t sample_rate = 0;
+static int32_t  tracked_coefficient = 0; // 2cos(w) of Goertzel in Q14, 0 if not tracked
+static uint16_t sequence = 0;
+static uint16_t dropped = 0;
+
+/** FFT work area and power spectrum, kept off the stack */
+static int16_t  re[VIBRATION_BLOCK_LENGTH];
+static int16_t  im[VIBRATION_BLOCK_LENGTH];
+static uint32_t power[HALF_LENGTH + 1];
+
+static uint32_t isqrt(uint64_t value)
+{
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+  while(bit > value) { bit >>= 2; }
+  while(bit)
+  {
+    if(value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else { root >>= 1; }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+/** Undo block floating point scaling, shift is count of left shifts applied to samples */
+static uint64_t unscale(uint64_t value, int8_t shift)
+{
+  return (shift >= 0) ? value >> shift : value << -shift;
+}
+
+static uint16_t saturate(uint32_t value)
+{
+  return (value > UINT16_MAX) ? UINT16_MAX : value;
+}
+
+static void tables_init(void)
+{
+  for(uint16_t ii = 0; ii < VIBRATION_BLOCK_LENGTH; ii++)
+  {
+    // Periodic Hann window
+    window[ii] = (int16_t)lroundf(32767.0f * 0.5f * (1.0f - cosf(2.0f * (float)M_PI * ii / VIBRATION_BLOCK_LENGTH)));
+  }
+  for(uint16_t ii = 0; ii < HALF_LENGTH; ii++)
+  {
+    twiddle_cos[ii] = (int16_t)lroundf(32767.0f * cosf(2.0f * (float)M_PI * ii / VIBRATION_BLOCK_LENGTH));
+    twiddle_sin[ii] = (int16_t)lroundf(32767.0f * sinf(2.0f * (float)M_PI * ii / VIBRATION_BLOCK_LENGTH));
+  }
+  tables_ready = true;
+}
+
+ret_code_t vibration_init(uint16_t sample_rate_hz, uint16_t tracked_frequency_hz)
+{
+  if(0 == sample_rate_hz || tracked_frequency_hz * 2 >= sample_rate_hz) { return NRF_ERROR_INVALID_PARAM; }
+  if(!tables_ready) { tables_init(); }
+  sample_rate = sample_rate_hz;
+  tracked_coefficient = 0;
+  if(tracked_frequency_hz)
+  {
+    tracked_coefficient = lroundf(16384.0f * 2.0f * cosf(2.0f * (float)M_PI * tracked_frequency_hz / sample_rate_hz));
+  }
+  fill_block = 0;
+  fill_count = 0;
+  block_ready = false;
+  sequence = 0;
+  dropped = 0;
+  running = true;
+  NRF_LOG_INFO("Vibration analysis at %d Hz, tracking %d Hz\r\n", sample_rate_hz, tracked_frequency_hz);
+  return NRF_SUCCESS;
+}
+
+void vibration_stop(void)
+{
+  running = false;
+  block_ready = false;
+}
+
+bool vibration_is_running(void)
+{
+  return running;
+}
+
+bool vibration_sample_put(int16_t x, int16_t y, int16_t z)
+{
+  if(!running) { return false; }
+  blocks[fill_block][fill_count][0] = x;
+  blocks[fill_block][fill_count][1] = y;
+  blocks[fill_block][fill_count][2] = z;
+  fill_count++;
+  if(VIBRATION_BLOCK_LENGTH > fill_count) { return false; }
+
+  fill_count = 0;
+  // Previous block was not analysed in time, overwrite it
+  if(block_ready)
+  {
+    dropped++;
+    return false;
+  }
+  block_ready = true;
+  fill_block ^= 1;
+  return true;
+}
+
+/** In-place radix-2 decimation in time FFT of re, im. Each stage halves, result is scaled by 1/N. */
+static void fft(void)
+{
+  // Bit reversed order
+  for(uint16_t ii = 1, jj = 0; ii < VIBRATION_BLOCK_LENGTH; ii++)
+  {
+    uint16_t bit = HALF_LENGTH;
+    for(; jj & bit; bit >>= 1) { jj ^= bit; }
+    jj ^= bit;
+    if(ii < jj)
+    {
+      int16_t swap = re[ii]; re[ii] = re[jj]; re[jj] = swap;
+      swap = im[ii]; im[ii] = im[jj]; im[jj] = swap;
+    }
+  }
+
+  for(uint16_t size = 2; size <= VIBRATION_BLOCK_LENGTH; size <<= 1)
+  {
+    uint16_t half = size >> 1;
+    uint16_t step = VIBRATION_BLOCK_LENGTH / size;
+    for(uint16_t start = 0; start < VIBRATION_BLOCK_LENGTH; start += size)
+    {
+      for(uint16_t kk = 0; kk < half; kk++)
+      {
+        int32_t wr = twiddle_cos[kk * step];
+        int32_t wi = -twiddle_sin[kk * step];
+        uint16_t ii = start + kk;
+        uint16_t jj = ii + half;
+        int32_t tr = (wr * re[jj] - wi * im[jj]) >> 15;
+        int32_t ti = (wr * im[jj] + wi * re[jj]) >> 15;
+        re[jj] = (re[ii] - tr) >> 1;
+        im[jj] = (im[ii] - ti) >> 1;
+        re[ii] = (re[ii] + tr) >> 1;
+        im[ii] = (im[ii] + ti) >> 1;
+      }
+    }
+  }
+}
+
+/** Return |X|^2 of windowed block in re at tracked frequency, unscaled DFT */
+static uint64_t goertzel(void)
+{
+  int64_t s1 = 0;
+  int64_t s2 = 0;
+  for(uint16_t ii = 0; ii < VIBRATION_BLOCK_LENGTH; ii++)
+  {
+    int64_t s0 = re[ii] + ((tracked_coefficient * s1) >> 14) - s2;
+    s2 = s1;
+    s1 = s0;
+  }
+  int64_t square = s1 * s1 + s2 * s2 - ((tracked_coefficient * s1) >> 14) * s2;
+  return (square > 0) ? square : 0;
+}
+
+ret_code_t vibration_analyse(vibration_result_t* p_result)
+{
+  if(NULL == p_result) { return NRF_ERROR_NULL; }
+  if(!block_ready) { return NRF_ERROR_INVALID_STATE; }
+  int16_t (*p_block)[VIBRATION_AXES] = blocks[fill_block ^ 1];
+
+  // Remove gravity and static offset of each axis
+  int32_t mean[VIBRATION_AXES];
+  uint64_t square_sum = 0;
+  int32_t max = 0;
+  for(uint8_t axis = 0; axis < VIBRATION_AXES; axis++)
+  {
+    int32_t sum = 0;
+    for(uint16_t ii = 0; ii < VIBRATION_BLOCK_LENGTH; ii++) { sum += p_block[ii][axis]; }
+    mean[axis] = sum / VIBRATION_BLOCK_LENGTH;
+    for(uint16_t ii = 0; ii < VIBRATION_BLOCK_LENGTH; ii++)
+    {
+      int32_t ac = p_block[ii][axis] - mean[axis];
+      square_sum += (int64_t)ac * ac;
+      if(ac > max) { max = ac; }
+      if(-ac > max) { max = -ac; }
+    }
+  }
+
+  // Block floating point: scale largest sample of all axes to use the range of FFT
+  int8_t shift = 0;
+  while(max && (max << shift) <= NORMALIZED_MAX / 2) { shift++; }
+  while((max >> -shift) > NORMALIZED_MAX) { shift--; }
+
+  memset(p_result, 0, sizeof(vibration_result_t));
+  p_result->sample_rate_hz = sample_rate;
+  p_result->rms_mg = saturate(isqrt(square_sum / VIBRATION_BLOCK_LENGTH));
+  p_result->sequence = sequence++;
+  p_result->blocks_dropped = dropped;
+
+  // Power of axes is summed, spectrum does not depend on orientation of the tag
+  uint64_t tracked_power = 0;
+  memset(power, 0, sizeof(power));
+  for(uint8_t axis = 0; axis < VIBRATION_AXES; axis++)
+  {
+    for(uint16_t ii = 0; ii < VIBRATION_BLOCK_LENGTH; ii++)
+    {
+      int32_t ac = p_block[ii][axis] - mean[axis];
+      ac = (shift >= 0) ? ac << shift : ac >> -shift;
+      re[ii] = (ac * window[ii]) >> 15;
+      im[ii] = 0;
+    }
+    if(tracked_coefficient) { tracked_power += goertzel(); }
+    fft();
+    for(uint16_t kk = 0; kk <= HALF_LENGTH; kk++)
+    {
+      power[kk] += (int32_t)re[kk] * re[kk] + (int32_t)im[kk] * im[kk];
+    }
+  }
+  // Block was copied to work area on every pass, it can be filled again
+  block_ready = false;
+
+  // Amplitude of sine is 4|X|/N with Hann window of coherent gain 1/2
+  if(tracked_coefficient)
+  {
+    uint64_t magnitude = isqrt(tracked_power);
+    p_result->tracked_mg = saturate(unscale(magnitude * 4, shift) / VIBRATION_BLOCK_LENGTH);
+  }
+
+  uint16_t peak = 1;
+  for(uint16_t kk = 2; kk < HALF_LENGTH; kk++)
+  {
+    if(power[kk] > power[peak]) { peak = kk; }
+  }
+
+  // Bands end at N/16, N/8, N/4 and N/2. Mean square is 2 * sum |X|^2 / (3/8) of Hann window.
+  for(uint8_t band = 0; band < VIBRATION_BANDS; band++)
+  {
+    uint16_t first = band ? (HALF_LENGTH >> (VIBRATION_BANDS - band)) : 1;
+    uint16_t end = HALF_LENGTH >> (VIBRATION_BANDS - 1 - band);
+    uint64_t band_power = 0;
+    for(uint16_t kk = first; kk < end; kk++) { band_power += power[kk]; }
+    p_result->band_mg[band] = saturate(isqrt(unscale(unscale(band_power * 16 / 3, shift), shift)));
+  }
+
+  // Peak between bins, exact for Hann window: d = 2(m+ - m-) / (m- + 2m + m+)
+  int32_t previous = isqrt(power[peak - 1]);
+  int32_t current = isqrt(power[peak]);
+  int32_t next = isqrt(power[peak + 1]);
+  int32_t denominator = previous + 2 * current + next;
+  int32_t delta_q8 = denominator ? ((next - previous) * 512) / denominator : 0;
+  int32_t position_q8 = (peak << 8) + delta_q8;
+  p_result->peak_frequency_dhz = saturate(((int64_t)position_q8 * sample_rate * 10 / VIBRATION_BLOCK_LENGTH) >> 8);
+  p_result->peak_mg = saturate(unscale((uint64_t)current * 4, shift));
+  return NRF_SUCCESS;
+}
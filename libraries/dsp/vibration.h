@@ -0,0 +1,78 @@
+#ifndef VIBRATION_H
+#define VIBRATION_H
+
+/**
+ *  Spectral analysis of acceleration for vibration monitoring.
+ *
+ *  Samples of accelerometer FIFO are collected in blocks of VIBRATION_BLOCK_LENGTH.
+ *  A completed block is handed over for analysis and next block is collected into
+ *  second buffer, so analysis can run as a background task while FIFO keeps streaming.
+ *
+ *  Analysis removes mean (gravity) of each axis, windows the axes with Hann window and
+ *  runs a fixed-point radix-2 FFT with block floating point scaling on each. Power of
+ *  the axes is summed, so results do not depend on how the tag is mounted:
+ *  - RMS of acceleration vector around its mean, from time domain
+ *  - frequency and amplitude of largest peak, interpolated between bins
+ *  - RMS of VIBRATION_BANDS octave bands, highest band ends at Nyquist frequency
+ *  - amplitude at one tracked frequency, e.g. rotation speed, with Goertzel algorithm
+ *
+ *  At 400 Hz bands are 0-25, 25-50, 50-100 and 100-200 Hz and resolution is 1.6 Hz.
+ *
+ *  License: BSD-3
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+/** Samples per analysed block, power of two */
+#define VIBRATION_BLOCK_BITS   8
+#define VIBRATION_BLOCK_LENGTH (1 << VIBRATION_BLOCK_BITS)
+
+/** Octave bands below Nyquist frequency */
+#define VIBRATION_BANDS        4
+
+typedef struct {
+  uint16_t sample_rate_hz;
+  uint16_t rms_mg;                   // RMS of acceleration vector around its mean
+  uint16_t peak_frequency_dhz;       // Frequency of largest peak, 0.1 Hz
+  uint16_t peak_mg;                  // Amplitude of largest peak
+  uint16_t tracked_mg;               // Amplitude at tracked frequency, 0 if not tracked
+  uint16_t band_mg[VIBRATION_BANDS]; // RMS of each band, lowest first
+  uint16_t sequence;                 // Count of analysed blocks, wraps
+  uint16_t blocks_dropped;           // Blocks lost because analysis was late, wraps
+}vibration_result_t;
+
+/**
+ *  Start collecting blocks. Previous blocks are discarded, sequence and drop counts restart.
+ *
+ *  @param sample_rate_hz output data rate of accelerometer
+ *  @param tracked_frequency_hz frequency whose amplitude is reported, 0 for none.
+ *                              Must be below Nyquist frequency.
+ *
+ *  @return NRF_SUCCESS or NRF_ERROR_INVALID_PARAM
+ */
+ret_code_t vibration_init(uint16_t sample_rate_hz, uint16_t tracked_frequency_hz);
+
+/** Stop collecting samples */
+void vibration_stop(void);
+
+/** Return true if samples are collected */
+bool vibration_is_running(void);
+
+/**
+ *  Add sample of acceleration in mg.
+ *
+ *  @return true if a block was completed and is ready for vibration_analyse()
+ */
+bool vibration_sample_put(int16_t x, int16_t y, int16_t z);
+
+/**
+ *  Analyse completed block and release its buffer for collection.
+ *
+ *  @return NRF_SUCCESS or NRF_ERROR_INVALID_STATE if no block is ready
+ */
+ret_code_t vibration_analyse(vibration_result_t* p_result);
+
+#endif
@@ -0,0 +1,97 @@
+#include "eid.h"
+
+#include <string.h>
+
+/** Salt of temporary key derivation */
+#define EID_TEMPORARY_KEY_SALT 0xFF
+
+static void put_uint32(uint8_t* p_buffer, uint32_t value)
+{
+  for(uint8_t ii = 0; ii < 4; ii++) { p_buffer[ii] = value >> (24 - 8 * ii); }
+}
+
+uint32_t eid_rotation_start(uint8_t exponent, uint32_t time)
+{
+  return (time >> exponent) << exponent;
+}
+
+void eid_temporary_key(const aes128_t* p_identity, uint32_t time, uint8_t* p_key)
+{
+  uint8_t block[AES_BLOCK_SIZE] = {0};
+  block[11] = EID_TEMPORARY_KEY_SALT;
+  block[14] = time >> 24;
+  block[15] = time >> 16;
+  aes128_encrypt((void*)p_identity, block, p_key);
+}
+
+void eid_from_temporary(const aes128_t* p_temporary, uint8_t exponent, uint32_t time, uint8_t* p_eid)
+{
+  uint8_t block[AES_BLOCK_SIZE] = {0};
+  block[11] = exponent;
+  put_uint32(&block[12], eid_rotation_start(exponent, time));
+  aes128_encrypt((void*)p_temporary, block, block);
+  memcpy(p_eid, block, EID_LENGTH);
+}
+
+void eid_compute(const aes128_t* p_identity, uint8_t exponent, uint32_t time, uint8_t* p_eid)
+{
+  uint8_t key[AES_KEY_SIZE];
+  aes128_t temporary;
+  eid_temporary_key(p_identity, time, key);
+  aes128_init(&temporary, key);
+  eid_from_temporary(&temporary, exponent, time, p_eid);
+}
+
+void eid_omac(const aes_cmac_t* p_cmac, uint8_t tweak, const uint8_t* p_data, size_t length, uint8_t* p_mac)
+{
+  uint8_t buffer[AES_BLOCK_SIZE + EID_EAX_MAX_LENGTH] = {0};
+  buffer[AES_BLOCK_SIZE - 1] = tweak;
+  if(length) { memcpy(&buffer[AES_BLOCK_SIZE], p_data, length); }
+  aes_cmac_compute(p_cmac, buffer, AES_BLOCK_SIZE + length, p_mac);
+}
+
+void eid_eax_encrypt(const aes_cmac_t* p_cmac, const uint8_t* p_nonce, size_t nonce_length,
+                     const uint8_t* p_header, size_t header_length,
+                     const uint8_t* p_plain, size_t length, uint8_t* p_cipher, uint8_t* p_tag)
+{
+  uint8_t nonce_mac[AES_BLOCK_SIZE];
+  uint8_t header_mac[AES_BLOCK_SIZE];
+  uint8_t counter[AES_BLOCK_SIZE];
+  uint8_t keystream[AES_BLOCK_SIZE];
+  eid_omac(p_cmac, 0, p_nonce, nonce_length, nonce_mac);
+  eid_omac(p_cmac, 1, p_header, header_length, header_mac);
+
+  // CTR mode starting from nonce MAC, counter is a 128-bit big-endian integer
+  memcpy(counter, nonce_mac, sizeof(counter));
+  for(size_t offset = 0; offset < length; offset += AES_BLOCK_SIZE)
+  {
+    p_cmac->cipher(p_cmac->p_context, counter, keystream);
+    for(size_t ii = offset; ii < length && ii < offset + AES_BLOCK_SIZE; ii++)
+    {
+      p_cipher[ii] = p_plain[ii] ^ keystream[ii - offset];
+    }
+    for(int8_t ii = AES_BLOCK_SIZE - 1; ii >= 0 && 0 == ++counter[ii]; ii--);
+  }
+
+  eid_omac(p_cmac, 2, p_cipher, length, p_tag);
+  for(uint8_t ii = 0; ii < AES_BLOCK_SIZE; ii++) { p_tag[ii] ^= nonce_mac[ii] ^ header_mac[ii]; }
+}
+
+void eid_etlm_nonce(uint32_t time, uint16_t salt, uint8_t* p_nonce)
+{
+  put_uint32(p_nonce, time);
+  p_nonce[4] = salt >> 8;
+  p_nonce[5] = salt;
+}
+
+void eid_etlm_encrypt(const aes_cmac_t* p_cmac, uint32_t time, uint16_t salt,
+                      const uint8_t* p_tlm, uint8_t* p_etlm)
+{
+  uint8_t nonce[6];
+  uint8_t tag[AES_BLOCK_SIZE];
+  eid_etlm_nonce(time, salt, nonce);
+  eid_eax_encrypt(p_cmac, nonce, sizeof(nonce), NULL, 0, p_tlm, EID_ETLM_PLAIN_LENGTH, p_etlm, tag);
+  p_etlm[EID_ETLM_SALT_OFFSET]     = salt >> 8;
+  p_etlm[EID_ETLM_SALT_OFFSET + 1] = salt;
+  memcpy(&p_etlm[EID_ETLM_MIC_OFFSET], tag, EID_ETLM_MIC_LENGTH);
+}
@@ -0,0 +1,91 @@
+#ifndef EID_H
+#define EID_H
+
+/**
+ *  Ephemeral identifiers and encrypted telemetry of Eddystone.
+ *
+ *  EID of a rotation period is computed in two steps, both single AES-128 blocks:
+ *   - temporary key = AES(identity key, 11 x 0x00 | 0xFF | 0x00 0x00 | time bits 31..16)
+ *   - EID           = AES(temporary key, 11 x 0x00 | K | time with lowest K bits cleared)[0..7]
+ *  where time is the 32-bit beacon clock in seconds and EID rotates every 2^K seconds.
+ *
+ *  eTLM is the 12 bytes of plain TLM after version, VBATT, TEMP, ADV_CNT and SEC_CNT,
+ *  encrypted with AES-EAX under the identity key. Nonce is time, most significant byte
+ *  first, followed by a random 16-bit salt, MIC is the first 2 bytes of EAX tag.
+ *
+ *  Portable C99, no SDK dependencies. AES-128 and CMAC come from libraries/adv_auth.
+ *
+ *  License: BSD-3
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "aes_cmac.h"
+
+#define EID_LENGTH           8
+#define EID_MAX_EXPONENT     15
+#define EID_ETLM_PLAIN_LENGTH 12
+#define EID_ETLM_SALT_OFFSET 12    /**< uint16_t, most significant byte first */
+#define EID_ETLM_MIC_OFFSET  14
+#define EID_ETLM_MIC_LENGTH  2
+#define EID_ETLM_LENGTH      16    /**< Encrypted TLM, salt and MIC as in eTLM frame after version */
+#define EID_EAX_MAX_LENGTH   32    /**< Longest nonce, header or message of eid_eax_encrypt */
+
+/** Return start of rotation period of time, i.e. time with lowest exponent bits cleared */
+uint32_t eid_rotation_start(uint8_t exponent, uint32_t time);
+
+/**
+ *  Compute temporary key of time, valid for 65536 seconds from time with lowest 16 bits cleared.
+ *
+ *  @param p_identity identity key expanded with aes128_init
+ *  @param time       beacon clock, seconds
+ *  @param p_key      16 bytes out
+ */
+void eid_temporary_key(const aes128_t* p_identity, uint32_t time, uint8_t* p_key);
+
+/**
+ *  Compute EID of rotation period of time with temporary key of that time.
+ *
+ *  @param p_temporary temporary key expanded with aes128_init
+ *  @param exponent    rotation period exponent K, 0 ... EID_MAX_EXPONENT
+ *  @param time        beacon clock, seconds
+ *  @param p_eid       EID_LENGTH bytes out
+ */
+void eid_from_temporary(const aes128_t* p_temporary, uint8_t exponent, uint32_t time, uint8_t* p_eid);
+
+/** Compute EID from identity key, two block encryptions and key expansion of temporary key */
+void eid_compute(const aes128_t* p_identity, uint8_t exponent, uint32_t time, uint8_t* p_eid);
+
+/** OMAC of EAX, CMAC over a block of value tweak followed by data of at most EID_EAX_MAX_LENGTH bytes */
+void eid_omac(const aes_cmac_t* p_cmac, uint8_t tweak, const uint8_t* p_data, size_t length, uint8_t* p_mac);
+
+/**
+ *  AES-EAX encryption of Bellare, Rogaway and Wagner with full 16-byte tag.
+ *
+ *  @param p_cmac   CMAC state of key
+ *  @param p_nonce  nonce, nonce_length at most EID_EAX_MAX_LENGTH
+ *  @param p_header authenticated, not encrypted data, header_length at most EID_EAX_MAX_LENGTH
+ *  @param p_plain  message, length at most EID_EAX_MAX_LENGTH
+ *  @param p_cipher length bytes out, may be same as p_plain
+ *  @param p_tag    16 bytes out
+ */
+void eid_eax_encrypt(const aes_cmac_t* p_cmac, const uint8_t* p_nonce, size_t nonce_length,
+                     const uint8_t* p_header, size_t header_length,
+                     const uint8_t* p_plain, size_t length, uint8_t* p_cipher, uint8_t* p_tag);
+
+/**
+ *  Encrypt TLM into eTLM, 6 block encryptions.
+ *
+ *  @param p_cmac CMAC state of identity key
+ *  @param time   beacon clock, seconds
+ *  @param salt   random, must not repeat with same time
+ *  @param p_tlm  EID_ETLM_PLAIN_LENGTH bytes of TLM from VBATT onwards
+ *  @param p_etlm EID_ETLM_LENGTH bytes out
+ */
+void eid_etlm_encrypt(const aes_cmac_t* p_cmac, uint32_t time, uint16_t salt,
+                      const uint8_t* p_tlm, uint8_t* p_etlm);
+
+/** Write nonce of eTLM, 6 bytes */
+void eid_etlm_nonce(uint32_t time, uint16_t salt, uint8_t* p_nonce);
+
+#endif
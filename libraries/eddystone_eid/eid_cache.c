@@ -0,0 +1,120 @@
+#include "eid_cache.h"
+
+#include <string.h>
+
+/** OMAC tweaks of EAX */
+#define EAX_NONCE  0
+#define EAX_HEADER 1
+#define EAX_CIPHER 2
+
+void eid_cache_init(eid_cache_t* p_cache, const uint8_t* p_identity_key, uint8_t exponent)
+{
+  memset(p_cache, 0, sizeof(eid_cache_t));
+  p_cache->exponent = exponent;
+  aes128_init(&p_cache->identity, p_identity_key);
+  aes_cmac_init(&p_cache->cmac, aes128_encrypt, &p_cache->identity);
+  eid_omac(&p_cache->cmac, EAX_HEADER, NULL, 0, p_cache->header_mac);
+  // Ciphertext OMAC runs over tweak block and 12 bytes, first block never changes
+  p_cache->cipher_prefix[AES_BLOCK_SIZE - 1] = EAX_CIPHER;
+  p_cache->cmac.cipher(p_cache->cmac.p_context, p_cache->cipher_prefix, p_cache->cipher_prefix);
+}
+
+/** Compute EID of period starting at start, expanding a new temporary key when epoch changes */
+static void compute_entry(eid_cache_t* p_cache, uint32_t start, eid_cache_entry_t* p_entry)
+{
+  uint16_t epoch = start >> 16;
+  if(!p_cache->temporary_valid || epoch != p_cache->temporary_epoch)
+  {
+    uint8_t key[AES_KEY_SIZE];
+    eid_temporary_key(&p_cache->identity, start, key);
+    aes128_init(&p_cache->temporary, key);
+    p_cache->temporary_epoch = epoch;
+    p_cache->temporary_valid = true;
+  }
+  p_entry->start = start;
+  eid_from_temporary(&p_cache->temporary, p_cache->exponent, start, p_entry->eid);
+}
+
+uint8_t eid_cache_refill(eid_cache_t* p_cache, uint32_t time)
+{
+  uint32_t current = eid_rotation_start(p_cache->exponent, time);
+  uint32_t period  = 1UL << p_cache->exponent;
+  uint8_t  computed = 0;
+
+  // Keep entries of current period onwards, anything else is stale, e.g. after clock was set
+  uint8_t first = 0;
+  while(first < p_cache->eids && p_cache->entries[first].start != current) { first++; }
+  if(first == p_cache->eids) { p_cache->eids = 0; }
+  else if(first)
+  {
+    p_cache->eids -= first;
+    memmove(p_cache->entries, &p_cache->entries[first], p_cache->eids * sizeof(eid_cache_entry_t));
+  }
+
+  while(EID_CACHE_DEPTH > p_cache->eids)
+  {
+    uint32_t start = current + p_cache->eids * period;
+    compute_entry(p_cache, start, &p_cache->entries[p_cache->eids]);
+    p_cache->eids++;
+    computed++;
+  }
+  return computed;
+}
+
+bool eid_cache_get(const eid_cache_t* p_cache, uint32_t time, uint8_t* p_eid)
+{
+  uint32_t start = eid_rotation_start(p_cache->exponent, time);
+  for(uint8_t ii = 0; ii < p_cache->eids; ii++)
+  {
+    if(start != p_cache->entries[ii].start) { continue; }
+    memcpy(p_eid, p_cache->entries[ii].eid, EID_LENGTH);
+    return true;
+  }
+  return false;
+}
+
+void eid_cache_etlm_prepare(eid_cache_t* p_cache, uint32_t time, uint16_t salt)
+{
+  uint8_t nonce[6];
+  uint8_t nonce_mac[AES_BLOCK_SIZE];
+  uint8_t keystream[AES_BLOCK_SIZE];
+  eid_etlm_nonce(time, salt, nonce);
+  eid_omac(&p_cache->cmac, EAX_NONCE, nonce, sizeof(nonce), nonce_mac);
+  // 12 bytes of TLM fit in the first counter block
+  p_cache->cmac.cipher(p_cache->cmac.p_context, nonce_mac, keystream);
+  memcpy(p_cache->etlm_keystream, keystream, EID_ETLM_PLAIN_LENGTH);
+  for(uint8_t ii = 0; ii < AES_BLOCK_SIZE; ii++) { p_cache->etlm_mask[ii] = nonce_mac[ii] ^ p_cache->header_mac[ii]; }
+  p_cache->etlm_time  = time;
+  p_cache->etlm_salt  = salt;
+  p_cache->etlm_ready = true;
+}
+
+bool eid_cache_etlm_get(eid_cache_t* p_cache, uint32_t time, const uint8_t* p_tlm, uint8_t* p_etlm)
+{
+  if(!p_cache->etlm_ready || time != p_cache->etlm_time) { return false; }
+  p_cache->etlm_ready = false;
+
+  // Last CMAC block of ciphertext OMAC: ciphertext padded with 0x80, xor K2 and chaining value
+  uint8_t block[AES_BLOCK_SIZE];
+  for(uint8_t ii = 0; ii < AES_BLOCK_SIZE; ii++)
+  {
+    uint8_t byte = 0x00;
+    if(EID_ETLM_PLAIN_LENGTH > ii)
+    {
+      p_etlm[ii] = p_tlm[ii] ^ p_cache->etlm_keystream[ii];
+      byte = p_etlm[ii];
+    }
+    else if(EID_ETLM_PLAIN_LENGTH == ii) { byte = 0x80; }
+    block[ii] = byte ^ p_cache->cmac.k2[ii] ^ p_cache->cipher_prefix[ii];
+  }
+  p_cache->cmac.cipher(p_cache->cmac.p_context, block, block);
+
+  p_etlm[EID_ETLM_SALT_OFFSET]     = p_cache->etlm_salt >> 8;
+  p_etlm[EID_ETLM_SALT_OFFSET + 1] = p_cache->etlm_salt;
+  for(uint8_t ii = 0; ii < EID_ETLM_MIC_LENGTH; ii++)
+  {
+    p_etlm[EID_ETLM_MIC_OFFSET + ii] = block[ii] ^ p_cache->etlm_mask[ii];
+  }
+  memset(p_cache->etlm_keystream, 0, sizeof(p_cache->etlm_keystream));
+  return true;
+}
@@ -0,0 +1,94 @@
+#ifndef EID_CACHE_H
+#define EID_CACHE_H
+
+/**
+ *  Ahead-of-time computation of Eddystone EID and eTLM frames.
+ *
+ *  Computing an EID takes two block encryptions and a key expansion and an eTLM six
+ *  encryptions. Done when the slot is due, the work delays the frame by a varying amount
+ *  and forces a long spacing after eTLM frames. The cache moves the work to idle time:
+ *   - eid_cache_refill() computes EIDs of the current and following rotation periods,
+ *     a slot crossing a rotation boundary finds its EID ready
+ *   - eid_cache_etlm_prepare() derives the nonce MAC and keystream of the next eTLM,
+ *     only one block encryption of the final MAC is left for eid_cache_etlm_get()
+ *  Keys are expanded once at init, the temporary key once per 65536 seconds.
+ *
+ *  Getters return false on a miss, caller then falls back to eid_compute() or
+ *  eid_etlm_encrypt() and gets the same bytes. Cache is filled with software AES so it
+ *  can run in any context without the ECB peripheral.
+ *
+ *  Portable C99, no SDK dependencies.
+ *
+ *  License: BSD-3
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "aes_cmac.h"
+#include "eid.h"
+
+#define EID_CACHE_DEPTH 2   /**< Rotation periods cached: current and next */
+
+typedef struct {
+  uint32_t start;                  /**< Start of rotation period, seconds */
+  uint8_t  eid[EID_LENGTH];
+}eid_cache_entry_t;
+
+/** Cache of one EID slot. Holds pointers into itself, do not copy after eid_cache_init(). */
+typedef struct {
+  aes128_t          identity;
+  aes_cmac_t        cmac;                             /**< Over identity, OMAC of eTLM */
+  aes128_t          temporary;
+  uint16_t          temporary_epoch;                  /**< Time bits 31..16 of temporary key */
+  bool              temporary_valid;
+  uint8_t           exponent;
+  uint8_t           eids;                             /**< Valid entries, oldest first */
+  eid_cache_entry_t entries[EID_CACHE_DEPTH];
+  uint8_t           header_mac[AES_BLOCK_SIZE];       /**< OMAC of empty eTLM header, fixed per key */
+  uint8_t           cipher_prefix[AES_BLOCK_SIZE];    /**< First CMAC block of ciphertext OMAC, fixed per key */
+  bool              etlm_ready;
+  uint32_t          etlm_time;
+  uint16_t          etlm_salt;
+  uint8_t           etlm_keystream[EID_ETLM_PLAIN_LENGTH];
+  uint8_t           etlm_mask[AES_BLOCK_SIZE];        /**< Nonce MAC xor header MAC */
+}eid_cache_t;
+
+/**
+ *  Set up cache of a slot, expands identity key and computes eTLM constants.
+ *
+ *  @param p_cache        cache to initialise, emptied
+ *  @param p_identity_key 16 bytes
+ *  @param exponent       rotation period exponent K, 0 ... EID_MAX_EXPONENT
+ */
+void eid_cache_init(eid_cache_t* p_cache, const uint8_t* p_identity_key, uint8_t exponent);
+
+/**
+ *  Drop EIDs of periods that have ended and compute missing ones from period of time on.
+ *  Call from idle time, e.g. once a second or after each rotation. Cheap when full.
+ *
+ *  @return number of EIDs computed
+ */
+uint8_t eid_cache_refill(eid_cache_t* p_cache, uint32_t time);
+
+/** Copy EID of time to p_eid, return false if its period is not cached */
+bool eid_cache_get(const eid_cache_t* p_cache, uint32_t time, uint8_t* p_eid);
+
+/**
+ *  Precompute next eTLM of time and salt, three block encryptions.
+ *  Use a period start as time to let the preparation serve any frame of the period.
+ */
+void eid_cache_etlm_prepare(eid_cache_t* p_cache, uint32_t time, uint16_t salt);
+
+/**
+ *  Finish prepared eTLM with TLM data, one block encryption. Preparation is consumed,
+ *  salt is never used twice.
+ *
+ *  @param p_cache cache
+ *  @param time    time of nonce, must match preparation
+ *  @param p_tlm   EID_ETLM_PLAIN_LENGTH bytes of TLM from VBATT onwards
+ *  @param p_etlm  EID_ETLM_LENGTH bytes out, same as eid_etlm_encrypt() with prepared salt
+ *  @return false if no preparation for time, p_etlm is untouched
+ */
+bool eid_cache_etlm_get(eid_cache_t* p_cache, uint32_t time, const uint8_t* p_tlm, uint8_t* p_etlm);
+
+#endif
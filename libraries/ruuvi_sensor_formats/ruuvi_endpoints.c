@@ -1,5 +1,6 @@
 #include "ruuvi_endpoints.h"
 #include "chain_channels.h"
+#include "trace.h"
 
 #define NRF_LOG_MODULE_NAME "ENDPOINTS"
 #include "nrf_log.h"
@@ -18,6 +19,10 @@ static message_handler p_magnetometer_handler      = NULL;
 static message_handler p_gyroscope_handler         = NULL;
 static message_handler p_movement_detector_handler = NULL;
 static message_handler p_mam_handler               = NULL;
+static message_handler p_scheduler_handler         = NULL;
+static message_handler p_trace_handler             = NULL;
+static message_handler p_capture_handler           = NULL;
+static message_handler p_config_handler            = NULL;
 
 /** Chain handler **/
 static message_handler p_chain_handler = NULL;
@@ -47,7 +52,7 @@ void ble_gatt_scheduler_event_handler(void *p_event_data, uint16_t event_size)
  **/
 void route_message(const ruuvi_standard_message_t message)
 {
-    NRF_LOG_INFO("Routing message. %x, %x, %x, \r\n",message.destination_endpoint, message.source_endpoint, message.type);
+    TRACE_INFO("Routing message. %x, %x, %x, \r\n",message.destination_endpoint, message.source_endpoint, message.type);
     switch(message.destination_endpoint)
     {
       case PLAINTEXT_MESSAGE:
@@ -69,8 +74,23 @@ void route_message(const ruuvi_standard_message_t message)
         else {unknown_handler(message); }
         break;
 
+      case SCHEDULER:
+        if(p_scheduler_handler) {p_scheduler_handler(message); } 
+        else {unknown_handler(message); }
+        break;
+
+      case TRACE:
+        if(p_trace_handler) {p_trace_handler(message); } 
+        else {unknown_handler(message); }
+        break;
+
+      case CONFIG:
+        if(p_config_handler) {p_config_handler(message); } 
+        else {unknown_handler(message); }
+        break;
+
       case TEMPERATURE:
-        NRF_LOG_DEBUG("Message is a temperature message.\r\n");
+        TRACE_DEBUG("Message is a temperature message.\r\n");
         if(p_temperature_handler) {p_temperature_handler(message); } 
         else {unknown_handler(message); }
         break;
@@ -110,6 +130,11 @@ void route_message(const ruuvi_standard_message_t message)
         else {unknown_handler(message); }
         break;
 
+      case CAPTURE:
+        if(p_capture_handler) {p_capture_handler(message); } 
+        else {unknown_handler(message); }
+        break;
+
       case MAM:
         if(p_mam_handler) {p_mam_handler(message); } 
         else {unknown_handler(message); }
@@ -146,6 +171,26 @@ void set_mam_handler(message_handler handler)
   p_mam_handler = handler;
 }
 
+void set_scheduler_handler(message_handler handler)
+{
+  p_scheduler_handler = handler;
+}
+
+void set_trace_handler(message_handler handler)
+{
+  p_trace_handler = handler;
+}
+
+void set_capture_handler(message_handler handler)
+{
+  p_capture_handler = handler;
+}
+
+void set_config_handler(message_handler handler)
+{
+  p_config_handler = handler;
+}
+
 void set_reply_handler(message_handler handler)
 {
   p_reply_handler = handler;
@@ -239,7 +284,7 @@ message_handler get_chain_handler(void)
 // Send payload back to source with type "UNKNOWN"
 ret_code_t unknown_handler(const ruuvi_standard_message_t message)
 {
-  NRF_LOG_INFO("Unknown message. %x, %x, %x, \r\n",message.destination_endpoint, message.source_endpoint, message.type);
+  TRACE_INFO("Unknown message. %x, %x, %x, \r\n",message.destination_endpoint, message.source_endpoint, message.type);
   ruuvi_standard_message_t reply = { .destination_endpoint = message.source_endpoint,
                                      .source_endpoint = message.destination_endpoint,
                                      .type = UNKNOWN,
@@ -14,6 +14,9 @@ typedef enum{
   RNG                     = 0x21, // Random number
   RTC                     = 0x22, // Real time clock 
   NFC                     = 0x23, // NFC message
+  SCHEDULER               = 0x24, // Scheduler diagnostics
+  TRACE                   = 0x25, // Deferred binary log
+  CONFIG                  = 0x26, // Runtime configuration store
   TEMPERATURE             = 0x31, // Temperature message
   HUMIDITY                = 0x32,
   PRESSURE                = 0x33,
@@ -23,6 +26,9 @@ typedef enum{
   MAGNETOMETER            = 0x41,
   GYROSCOPE               = 0x42,
   MOVEMENT_DETECTOR       = 0x43, 
+  VIBRATION               = 0x44, // Spectral summary of acceleration: RMS, peak frequency and amplitude, tracked amplitude
+  VIBRATION_BANDS         = 0x45, // RMS of acceleration in octave bands
+  CAPTURE                 = 0x46, // Acceleration around activity event, downloaded in bulk
   // endpoints 0x50 ... 0x5F are reserved for chain handlers, however they're not enumerated but rather called dynamically
   MAM                     = 0xE0  // Masked Authenticated Messaging
 }ruuvi_endpoint_t;
@@ -90,6 +96,7 @@ typedef enum {
   DSP_IMPULSE   = 6,
   DSP_LOW_PASS  = 7,
   DSP_HIGH_PASS = 8,
+  DSP_SPECTRUM  = 9,   // Spectral analysis of blocks, parameter is tracked frequency in Hz
   DSP_VECTOR    = 128
 }ruuvi_dsp_function_t;
 
@@ -191,6 +198,10 @@ ret_code_t unknown_handler(const ruuvi_standard_message_t message);
 void set_temperature_handler(message_handler handler);
 void set_acceleration_handler(message_handler handler);
 void set_mam_handler(message_handler handler);
+void set_scheduler_handler(message_handler handler);
+void set_trace_handler(message_handler handler);
+void set_capture_handler(message_handler handler);
+void set_config_handler(message_handler handler);
 void set_unknown_handler(message_handler handler);
 
 // Data transmission handlers
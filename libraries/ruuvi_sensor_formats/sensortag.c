@@ -4,6 +4,7 @@
 #include "sensortag.h"
 
 #include <stdint.h>
+#include <string.h>
 #include "nrf52.h"
 #include "nrf52_bitfields.h"
 
@@ -13,23 +14,19 @@
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 
-/**
- *  Parses sensor values into propesed format. 
- *  Note: calling this function has side effect of incrementing packet counter
- *  Changes values in "environmental" as they're paresed to ruuvi format
- *
- *  @param data_buffer uint8_t array with length of 24 bytes
- *  @param environmental  Environmental data as data comes from BME280, i.e. uint32_t pressure, int32_t temperature, uint32_t humidity
- *  @param acceleration 3 x int16_t having acceleration along X-Y-Z axes in MG. Low pass and last sample are allowed DSP operations
- *  @param acceleration_events counter of acceleration events. Events are configured by application, "value exceeds 1.1 G" recommended.
- *  @param vbatt Voltage of battery in millivolts
- *  @param tx_pwr power in dBm, -40 ... 16
- *
- */
-void encodeToRawFormat5(uint8_t* data_buffer, const ruuvi_sensor_t* const data, uint16_t acceleration_events, int8_t tx_pwr)
+void getDeviceAddress(uint8_t* address)
+{
+    address[0] = ((NRF_FICR->DEVICEADDR[1]>>8)&0xFF) | 0xC0; //2 MSB must be 11;
+    address[1] = ((NRF_FICR->DEVICEADDR[1]>>0)&0xFF);
+    address[2] = ((NRF_FICR->DEVICEADDR[0]>>24)&0xFF);
+    address[3] = ((NRF_FICR->DEVICEADDR[0]>>16)&0xFF);
+    address[4] = ((NRF_FICR->DEVICEADDR[0]>>8)&0xFF);
+    address[5] = ((NRF_FICR->DEVICEADDR[0]>>0)&0xFF);
+}
+
+/** Bytes 1-15 of RAWv2, shared by authenticated format */
+static void encodeRawFormat5Fields(uint8_t* data_buffer, const ruuvi_sensor_t* const data, uint16_t acceleration_events, int8_t tx_pwr)
 {
-    static uint32_t packet_counter = 0;
-    data_buffer[0] = RAW_FORMAT_2;
     int32_t temperature = data->temperature;
     temperature *= 2; //Spec calls for 0.005 degree resolution, bme280 gives 0.01
     if(data->temperature == TEMPERATURE_INVALID) { temperature = TEMPERATURE_INVALID; }
@@ -62,16 +59,67 @@ void encodeToRawFormat5(uint8_t* data_buffer, const ruuvi_sensor_t* const data,
     tx_pwr /= 2;
     data_buffer[14] |= (tx_pwr)&0x1F; //5 lowest bits for TX pwr
     data_buffer[15] = acceleration_events % 256; // 0 may indicate a multiple of 256 events, not necessarily no events
+}
+
+/**
+ *  Parses sensor values into propesed format. 
+ *  Note: calling this function has side effect of incrementing packet counter
+ *  Changes values in "environmental" as they're paresed to ruuvi format
+ *
+ *  @param data_buffer uint8_t array with length of 24 bytes
+ *  @param environmental  Environmental data as data comes from BME280, i.e. uint32_t pressure, int32_t temperature, uint32_t humidity
+ *  @param acceleration 3 x int16_t having acceleration along X-Y-Z axes in MG. Low pass and last sample are allowed DSP operations
+ *  @param acceleration_events counter of acceleration events. Events are configured by application, "value exceeds 1.1 G" recommended.
+ *  @param vbatt Voltage of battery in millivolts
+ *  @param tx_pwr power in dBm, -40 ... 16
+ *
+ */
+void encodeToRawFormat5(uint8_t* data_buffer, const ruuvi_sensor_t* const data, uint16_t acceleration_events, int8_t tx_pwr)
+{
+    static uint32_t packet_counter = 0;
+    data_buffer[0] = RAW_FORMAT_2;
+    encodeRawFormat5Fields(data_buffer, data, acceleration_events, tx_pwr);
     data_buffer[16] = packet_counter>>8;
     data_buffer[17] = packet_counter&0xFF;
     packet_counter++;
-    data_buffer[18] = ((NRF_FICR->DEVICEADDR[1]>>8)&0xFF) | 0xC0; //2 MSB must be 11;
-    data_buffer[19] = ((NRF_FICR->DEVICEADDR[1]>>0)&0xFF);
-    data_buffer[20] = ((NRF_FICR->DEVICEADDR[0]>>24)&0xFF);
-    data_buffer[21] = ((NRF_FICR->DEVICEADDR[0]>>16)&0xFF);
-    data_buffer[22] = ((NRF_FICR->DEVICEADDR[0]>>8)&0xFF);
-    data_buffer[23] = ((NRF_FICR->DEVICEADDR[0]>>0)&0xFF);
+    getDeviceAddress(&data_buffer[18]);
+}
 
+void encodeToAuthenticatedFormat(uint8_t* data_buffer, const ruuvi_sensor_t* const data, uint16_t acceleration_events, int8_t tx_pwr)
+{
+    data_buffer[0] = AUTHENTICATED_FORMAT;
+    encodeRawFormat5Fields(data_buffer, data, acceleration_events, tx_pwr);
+    memset(&data_buffer[16], 0, AUTHENTICATED_ENCODED_DATA_LENGTH - 16);
+}
+
+void encodeToVibrationFormat(uint8_t* data_buffer, const uint16_t summary[4], const uint16_t bands[4], uint16_t sequence)
+{
+    data_buffer[0] = VIBRATION_FORMAT;
+    for(uint8_t ii = 0; ii < 4; ii++)
+    {
+        data_buffer[1 + 2 * ii] = summary[ii]>>8;
+        data_buffer[2 + 2 * ii] = summary[ii]&0xFF;
+        data_buffer[9 + 2 * ii] = bands[ii]>>8;
+        data_buffer[10 + 2 * ii] = bands[ii]&0xFF;
+    }
+    data_buffer[17] = sequence&0xFF;
+    getDeviceAddress(&data_buffer[18]);
+}
+
+void encodeToGestureFormat(uint8_t* data_buffer, uint8_t event, uint8_t detail, uint8_t face, const uint16_t counters[4], uint16_t sequence)
+{
+    data_buffer[0] = GESTURE_FORMAT;
+    data_buffer[1] = event;
+    data_buffer[2] = detail;
+    data_buffer[3] = face;
+    for(uint8_t ii = 0; ii < 4; ii++)
+    {
+        data_buffer[4 + 2 * ii] = counters[ii]>>8;
+        data_buffer[5 + 2 * ii] = counters[ii]&0xFF;
+    }
+    memset(&data_buffer[12], 0, 5);
+    data_buffer[17] = sequence&0xFF;
+    getDeviceAddress(&data_buffer[18]);
 }
 
 /**
@@ -137,21 +185,30 @@ void encodeToUrlDataFromat(char* url, uint8_t base_length, ruuvi_sensor_t* data)
     //serialize values into a string
     char pack[8] = {0};
     pack[0] = WEATHER_STATION_URL_ID_FORMAT;
-    uint8_t humidity = (data->humidity + 2) / 4; //Round to 2 %, add 2 % to round properly
-    pack[1] = humidity * 4;
-    int16_t temperature = data->temperature;
-    pack[2] = (temperature) >> 8;
-    if((temperature&0xFF) > 49) pack[2] += 1;
-    pack[3] = 0;          //Round off decimals
-    uint16_t pressure =   data->pressure + 50; // rounding
+    // Humidity in 0.5 % steps, rounded to 2 %
+    uint32_t humidity = data->humidity;
+    if(data->humidity == HUMIDITY_INVALID) { humidity = 0; }
+    pack[1] = ((humidity + 1024) / 2048) * 4;
+    // Whole degrees with sign bit as in RAWv1, round off decimals
+    int32_t temperature = data->temperature;
+    if(data->temperature == TEMPERATURE_INVALID) { temperature = 0; }
+    bool negative = (temperature < 0);
+    if(negative) { temperature = 0 - temperature; }
+    pack[2] = ((temperature + 50) / 100) & 0x7F;
+    pack[2] |= (negative<<7 & 0x80);
+    pack[3] = 0;
+    uint32_t pressure = data->pressure;
+    if(data->pressure == PRESSURE_INVALID) { pressure = 50000<<8; }
+    pressure = (pressure >> 8) + 50; // Scale into pa, round
     pressure = pressure - (pressure % 100); //Round pressure to hPa accuracy
+    pressure = (uint16_t)(pressure - 50000); //Shift by -50000 pa as per Ruu.vi interface.
     pack[4] = (pressure)>>8;
     pack[5] = (pressure)&0xFF;
     pack[6] = serial[0];
   
      
     /// Encoding 48 bits using Base64 produces max 8 chars.
-    memset(&(url[base_length]), 0, sizeof(URL_PAYLOAD_LENGTH));
+    memset(&(url[base_length]), 0, URL_PAYLOAD_LENGTH);
     base64encode(pack, sizeof(pack), &(url[base_length]), URL_PAYLOAD_LENGTH);
 
 }
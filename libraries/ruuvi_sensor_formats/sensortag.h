@@ -23,6 +23,45 @@
 #define RAW_FORMAT_2                    0x05          /**< Proposal, please see https://f.ruuvi.com/t/proposed-next-high-precision-data-format/692 */
 #define RAW_2_ENCODED_DATA_LENGTH       24
 
+/*
+0:     uint8_t   format;          // 0xF0, experimental
+1-2:   uint16_t  rms;             // mg, acceleration around mean
+3-4:   uint16_t  peak_frequency;  // 0.1 Hz
+5-6:   uint16_t  peak;            // mg, amplitude of largest peak
+7-8:   uint16_t  tracked;         // mg, amplitude at tracked frequency
+9-16:  uint16_t  bands[4];        // mg, RMS of octave bands, lowest first
+17:    uint8_t   sequence;        // Count of analysed blocks
+18-23: uint8_t   mac[6];
+*/
+#define VIBRATION_FORMAT                0xF0          /**< Experimental spectral summary of acceleration */
+#define VIBRATION_ENCODED_DATA_LENGTH   24
+
+/*
+0:     uint8_t   format;          // 0xF1, experimental
+1:     uint8_t   event;           // Type of latest event, lis2dh12_gesture_type_t
+2:     uint8_t   detail;          // Tap: sign and axis bits of CLICK_SRC, orientation: face
+3:     uint8_t   face;            // Latest orientation, lis2dh12_face_t
+4-5:   uint16_t  taps;
+6-7:   uint16_t  double_taps;
+8-9:   uint16_t  orientation_changes;
+10-11: uint16_t  freefalls;
+12-16: uint8_t   reserved[5];     // 0
+17:    uint8_t   sequence;        // Count of all events
+18-23: uint8_t   mac[6];
+*/
+#define GESTURE_FORMAT                  0xF1          /**< Experimental accelerometer event counters */
+#define GESTURE_ENCODED_DATA_LENGTH     24
+
+/*
+0:     uint8_t   format;          // 0xF2, experimental
+1-15:  as RAWv2
+16-19: uint32_t  counter;         // Never repeats for a key, see libraries/adv_auth
+20-23: uint8_t   tag[4];          // AES-CMAC of MAC and bytes 0-19, truncated
+MAC is not sent, receivers take it from address of advertisement.
+*/
+#define AUTHENTICATED_FORMAT            0xF2          /**< Experimental RAWv2 with authentication tag */
+#define AUTHENTICATED_ENCODED_DATA_LENGTH 24
+
 #define WEATHER_STATION_URL_FORMAT      0x02				  /**< Base64 */
 #define WEATHER_STATION_URL_ID_FORMAT   0x04				  /**< Base64, with ID byte */
 
@@ -83,6 +122,37 @@ void encodeToRawFormat3(uint8_t* data_buffer, const ruuvi_sensor_t* const data);
  */
 void encodeToRawFormat5(uint8_t* data_buffer,  const ruuvi_sensor_t* const data, uint16_t acceleration_events, int8_t tx_pwr);
 
+/**
+ *  Parses sensor values into experimental authenticated format. Counter and tag are
+ *  zeroed, adv_auth_sign() writes them.
+ *  @param data_buffer uint8_t array with length of AUTHENTICATED_ENCODED_DATA_LENGTH bytes
+ *  @param acceleration_events, tx_pwr as in RAWv2
+ */
+void encodeToAuthenticatedFormat(uint8_t* data_buffer, const ruuvi_sensor_t* const data, uint16_t acceleration_events, int8_t tx_pwr);
+
+/**
+ *  Writes static random device address of nRF52, most significant byte first as in RAWv2
+ *  @param address uint8_t array with length of 6 bytes
+ */
+void getDeviceAddress(uint8_t* address);
+
+/**
+ *  Encodes spectral summary of acceleration into experimental vibration format
+ *  @param data_buffer uint8_t array with length of VIBRATION_ENCODED_DATA_LENGTH bytes
+ *  @param summary RMS, peak frequency, peak amplitude and tracked amplitude as in VIBRATION endpoint payload
+ *  @param bands RMS of octave bands as in VIBRATION_BANDS endpoint payload
+ *  @param sequence count of analysed blocks, lowest byte is sent
+ */
+void encodeToVibrationFormat(uint8_t* data_buffer, const uint16_t summary[4], const uint16_t bands[4], uint16_t sequence);
+
+/**
+ *  Encodes latest accelerometer event and event counters into experimental gesture format
+ *  @param data_buffer uint8_t array with length of GESTURE_ENCODED_DATA_LENGTH bytes
+ *  @param event type, detail and current face as in lis2dh12_gesture_counters_t
+ *  @param counters taps, double taps, orientation changes and free-falls
+ *  @param sequence count of all events, lowest byte is sent
+ */
+void encodeToGestureFormat(uint8_t* data_buffer, uint8_t event, uint8_t detail, uint8_t face, const uint16_t counters[4], uint16_t sequence);
 
 /**
  *  Encodes sensor data into given char* url. The base url must have the base of url written by caller.
@@ -0,0 +1,296 @@
+#include "scheduler.h"
+
+#include <string.h>
+#include "app_util_platform.h"
+#include "nordic_common.h"
+#include "nrf_error.h"
+
+#define NRF_LOG_MODULE_NAME "SCHEDULER"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+/** Queued event, data is word-aligned for handlers */
+typedef struct {
+  app_sched_event_handler_t handler;
+  uint32_t enqueued;
+  uint16_t size;
+  bool     continuation;
+  uint32_t data[(SCHEDULER_MAX_EVENT_DATA_SIZE + 3) / 4];
+}scheduler_event_t;
+
+/** Ring buffer of one class. Slot at head is released after its handler returns. */
+typedef struct {
+  scheduler_event_t* events;
+  uint8_t size;
+  uint8_t head;
+  uint8_t count;
+}scheduler_queue_t;
+
+static scheduler_event_t realtime_events[SCHEDULER_QUEUE_SIZE_REALTIME];
+static scheduler_event_t io_events[SCHEDULER_QUEUE_SIZE_IO];
+static scheduler_event_t background_events[SCHEDULER_QUEUE_SIZE_BACKGROUND];
+
+static scheduler_queue_t queues[SCHEDULER_PRIORITY_COUNT] = {
+  { realtime_events,   SCHEDULER_QUEUE_SIZE_REALTIME,   0, 0 },
+  { io_events,         SCHEDULER_QUEUE_SIZE_IO,         0, 0 },
+  { background_events, SCHEDULER_QUEUE_SIZE_BACKGROUND, 0, 0 }
+};
+
+static const uint32_t budgets[SCHEDULER_PRIORITY_COUNT] = {
+  SCHEDULER_BUDGET_REALTIME, SCHEDULER_BUDGET_IO, SCHEDULER_BUDGET_BACKGROUND
+};
+
+static scheduler_time_fn_t       time_source = NULL;
+static scheduler_stats_t         stats;
+static scheduler_handler_stats_t handler_stats[SCHEDULER_MAX_HANDLERS];
+
+// Event being executed, NULL outside of handler
+static scheduler_event_t*   current = NULL;
+static scheduler_priority_t current_priority;
+static uint32_t             current_start;
+static bool                 continued;
+static scheduler_event_t    continuation;
+
+static uint32_t now(void)
+{
+  return (NULL == time_source) ? 0 : time_source() & SCHEDULER_TICKS_MASK;
+}
+
+static uint32_t elapsed(uint32_t since)
+{
+  return (now() - since) & SCHEDULER_TICKS_MASK;
+}
+
+static void saturating_increment(uint16_t* counter)
+{
+  if(UINT16_MAX > *counter) { (*counter)++; }
+}
+
+static void histogram_add(uint16_t* histogram, uint32_t ticks)
+{
+  uint8_t bin = 0;
+  while(ticks && bin < (SCHEDULER_HISTOGRAM_BINS - 1))
+  {
+    ticks >>= 1;
+    bin++;
+  }
+  saturating_increment(&histogram[bin]);
+}
+
+/** Find handler from table, add it if there is space. Call in critical region. */
+static scheduler_handler_stats_t* handler_find(app_sched_event_handler_t handler)
+{
+  for(uint8_t ii = 0; ii < stats.handlers; ii++)
+  {
+    if(handler_stats[ii].handler == handler) { return &handler_stats[ii]; }
+  }
+  if(SCHEDULER_MAX_HANDLERS > stats.handlers)
+  {
+    scheduler_handler_stats_t* entry = &handler_stats[stats.handlers++];
+    memset(entry, 0, sizeof(*entry));
+    entry->handler = handler;
+    return entry;
+  }
+  return NULL;
+}
+
+/** Copy event to tail of queue. Call in critical region. */
+static ret_code_t queue_push(scheduler_queue_t* queue, const scheduler_event_t* event)
+{
+  if(queue->count >= queue->size) { return NRF_ERROR_NO_MEM; }
+  memcpy(&queue->events[(queue->head + queue->count) % queue->size], event, sizeof(*event));
+  queue->count++;
+  return NRF_SUCCESS;
+}
+
+/** Return highest class with events, SCHEDULER_PRIORITY_COUNT if none. */
+static scheduler_priority_t highest_pending(scheduler_priority_t below)
+{
+  for(uint8_t priority = 0; priority < below; priority++)
+  {
+    if(queues[priority].count) { return priority; }
+  }
+  return SCHEDULER_PRIORITY_COUNT;
+}
+
+/** Run event at head of given queue and record statistics */
+static void dispatch(scheduler_priority_t priority)
+{
+  scheduler_queue_t* queue = &queues[priority];
+  scheduler_handler_stats_t* entry;
+  // Head is not written by interrupts, only tail
+  scheduler_event_t* event = &queue->events[queue->head];
+  uint32_t latency = elapsed(event->enqueued);
+  bool resumed = event->continuation;
+  CRITICAL_REGION_ENTER();
+  entry = handler_find(event->handler);
+  CRITICAL_REGION_EXIT();
+
+  current = event;
+  current_priority = priority;
+  continued = false;
+  current_start = now();
+  event->handler(event->size ? event->data : NULL, event->size);
+  uint32_t execution = elapsed(current_start);
+  current = NULL;
+
+  CRITICAL_REGION_ENTER();
+  queue->head = (queue->head + 1) % queue->size;
+  queue->count--;
+  // Slot of the event was just released, continuation always fits
+  if(continued) { queue_push(queue, &continuation); }
+  else
+  {
+    if(stats.pending) { stats.pending--; }
+    if(entry && entry->pending) { entry->pending--; }
+  }
+  CRITICAL_REGION_EXIT();
+
+  if(NULL == entry) { return; }
+  entry->dispatched++;
+  if(!resumed)
+  {
+    histogram_add(entry->latency_histogram, latency);
+    if(latency > entry->latency_max) { entry->latency_max = latency; }
+  }
+  histogram_add(entry->execution_histogram, execution);
+  if(execution > entry->execution_max) { entry->execution_max = execution; }
+  if(execution > budgets[priority]) { saturating_increment(&entry->overruns); }
+  if(continued) { saturating_increment(&entry->continued); }
+}
+
+void scheduler_priority_init(scheduler_time_fn_t time_fn)
+{
+  CRITICAL_REGION_ENTER();
+  time_source = time_fn;
+  for(uint8_t ii = 0; ii < SCHEDULER_PRIORITY_COUNT; ii++)
+  {
+    queues[ii].head = 0;
+    queues[ii].count = 0;
+  }
+  memset(&stats, 0, sizeof(stats));
+  memset(handler_stats, 0, sizeof(handler_stats));
+  CRITICAL_REGION_EXIT();
+}
+
+ret_code_t scheduler_event_put(void const* p_data, uint16_t size, app_sched_event_handler_t handler,
+                               scheduler_priority_t priority)
+{
+  if(SCHEDULER_MAX_EVENT_DATA_SIZE < size) { return NRF_ERROR_INVALID_LENGTH; }
+  if(SCHEDULER_PRIORITY_COUNT <= priority) { return NRF_ERROR_INVALID_PARAM; }
+
+  scheduler_event_t event = { .handler = handler, .enqueued = now(), .size = size, .continuation = false };
+  if(size) { memcpy(event.data, p_data, size); }
+
+  ret_code_t err_code;
+  CRITICAL_REGION_ENTER();
+  scheduler_handler_stats_t* entry = handler_find(handler);
+  if(NULL == entry) { saturating_increment(&stats.untracked); }
+  err_code = queue_push(&queues[priority], &event);
+  if(NRF_SUCCESS == err_code)
+  {
+    stats.pending++;
+    if(stats.pending > stats.pending_peak) { stats.pending_peak = stats.pending; }
+    if(entry)
+    {
+      entry->priority = priority;
+      entry->pending++;
+      if(entry->pending > entry->pending_peak) { entry->pending_peak = entry->pending; }
+    }
+  }
+  else
+  {
+    saturating_increment(&stats.dropped);
+    if(entry) { saturating_increment(&entry->dropped); }
+  }
+  CRITICAL_REGION_EXIT();
+
+  if(NRF_SUCCESS != err_code) { NRF_LOG_WARNING("Event dropped: %d\r\n", err_code); }
+  return err_code;
+}
+
+void scheduler_execute(void)
+{
+  scheduler_priority_t priority;
+  do
+  {
+    // Timer handlers may queue real-time events, run them before picking next event
+    app_sched_execute();
+    priority = highest_pending(SCHEDULER_PRIORITY_COUNT);
+    if(SCHEDULER_PRIORITY_COUNT != priority) { dispatch(priority); }
+  } while(SCHEDULER_PRIORITY_COUNT != priority);
+}
+
+bool scheduler_budget_exceeded(void)
+{
+  if(NULL == current) { return false; }
+  if(SCHEDULER_PRIORITY_COUNT != highest_pending(current_priority)) { return true; }
+  return elapsed(current_start) >= budgets[current_priority];
+}
+
+ret_code_t scheduler_continue(void const* p_data, uint16_t size)
+{
+  if(NULL == current) { return NRF_ERROR_INVALID_STATE; }
+  if(SCHEDULER_MAX_EVENT_DATA_SIZE < size) { return NRF_ERROR_INVALID_LENGTH; }
+
+  // p_data may point to data of current event, which stays valid until handler returns
+  continuation.handler = current->handler;
+  continuation.enqueued = now();
+  continuation.size = size;
+  continuation.continuation = true;
+  if(size) { memmove(continuation.data, p_data, size); }
+  continued = true;
+  return NRF_SUCCESS;
+}
+
+uint32_t scheduler_budget_get(scheduler_priority_t priority)
+{
+  return (SCHEDULER_PRIORITY_COUNT > priority) ? budgets[priority] : 0;
+}
+
+const scheduler_stats_t* scheduler_stats_get(void)
+{
+  return &stats;
+}
+
+const scheduler_handler_stats_t* scheduler_handler_stats_get(uint8_t index)
+{
+  return (index < stats.handlers) ? &handler_stats[index] : NULL;
+}
+
+uint32_t scheduler_histogram_percentile(const uint16_t* histogram, uint32_t max, uint16_t permille)
+{
+  uint32_t total = 0;
+  for(uint8_t ii = 0; ii < SCHEDULER_HISTOGRAM_BINS; ii++) { total += histogram[ii]; }
+  if(0 == total) { return 0; }
+
+  uint32_t target = (total * permille + 999) / 1000;
+  uint32_t count = 0;
+  for(uint8_t ii = 0; ii < SCHEDULER_HISTOGRAM_BINS - 1; ii++)
+  {
+    count += histogram[ii];
+    if(count >= target) { return MIN((1UL << ii) - 1, max); }
+  }
+  return max;
+}
+
+void scheduler_stats_reset(void)
+{
+  CRITICAL_REGION_ENTER();
+  stats.pending_peak = stats.pending;
+  stats.dropped = 0;
+  stats.untracked = 0;
+  for(uint8_t ii = 0; ii < stats.handlers; ii++)
+  {
+    scheduler_handler_stats_t* entry = &handler_stats[ii];
+    uint8_t pending = entry->pending;
+    uint8_t priority = entry->priority;
+    app_sched_event_handler_t handler = entry->handler;
+    memset(entry, 0, sizeof(*entry));
+    entry->handler = handler;
+    entry->priority = priority;
+    entry->pending = pending;
+    entry->pending_peak = pending;
+  }
+  CRITICAL_REGION_EXIT();
+}
@@ -0,0 +1,190 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+/**
+ *  Priority-aware cooperative scheduler with statistics.
+ *
+ *  Events are queued to one of three priority classes and run from main context by
+ *  scheduler_execute(). The highest non-empty class is always served first, events
+ *  within a class run in FIFO order. Nordic app_scheduler is still used by app_timer
+ *  and SoftDevice event dispatch, its queue is executed before every event of this
+ *  scheduler so that timer handlers can queue real-time work without delay.
+ *
+ *  Handlers run to completion, there is no preemption. Long handlers keep latency of
+ *  higher classes bounded by splitting their work: they poll scheduler_budget_exceeded()
+ *  and call scheduler_continue() with their state to be resumed later.
+ *
+ *  For each handler the scheduler records:
+ *   - enqueue to dispatch latency, histogram and maximum
+ *   - execution time of handler, histogram and maximum
+ *   - events dropped because queue was full
+ *   - events currently in queue and peak of it
+ *   - continuations and runs which exceeded the time budget of their class
+ *
+ *  Time is measured in ticks of the time source given to scheduler_priority_init(), in firmware
+ *  this is the RTC1 counter of app_timer.
+ *
+ *  License: BSD-3
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "app_scheduler.h"
+#include "sdk_errors.h"
+
+/** Priority classes, highest first */
+typedef enum {
+  SCHEDULER_PRIORITY_REALTIME = 0, /**< Sensor sampling and advertisement updates */
+  SCHEDULER_PRIORITY_IO,           /**< GATT messages, NFC, mode changes */
+  SCHEDULER_PRIORITY_BACKGROUND,   /**< Flash writes and GC, log compaction */
+  SCHEDULER_PRIORITY_COUNT
+}scheduler_priority_t;
+
+/** Queue sizes of classes, in events */
+#ifndef SCHEDULER_QUEUE_SIZE_REALTIME
+  #define SCHEDULER_QUEUE_SIZE_REALTIME   8
+#endif
+#ifndef SCHEDULER_QUEUE_SIZE_IO
+  #define SCHEDULER_QUEUE_SIZE_IO         8
+#endif
+#ifndef SCHEDULER_QUEUE_SIZE_BACKGROUND
+  #define SCHEDULER_QUEUE_SIZE_BACKGROUND 4
+#endif
+
+/** Time budgets of classes in ticks, 2048 Hz RTC1 by default. Handlers should yield after budget. */
+#ifndef SCHEDULER_BUDGET_REALTIME
+  #define SCHEDULER_BUDGET_REALTIME       41  // 20 ms
+#endif
+#ifndef SCHEDULER_BUDGET_IO
+  #define SCHEDULER_BUDGET_IO             20  // 10 ms
+#endif
+#ifndef SCHEDULER_BUDGET_BACKGROUND
+  #define SCHEDULER_BUDGET_BACKGROUND     10  // 5 ms
+#endif
+
+/** Maximum number of handlers which are tracked. Events of other handlers are run, but not tracked. */
+#ifndef SCHEDULER_MAX_HANDLERS
+  #define SCHEDULER_MAX_HANDLERS   10
+#endif
+
+/** Histogram bin 0 counts 0 ticks, bin n counts [2^(n-1), 2^n) ticks, last bin is open-ended. */
+#ifndef SCHEDULER_HISTOGRAM_BINS
+  #define SCHEDULER_HISTOGRAM_BINS 12
+#endif
+
+/** Time source is a free running counter of this width, RTC counter is 24 bits */
+#ifndef SCHEDULER_TICKS_MASK
+  #define SCHEDULER_TICKS_MASK     0x00FFFFFF
+#endif
+
+/** Largest payload which can be put to scheduler, fits ruuvi_standard_message_t */
+#ifndef SCHEDULER_MAX_EVENT_DATA_SIZE
+  #define SCHEDULER_MAX_EVENT_DATA_SIZE 12
+#endif
+
+/** Returns current time in ticks */
+typedef uint32_t(*scheduler_time_fn_t)(void);
+
+/** Statistics of one handler. Times are in ticks. */
+typedef struct {
+  app_sched_event_handler_t handler;
+  uint8_t  priority;                                      /**< Class of latest event of handler */
+  uint32_t dispatched;                                    /**< Events run */
+  uint16_t dropped;                                       /**< Events lost to full queue, saturates */
+  uint16_t continued;                                     /**< Runs which deferred rest of work, saturates */
+  uint16_t overruns;                                      /**< Runs longer than budget of class, saturates */
+  uint8_t  pending;                                       /**< Events in queue now */
+  uint8_t  pending_peak;                                  /**< Highest number of events in queue at once */
+  uint32_t latency_max;                                   /**< Longest time from put to dispatch */
+  uint32_t execution_max;                                 /**< Longest execution time of handler */
+  uint16_t latency_histogram[SCHEDULER_HISTOGRAM_BINS];   /**< Saturating counts */
+  uint16_t execution_histogram[SCHEDULER_HISTOGRAM_BINS]; /**< Saturating counts */
+}scheduler_handler_stats_t;
+
+/** Statistics of all queues */
+typedef struct {
+  uint8_t  pending;       /**< Events in queues now */
+  uint8_t  pending_peak;  /**< Highest number of events in queues at once */
+  uint16_t dropped;       /**< Events lost to full queue, saturates */
+  uint16_t untracked;     /**< Events of handlers which did not fit into handler table */
+  uint8_t  handlers;      /**< Number of tracked handlers */
+}scheduler_stats_t;
+
+/**
+ *  Clear queues and statistics, set time source. app_scheduler must be initialized
+ *  separately with APP_SCHED_INIT.
+ *
+ *  @param time_fn function returning current time in ticks, NULL to disable timing and budgets
+ */
+void scheduler_priority_init(scheduler_time_fn_t time_fn);
+
+/**
+ *  Put event to queue of given class. Safe to call from interrupt context.
+ *
+ *  @param p_data data to copy to queue, may be NULL if size is 0
+ *  @param size size of data, at most SCHEDULER_MAX_EVENT_DATA_SIZE
+ *  @param handler function to call from scheduler_execute
+ *  @param priority class of event
+ *
+ *  @return NRF_SUCCESS on success
+ *  @return NRF_ERROR_INVALID_LENGTH if size is too large
+ *  @return NRF_ERROR_INVALID_PARAM if priority is not a valid class
+ *  @return NRF_ERROR_NO_MEM if queue is full, event is counted as dropped
+ */
+ret_code_t scheduler_event_put(void const* p_data, uint16_t size, app_sched_event_handler_t handler,
+                               scheduler_priority_t priority);
+
+/**
+ *  Run queued events, highest class first, until all queues are empty.
+ *  app_scheduler queue is executed before each event. Call from main loop.
+ */
+void scheduler_execute(void);
+
+/**
+ *  Check if running handler should yield. Call from handler.
+ *
+ *  @return true if handler has run over budget of its class or if an event of
+ *          higher class is waiting, false otherwise or if called outside of handler
+ */
+bool scheduler_budget_exceeded(void);
+
+/**
+ *  Defer rest of work of running handler. Handler is called again with given data
+ *  after other events which are already queued to same or higher class. Call from
+ *  handler, which should return right after. The slot of running event is reused,
+ *  so continuation cannot be dropped. Latency of continuation is not recorded.
+ *
+ *  @param p_data state to pass to next call, may be the data of current call or NULL if size is 0
+ *  @param size size of data, at most SCHEDULER_MAX_EVENT_DATA_SIZE
+ *
+ *  @return NRF_SUCCESS on success
+ *  @return NRF_ERROR_INVALID_LENGTH if size is too large
+ *  @return NRF_ERROR_INVALID_STATE if called outside of handler
+ */
+ret_code_t scheduler_continue(void const* p_data, uint16_t size);
+
+/** Return time budget of given class in ticks, 0 if priority is not a valid class */
+uint32_t scheduler_budget_get(scheduler_priority_t priority);
+
+/** Return statistics of all queues */
+const scheduler_stats_t* scheduler_stats_get(void);
+
+/**
+ *  Return statistics of handler at given index
+ *
+ *  @return pointer to statistics, NULL if index is not in use
+ */
+const scheduler_handler_stats_t* scheduler_handler_stats_get(uint8_t index);
+
+/**
+ *  Return upper bound of ticks under which given permille of events fall,
+ *  e.g. 500 for median, 990 for 99th percentile. Bound is limited to max,
+ *  i.e. latency_max or execution_max of the same handler.
+ */
+uint32_t scheduler_histogram_percentile(const uint16_t* histogram, uint32_t max, uint16_t permille);
+
+/** Clear statistics, keep handler table */
+void scheduler_stats_reset(void);
+
+#endif
@@ -0,0 +1,120 @@
+#include "scheduler_handler.h"
+#include "scheduler.h"
+
+#include <string.h>
+
+#define NRF_LOG_MODULE_NAME "SCHEDULER_HANDLER"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+static uint16_t saturate(uint32_t value)
+{
+  return (value > UINT16_MAX) ? UINT16_MAX : value;
+}
+
+static void put_uint16(uint8_t* p_buffer, uint32_t value)
+{
+  uint16_t saturated = saturate(value);
+  p_buffer[0] = saturated & 0xFF;
+  p_buffer[1] = saturated >> 8;
+}
+
+static ret_code_t transmit(const ruuvi_standard_message_t reply)
+{
+  message_handler p_reply_handler = get_reply_handler();
+  if(NULL == p_reply_handler) { return ENDPOINT_HANDLER_ERROR; }
+  return p_reply_handler(reply);
+}
+
+static ret_code_t queue_status(const ruuvi_standard_message_t message)
+{
+  const scheduler_stats_t* stats = scheduler_stats_get();
+  ruuvi_standard_message_t reply = { .destination_endpoint = message.source_endpoint,
+                                     .source_endpoint      = SCHEDULER,
+                                     .type                 = UINT16,
+                                     .payload              = {0}};
+  reply.payload[0] = SCHEDULER_DIAGNOSTICS_QUEUE;
+  reply.payload[1] = stats->pending;
+  reply.payload[2] = stats->pending_peak;
+  reply.payload[3] = stats->handlers;
+  put_uint16(&reply.payload[4], stats->dropped);
+  put_uint16(&reply.payload[6], stats->untracked);
+  return transmit(reply);
+}
+
+static ret_code_t handler_status(const ruuvi_standard_message_t message, uint8_t index)
+{
+  const scheduler_handler_stats_t* stats = scheduler_handler_stats_get(index);
+  if(NULL == stats) { return ENDPOINT_INVALID; }
+
+  ret_code_t err_code = ENDPOINT_SUCCESS;
+  ruuvi_standard_message_t reply = { .destination_endpoint = message.source_endpoint,
+                                     .source_endpoint      = SCHEDULER,
+                                     .type                 = UINT16,
+                                     .payload              = {0}};
+  reply.payload[0] = index;
+
+  reply.payload[1] = SCHEDULER_DIAGNOSTICS_SUMMARY;
+  reply.payload[2] = stats->pending_peak;
+  reply.payload[3] = stats->priority;
+  put_uint16(&reply.payload[4], stats->dispatched);
+  put_uint16(&reply.payload[6], stats->dropped);
+  err_code |= transmit(reply);
+
+  memset(&reply.payload[2], 0, sizeof(reply.payload) - 2);
+  reply.payload[1] = SCHEDULER_DIAGNOSTICS_LATENCY;
+  put_uint16(&reply.payload[2], scheduler_histogram_percentile(stats->latency_histogram, stats->latency_max, 500));
+  put_uint16(&reply.payload[4], scheduler_histogram_percentile(stats->latency_histogram, stats->latency_max, 990));
+  put_uint16(&reply.payload[6], stats->latency_max);
+  err_code |= transmit(reply);
+
+  reply.payload[1] = SCHEDULER_DIAGNOSTICS_EXECUTION;
+  put_uint16(&reply.payload[2], scheduler_histogram_percentile(stats->execution_histogram, stats->execution_max, 500));
+  put_uint16(&reply.payload[4], scheduler_histogram_percentile(stats->execution_histogram, stats->execution_max, 990));
+  put_uint16(&reply.payload[6], stats->execution_max);
+  err_code |= transmit(reply);
+
+  reply.payload[1] = SCHEDULER_DIAGNOSTICS_BUDGET;
+  put_uint16(&reply.payload[2], scheduler_budget_get(stats->priority));
+  put_uint16(&reply.payload[4], stats->continued);
+  put_uint16(&reply.payload[6], stats->overruns);
+  err_code |= transmit(reply);
+
+  return err_code;
+}
+
+static ret_code_t data_query(const ruuvi_standard_message_t message)
+{
+  ret_code_t err_code = ENDPOINT_SUCCESS;
+  uint8_t index = message.payload[0];
+  if(SCHEDULER_DIAGNOSTICS_ALL == index)
+  {
+    for(uint8_t ii = 0; ii < scheduler_stats_get()->handlers; ii++)
+    {
+      err_code |= handler_status(message, ii);
+    }
+  }
+  else
+  {
+    err_code |= handler_status(message, index);
+  }
+  if(1 == message.payload[1]) { scheduler_stats_reset(); }
+  return err_code;
+}
+
+ret_code_t scheduler_handler(const ruuvi_standard_message_t message)
+{
+  if(SCHEDULER != message.destination_endpoint) { return ENDPOINT_INVALID; }
+  NRF_LOG_DEBUG("Diagnostics query %d\r\n", message.type);
+  switch(message.type)
+  {
+    case STATUS_QUERY:
+      return queue_status(message);
+
+    case DATA_QUERY:
+      return data_query(message);
+
+    default:
+      return unknown_handler(message);
+  }
+}
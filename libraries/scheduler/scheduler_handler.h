@@ -0,0 +1,35 @@
+#ifndef SCHEDULER_HANDLER_H
+#define SCHEDULER_HANDLER_H
+
+/**
+ *  Diagnostics endpoint of the scheduler, registered with set_scheduler_handler().
+ *
+ *  STATUS_QUERY returns one message of the whole queue:
+ *    payload[0] SCHEDULER_DIAGNOSTICS_QUEUE, [1] events pending, [2] peak pending,
+ *    [3] tracked handlers, [4..5] dropped, [6..7] untracked, little endian.
+ *
+ *  DATA_QUERY with payload[0] as handler index, SCHEDULER_DIAGNOSTICS_ALL for all
+ *  handlers, returns four messages per handler. payload[1] of query set to 1
+ *  clears statistics after reply.
+ *    SUMMARY:   [0] index, [1] type, [2] pending peak, [3] priority, [4..5] dispatched, [6..7] dropped
+ *    LATENCY:   [0] index, [1] type, [2..3] median, [4..5] 99th percentile, [6..7] maximum
+ *    EXECUTION: [0] index, [1] type, [2..3] median, [4..5] 99th percentile, [6..7] maximum
+ *    BUDGET:    [0] index, [1] type, [2..3] budget of class, [4..5] continued, [6..7] overruns
+ *  Times are ticks of scheduler time source, percentiles are upper bounds of histogram
+ *  bins limited to maximum. Values saturate at UINT16_MAX. Replies have type UINT16.
+ */
+
+#include "ruuvi_endpoints.h"
+#include "sdk_errors.h"
+
+#define SCHEDULER_DIAGNOSTICS_ALL       0xFF
+
+#define SCHEDULER_DIAGNOSTICS_SUMMARY   0
+#define SCHEDULER_DIAGNOSTICS_LATENCY   1
+#define SCHEDULER_DIAGNOSTICS_EXECUTION 2
+#define SCHEDULER_DIAGNOSTICS_QUEUE     3
+#define SCHEDULER_DIAGNOSTICS_BUDGET    4
+
+ret_code_t scheduler_handler(const ruuvi_standard_message_t message);
+
+#endif
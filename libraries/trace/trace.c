@@ -0,0 +1,162 @@
+#include "trace.h"
+
+#include <stdarg.h>
+#include <string.h>
+#include "app_util_platform.h"
+
+#if TRACE_BACKEND_RTT
+  #include "SEGGER_RTT.h"
+#endif
+
+#if TRACE_ENABLED
+
+#define TRACE_HEADER(id, nargs, level, sequence) \
+  ((uint32_t)(id) | ((uint32_t)(nargs) << 16) | ((uint32_t)(level) << 20) | ((uint32_t)(sequence) << 24))
+#define TRACE_HEADER_NARGS(header) (((header) >> 16) & 0x0F)
+
+/** Format strings of this build, start of section is provided by linker */
+extern const char __start_trace_strings[];
+
+static uint32_t        ring[TRACE_BUFFER_WORDS];
+static uint16_t        head = 0;      // Oldest word
+static uint16_t        count = 0;     // Words in ring
+static uint16_t        records = 0;   // Records in ring
+static uint16_t        lost = 0;      // Records dropped since last dropped-record
+static uint16_t        dropped = 0;   // Records dropped since init
+static uint8_t         sequence = 0;
+static trace_time_fn_t time_source = NULL;
+
+/** Copy record to ring. Call in critical region with enough space. */
+static void ring_push(const uint32_t* p_words, uint8_t length)
+{
+  for(uint8_t ii = 0; ii < length; ii++)
+  {
+    ring[(head + count) % TRACE_BUFFER_WORDS] = p_words[ii];
+    count++;
+  }
+  records++;
+  sequence++;
+}
+
+void trace_init(trace_time_fn_t time_fn)
+{
+  CRITICAL_REGION_ENTER();
+  time_source = time_fn;
+  head = 0;
+  count = 0;
+  records = 0;
+  lost = 0;
+  dropped = 0;
+  sequence = 0;
+  CRITICAL_REGION_EXIT();
+
+  #if TRACE_BACKEND_RTT
+    static uint8_t rtt_buffer[TRACE_BUFFER_WORDS];
+    SEGGER_RTT_ConfigUpBuffer(TRACE_RTT_CHANNEL, "trace", rtt_buffer, sizeof(rtt_buffer),
+                              SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+  #endif
+}
+
+void trace_record(uint8_t level, const char* fmt, uint8_t nargs, ...)
+{
+  if(TRACE_MAX_ARGS < nargs) { nargs = TRACE_MAX_ARGS; }
+  uint32_t words[TRACE_HEADER_WORDS + TRACE_MAX_ARGS];
+  uint16_t id = fmt - __start_trace_strings;
+  uint32_t timestamp = (NULL == time_source) ? 0 : time_source();
+  uint8_t length = TRACE_HEADER_WORDS + nargs;
+
+  va_list args;
+  va_start(args, nargs);
+  for(uint8_t ii = 0; ii < nargs; ii++) { words[TRACE_HEADER_WORDS + ii] = va_arg(args, uint32_t); }
+  va_end(args);
+  words[1] = timestamp;
+
+  CRITICAL_REGION_ENTER();
+  // Report earlier losses first so that decoder sees them in order
+  if(lost && TRACE_BUFFER_WORDS - count >= TRACE_HEADER_WORDS + 1 + length)
+  {
+    uint32_t report[TRACE_HEADER_WORDS + 1] = { TRACE_HEADER(TRACE_ID_DROPPED, 1, TRACE_LEVEL_WARNING, sequence),
+                                                timestamp, lost };
+    ring_push(report, sizeof(report) / sizeof(report[0]));
+    lost = 0;
+  }
+  if(!lost && TRACE_BUFFER_WORDS - count >= length)
+  {
+    words[0] = TRACE_HEADER(id, nargs, level, sequence);
+    ring_push(words, length);
+  }
+  else
+  {
+    if(UINT16_MAX > lost)    { lost++; }
+    if(UINT16_MAX > dropped) { dropped++; }
+  }
+  CRITICAL_REGION_EXIT();
+}
+
+size_t trace_read(uint8_t* p_buffer, size_t size)
+{
+  size_t copied = 0;
+  CRITICAL_REGION_ENTER();
+  while(records)
+  {
+    uint8_t length = TRACE_HEADER_WORDS + TRACE_HEADER_NARGS(ring[head]);
+    if(copied + length * sizeof(uint32_t) > size) { break; }
+    for(uint8_t ii = 0; ii < length; ii++)
+    {
+      memcpy(p_buffer + copied, &ring[head], sizeof(uint32_t));
+      copied += sizeof(uint32_t);
+      head = (head + 1) % TRACE_BUFFER_WORDS;
+      count--;
+    }
+    records--;
+  }
+  CRITICAL_REGION_EXIT();
+  return copied;
+}
+
+trace_stats_t trace_stats_get(void)
+{
+  trace_stats_t stats;
+  CRITICAL_REGION_ENTER();
+  stats.used = count * sizeof(uint32_t);
+  stats.capacity = sizeof(ring);
+  stats.dropped = dropped;
+  stats.records = records;
+  CRITICAL_REGION_EXIT();
+  return stats;
+}
+
+void trace_process(void)
+{
+  #if TRACE_BACKEND_RTT
+    uint8_t buffer[(TRACE_HEADER_WORDS + TRACE_MAX_ARGS) * sizeof(uint32_t) * 4];
+    size_t length;
+    // Records which do not fit to RTT are skipped, decoder sees a gap in sequence
+    while(0 != (length = trace_read(buffer, sizeof(buffer))))
+    {
+      if(0 == SEGGER_RTT_Write(TRACE_RTT_CHANNEL, buffer, length)) { break; }
+    }
+  #endif
+}
+
+#else
+
+// Log calls go to NRF_LOG, ring is not allocated. Endpoint reports an empty ring.
+void trace_init(trace_time_fn_t time_fn) { }
+
+void trace_record(uint8_t level, const char* fmt, uint8_t nargs, ...) { }
+
+size_t trace_read(uint8_t* p_buffer, size_t size)
+{
+  return 0;
+}
+
+trace_stats_t trace_stats_get(void)
+{
+  trace_stats_t stats = {0};
+  return stats;
+}
+
+void trace_process(void) { }
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ *  Deferred binary log.
+ *
+ *  TRACE_* macros record only an ID of the format string, a timestamp and raw 32-bit
+ *  arguments to a RAM ring. Nothing is formatted on target. Format strings are placed
+ *  in section trace_strings of the ELF, ID is the offset of the string in the section.
+ *  tools/trace_decoder rebuilds the text from the ELF of the same build.
+ *
+ *  Ring is drained with trace_read(), by trace_process() to RTT if TRACE_BACKEND_RTT
+ *  is set, or over GATT with LOG_QUERY to TRACE endpoint, see trace_handler.h.
+ *
+ *  Record, little endian 32-bit words:
+ *    word 0: [15:0] ID, [19:16] number of arguments, [22:20] level, [31:24] sequence
+ *    word 1: timestamp in ticks of time source given to trace_init()
+ *    word 2...: arguments
+ *  ID TRACE_ID_DROPPED carries number of records lost to full ring as argument.
+ *  Sequence increments on each stored record, a gap means records were lost in transport.
+ *
+ *  Arguments are cast to uint32_t: integers, characters and pointers are supported,
+ *  floats are not. %s is decoded if the pointer is to constant data in the ELF.
+ *  Format string is prefixed with NRF_LOG_MODULE_NAME, which must be defined by the
+ *  file using the macros. Trailing "\r\n" is removed by decoder.
+ *
+ *  If TRACE_ENABLED is 0 macros fall back to NRF_LOG_*, so the same call sites can be
+ *  formatted at runtime while debugging.
+ *
+ *  License: BSD-3
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdk_common.h"
+
+#ifndef TRACE_ENABLED
+  #define TRACE_ENABLED 0
+#endif
+
+/** Records of higher levels are compiled out */
+#ifndef TRACE_LEVEL
+  #define TRACE_LEVEL TRACE_LEVEL_DEBUG
+#endif
+
+/** Size of RAM ring in 32-bit words */
+#ifndef TRACE_BUFFER_WORDS
+  #define TRACE_BUFFER_WORDS 256
+#endif
+
+/** Drain ring to RTT up channel TRACE_RTT_CHANNEL in trace_process() */
+#ifndef TRACE_BACKEND_RTT
+  #define TRACE_BACKEND_RTT 0
+#endif
+#ifndef TRACE_RTT_CHANNEL
+  #define TRACE_RTT_CHANNEL 1
+#endif
+
+#define TRACE_LEVEL_ERROR    1
+#define TRACE_LEVEL_WARNING  2
+#define TRACE_LEVEL_INFO     3
+#define TRACE_LEVEL_DEBUG    4
+
+#define TRACE_MAX_ARGS       6
+#define TRACE_HEADER_WORDS   2
+#define TRACE_ID_DROPPED     0xFFFF
+#define TRACE_PADDING        0xFFFFFFFF  // Fills transport frames, never a valid header
+
+/** Returns current time in ticks */
+typedef uint32_t(*trace_time_fn_t)(void);
+
+/** Statistics of the ring */
+typedef struct {
+  uint16_t used;      /**< Bytes waiting to be read */
+  uint16_t capacity;  /**< Size of ring in bytes */
+  uint16_t dropped;   /**< Records lost to full ring since init, saturates */
+  uint16_t records;   /**< Records waiting to be read */
+}trace_stats_t;
+
+#if TRACE_ENABLED
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+#define TRACE_NARGS_(_0, _1, _2, _3, _4, _5, _6, N, ...) N
+#define TRACE_NARGS(...)    TRACE_NARGS_(0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define TRACE_CAST(x)       ((uint32_t)(uintptr_t)(x))
+#define TRACE_ARGS_0()
+#define TRACE_ARGS_1(a)                   , TRACE_CAST(a)
+#define TRACE_ARGS_2(a, b)                , TRACE_CAST(a), TRACE_CAST(b)
+#define TRACE_ARGS_3(a, b, c)             , TRACE_CAST(a), TRACE_CAST(b), TRACE_CAST(c)
+#define TRACE_ARGS_4(a, b, c, d)          , TRACE_CAST(a), TRACE_CAST(b), TRACE_CAST(c), TRACE_CAST(d)
+#define TRACE_ARGS_5(a, b, c, d, e)       , TRACE_CAST(a), TRACE_CAST(b), TRACE_CAST(c), TRACE_CAST(d), TRACE_CAST(e)
+#define TRACE_ARGS_6(a, b, c, d, e, f)    , TRACE_CAST(a), TRACE_CAST(b), TRACE_CAST(c), TRACE_CAST(d), TRACE_CAST(e), TRACE_CAST(f)
+
+#define TRACE_RECORD(level, fmt, ...)                                                         \
+  do {                                                                                        \
+    if((level) <= TRACE_LEVEL)                                                                \
+    {                                                                                         \
+      static const char trace_fmt[] __attribute__((section("trace_strings"))) =               \
+        NRF_LOG_MODULE_NAME ": " fmt;                                                         \
+      trace_record((level), trace_fmt, TRACE_NARGS(__VA_ARGS__)                               \
+                   TRACE_CONCAT(TRACE_ARGS_, TRACE_NARGS(__VA_ARGS__))(__VA_ARGS__));         \
+    }                                                                                         \
+  } while(0)
+
+#define TRACE_ERROR(fmt, ...)   TRACE_RECORD(TRACE_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define TRACE_WARNING(fmt, ...) TRACE_RECORD(TRACE_LEVEL_WARNING, fmt, ##__VA_ARGS__)
+#define TRACE_INFO(fmt, ...)    TRACE_RECORD(TRACE_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define TRACE_DEBUG(fmt, ...)   TRACE_RECORD(TRACE_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+#else
+
+#define TRACE_ERROR(...)   NRF_LOG_ERROR(__VA_ARGS__)
+#define TRACE_WARNING(...) NRF_LOG_WARNING(__VA_ARGS__)
+#define TRACE_INFO(...)    NRF_LOG_INFO(__VA_ARGS__)
+#define TRACE_DEBUG(...)   NRF_LOG_DEBUG(__VA_ARGS__)
+
+#endif
+
+/**
+ *  Clear ring and set time source.
+ *
+ *  @param time_fn function returning current time in ticks, NULL to record 0
+ */
+void trace_init(trace_time_fn_t time_fn);
+
+/**
+ *  Store record to ring, called by TRACE_* macros. Safe to call from interrupt context.
+ *  Record is dropped and counted if ring is full.
+ *
+ *  @param level TRACE_LEVEL_*
+ *  @param fmt format string in section trace_strings
+ *  @param nargs number of uint32_t arguments which follow, at most TRACE_MAX_ARGS
+ */
+void trace_record(uint8_t level, const char* fmt, uint8_t nargs, ...);
+
+/**
+ *  Move whole records from ring to buffer.
+ *
+ *  @param p_buffer buffer to copy records to
+ *  @param size size of buffer in bytes
+ *
+ *  @return number of bytes copied, multiple of 4
+ */
+size_t trace_read(uint8_t* p_buffer, size_t size);
+
+/** Return statistics of ring */
+trace_stats_t trace_stats_get(void);
+
+/** Drain ring to RTT if TRACE_BACKEND_RTT is set. Call from main loop. */
+void trace_process(void);
+
+#endif
@@ -0,0 +1,82 @@
+#include "trace_handler.h"
+#include "trace.h"
+
+#include <string.h>
+
+#define NRF_LOG_MODULE_NAME "TRACE_HANDLER"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+static void put_uint16(uint8_t* p_buffer, uint16_t value)
+{
+  p_buffer[0] = value & 0xFF;
+  p_buffer[1] = value >> 8;
+}
+
+static ret_code_t transmit(const ruuvi_standard_message_t reply)
+{
+  message_handler p_reply_handler = get_reply_handler();
+  if(NULL == p_reply_handler) { return ENDPOINT_HANDLER_ERROR; }
+  return p_reply_handler(reply);
+}
+
+static ret_code_t status_query(const ruuvi_standard_message_t message)
+{
+  trace_stats_t stats = trace_stats_get();
+  ruuvi_standard_message_t reply = { .destination_endpoint = message.source_endpoint,
+                                     .source_endpoint      = TRACE,
+                                     .type                 = UINT16,
+                                     .payload              = {0}};
+  put_uint16(&reply.payload[0], stats.used);
+  put_uint16(&reply.payload[2], stats.capacity);
+  put_uint16(&reply.payload[4], stats.dropped);
+  put_uint16(&reply.payload[6], stats.records);
+  return transmit(reply);
+}
+
+static ret_code_t log_query(const ruuvi_standard_message_t message)
+{
+  ret_code_t err_code = ENDPOINT_SUCCESS;
+  ruuvi_standard_message_t reply = { .destination_endpoint = message.source_endpoint,
+                                     .source_endpoint      = TRACE,
+                                     .type                 = UINT8,
+                                     .payload              = {0}};
+  const size_t frame = sizeof(reply.payload);
+  uint8_t buffer[4 * sizeof(reply.payload)];
+  uint32_t messages = message.payload[0] ? message.payload[0] : TRACE_HANDLER_MAX_MESSAGES;
+
+  while(messages)
+  {
+    // Read only what remaining replies can carry, records read are gone from ring
+    size_t limit = messages * frame;
+    size_t length = trace_read(buffer, (limit < sizeof(buffer)) ? limit : sizeof(buffer));
+    if(0 == length) { break; }
+    uint32_t padding = TRACE_PADDING;
+    while(length % frame) { memcpy(&buffer[length], &padding, sizeof(padding)); length += sizeof(padding); }
+
+    for(size_t offset = 0; offset < length; offset += frame)
+    {
+      memcpy(reply.payload, &buffer[offset], frame);
+      err_code |= transmit(reply);
+      messages--;
+    }
+  }
+  return err_code;
+}
+
+ret_code_t trace_handler(const ruuvi_standard_message_t message)
+{
+  if(TRACE != message.destination_endpoint) { return ENDPOINT_INVALID; }
+  NRF_LOG_DEBUG("Trace query %d\r\n", message.type);
+  switch(message.type)
+  {
+    case STATUS_QUERY:
+      return status_query(message);
+
+    case LOG_QUERY:
+      return log_query(message);
+
+    default:
+      return unknown_handler(message);
+  }
+}
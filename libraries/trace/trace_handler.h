@@ -0,0 +1,25 @@
+#ifndef TRACE_HANDLER_H
+#define TRACE_HANDLER_H
+
+/**
+ *  Endpoint for reading deferred binary log over GATT, registered with set_trace_handler().
+ *
+ *  STATUS_QUERY returns one message, type UINT16, little endian:
+ *    [0..1] bytes in ring, [2..3] capacity in bytes, [4..5] records dropped, [6..7] records in ring
+ *
+ *  LOG_QUERY moves records from ring to replies of type UINT8. payload[0] of query
+ *  limits number of replies, 0 for TRACE_HANDLER_MAX_MESSAGES. Each reply carries
+ *  8 bytes of record stream, the last one is padded with TRACE_PADDING. Concatenated
+ *  payloads are input of tools/trace_decoder.
+ */
+
+#include "ruuvi_endpoints.h"
+#include "sdk_errors.h"
+
+#ifndef TRACE_HANDLER_MAX_MESSAGES
+  #define TRACE_HANDLER_MAX_MESSAGES 16
+#endif
+
+ret_code_t trace_handler(const ruuvi_standard_message_t message);
+
+#endif
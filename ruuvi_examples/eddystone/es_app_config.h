@@ -32,9 +32,9 @@
 
 #define APP_CONFIG_ADV_FRAME_SPACING_MS_MIN                 100                         //!< Minimum time between advertisement frames. Imposes limit on minumum accepted advertisement interval.
 #if defined(NRF52)
-#define APP_CONFIG_ADV_FRAME_ETLM_SPACING_MS                300                         //!< The time that is reqired for preparing an eTLM slot. Imposes limit on minimum accepted advertisement interval.
+#define APP_CONFIG_ADV_FRAME_ETLM_SPACING_MS                100                         //!< The time that is reqired for preparing an eTLM slot. Imposes limit on minimum accepted advertisement interval. eTLM is prepared in idle time by es_security_cache.
 #elif defined(NRF51)
-#define APP_CONFIG_ADV_FRAME_ETLM_SPACING_MS                600                         //!< The time that is reqired for preparing an eTLM slot. Imposes limit on minimum accepted advertisement interval.
+#define APP_CONFIG_ADV_FRAME_ETLM_SPACING_MS                200                         //!< The time that is reqired for preparing an eTLM slot. Imposes limit on minimum accepted advertisement interval.
 #else
 #error MISSING ETLM DELAY TIMING
 #endif
@@ -55,7 +55,7 @@
 #define APP_MAX_ADV_SLOTS                   5                 //!< Maximum number of advertisement slots.
 #define APP_MAX_EID_SLOTS                   5                 /**< @brief Maximum number of EID slots.
                                                                * @note The maximum number of EID slots must be equal to the maximum number of advertisement slots (@ref APP_MAX_ADV_SLOTS). If your application does not adhere to this convention, you must modify the @ref eddystone_security module, because the security module maps the security slots' slot numbers 1 to 1 to the slots'. */
-#define APP_ETLM_DELAY_MS                   300               //!< The delay that is introduced between advertisement slots of type eTLM.
+#define APP_ETLM_DELAY_MS                   100               //!< The delay that is introduced between advertisement slots of type eTLM. eTLM is prepared in idle time by es_security_cache.
 
 // Broadcast Capabilities
 #define APP_IS_VARIABLE_ADV_SUPPORTED       ESCS_BROADCAST_VAR_ADV_SUPPORTED_No         //!< Information whether variable advertisement intervals are supported.
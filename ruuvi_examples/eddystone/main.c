@@ -34,6 +34,8 @@
 #include "init.h"
 #include "pin_interrupt.h"
 #include "nrf_nfc_handler.h"
+#include "crypto_bench.h"
+#include "es_security_cache.h"
 
 #define NRF_LOG_MODULE_NAME "MAIN"
 #include "nrf_log.h"
@@ -43,6 +45,13 @@
 
 #define DEAD_BEEF                   0xDEADBEEF       //!< Value used as error code on stack dump, can be used to identify stack location on stack unwind.
 
+// 1: Log known-answer tests and cost in cycles of Oberon crypto primitives at boot, see crypto_bench.h.
+// Needs NRF_LOG_ENABLED in sdk_application_config.h, e.g. make CFLAGS+=-DAPPLICATION_CRYPTO_BENCH=1
+#ifndef APPLICATION_CRYPTO_BENCH
+#define APPLICATION_CRYPTO_BENCH 0
+#endif
+#define CRYPTO_BENCH_BUDGET_CYCLES  (SystemCoreClock / 4) //!< Timed runs of each primitive, 250 ms
+
 /**@brief Callback function for asserts in the SoftDevice.
  *
  * @details This function will be called in case of an assert in the SoftDevice.
@@ -315,6 +324,32 @@ ret_code_t nfc_detected_handler(const ruuvi_standard_message_t message)
   return NRF_SUCCESS;
 }
 
+#if APPLICATION_CRYPTO_BENCH
+/** Cycle counter of Cortex-M4 */
+static uint32_t cycles(void)
+{
+  return DWT->CYCCNT;
+}
+
+/**
+ * Runs crypto benchmark before watchdog and SoftDevice are started, so that runs are
+ * not preempted by radio. SRP takes several seconds in all.
+ */
+static void crypto_bench(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  for(uint8_t ii = 0; ii < crypto_bench_count(); ii++)
+  {
+    crypto_bench_result_t result;
+    crypto_bench_run(ii, cycles, CRYPTO_BENCH_BUDGET_CYCLES, &result);
+    NRF_LOG_INFO("%s %s: %d cycles, %d runs\r\n", (uint32_t)result.name, (uint32_t)(result.passed ? "ok" : "FAIL"),
+                 result.ticks, result.runs);
+    NRF_LOG_FLUSH();
+  }
+}
+#endif
 
 /**
  * @brief Function for application main entry.
@@ -325,6 +360,9 @@ int main(void)
 
   // Initialize.
   err_code |= init_log();
+  #if APPLICATION_CRYPTO_BENCH
+    crypto_bench();
+  #endif
   err_code |= init_watchdog(NULL);
   err_code |= init_leds();
 
@@ -357,7 +395,9 @@ int main(void)
   {
     if (NRF_LOG_PROCESS() == false)
     {
-      app_sched_execute();
+      scheduler_execute();
+      // EIDs and eTLM are computed before their slots are due
+      es_security_cache_refill();
       power_manage();
     }
   }
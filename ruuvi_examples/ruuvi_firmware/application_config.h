@@ -3,6 +3,11 @@
 
 #include "bme280.h"
 #include "lis2dh12.h"
+// Milliseconds between samples of each environmental channel, advertisements repeat latest value.
+// Acceleration is read once per main loop interval of mode.
+#define APPLICATION_TEMPERATURE_INTERVAL 5000u
+#define APPLICATION_HUMIDITY_INTERVAL    5000u
+#define APPLICATION_PRESSURE_INTERVAL    60000u
 // Milliseconds before new button press is accepted. Applies both to rising and falling edge
 #define DEBOUNCE_THRESHOLD 100u
 // Milliseconds until new batteryreading is taken on radio interrupt.
@@ -21,6 +26,10 @@
 #define BME280_PRESSURE_OVERSAMPLING    BME280_OVERSAMPLING_1
 #define BME280_IIR                      BME280_IIR_16
 #define BME280_DELAY                    BME280_STANDBY_1000_MS
+// 1: Main loop timer triggers a forced measurement and data is read once measurement
+// time of above oversampling has passed. Sensor sleeps between main loop ticks.
+// 0: Sensor runs in normal mode with BME280_DELAY standby, main loop reads latest sample.
+#define BME280_FORCED_MODE              1
 
 #define LIS2DH12_SCALE              LIS2DH12_SCALE2G
 #define LIS2DH12_RESOLUTION         LIS2DH12_RES10BIT
@@ -30,4 +39,66 @@
 // mg, scaled to bits by driver
 #define LIS2DH12_ACTIVITY_THRESHOLD 64
 
+// 1: Accelerometer streams FIFO to spectral analysis and advertisement carries experimental
+// VIBRATION_FORMAT instead of RAWv2. Acceleration is not sampled for RAWv2 on NFC.
+#define APPLICATION_VIBRATION_MONITOR   0
+// Hz, 100, 200 or 400. Block of 256 samples is analysed every 1.28 s at 200 Hz.
+#define APPLICATION_VIBRATION_SAMPLERATE 200
+// Hz, amplitude at this frequency is reported, e.g. rotation speed of a motor. 0 disables.
+#define APPLICATION_VIBRATION_TRACKED_HZ 25
+
+// 1: Accelerometer samples at APPLICATION_CAPTURE_SAMPLERATE into a RAM ring until activity
+// interrupt, then keeps post-trigger samples and freezes until downloaded and armed again
+// over GATT, see lis2dh12_capture.h. Mode sample rate applies while capture is frozen.
+#define APPLICATION_CAPTURE_ENABLED      0
+// Hz, 1, 10, 25, 50, 100, 200 or 400.
+#define APPLICATION_CAPTURE_SAMPLERATE   400
+// Samples before and after activity, at most CAPTURE_MAX_SAMPLES together. 0.3 s + 1 s at 400 Hz.
+#define APPLICATION_CAPTURE_PRE_SAMPLES  120
+#define APPLICATION_CAPTURE_POST_SAMPLES 400
+
+// 1: LIS2DH12 detects APPLICATION_GESTURES on its own, see lis2dh12_gesture.h. Each event is
+// advertised in experimental GESTURE_FORMAT for APPLICATION_GESTURE_ADV_MS, then sensor data
+// resumes. Movement counter of RAWv2 counts gestures instead of activity.
+#define APPLICATION_GESTURES_ENABLED     0
+#define APPLICATION_GESTURES             (LIS2DH12_GESTURE_ENABLE_TAP | LIS2DH12_GESTURE_ENABLE_DOUBLE_TAP | \
+                                          LIS2DH12_GESTURE_ENABLE_ORIENTATION | LIS2DH12_GESTURE_ENABLE_FREEFALL)
+// Used in all modes while gestures are enabled. Taps need 100 Hz or more, 400 Hz is most reliable.
+#define APPLICATION_GESTURE_SAMPLERATE   LIS2DH12_RATE_100
+#define APPLICATION_GESTURE_ADV_MS       3000u
+// mg and ms, scaled to bits and samples by driver
+#define APPLICATION_TAP_THRESHOLD        1000
+#define APPLICATION_TAP_TIMELIMIT        100
+#define APPLICATION_TAP_LATENCY          100
+#define APPLICATION_TAP_WINDOW           400
+#define APPLICATION_ORIENTATION_THRESHOLD 800
+#define APPLICATION_ORIENTATION_DURATION 100
+#define APPLICATION_FREEFALL_THRESHOLD   350
+#define APPLICATION_FREEFALL_DURATION    30
+
+// 1: RAWv2 modes advertise experimental AUTHENTICATED_FORMAT, RAWv2 with a truncated AES-CMAC
+// and a counter, once a key is written to CONFIG_AUTH_KEY_* items. See adv_auth.h.
+#define APPLICATION_AUTHENTICATED_ADV    0
+// 1: AES on ECB peripheral through SoftDevice, 0: software AES of adv_auth
+#define APPLICATION_AUTH_ECB_HW          1
+// Counters reserved in flash at once, flash is written once per this many packets
+#define APPLICATION_AUTH_COUNTER_BLOCK   4096
+
+// 1: Advertisement rotates sensor data with Eddystone URL and TLM frames, so phones without
+// Ruuvi app see the tag too. Frames are encoded once per main loop and swapped in place, see
+// bluetooth_rotator_set(). Advertising events each frame stays on air, 0 leaves frame out.
+#define APPLICATION_EDDYSTONE_FRAMES     0
+#define APPLICATION_RAW_FRAME_EVENTS     3
+#define APPLICATION_URL_FRAME_EVENTS     1
+#define APPLICATION_TLM_FRAME_EVENTS     1
+// Base of weather station URL, 0x03 is https://. Sensor data is appended in format 4.
+#define APPLICATION_EDDYSTONE_URL        { 0x03, 'r', 'u', 'u', '.', 'v', 'i', '/', '#' }
+
+#if APPLICATION_CAPTURE_ENABLED && APPLICATION_VIBRATION_MONITOR
+  #error "Capture and vibration monitor both drain accelerometer FIFO, enable only one"
+#endif
+#if APPLICATION_GESTURES_ENABLED && (APPLICATION_CAPTURE_ENABLED || APPLICATION_VIBRATION_MONITOR)
+  #error "Gestures use interrupt pin 1 of accelerometer for events instead of FIFO watermark"
+#endif
+
 #endif
\ No newline at end of file
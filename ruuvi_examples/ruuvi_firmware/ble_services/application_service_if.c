@@ -13,6 +13,7 @@
 
 #include "ble_bulk_transfer.h"
 #include "ruuvi_endpoints.h"
+#include "scheduler.h"
 
 #define NRF_LOG_MODULE_NAME "SERVICE"
 #include "nrf_log.h"
@@ -33,9 +34,10 @@ static void nus_data_handler(ble_nus_t * p_nus, uint8_t * p_data, uint16_t lengt
                                          .payload = {0}};
     memcpy(&(message.payload[0]), &(p_data[3]), sizeof(message.payload));
     //Schedule handling of the message - do not process in interrupt context
-    app_sched_event_put	(	&message,
+    scheduler_event_put	(	&message,
                           sizeof(message),
-                          ble_gatt_scheduler_event_handler);
+                          ble_gatt_scheduler_event_handler,
+                          SCHEDULER_PRIORITY_IO);
   }
 }
 
@@ -97,6 +99,8 @@ uint32_t application_services_init(void)
     nus_init.data_handler = nus_data_handler;
 
     err_code |= ble_nus_init(&m_nus, &nus_init);
+    //Setup BLE bulk data transfer pointer
+    ble_bulk_set_nus(&m_nus);
 
     NRF_LOG_INFO("NUS Init status: %s\r\n", (uint32_t)ERR_TO_STR(err_code));
     
@@ -46,18 +46,36 @@
 #include "flash.h"
 #include "lis2dh12.h"
 #include "lis2dh12_acceleration_handler.h"
+#include "lis2dh12_capture.h"
+#include "lis2dh12_gesture.h"
+#include "lis2dh12_sensor.h"
 #include "bme280.h"
+#include "bme280_sensor.h"
+#include "calibration_cache.h"
+#include "config_store.h"
+#include "config_store_handler.h"
+#include "temperature.h"
+#include "sensor.h"
+#include "sensor_pipeline.h"
+#include "vibration.h"
 #include "battery.h"
+#include "ble_bulk_transfer.h"
 #include "bluetooth_core.h"
 #include "eddystone.h"
 #include "pin_interrupt.h"
 #include "nfc.h"
 #include "nfc_t2t_lib.h"
 #include "rtc.h"
+#include "scheduler.h"
+#include "trace.h"
 #include "application_config.h"
+#include "warm_boot.h"
 
 // Libraries
+#include "adv_auth.h"
+#include "aes_cmac.h"
 #include "base64.h"
+#include "ecb.h"
 #include "sensortag.h"
 
 // Init
@@ -72,6 +90,8 @@
 // ID for main loop timer.
 APP_TIMER_DEF(main_timer_id);                 // Creates timer id for our program.
 APP_TIMER_DEF(reset_timer_id);                 // Creates timer id for our program.
+APP_TIMER_DEF(sample_timer_id);                // Single shot, fires at next sampling deadline of sensor pipeline.
+APP_TIMER_DEF(sensor_ready_timer_id);          // Single shot, fires when measurements started by sample task are ready.
 
 static uint16_t init_status = 0;   // combined status of all initalizations.  Zero when all are complete if no errors occured.
 static uint8_t NFC_message[100];   // NFC message buffer has 4 records, up to 128 bytes each minus some overhead for NFC NDEF data keeping. 
@@ -91,7 +111,7 @@ static size_t NFC_message_length = sizeof(NFC_message);
 #define BUTTON_FAILED_INIT          0x2000
 #define BME_FAILED_INIT             0x4000
 
-// File and record for app mode
+// File and record for app mode of earlier firmware, moved to configuration store
 #define FDS_FILE_ID 1
 #define FDS_RECORD_ID 1
 
@@ -105,12 +125,39 @@ static uint8_t data_buffer[RAWv2_DATA_LENGTH] = { 0 };
 static bool bme280_available = false;          // Flag for sensors available
 static bool lis2dh12_available = false;        // Flag for sensors available
 static bool fast_advertising = true;           // Connectable mode
-static uint64_t fast_advertising_start = 0;    // Timestamp of when tag became connectable
-static uint64_t debounce = 0;                  // Flag for avoiding double presses
+static rtc_deadline_t fast_advertising_end = 0; // Time when connectable mode ends
+static rtc_deadline_t debounce_end = 0;        // Time when next press is accepted
+static rtc_deadline_t gesture_adv_end = 0;     // Time when sensor data replaces gesture advertisement
 static uint16_t acceleration_events = 0;       // Number of times accelerometer has triggered
 static volatile uint16_t vbat = 0;             // Update in interrupt after radio activity.
-static uint64_t last_battery_measurement = 0;  // Timestamp of VBat update.
+static rtc_deadline_t next_battery_measurement = 0; // Time of next VBat update.
+static volatile bool battery_idle_sampled = false; // Idle sample taken before radio, take load sample after.
 static volatile bool pressed = false;          // Debounce flag
+static ruuvi_sensor_t sweep_data;              // Sensor sweep, see sensor_read_task
+static uint8_t sampling_channels = 0;          // Channels of sweep in progress, 0 if idle
+static bool warm_boot = false;                 // Reset kept RAM, sensors of previous boot are not probed
+static uint8_t sensor_channels = 0;            // Channels of sensors found at boot
+static volatile uint32_t advertising_events = 0; // Radio activity since boot, ADV_CNT of Eddystone TLM
+#if APPLICATION_VIBRATION_MONITOR
+static uint8_t vibration_buffer[VIBRATION_ENCODED_DATA_LENGTH] = { 0 };
+static uint16_t vibration_summary[4];          // Latest VIBRATION payload, waits for bands
+static uint16_t vibration_blocks = 0;          // Count of advertised blocks
+#endif
+#if APPLICATION_GESTURES_ENABLED
+static uint8_t gesture_buffer[GESTURE_ENCODED_DATA_LENGTH] = { 0 };
+static const lis2dh12_gesture_config_t gesture_config = {
+  .gestures                 = APPLICATION_GESTURES,
+  .sample_rate              = APPLICATION_GESTURE_SAMPLERATE,
+  .tap_threshold_mg         = APPLICATION_TAP_THRESHOLD,
+  .tap_timelimit_ms         = APPLICATION_TAP_TIMELIMIT,
+  .tap_latency_ms           = APPLICATION_TAP_LATENCY,
+  .tap_window_ms            = APPLICATION_TAP_WINDOW,
+  .orientation_threshold_mg = APPLICATION_ORIENTATION_THRESHOLD,
+  .orientation_duration_ms  = APPLICATION_ORIENTATION_DURATION,
+  .freefall_threshold_mg    = APPLICATION_FREEFALL_THRESHOLD,
+  .freefall_duration_ms     = APPLICATION_FREEFALL_DURATION
+};
+#endif
 
 // Possible modes of the app
 #define RAWv1 0
@@ -118,57 +165,199 @@ static volatile bool pressed = false;          // Debounce flag
 #define RAWv2_SLOW 2
 #define DEFAULT_MODE RAWv2_FAST
 
-// Must be UINT32_T as flash storage operated in 4-byte chunks
-// Will get loaded from flash, this is default.
-static uint32_t tag_mode __attribute__ ((aligned (4))) = DEFAULT_MODE;
-// Rates of advertising. These must match the tag mode enum.
-static const uint16_t advertising_rates[] = {
-  ADVERTISING_INTERVAL_RAW,
-  ADVERTISING_INTERVAL_RAW,
-  ADVERTISING_INTERVAL_RAW_SLOW
-};
-// Rates of advertising. These must match the tag mode enum.
+// Copy of CONFIG_MODE, will get loaded from flash, this is default.
+static uint32_t tag_mode = DEFAULT_MODE;
+// Sizes of advertisement. These must match the tag mode enum.
 static const uint16_t advertising_sizes[] = {
   RAWv1_DATA_LENGTH,
   RAWv2_DATA_LENGTH,
   RAWv2_DATA_LENGTH
 };
 
+// Runtime configuration, read and changed over GATT through CONFIG endpoint, see config_store_handler.h.
+// IDs are keys of records in flash, never reuse an ID for another type.
+typedef enum
+{
+  CONFIG_MODE                      = 0,
+  CONFIG_ADVERTISING_INTERVAL      = 1,  // ms, RAWv1 and RAWv2_FAST
+  CONFIG_ADVERTISING_INTERVAL_SLOW = 2,  // ms, RAWv2_SLOW
+  CONFIG_MAIN_LOOP_INTERVAL        = 3,  // ms, RAWv1 and RAWv2_FAST
+  CONFIG_MAIN_LOOP_INTERVAL_SLOW   = 4,  // ms, RAWv2_SLOW
+  CONFIG_TX_POWER                  = 5,  // dBm, one of -40, -20, -16, -12, -8, -4, 0, 3, 4
+  CONFIG_TEMPERATURE_INTERVAL      = 6,  // ms
+  CONFIG_HUMIDITY_INTERVAL         = 7,
+  CONFIG_PRESSURE_INTERVAL         = 8,
+  CONFIG_TEMPERATURE_OVERSAMPLING  = 9,  // BME280_OVERSAMPLING_*, from next boot
+  CONFIG_HUMIDITY_OVERSAMPLING     = 10,
+  CONFIG_PRESSURE_OVERSAMPLING     = 11,
+  CONFIG_ACTIVITY_THRESHOLD        = 12, // mg, from next boot
+  CONFIG_AUTH_KEY_0                = 13, // Key of AUTHENTICATED_FORMAT, most significant word first. Write-only
+  CONFIG_AUTH_KEY_1                = 14,
+  CONFIG_AUTH_KEY_2                = 15,
+  CONFIG_AUTH_KEY_3                = 16,
+  CONFIG_AUTH_COUNTER              = 17  // Counters below this may have been used, reserved ahead in blocks. Read-only
+}config_id_t;
+
+// TX powers of radio, see bluetooth_tx_power_set()
+static const int32_t tx_powers[] = { -40, -20, -16, -12, -8, -4, 0, 3, 4 };
+
+// Defaults are the compile time configuration
+static const config_item_t config_items[] = {
+  { CONFIG_MODE,                      CONFIG_TYPE_UINT8,  DEFAULT_MODE,                    RAWv1, RAWv2_SLOW },
+  { CONFIG_ADVERTISING_INTERVAL,      CONFIG_TYPE_UINT16, ADVERTISING_INTERVAL_RAW,        100,   10240 },
+  { CONFIG_ADVERTISING_INTERVAL_SLOW, CONFIG_TYPE_UINT16, ADVERTISING_INTERVAL_RAW_SLOW,   100,   10240 },
+  { CONFIG_MAIN_LOOP_INTERVAL,        CONFIG_TYPE_UINT16, MAIN_LOOP_INTERVAL_RAW,          100,   60000 },
+  { CONFIG_MAIN_LOOP_INTERVAL_SLOW,   CONFIG_TYPE_UINT16, MAIN_LOOP_INTERVAL_RAW_SLOW,     100,   60000 },
+  { CONFIG_TX_POWER,                  CONFIG_TYPE_INT8,   BLE_TX_POWER,                    -40,   4,
+    false, false, tx_powers, sizeof(tx_powers)/sizeof(tx_powers[0]) },
+  { CONFIG_TEMPERATURE_INTERVAL,      CONFIG_TYPE_UINT32, APPLICATION_TEMPERATURE_INTERVAL, 1000, SENSOR_PIPELINE_MAX_INTERVAL_MS },
+  { CONFIG_HUMIDITY_INTERVAL,         CONFIG_TYPE_UINT32, APPLICATION_HUMIDITY_INTERVAL,   1000,  SENSOR_PIPELINE_MAX_INTERVAL_MS },
+  { CONFIG_PRESSURE_INTERVAL,         CONFIG_TYPE_UINT32, APPLICATION_PRESSURE_INTERVAL,   1000,  SENSOR_PIPELINE_MAX_INTERVAL_MS },
+  { CONFIG_TEMPERATURE_OVERSAMPLING,  CONFIG_TYPE_UINT8,  BME280_TEMPERATURE_OVERSAMPLING, BME280_OVERSAMPLING_1, BME280_OVERSAMPLING_16 },
+  { CONFIG_HUMIDITY_OVERSAMPLING,     CONFIG_TYPE_UINT8,  BME280_HUMIDITY_OVERSAMPLING,    BME280_OVERSAMPLING_1, BME280_OVERSAMPLING_16 },
+  { CONFIG_PRESSURE_OVERSAMPLING,     CONFIG_TYPE_UINT8,  BME280_PRESSURE_OVERSAMPLING,    BME280_OVERSAMPLING_1, BME280_OVERSAMPLING_16 },
+  { CONFIG_ACTIVITY_THRESHOLD,        CONFIG_TYPE_UINT16, LIS2DH12_ACTIVITY_THRESHOLD,     16,    2000 },
+  { CONFIG_AUTH_KEY_0,                CONFIG_TYPE_INT32,  0,                               INT32_MIN, INT32_MAX, true },
+  { CONFIG_AUTH_KEY_1,                CONFIG_TYPE_INT32,  0,                               INT32_MIN, INT32_MAX, true },
+  { CONFIG_AUTH_KEY_2,                CONFIG_TYPE_INT32,  0,                               INT32_MIN, INT32_MAX, true },
+  { CONFIG_AUTH_KEY_3,                CONFIG_TYPE_INT32,  0,                               INT32_MIN, INT32_MAX, true },
+  { CONFIG_AUTH_COUNTER,              CONFIG_TYPE_UINT32, 0,                               0,     INT32_MAX, false, true }
+};
+
+// State of previous boot kept over soft and watchdog resets, see warm_boot.h
+typedef struct
+{
+  uint8_t sensors;                             // sensor_active_mask()
+  uint8_t bme280_calibrated;                   // Calibration below is valid
+  struct comp_params bme280_calibration;
+}warm_state_t;
+static warm_state_t warm_state;
+
 // Prototype declaration
 static void main_timer_handler(void * p_context);
+static void schedule_sample(void);
+static void set_manufacturer_data(uint8_t* data, size_t length);
+
+/** Advertising interval of mode after startup, ms */
+static uint16_t advertising_interval(void)
+{
+  return config_store_get((RAWv2_SLOW == tag_mode) ? CONFIG_ADVERTISING_INTERVAL_SLOW : CONFIG_ADVERTISING_INTERVAL);
+}
+
+#if APPLICATION_VIBRATION_MONITOR
+/**@brief Advertise spectral summary once both messages of an analysed block have arrived.
+ * Called from vibration analysis in scheduler.
+ */
+static ret_code_t vibration_adv_handler(const ruuvi_standard_message_t message)
+{
+  if(VIBRATION == message.source_endpoint)
+  {
+    memcpy(vibration_summary, message.payload, sizeof(vibration_summary));
+    return ENDPOINT_SUCCESS;
+  }
+  if(VIBRATION_BANDS != message.source_endpoint) { return ENDPOINT_SUCCESS; }
+  uint16_t bands[4];
+  memcpy(bands, message.payload, sizeof(bands));
+  encodeToVibrationFormat(vibration_buffer, vibration_summary, bands, vibration_blocks++);
+  set_manufacturer_data(vibration_buffer, sizeof(vibration_buffer));
+  return ENDPOINT_SUCCESS;
+}
+
+/**@brief Stream accelerometer FIFO to spectral analysis, results are sent to vibration_adv_handler.
+ */
+static void vibration_monitor_start(void)
+{
+  ruuvi_sensor_configuration_t config = { .sample_rate       = APPLICATION_VIBRATION_SAMPLERATE,
+                                          .transmission_rate = TRANSMISSION_RATE_DSPRATE,
+                                          .resolution        = RESOLUTION_NO_CHANGE,
+                                          .scale             = SCALE_NO_CHANGE,
+                                          .dsp_function      = DSP_SPECTRUM,
+                                          .dsp_parameter     = APPLICATION_VIBRATION_TRACKED_HZ,
+                                          .target            = TRANSMISSION_TARGET_BLE_ADV,
+                                          .reserved          = 0 };
+  ruuvi_standard_message_t message = { .destination_endpoint = ACCELERATION,
+                                       .source_endpoint      = VIBRATION,
+                                       .type                 = SENSOR_CONFIGURATION,
+                                       .payload              = { 0 }};
+  memcpy(message.payload, &config, sizeof(config));
+  set_ble_adv_handler(vibration_adv_handler);
+  // Result of configuration is in reply, application has no reply handler
+  lis2dh12_acceleration_handler(message);
+  if(!vibration_is_running()) { NRF_LOG_ERROR("Vibration analysis was not started\r\n"); }
+}
+#endif
+
+#if APPLICATION_GESTURES_ENABLED
+/**@brief Advertise event detected by accelerometer right away, main loop resumes sensor data later.
+ * Called from gesture engine in scheduler.
+ */
+static void gesture_adv_handler(const lis2dh12_gesture_event_t* p_event, const lis2dh12_gesture_counters_t* p_counters)
+{
+  uint16_t counts[4] = { p_counters->taps, p_counters->double_taps,
+                         p_counters->orientation_changes, p_counters->freefalls };
+  acceleration_events = p_counters->sequence;
+  encodeToGestureFormat(gesture_buffer, p_event->type, p_event->detail, p_counters->face, counts, p_counters->sequence);
+  set_manufacturer_data(gesture_buffer, sizeof(gesture_buffer));
+  gesture_adv_end = rtc_deadline_ms(APPLICATION_GESTURE_ADV_MS);
+}
+#endif
 
 /**@brief Handler for button press.
  * Called in scheduler, out of interrupt context.
  */
 void change_mode(void* data, uint16_t length)
 {
+  // Accelerometer samples on its own, read latest sample once per main loop
+  uint32_t acceleration_interval = config_store_get(CONFIG_MAIN_LOOP_INTERVAL);
+  lis2dh12_sample_rate_t acceleration_rate = LIS2DH12_SAMPLERATE_RAWv1;
   app_timer_stop(main_timer_id);
     switch(tag_mode)
     {  
       case RAWv2_SLOW:
-        lis2dh12_set_sample_rate(LIS2DH12_SAMPLERATE_RAWv2);
-        app_timer_start(main_timer_id, APP_TIMER_TICKS(MAIN_LOOP_INTERVAL_RAW_SLOW, RUUVITAG_APP_TIMER_PRESCALER), NULL);
+        acceleration_rate = LIS2DH12_SAMPLERATE_RAWv2;
+        acceleration_interval = config_store_get(CONFIG_MAIN_LOOP_INTERVAL_SLOW);
         break;
 
       case RAWv2_FAST:
-        lis2dh12_set_sample_rate(LIS2DH12_SAMPLERATE_RAWv2);
-        app_timer_start(main_timer_id, APP_TIMER_TICKS(MAIN_LOOP_INTERVAL_RAW, RUUVITAG_APP_TIMER_PRESCALER), NULL);
+        acceleration_rate = LIS2DH12_SAMPLERATE_RAWv2;
         break;
 
       case RAWv1:
       default:
-        lis2dh12_set_sample_rate(LIS2DH12_SAMPLERATE_RAWv1);
-        app_timer_start(main_timer_id, APP_TIMER_TICKS(MAIN_LOOP_INTERVAL_RAW, RUUVITAG_APP_TIMER_PRESCALER), NULL);
+        acceleration_rate = LIS2DH12_SAMPLERATE_RAWv1;
         tag_mode = RAWv1;
         break;
     }
+  app_timer_start(main_timer_id, APP_TIMER_TICKS(acceleration_interval, RUUVITAG_APP_TIMER_PRESCALER), NULL);
+  if(lis2dh12_available)
+  {
+    // Capture runs at its own rate until the event, mode rate applies between captures
+    #if APPLICATION_CAPTURE_ENABLED
+      lis2dh12_capture_rest_rate_set(acceleration_rate);
+      if(CAPTURE_IDLE == capture_state())
+      {
+        lis2dh12_capture_arm(APPLICATION_CAPTURE_SAMPLERATE, APPLICATION_CAPTURE_PRE_SAMPLES,
+                             APPLICATION_CAPTURE_POST_SAMPLES);
+      }
+    #else
+      // Gesture detection timings are in samples of gesture rate
+      lis2dh12_set_sample_rate(APPLICATION_GESTURES_ENABLED ? APPLICATION_GESTURE_SAMPLERATE : acceleration_rate);
+    #endif
+    // Pipeline reads would take samples from FIFO of spectral analysis
+    #if APPLICATION_VIBRATION_MONITOR
+      vibration_monitor_start();
+    #else
+      sensor_pipeline_interval_set(SENSOR_CAPABILITY_ACCELERATION, acceleration_interval);
+      schedule_sample();
+    #endif
+  }
   if(fast_advertising)
   {
     bluetooth_configure_advertising_interval(ADVERTISING_INTERVAL_STARTUP);
   }
   else
   {
-    bluetooth_configure_advertising_interval(advertising_rates[tag_mode]);
+    bluetooth_configure_advertising_interval(advertising_interval());
   }
   bluetooth_apply_configuration();
   NRF_LOG_INFO("Updating to %d mode\r\n", (uint32_t) tag_mode);
@@ -182,41 +371,137 @@ void change_mode(void* data, uint16_t length)
  */
 static void become_connectable(void* data, uint16_t length)
 {
-  fast_advertising_start = millis();
+  fast_advertising_end = rtc_deadline_ms(ADVERTISING_STARTUP_PERIOD);
   fast_advertising = true;
   bluetooth_configure_advertising_interval(ADVERTISING_INTERVAL_STARTUP);
   bluetooth_configure_advertisement_type(STARTUP_ADVERTISEMENT_TYPE);
   bluetooth_apply_configuration();
 }
 
+#if APPLICATION_AUTHENTICATED_ADV
+static bool auth_enabled = false;              // Key is set, RAWv2 modes advertise AUTHENTICATED_FORMAT
+static bool auth_key_changed = false;          // Words of key changed, applied as batch completes
+static uint32_t auth_counter = 0;              // Counter of next packet
+static uint32_t auth_limit = 0;                // Counters below this are reserved in flash
+static aes_cmac_t auth_cmac;
+static uint8_t auth_address[ADV_AUTH_ADDRESS_LENGTH];
+#if APPLICATION_AUTH_ECB_HW
+static ecb_t auth_cipher;
+#else
+static aes128_t auth_cipher;
+#endif
+
+/** Key tag from configuration. Tag without key, i.e. all zeroes, advertises RAWv2 */
+static void auth_key_load(void)
+{
+  uint8_t key[AES_KEY_SIZE];
+  uint8_t any = 0;
+  for(uint8_t ii = 0; ii < AES_KEY_SIZE; ii++)
+  {
+    uint32_t word = config_store_get(CONFIG_AUTH_KEY_0 + ii / 4);
+    key[ii] = word >> (24 - 8 * (ii % 4));
+    any |= key[ii];
+  }
+  auth_enabled = (0 != any);
+  if(auth_enabled)
+  {
+    #if APPLICATION_AUTH_ECB_HW
+      ecb_init(&auth_cipher, key);
+      aes_cmac_init(&auth_cmac, ecb_encrypt, &auth_cipher);
+    #else
+      aes128_init(&auth_cipher, key);
+      aes_cmac_init(&auth_cmac, aes128_encrypt, &auth_cipher);
+    #endif
+  }
+  memset(key, 0, sizeof(key));
+  NRF_LOG_INFO("Authenticated advertisements %s\r\n", (uint32_t)(auth_enabled ? "enabled" : "disabled"));
+}
+
 /**
- * Stores current mode to flash, given in parameters.
- *
- * Data is address of the tag_mode.
- * length is length of the address, not data.
+ * Take counter of next packet. A counter is used only after it is reserved in flash so that
+ * counters never repeat over resets. Next block is reserved once half of current block is
+ * used, commit has the other half of packets to land.
  *
+ * @return false if no counter is reserved, packet is sent as RAWv2
  */
-static void store_mode(void* data, uint16_t length)
+static bool auth_counter_take(uint32_t* p_counter)
 {
-  // Point the record directly to word-aligned tag mode rather than data pointer passed as context.
-  ret_code_t err_code = flash_record_set(FDS_FILE_ID, FDS_RECORD_ID, sizeof(tag_mode), &tag_mode);
-  if(err_code)
-  {
-   NRF_LOG_WARNING("Error in flash write %X\r\n", err_code);
-  }
-  else
+  if(!(CONFIG_STORE_FLAG_PENDING & config_store_flags(CONFIG_AUTH_COUNTER)))
   {
-    size_t flash_space_remaining;
-    flash_free_size_get(&flash_space_remaining);
-    NRF_LOG_INFO("Stored mode in flash, Largest continuous space remaining %d bytes\r\n", flash_space_remaining);
-    if(4000 > flash_space_remaining)
+    uint32_t reserved = config_store_get(CONFIG_AUTH_COUNTER);
+    auth_limit = reserved;
+    if(reserved <= auth_counter + APPLICATION_AUTH_COUNTER_BLOCK / 2 &&
+       auth_counter <= INT32_MAX - APPLICATION_AUTH_COUNTER_BLOCK &&
+       NRF_SUCCESS == config_store_set(CONFIG_AUTH_COUNTER, auth_counter + APPLICATION_AUTH_COUNTER_BLOCK))
     {
-      NRF_LOG_INFO("Flash space is almost used, running gc\r\n")
-      flash_gc_run();
-      flash_free_size_get(&flash_space_remaining);
-      NRF_LOG_INFO("Continuous space remaining after gc %d bytes\r\n", flash_space_remaining);
+      scheduler_event_put(NULL, 0, config_store_commit_task, SCHEDULER_PRIORITY_BACKGROUND);
     }
   }
+  if(auth_counter >= auth_limit) { return false; }
+  *p_counter = auth_counter++;
+  return true;
+}
+#endif
+
+/**
+ * Applies changed configuration. Called on changes from CONFIG endpoint and button press.
+ * Oversampling and activity threshold take effect on next boot. Key of authenticated
+ * advertisements is applied once the batch which writes its words is committed, packets
+ * are never signed with a key of old and new words.
+ */
+static void config_changed(uint8_t id, int32_t value)
+{
+  switch(id)
+  {
+    case CONFIG_MODE:
+      tag_mode = value;
+      scheduler_event_put (NULL, 0, change_mode, SCHEDULER_PRIORITY_IO);
+      break;
+
+    case CONFIG_ADVERTISING_INTERVAL:
+    case CONFIG_ADVERTISING_INTERVAL_SLOW:
+    case CONFIG_MAIN_LOOP_INTERVAL:
+    case CONFIG_MAIN_LOOP_INTERVAL_SLOW:
+      scheduler_event_put (NULL, 0, change_mode, SCHEDULER_PRIORITY_IO);
+      break;
+
+    case CONFIG_TX_POWER:
+      if(bluetooth_tx_power_set(value)) { NRF_LOG_WARNING("Invalid TX power %d\r\n", value); }
+      else { bluetooth_apply_configuration(); }
+      break;
+
+    case CONFIG_TEMPERATURE_INTERVAL:
+      sensor_pipeline_interval_set(sensor_channels & SENSOR_CAPABILITY_TEMPERATURE, value);
+      schedule_sample();
+      break;
+
+    case CONFIG_HUMIDITY_INTERVAL:
+      sensor_pipeline_interval_set(sensor_channels & SENSOR_CAPABILITY_HUMIDITY, value);
+      schedule_sample();
+      break;
+
+    case CONFIG_PRESSURE_INTERVAL:
+      sensor_pipeline_interval_set(sensor_channels & SENSOR_CAPABILITY_PRESSURE, value);
+      schedule_sample();
+      break;
+
+    #if APPLICATION_AUTHENTICATED_ADV
+    case CONFIG_AUTH_KEY_0:
+    case CONFIG_AUTH_KEY_1:
+    case CONFIG_AUTH_KEY_2:
+    case CONFIG_AUTH_KEY_3:
+      auth_key_changed = true;
+      break;
+
+    case CONFIG_STORE_ALL:
+      if(auth_key_changed) { auth_key_load(); }
+      auth_key_changed = false;
+      break;
+    #endif
+
+    default:
+      break;
+  }
 }
 
 /**
@@ -245,7 +530,7 @@ static void reboot(void* p_context)
 ret_code_t button_press_handler(const ruuvi_standard_message_t message)
 {
   // Debounce
-  if(false == message.payload[1] && ((millis() - debounce) > DEBOUNCE_THRESHOLD) && !pressed)
+  if(false == message.payload[1] && rtc_deadline_passed(debounce_end) && !pressed)
   {
     NRF_LOG_INFO("Button pressed\r\n");
     GREEN_LED_ON;
@@ -265,32 +550,33 @@ ret_code_t button_press_handler(const ruuvi_standard_message_t message)
      GREEN_LED_OFF;
      RED_LED_OFF;
 
-     // Update mode
-     tag_mode++;
-     if(tag_mode > sizeof(advertising_rates)/sizeof(advertising_rates[0])) { tag_mode = 0; }
-     app_sched_event_put (&tag_mode, sizeof(&tag_mode), change_mode);
+     // Update mode, change handler enters it
+     uint32_t mode = tag_mode + 1;
+     if(mode >= sizeof(advertising_sizes)/sizeof(advertising_sizes[0])) { mode = RAWv1; }
+     config_store_set(CONFIG_MODE, mode);
 
      //Enter connectable mode if allowed by configuration.
      if(APP_GATT_PROFILE_ENABLED)
      {
-       app_sched_event_put (NULL, 0, become_connectable);
+       scheduler_event_put (NULL, 0, become_connectable, SCHEDULER_PRIORITY_IO);
      }
 
      // Schedule store mode to flash
-     app_sched_event_put (NULL, 0, store_mode);
+     scheduler_event_put (NULL, 0, config_store_commit_task, SCHEDULER_PRIORITY_BACKGROUND);
   }
 
-  debounce = millis();
+  debounce_end = rtc_deadline_ms(DEBOUNCE_THRESHOLD);
   return ENDPOINT_SUCCESS;
 }
 
 /**
- * Work around NFC data corruption bug by reinitializing NFC data after field has been lost.
+ * Work around NFC data corruption bug by rewriting NFC payload after field has been lost.
+ * Only the data record is re-encoded, NFC is not torn down.
  * Call this function outside of interrupt context.
  */
 static void reinit_nfc(void* data, uint16_t length)
 {
-  init_nfc();
+  nfc_data_set(data_buffer, advertising_sizes[tag_mode]);
 }
 
 /**@brief Function for handling NFC events.
@@ -309,10 +595,10 @@ void app_nfc_callback(void* p_context, nfc_t2t_event_t event, const uint8_t* p_d
 
     case NFC_T2T_EVENT_FIELD_OFF:
       NRF_LOG_INFO("NFC Field lost \r\n");
-      app_sched_event_put (NULL, 0, reinit_nfc);
+      scheduler_event_put (NULL, 0, reinit_nfc, SCHEDULER_PRIORITY_IO);
       if(APP_GATT_PROFILE_ENABLED)
       {
-        app_sched_event_put (NULL, 0, become_connectable);
+        scheduler_event_put (NULL, 0, become_connectable, SCHEDULER_PRIORITY_IO);
       }
       break;
 
@@ -341,68 +627,184 @@ static void power_manage(void)
 }
 
 
+#if APPLICATION_EDDYSTONE_FRAMES
+// Slots of advertisement rotator
+#define FRAME_SLOT_MANUFACTURER 0
+#define FRAME_SLOT_URL          1
+#define FRAME_SLOT_TLM          2
+
+static const char eddystone_url_base[] = APPLICATION_EDDYSTONE_URL;
+
+/** Time frame stays on air, ms, for given number of events at current advertising interval */
+static uint16_t frame_duration(uint8_t events)
+{
+  uint32_t interval = fast_advertising ? ADVERTISING_INTERVAL_STARTUP : advertising_interval();
+  uint32_t duration = events * interval;
+  return (UINT16_MAX < duration) ? UINT16_MAX : duration;
+}
+
+/**@brief Encode Eddystone URL and TLM of latest sensor values into their rotator slots.
+ */
+static void eddystone_frames_update(ruuvi_sensor_t* p_data)
+{
+  ret_code_t err_code = NRF_SUCCESS;
+  ble_advdata_t frame;
+  char url[sizeof(eddystone_url_base) + URL_PAYLOAD_LENGTH] = { 0 };
+  memcpy(url, eddystone_url_base, sizeof(eddystone_url_base));
+  encodeToUrlDataFromat(url, sizeof(eddystone_url_base), p_data);
+  err_code |= eddystone_prepare_url_advertisement(&frame, url, sizeof(eddystone_url_base) + URL_PAYLOAD_LENGTH);
+  err_code |= bluetooth_rotator_set(FRAME_SLOT_URL, &frame, frame_duration(APPLICATION_URL_FRAME_EVENTS));
+
+  uint32_t uptime = rtc_ticks64_get() * 10 / rtc_ticks_per_second();
+  err_code |= eddystone_prepare_tlm_advertisement(&frame, p_data->vbat, p_data->temperature,
+                                                  advertising_events, uptime);
+  err_code |= bluetooth_rotator_set(FRAME_SLOT_TLM, &frame, frame_duration(APPLICATION_TLM_FRAME_EVENTS));
+  if(NRF_SUCCESS != err_code) { NRF_LOG_WARNING("Eddystone frame update failed: %d\r\n", err_code); }
+}
+#endif
+
+/**@brief Advertise manufacturer data, in its rotator slot if Eddystone frames are enabled.
+ */
+static void set_manufacturer_data(uint8_t* data, size_t length)
+{
+  #if APPLICATION_EDDYSTONE_FRAMES
+    bluetooth_rotator_set_manufacturer_data(FRAME_SLOT_MANUFACTURER, data, length,
+                                            frame_duration(APPLICATION_RAW_FRAME_EVENTS));
+  #else
+    bluetooth_set_manufacturer_data(data, length);
+  #endif
+}
+
 static void updateAdvertisement(void)
 {
-  bluetooth_set_manufacturer_data(data_buffer, advertising_sizes[tag_mode]);
+  set_manufacturer_data(data_buffer, advertising_sizes[tag_mode]);
 }
 
 
-static void main_sensor_task(void* p_data, uint16_t length)
+/**@brief Start sample timer for next due channel of sensor pipeline.
+ *
+ * Does nothing while a sweep is in progress, its completion schedules next sample.
+ */
+static void schedule_sample(void)
 {
-  // Signal mode by led color.
-  if (RAWv1 == tag_mode) { RED_LED_ON; }
-  else { GREEN_LED_ON; }
+  rtc_deadline_t deadline;
+  if(sampling_channels || !sensor_pipeline_next(&deadline)) { return; }
+  app_timer_stop(sample_timer_id);
+  rtc_deadline_timer_start(sample_timer_id, deadline, NULL);
+}
 
-  ruuvi_sensor_t data = { .accX = ACCELERATION_INVALID,
-                          .accY = ACCELERATION_INVALID,
-                          .accZ = ACCELERATION_INVALID,
-                          .humidity = HUMIDITY_INVALID,
-                          .pressure = PRESSURE_INVALID,
-                          .temperature = TEMPERATURE_INVALID,
-                          .vbat = vbat
-                        };
-  lis2dh12_sensor_buffer_t buffer;
+/**@brief Store results of sensor sweep to pipeline cache and schedule next sample.
+ *
+ * Channels whose sensor is missing or failed to read are invalid and not stored.
+ */
+static void sensor_sweep_complete(ruuvi_sensor_t* p_data)
+{
+  sensor_pipeline_store(p_data, sampling_channels);
+  sampling_channels = 0;
+  schedule_sample();
+}
 
-  if (fast_advertising && ((millis() - fast_advertising_start) > ADVERTISING_STARTUP_PERIOD))
+/**@brief Read sensors of due channels.
+ *
+ * Reads of registered sensors are fanned out at once, SPI reads run back to back
+ * chained from SPI interrupt. Results are handled once in sensor_sweep_complete.
+ */
+static void sensor_read_task(void* p_data, uint16_t length)
+{
+  ruuvi_sensor_t invalid = { .accX = ACCELERATION_INVALID,
+                             .accY = ACCELERATION_INVALID,
+                             .accZ = ACCELERATION_INVALID,
+                             .humidity = HUMIDITY_INVALID,
+                             .pressure = PRESSURE_INVALID,
+                             .temperature = TEMPERATURE_INVALID
+                           };
+  sweep_data = invalid;
+  if(NRF_SUCCESS != sensor_sweep(&sweep_data, sampling_channels, sensor_sweep_complete))
   {
-    fast_advertising = false;
-    bluetooth_configure_advertisement_type(APPLICATION_ADVERTISEMENT_TYPE);
+    sampling_channels = 0;
+    schedule_sample();
+  }
+}
 
-    bluetooth_configure_advertising_interval(advertising_rates[tag_mode]);
-    bluetooth_apply_configuration();
+/**@brief Timeout handler for measurements started by sample task, results are ready to be read.
+ */
+static void sensor_ready_timer_handler(void * p_context)
+{
+  scheduler_event_put (NULL, 0, sensor_read_task, SCHEDULER_PRIORITY_REALTIME);
+}
+
+/**@brief Sample channels which are due.
+ *
+ * Sensors which sample on demand, e.g. BME280 in forced mode, start conversion of due
+ * channels only and read task runs once the slowest of them has data ready.
+ */
+static void sensor_sample_task(void* p_data, uint16_t length)
+{
+  if(sampling_channels) { return; }
+  sampling_channels = sensor_pipeline_due();
+  if(!sampling_channels)
+  {
+    schedule_sample();
+    return;
   }
 
-  if (bme280_available)
+  uint32_t ready_us = sensor_start_all(sampling_channels);
+  if (ready_us)
   {
-    // Get raw environmental data.
-    bme280_read_measurements();
-    data.temperature = bme280_get_temperature();
-    data.pressure    = bme280_get_pressure();
-    data.humidity    = bme280_get_humidity();
+    // +1 ms to account for rounding to app timer ticks.
+    uint32_t ready_ms = ready_us / 1000 + 1;
+    app_timer_start(sensor_ready_timer_id, APP_TIMER_TICKS(ready_ms, RUUVITAG_APP_TIMER_PRESCALER), NULL);
   }
-  // If only temperature sensor is present.
   else
   {
-    int32_t temp;                                        // variable to hold temp reading
-    (void)sd_temp_get(&temp);                            // get new temperature
-    temp *= 25;                                          // SD returns temp * 4. Ruuvi format expects temp * 100. 4*25 = 100.
-    data.temperature = temp;
+    sensor_read_task(NULL, 0);
   }
+}
 
-  if(lis2dh12_available)
+/**@brief Timeout handler for sampling deadline of sensor pipeline.
+ */
+static void sample_timer_handler(void * p_context)
+{
+  scheduler_event_put (NULL, 0, sensor_sample_task, SCHEDULER_PRIORITY_REALTIME);
+}
+
+/**@brief Encode latest sensor values to advertisement and NFC.
+ *
+ * Values come from sensor pipeline cache, channels not sampled recently are invalid.
+ */
+static void main_sensor_task(void* p_data, uint16_t length)
+{
+  // Signal mode by led color.
+  if (RAWv1 == tag_mode) { RED_LED_ON; }
+  else { GREEN_LED_ON; }
+
+  if (fast_advertising && rtc_deadline_passed(fast_advertising_end))
   {
-    // Get accelerometer data.
-    lis2dh12_read_samples(&buffer, 1);
-    data.accX = buffer.sensor.x;
-    data.accY = buffer.sensor.y;
-    data.accZ = buffer.sensor.z;
+    fast_advertising = false;
+    bluetooth_configure_advertisement_type(APPLICATION_ADVERTISEMENT_TYPE);
+
+    bluetooth_configure_advertising_interval(advertising_interval());
+    bluetooth_apply_configuration();
   }
 
+  ruuvi_sensor_t data = { .vbat = vbat };
+  sensor_pipeline_latest(&data);
   switch(tag_mode)
   {
     case RAWv2_FAST:
     case RAWv2_SLOW:
-      encodeToRawFormat5(data_buffer, &data, acceleration_events, BLE_TX_POWER);
+      #if APPLICATION_AUTHENTICATED_ADV
+      {
+        uint32_t counter;
+        if(auth_enabled && auth_counter_take(&counter))
+        {
+          encodeToAuthenticatedFormat(data_buffer, &data, acceleration_events, config_store_get(CONFIG_TX_POWER));
+          adv_auth_sign(&auth_cmac, auth_address, data_buffer, counter);
+          break;
+        }
+      }
+      #endif
+      encodeToRawFormat5(data_buffer, &data, acceleration_events, config_store_get(CONFIG_TX_POWER));
       break;
     
     case RAWv1:
@@ -411,15 +813,22 @@ static void main_sensor_task(void* p_data, uint16_t length)
       break;
   }
 
-  updateAdvertisement();
+  // Vibration analysis updates advertisement when a block is complete, latest gesture is kept for a while
+  if(!APPLICATION_VIBRATION_MONITOR && rtc_deadline_passed(gesture_adv_end)) { updateAdvertisement(); }
+  #if APPLICATION_EDDYSTONE_FRAMES
+    eddystone_frames_update(&data);
+  #endif
+  // Fails while field is on, payload is refreshed once field is lost.
+  nfc_data_set(data_buffer, advertising_sizes[tag_mode]);
+  NRF_LOG_DEBUG("Battery %d mV, load drop %d mV\r\n", vbat, battery_load_drop_get());
   watchdog_feed();
 }
 
-/**@brief Timeout handler for the repeated timer
+/**@brief Timeout handler for the repeated timer, runs at advertising rate of mode.
  */
 static void main_timer_handler(void * p_context)
 {
-  app_sched_event_put (NULL, 0, main_sensor_task);
+  scheduler_event_put (NULL, 0, main_sensor_task, SCHEDULER_PRIORITY_REALTIME);
 }
 
 
@@ -434,11 +843,15 @@ static void main_timer_handler(void * p_context)
 ret_code_t lis2dh12_int2_handler(const ruuvi_standard_message_t message)
 {
   NRF_LOG_DEBUG("Accelerometer interrupt to pin 2\r\n");
+  // Free-fall replaces activity, gesture engine counts events
+  if(APPLICATION_GESTURES_ENABLED) { return lis2dh12_gesture_int2_handler(message); }
   acceleration_events++;
+  if(APPLICATION_CAPTURE_ENABLED) { lis2dh12_capture_int2_handler(message); }
   /*
-  app_sched_event_put ((void*)(&message),
+  scheduler_event_put ((void*)(&message),
                        sizeof(message),
-                       lis2dh12_scheduler_event_handler);
+                       lis2dh12_scheduler_event_handler,
+                       SCHEDULER_PRIORITY_REALTIME);
   */
   return NRF_SUCCESS;
 }
@@ -446,17 +859,26 @@ ret_code_t lis2dh12_int2_handler(const ruuvi_standard_message_t message)
 /**
  * Task to run on radio activity
  * This function is in interrupt context, avoid long processing or using peripherals.
+ * Battery conversions are only started here, SAADC completes them in background.
  *
  * parameter active: True if radio is going to be active after event, false if radio was turned off (after tx/rx)
  */
 static void on_radio_evt(bool active)
 {
-  // If radio is turned off (was active) and enough time has passed since last measurement
-  if(false == active && millis() - last_battery_measurement > APPLICATION_BATTERY_INTERVAL)
+  if(active) { advertising_events++; }
+  // Radio is about to turn on and enough time has passed since last measurement: sample rested battery
+  if(true == active && rtc_deadline_passed(next_battery_measurement))
+  {
+    battery_idle_sampled = (NRF_SUCCESS == battery_sample_start(BATTERY_SAMPLE_IDLE));
+  }
+  // Radio was turned off: sample battery recovering from TX load
+  else if(false == active && battery_idle_sampled)
   {
-    vbat = getBattery();
-    last_battery_measurement = millis();
+    battery_sample_start(BATTERY_SAMPLE_LOAD);
+    battery_idle_sampled = false;
+    next_battery_measurement = rtc_deadline_ms(APPLICATION_BATTERY_INTERVAL);
   }
+  vbat = battery_voltage_get();
 }
 
 /**  This is where it all starts ++++++++++++++++++++++++++++++++++++++++++ 
@@ -471,7 +893,7 @@ static void on_radio_evt(bool active)
  Since some events occur after tag is deployed and no one can see the LEDs the system continues operating.
 
  After initalizition (including setting up interrupts)
-    we loop here calling app_sched_execute and sd_app_evt_wait 
+    we loop here calling scheduler_execute and sd_app_evt_wait 
 */
 int main(void)
 {
@@ -479,8 +901,12 @@ int main(void)
   init_leds();
   RED_LED_ON;
 
+  // Before SoftDevice, which owns reset reasons once enabled
+  warm_boot = warm_boot_init() && warm_boot_state_load(&warm_state, sizeof(warm_state));
+
   if( init_log() ) { init_status |=LOG_FAILED_INIT; }
   else { NRF_LOG_INFO("LOG initialized \r\n"); } // subsequent initializations assume log is working
+  if(warm_boot) { NRF_LOG_INFO("Warm boot %d\r\n", warm_boot_count()); }
 
   // start watchdog now in case program hangs up.
   // watchdog_default_handler logs error and resets the tag.
@@ -493,21 +919,6 @@ int main(void)
   if( vbat < BATTERY_MIN_V ) { init_status |=BATTERY_FAILED_INIT; }
   else NRF_LOG_INFO("BATTERY initalized \r\n"); 
 
-  if(init_lis2dh12() == NRF_SUCCESS )
-  {
-    lis2dh12_available = true;
-    NRF_LOG_INFO("Accelerometer initialized \r\n");  
-  }
-  else { init_status |= ACC_INT_FAILED_INIT; }
-
-  if(init_bme280() == NRF_SUCCESS )
-  {
-    bme280_available = true;
-    NRF_LOG_INFO("BME initialized \r\n");  
-  } 
-  else { init_status |= TEMP_HUM_PRESS_FAILED_INIT; }
-
-
   // Init NFC ASAP in case we're waking from deep sleep via NFC (todo)
   // outputs ID:DEVICEID ,MAC:DEVICEADDR, SW:REVision
   set_nfc_callback(app_nfc_callback);
@@ -524,7 +935,6 @@ int main(void)
   // Initialize BLE Stack. Starts LFCLK required for timer operation.
   if( init_ble() ) { init_status |= BLE_FAILED_INIT; }
   bluetooth_configure_advertisement_type(STARTUP_ADVERTISEMENT_TYPE);
-  bluetooth_tx_power_set(BLE_TX_POWER);
   bluetooth_configure_advertising_interval(ADVERTISING_INTERVAL_STARTUP);
 
   // Priorities 2 and 3 are after SD timing critical events. 
@@ -551,18 +961,89 @@ int main(void)
     flash_free_size_get(&flash_space_remaining);
     NRF_LOG_INFO("Continuous space remaining after gc %d bytes\r\n", flash_space_remaining);
   }
-  else if (flash_record_get(FDS_FILE_ID, FDS_RECORD_ID, sizeof(tag_mode), &tag_mode))
+
+  // Values changed over GATT, defaults for the rest
+  if(config_store_init(config_items, sizeof(config_items)/sizeof(config_items[0]), config_changed))
+  {
+    NRF_LOG_ERROR("Invalid configuration table \r\n");
+  }
+  tag_mode = config_store_get(CONFIG_MODE);
+  // Mode stored by earlier firmware is moved to configuration once, record is deleted after
+  uint32_t stored_mode = DEFAULT_MODE;
+  if(NRF_SUCCESS == flash_record_get(FDS_FILE_ID, FDS_RECORD_ID, sizeof(stored_mode), &stored_mode))
   {
-   NRF_LOG_INFO("Did not find mode in flash, is this first boot? \r\n");
+    if(!(CONFIG_STORE_FLAG_STORED & config_store_flags(CONFIG_MODE)) &&
+       NRF_SUCCESS == config_store_set(CONFIG_MODE, stored_mode))
+    {
+      config_store_commit(0);
+    }
+    flash_record_delete(FDS_FILE_ID, FDS_RECORD_ID);
+  }
+  NRF_LOG_INFO("Mode %d\r\n", tag_mode);
+  set_config_handler(config_store_handler);
+  bluetooth_tx_power_set(config_store_get(CONFIG_TX_POWER));
+  #if APPLICATION_AUTHENTICATED_ADV
+    // Counters up to stored reservation may have been used before reset
+    auth_counter = config_store_get(CONFIG_AUTH_COUNTER);
+    getDeviceAddress(auth_address);
+    auth_key_load();
+  #endif
+
+  // Sensors after flash, which has calibration of sensors
+  // In order of preference, on-chip temperature is used only if BME280 is missing
+  sensor_pipeline_init();
+  sensor_register(&lis2dh12_sensor);
+  sensor_register(&bme280_sensor);
+  sensor_register(&temperature_sensor);
+  if(warm_boot)
+  {
+    // Sensors found on cold boot, BME280 gets calibration read on cold boot
+    if(warm_state.bme280_calibrated) { bme280_init_calibrated(&warm_state.bme280_calibration); }
+    sensor_channels = sensor_resume_all(warm_state.sensors);
   }
-  else 
+  else
+  {
+    // Calibration of previous cold boot is confirmed with one short read
+    uint8_t calibration[BME280_CALIBRATION_LENGTH];
+    if(NRF_SUCCESS == calibration_cache_load(BME280_ID_VALUE, calibration, sizeof(calibration)))
+    {
+      bme280_preload_calibration(calibration);
+    }
+    sensor_channels = sensor_init_all();
+  }
+
+  if(sensor_is_active(&lis2dh12_sensor))
+  {
+    lis2dh12_available = true;
+    NRF_LOG_INFO("Accelerometer initialized \r\n");  
+  }
+  else { init_status |= ACC_INT_FAILED_INIT; }
+
+  if(sensor_is_active(&bme280_sensor))
+  {
+    bme280_available = true;
+    NRF_LOG_INFO("BME initialized \r\n");  
+  } 
+  else { init_status |= TEMP_HUM_PRESS_FAILED_INIT; }
+  // First boot or BME280 has other calibration than cached
+  if(bme280_available && !warm_boot && !bme280_calibration_is_preloaded())
   {
-    NRF_LOG_INFO("Loaded mode %d from flash\r\n", tag_mode);
+    calibration_cache_store(BME280_ID_VALUE, bme280_get_calibration_raw(), BME280_CALIBRATION_LENGTH);
   }
 
+  warm_state.sensors = sensor_active_mask();
+  warm_state.bme280_calibrated = bme280_available;
+  if(bme280_available) { warm_state.bme280_calibration = *bme280_get_calibration(); }
+  warm_boot_state_store(&warm_state, sizeof(warm_state));
+
   if( init_rtc() ) { init_status |= RTC_FAILED_INIT; }
   else { NRF_LOG_INFO("RTC initialized \r\n"); }
 
+  // Deadlines are counted from RTC, acceleration follows main loop interval of mode, set in change_mode
+  sensor_pipeline_interval_set(sensor_channels & SENSOR_CAPABILITY_TEMPERATURE, config_store_get(CONFIG_TEMPERATURE_INTERVAL));
+  sensor_pipeline_interval_set(sensor_channels & SENSOR_CAPABILITY_HUMIDITY, config_store_get(CONFIG_HUMIDITY_INTERVAL));
+  sensor_pipeline_interval_set(sensor_channels & SENSOR_CAPABILITY_PRESSURE, config_store_get(CONFIG_PRESSURE_INTERVAL));
+
   // Configure lis2dh12
   if (lis2dh12_available)    
   {
@@ -573,33 +1054,52 @@ int main(void)
     {
       init_status |= ACC_INT_FAILED_INIT;
     }
+    // FIFO watermark of spectral analysis and capture
+    if ((APPLICATION_VIBRATION_MONITOR || APPLICATION_CAPTURE_ENABLED) &&
+        pin_interrupt_enable(INT_ACC1_PIN, NRF_GPIOTE_POLARITY_LOTOHI, NRF_GPIO_PIN_NOPULL, lis2dh12_int1_handler) )
+    {
+      init_status |= ACC_INT_FAILED_INIT;
+    }
+    // Tap and orientation events
+    if (APPLICATION_GESTURES_ENABLED &&
+        pin_interrupt_enable(INT_ACC1_PIN, NRF_GPIOTE_POLARITY_LOTOHI, NRF_GPIO_PIN_NOPULL, lis2dh12_gesture_int1_handler) )
+    {
+      init_status |= ACC_INT_FAILED_INIT;
+    }
     
-    nrf_delay_ms(10); // Wait for LIS reboot.
+    if(!warm_boot) { nrf_delay_ms(10); } // Wait for LIS reboot, it stays powered over warm reset.
     // Enable XYZ axes.
     lis2dh12_enable();
     lis2dh12_set_scale(LIS2DH12_SCALE);
     lis2dh12_set_sample_rate(LIS2DH12_SAMPLERATE_RAWv1);
     lis2dh12_set_resolution(LIS2DH12_RESOLUTION);
 
-    lis2dh12_set_activity_interrupt_pin_2(LIS2DH12_ACTIVITY_THRESHOLD);
+    #if APPLICATION_GESTURES_ENABLED
+      if(lis2dh12_gesture_init(&gesture_config, gesture_adv_handler)) { init_status |= ACC_INT_FAILED_INIT; }
+    #else
+      lis2dh12_set_activity_interrupt_pin_2(config_store_get(CONFIG_ACTIVITY_THRESHOLD));
+    #endif
+    // Capture is armed by change_mode, download with LOG_QUERY to CAPTURE endpoint
+    if(APPLICATION_CAPTURE_ENABLED) { set_capture_handler(lis2dh12_capture_handler); }
     NRF_LOG_INFO("Accelerometer configuration done \r\n");
   }
   if(bme280_available)
   {
     // oversampling must be set for each used sensor.
-    bme280_set_oversampling_hum  (BME280_HUMIDITY_OVERSAMPLING);
-    bme280_set_oversampling_temp (BME280_TEMPERATURE_OVERSAMPLING);
-    bme280_set_oversampling_press(BME280_PRESSURE_OVERSAMPLING);
+    bme280_set_oversampling_hum  (config_store_get(CONFIG_HUMIDITY_OVERSAMPLING));
+    bme280_set_oversampling_temp (config_store_get(CONFIG_TEMPERATURE_OVERSAMPLING));
+    bme280_set_oversampling_press(config_store_get(CONFIG_PRESSURE_OVERSAMPLING));
     bme280_set_iir(BME280_IIR);
     bme280_set_interval(BME280_DELAY);
-    bme280_set_mode(BME280_MODE_NORMAL);
+    // Forced mode takes first sample here, later samples are triggered by sensor pipeline.
+    bme280_set_mode(BME280_FORCED_MODE ? BME280_MODE_FORCED : BME280_MODE_NORMAL);
     NRF_LOG_INFO("BME280 configuration done \r\n");
   }
 
   // Enter stored mode after boot - or default mode if store mode was not found
-  app_sched_event_put (&tag_mode, sizeof(&tag_mode), change_mode);
+  scheduler_event_put (&tag_mode, sizeof(&tag_mode), change_mode, SCHEDULER_PRIORITY_IO);
   
-  // Initialize repeated timer for sensor read and single-shot timer for button reset
+  // Initialize repeated timer for advertisement update and single-shot timers for button reset and sampling
   if( init_timer(main_timer_id, APP_TIMER_MODE_REPEATED, MAIN_LOOP_INTERVAL_RAW, main_timer_handler) )
   {
     init_status |= TIMER_FAILED_INIT;
@@ -609,15 +1109,26 @@ int main(void)
   {
     init_status |= TIMER_FAILED_INIT;
   }
-  // Init starts timers, stop the reset
+  if( init_timer(sensor_ready_timer_id, APP_TIMER_MODE_SINGLE_SHOT, MAIN_LOOP_INTERVAL_RAW, sensor_ready_timer_handler) )
+  {
+    init_status |= TIMER_FAILED_INIT;
+  }
+  if( init_timer(sample_timer_id, APP_TIMER_MODE_SINGLE_SHOT, MAIN_LOOP_INTERVAL_RAW, sample_timer_handler) )
+  {
+    init_status |= TIMER_FAILED_INIT;
+  }
+  // Init starts timers, stop the reset, sensor ready and sample timers
   app_timer_stop(reset_timer_id);
+  app_timer_stop(sensor_ready_timer_id);
+  app_timer_stop(sample_timer_id);
 
   // Log errors, add a note to NFC, blink RED to visually indicate the problem
   if (init_status)
   { 
     snprintf((char* )NFC_message, NFC_message_length, "Error: %X", init_status);
     NRF_LOG_WARNING (" -- Initialization error :  %X \r\n", init_status);
-    for ( int16_t i=0; i<13; i++)
+    // Tag resets itself on warm boots, errors were already blinked on cold boot
+    for ( int16_t i=0; i<13 && !warm_boot; i++)
     { 
       RED_LED_ON;
       nrf_delay_ms(500u);
@@ -636,21 +1147,37 @@ int main(void)
   // Turn off red led, leave green on to signal model+ without errors
   RED_LED_OFF;
 
-  // Wait for sensors to take first sample
-  nrf_delay_ms(1000);
-  // Get first sample from sensors, set fast advertising start counter
-  fast_advertising_start = millis();
-  app_sched_event_put (NULL, 0, main_sensor_task);
-  app_sched_execute();
+  // Wait for sensors to take first sample. Sensors stay powered over a warm reset
+  // and have the latest sample of previous boot ready.
+  if(!warm_boot) { nrf_delay_ms(1000); }
+  // Get first sample of all channels into pipeline, set end of fast advertising
+  fast_advertising_end = rtc_deadline_ms(ADVERTISING_STARTUP_PERIOD);
+  next_battery_measurement = rtc_deadline_ms(APPLICATION_BATTERY_INTERVAL);
+  scheduler_event_put (NULL, 0, sensor_sample_task, SCHEDULER_PRIORITY_REALTIME);
+  scheduler_execute();
+  while(sampling_channels)
+  {
+    power_manage();
+    scheduler_execute();
+  }
+  scheduler_event_put (NULL, 0, main_sensor_task, SCHEDULER_PRIORITY_REALTIME);
+  scheduler_execute();
 
   // Start advertising 
+  if(APPLICATION_EDDYSTONE_FRAMES && NRF_SUCCESS != bluetooth_rotator_start())
+  {
+    NRF_LOG_ERROR("Advertisement rotator was not started\r\n");
+  }
   bluetooth_advertising_start(); 
   NRF_LOG_INFO("Advertising started\r\n");
 
   // Enter main loop. Executes tasks scheduled by timers and interrupts.
   for (;;)
   {
-    app_sched_execute();
+    scheduler_execute();
+    trace_process();
+    // Replies and bulk downloads wait in queue until NUS has buffers
+    if(APP_GATT_PROFILE_ENABLED) { ble_message_queue_process(); }
     // Sleep until next event.
     power_manage();
   }
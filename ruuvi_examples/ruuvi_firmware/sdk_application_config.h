@@ -18,6 +18,11 @@
 #define TIMER3_ENABLED  1
 #define TIMER4_ENABLED  0  // Required by NFC
 #define NFC_HAL_ENABLED 1
+#define RTC_ENABLED     0  // millis() and deadlines use RTC1 of app_timer, RTC2 stays off
+// Battery is sampled with 12-bit resolution, 16x oversampling in burst mode.
+// Averaging is done by SAADC in background, CPU is not involved.
+#define SAADC_CONFIG_RESOLUTION 2  // 12 bit
+#define SAADC_CONFIG_OVERSAMPLE 4  // 16x
 #define FDS_CRC_ENABLED 1  // Driver checks if value is defined, comment this line out to disable CRC
 #if FDS_CRC_ENABLED
   #define CRC16_ENABLED   FDS_CRC_ENABLED  
@@ -25,6 +30,10 @@
 #endif
 
 #define NRF_LOG_ENABLED 1  // Disable log output by default to save space (unless needed for testing)
+// Record hot path logs as binary trace instead of formatting them, drained to RTT channel 1.
+// Decode with tools/trace_decoder and the ELF of the same build.
+#define TRACE_ENABLED     0
+#define TRACE_BACKEND_RTT 1
 
 #if APP_GATT_PROFILE_ENABLED
   #define BLE_DIS_ENABLED 1  //Device information service
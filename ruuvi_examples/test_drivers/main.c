@@ -200,7 +200,7 @@ int main(void)
   while(1)
   {
     //Execute scheduler first
-    app_sched_execute();
+    scheduler_execute();
     //Process queue once schdule has placed new elements to queue
     ble_message_queue_process(); 
     NRF_LOG_DEBUG("Loop\r\n");
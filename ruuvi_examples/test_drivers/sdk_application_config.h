@@ -15,6 +15,7 @@
 #define TIMER3_ENABLED 1
 #define TIMER4_ENABLED  0  //Required by NFC
 #define NFC_HAL_ENABLED 1
+#define RTC_ENABLED 0  // millis() uses RTC1 of app_timer
 #define CRC16_ENABLED 1
 #define CRC32_ENABLED 1
 #define NRF_LOG_ENABLED 1
@@ -155,7 +155,7 @@ static void test_sample_rates(void)
   //Loop through allowed values
   for(uint8_t ii = 0; ii < sizeof(samplerates); ii++){
     //Store start
-    uint64_t start = millis();
+    uint32_t start = millis();
     //Setup sample rate
     lis2dh12_set_sample_rate(samplerates[ii]);
     //Clear FIFO
@@ -169,10 +169,10 @@ static void test_sample_rates(void)
     while(!interrupted1 && ((millis() - start) < sampling_timeouts[ii]));
 
     //Store time of interrupt
-    uint64_t stop = millis();
+    uint32_t stop = millis();
 
     //Check we're in range
-    uint64_t time = stop-start;
+    uint32_t time = stop-start;
     if(sampling_timeouts[ii] <= time || sampling_timeouts[ii]/2 > time) {NRF_LOG_ERROR("Sample rate nbr %d took %d ms to read 8 samples\r\n", ii, time);}
 
   }
@@ -10,6 +10,8 @@ void test_nfc(void)
   //TODO: Test binary data setup
   //TODO: Setup limits for data, test error reporting from NFC.
   nfc_init(NULL, 0);
+  static const uint8_t data[] = {0x03, 0x52, 0xAB, 0xCD};
+  NRF_LOG_INFO("Data update status: %d\r\n", nfc_data_set(data, sizeof(data)));
   NRF_LOG_INFO("Waiting for NFC field\r\n");
   sd_app_evt_wait();
 }
@@ -0,0 +1,139 @@
+#include "es_security_cache.h"
+#include "es.h"
+#include "es_security.h"
+#include "eid_cache.h"
+#include "nrf_soc.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define NRF_LOG_MODULE_NAME "ES_SECURITY_CACHE"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+
+#define NO_SLOT 0xFF
+
+typedef struct {
+  uint8_t     slot;                /**< Slot number of es_security */
+  bool        used;
+  bool        valid;               /**< Cache has current key and scaler of slot */
+  uint8_t     exponent;
+  uint8_t     key[AES_KEY_SIZE];   /**< Identity key the cache was set up with */
+  eid_cache_t cache;
+}slot_cache_t;
+
+static slot_cache_t m_slots[ES_SECURITY_CACHE_SLOTS];
+static volatile bool m_refilling = false;        // Frames fall back to SDK while cache changes
+static volatile uint8_t m_wanted = NO_SLOT;      // Slot asked for without a cache
+
+void __real_es_security_eid_get(uint8_t slot_no, uint8_t * p_eid_buffer);
+void __real_es_security_tlm_to_etlm(uint8_t ik_slot_no, es_tlm_frame_t * p_tlm, es_etlm_frame_t * p_etlm);
+
+/** Return cache of slot if it has current key and scaler of slot, NULL otherwise */
+static slot_cache_t* cache_of(uint8_t slot_no)
+{
+  if(m_refilling) { return NULL; }
+  for(uint8_t ii = 0; ii < ES_SECURITY_CACHE_SLOTS; ii++)
+  {
+    slot_cache_t* p_slot = &m_slots[ii];
+    if(!p_slot->used || slot_no != p_slot->slot) { continue; }
+    // Key may have been changed over GATT since last refill, a copy is cheap to check
+    uint8_t key[AES_KEY_SIZE];
+    es_security_plain_eik_get(slot_no, key);
+    if(p_slot->exponent != es_security_scaler_get(slot_no) || memcmp(key, p_slot->key, sizeof(key)))
+    {
+      p_slot->valid = false;
+    }
+    memset(key, 0, sizeof(key));
+    return p_slot->valid ? p_slot : NULL;
+  }
+  m_wanted = slot_no;
+  return NULL;
+}
+
+void __wrap_es_security_eid_get(uint8_t slot_no, uint8_t * p_eid_buffer)
+{
+  slot_cache_t* p_slot = cache_of(slot_no);
+  if(NULL == p_slot || !eid_cache_get(&p_slot->cache, es_security_clock_get(slot_no), p_eid_buffer))
+  {
+    __real_es_security_eid_get(slot_no, p_eid_buffer);
+  }
+}
+
+void __wrap_es_security_tlm_to_etlm(uint8_t ik_slot_no, es_tlm_frame_t * p_tlm, es_etlm_frame_t * p_etlm)
+{
+  slot_cache_t* p_slot = cache_of(ik_slot_no);
+  uint8_t plain[EID_ETLM_PLAIN_LENGTH];
+  uint8_t etlm[EID_ETLM_LENGTH];
+  // Plain TLM after version: VBATT, TEMP, ADV_CNT, SEC_CNT
+  memcpy(plain, &p_tlm->vbatt, sizeof(plain));
+  // Nonce time is timestamp of current EID
+  if(NULL == p_slot ||
+     !eid_cache_etlm_get(&p_slot->cache, eid_rotation_start(p_slot->exponent, es_security_clock_get(ik_slot_no)),
+                         plain, etlm))
+  {
+    __real_es_security_tlm_to_etlm(ik_slot_no, p_tlm, p_etlm);
+    return;
+  }
+  memset(p_etlm, 0, sizeof(es_etlm_frame_t));
+  p_etlm->frame_type = p_tlm->frame_type;
+  p_etlm->version = ES_TLM_VERSION_ETLM;
+  memcpy(p_etlm->encrypted_tlm, etlm, EID_ETLM_PLAIN_LENGTH);
+  memcpy(&p_etlm->random_salt, &etlm[EID_ETLM_SALT_OFFSET], sizeof(p_etlm->random_salt));
+  memcpy(&p_etlm->msg_integrity_check, &etlm[EID_ETLM_MIC_OFFSET], sizeof(p_etlm->msg_integrity_check));
+}
+
+/** Give a free cache to slot asked for. Caches are not released, EID slots rarely change */
+static void slot_take(void)
+{
+  uint8_t slot_no = m_wanted;
+  m_wanted = NO_SLOT;
+  if(NO_SLOT == slot_no) { return; }
+  for(uint8_t ii = 0; ii < ES_SECURITY_CACHE_SLOTS; ii++)
+  {
+    if(m_slots[ii].used && slot_no == m_slots[ii].slot) { return; }
+  }
+  for(uint8_t ii = 0; ii < ES_SECURITY_CACHE_SLOTS; ii++)
+  {
+    if(m_slots[ii].used) { continue; }
+    m_slots[ii].slot = slot_no;
+    m_slots[ii].valid = false;
+    m_slots[ii].used = true;
+    NRF_LOG_DEBUG("Caching EID slot %d\r\n", slot_no);
+    return;
+  }
+}
+
+uint8_t es_security_cache_refill(void)
+{
+  uint8_t computed = 0;
+  m_refilling = true;
+  slot_take();
+  for(uint8_t ii = 0; ii < ES_SECURITY_CACHE_SLOTS; ii++)
+  {
+    slot_cache_t* p_slot = &m_slots[ii];
+    if(!p_slot->used) { continue; }
+    if(!p_slot->valid)
+    {
+      p_slot->exponent = es_security_scaler_get(p_slot->slot);
+      if(EID_MAX_EXPONENT < p_slot->exponent) { continue; }
+      es_security_plain_eik_get(p_slot->slot, p_slot->key);
+      eid_cache_init(&p_slot->cache, p_slot->key, p_slot->exponent);
+      p_slot->valid = true;
+    }
+    uint32_t time = es_security_clock_get(p_slot->slot);
+    computed += eid_cache_refill(&p_slot->cache, time);
+
+    // Salt is random as in SDK, a new one for each eTLM
+    uint32_t start = eid_rotation_start(p_slot->exponent, time);
+    uint16_t salt;
+    if((!p_slot->cache.etlm_ready || start != p_slot->cache.etlm_time) &&
+       NRF_SUCCESS == sd_rand_application_vector_get((uint8_t*)&salt, sizeof(salt)))
+    {
+      eid_cache_etlm_prepare(&p_slot->cache, start, salt);
+      computed++;
+    }
+  }
+  m_refilling = false;
+  return computed;
+}
@@ -0,0 +1,36 @@
+#ifndef ES_SECURITY_CACHE_H
+#define ES_SECURITY_CACHE_H
+
+/**
+ *  EIDs and eTLM of SDK Eddystone security module from libraries/eddystone_eid.
+ *
+ *  es_security_cache.c replaces es_security_eid_get() and es_security_tlm_to_etlm() of
+ *  SDK es_security.c through the linker, link with
+ *    -Wl,--wrap=es_security_eid_get -Wl,--wrap=es_security_tlm_to_etlm
+ *  Rest of the security module, i.e. keys, clock, lock and ECDH, is used unchanged.
+ *
+ *  Frames read EIDs and prepared eTLM from an eid_cache_t per EID slot, refilled by
+ *  es_security_cache_refill() in idle time. Slots are taken as their first frame is
+ *  asked for. On a miss, e.g. first frame of a slot, new key or slot past
+ *  ES_SECURITY_CACHE_SLOTS, the SDK computes the frame as before.
+ *
+ *  License: BSD-3
+ */
+
+#include <stdint.h>
+
+/** EID slots with a cache, ~500 bytes of RAM each. Other slots are computed by SDK */
+#ifndef ES_SECURITY_CACHE_SLOTS
+  #define ES_SECURITY_CACHE_SLOTS 2
+#endif
+
+/**
+ *  Take slots asked for, follow changed keys, compute EIDs of current and next rotation
+ *  period and prepare next eTLM. Call from main loop before sleeping, cheap when cache
+ *  is full.
+ *
+ *  @return number of EIDs and eTLM computed
+ */
+uint8_t es_security_cache_refill(void);
+
+#endif
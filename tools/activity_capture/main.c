@@ -0,0 +1,293 @@
+/**
+ *  Host test of libraries/dsp/capture as used by drivers/lis2dh12/lis2dh12_capture.
+ *
+ *  An emulated LIS2DH12 streams samples into a 32 sample FIFO. Watermark of 16 schedules
+ *  a drain of the FIFO into capture and activity on high-passed acceleration schedules a
+ *  trigger, both after a configurable scheduler latency in samples. Trigger counts the
+ *  samples still in FIFO as pending like lis2dh12_capture does. Once frozen, watermark
+ *  interrupt stops and FIFO is bypassed as the accelerometer returns to rest rate, so
+ *  output registers read for advertisement must hold the latest sample, not a stale one
+ *  from FIFO.
+ *
+ *  Every sample is numbered, so frozen capture can be checked sample by sample against
+ *  the stream: impact must be within trigger latency before the trigger index and readout
+ *  in download sized parts must reassemble into the full capture.
+ *
+ *  Usage: activity_capture [-v]
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capture.h"
+#include "nrf_error.h"
+
+#define FIFO_LENGTH         32
+#define FIFO_WATERMARK      16    // LIS2DH12_CAPTURE_WATERMARK
+#define ACTIVITY_MG         64
+#define DOWNLOAD_SAMPLES    512   // LIS2DH12_CAPTURE_DOWNLOAD_SAMPLES
+#define BULK_CHUNK          18    // BLE_CHUNK_SIZE of ble_bulk_transfer
+#define MAX_STREAM          20000
+
+typedef struct {
+  const char* name;
+  uint16_t    sample_rate_hz;
+  uint16_t    pre;
+  uint16_t    post;
+  uint32_t    impact_at;          // Sample of impact onset
+  uint16_t    drain_latency;      // Samples from watermark to drain
+  uint16_t    trigger_latency;    // Samples from activity to trigger task
+  uint32_t    second_impact_at;   // Impact after freeze, must be ignored. 0 for none
+}scenario_t;
+
+static const scenario_t scenarios[] = {
+  { "drop on table",        400, 120, 400,  2000, 1, 1, 0    },
+  { "slow scheduler",       400, 120, 400,  2000, 14, 6, 0   },
+  { "impact right away",    400, 120, 400,    50, 1, 1, 0    },
+  { "long wait, wrapped",   400, 256, 512, 15000, 2, 2, 0    },
+  { "second impact frozen", 200, 100, 300,  1000, 1, 1, 1500 },
+  { "full ring",            400, 512, 512,  3000, 1, 0, 0    }
+};
+
+static bool verbose = false;
+static int16_t stream[MAX_STREAM][3];
+
+/** Gravity on Z, small noise, damped ring-down of impact on all axes, quantized to 4 mg */
+static void stream_generate(const scenario_t* p_scenario)
+{
+  srand(1);
+  for(uint32_t ii = 0; ii < MAX_STREAM; ii++)
+  {
+    double value[3] = { 0, 0, 1000 };
+    uint32_t impacts[2] = { p_scenario->impact_at, p_scenario->second_impact_at };
+    for(uint8_t jj = 0; jj < 2; jj++)
+    {
+      if(0 == impacts[jj] || ii < impacts[jj]) { continue; }
+      double t = (double)(ii - impacts[jj]) / p_scenario->sample_rate_hz;
+      double ring_down = 1500 * exp(-t * 40) * cos(2 * M_PI * 60 * t);
+      value[0] += ring_down;
+      value[1] -= ring_down / 2;
+      value[2] += ring_down / 3;
+    }
+    for(uint8_t axis = 0; axis < 3; axis++)
+    {
+      value[axis] += ((rand() % 9) - 4);
+      stream[ii][axis] = (int16_t)(4 * lround(value[axis] / 4));
+    }
+  }
+}
+
+typedef struct {
+  uint32_t fifo_start;      // Number of first sample in FIFO
+  uint32_t fifo_count;
+  int32_t  drain_at;        // Sample at which drain runs, -1 if not scheduled
+  int32_t  trigger_at;      // Sample at which trigger runs, -1 if not scheduled
+  bool     watermark;       // Watermark interrupt enabled
+  bool     fifo_enabled;    // Stream mode, bypass otherwise
+  uint32_t output;          // Sample in output registers at end of run
+  uint32_t drains;
+  uint32_t overflows;
+}emulator_t;
+
+static void drain(emulator_t* p_lis)
+{
+  p_lis->drains++;
+  for(uint32_t ii = 0; ii < p_lis->fifo_count; ii++)
+  {
+    const int16_t* p_sample = stream[p_lis->fifo_start + ii];
+    if(capture_sample_put(p_sample[0], p_sample[1], p_sample[2]))
+    {
+      // lis2dh12_capture_put returns to rest, remaining samples are not captured
+      p_lis->watermark = false;
+      p_lis->fifo_enabled = false;
+      break;
+    }
+  }
+  p_lis->fifo_start += p_lis->fifo_count;
+  p_lis->fifo_count = 0;
+}
+
+/** Run stream through emulated FIFO, return sample count when capture froze or 0 */
+static uint32_t run(const scenario_t* p_scenario, emulator_t* p_lis, uint32_t length)
+{
+  memset(p_lis, 0, sizeof(emulator_t));
+  p_lis->drain_at = -1;
+  p_lis->trigger_at = -1;
+  p_lis->watermark = true;
+  p_lis->fifo_enabled = true;
+  uint32_t frozen_at = 0;
+  for(uint32_t ii = 0; ii < length; ii++)
+  {
+    // New sample, bypass keeps only latest, stream mode drops oldest on overflow
+    if(!p_lis->fifo_enabled)
+    {
+      p_lis->fifo_start = ii;
+      p_lis->fifo_count = 0;
+    }
+    else if(FIFO_LENGTH == p_lis->fifo_count)
+    {
+      p_lis->fifo_start++;
+      p_lis->fifo_count--;
+      if(CAPTURE_FROZEN != capture_state()) { p_lis->overflows++; }
+    }
+    p_lis->fifo_count++;
+
+    // Activity interrupt on deviation from gravity, handler schedules trigger only while armed
+    if(ii && abs(stream[ii][0] - stream[ii - 1][0]) > ACTIVITY_MG && -1 == p_lis->trigger_at &&
+       CAPTURE_ARMED == capture_state())
+    {
+      p_lis->trigger_at = ii + p_scenario->trigger_latency;
+    }
+    if(p_lis->watermark && FIFO_WATERMARK <= p_lis->fifo_count && -1 == p_lis->drain_at)
+    {
+      p_lis->drain_at = ii + p_scenario->drain_latency;
+    }
+
+    // Scheduler runs events in order of scheduling at end of sample period
+    if((int32_t)ii == p_lis->trigger_at)
+    {
+      capture_trigger(p_lis->fifo_count);
+      p_lis->trigger_at = -1;
+    }
+    if((int32_t)ii == p_lis->drain_at)
+    {
+      drain(p_lis);
+      p_lis->drain_at = -1;
+    }
+    if(!frozen_at && CAPTURE_FROZEN == capture_state()) { frozen_at = ii + 1; }
+  }
+  // Output registers show oldest FIFO entry in stream mode, latest sample in bypass
+  p_lis->output = (p_lis->fifo_enabled && p_lis->fifo_count) ? p_lis->fifo_start : length - 1;
+  return frozen_at;
+}
+
+static bool check_scenario(const scenario_t* p_scenario)
+{
+  bool pass = true;
+  emulator_t lis;
+  stream_generate(p_scenario);
+  capture_arm(p_scenario->sample_rate_hz, p_scenario->pre, p_scenario->post);
+  uint32_t length = p_scenario->impact_at + p_scenario->post + 4 * FIFO_LENGTH + 1000;
+  if(p_scenario->second_impact_at) { length = p_scenario->second_impact_at + 1000; }
+  uint32_t frozen_at = run(p_scenario, &lis, length);
+  capture_info_t info = capture_info();
+
+  if(!frozen_at || CAPTURE_FROZEN != info.state) { printf("%-22s not frozen: FAIL\n", p_scenario->name); return false; }
+  uint16_t expected_pre = (p_scenario->impact_at < p_scenario->pre) ? 0 : p_scenario->pre;
+
+  // Read in download sized parts as LOG_QUERY does
+  static uint8_t full[CAPTURE_MAX_SAMPLES * CAPTURE_SAMPLE_SIZE];
+  static uint8_t parts[CAPTURE_MAX_SAMPLES * CAPTURE_SAMPLE_SIZE];
+  size_t read = capture_read(full, 0, CAPTURE_MAX_SAMPLES);
+  size_t part_read = 0;
+  uint32_t transfers = 0;
+  uint32_t packets = 0;
+  while(part_read < info.samples)
+  {
+    size_t count = capture_read(&parts[part_read * CAPTURE_SAMPLE_SIZE], part_read, DOWNLOAD_SAMPLES);
+    transfers++;
+    packets += 1 + (count * CAPTURE_SAMPLE_SIZE + BULK_CHUNK - 1) / BULK_CHUNK;
+    part_read += count;
+  }
+  if(read != info.samples || part_read != read || memcmp(full, parts, read * CAPTURE_SAMPLE_SIZE))
+  {
+    printf("%-22s readout in parts differs: FAIL\n", p_scenario->name);
+    pass = false;
+  }
+
+  // Locate capture in stream by its samples, impact onset must be just before trigger index
+  uint32_t first = 0;
+  bool found = false;
+  for(uint32_t start = 0; start + read <= length && !found; start++)
+  {
+    found = true;
+    for(uint32_t ii = 0; ii < read && found; ii++)
+    {
+      for(uint8_t axis = 0; axis < 3; axis++)
+      {
+        int16_t value = (int16_t)(full[ii * 6 + axis * 2] | (full[ii * 6 + axis * 2 + 1] << 8));
+        if(value != stream[start + ii][axis]) { found = false; }
+      }
+    }
+    if(found) { first = start; }
+  }
+  int32_t onset_index = (int32_t)p_scenario->impact_at - (int32_t)first;
+  int32_t trigger_error = (int32_t)info.trigger_index - 1 - onset_index;
+  bool aligned = found && 0 <= trigger_error && trigger_error <= p_scenario->trigger_latency + 1;
+  bool windows = info.samples == info.trigger_index + p_scenario->post &&
+                 (expected_pre ? info.trigger_index == expected_pre : info.trigger_index <= p_scenario->pre);
+  bool rest = !lis.watermark && !lis.fifo_enabled;
+  uint32_t stale = length - 1 - lis.output;
+  pass &= aligned && windows && rest && 0 == stale && 0 == lis.overflows;
+
+  printf("%-22s %3d Hz: %4d samples, trigger at %4d, impact at %4d, froze %4d ms after impact, "
+         "%d FIFO drains, %d overflows, %d transfers %d packets: %s\n",
+         p_scenario->name, p_scenario->sample_rate_hz, info.samples, info.trigger_index, onset_index,
+         (int)((frozen_at - p_scenario->impact_at) * 1000 / p_scenario->sample_rate_hz), lis.drains,
+         lis.overflows, transfers, packets, pass ? "PASS" : "FAIL");
+  if(verbose || !pass)
+  {
+    printf("  found %d, aligned %d, error %d, windows %d, rest %d, output %d samples stale\n",
+           found, aligned, trigger_error, windows, rest, stale);
+  }
+  return pass;
+}
+
+static bool check_api(void)
+{
+  bool pass = true;
+  int16_t x, y, z;
+  uint8_t buffer[CAPTURE_SAMPLE_SIZE];
+
+  pass &= NRF_ERROR_INVALID_PARAM == capture_arm(400, 100, 0);
+  pass &= NRF_ERROR_INVALID_PARAM == capture_arm(400, CAPTURE_MAX_SAMPLES, 1);
+  pass &= NRF_SUCCESS == capture_arm(400, 0, 1);
+  pass &= !capture_latest(&x, &y, &z);
+  pass &= !capture_sample_put(1, 2, 3);
+  pass &= capture_latest(&x, &y, &z) && 1 == x && 2 == y && 3 == z;
+  pass &= 0 == capture_read(buffer, 0, 1);       // Not frozen
+  pass &= capture_trigger(0);
+  pass &= !capture_trigger(0);                   // Already triggered
+  pass &= capture_sample_put(-4, 5, -6);
+  pass &= CAPTURE_FROZEN == capture_state();
+  pass &= !capture_sample_put(7, 8, 9);          // Frozen ignores samples
+  pass &= 1 == capture_read(buffer, 0, 4);
+  pass &= 0xFC == buffer[0] && 0xFF == buffer[1] && 5 == buffer[2] && 0xFA == buffer[4];
+  pass &= 0 == capture_read(buffer, 1, 1);
+  capture_disarm();
+  pass &= CAPTURE_IDLE == capture_state() && !capture_sample_put(1, 1, 1) && !capture_trigger(0);
+  printf("api: %s\n", pass ? "PASS" : "FAIL");
+  return pass;
+}
+
+int main(int argc, char** argv)
+{
+  int option;
+  while(-1 != (option = getopt(argc, argv, "v")))
+  {
+    if('v' == option) { verbose = true; }
+    else
+    {
+      fprintf(stderr, "Usage: %s [-v]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  bool pass = check_api();
+  for(size_t ii = 0; ii < sizeof(scenarios) / sizeof(scenarios[0]); ii++)
+  {
+    pass &= check_scenario(&scenarios[ii]);
+  }
+
+  // Capture sends one burst per event, continuous streaming sends every sample
+  const scenario_t* p_typical = &scenarios[0];
+  uint32_t burst = (p_typical->pre + p_typical->post) * CAPTURE_SAMPLE_SIZE;
+  uint32_t stream_hour = 3600u * p_typical->sample_rate_hz * CAPTURE_SAMPLE_SIZE;
+  printf("ring %d bytes of RAM, burst %d bytes per event vs %d bytes per hour of streaming at %d Hz\n",
+         (int)sizeof(int16_t) * 3 * CAPTURE_MAX_SAMPLES, burst, stream_hour, p_typical->sample_rate_hz);
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
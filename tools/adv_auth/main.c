@@ -0,0 +1,346 @@
+/**
+ *  Host test and benchmark of libraries/adv_auth.
+ *
+ *  Software AES-128 is checked against FIPS-197 appendix C.1 and CMAC against the
+ *  examples of RFC 4493. Firmware uses the ECB peripheral instead of software AES, both
+ *  give the same tags as CMAC sees only the block cipher.
+ *
+ *  Checks:
+ *   - AES-128 and CMAC subkeys and tags of the reference vectors
+ *   - signed packet verifies, any changed bit, other address or other key is rejected
+ *   - counter newer than latest is accepted, same counter is a duplicate, older a replay
+ *   - signing a packet takes two block encryptions
+ *   - host verification rate, packets per second of one core
+ *
+ *  A received packet can be verified with -k key -a address -p packet, all hex.
+ *
+ *  Usage: adv_auth [-v] [-k key -a address -p packet]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "adv_auth.h"
+#include "aes_cmac.h"
+
+#define BENCH_PACKETS 200000
+
+static uint32_t failures;
+static bool     verbose = false;
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if(!(condition))                                                       \
+    {                                                                      \
+      printf("FAIL %s:%d: %s\n", __func__, __LINE__, #condition);          \
+      failures++;                                                          \
+    }                                                                      \
+  } while(0)
+
+/** Parse hex string into at most length bytes, return bytes parsed or -1 on error */
+static int parse_hex(const char* p_hex, uint8_t* p_out, size_t length)
+{
+  size_t count = strlen(p_hex);
+  if(count % 2 || count / 2 > length) { return -1; }
+  for(size_t ii = 0; ii < count / 2; ii++)
+  {
+    unsigned int byte;
+    if(1 != sscanf(&p_hex[2 * ii], "%2x", &byte)) { return -1; }
+    p_out[ii] = byte;
+  }
+  return count / 2;
+}
+
+static const uint8_t rfc4493_key[AES_KEY_SIZE] = {
+  0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static void test_aes(void)
+{
+  const uint8_t key[AES_KEY_SIZE] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+  };
+  const uint8_t plain[AES_BLOCK_SIZE] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+  };
+  const uint8_t cipher[AES_BLOCK_SIZE] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+  };
+  aes128_t aes;
+  uint8_t out[AES_BLOCK_SIZE];
+  aes128_init(&aes, key);
+  aes128_encrypt(&aes, plain, out);
+  CHECK(0 == memcmp(cipher, out, sizeof(out)));
+  // In place, as CMAC uses it
+  memcpy(out, plain, sizeof(out));
+  aes128_encrypt(&aes, out, out);
+  CHECK(0 == memcmp(cipher, out, sizeof(out)));
+}
+
+static void test_cmac(void)
+{
+  const uint8_t k1[AES_BLOCK_SIZE] = {
+    0xfb, 0xee, 0xd6, 0x18, 0x35, 0x71, 0x33, 0x66, 0x7c, 0x85, 0xe0, 0x8f, 0x72, 0x36, 0xa8, 0xde
+  };
+  const uint8_t k2[AES_BLOCK_SIZE] = {
+    0xf7, 0xdd, 0xac, 0x30, 0x6a, 0xe2, 0x66, 0xcc, 0xf9, 0x0b, 0xc1, 0x1e, 0xe4, 0x6d, 0x51, 0x3b
+  };
+  const uint8_t message[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+  };
+  const struct { size_t length; uint8_t mac[AES_BLOCK_SIZE]; } examples[] = {
+    {  0, { 0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28, 0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46 } },
+    { 16, { 0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44, 0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c } },
+    { 40, { 0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27 } },
+    { 64, { 0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92, 0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe } }
+  };
+  aes128_t aes;
+  aes_cmac_t cmac;
+  uint8_t mac[AES_BLOCK_SIZE];
+  aes128_init(&aes, rfc4493_key);
+  aes_cmac_init(&cmac, aes128_encrypt, &aes);
+  CHECK(0 == memcmp(k1, cmac.k1, sizeof(k1)));
+  CHECK(0 == memcmp(k2, cmac.k2, sizeof(k2)));
+  for(size_t ii = 0; ii < sizeof(examples) / sizeof(examples[0]); ii++)
+  {
+    aes_cmac_compute(&cmac, message, examples[ii].length, mac);
+    CHECK(0 == memcmp(examples[ii].mac, mac, sizeof(mac)));
+  }
+}
+
+/** Packet with fields of RAWv2 set to a pattern */
+static void make_packet(uint8_t* p_packet, uint8_t seed)
+{
+  memset(p_packet, 0, ADV_AUTH_LENGTH);
+  p_packet[0] = ADV_AUTH_FORMAT;
+  for(uint8_t ii = 1; ii < ADV_AUTH_COUNTER_OFFSET; ii++) { p_packet[ii] = seed + 17 * ii; }
+}
+
+static const uint8_t address[ADV_AUTH_ADDRESS_LENGTH] = { 0xC7, 0x12, 0x34, 0x56, 0x78, 0x9A };
+
+static void test_sign_verify(void)
+{
+  aes128_t aes;
+  aes_cmac_t cmac;
+  aes128_init(&aes, rfc4493_key);
+  aes_cmac_init(&cmac, aes128_encrypt, &aes);
+  uint8_t packet[ADV_AUTH_LENGTH];
+  make_packet(packet, 3);
+  adv_auth_sign(&cmac, address, packet, 0x01020304);
+  CHECK(0x01020304 == adv_auth_counter(packet));
+  CHECK(0x01 == packet[ADV_AUTH_COUNTER_OFFSET] && 0x04 == packet[ADV_AUTH_COUNTER_OFFSET + 3]);
+  CHECK(ADV_AUTH_VALID == adv_auth_verify(&cmac, address, packet, sizeof(packet), NULL));
+
+  if(verbose)
+  {
+    printf("packet ");
+    for(uint8_t ii = 0; ii < ADV_AUTH_LENGTH; ii++) { printf("%02x", packet[ii]); }
+    printf("\n");
+  }
+
+  // Every bit after format and address is covered by tag
+  for(uint8_t ii = 8; ii < ADV_AUTH_LENGTH * 8; ii++)
+  {
+    uint8_t forged[ADV_AUTH_LENGTH];
+    memcpy(forged, packet, sizeof(forged));
+    forged[ii / 8] ^= 1 << (ii % 8);
+    CHECK(ADV_AUTH_FORGED == adv_auth_verify(&cmac, address, forged, sizeof(forged), NULL));
+  }
+  for(uint8_t ii = 0; ii < ADV_AUTH_ADDRESS_LENGTH * 8; ii++)
+  {
+    uint8_t other[ADV_AUTH_ADDRESS_LENGTH];
+    memcpy(other, address, sizeof(other));
+    other[ii / 8] ^= 1 << (ii % 8);
+    CHECK(ADV_AUTH_FORGED == adv_auth_verify(&cmac, other, packet, sizeof(packet), NULL));
+  }
+
+  // Other key
+  uint8_t key[AES_KEY_SIZE];
+  memcpy(key, rfc4493_key, sizeof(key));
+  key[15] ^= 0x01;
+  aes128_t other_aes;
+  aes_cmac_t other_cmac;
+  aes128_init(&other_aes, key);
+  aes_cmac_init(&other_cmac, aes128_encrypt, &other_aes);
+  CHECK(ADV_AUTH_FORGED == adv_auth_verify(&other_cmac, address, packet, sizeof(packet), NULL));
+
+  // Not authenticated packets
+  CHECK(ADV_AUTH_INVALID == adv_auth_verify(&cmac, address, packet, sizeof(packet) - 1, NULL));
+  packet[0] = 0x05;
+  CHECK(ADV_AUTH_INVALID == adv_auth_verify(&cmac, address, packet, sizeof(packet), NULL));
+}
+
+static void test_replay(void)
+{
+  aes128_t aes;
+  aes_cmac_t cmac;
+  aes128_init(&aes, rfc4493_key);
+  aes_cmac_init(&cmac, aes128_encrypt, &aes);
+  uint8_t first[ADV_AUTH_LENGTH], second[ADV_AUTH_LENGTH];
+  make_packet(first, 1);
+  make_packet(second, 2);
+  adv_auth_sign(&cmac, address, first, 4096);
+  adv_auth_sign(&cmac, address, second, 4097);
+
+  uint32_t latest = 0;
+  CHECK(ADV_AUTH_VALID == adv_auth_verify(&cmac, address, first, sizeof(first), &latest));
+  CHECK(4096 == latest);
+  // Same packet on another advertising channel
+  CHECK(ADV_AUTH_DUPLICATE == adv_auth_verify(&cmac, address, first, sizeof(first), &latest));
+  CHECK(ADV_AUTH_VALID == adv_auth_verify(&cmac, address, second, sizeof(second), &latest));
+  CHECK(4097 == latest);
+  CHECK(ADV_AUTH_REPLAY == adv_auth_verify(&cmac, address, first, sizeof(first), &latest));
+  CHECK(4097 == latest);
+
+  // Forged packet does not move latest counter
+  second[ADV_AUTH_COUNTER_OFFSET] = 0x7F;
+  CHECK(ADV_AUTH_FORGED == adv_auth_verify(&cmac, address, second, sizeof(second), &latest));
+  CHECK(4097 == latest);
+}
+
+static uint32_t encryptions;
+
+static void counting_cipher(void* p_context, const uint8_t* p_in, uint8_t* p_out)
+{
+  encryptions++;
+  aes128_encrypt(p_context, p_in, p_out);
+}
+
+static void test_cost(void)
+{
+  aes128_t aes;
+  aes_cmac_t cmac;
+  aes128_init(&aes, rfc4493_key);
+  aes_cmac_init(&cmac, counting_cipher, &aes);
+  CHECK(1 == encryptions);
+  uint8_t packet[ADV_AUTH_LENGTH];
+  make_packet(packet, 5);
+  encryptions = 0;
+  adv_auth_sign(&cmac, address, packet, 1);
+  CHECK(2 == encryptions);
+  encryptions = 0;
+  CHECK(ADV_AUTH_VALID == adv_auth_verify(&cmac, address, packet, sizeof(packet), NULL));
+  CHECK(2 == encryptions);
+}
+
+static double elapsed_us(const struct timespec* p_start, const struct timespec* p_end)
+{
+  return (p_end->tv_sec - p_start->tv_sec) * 1e6 + (p_end->tv_nsec - p_start->tv_nsec) / 1e3;
+}
+
+/** Gateway checks packets of many tags, each with its own key and latest counter */
+static void benchmark(void)
+{
+  enum { TAGS = 64 };
+  static aes128_t   aes[TAGS];
+  static aes_cmac_t cmac[TAGS];
+  static uint8_t    packets[TAGS][ADV_AUTH_LENGTH];
+  uint32_t latest[TAGS] = {0};
+  for(uint8_t ii = 0; ii < TAGS; ii++)
+  {
+    uint8_t key[AES_KEY_SIZE];
+    memcpy(key, rfc4493_key, sizeof(key));
+    key[0] = ii;
+    aes128_init(&aes[ii], key);
+    aes_cmac_init(&cmac[ii], aes128_encrypt, &aes[ii]);
+    make_packet(packets[ii], ii);
+  }
+
+  // Signed packets as a gateway would receive them, round robin over tags
+  static uint8_t received[BENCH_PACKETS][ADV_AUTH_LENGTH];
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(uint32_t ii = 0; ii < BENCH_PACKETS; ii++)
+  {
+    uint8_t tag = ii % TAGS;
+    adv_auth_sign(&cmac[tag], address, packets[tag], ii / TAGS + 1);
+    memcpy(received[ii], packets[tag], ADV_AUTH_LENGTH);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double sign_us = elapsed_us(&start, &end) / BENCH_PACKETS;
+
+  uint32_t valid = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(uint32_t ii = 0; ii < BENCH_PACKETS; ii++)
+  {
+    uint8_t tag = ii % TAGS;
+    valid += (ADV_AUTH_VALID == adv_auth_verify(&cmac[tag], address, received[ii], ADV_AUTH_LENGTH, &latest[tag]));
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double verify_us = elapsed_us(&start, &end) / BENCH_PACKETS;
+  CHECK(BENCH_PACKETS == valid);
+
+  printf("sign   %.2f us/packet\n", sign_us);
+  printf("verify %.2f us/packet, %.0f packets/s\n", verify_us, 1e6 / verify_us);
+}
+
+/** Verify a packet given on command line */
+static int verify_packet(const char* p_key, const char* p_address, const char* p_packet)
+{
+  uint8_t key[AES_KEY_SIZE];
+  uint8_t mac[ADV_AUTH_ADDRESS_LENGTH];
+  uint8_t packet[ADV_AUTH_LENGTH];
+  int length = parse_hex(p_packet, packet, sizeof(packet));
+  if(AES_KEY_SIZE != parse_hex(p_key, key, sizeof(key)) ||
+     ADV_AUTH_ADDRESS_LENGTH != parse_hex(p_address, mac, sizeof(mac)) || 0 > length)
+  {
+    fprintf(stderr, "Key must be 16 bytes, address 6 bytes and packet at most %d bytes of hex\n", ADV_AUTH_LENGTH);
+    return 2;
+  }
+  aes128_t aes;
+  aes_cmac_t cmac;
+  aes128_init(&aes, key);
+  aes_cmac_init(&cmac, aes128_encrypt, &aes);
+  adv_auth_result_t result = adv_auth_verify(&cmac, mac, packet, length, NULL);
+  const char* names[] = { "VALID", "DUPLICATE", "REPLAY", "FORGED", "INVALID" };
+  printf("%s", names[result]);
+  if(ADV_AUTH_VALID == result) { printf(" counter %u", adv_auth_counter(packet)); }
+  printf("\n");
+  return ADV_AUTH_VALID == result ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+  const char* p_key = NULL;
+  const char* p_address = NULL;
+  const char* p_packet = NULL;
+  int option;
+  while(-1 != (option = getopt(argc, argv, "vk:a:p:")))
+  {
+    switch(option)
+    {
+      case 'v': verbose = true; break;
+      case 'k': p_key = optarg; break;
+      case 'a': p_address = optarg; break;
+      case 'p': p_packet = optarg; break;
+      default:
+        fprintf(stderr, "Usage: %s [-v] [-k key -a address -p packet]\n", argv[0]);
+        return 2;
+    }
+  }
+  if(p_key || p_address || p_packet)
+  {
+    if(!(p_key && p_address && p_packet))
+    {
+      fprintf(stderr, "Usage: %s [-v] [-k key -a address -p packet]\n", argv[0]);
+      return 2;
+    }
+    return verify_packet(p_key, p_address, p_packet);
+  }
+
+  test_aes();
+  test_cmac();
+  test_sign_verify();
+  test_replay();
+  test_cost();
+  benchmark();
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,274 @@
+#include "bme280_emulator.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "spi.h"
+#include "bme280.h"
+
+#define ADC_T_BASE 519888
+#define ADC_P_BASE 415148
+#define ADC_H_BASE 30000
+#define ADC_SKIPPED_20BIT 0x80000
+#define ADC_SKIPPED_16BIT 0x8000
+
+static uint8_t  registers[256];
+static uint64_t now_us;
+static uint64_t conversion_end_us;
+static uint64_t next_conversion_us;
+static bool     measuring;
+static uint32_t conversions;
+static uint32_t random_state;
+static float    filtered_t;
+static float    filtered_p;
+static bool     filter_initialized;
+static bme280_emulator_environment_t env;
+static uint32_t transfers;
+static uint32_t transfer_bytes;
+
+/** Calibration of a real sensor, datasheet example values for T and P, other units differ slightly */
+static void load_calibration(uint8_t unit)
+{
+  const uint16_t tp[] = {27504, 26435, (uint16_t)-1000,
+                         36477, (uint16_t)-10685, 3024, 2855, 140, (uint16_t)-7, 15500, (uint16_t)-14600, 6000};
+  for(size_t ii = 0; ii < sizeof(tp)/sizeof(tp[0]); ii++)
+  {
+    uint16_t value = tp[ii] + unit * (ii + 1);
+    registers[BME280REG_CALIB_00 + 2*ii]     = value & 0xFF;
+    registers[BME280REG_CALIB_00 + 2*ii + 1] = value >> 8;
+  }
+  const int16_t h2 = 362, h4 = 313, h5 = 50;
+  registers[0xA1] = 75;
+  registers[0xE1] = h2 & 0xFF;
+  registers[0xE2] = h2 >> 8;
+  registers[0xE3] = 0;
+  registers[0xE4] = h4 >> 4;
+  registers[0xE5] = (h4 & 0x0F) | ((h5 & 0x0F) << 4);
+  registers[0xE6] = h5 >> 4;
+  registers[0xE7] = 30;
+}
+
+static uint32_t samples(uint8_t os)
+{
+  if(BME280_OVERSAMPLING_SKIP == os) { return 0; }
+  if(BME280_OVERSAMPLING_16 < os)    { os = BME280_OVERSAMPLING_16; }
+  return 1 << (os - 1);
+}
+
+/** Approximately normal distributed value with unit variance */
+static float gaussian(void)
+{
+  float sum = 0;
+  for(int ii = 0; ii < 4; ii++)
+  {
+    random_state = random_state * 1103515245u + 12345u;
+    sum += ((random_state >> 8) & 0xFFFF) / 65536.0f - 0.5f;
+  }
+  return sum * 1.7320508f;
+}
+
+static uint8_t os_temp(void)  { return registers[BME280REG_CTRL_MEAS] >> 5; }
+static uint8_t os_press(void) { return (registers[BME280REG_CTRL_MEAS] >> 2) & 0x07; }
+static uint8_t os_hum(void)   { return registers[BME280REG_CTRL_HUM] & 0x07; }
+static uint8_t mode(void)     { return registers[BME280REG_CTRL_MEAS] & 0x03; }
+
+/** Typical measurement time, datasheet appendix B */
+static uint64_t measurement_time_us(void)
+{
+  uint64_t t = 1000 + 2000 * samples(os_temp());
+  if(os_press()) { t += 2000 * samples(os_press()) + 500; }
+  if(os_hum())   { t += 2000 * samples(os_hum()) + 500; }
+  return t;
+}
+
+static uint64_t standby_us(void)
+{
+  static const uint32_t standby[] = {500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000};
+  return standby[registers[BME280REG_CONFIG] >> 5];
+}
+
+static uint32_t iir_coefficient(void)
+{
+  uint8_t iir = (registers[BME280REG_CONFIG] & BME280_IIR_MASK) >> 2;
+  return (iir > 4) ? 16 : (1 << iir);
+}
+
+/** Round 20-bit value to resolution of given number of bits */
+static int32_t quantize(float value, uint32_t bits)
+{
+  int32_t step = 1 << (20 - bits);
+  int32_t raw = (int32_t)lroundf(value / step) * step;
+  if(raw < 0)        { raw = 0; }
+  if(raw > 0xFFFFF)  { raw = 0xFFFFF; }
+  return raw;
+}
+
+static void complete_conversion(void)
+{
+  float phase = 2.0f * (float)M_PI * (now_us / 1e6f) / env.drift_period_s;
+  float drift = sinf(phase);
+  uint32_t n_t = samples(os_temp());
+  uint32_t n_p = samples(os_press());
+  uint32_t n_h = samples(os_hum());
+  uint32_t iir = iir_coefficient();
+
+  float t = ADC_T_BASE + env.drift_t * drift + (n_t ? env.noise_t / sqrtf(n_t) * gaussian() : 0);
+  float p = ADC_P_BASE + env.drift_p * drift + (n_p ? env.noise_p / sqrtf(n_p) * gaussian() : 0);
+  float h = ADC_H_BASE + env.drift_h * drift + (n_h ? env.noise_h / sqrtf(n_h) * gaussian() : 0);
+
+  if(!filter_initialized || 1 == iir)
+  {
+    filtered_t = t;
+    filtered_p = p;
+    filter_initialized = true;
+  }
+  else
+  {
+    filtered_t += (t - filtered_t) / iir;
+    filtered_p += (p - filtered_p) / iir;
+  }
+
+  // Resolution is 16 bits + 1 bit per oversampling step, 20 bits if IIR is used
+  int32_t adc_t = n_t ? quantize(filtered_t, (1 == iir) ? 15 + os_temp() : 20)  : ADC_SKIPPED_20BIT;
+  int32_t adc_p = n_p ? quantize(filtered_p, (1 == iir) ? 15 + os_press() : 20) : ADC_SKIPPED_20BIT;
+  int32_t adc_h = n_h ? (int32_t)lroundf(h) & 0xFFFF : ADC_SKIPPED_16BIT;
+
+  registers[BME280REG_PRESS_MSB]  = adc_p >> 12;
+  registers[BME280REG_PRESS_LSB]  = (adc_p >> 4) & 0xFF;
+  registers[BME280REG_PRESS_XLSB] = (adc_p & 0x0F) << 4;
+  registers[BME280REG_TEMP_MSB]   = adc_t >> 12;
+  registers[BME280REG_TEMP_LSB]   = (adc_t >> 4) & 0xFF;
+  registers[BME280REG_TEMP_XLSB]  = (adc_t & 0x0F) << 4;
+  registers[BME280REG_HUM_MSB]    = adc_h >> 8;
+  registers[BME280REG_HUM_LSB]    = adc_h & 0xFF;
+
+  measuring = false;
+  conversions++;
+  if(BME280_MODE_NORMAL == mode()) { next_conversion_us = now_us + standby_us(); }
+  else { registers[BME280REG_CTRL_MEAS] &= ~0x03; } // Forced mode returns to sleep
+}
+
+static void start_conversion(void)
+{
+  measuring = true;
+  conversion_end_us = now_us + measurement_time_us();
+}
+
+void bme280_emulator_init(uint32_t seed, const bme280_emulator_environment_t* environment)
+{
+  memset(registers, 0, sizeof(registers));
+  registers[BME280REG_ID] = BME280_ID_VALUE;
+  load_calibration(0);
+  transfers = 0;
+  transfer_bytes = 0;
+  now_us = 0;
+  measuring = false;
+  conversions = 0;
+  random_state = seed;
+  filter_initialized = false;
+  env = *environment;
+}
+
+void bme280_emulator_advance(uint64_t us)
+{
+  uint64_t target = now_us + us;
+  while(1)
+  {
+    if(measuring && conversion_end_us <= target)
+    {
+      now_us = conversion_end_us;
+      complete_conversion();
+    }
+    else if(!measuring && BME280_MODE_NORMAL == mode() && next_conversion_us <= target)
+    {
+      now_us = next_conversion_us;
+      start_conversion();
+    }
+    else { break; }
+  }
+  now_us = target;
+}
+
+uint64_t bme280_emulator_time_us(void)
+{
+  return now_us;
+}
+
+uint32_t bme280_emulator_conversions(void)
+{
+  return conversions;
+}
+
+void bme280_emulator_unit_set(uint8_t unit)
+{
+  load_calibration(unit);
+}
+
+uint32_t bme280_emulator_transfers(void)
+{
+  return transfers;
+}
+
+uint32_t bme280_emulator_transfer_bytes(void)
+{
+  return transfer_bytes;
+}
+
+static void write_register(uint8_t reg, uint8_t value)
+{
+  uint8_t previous_mode = mode();
+  registers[reg] = value;
+  if(BME280REG_CTRL_MEAS != reg) { return; }
+  switch(mode())
+  {
+    case BME280_MODE_SLEEP:
+      measuring = false;
+      break;
+
+    case BME280_MODE_NORMAL:
+      if(BME280_MODE_NORMAL != previous_mode && !measuring) { start_conversion(); }
+      break;
+
+    default:
+      if(!measuring) { start_conversion(); }
+      break;
+  }
+}
+
+static uint8_t read_register(uint8_t reg)
+{
+  if(BME280REG_STATUS == reg) { return measuring ? 0x08 : 0x00; }
+  return registers[reg];
+}
+
+void spi_init(void)
+{
+}
+
+bool spi_isInitialized(void)
+{
+  return true;
+}
+
+SPI_Ret spi_transfer_bme280(uint8_t* const p_toWrite, uint8_t count, uint8_t* const p_toRead)
+{
+  if(count < 2) { return SPI_RET_ERROR; }
+  transfers++;
+  transfer_bytes += count;
+  uint8_t address = p_toWrite[0];
+  if(address & 0x80)
+  {
+    // Burst read with auto-increment
+    for(uint8_t ii = 1; ii < count; ii++)
+    {
+      p_toRead[ii] = read_register(address + ii - 1);
+    }
+  }
+  else
+  {
+    // Register address bit 7 is dropped on writes
+    write_register(address | 0x80, p_toWrite[1]);
+  }
+  return SPI_RET_OK;
+}
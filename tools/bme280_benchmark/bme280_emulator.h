@@ -0,0 +1,48 @@
+#ifndef BME280_EMULATOR_H
+#define BME280_EMULATOR_H
+
+#include <stdint.h>
+
+/**
+ *  Register level BME280 emulator behind the Ruuvi SPI wrapper API.
+ *  Implements spi_init(), spi_isInitialized() and spi_transfer_bme280() so that
+ *  drivers/bme280/bme280.c can be run on host against simulated time.
+ *
+ *  Raw ADC values are generated directly as a slow drift plus noise, quantized to the
+ *  resolution given by oversampling and IIR settings. Values are not physically
+ *  calibrated, they are only meant to exercise change detection of the driver.
+ */
+
+/** Environment of the simulation. Noise and drift are in 20-bit ADC LSBs (16-bit for humidity) */
+typedef struct {
+  float noise_t;
+  float noise_p;
+  float noise_h;
+  float drift_t;    /**< Amplitude of slow sinusoidal drift */
+  float drift_p;
+  float drift_h;
+  uint32_t drift_period_s;
+}bme280_emulator_environment_t;
+
+/** Reset registers, time and random generator */
+void bme280_emulator_init(uint32_t seed, const bme280_emulator_environment_t* environment);
+
+/** Advance simulated time, completes conversions which end within the time */
+void bme280_emulator_advance(uint64_t us);
+
+/** Current simulated time */
+uint64_t bme280_emulator_time_us(void);
+
+/** Number of conversions completed since init */
+uint32_t bme280_emulator_conversions(void);
+
+/** Replace calibration registers by the ones of another unit, 0 is the unit of init */
+void bme280_emulator_unit_set(uint8_t unit);
+
+/** Number of SPI transfers since init */
+uint32_t bme280_emulator_transfers(void);
+
+/** Bytes clocked on SPI since init, including register address */
+uint32_t bme280_emulator_transfer_bytes(void);
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ *  Host benchmark for BME280 driver read and compensation skipping.
+ *
+ *  Runs drivers/bme280/bme280.c against a register level emulator and replays the
+ *  ruuvi_firmware main loop: read measurements, get temperature, pressure and humidity
+ *  once per loop. Without caching the driver would run all 3 compensation formulas
+ *  every loop, report shows how many of those were avoided per hour.
+ *
+ *  Usage: bme280_benchmark [-d hours]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "application_config.h"
+#include "bluetooth_application_config.h"
+#include "bme280.h"
+#include "bme280_emulator.h"
+
+#define US_PER_MS 1000ULL
+#define US_PER_HOUR (3600ULL * 1000 * US_PER_MS)
+
+typedef struct {
+  const char* name;
+  const bme280_emulator_environment_t* environment;
+  uint32_t loop_interval;  // ms
+  bool     forced;
+}scenario_t;
+
+/** Indoor conditions, slowly changing temperature */
+static const bme280_emulator_environment_t indoor = {
+  .noise_t = 16, .noise_p = 16, .noise_h = 1,
+  .drift_t = 2000, .drift_p = 500, .drift_h = 200,
+  .drift_period_s = 6 * 3600
+};
+
+/** Stable conditions, e.g. a storage room. Noise is mostly below resolution at oversampling 1 */
+static const bme280_emulator_environment_t stable = {
+  .noise_t = 4, .noise_p = 4, .noise_h = 0.3f,
+  .drift_t = 50, .drift_p = 50, .drift_h = 5,
+  .drift_period_s = 24 * 3600
+};
+
+static const scenario_t scenarios[] = {
+  { "normal fast indoor", &indoor, MAIN_LOOP_INTERVAL_RAW,      false },
+  { "normal slow indoor", &indoor, MAIN_LOOP_INTERVAL_RAW_SLOW, false },
+  { "forced fast indoor", &indoor, MAIN_LOOP_INTERVAL_RAW,      true  },
+  { "forced slow indoor", &indoor, MAIN_LOOP_INTERVAL_RAW_SLOW, true  },
+  { "normal fast stable", &stable, MAIN_LOOP_INTERVAL_RAW,      false },
+  { "forced fast stable", &stable, MAIN_LOOP_INTERVAL_RAW,      true  },
+  { "forced slow stable", &stable, MAIN_LOOP_INTERVAL_RAW_SLOW, true  },
+  // Reader polling faster than conversions, e.g. a temperature endpoint at 10 Hz
+  { "normal 100ms stable", &stable, 100,                        false }
+};
+
+/** Configure driver as main.c does at boot */
+static void configure(bool forced)
+{
+  bme280_set_mode(BME280_MODE_SLEEP);
+  bme280_init();
+  bme280_set_oversampling_hum  (BME280_HUMIDITY_OVERSAMPLING);
+  bme280_set_oversampling_temp (BME280_TEMPERATURE_OVERSAMPLING);
+  bme280_set_oversampling_press(BME280_PRESSURE_OVERSAMPLING);
+  bme280_set_iir(BME280_IIR);
+  bme280_set_interval(BME280_DELAY);
+  bme280_set_mode(forced ? BME280_MODE_FORCED : BME280_MODE_NORMAL);
+}
+
+static void run(const scenario_t* scenario, uint32_t hours)
+{
+  bme280_emulator_init(0x52554956, scenario->environment);
+  configure(scenario->forced);
+  bme280_stats_t start = *bme280_get_stats();
+  uint32_t loops = 0;
+  uint64_t duration = hours * US_PER_HOUR;
+
+  while(bme280_emulator_time_us() < duration)
+  {
+    bme280_emulator_advance(scenario->loop_interval * US_PER_MS);
+    if(scenario->forced)
+    {
+      bme280_set_mode(BME280_MODE_FORCED);
+      bme280_emulator_advance(bme280_get_measurement_time_us() + US_PER_MS);
+    }
+    bme280_read_measurements();
+    bme280_get_temperature();
+    bme280_get_pressure();
+    bme280_get_humidity();
+    loops++;
+  }
+
+  const bme280_stats_t* end = bme280_get_stats();
+  uint32_t reads      = end->reads - start.reads;
+  uint32_t unchanged  = end->reads_unchanged - start.reads_unchanged;
+  uint32_t skipped    = end->reads_skipped - start.reads_skipped;
+  uint32_t computed   = end->compensations - start.compensations;
+  uint32_t naive      = 3 * loops;
+  printf("%-19s %8u %8u %8u %8u %8u %10u %10.0f %5.1f %%\n",
+         scenario->name, loops, bme280_emulator_conversions(), reads, unchanged, skipped,
+         computed, (float)(naive - computed) / hours, 100.0f * (naive - computed) / naive);
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t hours = 1;
+  int opt;
+  while(-1 != (opt = getopt(argc, argv, "d:")))
+  {
+    if('d' == opt) { hours = strtoul(optarg, NULL, 10); }
+    else
+    {
+      fprintf(stderr, "Usage: %s [-d hours]\n", argv[0]);
+      return 2;
+    }
+  }
+  if(0 == hours) { hours = 1; }
+
+  printf("Simulated %u h, BME280 os T/P/H %d/%d/%d, IIR 0x%02X, standby 0x%02X\n", hours,
+         BME280_TEMPERATURE_OVERSAMPLING, BME280_PRESSURE_OVERSAMPLING, BME280_HUMIDITY_OVERSAMPLING,
+         BME280_IIR, BME280_DELAY);
+  printf("%-19s %8s %8s %8s %8s %8s %10s %10s %7s\n", "scenario", "loops", "convs", "reads",
+         "unchngd", "skipped", "compensate", "avoided/h", "avoided");
+  for(size_t ii = 0; ii < sizeof(scenarios) / sizeof(scenarios[0]); ii++)
+  {
+    run(&scenarios[ii], hours);
+  }
+  return 0;
+}
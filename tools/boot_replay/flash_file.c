@@ -0,0 +1,221 @@
+#include "flash_file.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sdk_errors.h"
+#include "flash.h"
+
+#define PAGE_DATA    0xDA7A0001  // First word of a page in use
+#define HEADER_WORDS 3           // Key and length, file ID, record ID
+#define KEY_SHIFT    16
+#define LENGTH_MASK  0xFFFF
+#define ERASED       0xFFFFFFFF
+
+static uint32_t image[FLASH_FILE_PAGES][FLASH_FILE_PAGE_WORDS];
+static const char* image_path = NULL;
+static bool initialized = false;
+static uint32_t record_id = 0;
+static flash_file_stats_t stats;
+
+static void image_save(void)
+{
+  if(NULL == image_path) { return; }
+  FILE* file = fopen(image_path, "wb");
+  if(NULL == file) { return; }
+  fwrite(image, sizeof(image), 1, file);
+  fclose(file);
+}
+
+static bool image_load(void)
+{
+  if(NULL == image_path) { return false; }
+  FILE* file = fopen(image_path, "rb");
+  if(NULL == file) { return false; }
+  bool loaded = (1 == fread(image, sizeof(image), 1, file));
+  fclose(file);
+  return loaded;
+}
+
+/** Program a word, bits can only be cleared */
+static void program(uint32_t page, uint32_t offset, uint32_t value)
+{
+  image[page][offset] &= value;
+  stats.words_written++;
+}
+
+static void erase(uint32_t page)
+{
+  memset(image[page], 0xFF, sizeof(image[page]));
+  stats.pages_erased++;
+}
+
+/** Offset of first free word of a page in use */
+static uint32_t page_end(uint32_t page)
+{
+  uint32_t offset = 1;
+  while(offset + HEADER_WORDS <= FLASH_FILE_PAGE_WORDS && ERASED != image[page][offset])
+  {
+    offset += HEADER_WORDS + (image[page][offset] & LENGTH_MASK);
+  }
+  return offset;
+}
+
+/** Find valid record, return false if there is none */
+static bool record_find(uint16_t file_id, uint16_t key, uint32_t* p_page, uint32_t* p_offset)
+{
+  for(uint32_t page = 0; page < FLASH_FILE_PAGES; page++)
+  {
+    if(PAGE_DATA != image[page][0]) { continue; }
+    uint32_t end = page_end(page);
+    for(uint32_t offset = 1; offset < end; offset += HEADER_WORDS + (image[page][offset] & LENGTH_MASK))
+    {
+      if(key == image[page][offset] >> KEY_SHIFT && file_id == (image[page][offset + 1] & 0xFFFF))
+      {
+        *p_page = page;
+        *p_offset = offset;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/** Copy words of a record to the end of a page */
+static void record_copy(uint32_t page, const uint32_t* p_words, uint32_t count)
+{
+  uint32_t end = page_end(page);
+  for(uint32_t ii = 0; ii < count; ii++) { program(page, end + ii, p_words[ii]); }
+}
+
+void flash_file_path_set(const char* path)
+{
+  image_path = path;
+}
+
+void flash_file_erase(void)
+{
+  for(uint32_t page = 0; page < FLASH_FILE_PAGES; page++) { erase(page); }
+  image_save();
+}
+
+bool flash_file_corrupt(uint16_t file_id, uint16_t key)
+{
+  uint32_t page, offset;
+  if(!record_find(file_id, key, &page, &offset) || 0 == (image[page][offset] & LENGTH_MASK)) { return false; }
+  uint32_t* p_word = &image[page][offset + HEADER_WORDS];
+  // Lowest set bit, as an interrupted write would leave it
+  *p_word &= *p_word - 1;
+  image_save();
+  return true;
+}
+
+const flash_file_stats_t* flash_file_stats(void)
+{
+  return &stats;
+}
+
+ret_code_t flash_init(void)
+{
+  memset(&stats, 0, sizeof(stats));
+  // Image in memory only is kept as it is
+  if(NULL != image_path && !image_load()) { memset(image, 0xFF, sizeof(image)); }
+  // Last page is swap, as FDS formats erased flash
+  uint32_t in_use = 0;
+  for(uint32_t page = 0; page < FLASH_FILE_PAGES; page++) { in_use += (PAGE_DATA == image[page][0]); }
+  for(uint32_t page = 0; page < FLASH_FILE_PAGES - 1 && 0 == in_use; page++) { program(page, 0, PAGE_DATA); }
+  record_id = 0;
+  initialized = true;
+  image_save();
+  return NRF_SUCCESS;
+}
+
+ret_code_t flash_gc_run(void)
+{
+  if(!initialized) { return NRF_ERROR_INVALID_STATE; }
+  uint32_t swap = 0;
+  while(swap < FLASH_FILE_PAGES && PAGE_DATA == image[swap][0]) { swap++; }
+  if(FLASH_FILE_PAGES == swap) { return NRF_ERROR_INTERNAL; }
+  for(uint32_t page = 0; page < FLASH_FILE_PAGES; page++)
+  {
+    if(PAGE_DATA != image[page][0]) { continue; }
+    erase(swap);
+    program(swap, 0, PAGE_DATA);
+    uint32_t end = page_end(page);
+    for(uint32_t offset = 1; offset < end; offset += HEADER_WORDS + (image[page][offset] & LENGTH_MASK))
+    {
+      if(0 == image[page][offset] >> KEY_SHIFT) { continue; }
+      record_copy(swap, &image[page][offset], HEADER_WORDS + (image[page][offset] & LENGTH_MASK));
+    }
+    erase(page);
+    swap = page;
+  }
+  image_save();
+  return NRF_SUCCESS;
+}
+
+ret_code_t flash_record_get(const uint32_t page_id, const uint32_t record_id, const size_t data_size, void* const data)
+{
+  if(NULL == data) { return NRF_ERROR_NULL; }
+  if(!initialized) { return NRF_ERROR_INVALID_STATE; }
+  uint32_t page, offset;
+  if(!record_find(page_id, record_id, &page, &offset)) { return NRF_ERROR_NOT_FOUND; }
+  uint32_t length_words = image[page][offset] & LENGTH_MASK;
+  if(length_words * 4 > data_size) { return NRF_ERROR_DATA_SIZE; }
+  memcpy(data, &image[page][offset + HEADER_WORDS], length_words * 4);
+  return NRF_SUCCESS;
+}
+
+ret_code_t flash_record_set(const uint32_t page_id, const uint32_t key, const size_t data_size, const void* const data)
+{
+  if(NULL == data) { return NRF_ERROR_NULL; }
+  if(!initialized) { return NRF_ERROR_INVALID_STATE; }
+  uint32_t length_words = (data_size + 3) / sizeof(uint32_t);
+  uint32_t words[HEADER_WORDS + FLASH_FILE_PAGE_WORDS];
+  if(length_words + HEADER_WORDS + 1 > FLASH_FILE_PAGE_WORDS) { return NRF_ERROR_DATA_SIZE; }
+  words[0] = ((key & 0xFFFF) << KEY_SHIFT) | length_words;
+  words[1] = 0xFFFF0000 | (page_id & 0xFFFF);
+  words[2] = ++record_id;
+  memset(&words[HEADER_WORDS], 0, length_words * 4);
+  memcpy(&words[HEADER_WORDS], data, data_size);
+
+  for(uint32_t page = 0; page < FLASH_FILE_PAGES; page++)
+  {
+    if(PAGE_DATA != image[page][0] || page_end(page) + HEADER_WORDS + length_words > FLASH_FILE_PAGE_WORDS) { continue; }
+    uint32_t old_page, old_offset;
+    bool update = record_find(page_id, key, &old_page, &old_offset);
+    record_copy(page, words, HEADER_WORDS + length_words);
+    // Old record is deleted once the new one is complete
+    if(update) { program(old_page, old_offset, LENGTH_MASK); }
+    stats.records_written++;
+    image_save();
+    return NRF_SUCCESS;
+  }
+  return NRF_ERROR_NO_MEM;
+}
+
+ret_code_t flash_record_delete(const uint32_t page_id, const uint32_t record_id)
+{
+  if(!initialized) { return NRF_ERROR_INVALID_STATE; }
+  uint32_t page, offset;
+  if(!record_find(page_id, record_id, &page, &offset)) { return NRF_ERROR_NOT_FOUND; }
+  // Key is cleared, data stays until garbage collection
+  program(page, offset, LENGTH_MASK);
+  image_save();
+  return NRF_SUCCESS;
+}
+
+ret_code_t flash_free_size_get(size_t* size)
+{
+  if(NULL == size) { return NRF_ERROR_NULL; }
+  if(!initialized) { return NRF_ERROR_INVALID_STATE; }
+  *size = 0;
+  for(uint32_t page = 0; page < FLASH_FILE_PAGES; page++)
+  {
+    if(PAGE_DATA != image[page][0]) { continue; }
+    size_t free = (FLASH_FILE_PAGE_WORDS - page_end(page)) * 4;
+    if(free > *size) { *size = free; }
+  }
+  return NRF_SUCCESS;
+}
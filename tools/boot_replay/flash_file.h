@@ -0,0 +1,44 @@
+#ifndef FLASH_FILE_H
+#define FLASH_FILE_H
+
+/**
+ *  File backed emulation of drivers/nrf_nordic_flash/flash.h on host.
+ *
+ *  Records are kept in pages as FDS keeps them: a record is appended with a header and its
+ *  data, an update writes the new record before it clears the key of the old one, and
+ *  garbage collection copies valid records of a page to the swap page and erases the page.
+ *  Programming only clears bits, erase sets a page to 0xFF.
+ *
+ *  flash_init() loads the image from the file and every operation writes it back, so that
+ *  boots replayed by separate runs of a host tool see the flash of earlier runs. Errors are
+ *  NRF_ERROR_* codes instead of FDS_ERR_* codes of the firmware.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FLASH_FILE_PAGES      3      /**< FDS_VIRTUAL_PAGES of sdk_config.h, one of them is swap */
+#define FLASH_FILE_PAGE_WORDS 1024   /**< FDS_VIRTUAL_PAGE_SIZE */
+
+typedef struct {
+  uint32_t words_written;
+  uint32_t records_written;
+  uint32_t pages_erased;
+}flash_file_stats_t;
+
+/**
+ *  Set file of the image, NULL keeps the image in memory only, erase it with flash_file_erase()
+ *  before first flash_init(). Call before flash_init().
+ */
+void flash_file_path_set(const char* path);
+
+/** Erase all pages, as a tag with erased flash */
+void flash_file_erase(void);
+
+/** Clear one bit of data of valid record, return false if there is no such record */
+bool flash_file_corrupt(uint16_t file_id, uint16_t key);
+
+/** Return counters since flash_init() */
+const flash_file_stats_t* flash_file_stats(void);
+
+#endif
@@ -0,0 +1,280 @@
+/**
+ *  Host replay of sensor calibration caching over boots.
+ *
+ *  Runs the cold boot part of ruuvi_firmware main.c which loads BME280 calibration from
+ *  flash, i.e. drivers/nrf_nordic_flash/calibration_cache.c and drivers/bme280/bme280.c,
+ *  against the register level emulator of tools/bme280_benchmark and a file backed
+ *  emulation of flash. Each boot reports SPI transfers to BME280 and flash writes.
+ *
+ *  Events:
+ *   - boot     boot the tag, flash is garbage collected as main.c does when it is full
+ *   - replace  replace BME280 with a unit of other calibration, e.g. on a repaired tag
+ *   - corrupt  clear a bit of the cached calibration, e.g. an interrupted write
+ *   - erase    erase flash, e.g. full chip erase before programming
+ *
+ *  Flash is kept in the file between runs, emulated sensor is the first unit on every run.
+ *  Without events a self test is run on a temporary file.
+ *
+ *  Usage: boot_replay [<flash file> <event>...]
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sdk_errors.h"
+#include "nrf_error.h"
+#include "bme280.h"
+#include "bme280_emulator.h"
+#include "calibration_cache.h"
+#include "flash.h"
+#include "flash_file.h"
+
+/** Free space below which main.c runs garbage collection at boot */
+#define GC_THRESHOLD 4000
+
+typedef struct {
+  uint32_t transfers;
+  uint32_t bytes;
+  bool     cached;              // Calibration was loaded from flash and confirmed
+  uint32_t records_written;
+  uint32_t pages_erased;
+}boot_report_t;
+
+static const bme280_emulator_environment_t environment = {
+  .noise_t = 16, .noise_p = 16, .noise_h = 1,
+  .drift_t = 2000, .drift_p = 500, .drift_h = 200,
+  .drift_period_s = 3600
+};
+
+static uint8_t  unit;
+static uint32_t failures;
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if(!(condition))                                                       \
+    {                                                                      \
+      printf("FAIL %s:%d: %s\n", __func__, __LINE__, #condition);          \
+      failures++;                                                          \
+    }                                                                      \
+  } while(0)
+
+/** Boot as main.c does, sensor init after flash init */
+static boot_report_t boot(void)
+{
+  bme280_emulator_init(1, &environment);
+  bme280_emulator_unit_set(unit);
+
+  flash_init();
+  size_t flash_space_remaining = 0;
+  flash_free_size_get(&flash_space_remaining);
+  if(GC_THRESHOLD > flash_space_remaining) { flash_gc_run(); }
+
+  bme280_preload_calibration(NULL);
+  uint8_t calibration[BME280_CALIBRATION_LENGTH];
+  if(NRF_SUCCESS == calibration_cache_load(BME280_ID_VALUE, calibration, sizeof(calibration)))
+  {
+    bme280_preload_calibration(calibration);
+  }
+  bool available = (BME280_RET_OK == bme280_init());
+  if(available && !bme280_calibration_is_preloaded())
+  {
+    calibration_cache_store(BME280_ID_VALUE, bme280_get_calibration_raw(), BME280_CALIBRATION_LENGTH);
+  }
+
+  boot_report_t report = {
+    .transfers = bme280_emulator_transfers(),
+    .bytes = bme280_emulator_transfer_bytes(),
+    .cached = bme280_calibration_is_preloaded(),
+    .records_written = flash_file_stats()->records_written,
+    .pages_erased = flash_file_stats()->pages_erased
+  };
+  return report;
+}
+
+static void print_report(const char* event, const boot_report_t* p_report)
+{
+  printf("%-8s %2u transfers %3u bytes, calibration %-6s, %u records written, %u pages erased\n",
+         event, p_report->transfers, p_report->bytes, p_report->cached ? "cached" : "read",
+         p_report->records_written, p_report->pages_erased);
+}
+
+static bool run_event(const char* event)
+{
+  if(0 == strcmp(event, "boot"))
+  {
+    boot_report_t report = boot();
+    print_report(event, &report);
+  }
+  else if(0 == strcmp(event, "replace")) { unit++; }
+  else if(0 == strcmp(event, "corrupt"))
+  {
+    if(!flash_file_corrupt(CALIBRATION_CACHE_FILE_ID, BME280_ID_VALUE)) { printf("corrupt: no calibration in flash\n"); }
+  }
+  else if(0 == strcmp(event, "erase")) { flash_file_erase(); }
+  else { return false; }
+  return true;
+}
+
+/** Calibration of emulated unit 0 */
+static void test_parameters(void)
+{
+  const struct comp_params* cp = &bme280.cp;
+  CHECK(27504 == cp->dig_T1);
+  CHECK(26435 == cp->dig_T2);
+  CHECK(-1000 == cp->dig_T3);
+  CHECK(36477 == cp->dig_P1);
+  CHECK(6000 == cp->dig_P9);
+  CHECK(75 == cp->dig_H1);
+  CHECK(362 == cp->dig_H2);
+  CHECK(0 == cp->dig_H3);
+  CHECK(313 == cp->dig_H4);
+  CHECK(50 == cp->dig_H5);
+  CHECK(30 == cp->dig_H6);
+}
+
+static void test_first_boot(void)
+{
+  boot_report_t report = boot();
+  // ID, then temperature and pressure, then humidity
+  CHECK(3 == report.transfers);
+  CHECK(!report.cached);
+  CHECK(1 == report.records_written);
+  test_parameters();
+}
+
+static void test_cached_boot(void)
+{
+  struct comp_params first = bme280.cp;
+  boot_report_t report = boot();
+  // ID, then check of cached calibration
+  CHECK(2 == report.transfers);
+  CHECK(2 + 1 + BME280_CALIBRATION_CHECK_LENGTH == report.bytes);
+  CHECK(report.cached);
+  CHECK(0 == report.records_written);
+  CHECK(0 == memcmp(&first, &bme280.cp, sizeof(first)));
+}
+
+static void test_replaced_sensor(void)
+{
+  unit++;
+  boot_report_t report = boot();
+  // Check fails, all calibration is read and cache is updated
+  CHECK(4 == report.transfers);
+  CHECK(!report.cached);
+  CHECK(1 == report.records_written);
+  CHECK(27504 + unit == bme280.cp.dig_T1);
+  report = boot();
+  CHECK(report.cached);
+  CHECK(27504 + unit == bme280.cp.dig_T1);
+  unit = 0;
+  boot();
+}
+
+static void test_corrupted_record(void)
+{
+  CHECK(flash_file_corrupt(CALIBRATION_CACHE_FILE_ID, BME280_ID_VALUE));
+  boot_report_t report = boot();
+  CHECK(3 == report.transfers);
+  CHECK(!report.cached);
+  CHECK(1 == report.records_written);
+  test_parameters();
+  CHECK(boot().cached);
+}
+
+static void test_other_version(void)
+{
+  // Record of a later firmware with other layout
+  uint32_t record[(4 + CALIBRATION_CACHE_MAX_LENGTH + 4) / sizeof(uint32_t)];
+  memset(record, 0, sizeof(record));
+  ((uint8_t*)record)[0] = CALIBRATION_CACHE_VERSION + 1;
+  ((uint8_t*)record)[1] = BME280_ID_VALUE;
+  ((uint8_t*)record)[2] = BME280_CALIBRATION_LENGTH;
+  CHECK(NRF_SUCCESS == flash_record_set(CALIBRATION_CACHE_FILE_ID, BME280_ID_VALUE, sizeof(record), record));
+  boot_report_t report = boot();
+  CHECK(!report.cached);
+  CHECK(1 == report.records_written);
+  CHECK(boot().cached);
+}
+
+static void test_deleted_record(void)
+{
+  CHECK(NRF_SUCCESS == flash_record_delete(CALIBRATION_CACHE_FILE_ID, BME280_ID_VALUE));
+  CHECK(NRF_ERROR_NOT_FOUND == flash_record_delete(CALIBRATION_CACHE_FILE_ID, BME280_ID_VALUE));
+  boot_report_t report = boot();
+  CHECK(!report.cached);
+  CHECK(1 == report.records_written);
+  CHECK(boot().cached);
+}
+
+static void test_garbage_collection(void)
+{
+  uint32_t erased = 0;
+  // Each replacement leaves a deleted record, enough of them fill both data pages
+  for(uint32_t ii = 0; ii < 2 * FLASH_FILE_PAGE_WORDS / 10; ii++)
+  {
+    unit = (ii & 1) ? 0 : 1;
+    boot_report_t report = boot();
+    CHECK(!report.cached);
+    CHECK(1 == report.records_written);
+    erased += report.pages_erased;
+  }
+  CHECK(0 < erased);
+  unit = 0;
+  CHECK(boot().cached);
+  test_parameters();
+}
+
+static void test_erased_flash(void)
+{
+  flash_file_erase();
+  boot_report_t report = boot();
+  CHECK(3 == report.transfers);
+  CHECK(!report.cached);
+  CHECK(1 == report.records_written);
+}
+
+static int self_test(void)
+{
+  char path[] = "/tmp/boot_replay_XXXXXX";
+  int fd = mkstemp(path);
+  if(0 > fd) { perror("mkstemp"); return 2; }
+  close(fd);
+  // Empty file is erased flash
+  flash_file_path_set(path);
+
+  test_first_boot();
+  test_cached_boot();
+  test_replaced_sensor();
+  test_corrupted_record();
+  test_other_version();
+  test_deleted_record();
+  test_garbage_collection();
+  test_erased_flash();
+
+  unlink(path);
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+  if(1 == argc) { return self_test(); }
+  if(3 > argc)
+  {
+    fprintf(stderr, "Usage: %s [<flash file> <event>...], events: boot replace corrupt erase\n", argv[0]);
+    return 2;
+  }
+  flash_file_path_set(argv[1]);
+  for(int ii = 2; ii < argc; ii++)
+  {
+    if(!run_event(argv[ii]))
+    {
+      fprintf(stderr, "Unknown event %s\n", argv[ii]);
+      return 2;
+    }
+  }
+  return 0;
+}
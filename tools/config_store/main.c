@@ -0,0 +1,436 @@
+/**
+ *  Host test of runtime configuration store and its endpoint.
+ *
+ *  Runs libraries/config_store against the file backed flash emulation of
+ *  tools/boot_replay, reboots are replayed by initialising flash and store again.
+ *  Commit task runs in the scheduler of libraries/scheduler with a time source that
+ *  advances on every read, so that the task yields between records.
+ *
+ *  Checks:
+ *   - defaults without records, typed ranges, change handler
+ *   - commit writes only changed items and nothing for values back at default
+ *   - values survive reboot, changing back to default rewrites the record
+ *   - records of other type, out of range or corrupted fall back to defaults
+ *   - commit task writes a batch in several runs and collects garbage when flash fills
+ *   - endpoint replies to STATUS_QUERY, DATA_QUERY and SENSOR_CONFIGURATION
+ *   - change handler is told when a batch is complete, only by commit of endpoint
+ *   - values of secret items are written over endpoint but never sent
+ *   - read-only items are sent but not written over endpoint
+ *   - items with a set of values reject and ignore other values within range
+ *
+ *  Usage: config_store
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "app_scheduler_host.h"
+#include "config_store.h"
+#include "config_store_handler.h"
+#include "flash.h"
+#include "flash_file.h"
+#include "nrf_error.h"
+#include "ruuvi_endpoints.h"
+#include "scheduler.h"
+
+#define REPLIES_MAX 40
+
+enum { ITEM_MODE = 0, ITEM_INTERVAL = 1, ITEM_POWER = 2, ITEM_PERIOD = 5 };
+
+static const int32_t tx_powers[] = { -40, -20, -16, -12, -8, -4, 0, 3, 4 };
+
+static const config_item_t items[] = {
+  { ITEM_MODE,     CONFIG_TYPE_UINT8,  1,    0,    2 },
+  { ITEM_INTERVAL, CONFIG_TYPE_UINT16, 1280, 100,  10240 },
+  { ITEM_POWER,    CONFIG_TYPE_INT8,   4,    -40,  4 },
+  { ITEM_PERIOD,   CONFIG_TYPE_UINT32, 5000, 1000, 3600000 }
+};
+
+static uint32_t failures;
+static uint32_t ticks_now;
+static uint8_t  changes;
+static uint8_t  last_change_id;
+static int32_t  last_change_value;
+static ruuvi_standard_message_t replies[REPLIES_MAX];
+static uint8_t  reply_count;
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if(!(condition))                                                       \
+    {                                                                      \
+      printf("FAIL %s:%d: %s\n", __func__, __LINE__, #condition);          \
+      failures++;                                                          \
+    }                                                                      \
+  } while(0)
+
+/** Each read advances time by 8 ticks, background budget is used after 2 reads */
+static uint32_t ticks(void)
+{
+  ticks_now += 8;
+  return ticks_now;
+}
+
+static void changed(uint8_t id, int32_t value)
+{
+  changes++;
+  last_change_id = id;
+  last_change_value = value;
+}
+
+static ret_code_t reply(const ruuvi_standard_message_t message)
+{
+  if(REPLIES_MAX > reply_count) { replies[reply_count++] = message; }
+  return ENDPOINT_SUCCESS;
+}
+
+/** Reboot with given table */
+static void boot_with(const config_item_t* p_items, uint8_t count)
+{
+  flash_init();
+  changes = 0;
+  CHECK(NRF_SUCCESS == config_store_init(p_items, count, changed));
+}
+
+static void boot(void)
+{
+  boot_with(items, sizeof(items)/sizeof(items[0]));
+}
+
+static void run_scheduler(void)
+{
+  for(uint8_t ii = 0; ii < 100; ii++) { scheduler_execute(); }
+}
+
+static int32_t get_int32(const uint8_t* p_buffer)
+{
+  return (int32_t)(p_buffer[0] | (p_buffer[1] << 8) | (p_buffer[2] << 16) | ((uint32_t)p_buffer[3] << 24));
+}
+
+static void test_invalid_table(void)
+{
+  const config_item_t duplicate[] = { items[0], items[0] };
+  const config_item_t out_of_type[] = { { 0, CONFIG_TYPE_UINT8, 1, 0, 300 } };
+  const config_item_t default_out_of_range[] = { { 0, CONFIG_TYPE_INT16, -5, 0, 10 } };
+  const config_item_t unknown_type[] = { { 0, 0x88, 0, 0, 0 } };
+  const config_item_t default_not_in_values[] = { { 0, CONFIG_TYPE_INT8, 1, -40, 4, false, false, tx_powers, 9 } };
+  CHECK(NRF_ERROR_NULL == config_store_init(NULL, 0, NULL));
+  CHECK(NRF_ERROR_INVALID_PARAM == config_store_init(duplicate, 2, NULL));
+  CHECK(NRF_ERROR_INVALID_PARAM == config_store_init(out_of_type, 1, NULL));
+  CHECK(NRF_ERROR_INVALID_PARAM == config_store_init(default_out_of_range, 1, NULL));
+  CHECK(NRF_ERROR_INVALID_PARAM == config_store_init(unknown_type, 1, NULL));
+  CHECK(NRF_ERROR_INVALID_PARAM == config_store_init(default_not_in_values, 1, NULL));
+}
+
+static void test_defaults(void)
+{
+  boot();
+  CHECK(4 == config_store_count());
+  CHECK(1 == config_store_get(ITEM_MODE));
+  CHECK(1280 == config_store_get(ITEM_INTERVAL));
+  CHECK(4 == config_store_get(ITEM_POWER));
+  CHECK(5000 == config_store_get(ITEM_PERIOD));
+  CHECK(0 == config_store_get(3));
+  CHECK(CONFIG_STORE_FLAG_DEFAULT == config_store_flags(ITEM_MODE));
+  CHECK(0 == config_store_stored());
+  CHECK(0 == config_store_pending());
+  CHECK(0 == changes);
+}
+
+static void test_set(void)
+{
+  CHECK(NRF_ERROR_NOT_FOUND == config_store_set(3, 0));
+  CHECK(NRF_ERROR_INVALID_PARAM == config_store_set(ITEM_MODE, 3));
+  CHECK(NRF_ERROR_INVALID_PARAM == config_store_set(ITEM_POWER, -41));
+  CHECK(0 == changes);
+  CHECK(NRF_SUCCESS == config_store_set(ITEM_POWER, -8));
+  CHECK(1 == changes && ITEM_POWER == last_change_id && -8 == last_change_value);
+  CHECK(NRF_SUCCESS == config_store_set(ITEM_POWER, -8));
+  CHECK(1 == changes);
+  CHECK(-8 == config_store_get(ITEM_POWER));
+  CHECK(CONFIG_STORE_FLAG_PENDING == config_store_flags(ITEM_POWER));
+  CHECK(1 == config_store_pending());
+}
+
+static void test_delta_commit(void)
+{
+  // Batch of changes, one of them back to default before commit
+  CHECK(NRF_SUCCESS == config_store_set(ITEM_PERIOD, 60000));
+  CHECK(NRF_SUCCESS == config_store_set(ITEM_MODE, 2));
+  CHECK(NRF_SUCCESS == config_store_set(ITEM_MODE, 1));
+  CHECK(3 == config_store_pending());
+  uint32_t written = flash_file_stats()->records_written;
+  CHECK(NRF_SUCCESS == config_store_commit(1));
+  CHECK(written + 1 == flash_file_stats()->records_written);
+  CHECK(1 == config_store_pending());
+  CHECK(NRF_SUCCESS == config_store_commit(0));
+  CHECK(written + 2 == flash_file_stats()->records_written);
+  CHECK(0 == config_store_pending());
+  CHECK(2 == config_store_stored());
+  CHECK(CONFIG_STORE_FLAG_STORED == config_store_flags(ITEM_POWER));
+  CHECK(CONFIG_STORE_FLAG_DEFAULT == config_store_flags(ITEM_MODE));
+  // Nothing changed, nothing written
+  CHECK(NRF_SUCCESS == config_store_commit(0));
+  CHECK(written + 2 == flash_file_stats()->records_written);
+}
+
+static void test_reboot(void)
+{
+  boot();
+  CHECK(-8 == config_store_get(ITEM_POWER));
+  CHECK(60000 == config_store_get(ITEM_PERIOD));
+  CHECK(1 == config_store_get(ITEM_MODE));
+  CHECK(2 == config_store_stored());
+  CHECK(0 == config_store_pending());
+  CHECK(0 == changes);
+  // Back to default must overwrite the record, and changing back to stored value needs no write
+  CHECK(NRF_SUCCESS == config_store_set(ITEM_POWER, 4));
+  CHECK(NRF_SUCCESS == config_store_set(ITEM_PERIOD, 1000));
+  CHECK(NRF_SUCCESS == config_store_set(ITEM_PERIOD, 60000));
+  CHECK(NRF_SUCCESS == config_store_commit(0));
+  CHECK(1 == flash_file_stats()->records_written);
+  boot();
+  CHECK(4 == config_store_get(ITEM_POWER));
+  CHECK((CONFIG_STORE_FLAG_STORED | CONFIG_STORE_FLAG_DEFAULT) == config_store_flags(ITEM_POWER));
+}
+
+static void test_table_update(void)
+{
+  // Later firmware: interval becomes signed, period range is narrowed, mode is removed
+  const config_item_t updated[] = {
+    { ITEM_INTERVAL, CONFIG_TYPE_INT16,  1280, 100,  10240 },
+    { ITEM_POWER,    CONFIG_TYPE_INT8,   4,    -40,  4 },
+    { ITEM_PERIOD,   CONFIG_TYPE_UINT32, 5000, 1000, 30000 }
+  };
+  CHECK(NRF_SUCCESS == config_store_set(ITEM_INTERVAL, 200));
+  CHECK(NRF_SUCCESS == config_store_commit(0));
+  boot_with(updated, sizeof(updated)/sizeof(updated[0]));
+  CHECK(1280 == config_store_get(ITEM_INTERVAL));
+  CHECK(5000 == config_store_get(ITEM_PERIOD));
+  CHECK(1 == config_store_stored());
+  boot();
+  CHECK(200 == config_store_get(ITEM_INTERVAL));
+  CHECK(60000 == config_store_get(ITEM_PERIOD));
+}
+
+static void test_corrupted(void)
+{
+  CHECK(flash_file_corrupt(CONFIG_STORE_FILE_ID, ITEM_INTERVAL + 1));
+  boot();
+  CHECK(1280 == config_store_get(ITEM_INTERVAL));
+  CHECK(0 == (CONFIG_STORE_FLAG_STORED & config_store_flags(ITEM_INTERVAL)));
+  CHECK(60000 == config_store_get(ITEM_PERIOD));
+}
+
+static void test_commit_task(void)
+{
+  app_sched_host_init(16, 8);
+  scheduler_priority_init(ticks);
+  CHECK(NRF_SUCCESS == config_store_set(ITEM_MODE, 0));
+  CHECK(NRF_SUCCESS == config_store_set(ITEM_INTERVAL, 300));
+  CHECK(NRF_SUCCESS == config_store_set(ITEM_POWER, -20));
+  CHECK(NRF_SUCCESS == scheduler_event_put(NULL, 0, config_store_commit_task, SCHEDULER_PRIORITY_BACKGROUND));
+  run_scheduler();
+  CHECK(0 == config_store_pending());
+  CHECK(3 == flash_file_stats()->records_written);
+  CHECK(0 < scheduler_handler_stats_get(0)->continued);
+
+  // Rewrites fill flash, task collects garbage once space runs low
+  uint32_t erased = flash_file_stats()->pages_erased;
+  for(uint32_t ii = 0; ii < FLASH_FILE_PAGE_WORDS; ii++)
+  {
+    CHECK(NRF_SUCCESS == config_store_set(ITEM_PERIOD, 1000 + ii));
+    CHECK(NRF_SUCCESS == scheduler_event_put(NULL, 0, config_store_commit_task, SCHEDULER_PRIORITY_BACKGROUND));
+    run_scheduler();
+    CHECK(0 == config_store_pending());
+  }
+  CHECK(erased < flash_file_stats()->pages_erased);
+  boot();
+  CHECK(1000 + FLASH_FILE_PAGE_WORDS - 1 == config_store_get(ITEM_PERIOD));
+  CHECK(-20 == config_store_get(ITEM_POWER));
+  CHECK(300 == config_store_get(ITEM_INTERVAL));
+  CHECK(0 == config_store_get(ITEM_MODE));
+}
+
+static void test_endpoint(void)
+{
+  set_reply_handler(reply);
+  set_config_handler(config_store_handler);
+  ruuvi_standard_message_t message = { .destination_endpoint = CONFIG,
+                                       .source_endpoint      = PLAINTEXT_MESSAGE,
+                                       .type                 = STATUS_QUERY,
+                                       .payload              = {0}};
+  reply_count = 0;
+  route_message(message);
+  CHECK(1 == reply_count);
+  CHECK(UINT8 == replies[0].type && CONFIG == replies[0].source_endpoint);
+  CHECK(4 == replies[0].payload[0] && 0 == replies[0].payload[1] && 4 == replies[0].payload[2]);
+  CHECK(CONFIG_STORE_VERSION == replies[0].payload[3]);
+
+  reply_count = 0;
+  message.type = DATA_QUERY;
+  message.payload[0] = CONFIG_STORE_ALL;
+  route_message(message);
+  CHECK(4 == reply_count);
+  CHECK(INT32 == replies[2].type && ITEM_POWER == replies[2].payload[0]);
+  CHECK(CONFIG_TYPE_INT8 == replies[2].payload[1] && CONFIG_STORE_FLAG_STORED == replies[2].payload[2]);
+  CHECK(-20 == get_int32(&replies[2].payload[4]));
+
+  // Batch of two changes, committed by the second
+  reply_count = 0;
+  uint32_t written = flash_file_stats()->records_written;
+  message.type = SENSOR_CONFIGURATION;
+  message.payload[0] = ITEM_INTERVAL;
+  message.payload[1] = 0;
+  message.payload[4] = 0x00;
+  message.payload[5] = 0x28;
+  changes = 0;
+  route_message(message);
+  CHECK(1 == reply_count && 10240 == get_int32(&replies[0].payload[4]));
+  CHECK(CONFIG_STORE_FLAG_PENDING & replies[0].payload[2]);
+  CHECK(1 == changes && ITEM_INTERVAL == last_change_id);
+  message.payload[0] = ITEM_POWER;
+  message.payload[1] = CONFIG_STORE_HANDLER_COMMIT;
+  memset(&message.payload[4], 0xFF, 4);
+  route_message(message);
+  CHECK(2 == reply_count && -1 == get_int32(&replies[1].payload[4]));
+  CHECK(3 == changes && CONFIG_STORE_ALL == last_change_id);
+  CHECK(2 == config_store_pending());
+  run_scheduler();
+  CHECK(0 == config_store_pending());
+  CHECK(written + 2 == flash_file_stats()->records_written);
+
+  // Out of range and unknown items
+  reply_count = 0;
+  message.payload[0] = ITEM_POWER;
+  message.payload[4] = 10;
+  memset(&message.payload[5], 0, 3);
+  route_message(message);
+  message.payload[0] = 3;
+  route_message(message);
+  message.type = DATA_QUERY;
+  route_message(message);
+  CHECK(3 == reply_count);
+  CHECK(ERROR == replies[0].type && ITEM_POWER == replies[0].payload[0]);
+  CHECK(ERROR == replies[1].type && 3 == replies[1].payload[0]);
+  CHECK(ERROR == replies[2].type);
+  CHECK(-1 == config_store_get(ITEM_POWER));
+}
+
+static void test_secret(void)
+{
+  const config_item_t secret[] = { items[ITEM_MODE], { 7, CONFIG_TYPE_INT32, 0, INT32_MIN, INT32_MAX, true } };
+  boot_with(secret, 2);
+  ruuvi_standard_message_t message = { .destination_endpoint = CONFIG,
+                                       .source_endpoint      = PLAINTEXT_MESSAGE,
+                                       .type                 = SENSOR_CONFIGURATION,
+                                       .payload              = {0}};
+  reply_count = 0;
+  message.payload[0] = 7;
+  message.payload[1] = CONFIG_STORE_HANDLER_COMMIT;
+  memset(&message.payload[4], 0xA5, 4);
+  route_message(message);
+  CHECK(1 == reply_count && INT32 == replies[0].type);
+  CHECK(CONFIG_STORE_FLAG_SECRET & replies[0].payload[2]);
+  CHECK(!(CONFIG_STORE_FLAG_DEFAULT & replies[0].payload[2]));
+  CHECK(0 == get_int32(&replies[0].payload[4]));
+  CHECK((int32_t)0xA5A5A5A5 == config_store_get(7));
+  run_scheduler();
+
+  boot_with(secret, 2);
+  reply_count = 0;
+  message.type = DATA_QUERY;
+  message.payload[0] = CONFIG_STORE_ALL;
+  route_message(message);
+  CHECK(2 == reply_count);
+  CHECK(0 == (CONFIG_STORE_FLAG_SECRET & replies[0].payload[2]));
+  CHECK(config_store_get(ITEM_MODE) == get_int32(&replies[0].payload[4]));
+  CHECK((CONFIG_STORE_FLAG_SECRET | CONFIG_STORE_FLAG_STORED) == replies[1].payload[2]);
+  CHECK(0 == get_int32(&replies[1].payload[4]));
+  CHECK((int32_t)0xA5A5A5A5 == config_store_get(7));
+}
+
+static void test_read_only(void)
+{
+  const config_item_t read_only[] = { items[ITEM_MODE], { 8, CONFIG_TYPE_UINT32, 0, 0, INT32_MAX, false, true } };
+  boot_with(read_only, 2);
+  ruuvi_standard_message_t message = { .destination_endpoint = CONFIG,
+                                       .source_endpoint      = PLAINTEXT_MESSAGE,
+                                       .type                 = SENSOR_CONFIGURATION,
+                                       .payload              = {0}};
+  // Application sets the value, endpoint cannot
+  CHECK(NRF_SUCCESS == config_store_set(8, 4096));
+  reply_count = 0;
+  message.payload[0] = 8;
+  message.payload[1] = CONFIG_STORE_HANDLER_COMMIT;
+  route_message(message);
+  CHECK(1 == reply_count && ERROR == replies[0].type && 8 == replies[0].payload[0]);
+  CHECK(4096 == config_store_get(8));
+  // Rejected change does not commit the batch
+  CHECK(1 == config_store_pending());
+
+  reply_count = 0;
+  message.type = DATA_QUERY;
+  route_message(message);
+  CHECK(1 == reply_count && INT32 == replies[0].type);
+  CHECK(CONFIG_STORE_FLAG_READ_ONLY & replies[0].payload[2]);
+  CHECK(4096 == get_int32(&replies[0].payload[4]));
+}
+
+static void test_values(void)
+{
+  const config_item_t power[] = { { 9, CONFIG_TYPE_INT8, 0, -40, 4, false, false, tx_powers, 9 } };
+  boot_with(power, 1);
+  CHECK(NRF_ERROR_INVALID_PARAM == config_store_set(9, -10));
+  // -30 dBm is a level of nRF51 only, +3 dBm is supported by S132
+  CHECK(NRF_ERROR_INVALID_PARAM == config_store_set(9, -30));
+  CHECK(NRF_SUCCESS == config_store_set(9, 3));
+  CHECK(3 == config_store_get(9));
+  CHECK(NRF_SUCCESS == config_store_set(9, -12));
+  CHECK(-12 == config_store_get(9));
+  ruuvi_standard_message_t message = { .destination_endpoint = CONFIG,
+                                       .source_endpoint      = PLAINTEXT_MESSAGE,
+                                       .type                 = SENSOR_CONFIGURATION,
+                                       .payload              = {0}};
+  reply_count = 0;
+  message.payload[0] = 9;
+  message.payload[1] = CONFIG_STORE_HANDLER_COMMIT;
+  memset(&message.payload[4], 0xFF, 4);
+  message.payload[4] = (uint8_t)-10;
+  route_message(message);
+  CHECK(1 == reply_count && ERROR == replies[0].type && 9 == replies[0].payload[0]);
+  CHECK(-12 == config_store_get(9));
+  config_store_commit(0);
+
+  // Value dropped from set by an update falls back to default
+  const int32_t fewer[] = { -40, -20, 0, 4 };
+  const config_item_t updated[] = { { 9, CONFIG_TYPE_INT8, 0, -40, 4, false, false, fewer, 4 } };
+  boot_with(updated, 1);
+  CHECK(0 == config_store_get(9));
+  boot_with(power, 1);
+  CHECK(-12 == config_store_get(9));
+}
+
+int main(int argc, char** argv)
+{
+  // Image in memory only, flash_init() keeps it
+  flash_file_path_set(NULL);
+  flash_file_erase();
+
+  test_invalid_table();
+  test_defaults();
+  test_set();
+  test_delta_commit();
+  test_reboot();
+  test_table_update();
+  test_corrupted();
+  test_commit_task();
+  test_endpoint();
+  test_secret();
+  test_read_only();
+  test_values();
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
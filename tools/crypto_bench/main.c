@@ -0,0 +1,93 @@
+/**
+ *  Host benchmark and known-answer tests of Oberon crypto primitives.
+ *
+ *  Runs libraries/crypto_bench, the suite that also runs on tag, against occ_host.c.
+ *  Each primitive is checked against a published test vector and then timed for a
+ *  budget of wall clock time. Report has mean time per operation and throughput of
+ *  bulk primitives. Host times tell relative costs only, cycles on tag come from the
+ *  same suite in ruuvi_examples/eddystone.
+ *
+ *  Usage: crypto_bench [-v] [-b budget_ms] [-c case]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "crypto_bench.h"
+
+static uint32_t failures;
+static bool     verbose = false;
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if(!(condition))                                                       \
+    {                                                                      \
+      printf("FAIL %s:%d: %s\n", __func__, __LINE__, #condition);          \
+      failures++;                                                          \
+    }                                                                      \
+  } while(0)
+
+/** Nanoseconds, wraps every 4.3 s which is longer than any single operation */
+static uint32_t clock_ns(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)((uint64_t)now.tv_sec * 1000000000u + now.tv_nsec);
+}
+
+static void report(const crypto_bench_result_t* p_result)
+{
+  printf("%-18s %-4s %12.2f us", p_result->name, p_result->passed ? "ok" : "FAIL", p_result->ticks / 1000.0);
+  if(p_result->bytes) { printf(" %9.1f MB/s", p_result->bytes * 1000.0 / p_result->ticks); }
+  if(verbose) { printf("  %u runs", p_result->runs); }
+  printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t budget_ms = 100;
+  const char* p_case = NULL;
+  int option;
+  while(-1 != (option = getopt(argc, argv, "vb:c:")))
+  {
+    switch(option)
+    {
+      case 'v': verbose = true; break;
+      case 'b': budget_ms = atoi(optarg); break;
+      case 'c': p_case = optarg; break;
+      default:
+        fprintf(stderr, "Usage: %s [-v] [-b budget_ms] [-c case]\n", argv[0]);
+        return 2;
+    }
+  }
+  if(4000 < budget_ms)
+  {
+    fprintf(stderr, "Budget is at most 4000 ms\n");
+    return 2;
+  }
+
+  uint8_t matched = 0;
+  for(uint8_t ii = 0; ii < crypto_bench_count(); ii++)
+  {
+    if(p_case && strcmp(p_case, crypto_bench_name(ii))) { continue; }
+    crypto_bench_result_t result;
+    CHECK(crypto_bench_run(ii, clock_ns, budget_ms * 1000000u, &result));
+    matched++;
+    CHECK(result.passed);
+    CHECK(0 < result.runs);
+    report(&result);
+  }
+  CHECK(!crypto_bench_run(crypto_bench_count(), clock_ns, 0, NULL));
+  CHECK(NULL == crypto_bench_name(crypto_bench_count()));
+  if(p_case && 0 == matched)
+  {
+    fprintf(stderr, "No case %s\n", p_case);
+    return 2;
+  }
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
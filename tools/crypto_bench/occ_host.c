@@ -0,0 +1,477 @@
+/**
+ *  occ_* API of Oberon crypto library on host, backed by OpenSSL libcrypto.
+ *
+ *  Bundled library is object code for Cortex-M only. This lets libraries/crypto_bench run
+ *  on host through the same API, so that known-answer tests can be developed and relative
+ *  costs of algorithms compared before running on a tag. Only the functions used by
+ *  crypto_bench are provided. SRP follows RFC 5054 with the 3072 bit group and SHA-512
+ *  as in HomeKit, which occ implements.
+ */
+#include <stdbool.h>
+#include <string.h>
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/obj_mac.h>
+
+#include "occ_chacha20_poly1305.h"
+#include "occ_curve25519.h"
+#include "occ_ecdh_p256.h"
+#include "occ_ecdsa_p256.h"
+#include "occ_ed25519.h"
+#include "occ_hkdf_sha256.h"
+#include "occ_hmac_sha256.h"
+#include "occ_sha256.h"
+#include "occ_sha512.h"
+#include "occ_srp.h"
+
+/** Longest info of occ_hkdf_sha256() */
+#define HKDF_INFO_MAX 256
+
+void occ_sha256(uint8_t r[occ_sha256_BYTES], const uint8_t *in, size_t in_len)
+{
+  EVP_Digest(in, in_len, r, NULL, EVP_sha256(), NULL);
+}
+
+void occ_sha512(uint8_t r[occ_sha512_BYTES], const uint8_t *in, size_t in_len)
+{
+  EVP_Digest(in, in_len, r, NULL, EVP_sha512(), NULL);
+}
+
+void occ_hmac_sha256(uint8_t r[occ_hmac_sha256_BYTES], const uint8_t* key, size_t key_len,
+                     const uint8_t* in, size_t in_len)
+{
+  HMAC(EVP_sha256(), key, key_len, in, in_len, r, NULL);
+}
+
+void occ_hkdf_sha256(uint8_t* r, size_t r_len, const uint8_t* key, size_t key_len,
+                     const uint8_t* salt, size_t salt_len, const uint8_t* info, size_t info_len)
+{
+  uint8_t prk[occ_hmac_sha256_BYTES];
+  uint8_t block[occ_hmac_sha256_BYTES + HKDF_INFO_MAX + 1];
+  // Full expand of RFC 5869 although occ documents at most occ_hkdf_sha256_LENGTH_MAX bytes.
+  // Rejected requests give zeroes, which fail any known-answer test.
+  memset(r, 0, r_len);
+  if(info_len > HKDF_INFO_MAX || r_len > 255 * occ_hmac_sha256_BYTES) { return; }
+  HMAC(EVP_sha256(), salt, salt_len, key, key_len, prk, NULL);
+  // T(n) = HMAC(PRK, T(n-1) | info | n), T(0) is empty
+  size_t t_len = 0;
+  for(uint8_t n = 1; r_len; n++)
+  {
+    memcpy(block + t_len, info, info_len);
+    block[t_len + info_len] = n;
+    HMAC(EVP_sha256(), prk, sizeof(prk), block, t_len + info_len + 1, block, NULL);
+    t_len = occ_hmac_sha256_BYTES;
+    size_t length = (r_len < t_len) ? r_len : t_len;
+    memcpy(r, block, length);
+    r += length;
+    r_len -= length;
+  }
+}
+
+/** Returns 0 on success, tag is read on decrypt and written on encrypt */
+static int aead(bool encrypt, uint8_t* tag, uint8_t* out, const uint8_t* in, size_t len,
+                const uint8_t* a, size_t a_len, const uint8_t* n, size_t n_len, const uint8_t* k)
+{
+  EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+  int out_len;
+  int ok = EVP_CipherInit_ex(ctx, EVP_chacha20_poly1305(), NULL, NULL, NULL, encrypt);
+  ok &= EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, n_len, NULL);
+  ok &= EVP_CipherInit_ex(ctx, NULL, NULL, k, n, encrypt);
+  if(!encrypt) { ok &= EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, occ_chacha20_poly1305_TAG_BYTES, tag); }
+  if(a_len) { ok &= EVP_CipherUpdate(ctx, NULL, &out_len, a, a_len); }
+  if(len) { ok &= EVP_CipherUpdate(ctx, out, &out_len, in, len); }
+  ok &= EVP_CipherFinal_ex(ctx, out + len, &out_len);
+  if(encrypt) { ok &= EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, occ_chacha20_poly1305_TAG_BYTES, tag); }
+  EVP_CIPHER_CTX_free(ctx);
+  return ok ? 0 : 1;
+}
+
+void occ_chacha20_poly1305_encrypt(uint8_t tag[occ_chacha20_poly1305_TAG_BYTES], uint8_t *c,
+                                   const uint8_t *m, size_t m_len, const uint8_t *n, size_t n_len,
+                                   const uint8_t k[occ_chacha20_poly1305_KEY_BYTES])
+{
+  aead(true, tag, c, m, m_len, NULL, 0, n, n_len, k);
+}
+
+void occ_chacha20_poly1305_encrypt_aad(uint8_t tag[occ_chacha20_poly1305_TAG_BYTES], uint8_t *c,
+                                       const uint8_t *m, size_t m_len, const uint8_t *a, size_t a_len,
+                                       const uint8_t *n, size_t n_len,
+                                       const uint8_t k[occ_chacha20_poly1305_KEY_BYTES])
+{
+  aead(true, tag, c, m, m_len, a, a_len, n, n_len, k);
+}
+
+int occ_chacha20_poly1305_decrypt_aad(const uint8_t tag[occ_chacha20_poly1305_TAG_BYTES], uint8_t *m,
+                                      const uint8_t *c, size_t c_len, const uint8_t *a, size_t a_len,
+                                      const uint8_t *n, size_t n_len,
+                                      const uint8_t k[occ_chacha20_poly1305_KEY_BYTES])
+{
+  uint8_t t[occ_chacha20_poly1305_TAG_BYTES];
+  memcpy(t, tag, sizeof(t));
+  return aead(false, t, m, c, c_len, a, a_len, n, n_len, k);
+}
+
+void occ_curve25519_scalarmult_base(uint8_t r[occ_curve25519_BYTES], const uint8_t n[occ_curve25519_SCALAR_BYTES])
+{
+  size_t length = occ_curve25519_BYTES;
+  EVP_PKEY* key = EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, NULL, n, occ_curve25519_SCALAR_BYTES);
+  EVP_PKEY_get_raw_public_key(key, r, &length);
+  EVP_PKEY_free(key);
+}
+
+void occ_curve25519_scalarmult(uint8_t r[occ_curve25519_BYTES], const uint8_t n[occ_curve25519_SCALAR_BYTES],
+                               const uint8_t p[occ_curve25519_BYTES])
+{
+  size_t length = occ_curve25519_BYTES;
+  EVP_PKEY* key = EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, NULL, n, occ_curve25519_SCALAR_BYTES);
+  EVP_PKEY* peer = EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, NULL, p, occ_curve25519_BYTES);
+  EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(key, NULL);
+  EVP_PKEY_derive_init(ctx);
+  EVP_PKEY_derive_set_peer(ctx, peer);
+  EVP_PKEY_derive(ctx, r, &length);
+  EVP_PKEY_CTX_free(ctx);
+  EVP_PKEY_free(peer);
+  EVP_PKEY_free(key);
+}
+
+void occ_ed25519_public_key(uint8_t pk[occ_ed25519_PUBLIC_KEY_BYTES], const uint8_t sk[occ_ed25519_SECRET_KEY_BYTES])
+{
+  size_t length = occ_ed25519_PUBLIC_KEY_BYTES;
+  EVP_PKEY* key = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, NULL, sk, occ_ed25519_SECRET_KEY_BYTES);
+  EVP_PKEY_get_raw_public_key(key, pk, &length);
+  EVP_PKEY_free(key);
+}
+
+void occ_ed25519_sign(uint8_t sig[occ_ed25519_BYTES], const uint8_t *m, size_t m_len,
+                      const uint8_t sk[occ_ed25519_SECRET_KEY_BYTES], const uint8_t pk[occ_ed25519_PUBLIC_KEY_BYTES])
+{
+  size_t length = occ_ed25519_BYTES;
+  EVP_PKEY* key = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, NULL, sk, occ_ed25519_SECRET_KEY_BYTES);
+  EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+  EVP_DigestSignInit(ctx, NULL, NULL, NULL, key);
+  EVP_DigestSign(ctx, sig, &length, m ? m : (const uint8_t*)"", m_len);
+  EVP_MD_CTX_free(ctx);
+  EVP_PKEY_free(key);
+}
+
+int occ_ed25519_verify(const uint8_t sig[occ_ed25519_BYTES], const uint8_t *m, size_t m_len,
+                       const uint8_t pk[occ_ed25519_PUBLIC_KEY_BYTES])
+{
+  EVP_PKEY* key = EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, NULL, pk, occ_ed25519_PUBLIC_KEY_BYTES);
+  EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+  EVP_DigestVerifyInit(ctx, NULL, NULL, NULL, key);
+  int ok = EVP_DigestVerify(ctx, sig, occ_ed25519_BYTES, m ? m : (const uint8_t*)"", m_len);
+  EVP_MD_CTX_free(ctx);
+  EVP_PKEY_free(key);
+  return 1 == ok ? 0 : -1;
+}
+
+/** P-256 state shared by functions, created on first use */
+static EC_GROUP* p256;
+static BN_CTX*   bn_ctx;
+
+static const BIGNUM* p256_order(void)
+{
+  if(NULL == p256)
+  {
+    p256 = EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+    bn_ctx = BN_CTX_new();
+  }
+  return EC_GROUP_get0_order(p256);
+}
+
+/** Scalar in 1 ... n - 1 from 32 bytes, NULL otherwise */
+static BIGNUM* p256_scalar(const uint8_t s[32])
+{
+  BIGNUM* scalar = BN_bin2bn(s, 32, NULL);
+  if(BN_is_zero(scalar) || 0 <= BN_cmp(scalar, p256_order())) { BN_free(scalar); return NULL; }
+  return scalar;
+}
+
+/** Point from x | y, NULL if not on curve */
+static EC_POINT* p256_point(const uint8_t p[64])
+{
+  EC_POINT* point = EC_POINT_new(p256);
+  BIGNUM* x = BN_bin2bn(p, 32, NULL);
+  BIGNUM* y = BN_bin2bn(&p[32], 32, NULL);
+  if(!EC_POINT_set_affine_coordinates(p256, point, x, y, bn_ctx)) { EC_POINT_free(point); point = NULL; }
+  BN_free(x);
+  BN_free(y);
+  return point;
+}
+
+static void p256_point_bytes(uint8_t r[64], const EC_POINT* point)
+{
+  BIGNUM* x = BN_new();
+  BIGNUM* y = BN_new();
+  EC_POINT_get_affine_coordinates(p256, point, x, y, bn_ctx);
+  BN_bn2binpad(x, r, 32);
+  BN_bn2binpad(y, &r[32], 32);
+  BN_free(x);
+  BN_free(y);
+}
+
+int occ_ecdh_p256_public_key(uint8_t r[64], const uint8_t s[32])
+{
+  p256_order();
+  BIGNUM* scalar = p256_scalar(s);
+  if(NULL == scalar) { return 1; }
+  EC_POINT* point = EC_POINT_new(p256);
+  EC_POINT_mul(p256, point, scalar, NULL, NULL, bn_ctx);
+  p256_point_bytes(r, point);
+  EC_POINT_free(point);
+  BN_free(scalar);
+  return 0;
+}
+
+int occ_ecdh_p256_common_secret(uint8_t r[64], const uint8_t s[32], const uint8_t p[64])
+{
+  p256_order();
+  BIGNUM* scalar = p256_scalar(s);
+  EC_POINT* peer = p256_point(p);
+  int err = (NULL == scalar || NULL == peer);
+  if(!err)
+  {
+    EC_POINT* point = EC_POINT_new(p256);
+    EC_POINT_mul(p256, point, NULL, peer, scalar, bn_ctx);
+    p256_point_bytes(r, point);
+    EC_POINT_free(point);
+  }
+  EC_POINT_free(peer);
+  BN_free(scalar);
+  return err;
+}
+
+int occ_ecdsa_p256_public_key(uint8_t pk[64], const uint8_t sk[32])
+{
+  return occ_ecdh_p256_public_key(pk, sk);
+}
+
+/** SHA-256 of message as integer, same bit length as order of P-256 */
+static BIGNUM* ecdsa_digest(const uint8_t* m, uint32_t mlen)
+{
+  uint8_t h[occ_sha256_BYTES];
+  occ_sha256(h, m, mlen);
+  return BN_bin2bn(h, sizeof(h), NULL);
+}
+
+int occ_ecdsa_p256_sign(uint8_t sig[64], const uint8_t *m, uint32_t mlen, const uint8_t sk[32], const uint8_t ek[32])
+{
+  const BIGNUM* n = p256_order();
+  BIGNUM* d = p256_scalar(sk);
+  BIGNUM* k = p256_scalar(ek);
+  if(NULL == d || NULL == k) { BN_free(d); BN_free(k); return 1; }
+  BIGNUM* z = ecdsa_digest(m, mlen);
+  BIGNUM* r = BN_new();
+  BIGNUM* s = BN_new();
+  EC_POINT* point = EC_POINT_new(p256);
+  // r = x(kG) mod n, s = k^-1 (z + r d) mod n
+  EC_POINT_mul(p256, point, k, NULL, NULL, bn_ctx);
+  EC_POINT_get_affine_coordinates(p256, point, r, NULL, bn_ctx);
+  BN_nnmod(r, r, n, bn_ctx);
+  BN_mod_mul(s, r, d, n, bn_ctx);
+  BN_mod_add(s, s, z, n, bn_ctx);
+  BN_mod_inverse(k, k, n, bn_ctx);
+  BN_mod_mul(s, s, k, n, bn_ctx);
+  int err = BN_is_zero(r) || BN_is_zero(s);
+  BN_bn2binpad(r, sig, 32);
+  BN_bn2binpad(s, &sig[32], 32);
+  EC_POINT_free(point);
+  BN_free(s);
+  BN_free(r);
+  BN_free(z);
+  BN_free(k);
+  BN_free(d);
+  return err;
+}
+
+int occ_ecdsa_p256_verify(const uint8_t sig[64], const uint8_t *m, uint32_t mlen, const uint8_t pk[64])
+{
+  const BIGNUM* n = p256_order();
+  BIGNUM* r = p256_scalar(sig);
+  BIGNUM* s = p256_scalar(&sig[32]);
+  EC_POINT* q = p256_point(pk);
+  int err = (NULL == r || NULL == s || NULL == q);
+  if(!err)
+  {
+    // x(u1 G + u2 Q) mod n == r, u1 = z / s, u2 = r / s
+    BIGNUM* z = ecdsa_digest(m, mlen);
+    BIGNUM* x = BN_new();
+    EC_POINT* point = EC_POINT_new(p256);
+    BN_mod_inverse(s, s, n, bn_ctx);
+    BN_mod_mul(z, z, s, n, bn_ctx);
+    BN_mod_mul(s, r, s, n, bn_ctx);
+    EC_POINT_mul(p256, point, z, q, s, bn_ctx);
+    err = EC_POINT_is_at_infinity(p256, point) ||
+          !EC_POINT_get_affine_coordinates(p256, point, x, NULL, bn_ctx);
+    if(!err)
+    {
+      BN_nnmod(x, x, n, bn_ctx);
+      err = (0 != BN_cmp(x, r));
+    }
+    EC_POINT_free(point);
+    BN_free(x);
+    BN_free(z);
+  }
+  EC_POINT_free(q);
+  BN_free(s);
+  BN_free(r);
+  return err ? -1 : 0;
+}
+
+/** RFC 5054 3072 bit group, generator 5 */
+static BIGNUM* srp_n;
+static BIGNUM* srp_g;
+
+static void srp_group(void)
+{
+  if(NULL != srp_n) { return; }
+  p256_order();
+  srp_n = BN_get_rfc3526_prime_3072(NULL);
+  srp_g = BN_new();
+  BN_set_word(srp_g, 5);
+}
+
+static BIGNUM* srp_number(const uint8_t* p_bytes, size_t length)
+{
+  return BN_bin2bn(p_bytes, length, NULL);
+}
+
+static void srp_bytes(uint8_t* p_bytes, const BIGNUM* number)
+{
+  BN_bn2binpad(number, p_bytes, occ_srp_PUBLIC_KEY_BYTES);
+}
+
+void occ_srp_verifier(uint8_t v[occ_srp_VERIFIER_BYTES], const uint8_t salt[occ_srp_SALT_BYTES],
+                      const uint8_t *user, size_t user_len, const uint8_t *pass, size_t pass_len)
+{
+  uint8_t h[occ_sha512_BYTES];
+  EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+  srp_group();
+  // x = H(s | H(I | ":" | P)), v = g^x
+  EVP_DigestInit_ex(ctx, EVP_sha512(), NULL);
+  EVP_DigestUpdate(ctx, user, user_len);
+  EVP_DigestUpdate(ctx, ":", 1);
+  EVP_DigestUpdate(ctx, pass, pass_len);
+  EVP_DigestFinal_ex(ctx, h, NULL);
+  EVP_DigestInit_ex(ctx, EVP_sha512(), NULL);
+  EVP_DigestUpdate(ctx, salt, occ_srp_SALT_BYTES);
+  EVP_DigestUpdate(ctx, h, sizeof(h));
+  EVP_DigestFinal_ex(ctx, h, NULL);
+  EVP_MD_CTX_free(ctx);
+  BIGNUM* x = srp_number(h, sizeof(h));
+  BIGNUM* result = BN_new();
+  BN_mod_exp(result, srp_g, x, srp_n, bn_ctx);
+  srp_bytes(v, result);
+  BN_free(result);
+  BN_free(x);
+}
+
+void occ_srp_public_key(uint8_t pub_b[occ_srp_PUBLIC_KEY_BYTES], const uint8_t priv_b[occ_srp_SECRET_KEY_BYTES],
+                        const uint8_t v[occ_srp_VERIFIER_BYTES])
+{
+  uint8_t padded[2 * occ_srp_PUBLIC_KEY_BYTES];
+  uint8_t h[occ_sha512_BYTES];
+  srp_group();
+  // k = H(N | PAD(g)), B = k v + g^b
+  srp_bytes(padded, srp_n);
+  srp_bytes(&padded[occ_srp_PUBLIC_KEY_BYTES], srp_g);
+  occ_sha512(h, padded, sizeof(padded));
+  BIGNUM* k = srp_number(h, sizeof(h));
+  BIGNUM* b = srp_number(priv_b, occ_srp_SECRET_KEY_BYTES);
+  BIGNUM* verifier = srp_number(v, occ_srp_VERIFIER_BYTES);
+  BIGNUM* result = BN_new();
+  BIGNUM* gb = BN_new();
+  BN_mod_mul(result, k, verifier, srp_n, bn_ctx);
+  BN_mod_exp(gb, srp_g, b, srp_n, bn_ctx);
+  BN_mod_add(result, result, gb, srp_n, bn_ctx);
+  srp_bytes(pub_b, result);
+  BN_free(gb);
+  BN_free(result);
+  BN_free(verifier);
+  BN_free(b);
+  BN_free(k);
+}
+
+void occ_srp_scrambling_parameter(uint8_t u[occ_srp_SCRAMBLING_PARAMETER_BYTES],
+                                  const uint8_t pub_a[occ_srp_PUBLIC_KEY_BYTES],
+                                  const uint8_t pub_b[occ_srp_PUBLIC_KEY_BYTES])
+{
+  uint8_t concat[2 * occ_srp_PUBLIC_KEY_BYTES];
+  memcpy(concat, pub_a, occ_srp_PUBLIC_KEY_BYTES);
+  memcpy(&concat[occ_srp_PUBLIC_KEY_BYTES], pub_b, occ_srp_PUBLIC_KEY_BYTES);
+  occ_sha512(u, concat, sizeof(concat));
+}
+
+int occ_srp_premaster_secret(uint8_t s[occ_srp_PREMASTER_SECRET_BYTES], const uint8_t pub_a[occ_srp_PUBLIC_KEY_BYTES],
+                             const uint8_t priv_b[occ_srp_SECRET_KEY_BYTES],
+                             const uint8_t u[occ_srp_SCRAMBLING_PARAMETER_BYTES], const uint8_t v[occ_srp_VERIFIER_BYTES])
+{
+  srp_group();
+  BIGNUM* a = srp_number(pub_a, occ_srp_PUBLIC_KEY_BYTES);
+  BN_nnmod(a, a, srp_n, bn_ctx);
+  if(BN_is_zero(a)) { BN_free(a); return 1; }
+  // S = (A v^u)^b
+  BIGNUM* scramble = srp_number(u, occ_srp_SCRAMBLING_PARAMETER_BYTES);
+  BIGNUM* verifier = srp_number(v, occ_srp_VERIFIER_BYTES);
+  BIGNUM* b = srp_number(priv_b, occ_srp_SECRET_KEY_BYTES);
+  BIGNUM* result = BN_new();
+  BN_mod_exp(result, verifier, scramble, srp_n, bn_ctx);
+  BN_mod_mul(result, result, a, srp_n, bn_ctx);
+  BN_mod_exp(result, result, b, srp_n, bn_ctx);
+  srp_bytes(s, result);
+  BN_free(result);
+  BN_free(b);
+  BN_free(verifier);
+  BN_free(scramble);
+  BN_free(a);
+  return 0;
+}
+
+void occ_srp_session_key(uint8_t k[occ_srp_SESSION_KEY_BYTES], const uint8_t s[occ_srp_PREMASTER_SECRET_BYTES])
+{
+  occ_sha512(k, s, occ_srp_PREMASTER_SECRET_BYTES);
+}
+
+void occ_srp_proof_m1(uint8_t m1[occ_srp_PROOF_BYTES], const uint8_t *user, size_t user_len,
+                      const uint8_t salt[occ_srp_SALT_BYTES], const uint8_t pub_a[occ_srp_PUBLIC_KEY_BYTES],
+                      const uint8_t pub_b[occ_srp_PUBLIC_KEY_BYTES], const uint8_t k[occ_srp_SESSION_KEY_BYTES])
+{
+  uint8_t n[occ_srp_PUBLIC_KEY_BYTES];
+  uint8_t hn[occ_sha512_BYTES];
+  uint8_t hg[occ_sha512_BYTES];
+  uint8_t hu[occ_sha512_BYTES];
+  uint8_t g = 5;
+  srp_group();
+  // M1 = H(H(N) xor H(g) | H(I) | s | A | B | K)
+  srp_bytes(n, srp_n);
+  occ_sha512(hn, n, sizeof(n));
+  occ_sha512(hg, &g, 1);
+  for(size_t ii = 0; ii < sizeof(hn); ii++) { hn[ii] ^= hg[ii]; }
+  occ_sha512(hu, user, user_len);
+  EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+  EVP_DigestInit_ex(ctx, EVP_sha512(), NULL);
+  EVP_DigestUpdate(ctx, hn, sizeof(hn));
+  EVP_DigestUpdate(ctx, hu, sizeof(hu));
+  EVP_DigestUpdate(ctx, salt, occ_srp_SALT_BYTES);
+  EVP_DigestUpdate(ctx, pub_a, occ_srp_PUBLIC_KEY_BYTES);
+  EVP_DigestUpdate(ctx, pub_b, occ_srp_PUBLIC_KEY_BYTES);
+  EVP_DigestUpdate(ctx, k, occ_srp_SESSION_KEY_BYTES);
+  EVP_DigestFinal_ex(ctx, m1, NULL);
+  EVP_MD_CTX_free(ctx);
+}
+
+void occ_srp_proof_m2(uint8_t m2[occ_srp_PROOF_BYTES], const uint8_t pub_a[occ_srp_PUBLIC_KEY_BYTES],
+                      const uint8_t m1[occ_srp_PROOF_BYTES], const uint8_t k[occ_srp_SESSION_KEY_BYTES])
+{
+  EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+  EVP_DigestInit_ex(ctx, EVP_sha512(), NULL);
+  EVP_DigestUpdate(ctx, pub_a, occ_srp_PUBLIC_KEY_BYTES);
+  EVP_DigestUpdate(ctx, m1, occ_srp_PROOF_BYTES);
+  EVP_DigestUpdate(ctx, k, occ_srp_SESSION_KEY_BYTES);
+  EVP_DigestFinal_ex(ctx, m2, NULL);
+  EVP_MD_CTX_free(ctx);
+}
@@ -0,0 +1,847 @@
+/**
+ *  Packer of compressed and delta firmware images for DFU, see bootloader/dfu_decoder.h.
+ *
+ *  Packs the application .bin of a DFU package. The init packet stays the one nrfutil generated
+ *  for the plain image, replace the .bin in the package with the packed one. A delta image can
+ *  only be installed over the exact application it was packed against.
+ *
+ *  Each packed image is decoded with bootloader/dfu_decoder.c behind bootloader/dfu_pipeline.c
+ *  and compared to the plain image before it is written.
+ *
+ *  Usage:
+ *    dfu_pack [-b installed.bin] new.bin [packed.bin]
+ *        Pack new.bin, delta against installed.bin if given, and print sizes.
+ *    dfu_pack
+ *        Run tests and the benchmark on modelled release pairs.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "crc32.h"
+#include "dfu_decoder.h"
+#include "dfu_pipeline.h"
+
+#define MAX_IMAGE_SIZE      (512 * 1024)
+#define MAX_MATCH           273
+#define BASE_MIN_MATCH      6
+#define HASH_BITS           16
+#define MAX_CANDIDATES      64
+#define OBJECT_SIZE         4096
+#define APP_START           0x1F000          // CODE_REGION_1_START of S132 v3
+#define RES_SUCCESS         DFU_PIPELINE_RES_SUCCESS
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if(!(condition))                                                       \
+    {                                                                      \
+      printf("FAIL %s:%d: %s\n", __func__, __LINE__, #condition);          \
+      failures++;                                                          \
+    }                                                                      \
+  } while(0)
+
+typedef struct {
+  uint8_t* data;
+  uint32_t size;
+}buffer_t;
+
+static uint32_t failures;
+
+/* ---------------------------------------------------------------- Packer */
+
+/** Chains of positions of 4 byte sequences in the installed image */
+static struct {
+  const uint8_t* p_data;
+  uint32_t       size;
+  int32_t        head[1 << HASH_BITS];
+  int32_t*       p_next;
+}base_index;
+
+static uint32_t hash4(const uint8_t* p_data)
+{
+  uint32_t value = p_data[0] | (p_data[1] << 8) | (p_data[2] << 16) | ((uint32_t)p_data[3] << 24);
+  return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void base_index_build(const uint8_t* p_base, uint32_t size)
+{
+  base_index.p_data = p_base;
+  base_index.size = size;
+  memset(base_index.head, 0xFF, sizeof(base_index.head));
+  free(base_index.p_next);
+  base_index.p_next = malloc((size + 1) * sizeof(int32_t));
+  // Chains start from the latest position
+  for(uint32_t ii = 0; ii + 4 <= size; ii++)
+  {
+    uint32_t hash = hash4(&p_base[ii]);
+    base_index.p_next[ii] = base_index.head[hash];
+    base_index.head[hash] = ii;
+  }
+}
+
+static void put8(buffer_t* p_out, uint8_t byte)
+{
+  p_out->data[p_out->size++] = byte;
+}
+
+static void put32(buffer_t* p_out, uint32_t value)
+{
+  for(int ii = 0; ii < 4; ii++) { put8(p_out, value >> (8 * ii)); }
+}
+
+static uint32_t number_size(uint32_t value)
+{
+  uint32_t size = 1;
+  while(value >= 0x80) { value >>= 7; size++; }
+  return size;
+}
+
+static void put_number(buffer_t* p_out, uint32_t value)
+{
+  while(value >= 0x80)
+  {
+    put8(p_out, 0x80 | (value & 0x7F));
+    value >>= 7;
+  }
+  put8(p_out, value);
+}
+
+static uint32_t zigzag(int32_t value)
+{
+  return (value < 0) ? ((uint32_t)(~value) << 1) | 1 : (uint32_t)value << 1;
+}
+
+static uint32_t match_cost(uint32_t len) { return (len >= 18) ? 3 : 2; }
+
+static uint32_t base_cost(uint32_t len, int32_t adjust)
+{
+  return 1 + ((len >= 67) ? number_size(len - 67) : 0) + number_size(zigzag(adjust));
+}
+
+typedef struct {
+  uint32_t len;
+  uint32_t source;     // Distance of a match, offset in installed image of a base copy
+  bool     base;
+  int32_t  gain;       // Bytes saved compared to literals
+}token_t;
+
+/** Best token at pos of page start...end, cursor is the position in the installed image at pos */
+static token_t token_find(const uint8_t* p_image, uint32_t start, uint32_t end, uint32_t pos, uint32_t cursor)
+{
+  token_t best = { 0 };
+  uint32_t max = (end - pos > MAX_MATCH) ? MAX_MATCH : end - pos;
+  uint32_t window = (pos - start > DFU_DECODER_WINDOW_SIZE) ? DFU_DECODER_WINDOW_SIZE : pos - start;
+
+  for(uint32_t distance = 1; distance <= window && max >= 3; distance++)
+  {
+    const uint8_t* p_from = &p_image[pos - distance];
+    if(p_from[0] != p_image[pos] || p_from[1] != p_image[pos + 1]) { continue; }
+    uint32_t len = 0;
+    while(len < max && p_from[len] == p_image[pos + len]) { len++; }
+    if(len >= 3 && (int32_t)(len - match_cost(len)) > best.gain)
+    {
+      best = (token_t){ len, distance, false, len - match_cost(len) };
+    }
+  }
+
+  if(NULL != base_index.p_data && end - pos >= BASE_MIN_MATCH)
+  {
+    // Position following the previous token first, then the chain of the hash
+    int32_t candidate = (cursor < base_index.size) ? (int32_t)cursor : -1;
+    int32_t chain = base_index.head[hash4(&p_image[pos])];
+    for(int ii = 0; ii <= MAX_CANDIDATES && candidate >= 0; ii++)
+    {
+      uint32_t len = 0;
+      uint32_t limit = base_index.size - candidate;
+      if(limit > end - pos) { limit = end - pos; }
+      while(len < limit && base_index.p_data[candidate + len] == p_image[pos + len]) { len++; }
+      int32_t gain = (int32_t)len - (int32_t)base_cost(len, (int32_t)(candidate - cursor));
+      if(len >= BASE_MIN_MATCH && gain > best.gain)
+      {
+        best = (token_t){ len, candidate, true, gain };
+      }
+      candidate = chain;
+      if(chain >= 0) { chain = base_index.p_next[chain]; }
+    }
+  }
+  return best;
+}
+
+static void literals_put(buffer_t* p_out, const uint8_t* p_data, uint32_t len)
+{
+  while(len > 0)
+  {
+    uint32_t run = (len > 0x80) ? 0x80 : len;
+    put8(p_out, run - 1);
+    memcpy(&p_out->data[p_out->size], p_data, run);
+    p_out->size += run;
+    p_data += run;
+    len -= run;
+  }
+}
+
+static void token_put(buffer_t* p_out, const token_t* p_token, uint32_t cursor)
+{
+  if(p_token->base)
+  {
+    uint32_t len = p_token->len - 4;
+    put8(p_out, 0xC0 | ((len >= 63) ? 63 : len));
+    if(len >= 63) { put_number(p_out, len - 63); }
+    put_number(p_out, zigzag((int32_t)(p_token->source - cursor)));
+    return;
+  }
+  uint32_t distance = p_token->source - 1;
+  uint32_t len = (p_token->len >= 18) ? 15 : p_token->len - 3;
+  put8(p_out, 0x80 | (len << 2) | (distance >> 8));
+  put8(p_out, distance & 0xFF);
+  if(len == 15) { put8(p_out, p_token->len - 18); }
+}
+
+/** Pack image, delta against p_base if not NULL. Output must have room for twice the image size */
+static void pack(const uint8_t* p_image, uint32_t size, const uint8_t* p_base, uint32_t base_size, buffer_t* p_out)
+{
+  p_out->size = 0;
+  put32(p_out, DFU_DECODER_MAGIC);
+  put8(p_out, DFU_DECODER_VERSION);
+  put8(p_out, (NULL != p_base) ? DFU_DECODER_MODE_DELTA : DFU_DECODER_MODE_COMPRESSED);
+  put8(p_out, DFU_DECODER_PAGE_SIZE & 0xFF);
+  put8(p_out, DFU_DECODER_PAGE_SIZE >> 8);
+  put32(p_out, size);
+  put32(p_out, crc32_compute(p_image, size, NULL));
+  put32(p_out, (NULL != p_base) ? base_size : 0);
+  put32(p_out, (NULL != p_base) ? crc32_compute(p_base, base_size, NULL) : 0);
+
+  if(NULL != p_base) { base_index_build(p_base, base_size); }
+  else { base_index.p_data = NULL; }
+
+  for(uint32_t start = 0; start < size; start += DFU_DECODER_PAGE_SIZE)
+  {
+    uint32_t end = (size - start > DFU_DECODER_PAGE_SIZE) ? start + DFU_DECODER_PAGE_SIZE : size;
+    uint32_t pos = start;
+    uint32_t literal = start;
+    uint32_t cursor = start;        // At literal, installed image position following previous token
+    while(pos < end)
+    {
+      token_t token = token_find(p_image, start, end, pos, cursor + (pos - literal));
+      // Lazy: a literal is cheaper if the next position has a clearly better token
+      if(token.gain > 0 && pos + 1 < end)
+      {
+        token_t next = token_find(p_image, start, end, pos + 1, cursor + (pos + 1 - literal));
+        if(next.gain > token.gain + 1) { token.gain = 0; }
+      }
+      if(token.gain <= 0)
+      {
+        pos++;
+        continue;
+      }
+      literals_put(p_out, &p_image[literal], pos - literal);
+      cursor += pos - literal;
+      token_put(p_out, &token, cursor);
+      cursor = (token.base ? token.source : cursor) + token.len;
+      pos += token.len;
+      literal = pos;
+    }
+    literals_put(p_out, &p_image[literal], pos - literal);
+  }
+}
+
+/* ---------------------------------------------------------------- Request handler */
+
+/** Data objects of the request handler, receives the plain image */
+static struct {
+  uint8_t  image[MAX_IMAGE_SIZE];
+  uint32_t size;               // Expected image size, from init packet
+  uint32_t crc;
+  uint32_t offset;
+  uint32_t executed;
+  uint32_t object_end;
+  bool     object_open;
+  uint32_t creates;
+  uint32_t bytes_written;
+  bool     validated;
+}handler;
+
+static uint8_t handler_create(uint32_t object_size)
+{
+  if(0 == object_size || object_size > OBJECT_SIZE || handler.executed + object_size > handler.size)
+  {
+    return 0x04;    // NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES
+  }
+  // Objects are page aligned, all but the last one full size
+  if(object_size != OBJECT_SIZE && handler.executed + object_size != handler.size) { return 0x03; }
+  handler.offset = handler.executed;
+  handler.object_end = handler.executed + object_size;
+  handler.object_open = true;
+  handler.creates++;
+  return RES_SUCCESS;
+}
+
+static uint8_t handler_write(uint8_t const* p_data, uint16_t len)
+{
+  if(!handler.object_open || handler.offset + len > handler.object_end) { return 0x08; }
+  memcpy(&handler.image[handler.offset], p_data, len);
+  handler.offset += len;
+  handler.bytes_written += len;
+  return RES_SUCCESS;
+}
+
+static uint8_t handler_execute(void)
+{
+  if(!handler.object_open || handler.offset != handler.object_end) { return 0x08; }
+  handler.object_open = false;
+  handler.executed = handler.offset;
+  if(handler.executed == handler.size)
+  {
+    // Hash of the init packet
+    handler.validated = (handler.crc == crc32_compute(handler.image, handler.size, NULL));
+    if(!handler.validated) { return 0x0A; }
+  }
+  return RES_SUCCESS;
+}
+
+static const dfu_pipeline_sink_t handler_sink = { handler_create, handler_write, handler_execute, NULL };
+
+static dfu_decoder_base_t installed;
+
+static dfu_decoder_base_t const* installed_get(uint32_t image_size)
+{
+  (void)image_size;
+  return (NULL != installed.p_data) ? &installed : NULL;
+}
+
+static void install(const uint8_t* p_image, uint32_t size)
+{
+  installed.p_data = p_image;
+  installed.size = size;
+  installed.crc = (NULL != p_image) ? crc32_compute(p_image, size, NULL) : 0;
+}
+
+/** New DFU of image with given plain size and CRC, as after the init packet */
+static void session_start(const uint8_t* p_image, uint32_t size)
+{
+  memset(&handler, 0, sizeof(handler));
+  handler.size = size;
+  handler.crc = crc32_compute(p_image, size, NULL);
+  dfu_decoder_init(&handler_sink, installed_get);
+  dfu_pipeline_init(dfu_decoder_sink());
+}
+
+/** Transport after Select of the data object, as in nrf_ble_dfu.c */
+static uint32_t session_select(void)
+{
+  (void)dfu_pipeline_flush();
+  uint32_t offset = dfu_decoder_is_coded() ? 0 : handler.offset;
+  uint32_t crc = dfu_decoder_is_coded() ? 0 : crc32_compute(handler.image, handler.offset, NULL);
+  dfu_decoder_restart(offset);
+  dfu_pipeline_position_set(offset, crc);
+  return offset;
+}
+
+/**
+ *  DFU Controller sends stream from offset until stop in objects and packets,
+ *  return result of the last execute or the first failure.
+ */
+static uint8_t session_send(const uint8_t* p_stream, uint32_t size, uint32_t offset, uint32_t stop, uint16_t packet)
+{
+  uint8_t res = RES_SUCCESS;
+  for(uint32_t start = offset; start < stop && RES_SUCCESS == res; start += OBJECT_SIZE)
+  {
+    uint32_t len = (size - start > OBJECT_SIZE) ? OBJECT_SIZE : size - start;
+    res = dfu_pipeline_create(len);
+    for(uint32_t sent = 0; sent < len && start + sent < stop && RES_SUCCESS == res; sent += packet)
+    {
+      uint16_t chunk = (len - sent > packet) ? packet : len - sent;
+      res = dfu_pipeline_write(&p_stream[start + sent], chunk);
+      dfu_pipeline_process();
+    }
+    if(start + len > stop) { break; }
+    if(RES_SUCCESS == res && dfu_pipeline_offset() != start + len) { res = 0x0A; }
+    if(RES_SUCCESS == res && dfu_pipeline_crc() != crc32_compute(p_stream, start + len, NULL)) { res = 0x0A; }
+    if(RES_SUCCESS == res) { res = dfu_pipeline_execute(len == OBJECT_SIZE); }
+  }
+  (void)dfu_pipeline_flush();
+  return (RES_SUCCESS == res) ? dfu_pipeline_result() : res;
+}
+
+/** Send packed image over DFU, return true if the request handler received and validated the image */
+static bool roundtrip(const uint8_t* p_stream, uint32_t stream_size, const uint8_t* p_image, uint32_t size, uint16_t packet)
+{
+  session_start(p_image, size);
+  (void)session_select();
+  uint8_t res = session_send(p_stream, stream_size, 0, stream_size, packet);
+  return RES_SUCCESS == res && handler.validated && 0 == memcmp(handler.image, p_image, size);
+}
+
+/* ---------------------------------------------------------------- Release model */
+
+/**
+ *  Model of an application image: vector table, functions of 16-bit instructions with BL calls
+ *  to other functions and literal pools of function, string and RAM addresses, then strings.
+ *  Instructions are drawn from a skewed vocabulary. A release is a list of functions and strings;
+ *  a point release edits a few functions, adds one and changes the version string, so code after
+ *  the first change moves and calls and pointers across it change.
+ */
+#define MAX_FUNCTIONS       1024
+#define MAX_STRINGS         512
+#define VOCABULARY          192
+#define VECTORS             64
+
+typedef struct {
+  uint32_t seed;
+  uint32_t variant;            // Non-zero if edited
+}function_t;
+
+typedef struct {
+  function_t functions[MAX_FUNCTIONS];
+  uint32_t   function_count;
+  uint32_t   string_seeds[MAX_STRINGS];
+  uint32_t   string_count;
+  char       version[16];
+}release_t;
+
+typedef enum { ITEM_INSTRUCTION, ITEM_CALL, ITEM_POOL_FUNCTION, ITEM_POOL_STRING, ITEM_POOL_RAM }item_type_t;
+
+typedef struct {
+  item_type_t type;
+  uint32_t    value;
+}item_t;
+
+static uint16_t vocabulary[VOCABULARY];
+static uint32_t vocabulary_weight_total;
+
+static uint32_t rng_state;
+static uint32_t rng(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static void vocabulary_init(void)
+{
+  rng_state = 0x5EED;
+  for(uint32_t ii = 0; ii < VOCABULARY; ii++) { vocabulary[ii] = rng(); }
+  vocabulary_weight_total = 0;
+  for(uint32_t ii = 0; ii < VOCABULARY; ii++) { vocabulary_weight_total += 4096 / (ii + 1); }
+}
+
+static uint16_t instruction(void)
+{
+  uint32_t pick = rng() % vocabulary_weight_total;
+  for(uint32_t ii = 0; ii < VOCABULARY; ii++)
+  {
+    uint32_t weight = 4096 / (ii + 1);
+    if(pick < weight) { return vocabulary[ii]; }
+    pick -= weight;
+  }
+  return vocabulary[0];
+}
+
+static item_t item_random(const release_t* p_release)
+{
+  uint32_t kind = rng() % 100;
+  if(kind < 7) { return (item_t){ ITEM_CALL, rng() % p_release->function_count }; }
+  return (item_t){ ITEM_INSTRUCTION, instruction() };
+}
+
+/** Items of function, edited functions differ in a few places */
+static uint32_t function_items(const release_t* p_release, const function_t* p_function, item_t* p_items)
+{
+  rng_state = p_function->seed;
+  uint32_t count = 10 + rng() % 180;
+  for(uint32_t ii = 0; ii < count; ii++) { p_items[ii] = item_random(p_release); }
+  uint32_t pool = rng() % 5;
+  for(uint32_t ii = 0; ii < pool; ii++)
+  {
+    uint32_t kind = rng() % 3;
+    if(0 == kind)      { p_items[count++] = (item_t){ ITEM_POOL_FUNCTION, rng() % p_release->function_count }; }
+    else if(1 == kind) { p_items[count++] = (item_t){ ITEM_POOL_STRING, rng() % p_release->string_count }; }
+    else               { p_items[count++] = (item_t){ ITEM_POOL_RAM, 0x20002000 + (rng() % 0x4000) * 4 }; }
+  }
+  if(0 != p_function->variant)
+  {
+    rng_state = p_function->seed ^ (p_function->variant * 0x9E3779B9);
+    uint32_t edits = 1 + rng() % 4;
+    for(uint32_t ii = 0; ii < edits; ii++)
+    {
+      uint32_t at = rng() % (count - pool);
+      uint32_t insert = rng() % 6;
+      memmove(&p_items[at + insert], &p_items[at], (count - at) * sizeof(item_t));
+      count += insert;
+      for(uint32_t jj = 0; jj <= insert; jj++) { p_items[at + jj] = item_random(p_release); }
+    }
+  }
+  return count;
+}
+
+static uint32_t item_size(const item_t* p_item)
+{
+  return (ITEM_INSTRUCTION == p_item->type) ? 2 : 4;
+}
+
+static uint32_t string_make(uint32_t seed, char* p_text)
+{
+  static const char* words[] = {
+    "sensor", "init", "failed", "error", "BME280", "LIS2DH12", "timer", "advertising",
+    "battery", "voltage", "temperature", "humidity", "pressure", "scheduler", "event",
+    "queue", "full", "read", "write", "SPI", "NFC", "flash", "record", "mode", "interval",
+    "started", "stopped", "data", "format", "%d", "%u", "0x%08x", "ms", "mV", "\r\n"
+  };
+  rng_state = seed;
+  uint32_t count = 2 + rng() % 7;
+  uint32_t len = 0;
+  for(uint32_t ii = 0; ii < count; ii++)
+  {
+    const char* p_word = words[rng() % (sizeof(words) / sizeof(words[0]))];
+    len += sprintf(&p_text[len], "%s%s", (0 == ii) ? "" : " ", p_word);
+  }
+  return len + 1;
+}
+
+static uint32_t align4(uint32_t value) { return (value + 3) & ~3u; }
+
+static void put16le(uint8_t* p_out, uint16_t value) { p_out[0] = value; p_out[1] = value >> 8; }
+static void put32le(uint8_t* p_out, uint32_t value) { put16le(p_out, value); put16le(&p_out[2], value >> 16); }
+
+/** Lay out release, return image size */
+static uint32_t release_build(const release_t* p_release, uint8_t* p_image)
+{
+  static uint32_t function_address[MAX_FUNCTIONS];
+  static uint32_t string_address[MAX_STRINGS];
+  static item_t   items[512];
+  static char     text[256];
+  uint32_t address = APP_START + VECTORS * 4;
+
+  for(uint32_t ii = 0; ii < p_release->function_count; ii++)
+  {
+    function_address[ii] = address;
+    uint32_t count = function_items(p_release, &p_release->functions[ii], items);
+    for(uint32_t jj = 0; jj < count; jj++)
+    {
+      if(ITEM_INSTRUCTION != items[jj].type && ITEM_CALL != items[jj].type) { address = align4(address); }
+      address += item_size(&items[jj]);
+    }
+    address = align4(address);
+  }
+  for(uint32_t ii = 0; ii < p_release->string_count; ii++)
+  {
+    string_address[ii] = address;
+    address = align4(address + string_make(p_release->string_seeds[ii], text));
+  }
+  uint32_t version_address = address;
+  address = align4(address + strlen(p_release->version) + 1);
+  uint32_t size = address - APP_START;
+  memset(p_image, 0, size);
+
+  put32le(&p_image[0], 0x20010000);
+  for(uint32_t ii = 1; ii < VECTORS; ii++)
+  {
+    put32le(&p_image[ii * 4], function_address[ii % p_release->function_count] | 1);
+  }
+  for(uint32_t ii = 0; ii < p_release->function_count; ii++)
+  {
+    uint32_t at = function_address[ii];
+    uint32_t count = function_items(p_release, &p_release->functions[ii], items);
+    for(uint32_t jj = 0; jj < count; jj++)
+    {
+      uint8_t* p_out;
+      if(ITEM_INSTRUCTION != items[jj].type && ITEM_CALL != items[jj].type) { at = align4(at); }
+      p_out = &p_image[at - APP_START];
+      switch(items[jj].type)
+      {
+        case ITEM_INSTRUCTION:
+          put16le(p_out, items[jj].value);
+          break;
+        case ITEM_CALL:
+        {
+          int32_t offset = (int32_t)(function_address[items[jj].value] - (at + 4)) >> 1;
+          put16le(p_out, 0xF000 | ((offset >> 11) & 0x7FF));
+          put16le(&p_out[2], 0xF800 | (offset & 0x7FF));
+          break;
+        }
+        case ITEM_POOL_FUNCTION:
+          put32le(p_out, function_address[items[jj].value] | 1);
+          break;
+        case ITEM_POOL_STRING:
+          put32le(p_out, string_address[items[jj].value]);
+          break;
+        default:
+          put32le(p_out, items[jj].value);
+          break;
+      }
+      at += item_size(&items[jj]);
+    }
+  }
+  for(uint32_t ii = 0; ii < p_release->string_count; ii++)
+  {
+    uint32_t len = string_make(p_release->string_seeds[ii], text);
+    memcpy(&p_image[string_address[ii] - APP_START], text, len);
+  }
+  memcpy(&p_image[version_address - APP_START], p_release->version, strlen(p_release->version) + 1);
+  return size;
+}
+
+static void release_first(release_t* p_release, uint32_t functions, uint32_t strings)
+{
+  memset(p_release, 0, sizeof(*p_release));
+  rng_state = 0xC0DE;
+  p_release->function_count = functions;
+  p_release->string_count = strings;
+  for(uint32_t ii = 0; ii < functions; ii++) { p_release->functions[ii].seed = rng() | 1; }
+  for(uint32_t ii = 0; ii < strings; ii++) { p_release->string_seeds[ii] = rng() | 1; }
+  strcpy(p_release->version, "2.5.8");
+}
+
+/** Next release: edit functions, add functions and strings, bump version */
+static void release_next(release_t* p_release, uint32_t edits, uint32_t added, uint32_t seed)
+{
+  rng_state = seed;
+  for(uint32_t ii = 0; ii < edits; ii++)
+  {
+    p_release->functions[rng() % p_release->function_count].variant = seed + ii;
+  }
+  for(uint32_t ii = 0; ii < added; ii++)
+  {
+    uint32_t at = rng() % p_release->function_count;
+    memmove(&p_release->functions[at + 1], &p_release->functions[at],
+            (p_release->function_count - at) * sizeof(function_t));
+    p_release->functions[at] = (function_t){ rng() | 1, 0 };
+    p_release->function_count++;
+    p_release->string_seeds[p_release->string_count++] = rng() | 1;
+  }
+  p_release->version[4]++;
+}
+
+/* ---------------------------------------------------------------- Tests */
+
+static uint8_t old_image[MAX_IMAGE_SIZE];
+static uint8_t new_image[MAX_IMAGE_SIZE];
+static uint8_t stream[2 * MAX_IMAGE_SIZE + 1024];
+
+static uint32_t old_size;
+static uint32_t new_size;
+
+/** Point release of a model application of about 100 kB */
+static void release_pair(uint32_t edits, uint32_t added)
+{
+  static release_t release;
+  release_first(&release, 450, 150);
+  old_size = release_build(&release, old_image);
+  release_next(&release, edits, added, 0xABC + edits);
+  new_size = release_build(&release, new_image);
+}
+
+static void test_roundtrip(void)
+{
+  buffer_t packed = { stream, 0 };
+  release_pair(3, 1);
+
+  install(NULL, 0);
+  pack(new_image, new_size, NULL, 0, &packed);
+  CHECK(packed.size < new_size);
+  CHECK(roundtrip(stream, packed.size, new_image, new_size, 244));
+  CHECK(roundtrip(stream, packed.size, new_image, new_size, 20));
+  CHECK(handler.creates == (new_size + OBJECT_SIZE - 1) / OBJECT_SIZE);
+  CHECK(handler.bytes_written == new_size);
+
+  install(old_image, old_size);
+  pack(new_image, new_size, old_image, old_size, &packed);
+  CHECK(packed.size < new_size / 3);
+  CHECK(roundtrip(stream, packed.size, new_image, new_size, 244));
+  CHECK(roundtrip(stream, packed.size, new_image, new_size, 20));
+
+  // Delta against another image than the installed one
+  install(new_image, new_size);
+  CHECK(!roundtrip(stream, packed.size, new_image, new_size, 244));
+  CHECK(0 == handler.creates);
+  install(NULL, 0);
+  CHECK(!roundtrip(stream, packed.size, new_image, new_size, 244));
+}
+
+/** Plain image is passed to the request handler as it is */
+static void test_plain(void)
+{
+  release_pair(3, 1);
+  install(old_image, old_size);
+  CHECK(roundtrip(new_image, new_size, new_image, new_size, 244));
+  CHECK(!dfu_decoder_is_coded());
+  CHECK(handler.creates == (new_size + OBJECT_SIZE - 1) / OBJECT_SIZE);
+  // Packet shorter than the magic
+  CHECK(roundtrip(new_image, new_size, new_image, new_size, 3));
+}
+
+static void test_corrupt(void)
+{
+  buffer_t packed = { stream, 0 };
+  release_pair(3, 1);
+  install(old_image, old_size);
+  for(uint32_t mode = 0; mode < 2; mode++)
+  {
+    pack(new_image, new_size, mode ? old_image : NULL, old_size, &packed);
+    for(uint32_t at = DFU_DECODER_HEADER_SIZE - 20; at < packed.size; at += packed.size / 7)
+    {
+      stream[at] ^= 0x24;
+      CHECK(!roundtrip(stream, packed.size, new_image, new_size, 244));
+      CHECK(!handler.validated);
+      stream[at] ^= 0x24;
+    }
+    // Truncated
+    CHECK(!roundtrip(stream, packed.size - 1, new_image, new_size, 244));
+  }
+}
+
+/** Disconnection in the middle, coded image is sent again and written from the first page not executed */
+static void test_resume(void)
+{
+  buffer_t packed = { stream, 0 };
+  release_pair(3, 1);
+  install(NULL, 0);
+  pack(new_image, new_size, NULL, 0, &packed);
+
+  session_start(new_image, new_size);
+  CHECK(0 == session_select());
+  uint32_t stop = packed.size / 2 + 100;
+  CHECK(RES_SUCCESS == session_send(stream, packed.size, 0, stop, 244));
+  uint32_t executed = handler.executed;
+  CHECK(executed > 0);
+  CHECK(!handler.validated);
+
+  CHECK(0 == session_select());
+  CHECK(RES_SUCCESS == session_send(stream, packed.size, 0, packed.size, 244));
+  CHECK(handler.validated);
+  CHECK(0 == memcmp(handler.image, new_image, new_size));
+  CHECK(handler.creates == (new_size + OBJECT_SIZE - 1) / OBJECT_SIZE + 1);
+  CHECK(handler.bytes_written < new_size + OBJECT_SIZE);
+
+  // Plain image resumes from the offset of the request handler
+  session_start(new_image, new_size);
+  (void)session_select();
+  CHECK(RES_SUCCESS == session_send(new_image, new_size, 0, 5 * OBJECT_SIZE + 4 * 244, 244));
+  uint32_t offset = session_select();
+  CHECK(5 * OBJECT_SIZE + 4 * 244 == offset);
+  // Controller creates the partial object again, the transport knows where it starts
+  offset -= offset % OBJECT_SIZE;
+  dfu_decoder_restart(offset);
+  dfu_pipeline_position_set(offset, crc32_compute(new_image, offset, NULL));
+  CHECK(RES_SUCCESS == session_send(new_image, new_size, offset, new_size, 244));
+  CHECK(handler.validated);
+}
+
+static void benchmark(void)
+{
+  static const struct {
+    const char* name;
+    uint32_t    edits;
+    uint32_t    added;
+  }pairs[] = {
+    { "point release, 3 edits, 1 new function",      3, 1 },
+    { "point release, 12 edits, 4 new functions",   12, 4 },
+    { "minor release, 60 edits, 25 new functions",  60, 25 },
+  };
+  buffer_t packed = { stream, 0 };
+
+  printf("Modelled release pairs, bytes sent:\n");
+  printf("  %-44s %8s %17s %17s\n", "", "plain", "compressed", "delta");
+  for(uint32_t ii = 0; ii < sizeof(pairs) / sizeof(pairs[0]); ii++)
+  {
+    uint32_t compressed;
+    release_pair(pairs[ii].edits, pairs[ii].added);
+    install(old_image, old_size);
+    pack(new_image, new_size, NULL, 0, &packed);
+    compressed = packed.size;
+    CHECK(roundtrip(stream, packed.size, new_image, new_size, 244));
+    pack(new_image, new_size, old_image, old_size, &packed);
+    CHECK(roundtrip(stream, packed.size, new_image, new_size, 244));
+    printf("  %-44s %8u %8u (%5.1f%%) %8u (%5.1f%%)\n", pairs[ii].name, new_size,
+           compressed, 100.0 * compressed / new_size, packed.size, 100.0 * packed.size / new_size);
+  }
+}
+
+/* ---------------------------------------------------------------- Files */
+
+static uint32_t file_read(const char* p_path, uint8_t* p_data)
+{
+  FILE* p_file = fopen(p_path, "rb");
+  if(NULL == p_file)
+  {
+    perror(p_path);
+    exit(2);
+  }
+  size_t size = fread(p_data, 1, MAX_IMAGE_SIZE, p_file);
+  if(!feof(p_file))
+  {
+    fprintf(stderr, "%s: larger than %u bytes\n", p_path, MAX_IMAGE_SIZE);
+    exit(2);
+  }
+  fclose(p_file);
+  return size;
+}
+
+static int file_pack(const char* p_base_path, const char* p_new_path, const char* p_out_path)
+{
+  buffer_t packed = { stream, 0 };
+  uint32_t compressed;
+
+  new_size = file_read(p_new_path, new_image);
+  pack(new_image, new_size, NULL, 0, &packed);
+  compressed = packed.size;
+  printf("%-12s %8u bytes\n", "plain", new_size);
+  printf("%-12s %8u bytes (%5.1f%%)\n", "compressed", compressed, 100.0 * compressed / new_size);
+  install(NULL, 0);
+  if(NULL != p_base_path)
+  {
+    old_size = file_read(p_base_path, old_image);
+    install(old_image, old_size);
+    pack(new_image, new_size, old_image, old_size, &packed);
+    printf("%-12s %8u bytes (%5.1f%%)\n", "delta", packed.size, 100.0 * packed.size / new_size);
+  }
+  if(!roundtrip(stream, packed.size, new_image, new_size, 244))
+  {
+    fprintf(stderr, "Decoded image differs\n");
+    return 1;
+  }
+  if(NULL != p_out_path)
+  {
+    FILE* p_file = fopen(p_out_path, "wb");
+    if(NULL == p_file || packed.size != fwrite(stream, 1, packed.size, p_file))
+    {
+      perror(p_out_path);
+      return 2;
+    }
+    fclose(p_file);
+  }
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  const char* p_base_path = NULL;
+  int opt;
+  while((opt = getopt(argc, argv, "b:")) != -1)
+  {
+    if('b' == opt) { p_base_path = optarg; }
+    else
+    {
+      fprintf(stderr, "Usage: %s [-b installed.bin] new.bin [packed.bin]\n", argv[0]);
+      return 2;
+    }
+  }
+  if(optind < argc)
+  {
+    return file_pack(p_base_path, argv[optind], (optind + 1 < argc) ? argv[optind + 1] : NULL);
+  }
+
+  vocabulary_init();
+  test_roundtrip();
+  test_plain();
+  test_corrupt();
+  test_resume();
+  benchmark();
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
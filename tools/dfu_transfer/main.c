@@ -0,0 +1,805 @@
+/**
+ *  Host test and transfer-time benchmark of bootloader/dfu_pipeline.c.
+ *
+ *  A simulated DFU Controller sends an init packet and a firmware image over a simulated
+ *  connection to a copy of the control point and packet handling of bootloader/nrf_ble_dfu.c,
+ *  with or without the pipeline. The request handler is simulated with nRF52832 flash timing:
+ *  page erase 85 ms, word write 41 us, writes wait while two 256 byte buffers are queued and
+ *  Execute waits for the flash.
+ *
+ *  Radio: 15 ms connection interval, LL packets at 1 Mbps each acknowledged by an empty packet,
+ *  connection events of 3.75 ms, or the whole interval with event length extension. A request
+ *  is answered in the next connection event and the controller acts in the one after.
+ *  As with the SoftDevice, a flash write starts in a gap between radio activity that is long
+ *  enough for it, connection events during a started flash operation are skipped. Page erase
+ *  and a CPU waiting for the flash do not wait for a gap. PRN every 10 packets, the controller
+ *  checks each CRC.
+ *
+ *  Checks:
+ *   - flash holds the image and the last Execute validates it, in every mode
+ *   - PRN and Calculate CRC match the CRC of the image sent so far
+ *   - a failed flash write is reported to the controller, which resumes from a partial
+ *     object after reconnecting
+ *   - larger MTU is faster than the default one, pipelined flash writes faster than serial
+ *
+ *  Usage: dfu_transfer [-v]
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "crc32.h"
+#include "dfu_pipeline.h"
+
+#define IMAGE_SIZE          (100 * 1024 + 1000)
+#define INIT_SIZE           140
+#define OBJECT_SIZE         4096
+#define PRN                 10
+#define GATT_MTU_DEFAULT    23
+#define ATT_HEADER          3
+#define L2CAP_HEADER        4
+#define LL_PAYLOAD_DEFAULT  27
+#define LL_PAYLOAD_DLE      251
+#define RESPONSE_LEN        15
+#define CONN_INTERVAL_US    15000
+#define EVENT_US            3750
+#define EVENT_GUARD_US      1250     // End of extended event before next anchor
+#define ERASE_US            85000
+#define WORD_US             41
+#define HANDLER_BUFFER      512
+#define CHUNK_US            (DFU_PIPELINE_CHUNK_SIZE / 4 * WORD_US)
+#define MAX_FLASH_OPS       1024
+#define MAX_INTERVALS       32768
+#define MAX_RETRIES         3
+#define NO_TIMER            UINT32_MAX
+#define NO_FAILURE          UINT32_MAX
+
+// nrf_dfu_res_code_t
+#define RES_SUCCESS                0x01
+#define RES_INSUFFICIENT_RESOURCES 0x04
+#define RES_NOT_PERMITTED          0x08
+#define RES_OPERATION_FAILED       0x0A
+
+#define OBJ_TYPE_COMMAND    1
+#define OBJ_TYPE_DATA       2
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if(!(condition))                                                       \
+    {                                                                      \
+      printf("FAIL %s:%d: %s\n", __func__, __LINE__, #condition);          \
+      failures++;                                                          \
+    }                                                                      \
+  } while(0)
+
+typedef struct {
+  const char* name;
+  uint16_t mtu;
+  bool     dle;
+  bool     event_extension;
+  bool     pipelined;
+}link_config_t;
+
+typedef struct {
+  uint32_t queued;
+  uint32_t duration;
+  uint32_t start;
+  uint32_t end;
+  uint16_t bytes;                // 0 for erase
+  bool     committed;            // Start is decided
+}flash_op_t;
+
+/** Busy time of radio or flash */
+typedef struct {
+  uint32_t start;
+  uint32_t end;
+  uint32_t count;
+  uint32_t scan;                 // Intervals before this have ended
+  uint32_t time[MAX_INTERVALS][2];
+}intervals_t;
+
+typedef struct {
+  uint32_t time_us;
+  uint32_t errors;               // Error responses seen by controller
+  uint32_t retries;              // Reconnects
+  bool     validated;
+}transfer_result_t;
+
+static const link_config_t links[] = {
+  { "MTU  23, serial (previous)",  GATT_MTU_DEFAULT, false, false, false },
+  { "MTU  23, pipelined",          GATT_MTU_DEFAULT, false, false, true  },
+  { "MTU 247 + DLE, serial",       247,              true,  true,  false },
+  { "MTU 247 + DLE, pipelined",    247,              true,  true,  true  },
+};
+
+static bool     verbose;
+static uint32_t failures;
+static uint8_t  image[IMAGE_SIZE];
+
+/** CPU time, us */
+static uint32_t now;
+/** Timer of the transport, NO_TIMER if stopped */
+static uint32_t timer_at;
+
+/** Flash */
+static flash_op_t  flash_ops[MAX_FLASH_OPS];
+static uint32_t    flash_head;
+static uint32_t    flash_count;
+static uint32_t    flash_time;       // End of latest started operation
+static uint32_t    flash_estimate;   // Same estimate as the firmware
+static intervals_t flash_busy;
+static uint8_t     flash[IMAGE_SIZE];
+
+/** Controller side of the radio */
+static intervals_t radio_busy;
+static uint32_t    event_start;
+static uint32_t    tx;
+
+/** Request handler */
+static struct {
+  uint32_t offset;
+  uint32_t crc;
+  uint32_t executed;
+  uint32_t executed_crc;
+  uint32_t object_end;
+  bool     object_open;
+  uint32_t command_size;
+  uint32_t command_received;
+  bool     command_executed;
+  uint32_t fail_at;              // Write covering this offset fails once
+  bool     validated;
+}handler;
+
+/** Transport, as in nrf_ble_dfu.c */
+static struct {
+  const link_config_t* p_link;
+  uint8_t  object_type;
+  uint32_t object_size;
+  uint32_t max_object_size;
+  bool     partial_object;
+  uint16_t prn_target;
+  uint16_t prn_count;
+}transport;
+
+static uint32_t max_u32(uint32_t a, uint32_t b) { return (a > b) ? a : b; }
+
+/* ---------------------------------------------------------------- Busy intervals */
+
+static void interval_add(intervals_t* p_intervals, uint32_t start, uint32_t end)
+{
+  uint32_t last = p_intervals->count - 1;
+  if(p_intervals->count > 0 && p_intervals->time[last][1] >= start)
+  {
+    p_intervals->time[last][1] = max_u32(p_intervals->time[last][1], end);
+    return;
+  }
+  if(p_intervals->count < MAX_INTERVALS)
+  {
+    p_intervals->time[p_intervals->count][0] = start;
+    p_intervals->time[p_intervals->count][1] = end;
+    p_intervals->count++;
+  }
+}
+
+/** Return true and end of the interval if any overlaps start...end, start does not decrease between calls */
+static bool interval_overlap(intervals_t* p_intervals, uint32_t start, uint32_t end, uint32_t* p_end)
+{
+  while(p_intervals->scan < p_intervals->count && p_intervals->time[p_intervals->scan][1] <= start) { p_intervals->scan++; }
+  for(uint32_t ii = p_intervals->scan; ii < p_intervals->count && p_intervals->time[ii][0] < end; ii++)
+  {
+    if(p_intervals->time[ii][1] > start)
+    {
+      *p_end = p_intervals->time[ii][1];
+      return true;
+    }
+  }
+  return false;
+}
+
+/* ---------------------------------------------------------------- Flash */
+
+/** Earliest start at or after t of a write that fits between radio activity so far */
+static uint32_t radio_gap(uint32_t t, uint32_t duration)
+{
+  uint32_t end;
+  while(interval_overlap(&radio_busy, t, t + duration, &end)) { t = end; }
+  return t;
+}
+
+/** Decide start of the oldest operation that has not been started */
+static void flash_start_next(void)
+{
+  for(uint32_t ii = 0; ii < flash_count; ii++)
+  {
+    flash_op_t* p_op = &flash_ops[(flash_head + ii) % MAX_FLASH_OPS];
+    if(p_op->committed) { continue; }
+    p_op->start = max_u32(flash_time, p_op->queued);
+    if(0 != p_op->bytes) { p_op->start = radio_gap(p_op->start, p_op->duration); }
+    p_op->end = p_op->start + p_op->duration;
+    p_op->committed = true;
+    flash_time = p_op->end;
+    interval_add(&flash_busy, p_op->start, p_op->end);
+    return;
+  }
+}
+
+/** Start operations that can start by t, retire the ones completed by CPU time */
+static void flash_advance(uint32_t t)
+{
+  for(uint32_t ii = 0; ii < flash_count; ii++)
+  {
+    flash_op_t* p_op = &flash_ops[(flash_head + ii) % MAX_FLASH_OPS];
+    if(p_op->committed) { continue; }
+    uint32_t start = max_u32(flash_time, p_op->queued);
+    if(0 != p_op->bytes) { start = radio_gap(start, p_op->duration); }
+    if(start > t) { break; }
+    flash_start_next();
+  }
+  while(flash_count > 0 && flash_ops[flash_head].committed && flash_ops[flash_head].end <= now)
+  {
+    flash_head = (flash_head + 1) % MAX_FLASH_OPS;
+    flash_count--;
+  }
+}
+
+static void flash_queue(uint32_t duration, uint16_t bytes)
+{
+  if(flash_count < MAX_FLASH_OPS)
+  {
+    flash_ops[(flash_head + flash_count) % MAX_FLASH_OPS] = (flash_op_t){ now, duration, 0, 0, bytes, false };
+    flash_count++;
+  }
+  flash_advance(now);
+}
+
+static uint32_t flash_pending_bytes(void)
+{
+  uint32_t bytes = 0;
+  flash_advance(now);
+  for(uint32_t ii = 0; ii < flash_count; ii++) { bytes += flash_ops[(flash_head + ii) % MAX_FLASH_OPS].bytes; }
+  return bytes;
+}
+
+/** CPU waits for the flash, which does not wait for a gap in radio activity */
+static void cpu_block(uint32_t t)
+{
+  now = max_u32(now, t);
+  flash_advance(now);
+}
+
+static void cpu_block_for_oldest(void)
+{
+  flash_op_t* p_op = &flash_ops[flash_head];
+  if(!p_op->committed)
+  {
+    p_op->queued = max_u32(p_op->queued, now);
+    p_op->bytes = p_op->bytes ? p_op->bytes : 0;
+    p_op->start = max_u32(flash_time, p_op->queued);
+    p_op->end = p_op->start + p_op->duration;
+    p_op->committed = true;
+    flash_time = p_op->end;
+    interval_add(&flash_busy, p_op->start, p_op->end);
+  }
+  cpu_block(p_op->end);
+}
+
+/* ---------------------------------------------------------------- Request handler */
+
+static uint8_t handler_create(uint8_t type, uint32_t size)
+{
+  if(OBJ_TYPE_COMMAND == type)
+  {
+    handler.command_size = size;
+    handler.command_received = 0;
+    handler.command_executed = false;
+    return RES_SUCCESS;
+  }
+  if(!handler.command_executed) { return RES_NOT_PERMITTED; }
+  if(0 == size || size > OBJECT_SIZE || handler.executed + size > IMAGE_SIZE) { return RES_INSUFFICIENT_RESOURCES; }
+  // Data of an object that was not executed is discarded
+  handler.offset = handler.executed;
+  handler.crc = handler.executed_crc;
+  handler.object_end = handler.executed + size;
+  handler.object_open = true;
+  flash_queue((size + OBJECT_SIZE - 1) / OBJECT_SIZE * ERASE_US, 0);
+  return RES_SUCCESS;
+}
+
+static uint8_t handler_write(uint8_t type, const uint8_t* p_data, uint16_t len)
+{
+  if(OBJ_TYPE_COMMAND == type)
+  {
+    if(handler.command_received + len > handler.command_size) { return RES_NOT_PERMITTED; }
+    handler.command_received += len;
+    return RES_SUCCESS;
+  }
+  if(!handler.object_open || handler.offset + len > handler.object_end) { return RES_NOT_PERMITTED; }
+  if(handler.fail_at >= handler.offset && handler.fail_at < handler.offset + len)
+  {
+    handler.fail_at = NO_FAILURE;
+    return RES_OPERATION_FAILED;
+  }
+  // Buffers of the handler are full, wait for the oldest flash operation
+  while(flash_pending_bytes() + len > HANDLER_BUFFER) { cpu_block_for_oldest(); }
+  memcpy(&flash[handler.offset], p_data, len);
+  handler.crc = crc32_compute(p_data, len, (0 == handler.offset) ? NULL : &handler.crc);
+  handler.offset += len;
+  flash_queue((len + 3) / 4 * WORD_US, len);
+  return RES_SUCCESS;
+}
+
+static uint8_t handler_execute(uint8_t type)
+{
+  if(OBJ_TYPE_COMMAND == type)
+  {
+    if(handler.command_received != handler.command_size) { return RES_NOT_PERMITTED; }
+    handler.command_executed = true;
+    return RES_SUCCESS;
+  }
+  if(!handler.object_open || handler.offset != handler.object_end) { return RES_NOT_PERMITTED; }
+  while(flash_count > 0) { cpu_block_for_oldest(); }
+  handler.object_open = false;
+  handler.executed = handler.offset;
+  handler.executed_crc = handler.crc;
+  if(IMAGE_SIZE == handler.executed)
+  {
+    // Image is validated against the init packet
+    handler.validated = (0 == memcmp(flash, image, IMAGE_SIZE));
+    if(!handler.validated) { return RES_OPERATION_FAILED; }
+  }
+  return RES_SUCCESS;
+}
+
+/* ---------------------------------------------------------------- Transport */
+
+static uint32_t estimate_left(void)
+{
+  return (flash_estimate > now) ? flash_estimate - now : 0;
+}
+
+static void estimate_add(uint32_t duration)
+{
+  flash_estimate = now + estimate_left() + duration;
+}
+
+static uint8_t sink_create(uint32_t object_size)
+{
+  uint8_t res = handler_create(OBJ_TYPE_DATA, object_size);
+  if(RES_SUCCESS == res) { estimate_add((object_size + OBJECT_SIZE - 1) / OBJECT_SIZE * ERASE_US); }
+  return res;
+}
+
+static uint8_t sink_write(uint8_t const* p_data, uint16_t len)
+{
+  uint8_t res = handler_write(OBJ_TYPE_DATA, p_data, len);
+  estimate_add((len + 3) / 4 * WORD_US);
+  return res;
+}
+
+static uint8_t sink_execute(void) { return handler_execute(OBJ_TYPE_DATA); }
+
+static bool sink_is_busy(void) { return estimate_left() > CHUNK_US; }
+
+static const dfu_pipeline_sink_t sink = { sink_create, sink_write, sink_execute, sink_is_busy };
+
+/** pipeline_schedule of nrf_ble_dfu.c */
+static void transport_schedule(void)
+{
+  if(!transport.p_link->pipelined) { return; }
+  dfu_pipeline_process();
+  if(dfu_pipeline_is_empty()) { return; }
+  uint32_t left = estimate_left();
+  timer_at = now + max_u32((left > CHUNK_US) ? left - CHUNK_US : 0, 150);
+}
+
+/** CPU sleeps until t, timer of the transport may run meanwhile */
+static void cpu_wait(uint32_t t)
+{
+  while(NO_TIMER != timer_at && timer_at <= t)
+  {
+    cpu_block(timer_at);
+    timer_at = NO_TIMER;
+    transport_schedule();
+  }
+  cpu_block(t);
+}
+
+static uint8_t transport_create(uint8_t type, uint32_t size)
+{
+  transport.object_type = type;
+  transport.object_size = size;
+  if(!transport.p_link->pipelined) { return handler_create(type, size); }
+  if(OBJ_TYPE_DATA == type && transport.partial_object)
+  {
+    (void)dfu_pipeline_flush();
+    uint8_t res = sink_create(size);
+    if(RES_SUCCESS == res)
+    {
+      dfu_pipeline_position_set(handler.offset, handler.crc);
+      transport.partial_object = false;
+    }
+    return res;
+  }
+  if(OBJ_TYPE_DATA == type) { return dfu_pipeline_create(size); }
+  (void)dfu_pipeline_flush();
+  return handler_create(type, size);
+}
+
+static uint8_t transport_execute(void)
+{
+  if(!transport.p_link->pipelined) { return handler_execute(transport.object_type); }
+  if(OBJ_TYPE_DATA == transport.object_type)
+  {
+    uint8_t res = dfu_pipeline_execute(transport.object_size == transport.max_object_size);
+    transport.partial_object = false;
+    return res;
+  }
+  (void)dfu_pipeline_flush();
+  return handler_execute(transport.object_type);
+}
+
+static uint8_t transport_crc(uint32_t* p_offset, uint32_t* p_crc)
+{
+  if(transport.p_link->pipelined && OBJ_TYPE_DATA == transport.object_type)
+  {
+    *p_offset = dfu_pipeline_offset();
+    *p_crc = dfu_pipeline_crc();
+    return dfu_pipeline_result();
+  }
+  *p_offset = handler.offset;
+  *p_crc = handler.crc;
+  return RES_SUCCESS;
+}
+
+static uint8_t transport_select(uint8_t type, uint32_t* p_max_size, uint32_t* p_offset, uint32_t* p_crc)
+{
+  transport.object_type = type;
+  if(transport.p_link->pipelined) { (void)dfu_pipeline_flush(); }
+  *p_max_size = OBJECT_SIZE;
+  *p_offset = handler.offset;
+  *p_crc = handler.crc;
+  if(OBJ_TYPE_DATA == type)
+  {
+    transport.max_object_size = OBJECT_SIZE;
+    transport.partial_object = (0 != (handler.offset % OBJECT_SIZE));
+    dfu_pipeline_position_set(handler.offset, handler.crc);
+  }
+  return RES_SUCCESS;
+}
+
+/** Return true if a PRN is sent */
+static bool transport_packet(const uint8_t* p_data, uint16_t len, uint32_t* p_offset, uint32_t* p_crc)
+{
+  bool prn = false;
+  if(!transport.p_link->pipelined || OBJ_TYPE_COMMAND == transport.object_type)
+  {
+    (void)handler_write(transport.object_type, p_data, len);
+    *p_offset = handler.offset;
+    *p_crc = handler.crc;
+  }
+  else
+  {
+    (void)dfu_pipeline_write(p_data, len);
+    *p_offset = dfu_pipeline_offset();
+    *p_crc = dfu_pipeline_crc();
+  }
+  if(0 != transport.prn_target && 0 == --transport.prn_count)
+  {
+    transport.prn_count = transport.prn_target;
+    prn = true;
+  }
+  // Buffered data is written while the controller waits for the PRN
+  if(prn || 0 == transport.prn_target) { transport_schedule(); }
+  return prn;
+}
+
+static void transport_disconnect(void)
+{
+  if(transport.p_link->pipelined) { (void)dfu_pipeline_flush(); }
+  timer_at = NO_TIMER;
+}
+
+/* ---------------------------------------------------------------- Radio */
+
+static uint32_t next_event(uint32_t t)
+{
+  return (t + CONN_INTERVAL_US - 1) / CONN_INTERVAL_US * CONN_INTERVAL_US;
+}
+
+/** LL packet with acknowledgement, 10 bytes of preamble, address, header and CRC */
+static uint32_t pdu_us(uint16_t payload)
+{
+  return (payload + 10) * 8 + 150 + 80 + 150;
+}
+
+/** Place LL packet at or after tx in a connection event without flash activity */
+static void radio_pdu(uint16_t payload)
+{
+  uint32_t budget = transport.p_link->event_extension ? CONN_INTERVAL_US - EVENT_GUARD_US : EVENT_US;
+  uint32_t duration = pdu_us(payload);
+  uint32_t end;
+  while(true)
+  {
+    if(tx + duration > event_start + budget)
+    {
+      event_start = tx = next_event(tx + 1);
+      continue;
+    }
+    flash_advance(tx);
+    if(interval_overlap(&flash_busy, tx, tx + duration, &end))
+    {
+      event_start = tx = next_event(end);
+      continue;
+    }
+    break;
+  }
+  interval_add(&radio_busy, tx, tx + duration);
+  tx += duration;
+}
+
+/** Controller sends an ATT write from tx, return time it has been received */
+static uint32_t radio_write(uint16_t att_len)
+{
+  uint16_t ll = transport.p_link->dle ? LL_PAYLOAD_DLE : LL_PAYLOAD_DEFAULT;
+  uint32_t left = att_len + L2CAP_HEADER;
+  while(left > 0)
+  {
+    uint16_t payload = (left > ll) ? ll : left;
+    radio_pdu(payload);
+    left -= payload;
+  }
+  return tx;
+}
+
+/** Peripheral answers in the next connection event, controller acts in the one after */
+static void radio_response(void)
+{
+  event_start = tx = next_event(max_u32(now, tx) + 1);
+  radio_pdu(RESPONSE_LEN + ATT_HEADER + L2CAP_HEADER);
+  event_start = tx = next_event(tx + 1);
+}
+
+/** Controller writes a control point request, which the transport handles when received */
+static void radio_request(uint16_t len)
+{
+  cpu_wait(radio_write(ATT_HEADER + len));
+}
+
+/* ---------------------------------------------------------------- Controller */
+
+static void report(const char* what, uint32_t offset, uint8_t res)
+{
+  if(verbose) { printf("    %8.3f s  %-8s offset %6u  result 0x%02x\n", tx / 1e6, what, offset, res); }
+}
+
+/** Send data of current object, return false if a PRN does not match the image */
+static bool send_data(const uint8_t* p_data, uint32_t start, uint32_t len, uint16_t packet_len, bool check_prn)
+{
+  for(uint32_t sent = 0; sent < len;)
+  {
+    uint16_t chunk = (len - sent > packet_len) ? packet_len : (len - sent);
+    uint32_t offset, crc;
+    cpu_wait(radio_write(ATT_HEADER + chunk));
+    bool prn = transport_packet(&p_data[sent], chunk, &offset, &crc);
+    sent += chunk;
+    if(!prn) { continue; }
+    radio_response();
+    if(check_prn && (offset != start + sent || crc != crc32_compute(image, offset, NULL)))
+    {
+      report("PRN", offset, 0);
+      return false;
+    }
+  }
+  return true;
+}
+
+static void reset(const link_config_t* p_link, uint32_t fail_at)
+{
+  now = 0;
+  timer_at = NO_TIMER;
+  flash_head = flash_count = flash_time = flash_estimate = 0;
+  memset(&flash_busy, 0, sizeof(flash_busy));
+  memset(&radio_busy, 0, sizeof(radio_busy));
+  memset(flash, 0xFF, sizeof(flash));
+  memset(&handler, 0, sizeof(handler));
+  handler.fail_at = fail_at;
+  memset(&transport, 0, sizeof(transport));
+  transport.p_link = p_link;
+  dfu_pipeline_init(&sink);
+  event_start = tx = 0;
+}
+
+/** Controller sends init packet and image, resumes after failures, like nRF Connect */
+static transfer_result_t transfer(const link_config_t* p_link, uint32_t fail_at)
+{
+  transfer_result_t result = { 0 };
+  uint16_t packet_len = p_link->mtu - ATT_HEADER;
+  uint8_t  init[INIT_SIZE] = { 0 };
+  uint32_t max_size, offset, crc;
+  uint8_t  res;
+
+  reset(p_link, fail_at);
+  if(verbose) { printf("  %s\n", p_link->name); }
+
+  // MTU exchange and data length update
+  radio_request(3);
+  radio_response();
+
+  // Init packet
+  radio_request(2);
+  (void)transport_select(OBJ_TYPE_COMMAND, &max_size, &offset, &crc);
+  radio_response();
+  radio_request(6);
+  res = transport_create(OBJ_TYPE_COMMAND, INIT_SIZE);
+  radio_response();
+  (void)send_data(init, 0, INIT_SIZE, packet_len, false);
+  radio_request(1);
+  res |= transport_execute();
+  radio_response();
+  CHECK(RES_SUCCESS == res);
+
+  radio_request(3);
+  transport.prn_target = transport.prn_count = PRN;
+  radio_response();
+
+  for(uint32_t attempt = 0; attempt <= MAX_RETRIES && !handler.validated; attempt++)
+  {
+    if(attempt > 0)
+    {
+      transport_disconnect();
+      result.retries++;
+    }
+    radio_request(2);
+    (void)transport_select(OBJ_TYPE_DATA, &max_size, &offset, &crc);
+    radio_response();
+    report("select", offset, RES_SUCCESS);
+
+    // Partial object is sent again from its start
+    for(uint32_t start = offset - offset % max_size; start < IMAGE_SIZE; start += max_size)
+    {
+      uint32_t size = (IMAGE_SIZE - start > max_size) ? max_size : IMAGE_SIZE - start;
+      radio_request(6);
+      res = transport_create(OBJ_TYPE_DATA, size);
+      transport_schedule();
+      radio_response();
+      if(RES_SUCCESS != res) { report("create", start, res); result.errors++; break; }
+      if(!send_data(&image[start], start, size, packet_len, true)) { result.errors++; break; }
+      radio_request(1);
+      res = transport_crc(&offset, &crc);
+      transport_schedule();
+      radio_response();
+      if(RES_SUCCESS != res || offset != start + size || crc != crc32_compute(image, offset, NULL))
+      {
+        report("CRC", offset, res);
+        result.errors++;
+        break;
+      }
+      radio_request(1);
+      res = transport_execute();
+      transport_schedule();
+      radio_response();
+      if(RES_SUCCESS != res) { report("execute", start, res); result.errors++; break; }
+    }
+  }
+  result.time_us = tx;
+  result.validated = handler.validated;
+  if(verbose) { printf("    %8.3f s  done, %u retries\n", tx / 1e6, result.retries); }
+  return result;
+}
+
+static void test_transfers(void)
+{
+  uint32_t times[sizeof(links) / sizeof(links[0])];
+  printf("Transfer of %u byte image, %u ms connection interval, PRN %u:\n",
+         IMAGE_SIZE, CONN_INTERVAL_US / 1000, PRN);
+  for(uint32_t ii = 0; ii < sizeof(links) / sizeof(links[0]); ii++)
+  {
+    transfer_result_t result = transfer(&links[ii], NO_FAILURE);
+    CHECK(result.validated);
+    CHECK(0 == result.errors);
+    CHECK(0 == result.retries);
+    CHECK(dfu_pipeline_is_empty());
+    times[ii] = result.time_us;
+    printf("  %-28s %6.2f s  %5.1f kB/s\n", links[ii].name, result.time_us / 1e6,
+           IMAGE_SIZE / 1024.0 / (result.time_us / 1e6));
+  }
+  CHECK(times[1] <= times[0]);
+  CHECK(times[2] < times[0]);
+  CHECK(times[3] < times[2]);
+}
+
+/** Flash write fails in the middle of an object, controller resumes after reconnect */
+static void test_failure(void)
+{
+  for(uint32_t ii = 0; ii < sizeof(links) / sizeof(links[0]); ii++)
+  {
+    transfer_result_t result = transfer(&links[ii], 5 * OBJECT_SIZE + 1000);
+    CHECK(result.validated);
+    CHECK(1 == result.errors);
+    CHECK(1 == result.retries);
+  }
+}
+
+/** Pipeline on its own: data waits while flash is busy, failure is latched until position is set */
+static void test_pipeline(void)
+{
+  static const link_config_t link = { "pipeline", 247, true, true, true };
+  uint8_t data[244];
+  reset(&link, NO_FAILURE);
+  handler.command_executed = true;
+
+  // Erase keeps the flash busy, data stays in the pipeline
+  CHECK(RES_SUCCESS == dfu_pipeline_create(OBJECT_SIZE));
+  CHECK(dfu_pipeline_is_empty());
+  uint32_t sent = 0;
+  while(sent + sizeof(data) <= OBJECT_SIZE)
+  {
+    memcpy(data, &image[sent], sizeof(data));
+    CHECK(RES_SUCCESS == dfu_pipeline_write(data, sizeof(data)));
+    sent += sizeof(data);
+  }
+  CHECK(0 == handler.offset);
+  CHECK(sent == dfu_pipeline_offset());
+  CHECK(crc32_compute(image, sent, NULL) == dfu_pipeline_crc());
+  CHECK(0 == now);
+  CHECK(RES_SUCCESS == dfu_pipeline_write(&image[sent], OBJECT_SIZE - sent));
+  CHECK(RES_SUCCESS == dfu_pipeline_execute(true));
+  CHECK(!dfu_pipeline_is_empty());
+  CHECK(0 == now);
+  // Next object is queued behind the execute, full buffer waits for the flash
+  CHECK(RES_SUCCESS == dfu_pipeline_create(OBJECT_SIZE));
+  for(sent = 0; sent < OBJECT_SIZE; sent += 256)
+  {
+    CHECK(RES_SUCCESS == dfu_pipeline_write(&image[OBJECT_SIZE + sent], 256));
+  }
+  CHECK(now > ERASE_US);
+  CHECK(OBJECT_SIZE == handler.executed);
+  CHECK(RES_SUCCESS == dfu_pipeline_flush());
+  CHECK(2 * OBJECT_SIZE == handler.offset);
+  CHECK(handler.crc == dfu_pipeline_crc());
+  CHECK(0 == memcmp(flash, image, 2 * OBJECT_SIZE));
+
+  // Failure is returned until position is set again
+  CHECK(RES_SUCCESS == dfu_pipeline_execute(false));
+  handler.fail_at = 2 * OBJECT_SIZE + 10;
+  CHECK(RES_SUCCESS == dfu_pipeline_create(OBJECT_SIZE));
+  (void)dfu_pipeline_write(&image[2 * OBJECT_SIZE], 100);
+  CHECK(RES_OPERATION_FAILED == dfu_pipeline_flush());
+  CHECK(RES_OPERATION_FAILED == dfu_pipeline_write(data, 10));
+  CHECK(RES_OPERATION_FAILED == dfu_pipeline_execute(true));
+  CHECK(dfu_pipeline_is_empty());
+  dfu_pipeline_position_set(handler.executed, handler.executed_crc);
+  CHECK(RES_SUCCESS == dfu_pipeline_result());
+  CHECK(RES_SUCCESS == dfu_pipeline_create(OBJECT_SIZE));
+  CHECK(RES_SUCCESS == dfu_pipeline_write(&image[2 * OBJECT_SIZE], 100));
+  CHECK(RES_SUCCESS == dfu_pipeline_flush());
+  CHECK(handler.crc == dfu_pipeline_crc());
+  CHECK(2 * OBJECT_SIZE + 100 == handler.offset);
+}
+
+int main(int argc, char** argv)
+{
+  int opt;
+  while((opt = getopt(argc, argv, "v")) != -1)
+  {
+    if('v' == opt) { verbose = true; }
+    else
+    {
+      fprintf(stderr, "Usage: %s [-v]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  srand(1);
+  for(uint32_t ii = 0; ii < IMAGE_SIZE; ii++) { image[ii] = rand(); }
+
+  test_pipeline();
+  test_transfers();
+  test_failure();
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
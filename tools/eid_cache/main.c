@@ -0,0 +1,330 @@
+/**
+ *  Host test and benchmark of libraries/eddystone_eid.
+ *
+ *  EAX is checked against test vectors of the EAX paper by Bellare, Rogaway and Wagner.
+ *  EIDs are checked against values computed from the Eddystone formula with
+ *  openssl enc -aes-128-ecb -nopad, one encryption for temporary key and one for EID.
+ *
+ *  Checks:
+ *   - EAX ciphertext and tag of reference vectors
+ *   - temporary key and EIDs of reference identity key
+ *   - cache holds current and next rotation period, refills one per rotation, follows
+ *     clock changes and temporary key epochs
+ *   - cached eTLM equals computed eTLM, decrypts back to TLM, preparation is used once
+ *   - block encryptions left when slot is due: none for EID, one for eTLM
+ *   - host time of frames computed when due and taken from cache
+ *
+ *  Usage: eid_cache [-v]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aes_cmac.h"
+#include "eid.h"
+#include "eid_cache.h"
+
+#define BENCH_FRAMES 100000
+
+static uint32_t failures;
+static bool     verbose = false;
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if(!(condition))                                                       \
+    {                                                                      \
+      printf("FAIL %s:%d: %s\n", __func__, __LINE__, #condition);          \
+      failures++;                                                          \
+    }                                                                      \
+  } while(0)
+
+static void print_hex(const char* p_name, const uint8_t* p_data, size_t length)
+{
+  if(!verbose) { return; }
+  printf("%s ", p_name);
+  for(size_t ii = 0; ii < length; ii++) { printf("%02x", p_data[ii]); }
+  printf("\n");
+}
+
+static void test_eax(void)
+{
+  const struct {
+    uint8_t key[AES_KEY_SIZE];
+    uint8_t nonce[16];
+    uint8_t header[8];
+    uint8_t length;
+    uint8_t plain[2];
+    uint8_t cipher[2];
+    uint8_t tag[AES_BLOCK_SIZE];
+  } vectors[] = {
+    { { 0x23, 0x39, 0x52, 0xDE, 0xE4, 0xD5, 0xED, 0x5F, 0x9B, 0x9C, 0x6D, 0x6F, 0xF8, 0x0F, 0xF4, 0x78 },
+      { 0x62, 0xEC, 0x67, 0xF9, 0xC3, 0xA4, 0xA4, 0x07, 0xFC, 0xB2, 0xA8, 0xC4, 0x90, 0x31, 0xA8, 0xB3 },
+      { 0x6B, 0xFB, 0x91, 0x4F, 0xD0, 0x7E, 0xAE, 0x6B },
+      0, { 0 }, { 0 },
+      { 0xE0, 0x37, 0x83, 0x0E, 0x83, 0x89, 0xF2, 0x7B, 0x02, 0x5A, 0x2D, 0x65, 0x27, 0xE7, 0x9D, 0x01 } },
+    { { 0x91, 0x94, 0x5D, 0x3F, 0x4D, 0xCB, 0xEE, 0x0B, 0xF4, 0x5E, 0xF5, 0x22, 0x55, 0xF0, 0x95, 0xA4 },
+      { 0xBE, 0xCA, 0xF0, 0x43, 0xB0, 0xA2, 0x3D, 0x84, 0x31, 0x94, 0xBA, 0x97, 0x2C, 0x66, 0xDE, 0xBD },
+      { 0xFA, 0x3B, 0xFD, 0x48, 0x06, 0xEB, 0x53, 0xFA },
+      2, { 0xF7, 0xFB }, { 0x19, 0xDD },
+      { 0x5C, 0x4C, 0x93, 0x31, 0x04, 0x9D, 0x0B, 0xDA, 0xB0, 0x27, 0x74, 0x08, 0xF6, 0x79, 0x67, 0xE5 } }
+  };
+  for(size_t ii = 0; ii < sizeof(vectors) / sizeof(vectors[0]); ii++)
+  {
+    aes128_t aes;
+    aes_cmac_t cmac;
+    uint8_t cipher[2];
+    uint8_t tag[AES_BLOCK_SIZE];
+    aes128_init(&aes, vectors[ii].key);
+    aes_cmac_init(&cmac, aes128_encrypt, &aes);
+    eid_eax_encrypt(&cmac, vectors[ii].nonce, sizeof(vectors[ii].nonce), vectors[ii].header,
+                    sizeof(vectors[ii].header), vectors[ii].plain, vectors[ii].length, cipher, tag);
+    CHECK(0 == memcmp(vectors[ii].cipher, cipher, vectors[ii].length));
+    CHECK(0 == memcmp(vectors[ii].tag, tag, sizeof(tag)));
+  }
+}
+
+static const uint8_t identity_key[AES_KEY_SIZE] = {
+  0xe2, 0xc5, 0x6d, 0xb5, 0xdf, 0xfb, 0x48, 0xd2, 0xb0, 0x60, 0xd0, 0xf5, 0xa7, 0x10, 0x96, 0xe0
+};
+
+#define REFERENCE_EXPONENT 10
+#define REFERENCE_TIME     0x12345678
+
+static void test_eid(void)
+{
+  const uint8_t temporary_key[AES_KEY_SIZE] = {
+    0x32, 0x67, 0x41, 0x59, 0xd7, 0xac, 0xb5, 0x7f, 0xf2, 0x8b, 0x81, 0xaf, 0x6c, 0x96, 0x3f, 0x84
+  };
+  const struct { uint8_t exponent; uint32_t time; uint8_t eid[EID_LENGTH]; } vectors[] = {
+    { REFERENCE_EXPONENT, REFERENCE_TIME,        { 0x4c, 0xea, 0x4a, 0x8f, 0x8b, 0xca, 0xaa, 0xea } },
+    // Any time of the period gives the same EID
+    { REFERENCE_EXPONENT, 0x12345400,            { 0x4c, 0xea, 0x4a, 0x8f, 0x8b, 0xca, 0xaa, 0xea } },
+    { REFERENCE_EXPONENT, REFERENCE_TIME + 1024, { 0x43, 0x96, 0x34, 0xd6, 0x27, 0xd0, 0xb2, 0xbd } },
+    { 0,                  0x00010000,            { 0xcf, 0x09, 0x5e, 0x67, 0x76, 0xd7, 0x90, 0x87 } }
+  };
+  aes128_t identity;
+  uint8_t key[AES_KEY_SIZE];
+  uint8_t eid[EID_LENGTH];
+  aes128_init(&identity, identity_key);
+  eid_temporary_key(&identity, REFERENCE_TIME, key);
+  CHECK(0 == memcmp(temporary_key, key, sizeof(key)));
+  CHECK(0x12345400 == eid_rotation_start(REFERENCE_EXPONENT, REFERENCE_TIME));
+  CHECK(REFERENCE_TIME == eid_rotation_start(0, REFERENCE_TIME));
+  for(size_t ii = 0; ii < sizeof(vectors) / sizeof(vectors[0]); ii++)
+  {
+    eid_compute(&identity, vectors[ii].exponent, vectors[ii].time, eid);
+    CHECK(0 == memcmp(vectors[ii].eid, eid, sizeof(eid)));
+  }
+  print_hex("eid", eid, sizeof(eid));
+}
+
+static void test_cache(void)
+{
+  static eid_cache_t cache;
+  aes128_t identity;
+  uint8_t eid[EID_LENGTH];
+  uint8_t expected[EID_LENGTH];
+  const uint32_t period = 1 << REFERENCE_EXPONENT;
+  aes128_init(&identity, identity_key);
+  eid_cache_init(&cache, identity_key, REFERENCE_EXPONENT);
+  CHECK(!eid_cache_get(&cache, REFERENCE_TIME, eid));
+
+  CHECK(EID_CACHE_DEPTH == eid_cache_refill(&cache, REFERENCE_TIME));
+  CHECK(0 == eid_cache_refill(&cache, REFERENCE_TIME + 1));
+  // Slot crossing rotation boundary finds next EID ready
+  for(uint32_t time = REFERENCE_TIME; time < eid_rotation_start(REFERENCE_EXPONENT, REFERENCE_TIME) + 2 * period; time += 97)
+  {
+    CHECK(eid_cache_get(&cache, time, eid));
+    eid_compute(&identity, REFERENCE_EXPONENT, time, expected);
+    CHECK(0 == memcmp(expected, eid, sizeof(eid)));
+  }
+  CHECK(!eid_cache_get(&cache, REFERENCE_TIME + 2 * period, eid));
+  CHECK(!eid_cache_get(&cache, REFERENCE_TIME - period, eid));
+
+  // One EID per rotation
+  CHECK(1 == eid_cache_refill(&cache, REFERENCE_TIME + period));
+  CHECK(eid_cache_get(&cache, REFERENCE_TIME + 2 * period, eid));
+  CHECK(!eid_cache_get(&cache, REFERENCE_TIME, eid));
+
+  // Clock set backwards or far ahead empties cache
+  CHECK(EID_CACHE_DEPTH == eid_cache_refill(&cache, REFERENCE_TIME - 5 * period));
+  CHECK(EID_CACHE_DEPTH == eid_cache_refill(&cache, REFERENCE_TIME + 50 * period));
+
+  // Next period in next temporary key epoch
+  const uint32_t epoch_end = 0x0002FFFF;
+  CHECK(EID_CACHE_DEPTH == eid_cache_refill(&cache, epoch_end));
+  CHECK(eid_cache_get(&cache, epoch_end + 1, eid));
+  eid_compute(&identity, REFERENCE_EXPONENT, epoch_end + 1, expected);
+  CHECK(0 == memcmp(expected, eid, sizeof(eid)));
+  CHECK(eid_cache_get(&cache, epoch_end, eid));
+  eid_compute(&identity, REFERENCE_EXPONENT, epoch_end, expected);
+  CHECK(0 == memcmp(expected, eid, sizeof(eid)));
+}
+
+static void make_tlm(uint8_t* p_tlm, uint32_t seed)
+{
+  for(uint8_t ii = 0; ii < EID_ETLM_PLAIN_LENGTH; ii++) { p_tlm[ii] = seed * 31 + 7 * ii; }
+}
+
+static void test_etlm(void)
+{
+  static eid_cache_t cache;
+  aes128_t identity;
+  aes_cmac_t cmac;
+  aes128_init(&identity, identity_key);
+  aes_cmac_init(&cmac, aes128_encrypt, &identity);
+  eid_cache_init(&cache, identity_key, REFERENCE_EXPONENT);
+
+  for(uint32_t ii = 0; ii < 64; ii++)
+  {
+    uint8_t tlm[EID_ETLM_PLAIN_LENGTH];
+    uint8_t cached[EID_ETLM_LENGTH];
+    uint8_t expected[EID_ETLM_LENGTH];
+    uint32_t time = REFERENCE_TIME + ii * 1000;
+    uint16_t salt = 0x1234 + ii * 0x0F0F;
+    make_tlm(tlm, ii);
+    eid_cache_etlm_prepare(&cache, time, salt);
+    CHECK(eid_cache_etlm_get(&cache, time, tlm, cached));
+    eid_etlm_encrypt(&cmac, time, salt, tlm, expected);
+    CHECK(0 == memcmp(expected, cached, sizeof(cached)));
+    CHECK((salt >> 8) == cached[EID_ETLM_SALT_OFFSET] && (salt & 0xFF) == cached[EID_ETLM_SALT_OFFSET + 1]);
+
+    // Receiver decrypts with same nonce, CTR is its own inverse
+    uint8_t nonce[6];
+    uint8_t plain[EID_ETLM_PLAIN_LENGTH];
+    uint8_t tag[AES_BLOCK_SIZE];
+    eid_etlm_nonce(time, salt, nonce);
+    eid_eax_encrypt(&cmac, nonce, sizeof(nonce), NULL, 0, cached, EID_ETLM_PLAIN_LENGTH, plain, tag);
+    CHECK(0 == memcmp(tlm, plain, sizeof(plain)));
+    if(0 == ii) { print_hex("etlm", cached, sizeof(cached)); }
+  }
+
+  // Preparation is for one time and one frame only
+  uint8_t tlm[EID_ETLM_PLAIN_LENGTH];
+  uint8_t etlm[EID_ETLM_LENGTH];
+  uint8_t untouched[EID_ETLM_LENGTH] = {0};
+  make_tlm(tlm, 99);
+  memset(etlm, 0, sizeof(etlm));
+  CHECK(!eid_cache_etlm_get(&cache, REFERENCE_TIME, tlm, etlm));
+  eid_cache_etlm_prepare(&cache, REFERENCE_TIME, 1);
+  CHECK(!eid_cache_etlm_get(&cache, REFERENCE_TIME + 1, tlm, etlm));
+  CHECK(0 == memcmp(untouched, etlm, sizeof(etlm)));
+  CHECK(eid_cache_etlm_get(&cache, REFERENCE_TIME, tlm, etlm));
+  CHECK(!eid_cache_etlm_get(&cache, REFERENCE_TIME, tlm, etlm));
+}
+
+static uint32_t encryptions;
+
+static void counting_cipher(void* p_context, const uint8_t* p_in, uint8_t* p_out)
+{
+  encryptions++;
+  aes128_encrypt(p_context, p_in, p_out);
+}
+
+static void test_cost(void)
+{
+  static eid_cache_t cache;
+  aes128_t identity;
+  aes_cmac_t cmac;
+  uint8_t tlm[EID_ETLM_PLAIN_LENGTH];
+  uint8_t etlm[EID_ETLM_LENGTH];
+  uint8_t eid[EID_LENGTH];
+  aes128_init(&identity, identity_key);
+  aes_cmac_init(&cmac, counting_cipher, &identity);
+  make_tlm(tlm, 1);
+
+  encryptions = 0;
+  eid_etlm_encrypt(&cmac, REFERENCE_TIME, 1, tlm, etlm);
+  CHECK(6 == encryptions);
+
+  eid_cache_init(&cache, identity_key, REFERENCE_EXPONENT);
+  cache.cmac.cipher = counting_cipher;
+  eid_cache_refill(&cache, REFERENCE_TIME);
+  encryptions = 0;
+  eid_cache_etlm_prepare(&cache, REFERENCE_TIME, 1);
+  CHECK(3 == encryptions);
+  encryptions = 0;
+  CHECK(eid_cache_etlm_get(&cache, REFERENCE_TIME, tlm, etlm));
+  CHECK(eid_cache_get(&cache, REFERENCE_TIME, eid));
+  CHECK(1 == encryptions);
+}
+
+static double elapsed_us(const struct timespec* p_start, const struct timespec* p_end)
+{
+  return (p_end->tv_sec - p_start->tv_sec) * 1e6 + (p_end->tv_nsec - p_start->tv_nsec) / 1e3;
+}
+
+/** Work done when a slot is due: computing EID and eTLM from scratch or finishing them from cache */
+static void benchmark(void)
+{
+  static eid_cache_t cache;
+  aes128_t identity;
+  aes_cmac_t cmac;
+  uint8_t tlm[EID_ETLM_PLAIN_LENGTH];
+  uint8_t etlm[EID_ETLM_LENGTH];
+  uint8_t eid[EID_LENGTH];
+  uint32_t sink = 0;
+  struct timespec start, end;
+  aes128_init(&identity, identity_key);
+  aes_cmac_init(&cmac, aes128_encrypt, &identity);
+  eid_cache_init(&cache, identity_key, REFERENCE_EXPONENT);
+  make_tlm(tlm, 2);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(uint32_t ii = 0; ii < BENCH_FRAMES; ii++)
+  {
+    eid_compute(&identity, REFERENCE_EXPONENT, REFERENCE_TIME + ii, eid);
+    eid_etlm_encrypt(&cmac, REFERENCE_TIME + ii, ii, tlm, etlm);
+    sink += eid[0] + etlm[0];
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double direct_us = elapsed_us(&start, &end) / BENCH_FRAMES;
+
+  // Idle work is outside the timed part, only what is left when slot is due counts
+  double cached_us = 0;
+  uint32_t hits = 0;
+  for(uint32_t ii = 0; ii < BENCH_FRAMES; ii++)
+  {
+    eid_cache_refill(&cache, REFERENCE_TIME + ii);
+    eid_cache_etlm_prepare(&cache, REFERENCE_TIME + ii, ii);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    hits += eid_cache_get(&cache, REFERENCE_TIME + ii, eid);
+    hits += eid_cache_etlm_get(&cache, REFERENCE_TIME + ii, tlm, etlm);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    cached_us += elapsed_us(&start, &end);
+    sink += eid[0] + etlm[0];
+  }
+  cached_us /= BENCH_FRAMES;
+  CHECK(2 * BENCH_FRAMES == hits);
+
+  printf("eid and etlm when due %.2f us\n", direct_us);
+  printf("from cache            %.2f us, includes clock reads\n", cached_us);
+  if(verbose) { printf("sink %u\n", sink); }
+}
+
+int main(int argc, char** argv)
+{
+  int option;
+  while(-1 != (option = getopt(argc, argv, "v")))
+  {
+    switch(option)
+    {
+      case 'v': verbose = true; break;
+      default:
+        fprintf(stderr, "Usage: %s [-v]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  test_eax();
+  test_eid();
+  test_cache();
+  test_etlm();
+  test_cost();
+  benchmark();
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
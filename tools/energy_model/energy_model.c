@@ -0,0 +1,220 @@
+#include "energy_model.h"
+
+#include <stddef.h>
+
+/**
+ *  Values are typical figures from nRF52832 PS v1.4, BME280 datasheet rev 1.6,
+ *  LIS2DH12 datasheet rev 6 and Renata/Panasonic CR2477 datasheets.
+ *  SoftDevice processing overheads are approximated from Nordic Online Power Profiler
+ *  for S132 non-connectable advertising with DC/DC enabled.
+ */
+const energy_profile_t energy_profile_ruuvitag_b = {
+  .sleep_current           = 1.9f,
+  .nfc_sense_current       = 0.1f,
+  .cpu_current             = 3700.0f,
+  .radio_ramp_current      = 4900.0f,
+  .radio_ramp_time         = 0.14f,
+  .adv_prepare_charge      = 1450.0f,
+  .adv_post_charge         = 600.0f,
+  .radio_notification_time = 0.03f,
+  .main_loop_cpu_time      = 1.0f,
+  .saadc_current           = 700.0f,
+  .saadc_time              = 0.4f,   // idle + load sample, 16x oversampled, 12 us per conversion
+  .battery_cpu_time        = 0.06f,  // starting conversions and SAADC done interrupts
+  .bme280_sleep_current    = 0.1f,
+  .bme280_standby_current  = 0.2f,
+  .bme280_startup_time     = 1.0f,
+  .bme280_t_current        = 350.0f,
+  .bme280_p_current        = 714.0f,
+  .bme280_h_current        = 340.0f,
+  .battery_capacity        = 1000.0f,
+  .battery_usable_fraction = 0.85f,
+  .battery_self_discharge  = 0.01f
+};
+
+/** On-air bytes of ADV_NONCONN_IND excluding manufacturer data:
+ *  preamble 1, access address 4, header 2, AdvA 6, flags 3, manufacturer AD header 4, CRC 3 */
+#define ADV_OVERHEAD_BYTES 23
+#define ADV_US_PER_BYTE    8
+#define ADV_CHANNELS       3
+#define ADV_MAX_DELAY_MS   10
+
+/** Oversampling register value to number of samples */
+static float os_to_samples(uint8_t os)
+{
+  if(0 == os) { return 0; }
+  if(5 < os)  { os = 5; }
+  return (float)(1 << (os - 1));
+}
+
+/** Standby register value to milliseconds */
+static float standby_to_ms(uint8_t standby)
+{
+  static const float standby_ms[] = {0.5f, 62.5f, 125.0f, 250.0f, 500.0f, 1000.0f, 10.0f, 20.0f};
+  return standby_ms[(standby >> 5) & 0x07];
+}
+
+/** TX current in uA with DC/DC at given power level, nRF52832 PS table 51 */
+static float tx_current(int8_t power)
+{
+  if(4   <= power) { return 7500.0f; }
+  if(0   <= power) { return 5300.0f; }
+  if(-4  <= power) { return 4200.0f; }
+  if(-8  <= power) { return 3800.0f; }
+  if(-12 <= power) { return 3500.0f; }
+  if(-16 <= power) { return 3200.0f; }
+  if(-20 <= power) { return 3000.0f; }
+  return 2700.0f;
+}
+
+/** LIS2DH12 supply current in uA, datasheet table 10. 8-bit resolution is low-power mode */
+static float lis2dh12_current(uint8_t rate, uint8_t resolution)
+{
+  static const float low_power[] = {0.5f, 2.0f, 3.0f,  4.0f,  6.0f, 10.0f, 18.0f, 36.0f};
+  static const float normal[]    = {0.5f, 2.0f, 4.0f,  6.0f, 11.0f, 20.0f, 38.0f, 73.0f};
+  uint8_t index = (rate >> 4) & 0x07;
+  return (8 == resolution) ? low_power[index] : normal[index];
+}
+
+float energy_bme280_measurement_time(uint8_t os_t, uint8_t os_p, uint8_t os_h)
+{
+  float t = 1.0f + 2.0f * os_to_samples(os_t);
+  if(os_p) { t += 2.0f * os_to_samples(os_p) + 0.5f; }
+  if(os_h) { t += 2.0f * os_to_samples(os_h) + 0.5f; }
+  return t;
+}
+
+float energy_bme280_measurement_time_max(uint8_t os_t, uint8_t os_p, uint8_t os_h)
+{
+  float t = 1.25f + 2.3f * os_to_samples(os_t);
+  if(os_p) { t += 2.3f * os_to_samples(os_p) + 0.575f; }
+  if(os_h) { t += 2.3f * os_to_samples(os_h) + 0.575f; }
+  return t;
+}
+
+/** Charge of one BME280 conversion in nC */
+static float bme280_conversion_charge(const energy_config_t* config, const energy_profile_t* profile)
+{
+  float charge = profile->bme280_startup_time * profile->bme280_t_current;
+  charge += 2.0f * os_to_samples(config->bme280_os_temperature) * profile->bme280_t_current;
+  if(config->bme280_os_pressure)
+  {
+    charge += (2.0f * os_to_samples(config->bme280_os_pressure) + 0.5f) * profile->bme280_p_current;
+  }
+  if(config->bme280_os_humidity)
+  {
+    charge += (2.0f * os_to_samples(config->bme280_os_humidity) + 0.5f) * profile->bme280_h_current;
+  }
+  return charge;
+}
+
+/** Charge of one advertising event on all 3 channels in nC */
+static float advertising_event_charge(const energy_config_t* config, const energy_profile_t* profile)
+{
+  float tx_time = (ADV_OVERHEAD_BYTES + config->advertising_data_length) * ADV_US_PER_BYTE / 1000.0f;
+  float charge = profile->adv_prepare_charge + profile->adv_post_charge;
+  charge += ADV_CHANNELS * profile->radio_ramp_time * profile->radio_ramp_current;
+  charge += ADV_CHANNELS * tx_time * tx_current(config->tx_power);
+  // ble_radio_notification interrupts before and after radio activity
+  charge += 2 * profile->radio_notification_time * profile->cpu_current;
+  return charge;
+}
+
+/** Linear congruential generator for advDelay, fixed seed keeps results reproducible */
+static uint32_t adv_delay_ms(uint32_t* seed)
+{
+  *seed = (*seed) * 1103515245u + 12345u;
+  return ((*seed) >> 16) % (ADV_MAX_DELAY_MS + 1);
+}
+
+int energy_model_run(const energy_config_t* config, const energy_profile_t* profile, uint64_t duration_ms, energy_result_t* result)
+{
+  if(NULL == config || NULL == profile || NULL == result) { return 1; }
+  if(0 == duration_ms || 0 == config->main_loop_interval || 0 == config->advertising_interval) { return 1; }
+
+  energy_result_t r = {0};
+  float t_meas = energy_bme280_measurement_time(config->bme280_os_temperature,
+                                                config->bme280_os_pressure,
+                                                config->bme280_os_humidity);
+  float q_adv  = advertising_event_charge(config, profile);
+  float q_bme  = bme280_conversion_charge(config, profile);
+  float q_loop = profile->main_loop_cpu_time * profile->cpu_current;
+  float q_batt = profile->saadc_time * profile->saadc_current + profile->battery_cpu_time * profile->cpu_current;
+  float bme_period = t_meas + standby_to_ms(config->bme280_standby);
+
+  // Charge accumulators in nC
+  double adv = 0, loop = 0, bme = 0, batt = 0;
+  double bme_active_ms = 0;
+
+  // Next event timestamps in ms
+  double next_adv  = 0;
+  double next_loop = config->main_loop_interval;
+  double next_bme  = 0;
+  double last_battery = 0;
+  uint32_t seed = 0x52554956;  // "RUUV"
+
+  while(next_adv < duration_ms || next_loop < duration_ms)
+  {
+    if(next_adv <= next_loop)
+    {
+      adv += q_adv;
+      r.advertising_events++;
+      // Battery is measured in radio notification after radio goes inactive
+      if(next_adv - last_battery >= config->battery_interval)
+      {
+        batt += q_batt;
+        last_battery = next_adv;
+        r.battery_measurements++;
+      }
+      next_adv += config->advertising_interval + adv_delay_ms(&seed);
+    }
+    else
+    {
+      loop += q_loop;
+      r.main_loop_events++;
+      if(config->bme280_enabled && config->bme280_forced)
+      {
+        bme += q_bme;
+        bme_active_ms += t_meas;
+        r.bme280_conversions++;
+      }
+      next_loop += config->main_loop_interval;
+    }
+  }
+
+  // Free-running normal mode conversions are independent of the firmware timeline
+  if(config->bme280_enabled && !config->bme280_forced)
+  {
+    while(next_bme < duration_ms)
+    {
+      bme += q_bme;
+      bme_active_ms += t_meas;
+      r.bme280_conversions++;
+      next_bme += bme_period;
+    }
+  }
+
+  double idle_ms = duration_ms - bme_active_ms;
+  if(idle_ms < 0) { idle_ms = 0; }
+  if(config->bme280_enabled)
+  {
+    float idle_current = config->bme280_forced ? profile->bme280_sleep_current : profile->bme280_standby_current;
+    bme += idle_ms * idle_current;
+  }
+
+  r.sleep       = profile->sleep_current + profile->nfc_sense_current;
+  r.advertising = adv  / duration_ms;
+  r.main_loop   = loop / duration_ms;
+  r.bme280      = bme  / duration_ms;
+  r.battery     = batt / duration_ms;
+  r.lis2dh12    = lis2dh12_current(config->lis2dh12_rate, config->lis2dh12_resolution);
+  r.total       = r.sleep + r.advertising + r.main_loop + r.bme280 + r.lis2dh12 + r.battery;
+
+  // Self discharge is modeled as an equivalent constant current
+  float usable_uah = profile->battery_capacity * profile->battery_usable_fraction * 1000.0f;
+  float self_discharge = profile->battery_capacity * 1000.0f * profile->battery_self_discharge / (365.0f * 24);
+  r.lifetime_days = usable_uah / (r.total + self_discharge) / 24.0f;
+
+  *result = r;
+  return 0;
+}
@@ -0,0 +1,99 @@
+#ifndef ENERGY_MODEL_H
+#define ENERGY_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ *  Host-side energy model of RuuviTag firmware.
+ *
+ *  The model walks through the firmware event timeline (advertising events, main loop
+ *  ticks, BME280 conversions, battery measurements) and integrates the charge drawn
+ *  by each event on top of the static sleep currents of the nRF52832 and the sensors.
+ *
+ *  All currents are in microamperes, all times in milliseconds, all charges in nanocoulombs
+ *  (uA * ms).
+ */
+
+/** Firmware configuration which is modeled, filled from application headers */
+typedef struct {
+  const char* name;               /**< Name of the tag mode, printed in report */
+  uint32_t main_loop_interval;    /**< ms, MAIN_LOOP_INTERVAL_* */
+  uint32_t advertising_interval;  /**< ms, ADVERTISING_INTERVAL_* */
+  uint8_t  advertising_data_length; /**< bytes of manufacturer specific data, RAWv*_DATA_LENGTH */
+  int8_t   tx_power;              /**< dBm, APP_TX_POWER */
+  uint32_t battery_interval;      /**< ms, APPLICATION_BATTERY_INTERVAL */
+  bool     bme280_enabled;        /**< false if BME280 is not populated */
+  bool     bme280_forced;         /**< true if BME280 is triggered once per main loop instead of normal mode */
+  uint8_t  bme280_os_temperature; /**< BME280_OVERSAMPLING_* register value */
+  uint8_t  bme280_os_pressure;    /**< BME280_OVERSAMPLING_* register value */
+  uint8_t  bme280_os_humidity;    /**< BME280_OVERSAMPLING_* register value */
+  uint8_t  bme280_standby;        /**< BME280_STANDBY_* register value, normal mode only */
+  uint8_t  lis2dh12_rate;         /**< LIS2DH12_RATE_* register value */
+  uint8_t  lis2dh12_resolution;   /**< LIS2DH12_RES* value */
+}energy_config_t;
+
+/** Hardware constants of the model, see energy_model.c for sources */
+typedef struct {
+  float sleep_current;            /**< uA, nRF52832 System ON, RTC running, RAM retained */
+  float nfc_sense_current;        /**< uA, NFCT in field sense mode */
+  float cpu_current;              /**< uA, CPU running from flash with DC/DC */
+  float radio_ramp_current;       /**< uA, radio ramp-up between channels */
+  float radio_ramp_time;          /**< ms, per channel */
+  float adv_prepare_charge;       /**< nC, HFXO start and SoftDevice pre-processing per advertising event */
+  float adv_post_charge;          /**< nC, SoftDevice post-processing per advertising event */
+  float radio_notification_time;  /**< ms of CPU time per radio notification interrupt */
+  float main_loop_cpu_time;       /**< ms of CPU time per main_sensor_task */
+  float saadc_current;            /**< uA, SAADC active */
+  float saadc_time;               /**< ms of SAADC activity per battery measurement */
+  float battery_cpu_time;         /**< ms of CPU time per battery measurement */
+  float bme280_sleep_current;     /**< uA */
+  float bme280_standby_current;   /**< uA */
+  float bme280_startup_time;      /**< ms, fixed part of measurement time */
+  float bme280_t_current;         /**< uA during temperature conversion */
+  float bme280_p_current;         /**< uA during pressure conversion */
+  float bme280_h_current;         /**< uA during humidity conversion */
+  float battery_capacity;         /**< mAh, nominal */
+  float battery_usable_fraction;  /**< Derating for cut-off voltage and temperature */
+  float battery_self_discharge;   /**< Fraction of capacity lost per year */
+}energy_profile_t;
+
+/** Result of simulation. Average currents are split per consumer. */
+typedef struct {
+  float sleep;          /**< uA, nRF52 + NFC sense floor */
+  float advertising;    /**< uA, radio events including SoftDevice processing */
+  float main_loop;      /**< uA, sensor task CPU time */
+  float bme280;         /**< uA, conversions + sleep/standby */
+  float lis2dh12;       /**< uA, sampling at configured rate */
+  float battery;        /**< uA, SAADC measurements */
+  float total;          /**< uA, sum of above */
+  float lifetime_days;  /**< Projected battery life */
+  uint32_t advertising_events;
+  uint32_t main_loop_events;
+  uint32_t bme280_conversions;
+  uint32_t battery_measurements;
+}energy_result_t;
+
+/** Default hardware profile: RuuviTag B with nRF52832, BME280, LIS2DH12 and CR2477 */
+extern const energy_profile_t energy_profile_ruuvitag_b;
+
+/**
+ *  BME280 typical measurement time in ms for given oversampling register values,
+ *  datasheet section 9.1. Oversampling value BME280_OVERSAMPLING_SKIP disables channel.
+ */
+float energy_bme280_measurement_time(uint8_t os_t, uint8_t os_p, uint8_t os_h);
+
+/**
+ *  BME280 maximum measurement time in ms, datasheet section 9.1.
+ */
+float energy_bme280_measurement_time_max(uint8_t os_t, uint8_t os_p, uint8_t os_h);
+
+/**
+ *  Simulate given configuration for duration_ms and store average currents to result.
+ *  Simulation is deterministic, advertising random delay uses a fixed seed.
+ *
+ *  @return 0 on success, non-zero if configuration is invalid
+ */
+int energy_model_run(const energy_config_t* config, const energy_profile_t* profile, uint64_t duration_ms, energy_result_t* result);
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ *  Energy model report and regression benchmark for ruuvi_firmware configuration.
+ *
+ *  Usage: energy_model [-d hours] [-w baseline] [-c baseline] [-t tolerance_percent]
+ *    -d  simulated duration, default 24 hours
+ *    -w  write current averages to baseline file
+ *    -c  compare against baseline file, exit with 1 if any mode draws more than tolerance above baseline
+ *    -t  tolerance for -c, default 1 %
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "application_config.h"
+#include "bluetooth_application_config.h"
+#include "energy_model.h"
+
+#ifndef BME280_FORCED_MODE
+  #define BME280_FORCED_MODE 0
+#endif
+
+#define MODE_COUNT 3
+#define NAME_MAX_LENGTH 32
+
+/** Tag modes of ruuvi_firmware main.c. These must match advertising_rates and advertising_sizes in main.c */
+static energy_config_t modes[MODE_COUNT] = {
+  { .name = "RAWv1",
+    .main_loop_interval      = MAIN_LOOP_INTERVAL_RAW,
+    .advertising_interval    = ADVERTISING_INTERVAL_RAW,
+    .advertising_data_length = RAWv1_DATA_LENGTH,
+    .lis2dh12_rate           = LIS2DH12_SAMPLERATE_RAWv1 },
+  { .name = "RAWv2_FAST",
+    .main_loop_interval      = MAIN_LOOP_INTERVAL_RAW,
+    .advertising_interval    = ADVERTISING_INTERVAL_RAW,
+    .advertising_data_length = RAWv2_DATA_LENGTH,
+    .lis2dh12_rate           = LIS2DH12_SAMPLERATE_RAWv2 },
+  { .name = "RAWv2_SLOW",
+    .main_loop_interval      = MAIN_LOOP_INTERVAL_RAW_SLOW,
+    .advertising_interval    = ADVERTISING_INTERVAL_RAW_SLOW,
+    .advertising_data_length = RAWv2_DATA_LENGTH,
+    .lis2dh12_rate           = LIS2DH12_SAMPLERATE_RAWv2 }
+};
+
+/** Fill settings which are common to all modes */
+static void apply_common_configuration(energy_config_t* config)
+{
+  config->tx_power              = APP_TX_POWER;
+  config->battery_interval      = APPLICATION_BATTERY_INTERVAL;
+  config->bme280_enabled        = true;
+  config->bme280_forced         = BME280_FORCED_MODE;
+  config->bme280_os_temperature = BME280_TEMPERATURE_OVERSAMPLING;
+  config->bme280_os_pressure    = BME280_PRESSURE_OVERSAMPLING;
+  config->bme280_os_humidity    = BME280_HUMIDITY_OVERSAMPLING;
+  config->bme280_standby        = BME280_DELAY;
+  config->lis2dh12_resolution   = LIS2DH12_RESOLUTION;
+}
+
+static void print_report(const energy_config_t* config, const energy_result_t* r)
+{
+  printf("%-11s %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f | %7.2f uA %7.0f d %5.2f y\n",
+         config->name, r->sleep, r->advertising, r->main_loop, r->bme280, r->lis2dh12, r->battery,
+         r->total, r->lifetime_days, r->lifetime_days / 365.0f);
+}
+
+/** Write "<mode> <average uA>" lines */
+static int write_baseline(const char* path, const energy_result_t* results)
+{
+  FILE* f = fopen(path, "w");
+  if(NULL == f) { perror(path); return 1; }
+  for(int ii = 0; ii < MODE_COUNT; ii++)
+  {
+    fprintf(f, "%s %.3f\n", modes[ii].name, results[ii].total);
+  }
+  fclose(f);
+  return 0;
+}
+
+/** Return 1 if any mode in baseline is exceeded by more than tolerance percent */
+static int check_baseline(const char* path, const energy_result_t* results, float tolerance)
+{
+  FILE* f = fopen(path, "r");
+  if(NULL == f) { perror(path); return 1; }
+  char name[NAME_MAX_LENGTH];
+  float baseline;
+  int status = 0;
+  while(2 == fscanf(f, "%31s %f", name, &baseline))
+  {
+    for(int ii = 0; ii < MODE_COUNT; ii++)
+    {
+      if(strcmp(name, modes[ii].name)) { continue; }
+      float change = 100.0f * (results[ii].total - baseline) / baseline;
+      bool fail = change > tolerance;
+      printf("%-11s baseline %7.2f uA, now %7.2f uA, %+6.2f %% %s\n",
+             name, baseline, results[ii].total, change, fail ? "FAIL" : "ok");
+      if(fail) { status = 1; }
+    }
+  }
+  fclose(f);
+  return status;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t hours = 24;
+  const char* write_path = NULL;
+  const char* check_path = NULL;
+  float tolerance = 1.0f;
+  int opt;
+  while(-1 != (opt = getopt(argc, argv, "d:w:c:t:")))
+  {
+    switch(opt)
+    {
+      case 'd': hours = strtoul(optarg, NULL, 10); break;
+      case 'w': write_path = optarg; break;
+      case 'c': check_path = optarg; break;
+      case 't': tolerance = strtof(optarg, NULL); break;
+      default:
+        fprintf(stderr, "Usage: %s [-d hours] [-w baseline] [-c baseline] [-t tolerance_percent]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  energy_result_t results[MODE_COUNT];
+  printf("Simulated %u h, APP_TX_POWER %d dBm, BME280 os T/P/H %d/%d/%d, t_meas %.2f ms (max %.2f ms)\n",
+         hours, APP_TX_POWER,
+         BME280_TEMPERATURE_OVERSAMPLING, BME280_PRESSURE_OVERSAMPLING, BME280_HUMIDITY_OVERSAMPLING,
+         energy_bme280_measurement_time(BME280_TEMPERATURE_OVERSAMPLING, BME280_PRESSURE_OVERSAMPLING, BME280_HUMIDITY_OVERSAMPLING),
+         energy_bme280_measurement_time_max(BME280_TEMPERATURE_OVERSAMPLING, BME280_PRESSURE_OVERSAMPLING, BME280_HUMIDITY_OVERSAMPLING));
+  printf("%-11s %7s %7s %7s %7s %7s %7s | %10s %9s %7s\n",
+         "mode", "sleep", "adv", "loop", "bme280", "lis2dh", "vbat", "total", "CR2477", "");
+  for(int ii = 0; ii < MODE_COUNT; ii++)
+  {
+    apply_common_configuration(&modes[ii]);
+    if(energy_model_run(&modes[ii], &energy_profile_ruuvitag_b, (uint64_t)hours * 3600 * 1000, &results[ii]))
+    {
+      fprintf(stderr, "Invalid configuration for %s\n", modes[ii].name);
+      return 2;
+    }
+    print_report(&modes[ii], &results[ii]);
+  }
+
+  if(write_path && write_baseline(write_path, results)) { return 2; }
+  if(check_path)  { return check_baseline(check_path, results, tolerance); }
+  return 0;
+}
@@ -0,0 +1,278 @@
+#include "lis2dh12_emulator.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "lis2dh12_registers.h"
+#include "spi.h"
+
+#define SPI_READ    0x80U
+#define SPI_ADR_INC 0x40U
+#define ADR_MASK    0x3FU
+#define WHO_AM_I    0x33U
+
+/** High-pass at largest cutoff, ODR/50 */
+#define HP_COEFFICIENT (2 * M_PI / 50)
+
+typedef enum {
+  CLICK_IDLE,
+  CLICK_ABOVE,     // First tap above threshold
+  CLICK_LATENCY,   // Dead time after first tap
+  CLICK_WINDOW,    // Waiting for second tap
+  CLICK_ABOVE_2    // Second tap above threshold
+}click_state_t;
+
+typedef struct {
+  uint8_t  cfg_reg;
+  uint8_t  ths_reg;
+  uint8_t  duration_reg;
+  uint8_t  source_reg;
+  uint8_t  hp_mask;     // CTRL_REG2
+  uint8_t  lir_mask;    // CTRL_REG5
+  uint32_t held;        // Samples condition has held
+  uint8_t  position;    // Latest recognized 6D position, source bits
+  uint8_t  candidate;   // 6D position of latest sample
+  bool     active;      // Unlatched IA of latest sample
+}generator_t;
+
+static uint8_t regs[ADR_MASK + 1];
+static double lp[3];
+static bool lp_valid = false;
+static uint32_t transfers = 0;
+static generator_t generators[2];
+static click_state_t click_state = CLICK_IDLE;
+static uint32_t click_count = 0;
+static uint8_t click_axis = 0;
+static bool click_active = false;       // Unlatched IA of latest sample
+
+void lis2dh12_emulator_reset(void)
+{
+  memset(regs, 0, sizeof(regs));
+  regs[0x0F] = WHO_AM_I;
+  regs[LIS2DH12_CTRL_REG1] = 0x07;
+  generator_t g1 = { LIS2DH12_INT1_CFG, LIS2DH12_INT1_THS, LIS2DH12_INT1_DURATION, LIS2DH12_INT1_SOURCE,
+                     LIS2DH12_HPIS1_MASK, LIS2DH12_LIR_INT1_MASK, 0, 0, 0, false };
+  generator_t g2 = { LIS2DH12_INT2_CFG, LIS2DH12_INT2_THS, LIS2DH12_INT2_DURATION, LIS2DH12_INT2_SOURCE,
+                     LIS2DH12_HPIS2_MASK, LIS2DH12_LIR_INT2_MASK, 0, 0, 0, false };
+  generators[0] = g1;
+  generators[1] = g2;
+  lp_valid = false;
+  transfers = 0;
+  click_state = CLICK_IDLE;
+  click_active = false;
+}
+
+static double full_scale_mg(void)
+{
+  return 2000 << ((regs[LIS2DH12_CTRL_REG4] & LIS2DH12_FS_MASK) >> 4);
+}
+
+static double threshold_mg(uint8_t reg)
+{
+  return (reg & 0x7F) * full_scale_mg() / 128;
+}
+
+/** Source bit of high or low event of axis, X first */
+static uint8_t axis_bit(uint8_t axis, bool high)
+{
+  return (1 << (2 * axis)) << (high ? 1 : 0);
+}
+
+static void generator_step(generator_t* p_g, const double raw[3], const double hp[3])
+{
+  uint8_t cfg = regs[p_g->cfg_reg];
+  const double* a = (regs[LIS2DH12_CTRL_REG2] & p_g->hp_mask) ? hp : raw;
+  double ths = threshold_mg(regs[p_g->ths_reg]);
+  bool latch = regs[LIS2DH12_CTRL_REG5] & p_g->lir_mask;
+  bool condition = false;
+  uint8_t bits = 0;
+  p_g->active = false;
+  if(0 == (cfg & 0x3F)) { return; }
+
+  if(cfg & LIS2DH12_6D_MASK)
+  {
+    // Position is known when exactly one axis is beyond threshold
+    uint8_t above = 0;
+    for(uint8_t axis = 0; axis < 3; axis++)
+    {
+      if(fabs(a[axis]) > ths)
+      {
+        above++;
+        bits = axis_bit(axis, a[axis] > 0);
+      }
+    }
+    if(1 != above) { bits = 0; }
+    if(cfg & LIS2DH12_AOI_MASK) { condition = (0 != bits); }
+    else
+    {
+      // Movement: new position must hold for duration, then it is recognized once
+      if(bits != p_g->candidate) { p_g->held = 0; }
+      p_g->candidate = bits;
+      condition = (0 != bits && bits != p_g->position);
+      if(condition && p_g->held + 1 > regs[p_g->duration_reg]) { p_g->position = bits; }
+    }
+  }
+  else
+  {
+    bool and = (cfg & LIS2DH12_AOI_MASK);
+    condition = and;
+    for(uint8_t axis = 0; axis < 3; axis++)
+    {
+      for(uint8_t high = 0; high < 2; high++)
+      {
+        if(!(cfg & axis_bit(axis, high))) { continue; }
+        bool event = high ? (fabs(a[axis]) > ths) : (fabs(a[axis]) < ths);
+        if(event) { bits |= axis_bit(axis, high); }
+        condition = and ? (condition && event) : (condition || event);
+      }
+    }
+  }
+
+  p_g->held = condition ? p_g->held + 1 : 0;
+  if(!condition || p_g->held <= regs[p_g->duration_reg]) { return; }
+  p_g->active = true;
+  uint8_t source = LIS2DH12_INT_IA_MASK | bits;
+  regs[p_g->source_reg] = latch ? (regs[p_g->source_reg] | source) : source;
+}
+
+static bool click_enabled_above(const double a[3], double ths, bool store)
+{
+  uint8_t cfg = regs[LIS2DH12_CLICK_CFG];
+  for(uint8_t axis = 0; axis < 3; axis++)
+  {
+    // Single and double bits of axis
+    if(!(cfg & (0x03 << (2 * axis))) || fabs(a[axis]) <= ths) { continue; }
+    if(store) { click_axis = (1 << axis) | ((a[axis] < 0) ? LIS2DH12_SIGN_MASK : 0); }
+    return true;
+  }
+  return false;
+}
+
+static void click_report(uint8_t kind)
+{
+  uint8_t source = LIS2DH12_CLK_IA_MASK | kind | click_axis;
+  bool latch = regs[LIS2DH12_CLICK_THS] & LIS2DH12_LIR_CLICK_MASK;
+  regs[LIS2DH12_CLICK_SRC] = latch ? (regs[LIS2DH12_CLICK_SRC] | source) : source;
+  click_active = true;
+}
+
+static void click_step(const double raw[3], const double hp[3])
+{
+  const double* a = (regs[LIS2DH12_CTRL_REG2] & LIS2DH12_HPCLICK_MASK) ? hp : raw;
+  uint8_t cfg = regs[LIS2DH12_CLICK_CFG];
+  bool singles = cfg & (LIS2DH12_XS_MASK | LIS2DH12_YS_MASK | LIS2DH12_ZS_MASK);
+  bool doubles = cfg & (LIS2DH12_XD_MASK | LIS2DH12_YD_MASK | LIS2DH12_ZD_MASK);
+  double ths = threshold_mg(regs[LIS2DH12_CLICK_THS]);
+  uint8_t limit = regs[LIS2DH12_TIME_LIMIT] & LIS2DH12_TLI_MASK;
+  click_active = false;
+  if(!singles && !doubles)
+  {
+    click_state = CLICK_IDLE;
+    return;
+  }
+  click_count++;
+  switch(click_state)
+  {
+    case CLICK_IDLE:
+      if(click_enabled_above(a, ths, true)) { click_state = CLICK_ABOVE; click_count = 0; }
+      break;
+
+    case CLICK_ABOVE:
+    case CLICK_ABOVE_2:
+      if(click_enabled_above(a, ths, false)) { break; }
+      // Tap is over, it is a tap only if it was short
+      if(click_count > limit) { click_state = CLICK_IDLE; break; }
+      if(CLICK_ABOVE_2 == click_state)
+      {
+        click_report(LIS2DH12_DCLICK_MASK);
+        click_state = CLICK_IDLE;
+        break;
+      }
+      if(singles) { click_report(LIS2DH12_SCLICK_MASK); }
+      click_state = doubles ? CLICK_LATENCY : CLICK_IDLE;
+      click_count = 0;
+      break;
+
+    case CLICK_LATENCY:
+      if(click_count >= regs[LIS2DH12_TIME_LATENCY]) { click_state = CLICK_WINDOW; click_count = 0; }
+      break;
+
+    case CLICK_WINDOW:
+      if(click_enabled_above(a, ths, true)) { click_state = CLICK_ABOVE_2; click_count = 0; }
+      else if(click_count > regs[LIS2DH12_TIME_WINDOW]) { click_state = CLICK_IDLE; }
+      break;
+  }
+}
+
+void lis2dh12_emulator_sample(double x, double y, double z)
+{
+  double raw[3] = { x, y, z };
+  double hp[3];
+  if(!lp_valid) { memcpy(lp, raw, sizeof(lp)); lp_valid = true; }
+  for(uint8_t axis = 0; axis < 3; axis++)
+  {
+    lp[axis] += (raw[axis] - lp[axis]) * HP_COEFFICIENT;
+    hp[axis] = raw[axis] - lp[axis];
+  }
+  generator_step(&generators[0], raw, hp);
+  generator_step(&generators[1], raw, hp);
+  click_step(raw, hp);
+}
+
+/** Latched IA holds until source is read, unlatched IA follows latest sample */
+static bool ia_level(uint8_t source_reg, bool latched, bool active)
+{
+  return latched ? (regs[source_reg] & LIS2DH12_INT_IA_MASK) : active;
+}
+
+bool lis2dh12_emulator_pin(uint8_t pin)
+{
+  bool click = ia_level(LIS2DH12_CLICK_SRC, regs[LIS2DH12_CLICK_THS] & LIS2DH12_LIR_CLICK_MASK, click_active);
+  bool ia1 = ia_level(LIS2DH12_INT1_SOURCE, regs[LIS2DH12_CTRL_REG5] & LIS2DH12_LIR_INT1_MASK, generators[0].active);
+  bool ia2 = ia_level(LIS2DH12_INT2_SOURCE, regs[LIS2DH12_CTRL_REG5] & LIS2DH12_LIR_INT2_MASK, generators[1].active);
+  uint8_t route = (1 == pin) ? regs[LIS2DH12_CTRL_REG3] : regs[LIS2DH12_CTRL_REG6];
+  // Bits of click, IA1 and IA2 are in the same place on both pins
+  return ((route & LIS2DH12_I1_CLICK) && click) ||
+         ((route & LIS2DH12_I1_IA1) && ia1) ||
+         ((route & LIS2DH12_I1_IA2) && ia2);
+}
+
+uint8_t lis2dh12_emulator_register(uint8_t address)
+{
+  return regs[address & ADR_MASK];
+}
+
+uint32_t lis2dh12_emulator_transfers(void)
+{
+  return transfers;
+}
+
+/** Reading a source register clears its latch */
+static uint8_t register_read(uint8_t address)
+{
+  uint8_t value = regs[address];
+  if(LIS2DH12_CLICK_SRC == address || LIS2DH12_INT1_SOURCE == address || LIS2DH12_INT2_SOURCE == address)
+  {
+    regs[address] = 0;
+  }
+  return value;
+}
+
+void spi_init(void) { }
+
+bool spi_isInitialized(void) { return true; }
+
+SPI_Ret spi_transfer_lis2dh12(uint8_t* const p_toWrite, uint8_t count, uint8_t* const p_toRead)
+{
+  if(NULL == p_toWrite || NULL == p_toRead || 0 == count) { return SPI_RET_ERROR; }
+  transfers++;
+  uint8_t address = p_toWrite[0] & ADR_MASK;
+  bool read = p_toWrite[0] & SPI_READ;
+  for(uint8_t ii = 1; ii < count; ii++)
+  {
+    if(read) { p_toRead[ii] = register_read(address); }
+    else     { regs[address] = p_toWrite[ii]; }
+    if(p_toWrite[0] & SPI_ADR_INC) { address = (address + 1) & ADR_MASK; }
+  }
+  return SPI_RET_OK;
+}
@@ -0,0 +1,33 @@
+#ifndef LIS2DH12_EMULATOR_H
+#define LIS2DH12_EMULATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ *  Register level model of LIS2DH12 embedded functions behind spi_transfer_lis2dh12,
+ *  so that the real driver configures it over emulated SPI.
+ *
+ *  Models click with time limit, latency and window, interrupt generators with
+ *  AND/OR of high/low events, 6D movement recognition, duration, latching and
+ *  clear on read of source registers, high-pass filtering of click and interrupt
+ *  generators and routing of functions to interrupt pins. Thresholds follow
+ *  full scale of CTRL_REG4. Filter and recognition details are simplified.
+ */
+
+/** Power-on registers */
+void lis2dh12_emulator_reset(void);
+
+/** Feed one sample in mg at output data rate */
+void lis2dh12_emulator_sample(double x, double y, double z);
+
+/** Level of interrupt pin 1 or 2 */
+bool lis2dh12_emulator_pin(uint8_t pin);
+
+/** Register value without side effects of SPI read */
+uint8_t lis2dh12_emulator_register(uint8_t address);
+
+/** Number of SPI transfers since reset */
+uint32_t lis2dh12_emulator_transfers(void);
+
+#endif
@@ -0,0 +1,319 @@
+/**
+ *  Host test of drivers/lis2dh12/lis2dh12_gesture.c against a register level LIS2DH12.
+ *
+ *  Real LIS2DH12 driver and gesture engine configure lis2dh12_emulator over emulated
+ *  SPI. Synthetic acceleration of handling a tag is fed at 100 Hz, rising edges of
+ *  interrupt pins call the handlers of the engine as GPIOTE would and scheduler runs
+ *  after a configurable latency in samples, as MCU wakes up from sleep.
+ *
+ *  Checks:
+ *   - registers of enabled functions, activity of generator 2 is kept without free-fall
+ *   - tap, double tap, orientation changes and free-fall are each published once, in
+ *     order and soon after they happen, handling and vibration publish nothing
+ *   - tap and orientation change latched in the same wakeup are both published
+ *   - latched sources are cleared, pins are low after events are handled
+ *   - events survive long scheduler latency
+ *
+ *  Prints MCU wakeups and SPI transfers compared to polling the accelerometer at 10 Hz.
+ *
+ *  Usage: gesture_events [-v]
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "app_scheduler_host.h"
+#include "lis2dh12.h"
+#include "lis2dh12_emulator.h"
+#include "lis2dh12_gesture.h"
+#include "nrf_error.h"
+#include "scheduler.h"
+
+#define SAMPLE_RATE_HZ   100
+#define POLLING_HZ       10
+#define MAX_EVENTS       32
+#define EVENT_WINDOW     20      // Samples from cause to published event at 1 sample latency
+
+typedef struct {
+  lis2dh12_gesture_type_t type;
+  uint8_t  detail;               // Face for orientation, 0 to ignore
+  uint32_t sample;               // Cause of event
+}expected_t;
+
+typedef struct {
+  lis2dh12_gesture_event_t event;
+  uint32_t sample;
+}published_t;
+
+static const lis2dh12_gesture_config_t config = {
+  .gestures                 = LIS2DH12_GESTURE_ENABLE_TAP | LIS2DH12_GESTURE_ENABLE_DOUBLE_TAP |
+                              LIS2DH12_GESTURE_ENABLE_ORIENTATION | LIS2DH12_GESTURE_ENABLE_FREEFALL,
+  .sample_rate              = LIS2DH12_RATE_100,
+  .tap_threshold_mg         = 1000,
+  .tap_timelimit_ms         = 100,
+  .tap_latency_ms           = 100,
+  .tap_window_ms            = 400,
+  .orientation_threshold_mg = 800,
+  .orientation_duration_ms  = 100,
+  .freefall_threshold_mg    = 350,
+  .freefall_duration_ms     = 30
+};
+
+/** Script of handling, in samples */
+#define T_TAP          500
+#define T_DOUBLE_TAP   1000
+#define DOUBLE_GAP     25
+#define T_TO_X_UP      1500
+#define T_TO_Z_DOWN    2000
+#define T_FALL         2500
+#define FALL_SAMPLES   40
+#define T_VIBRATION    3000
+#define VIBRATION_END  4000
+#define T_FLIP         4100
+#define T_END          4500
+
+static const expected_t expected[] = {
+  { LIS2DH12_GESTURE_ORIENTATION, LIS2DH12_FACE_Z_UP,   0 },
+  { LIS2DH12_GESTURE_TAP,         0,                    T_TAP },
+  { LIS2DH12_GESTURE_TAP,         0,                    T_DOUBLE_TAP },
+  { LIS2DH12_GESTURE_DOUBLE_TAP,  0,                    T_DOUBLE_TAP + DOUBLE_GAP },
+  { LIS2DH12_GESTURE_ORIENTATION, LIS2DH12_FACE_X_UP,   T_TO_X_UP + 50 },
+  { LIS2DH12_GESTURE_ORIENTATION, LIS2DH12_FACE_Z_DOWN, T_TO_Z_DOWN + 50 },
+  { LIS2DH12_GESTURE_FREEFALL,    0,                    T_FALL },
+  { LIS2DH12_GESTURE_TAP,         0,                    T_FLIP + 10 },
+  { LIS2DH12_GESTURE_ORIENTATION, LIS2DH12_FACE_Y_UP,   T_FLIP + 10 }
+};
+#define EXPECTED_COUNT (sizeof(expected) / sizeof(expected[0]))
+
+static bool        verbose;
+static uint32_t    failures;
+static uint32_t    sample;
+static published_t published[MAX_EVENTS];
+static uint32_t    published_count;
+static uint32_t    wakeups;
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if(!(condition))                                                       \
+    {                                                                      \
+      printf("FAIL %s:%d: %s\n", __func__, __LINE__, #condition);          \
+      failures++;                                                          \
+    }                                                                      \
+  } while(0)
+
+static void gesture_handler(const lis2dh12_gesture_event_t* p_event, const lis2dh12_gesture_counters_t* p_counters)
+{
+  if(verbose) { printf("  %5u: event %d detail 0x%02x\n", sample, p_event->type, p_event->detail); }
+  if(published_count < MAX_EVENTS)
+  {
+    published[published_count].event = *p_event;
+    published[published_count].sample = sample;
+  }
+  published_count++;
+}
+
+/** Orientation of Z up rotated around Y by angle, then around X */
+static void attitude(double angle_y, double angle_x, double a[3])
+{
+  a[0] = 1000 * sin(angle_y);
+  a[1] = -1000 * cos(angle_y) * sin(angle_x);
+  a[2] = 1000 * cos(angle_y) * cos(angle_x);
+}
+
+static double ramp(uint32_t start, uint32_t length)
+{
+  if(sample < start) { return 0; }
+  if(sample >= start + length) { return 1; }
+  return (double)(sample - start) / length;
+}
+
+/** Acceleration of scripted handling at current sample, mg */
+static void handling(double a[3])
+{
+  double angle_y = M_PI / 2 * ramp(T_TO_X_UP, 100) + M_PI / 2 * ramp(T_TO_Z_DOWN, 100);
+  double angle_x = 0;
+  if(sample >= T_FLIP)
+  {
+    // Quick flip from Z down to Y up
+    angle_y = 0;
+    angle_x = M_PI + M_PI / 2 * ramp(T_FLIP, 8);
+  }
+  attitude(angle_y, angle_x, a);
+
+  if(sample >= T_FALL && sample < T_FALL + FALL_SAMPLES) { a[0] = a[1] = a[2] = 0; }
+  // Caught softly, back to Z down
+  if(sample >= T_FALL + FALL_SAMPLES && sample < T_FALL + FALL_SAMPLES + 30)
+  {
+    for(uint8_t axis = 0; axis < 3; axis++) { a[axis] *= ramp(T_FALL + FALL_SAMPLES, 30); }
+  }
+  if(sample >= T_VIBRATION && sample < VIBRATION_END)
+  {
+    a[0] += 300 * sin(2 * M_PI * 3 * (sample - T_VIBRATION) / SAMPLE_RATE_HZ);
+  }
+
+  // Taps are short knocks on Z, last one on Y after flip
+  if(sample == T_TAP || sample == T_DOUBLE_TAP || sample == T_DOUBLE_TAP + DOUBLE_GAP) { a[2] -= 1800; }
+  if(sample == T_FLIP + 10) { a[1] += 1800; }
+
+  for(uint8_t axis = 0; axis < 3; axis++) { a[axis] += (rand() % 17) - 8; }
+}
+
+/** Feed samples, call handlers on rising edges and run scheduler every latency samples */
+static void run(uint32_t samples, uint32_t latency)
+{
+  bool pin_1 = lis2dh12_emulator_pin(1);
+  bool pin_2 = lis2dh12_emulator_pin(2);
+  ruuvi_standard_message_t message = { 0 };
+  bool pending = false;
+  for(uint32_t ii = 0; ii < samples; ii++, sample++)
+  {
+    double a[3];
+    handling(a);
+    lis2dh12_emulator_sample(a[0], a[1], a[2]);
+    if(!pin_1 && lis2dh12_emulator_pin(1)) { lis2dh12_gesture_int1_handler(message); pending = true; }
+    if(!pin_2 && lis2dh12_emulator_pin(2)) { lis2dh12_gesture_int2_handler(message); pending = true; }
+    pin_1 = lis2dh12_emulator_pin(1);
+    pin_2 = lis2dh12_emulator_pin(2);
+    if(pending && 0 == (sample % latency))
+    {
+      wakeups++;
+      scheduler_execute();
+      pending = false;
+      pin_1 = lis2dh12_emulator_pin(1);
+      pin_2 = lis2dh12_emulator_pin(2);
+    }
+  }
+}
+
+static void reset(void)
+{
+  app_sched_host_init(SCHEDULER_MAX_EVENT_DATA_SIZE, 16);
+  scheduler_priority_init(NULL);
+  lis2dh12_emulator_reset();
+  lis2dh12_reset();
+  lis2dh12_enable();
+  lis2dh12_set_scale(LIS2DH12_SCALE2G);
+  lis2dh12_set_resolution(LIS2DH12_RES10BIT);
+  lis2dh12_set_sample_rate(LIS2DH12_RATE_1);
+  srand(1);
+  sample = 0;
+  published_count = 0;
+  wakeups = 0;
+}
+
+/** Match published events to script in order, return number of mismatches */
+static uint32_t match_script(uint32_t window)
+{
+  uint32_t mismatches = 0;
+  if(EXPECTED_COUNT != published_count)
+  {
+    printf("  %u events published, %u expected\n", published_count, (unsigned)EXPECTED_COUNT);
+    mismatches++;
+  }
+  for(uint32_t ii = 0; ii < EXPECTED_COUNT && ii < published_count && ii < MAX_EVENTS; ii++)
+  {
+    const expected_t* p_expected = &expected[ii];
+    const published_t* p_published = &published[ii];
+    // Orientation is recognized during rotation, before its scripted end
+    uint32_t earliest = (LIS2DH12_GESTURE_ORIENTATION == p_expected->type && p_expected->sample >= 50) ?
+                        p_expected->sample - 50 : p_expected->sample;
+    if(p_expected->type != p_published->event.type ||
+       (p_expected->detail && p_expected->detail != p_published->event.detail) ||
+       p_published->sample < earliest || p_published->sample > p_expected->sample + window)
+    {
+      printf("  event %u: type %d detail %d at %u, expected type %d detail %d at %u\n", ii,
+             p_published->event.type, p_published->event.detail, p_published->sample,
+             p_expected->type, p_expected->detail, p_expected->sample);
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
+
+static void test_registers(void)
+{
+  reset();
+  // Activity of generator 2, as firmware configures it without free-fall
+  lis2dh12_set_activity_interrupt_pin_2(64);
+  lis2dh12_gesture_config_t no_freefall = config;
+  no_freefall.gestures &= ~LIS2DH12_GESTURE_ENABLE_FREEFALL;
+  uint8_t int2_cfg = lis2dh12_emulator_register(LIS2DH12_INT2_CFG);
+  uint8_t int2_ths = lis2dh12_emulator_register(LIS2DH12_INT2_THS);
+  CHECK(LIS2DH12_RET_OK == lis2dh12_gesture_init(&no_freefall, NULL));
+  CHECK(int2_cfg == lis2dh12_emulator_register(LIS2DH12_INT2_CFG));
+  CHECK(int2_ths == lis2dh12_emulator_register(LIS2DH12_INT2_THS));
+  CHECK(LIS2DH12_I2C_INT2_MASK == lis2dh12_emulator_register(LIS2DH12_CTRL_REG6));
+  CHECK(lis2dh12_emulator_register(LIS2DH12_CTRL_REG2) & LIS2DH12_HPIS2_MASK);
+
+  reset();
+  lis2dh12_set_activity_interrupt_pin_2(64);
+  CHECK(LIS2DH12_RET_OK == lis2dh12_gesture_init(&config, NULL));
+  uint8_t ctrl2 = lis2dh12_emulator_register(LIS2DH12_CTRL_REG2);
+  CHECK(LIS2DH12_RATE_100 == (lis2dh12_emulator_register(LIS2DH12_CTRL_REG1) & LIS2DH12_ODR_MASK));
+  CHECK(!(ctrl2 & (LIS2DH12_HPIS1_MASK | LIS2DH12_HPIS2_MASK)));
+  CHECK(ctrl2 & LIS2DH12_HPCLICK_MASK);
+  CHECK((LIS2DH12_I1_CLICK | LIS2DH12_I1_IA1) == lis2dh12_emulator_register(LIS2DH12_CTRL_REG3));
+  CHECK(LIS2DH12_LIR_INT1_MASK == (lis2dh12_emulator_register(LIS2DH12_CTRL_REG5) & 0x0F));
+  CHECK(LIS2DH12_I2C_INT2_MASK == lis2dh12_emulator_register(LIS2DH12_CTRL_REG6));
+  CHECK(0x3F == lis2dh12_emulator_register(LIS2DH12_CLICK_CFG));
+  CHECK((LIS2DH12_LIR_CLICK_MASK | 64) == lis2dh12_emulator_register(LIS2DH12_CLICK_THS));
+  CHECK(51 == lis2dh12_emulator_register(LIS2DH12_INT1_THS));
+  CHECK(10 == lis2dh12_emulator_register(LIS2DH12_INT1_DURATION));
+  CHECK(22 == lis2dh12_emulator_register(LIS2DH12_INT2_THS));
+  CHECK(3 == lis2dh12_emulator_register(LIS2DH12_INT2_DURATION));
+  CHECK((LIS2DH12_AOI_MASK | LIS2DH12_XLIE_MASK | LIS2DH12_YLIE_MASK | LIS2DH12_ZLIE_MASK) ==
+        lis2dh12_emulator_register(LIS2DH12_INT2_CFG));
+}
+
+static void test_handling(uint32_t latency, bool report)
+{
+  reset();
+  CHECK(LIS2DH12_RET_OK == lis2dh12_gesture_init(&config, gesture_handler));
+  uint32_t transfers = lis2dh12_emulator_transfers();
+  run(T_END, latency);
+  transfers = lis2dh12_emulator_transfers() - transfers;
+  CHECK(0 == match_script(EVENT_WINDOW + latency));
+
+  lis2dh12_gesture_counters_t counters = lis2dh12_gesture_counters();
+  CHECK(3 == counters.taps);
+  CHECK(1 == counters.double_taps);
+  CHECK(4 == counters.orientation_changes);
+  CHECK(1 == counters.freefalls);
+  CHECK(EXPECTED_COUNT == counters.sequence);
+  CHECK(LIS2DH12_FACE_Y_UP == counters.face);
+  CHECK(!lis2dh12_emulator_pin(1));
+  CHECK(!lis2dh12_emulator_pin(2));
+
+  if(!report) { return; }
+  // Polling reads FIFO count and latest sample, 2 transfers
+  uint32_t polls = T_END * POLLING_HZ / SAMPLE_RATE_HZ;
+  printf("%u s of handling: %u events, %u wakeups and %u SPI transfers vs %u wakeups and %u transfers polling at %d Hz\n",
+         T_END / SAMPLE_RATE_HZ, published_count, wakeups, transfers, polls, 2 * polls, POLLING_HZ);
+}
+
+int main(int argc, char** argv)
+{
+  int opt;
+  while((opt = getopt(argc, argv, "v")) != -1)
+  {
+    if('v' == opt) { verbose = true; }
+    else
+    {
+      fprintf(stderr, "Usage: %s [-v]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  test_registers();
+  if(verbose) { printf("Wakeup every sample:\n"); }
+  test_handling(1, true);
+  // 300 ms, latched sources must hold events until read
+  if(verbose) { printf("Wakeup every 30 samples:\n"); }
+  test_handling(30, false);
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+/**
+ *  Host test of CAPABILITY_QUERY of sensor endpoints.
+ *
+ *  Queries drivers/sensor/sensor_endpoint.c with the BME280 and LIS2DH12 adapters.
+ *  BME280 runs against the register level emulator of tools/bme280_benchmark,
+ *  LIS2DH12 against a plain register file. Replies are collected from the reply
+ *  handler of ruuvi_endpoints.
+ *
+ *  Checks:
+ *   - option lists, rounded proposal and estimated current of both sensors
+ *   - queries do not touch the sensors
+ *   - proposals the sensor cannot apply are answered with ERROR
+ *   - BME280 resolution selects temperature oversampling when configured
+ *   - estimate of current settings matches current_na() of the adapters
+ *   - a client can pick the cheapest configuration which meets its needs from replies
+ *
+ *  Usage: power_query [-v]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bme280.h"
+#include "bme280_emulator.h"
+#include "bme280_sensor.h"
+#include "init.h"
+#include "lis2dh12.h"
+#include "lis2dh12_sensor.h"
+#include "nrf_error.h"
+#include "ruuvi_endpoints.h"
+#include "sensor.h"
+#include "sensor_endpoint.h"
+#include "spi.h"
+
+#define REPLIES_MAX 8
+
+static ruuvi_standard_message_t replies[REPLIES_MAX];
+static uint8_t  reply_count;
+static uint8_t  lis_registers[0x40];
+static uint32_t lis_transfers;
+static bool     verbose;
+static uint32_t failures;
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if(!(condition))                                                       \
+    {                                                                      \
+      printf("FAIL %s:%d: %s\n", __func__, __LINE__, #condition);          \
+      failures++;                                                          \
+    }                                                                      \
+  } while(0)
+
+init_err_code_t init_bme280(void) { return INIT_SUCCESS; }
+init_err_code_t init_bme280_calibrated(void) { return INIT_SUCCESS; }
+init_err_code_t init_lis2dh12(void) { return INIT_SUCCESS; }
+
+/** Register file of LIS2DH12, address auto increment as the sensor does */
+SPI_Ret spi_transfer_lis2dh12(uint8_t* const p_toWrite, uint8_t count, uint8_t* const p_toRead)
+{
+  if(NULL == p_toWrite || NULL == p_toRead || 0 == count) { return SPI_RET_ERROR; }
+  lis_transfers++;
+  uint8_t address = p_toWrite[0] & 0x3F;
+  for(uint8_t ii = 1; ii < count; ii++)
+  {
+    if(p_toWrite[0] & 0x80) { p_toRead[ii] = lis_registers[address]; }
+    else                    { lis_registers[address] = p_toWrite[ii]; }
+    if(p_toWrite[0] & 0x40) { address = (address + 1) & 0x3F; }
+  }
+  return SPI_RET_OK;
+}
+
+static ret_code_t collect(const ruuvi_standard_message_t message)
+{
+  if(REPLIES_MAX > reply_count) { replies[reply_count++] = message; }
+  if(verbose)
+  {
+    printf("  reply %02X to %02X:", message.type, message.destination_endpoint);
+    for(uint8_t ii = 0; ii < sizeof(message.payload); ii++) { printf(" %02X", message.payload[ii]); }
+    printf("\n");
+  }
+  return ENDPOINT_SUCCESS;
+}
+
+static ruuvi_standard_message_t message(uint8_t endpoint, uint8_t type, uint8_t sample_rate, uint8_t resolution,
+                                        uint8_t scale)
+{
+  ruuvi_sensor_configuration_t configuration = { .sample_rate       = sample_rate,
+                                                 .transmission_rate = TRANSMISSION_RATE_NO_CHANGE,
+                                                 .resolution        = resolution,
+                                                 .scale             = scale,
+                                                 .dsp_function      = DSP_LAST,
+                                                 .dsp_parameter     = 0,
+                                                 .target            = TRANSMISSION_TARGET_NO_CHANGE,
+                                                 .reserved          = 0 };
+  ruuvi_standard_message_t query = { .destination_endpoint = endpoint,
+                                     .source_endpoint      = PLAINTEXT_MESSAGE,
+                                     .type                 = type,
+                                     .payload              = { 0 }};
+  memcpy(query.payload, &configuration, sizeof(configuration));
+  return query;
+}
+
+/** Send query, return true if the three option lists and POWER_RESPONSE or ERROR came back */
+static bool query(const sensor_t* p_sensor, uint8_t endpoint, uint8_t sample_rate, uint8_t resolution, uint8_t scale)
+{
+  reply_count = 0;
+  if(verbose) { printf(" %s: rate %d resolution %d scale %d\n", p_sensor->name, sample_rate, resolution, scale); }
+  ret_code_t err_code = sensor_endpoint_capability(p_sensor, message(endpoint, CAPABILITY_QUERY, sample_rate,
+                                                                     resolution, scale));
+  return ENDPOINT_SUCCESS == err_code && 4 == reply_count &&
+         SAMPLERATE_RESPONSE == replies[0].type && RESOLUTION_RESPONSE == replies[1].type &&
+         SCALE_RESPONSE == replies[2].type && endpoint == replies[3].source_endpoint &&
+         PLAINTEXT_MESSAGE == replies[3].destination_endpoint;
+}
+
+static bool power_is(uint16_t rate_hz, uint8_t resolution, uint8_t scale, uint32_t current_na)
+{
+  const uint8_t* p = replies[3].payload;
+  uint16_t rate = p[0] | (p[1] << 8);
+  uint32_t current = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+  if(verbose) { printf("  %d Hz, %d bits, scale %d, %u nA\n", rate, p[2], p[3], current); }
+  return POWER_RESPONSE == replies[3].type && rate_hz == rate && resolution == p[2] && scale == p[3] &&
+         current_na == current;
+}
+
+static bool error_is(uint8_t result)
+{
+  return ERROR == replies[3].type && result == replies[3].payload[0];
+}
+
+static uint32_t power_na(void)
+{
+  const uint8_t* p = replies[3].payload;
+  return p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+}
+
+/** Current of BME280 model, 480 uA while measuring over the maximum measurement time */
+static uint32_t bme280_expected_na(uint32_t measurement_us, uint32_t period_us)
+{
+  return 100 + (uint32_t)((uint64_t)measurement_us * 480000 / period_us);
+}
+
+static void test_bme280(void)
+{
+  static const uint8_t rates[8]       = { 1, 2, 8, 16, 200, SAMPLE_RATE_SINGLE };
+  static const uint8_t resolutions[8] = { 16, 17, 18, 19, 20 };
+  static const uint8_t scales[8]      = { 0 };
+  uint32_t transfers = bme280_emulator_transfers();
+
+  // Forced measurement of all channels at 1x is 9.3 ms, estimated once per second
+  CHECK(query(&bme280_sensor, TEMPERATURE, SAMPLE_RATE_SINGLE, 16, SCALE_NO_CHANGE));
+  CHECK(!memcmp(replies[0].payload, rates, 8));
+  CHECK(!memcmp(replies[1].payload, resolutions, 8));
+  CHECK(!memcmp(replies[2].payload, scales, 8));
+  CHECK(power_is(1, 16, 0, bme280_expected_na(9300, 1000000)));
+
+  // 20 bits is 16x oversampling of temperature
+  CHECK(query(&bme280_sensor, TEMPERATURE, SAMPLE_RATE_SINGLE, RESOLUTION_MAX, SCALE_MIN));
+  CHECK(power_is(1, 20, 0, bme280_expected_na(9300 + 15 * 2300, 1000000)));
+
+  // Normal mode samples every measurement time + standby, rate is limited by measurement time
+  CHECK(query(&bme280_sensor, TEMPERATURE, 200, 16, SCALE_NO_CHANGE));
+  CHECK(power_is(102, 16, 0, bme280_expected_na(9300, 9800)));
+  CHECK(query(&bme280_sensor, TEMPERATURE, 5, 16, SCALE_NO_CHANGE));
+  CHECK(power_is(7, 16, 0, bme280_expected_na(9300, 134300)));
+  CHECK(query(&bme280_sensor, TEMPERATURE, SAMPLE_RATE_STOP, 16, SCALE_NO_CHANGE));
+  CHECK(power_is(0, 16, 0, 100));
+
+  // Proposals configure() would reject
+  CHECK(query(&bme280_sensor, TEMPERATURE, 1, 14, SCALE_NO_CHANGE));
+  CHECK(error_is(ENDPOINT_NOT_SUPPORTED));
+  CHECK(query(&bme280_sensor, TEMPERATURE, 1, 16, 3));
+  CHECK(error_is(ENDPOINT_NOT_SUPPORTED));
+  CHECK(query(&bme280_sensor, TEMPERATURE, 220, 16, SCALE_NO_CHANGE));
+  CHECK(error_is(ENDPOINT_INVALID));
+
+  CHECK(transfers == bme280_emulator_transfers());
+  CHECK(BME280_MODE_SLEEP == bme280_get_mode());
+  CHECK(BME280_OVERSAMPLING_1 == bme280_get_oversampling_temp());
+
+  // Resolution of configuration sets temperature oversampling, current settings are estimated
+  static message_handler_state_t state;
+  reply_count = 0;
+  sensor_endpoint_configure(&bme280_sensor, &state, message(TEMPERATURE, SENSOR_CONFIGURATION, 1, 18,
+                                                            SCALE_NO_CHANGE));
+  ruuvi_sensor_configuration_t result;
+  memcpy(&result, replies[0].payload, sizeof(result));
+  CHECK(ACKNOWLEDGEMENT == replies[0].type && ENDPOINT_SUCCESS == result.resolution &&
+        ENDPOINT_SUCCESS == result.sample_rate);
+  CHECK(BME280_OVERSAMPLING_4 == bme280_get_oversampling_temp());
+  CHECK(BME280_MODE_NORMAL == bme280_get_mode());
+  CHECK(query(&bme280_sensor, TEMPERATURE, SAMPLE_RATE_NO_CHANGE, RESOLUTION_NO_CHANGE, SCALE_NO_CHANGE));
+  CHECK(power_is(1, 18, 0, bme280_expected_na(16200, 1016200)));
+  CHECK(bme280_sensor.current_na(1000) == power_na());
+  sensor_endpoint_configure(&bme280_sensor, &state, message(TEMPERATURE, SENSOR_CONFIGURATION, SAMPLE_RATE_STOP,
+                                                            16, SCALE_NO_CHANGE));
+  CHECK(BME280_OVERSAMPLING_1 == bme280_get_oversampling_temp());
+  CHECK(BME280_MODE_SLEEP == bme280_get_mode());
+}
+
+static void test_lis2dh12(void)
+{
+  static const uint8_t rates[8]       = { 1, 10, 25, 50, 100, 200 };
+  static const uint8_t resolutions[8] = { 8, 10, 12 };
+  static const uint8_t scales[8]      = { 2, 4, 8, 16 };
+  uint32_t transfers = lis_transfers;
+
+  // Low-power mode draws half at 100 Hz, 10 and 12 bits draw the same
+  CHECK(query(&lis2dh12_sensor, ACCELERATION, 100, 8, 2));
+  CHECK(!memcmp(replies[0].payload, rates, 8));
+  CHECK(!memcmp(replies[1].payload, resolutions, 8));
+  CHECK(!memcmp(replies[2].payload, scales, 8));
+  CHECK(power_is(100, 8, 2, 10000));
+  CHECK(query(&lis2dh12_sensor, ACCELERATION, 100, 10, 2));
+  CHECK(power_is(100, 10, 2, 20000));
+  CHECK(query(&lis2dh12_sensor, ACCELERATION, 100, RESOLUTION_MAX, SCALE_MAX));
+  CHECK(power_is(100, 12, 16, 20000));
+
+  // Rates round up to output data rate as configure() does
+  CHECK(query(&lis2dh12_sensor, ACCELERATION, 150, RESOLUTION_MIN, 4));
+  CHECK(power_is(200, 8, 4, 18000));
+  CHECK(query(&lis2dh12_sensor, ACCELERATION, 250, 12, 8));
+  CHECK(power_is(400, 12, 8, 73000));
+  CHECK(query(&lis2dh12_sensor, ACCELERATION, SAMPLE_RATE_STOP, 12, 8));
+  CHECK(power_is(0, 12, 8, 500));
+
+  CHECK(query(&lis2dh12_sensor, ACCELERATION, 10, 11, 2));
+  CHECK(error_is(ENDPOINT_NOT_SUPPORTED));
+  CHECK(query(&lis2dh12_sensor, ACCELERATION, 10, 12, 3));
+  CHECK(error_is(ENDPOINT_NOT_SUPPORTED));
+  CHECK(query(&lis2dh12_sensor, ACCELERATION, SAMPLE_RATE_SINGLE, 12, 2));
+  CHECK(error_is(ENDPOINT_NOT_IMPLEMENTED));
+  CHECK(transfers == lis_transfers);
+
+  static message_handler_state_t state;
+  sensor_endpoint_configure(&lis2dh12_sensor, &state, message(ACCELERATION, SENSOR_CONFIGURATION, 10, 12, 2));
+  CHECK(query(&lis2dh12_sensor, ACCELERATION, SAMPLE_RATE_NO_CHANGE, RESOLUTION_NO_CHANGE, SCALE_NO_CHANGE));
+  CHECK(power_is(10, 12, 2, 4000));
+  CHECK(lis2dh12_sensor.current_na(1000) == power_na());
+}
+
+/** Walk the option lists as a fleet manager would and pick the cheapest proposal meeting the needs */
+static void test_cheapest(void)
+{
+  CHECK(query(&lis2dh12_sensor, ACCELERATION, SAMPLE_RATE_NO_CHANGE, RESOLUTION_NO_CHANGE, SCALE_NO_CHANGE));
+  ruuvi_standard_message_t options[2] = { replies[0], replies[1] };
+  uint8_t  best_rate = 0;
+  uint8_t  best_resolution = 0;
+  uint32_t best_na = UINT32_MAX;
+  for(uint8_t ii = 0; ii < 8 && options[0].payload[ii]; ii++)
+  {
+    for(uint8_t jj = 0; jj < 8 && options[1].payload[jj]; jj++)
+    {
+      uint8_t rate = options[0].payload[ii];
+      uint8_t resolution = options[1].payload[jj];
+      if(20 > rate || 10 > resolution) { continue; }
+      CHECK(query(&lis2dh12_sensor, ACCELERATION, rate, resolution, SCALE_NO_CHANGE));
+      if(POWER_RESPONSE == replies[3].type && power_na() < best_na)
+      {
+        best_na = power_na();
+        best_rate = rate;
+        best_resolution = resolution;
+      }
+    }
+  }
+  if(verbose) { printf(" cheapest: %d Hz, %d bits, %u nA\n", best_rate, best_resolution, best_na); }
+  CHECK(25 == best_rate && 10 == best_resolution && 6000 == best_na);
+}
+
+int main(int argc, char** argv)
+{
+  int option;
+  while(-1 != (option = getopt(argc, argv, "v")))
+  {
+    if('v' == option) { verbose = true; }
+    else
+    {
+      fprintf(stderr, "Usage: %s [-v]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  set_reply_handler(collect);
+  const bme280_emulator_environment_t environment = { .noise_t = 16, .noise_p = 16, .noise_h = 1,
+                                                      .drift_t = 2000, .drift_p = 500, .drift_h = 200,
+                                                      .drift_period_s = 3600 };
+  bme280_emulator_init(1, &environment);
+  bme280_init();
+  bme280_set_oversampling_hum(BME280_OVERSAMPLING_1);
+  bme280_set_oversampling_temp(BME280_OVERSAMPLING_1);
+  bme280_set_oversampling_press(BME280_OVERSAMPLING_1);
+
+  test_bme280();
+  test_lis2dh12();
+  test_cheapest();
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+#include "app_scheduler_host.h"
+
+#include <string.h>
+#include "app_scheduler.h"
+
+#define MAX_QUEUE_SIZE 64
+#define MAX_EVENT_SIZE 64
+
+typedef struct {
+  app_sched_event_handler_t handler;
+  uint16_t size;
+  uint32_t data[MAX_EVENT_SIZE / 4];
+}queue_entry_t;
+
+static queue_entry_t queue[MAX_QUEUE_SIZE];
+static uint16_t queue_size;
+static uint16_t event_size_max;
+static uint16_t start;
+static uint16_t count;
+
+void app_sched_host_init(uint16_t event_size, uint16_t size)
+{
+  event_size_max = (event_size > MAX_EVENT_SIZE) ? MAX_EVENT_SIZE : event_size;
+  queue_size = (size > MAX_QUEUE_SIZE) ? MAX_QUEUE_SIZE : size;
+  start = 0;
+  count = 0;
+}
+
+uint16_t app_sched_host_queue_count(void)
+{
+  return count;
+}
+
+uint32_t app_sched_event_put(void const * p_event_data, uint16_t event_size, app_sched_event_handler_t handler)
+{
+  if(event_size > event_size_max) { return NRF_ERROR_INVALID_LENGTH; }
+  if(count >= queue_size)         { return NRF_ERROR_NO_MEM; }
+
+  queue_entry_t* entry = &queue[(start + count) % queue_size];
+  entry->handler = handler;
+  entry->size = event_size;
+  if(event_size) { memcpy(entry->data, p_event_data, event_size); }
+  count++;
+  return NRF_SUCCESS;
+}
+
+void app_sched_execute(void)
+{
+  while(count)
+  {
+    queue_entry_t* entry = &queue[start];
+    entry->handler(entry->size ? entry->data : NULL, entry->size);
+    // Slot is free only after handler returns, as in SDK
+    start = (start + 1) % queue_size;
+    count--;
+  }
+}
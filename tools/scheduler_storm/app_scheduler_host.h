@@ -0,0 +1,18 @@
+#ifndef APP_SCHEDULER_HOST_H
+#define APP_SCHEDULER_HOST_H
+
+#include <stdint.h>
+
+/**
+ *  Host implementation of Nordic app_scheduler with the queue semantics of SDK 12:
+ *  fixed number of slots of fixed size, NRF_ERROR_NO_MEM when full and the slot of
+ *  an event is released only after its handler returns.
+ */
+
+/** Reset queue, equivalent of APP_SCHED_INIT */
+void app_sched_host_init(uint16_t event_size, uint16_t queue_size);
+
+/** Number of events in queue, including the one being executed */
+uint16_t app_sched_host_queue_count(void);
+
+#endif
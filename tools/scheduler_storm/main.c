@@ -0,0 +1,365 @@
+/**
+ *  Host simulation of libraries/scheduler under an event storm.
+ *
+ *  Interrupt sources of ruuvi_firmware put events through scheduler_event_put() at
+ *  simulated times, handlers consume simulated CPU time. Interrupts which fire while
+ *  a handler runs are delivered at their own time, as on target. Timer sources go
+ *  through app_scheduler first, as app_timer does with APP_TIMER_APPSH_INIT.
+ *  After each scenario statistics are printed and queried through the SCHEDULER
+ *  diagnostics endpoint.
+ *
+ *  Scenarios run the same load twice: once as a single FIFO with run-to-completion
+ *  handlers, as firmware did before priority classes, and once with priority classes
+ *  and background tasks which yield on budget. Latency of main_sensor_task from timer
+ *  expiry to start of the task is checked against a bound in the latter, the program
+ *  exits with 1 if the bound is exceeded.
+ *
+ *  Handler costs are rough estimates of the firmware handlers, they are meant to show
+ *  queue behaviour rather than exact timing.
+ *
+ *  Usage: scheduler_storm [-d seconds] [-q]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "app_scheduler.h"
+#include "app_scheduler_host.h"
+#include "ruuvi_endpoints.h"
+#include "scheduler.h"
+#include "scheduler_handler.h"
+
+#define TICK_HZ          (32768 / 16)  // RTC1 with RUUVITAG_APP_TIMER_PRESCALER 15
+#define SCHED_QUEUE_SIZE 16            // RUUVITAG_APP_TIMER_OP_QUEUE_SIZE
+#define US_PER_MS        1000ULL
+#define US_PER_S         (1000 * US_PER_MS)
+
+#define COMPACTION_CHUNK_US 500        // Work done between budget checks
+
+typedef struct {
+  const char* name;
+  uint32_t cost_us;
+  uint32_t resume_us;                  // Cost of deferred part, 0 if task is not split
+}task_t;
+
+typedef struct {
+  const task_t* task;
+  app_sched_event_handler_t handler;
+  scheduler_priority_t priority;
+  bool timer;          // Delivered through app_scheduler like app_timer
+  uint32_t period_us;  // Interval of bursts
+  uint32_t burst;      // Interrupts per burst
+  uint32_t spacing_us; // Interval of interrupts within burst
+  uint32_t phase_us;   // First burst
+}source_t;
+
+typedef struct {
+  const char* name;
+  const source_t* sources;
+  size_t source_count;
+  bool prioritized;    // false: every event to one class, handlers run to completion
+  uint32_t sensor_latency_bound_us; // 0: not checked
+}scenario_t;
+
+typedef struct {
+  uint64_t next_us;
+  uint32_t index;
+}source_state_t;
+
+/** Event data of simulated tasks */
+typedef struct {
+  uint32_t fired_ms;   // Time of interrupt, ms part
+  uint16_t fired_us;   // Time of interrupt, us part
+  uint16_t source;
+}sim_event_t;
+
+static uint64_t now_us;
+static const scenario_t* active_scenario;
+static source_state_t source_state[16];
+static uint64_t sensor_latency_max_us;
+
+static const task_t main_sensor_task   = { "main_sensor_task",   4000,  0 };    // BME280, LIS2DH12, encode, advertisement update
+static const task_t change_mode        = { "change_mode",        1500,  0 };    // Reconfigure advertising and sensors
+static const task_t store_mode         = { "store_mode",         8000,  6000 }; // FDS write, then GC as continuation
+static const task_t reinit_nfc         = { "reinit_nfc",         600,   0 };    // Re-encode data record, swap payload
+static const task_t become_connectable = { "become_connectable", 2500,  0 };    // Advertising restart
+static const task_t lis2dh12_fifo      = { "lis2dh12_handler",   1800,  0 };    // Read 32 samples over SPI
+static const task_t gatt_message       = { "ble_gatt_handler",   400,   0 };    // route_message and reply
+static const task_t log_compaction     = { "log_compaction",     80000, 0 };    // Background maintenance in chunks
+
+static const task_t* const tasks[] = { &main_sensor_task, &change_mode, &store_mode, &reinit_nfc,
+                                       &become_connectable, &lis2dh12_fifo, &gatt_message, &log_compaction };
+
+static uint32_t ticks(void)
+{
+  return now_us * TICK_HZ / US_PER_S;
+}
+
+static void advance(uint64_t us);
+
+static uint64_t fired_time(const sim_event_t* event)
+{
+  return event->fired_ms * US_PER_MS + event->fired_us;
+}
+
+#define TASK_HANDLER(task)                                      \
+  static void task##_handler(void* p_data, uint16_t length)     \
+  {                                                             \
+    (void)p_data; (void)length;                                 \
+    advance(task.cost_us);                                      \
+  }
+
+TASK_HANDLER(change_mode)
+TASK_HANDLER(reinit_nfc)
+TASK_HANDLER(become_connectable)
+TASK_HANDLER(lis2dh12_fifo)
+TASK_HANDLER(gatt_message)
+
+/** Records latency from timer expiry, which includes time in app_scheduler queue */
+static void main_sensor_task_handler(void* p_data, uint16_t length)
+{
+  uint64_t latency = now_us - fired_time(p_data);
+  if(latency > sensor_latency_max_us) { sensor_latency_max_us = latency; }
+  advance(main_sensor_task.cost_us);
+}
+
+/** Same steps as store_mode of ruuvi_firmware, GC is deferred if budget is used */
+static void store_mode_handler(void* p_data, uint16_t length)
+{
+  uint8_t step = (sizeof(step) == length) ? *(uint8_t*)p_data : 0;
+  if(0 == step)
+  {
+    advance(store_mode.cost_us);
+    step = 1;
+    if(active_scenario->prioritized && scheduler_budget_exceeded())
+    {
+      scheduler_continue(&step, sizeof(step));
+      return;
+    }
+  }
+  advance(store_mode.resume_us);
+}
+
+/** Processes work in chunks, yields with remaining work when budget is exceeded */
+static void log_compaction_handler(void* p_data, uint16_t length)
+{
+  uint32_t remaining_us = log_compaction.cost_us;
+  if(sizeof(remaining_us) == length) { memcpy(&remaining_us, p_data, sizeof(remaining_us)); }
+  while(remaining_us)
+  {
+    uint32_t chunk = (remaining_us > COMPACTION_CHUNK_US) ? COMPACTION_CHUNK_US : remaining_us;
+    advance(chunk);
+    remaining_us -= chunk;
+    if(remaining_us && active_scenario->prioritized && scheduler_budget_exceeded())
+    {
+      scheduler_continue(&remaining_us, sizeof(remaining_us));
+      return;
+    }
+  }
+}
+
+#define RT SCHEDULER_PRIORITY_REALTIME
+#define IO SCHEDULER_PRIORITY_IO
+#define BG SCHEDULER_PRIORITY_BACKGROUND
+
+static const source_t nominal[] = {
+  { &main_sensor_task,   main_sensor_task_handler,   RT, true,  1000000, 1,  0,    0 },
+  { &lis2dh12_fifo,      lis2dh12_fifo_handler,      RT, false, 1280000, 1,  0,    3000 },
+  { &log_compaction,     log_compaction_handler,     BG, false, 4100000, 1,  0,    960000 },
+};
+
+static const source_t storm[] = {
+  { &main_sensor_task,   main_sensor_task_handler,   RT, true,  1000000, 1,  0,    0 },
+  { &lis2dh12_fifo,      lis2dh12_fifo_handler,      RT, false, 40000,   1,  0,    3000 },    // Movement, FIFO at 25 Hz
+  { &change_mode,        change_mode_handler,        IO, false, 700000,  1,  0,    100000 },  // Button mashed
+  { &become_connectable, become_connectable_handler, IO, false, 700000,  1,  0,    100000 },
+  { &store_mode,         store_mode_handler,         BG, false, 700000,  1,  0,    100000 },
+  { &reinit_nfc,         reinit_nfc_handler,         IO, false, 300000,  1,  0,    50000 },   // NFC field flickering
+  { &become_connectable, become_connectable_handler, IO, false, 300000,  1,  0,    50000 },
+  { &gatt_message,       gatt_message_handler,       IO, false, 2000000, 24, 500,  500000 },  // Burst of GATT commands
+  { &log_compaction,     log_compaction_handler,     BG, false, 4100000, 1,  0,    960000 },
+};
+
+#define SENSOR_LATENCY_BOUND_US (SCHEDULER_BUDGET_REALTIME * US_PER_S / TICK_HZ)
+
+static const scenario_t scenarios[] = {
+  { "nominal, single FIFO",       nominal, sizeof(nominal) / sizeof(nominal[0]), false, 0 },
+  { "nominal, priority classes",  nominal, sizeof(nominal) / sizeof(nominal[0]), true,  SENSOR_LATENCY_BOUND_US },
+  { "storm, single FIFO",         storm,   sizeof(storm) / sizeof(storm[0]),     false, 0 },
+  { "storm, priority classes",    storm,   sizeof(storm) / sizeof(storm[0]),     true,  SENSOR_LATENCY_BOUND_US }
+};
+
+/** Return index of source which fires next */
+static size_t next_source(void)
+{
+  size_t next = 0;
+  for(size_t ii = 1; ii < active_scenario->source_count; ii++)
+  {
+    if(source_state[ii].next_us < source_state[next].next_us) { next = ii; }
+  }
+  return next;
+}
+
+/** Handler of timer event in app_scheduler, queues the task as main_timer_handler does */
+static void timer_handler(void* p_data, uint16_t length)
+{
+  sim_event_t event;
+  memcpy(&event, p_data, sizeof(event));
+  const source_t* source = &active_scenario->sources[event.source];
+  scheduler_priority_t priority = active_scenario->prioritized ? source->priority : SCHEDULER_PRIORITY_IO;
+  scheduler_event_put(&event, sizeof(event), source->handler, priority);
+}
+
+/** Interrupt service routine of a source, puts event to scheduler and sets next interrupt */
+static void fire(size_t index)
+{
+  const source_t* source = &active_scenario->sources[index];
+  source_state_t* state = &source_state[index];
+  now_us = state->next_us;
+  sim_event_t event = { .fired_ms = now_us / US_PER_MS, .fired_us = now_us % US_PER_MS, .source = index };
+  if(source->timer) { app_sched_event_put(&event, sizeof(event), timer_handler); }
+  else              { timer_handler(&event, sizeof(event)); }
+
+  state->index++;
+  if(state->index < source->burst) { state->next_us += source->spacing_us; }
+  else
+  {
+    state->next_us += source->period_us - (source->burst - 1) * source->spacing_us;
+    state->index = 0;
+  }
+}
+
+/** Consume CPU time, delivering interrupts which fire meanwhile */
+static void advance(uint64_t us)
+{
+  uint64_t target = now_us + us;
+  size_t next;
+  while(source_state[next = next_source()].next_us <= target) { fire(next); }
+  now_us = target;
+}
+
+static const char* task_name(app_sched_event_handler_t handler)
+{
+  static const app_sched_event_handler_t handlers[] = {
+    main_sensor_task_handler, change_mode_handler, store_mode_handler, reinit_nfc_handler,
+    become_connectable_handler, lis2dh12_fifo_handler, gatt_message_handler, log_compaction_handler };
+  for(size_t ii = 0; ii < sizeof(handlers) / sizeof(handlers[0]); ii++)
+  {
+    if(handlers[ii] == handler) { return tasks[ii]->name; }
+  }
+  return "unknown";
+}
+
+static float to_ms(uint32_t ticks)
+{
+  return ticks * 1000.0f / TICK_HZ;
+}
+
+static void print_stats(void)
+{
+  const scheduler_stats_t* stats = scheduler_stats_get();
+  printf("queues: peak %u / %u, dropped %u, untracked %u\n", stats->pending_peak,
+         SCHEDULER_QUEUE_SIZE_REALTIME + SCHEDULER_QUEUE_SIZE_IO + SCHEDULER_QUEUE_SIZE_BACKGROUND,
+         stats->dropped, stats->untracked);
+  printf("%-19s %3s %7s %7s %5s %5s %5s | %8s %8s %8s | %8s %8s %8s\n", "handler", "pri", "runs", "dropped",
+         "peak", "cont", "over", "lat p50", "lat p99", "lat max", "exe p50", "exe p99", "exe max");
+  for(uint8_t ii = 0; ii < stats->handlers; ii++)
+  {
+    const scheduler_handler_stats_t* h = scheduler_handler_stats_get(ii);
+    printf("%-19s %3u %7u %7u %5u %5u %5u | %8.1f %8.1f %8.1f | %8.1f %8.1f %8.1f\n", task_name(h->handler),
+           h->priority, h->dispatched, h->dropped, h->pending_peak, h->continued, h->overruns,
+           to_ms(scheduler_histogram_percentile(h->latency_histogram, h->latency_max, 500)),
+           to_ms(scheduler_histogram_percentile(h->latency_histogram, h->latency_max, 990)),
+           to_ms(h->latency_max),
+           to_ms(scheduler_histogram_percentile(h->execution_histogram, h->execution_max, 500)),
+           to_ms(scheduler_histogram_percentile(h->execution_histogram, h->execution_max, 990)),
+           to_ms(h->execution_max));
+  }
+  printf("times in ms at %d Hz tick, percentiles are upper bounds of log2 histogram bins, limited to max\n", TICK_HZ);
+}
+
+/** Reply handler of the diagnostics endpoint, prints raw replies as they would be sent over GATT */
+static ret_code_t print_reply(const ruuvi_standard_message_t reply)
+{
+  printf("  reply %02X %02X %02X:", reply.destination_endpoint, reply.source_endpoint, reply.type);
+  for(size_t ii = 0; ii < sizeof(reply.payload); ii++) { printf(" %02X", reply.payload[ii]); }
+  printf("\n");
+  return NRF_SUCCESS;
+}
+
+static void query_endpoint(void)
+{
+  ruuvi_standard_message_t query = { .destination_endpoint = SCHEDULER,
+                                     .source_endpoint = PLAINTEXT_MESSAGE,
+                                     .type = STATUS_QUERY,
+                                     .payload = {0}};
+  printf("diagnostics endpoint, STATUS_QUERY and DATA_QUERY of all handlers:\n");
+  route_message(query);
+  query.type = DATA_QUERY;
+  query.payload[0] = SCHEDULER_DIAGNOSTICS_ALL;
+  route_message(query);
+}
+
+/** Run scenario, return false if latency bound of sensor task was exceeded */
+static bool run(const scenario_t* scenario, uint32_t seconds, bool query)
+{
+  active_scenario = scenario;
+  now_us = 0;
+  sensor_latency_max_us = 0;
+  memset(source_state, 0, sizeof(source_state));
+  for(size_t ii = 0; ii < scenario->source_count; ii++)
+  {
+    source_state[ii].next_us = scenario->sources[ii].phase_us;
+  }
+  app_sched_host_init(sizeof(sim_event_t), SCHED_QUEUE_SIZE);
+  scheduler_priority_init(ticks);
+
+  uint64_t end = seconds * US_PER_S;
+  while(now_us < end)
+  {
+    // Sleep until next interrupt, then run main loop
+    fire(next_source());
+    scheduler_execute();
+  }
+
+  printf("\n== %s, %u s\n", scenario->name, seconds);
+  print_stats();
+  bool pass = !scenario->sensor_latency_bound_us || sensor_latency_max_us <= scenario->sensor_latency_bound_us;
+  printf("main_sensor_task latency from timer, max %.1f ms", sensor_latency_max_us / 1000.0f);
+  if(scenario->sensor_latency_bound_us)
+  {
+    printf(", bound %.1f ms: %s", scenario->sensor_latency_bound_us / 1000.0f, pass ? "PASS" : "FAIL");
+  }
+  printf("\n");
+  if(query) { query_endpoint(); }
+  return pass;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t seconds = 60;
+  bool query = true;
+  int opt;
+  while(-1 != (opt = getopt(argc, argv, "d:q")))
+  {
+    if('d' == opt)      { seconds = strtoul(optarg, NULL, 10); }
+    else if('q' == opt) { query = false; }
+    else
+    {
+      fprintf(stderr, "Usage: %s [-d seconds] [-q]\n", argv[0]);
+      return 2;
+    }
+  }
+  if(0 == seconds) { seconds = 60; }
+
+  set_scheduler_handler(scheduler_handler);
+  set_reply_handler(print_reply);
+  bool pass = true;
+  for(size_t ii = 0; ii < sizeof(scenarios) / sizeof(scenarios[0]); ii++)
+  {
+    pass &= run(&scenarios[ii], seconds, query);
+  }
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+// Host stub: lets host tools include firmware driver headers.
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef NRF_SUCCESS
+  #define NRF_SUCCESS 0
+#endif
+typedef uint32_t ret_code_t;
@@ -0,0 +1,12 @@
+// Host stub: lets host tools include firmware driver headers.
+#ifndef APP_SCHEDULER_H__
+#define APP_SCHEDULER_H__
+#include <stdint.h>
+#include "sdk_errors.h"
+
+typedef void (*app_sched_event_handler_t)(void * p_event_data, uint16_t event_size);
+
+// Implemented by host tools which run the scheduler, e.g. tools/scheduler_storm.
+uint32_t app_sched_event_put(void const * p_event_data, uint16_t event_size, app_sched_event_handler_t handler);
+void app_sched_execute(void);
+#endif
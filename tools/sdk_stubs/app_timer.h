@@ -0,0 +1,11 @@
+// Host stub: lets host tools include firmware driver headers.
+#ifndef APP_TIMER_H__
+#define APP_TIMER_H__
+#include <stdint.h>
+
+typedef void* app_timer_id_t;
+
+#define APP_TIMER_MIN_TIMEOUT_TICKS 5
+
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void* p_context);
+#endif
@@ -0,0 +1,3 @@
+// Host stub: lets host tools include firmware driver headers. Host tools are single threaded.
+#define CRITICAL_REGION_ENTER()
+#define CRITICAL_REGION_EXIT()
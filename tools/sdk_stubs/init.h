@@ -0,0 +1,14 @@
+// Host stub: lets host tools include firmware driver headers.
+#ifndef INIT_H
+#define INIT_H
+
+typedef enum {
+  INIT_SUCCESS = 0
+}init_err_code_t;
+
+// Defined by host tool which links sensor adapters of drivers
+init_err_code_t init_bme280(void);
+init_err_code_t init_bme280_calibrated(void);
+init_err_code_t init_lis2dh12(void);
+
+#endif
@@ -0,0 +1,7 @@
+// Host stub: lets host tools include firmware driver headers.
+#ifndef MIN
+  #define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+  #define MAX(a, b) ((a) < (b) ? (b) : (a))
+#endif
@@ -0,0 +1,3 @@
+// Host stub: lets host tools include firmware driver headers.
+#define nrf_delay_ms(ms)
+#define nrf_delay_us(us)
@@ -0,0 +1,7 @@
+// Host stub: lets host tools include firmware driver headers.
+#define NRF_LOG_ERROR(...)
+#define NRF_LOG_WARNING(...)
+#define NRF_LOG_INFO(...)
+#define NRF_LOG_DEBUG(...)
+#define NRF_LOG_FLUSH()
+#define NRF_LOG_HEXDUMP_DEBUG(...)
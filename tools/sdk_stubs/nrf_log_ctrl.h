@@ -0,0 +1 @@
+// Host stub: lets host tools include firmware driver headers.
@@ -0,0 +1,5 @@
+// Host stub: lets host tools include firmware driver headers.
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "sdk_errors.h"
@@ -0,0 +1,3 @@
+// Host stub: lets host tools include firmware driver headers.
+#include "nrf_error.h"
+#include "app_error.h"
@@ -0,0 +1,594 @@
+/**
+ *  Host test of drivers/spi/spi_transaction.c against a fake SPI bus.
+ *
+ *  The fake port records chip select and transfer starts, and ends a transfer only
+ *  when the test fires the simulated END interrupt, as SPIM would. BME280 transfers
+ *  go to the register level emulator of tools/bme280_benchmark, so the queued
+ *  measurement read of drivers/bme280 is checked against its blocking read.
+ *  LIS2DH12 transfers return a fixed pattern.
+ *
+ *  Sensor sweep of drivers/sensor is run with the BME280 adapter, a fake accelerometer
+ *  on the same fake bus and a fake on-chip temperature fallback. Sensor pipeline runs
+ *  on a fake RTC which advances with the BME280 emulator.
+ *
+ *  Checks:
+ *   - a sensor sweep runs back to back and wakes main context once
+ *   - chip select is driven per transaction in queue order
+ *   - transactions put while the bus is busy join the running sequence
+ *   - full queue, double put and failed starts are reported
+ *   - held queue starts transactions of several puts as one sequence
+ *   - sensor sweep reads all sensors in one sequence and reports once, fallback is left out
+ *   - sensor pipeline samples channels at their own intervals, forced BME280 measurements
+ *     skip channels which are not due and cached values go stale
+ *
+ *  Usage: spi_sweep [-v]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "app_scheduler.h"
+#include "app_scheduler_host.h"
+#include "bme280.h"
+#include "bme280_emulator.h"
+#include "bme280_sensor.h"
+#include "init.h"
+#include "nrf_error.h"
+#include "scheduler.h"
+#include "rtc.h"
+#include "sensor.h"
+#include "sensor_pipeline.h"
+#include "spi_transaction.h"
+
+#define LOG_SIZE      64
+#define BUS_BYTE_US   1     // 8 MHz SPI
+#define IRQ_ENTRY_US  3     // Interrupt entry, handler and exit
+
+static const char* device_names[SPI_DEVICE_COUNT] = { "BME280", "LIS2DH12" };
+
+static char       bus_log[LOG_SIZE][32];
+static uint8_t    bus_log_count;
+static bool       bus_running;
+static ret_code_t start_error = NRF_SUCCESS;
+static uint32_t   interrupts;
+static uint32_t   bus_us;
+static uint8_t    completions;
+static bool       verbose;
+static uint32_t   failures;
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if(!(condition))                                                       \
+    {                                                                      \
+      printf("FAIL %s:%d: %s\n", __func__, __LINE__, #condition);          \
+      failures++;                                                          \
+    }                                                                      \
+  } while(0)
+
+static void log_bus(const char* event, spi_device_t device)
+{
+  if(LOG_SIZE > bus_log_count)
+  {
+    snprintf(bus_log[bus_log_count++], sizeof(bus_log[0]), "%s %s", event, device_names[device]);
+  }
+  if(verbose) { printf("  bus: %s %s\n", event, device_names[device]); }
+}
+
+static spi_device_t selected_device;
+
+static void fake_select(spi_device_t device, bool selected)
+{
+  if(selected) { selected_device = device; }
+  log_bus(selected ? "select" : "release", device);
+}
+
+static ret_code_t fake_start(const uint8_t* p_tx, uint8_t* p_rx, uint8_t length)
+{
+  if(NRF_SUCCESS != start_error) { return start_error; }
+  if(bus_running) { return NRF_ERROR_BUSY; }
+  log_bus("start", selected_device);
+  if(SPI_DEVICE_BME280 == selected_device)
+  {
+    spi_transfer_bme280((uint8_t*)p_tx, length, p_rx);
+  }
+  else
+  {
+    for(uint8_t ii = 0; ii < length; ii++) { p_rx[ii] = ii; }
+  }
+  bus_running = true;
+  bus_us += length * BUS_BYTE_US;
+  return NRF_SUCCESS;
+}
+
+static const spi_port_t fake_port = { fake_select, fake_start };
+
+/** SPIM END interrupt, returns false if bus was idle */
+static bool fire_interrupt(void)
+{
+  if(!bus_running) { return false; }
+  bus_running = false;
+  interrupts++;
+  bus_us += IRQ_ENTRY_US;
+  spi_transaction_complete(NRF_SUCCESS);
+  return true;
+}
+
+static void run_bus(void)
+{
+  while(fire_interrupt());
+}
+
+static void reset(void)
+{
+  app_sched_host_init(SCHEDULER_MAX_EVENT_DATA_SIZE, 16);
+  scheduler_priority_init(NULL);
+  spi_transaction_init(&fake_port);
+  bus_log_count = 0;
+  bus_running = false;
+  start_error = NRF_SUCCESS;
+  interrupts = 0;
+  bus_us = 0;
+  completions = 0;
+}
+
+static bool log_is(const char* const* expected, uint8_t count)
+{
+  if(count != bus_log_count) { return false; }
+  for(uint8_t ii = 0; ii < count; ii++)
+  {
+    if(strcmp(expected[ii], bus_log[ii])) { return false; }
+  }
+  return true;
+}
+
+static void count_completion(spi_transaction_t* p_transaction)
+{
+  completions++;
+}
+
+static uint8_t lis_tx[7], lis_rx[7];
+
+static void lis_transaction(spi_transaction_t* p_transaction, spi_transaction_handler_t handler)
+{
+  memset(p_transaction, 0, sizeof(*p_transaction));
+  lis_tx[0] = 0x28 | 0xC0;  // OUT_X_L, read, auto increment
+  p_transaction->device = SPI_DEVICE_LIS2DH12;
+  p_transaction->p_tx = lis_tx;
+  p_transaction->p_rx = lis_rx;
+  p_transaction->length = sizeof(lis_tx);
+  p_transaction->handler = handler;
+}
+
+/** BME280 burst and LIS2DH12 sample read as main_sensor_task queues them */
+static void test_sweep(void)
+{
+  static spi_transaction_t bme, lis;
+  reset();
+  memset(&bme, 0, sizeof(bme));
+  CHECK(BME280_RET_OK == bme280_measurement_transaction(&bme, NULL, NULL));
+  lis_transaction(&lis, count_completion);
+  spi_transaction_t* sequence[] = { &bme, &lis };
+
+  CHECK(NRF_SUCCESS == spi_transaction_put_sequence(sequence, 2));
+  CHECK(spi_transaction_busy());
+  run_bus();
+  CHECK(!spi_transaction_busy());
+  CHECK(2 == interrupts);
+  // Nothing runs in main context until whole sequence is done
+  CHECK(0 == completions);
+  CHECK(1 == app_sched_host_queue_count() + scheduler_stats_get()->pending);
+
+  scheduler_execute();
+  CHECK(1 == completions);
+  const spi_transaction_stats_t* stats = spi_transaction_stats_get();
+  CHECK(1 == stats->sequences);
+  CHECK(1 == stats->deliveries);
+  CHECK(2 == stats->transactions);
+
+  const char* expected[] = { "select BME280", "start BME280", "release BME280",
+                             "select LIS2DH12", "start LIS2DH12", "release LIS2DH12" };
+  CHECK(log_is(expected, sizeof(expected) / sizeof(expected[0])));
+
+  // Queued read gives same values as blocking read of same conversion
+  CHECK(BME280_RET_OK == bme280_measurement_complete(&bme));
+  int32_t  temperature = bme280_get_temperature();
+  uint32_t pressure    = bme280_get_pressure();
+  uint32_t humidity    = bme280_get_humidity();
+  CHECK(BME280_RET_OK == bme280_read_measurements());
+  CHECK(0 == bme280_get_updated_channels());
+  CHECK(temperature == bme280_get_temperature());
+  CHECK(pressure == bme280_get_pressure());
+  CHECK(humidity == bme280_get_humidity());
+  CHECK(lis.state == SPI_TRANSACTION_DONE && NRF_SUCCESS == lis.result && 6 == lis_rx[6]);
+
+  printf("sweep: %u transactions, %u interrupts, %u main context wake-up, bus busy %u us\n",
+         (unsigned)stats->transactions, (unsigned)interrupts, (unsigned)stats->deliveries, (unsigned)bus_us);
+}
+
+/** Transaction put while bus is busy, e.g. from GATT handler, joins running sequence */
+static void test_join(void)
+{
+  static spi_transaction_t first, second, third;
+  reset();
+  lis_transaction(&first, count_completion);
+  lis_transaction(&second, count_completion);
+  lis_transaction(&third, NULL);
+
+  CHECK(NRF_SUCCESS == spi_transaction_put(&first));
+  CHECK(NRF_SUCCESS == spi_transaction_put(&second));
+  CHECK(NRF_ERROR_INVALID_STATE == spi_transaction_put(&second));
+  fire_interrupt();
+  CHECK(NRF_SUCCESS == spi_transaction_put(&third));
+  run_bus();
+  scheduler_execute();
+
+  const spi_transaction_stats_t* stats = spi_transaction_stats_get();
+  CHECK(2 == completions);
+  CHECK(1 == stats->sequences);
+  CHECK(1 == stats->deliveries);
+  CHECK(3 == stats->transactions);
+  // Transaction without handler is only polled
+  CHECK(SPI_TRANSACTION_DONE == third.state);
+}
+
+static void test_queue_full(void)
+{
+  static spi_transaction_t transactions[SPI_TRANSACTION_QUEUE_SIZE + 1];
+  reset();
+  for(uint8_t ii = 0; ii < SPI_TRANSACTION_QUEUE_SIZE + 1; ii++)
+  {
+    lis_transaction(&transactions[ii], count_completion);
+  }
+  for(uint8_t ii = 0; ii < SPI_TRANSACTION_QUEUE_SIZE; ii++)
+  {
+    CHECK(NRF_SUCCESS == spi_transaction_put(&transactions[ii]));
+  }
+  CHECK(NRF_ERROR_NO_MEM == spi_transaction_put(&transactions[SPI_TRANSACTION_QUEUE_SIZE]));
+  CHECK(SPI_TRANSACTION_QUEUE_SIZE == spi_transaction_stats_get()->queue_peak);
+
+  // Completed but undelivered transactions keep their slots
+  run_bus();
+  CHECK(NRF_ERROR_NO_MEM == spi_transaction_put(&transactions[SPI_TRANSACTION_QUEUE_SIZE]));
+  scheduler_execute();
+  CHECK(SPI_TRANSACTION_QUEUE_SIZE == completions);
+  CHECK(NRF_SUCCESS == spi_transaction_put(&transactions[SPI_TRANSACTION_QUEUE_SIZE]));
+  CHECK(2 == spi_transaction_stats_get()->rejected);
+
+  // Sequence is queued whole or not at all
+  spi_transaction_t* sequence[SPI_TRANSACTION_QUEUE_SIZE];
+  for(uint8_t ii = 0; ii < SPI_TRANSACTION_QUEUE_SIZE; ii++) { sequence[ii] = &transactions[ii]; }
+  CHECK(NRF_ERROR_NO_MEM == spi_transaction_put_sequence(sequence, SPI_TRANSACTION_QUEUE_SIZE));
+  CHECK(SPI_TRANSACTION_DONE == transactions[0].state);
+}
+
+static void check_error(spi_transaction_t* p_transaction)
+{
+  CHECK(NRF_ERROR_INVALID_ADDR == p_transaction->result);
+  completions++;
+}
+
+static void test_start_error(void)
+{
+  static spi_transaction_t failing, next;
+  reset();
+  lis_transaction(&failing, check_error);
+  lis_transaction(&next, count_completion);
+  start_error = NRF_ERROR_INVALID_ADDR;
+  CHECK(NRF_SUCCESS == spi_transaction_put(&failing));
+  CHECK(!spi_transaction_busy());
+  start_error = NRF_SUCCESS;
+  CHECK(NRF_SUCCESS == spi_transaction_put(&next));
+  run_bus();
+  scheduler_execute();
+  CHECK(2 == completions);
+  CHECK(NRF_SUCCESS == next.result);
+
+  // Chip select is released after failed start
+  const char* expected[] = { "select LIS2DH12", "release LIS2DH12",
+                             "select LIS2DH12", "start LIS2DH12", "release LIS2DH12" };
+  CHECK(log_is(expected, sizeof(expected) / sizeof(expected[0])));
+}
+
+static void test_hold(void)
+{
+  static spi_transaction_t first, second, polled;
+  reset();
+  lis_transaction(&first, count_completion);
+  lis_transaction(&second, count_completion);
+  lis_transaction(&polled, NULL);
+
+  spi_transaction_hold();
+  spi_transaction_hold();
+  CHECK(NRF_SUCCESS == spi_transaction_put(&first));
+  CHECK(NRF_SUCCESS == spi_transaction_put(&second));
+  spi_transaction_release();
+  CHECK(0 == bus_log_count);
+  spi_transaction_release();
+  CHECK(spi_transaction_busy());
+  run_bus();
+  scheduler_execute();
+  const spi_transaction_stats_t* stats = spi_transaction_stats_get();
+  CHECK(2 == completions);
+  CHECK(1 == stats->sequences);
+  CHECK(1 == stats->deliveries);
+  CHECK(1 == stats->holds);
+
+  // Blocking caller is not held, it would wait forever
+  spi_transaction_hold();
+  CHECK(NRF_SUCCESS == spi_transaction_put(&polled));
+  CHECK(0 != bus_log_count && bus_running);
+  run_bus();
+  CHECK(SPI_TRANSACTION_DONE == polled.state);
+  spi_transaction_release();
+  spi_transaction_release();
+  CHECK(2 == stats->holds);
+}
+
+static uint8_t            bme280_inits;
+static uint8_t            bme280_resumes;
+static spi_transaction_t  accel_transaction;
+static ruuvi_sensor_t*    accel_target;
+static sensor_complete_t  accel_complete;
+static uint8_t            temperature_inits;
+static uint8_t            sweeps;
+
+init_err_code_t init_bme280(void)
+{
+  // Driver is brought up by main
+  bme280_inits++;
+  return INIT_SUCCESS;
+}
+
+init_err_code_t init_bme280_calibrated(void)
+{
+  bme280_resumes++;
+  return INIT_SUCCESS;
+}
+
+static ret_code_t accel_init(void) { return NRF_SUCCESS; }
+static ret_code_t temperature_init(void) { temperature_inits++; return NRF_SUCCESS; }
+static void sensor_configure(const ruuvi_sensor_configuration_t* p_configuration, ruuvi_sensor_configuration_t* p_result) { }
+static uint32_t sensor_start(uint8_t channels) { return 0; }
+static uint32_t sensor_current(uint32_t interval_ms) { return 1000; }
+
+static void accel_done(spi_transaction_t* p_transaction)
+{
+  accel_target->accX = lis_rx[1];
+  p_transaction->state = SPI_TRANSACTION_IDLE;
+  accel_complete(NRF_SUCCESS);
+}
+
+static ret_code_t accel_read(ruuvi_sensor_t* p_data, sensor_complete_t complete)
+{
+  lis_transaction(&accel_transaction, accel_done);
+  accel_target = p_data;
+  accel_complete = complete;
+  return spi_transaction_put(&accel_transaction);
+}
+
+static uint8_t accel_capabilities(void) { return SENSOR_CAPABILITY_ACCELERATION; }
+
+static ret_code_t temperature_read(ruuvi_sensor_t* p_data, sensor_complete_t complete)
+{
+  p_data->temperature = 1234;
+  complete(NRF_SUCCESS);
+  return NRF_SUCCESS;
+}
+
+static uint8_t temperature_capabilities(void) { return SENSOR_CAPABILITY_TEMPERATURE; }
+
+static const sensor_t accel_sensor = { "ACCEL", accel_init, sensor_configure, sensor_start, accel_read,
+                                       accel_capabilities, sensor_current };
+static const sensor_t temperature_sensor = { "TEMPERATURE", temperature_init, sensor_configure, sensor_start,
+                                             temperature_read, temperature_capabilities, sensor_current };
+
+static void sweep_done(ruuvi_sensor_t* p_data)
+{
+  sweeps++;
+}
+
+static void test_sensor_sweep(void)
+{
+  static ruuvi_sensor_t data;
+  reset();
+  CHECK(NRF_SUCCESS == sensor_register(&bme280_sensor));
+  CHECK(NRF_SUCCESS == sensor_register(&accel_sensor));
+  CHECK(NRF_SUCCESS == sensor_register(&temperature_sensor));
+  uint8_t provided = sensor_init_all();
+  CHECK((SENSOR_CAPABILITY_TEMPERATURE | SENSOR_CAPABILITY_HUMIDITY | SENSOR_CAPABILITY_PRESSURE |
+         SENSOR_CAPABILITY_ACCELERATION) == provided);
+  CHECK(1 == bme280_inits && 0 == temperature_inits);
+  CHECK(sensor_is_active(&bme280_sensor) && !sensor_is_active(&temperature_sensor));
+
+  // Warm boot brings up sensors active on cold boot, BME280 without probing
+  CHECK(0x03 == sensor_active_mask());
+  CHECK(provided == sensor_resume_all(sensor_active_mask()));
+  CHECK(1 == bme280_inits && 1 == bme280_resumes && 0 == temperature_inits);
+  CHECK(sensor_is_active(&bme280_sensor) && !sensor_is_active(&temperature_sensor));
+
+  // Normal mode samples on its own
+  CHECK(0 == sensor_start_all(provided));
+  data.temperature = TEMPERATURE_INVALID;
+  data.accX = ACCELERATION_INVALID;
+  CHECK(NRF_SUCCESS == sensor_sweep(&data, provided, sweep_done));
+  CHECK(NRF_ERROR_BUSY == sensor_sweep(&data, provided, sweep_done));
+  run_bus();
+  CHECK(0 == sweeps);
+  scheduler_execute();
+  CHECK(1 == sweeps && !sensor_sweep_busy());
+  CHECK(1 == spi_transaction_stats_get()->sequences);
+  CHECK(1 == spi_transaction_stats_get()->deliveries);
+  CHECK(bme280_get_temperature() == data.temperature && 1 == data.accX);
+  const char* expected[] = { "select BME280", "start BME280", "release BME280",
+                             "select LIS2DH12", "start LIS2DH12", "release LIS2DH12" };
+  CHECK(log_is(expected, sizeof(expected) / sizeof(expected[0])));
+
+  // Forced mode: read right after start completes synchronously with previous values
+  CHECK(BME280_RET_OK == bme280_set_mode(BME280_MODE_SLEEP));
+  CHECK(bme280_get_measurement_time_us() == sensor_start_all(provided));
+  CHECK(NRF_SUCCESS == sensor_sweep(&data, provided, sweep_done));
+  run_bus();
+  scheduler_execute();
+  CHECK(2 == sweeps);
+  CHECK(1 == bme280_get_stats()->reads_skipped);
+  // Forced mode current follows sampling interval
+  CHECK(sensor_current_na(10000) < sensor_current_na(1000));
+
+  printf("sensor sweep: %u sweeps, %u main context wake-ups, estimated %u nA at 1 s\n", (unsigned)sweeps,
+         (unsigned)spi_transaction_stats_get()->deliveries, (unsigned)sensor_current_na(1000));
+  bme280_set_mode(BME280_MODE_NORMAL);
+}
+
+/** Fake timebase of rtc.h at 2048 Hz, follows emulator time */
+uint32_t rtc_ticks_get(void)
+{
+  return (uint32_t)(bme280_emulator_time_us() * 2048 / 1000000);
+}
+
+uint32_t rtc_ms_to_ticks(uint32_t ms)
+{
+  return (uint32_t)(((uint64_t)ms * 2048 + 999) / 1000);
+}
+
+rtc_deadline_t rtc_deadline_ms(uint32_t ms)
+{
+  return rtc_ticks_get() + rtc_ms_to_ticks(ms);
+}
+
+bool rtc_deadline_passed(rtc_deadline_t deadline)
+{
+  return (int32_t)(deadline - rtc_ticks_get()) <= 0;
+}
+
+uint32_t rtc_deadline_remaining(rtc_deadline_t deadline)
+{
+  return rtc_deadline_passed(deadline) ? 0 : deadline - rtc_ticks_get();
+}
+
+static uint8_t pipeline_channels;
+
+static void pipeline_sweep_done(ruuvi_sensor_t* p_data)
+{
+  sensor_pipeline_store(p_data, pipeline_channels);
+  pipeline_channels = 0;
+}
+
+/** Run sample loop of ruuvi_firmware main for seconds, return measurement time of BME280 */
+static uint64_t run_pipeline(uint32_t seconds, uint32_t* p_samples)
+{
+  static ruuvi_sensor_t data;
+  uint64_t measuring_us = 0;
+  uint64_t end_us = bme280_emulator_time_us() + (uint64_t)seconds * 1000000;
+  rtc_deadline_t deadline;
+  while(sensor_pipeline_next(&deadline))
+  {
+    uint64_t wait_us = (uint64_t)rtc_deadline_remaining(deadline) * 1000000 / 2048 + 1;
+    if(bme280_emulator_time_us() + wait_us > end_us) { break; }
+    bme280_emulator_advance(wait_us);
+
+    pipeline_channels = sensor_pipeline_due();
+    for(uint8_t ii = 0; ii < 4; ii++) { if(pipeline_channels & (1 << ii)) { p_samples[ii]++; } }
+    uint32_t ready_us = sensor_start_all(pipeline_channels);
+    measuring_us += ready_us;
+    bme280_emulator_advance(ready_us + 1000);
+    data.temperature = TEMPERATURE_INVALID;
+    data.humidity = HUMIDITY_INVALID;
+    data.pressure = PRESSURE_INVALID;
+    data.accX = ACCELERATION_INVALID;
+    CHECK(NRF_SUCCESS == sensor_sweep(&data, pipeline_channels, pipeline_sweep_done));
+    run_bus();
+    scheduler_execute();
+    CHECK(0 == pipeline_channels);
+  }
+  bme280_emulator_advance(end_us - bme280_emulator_time_us());
+  return measuring_us;
+}
+
+static void test_sensor_pipeline(void)
+{
+  uint32_t samples[4] = { 0 };
+  ruuvi_sensor_t latest = { 0 };
+  reset();
+  CHECK(BME280_RET_OK == bme280_set_mode(BME280_MODE_SLEEP));
+  uint32_t all_channels_us = bme280_get_measurement_time_us();
+
+  sensor_pipeline_init();
+  sensor_pipeline_latest(&latest);
+  CHECK(TEMPERATURE_INVALID == latest.temperature && PRESSURE_INVALID == latest.pressure);
+  CHECK(NRF_ERROR_INVALID_PARAM == sensor_pipeline_interval_set(SENSOR_CAPABILITY_PRESSURE, 24 * 3600000u));
+  CHECK(NRF_SUCCESS == sensor_pipeline_interval_set(SENSOR_CAPABILITY_TEMPERATURE | SENSOR_CAPABILITY_HUMIDITY, 5000));
+  CHECK(NRF_SUCCESS == sensor_pipeline_interval_set(SENSOR_CAPABILITY_PRESSURE, 60000));
+  CHECK(NRF_SUCCESS == sensor_pipeline_interval_set(SENSOR_CAPABILITY_ACCELERATION, 1280));
+  CHECK(60000 == sensor_pipeline_interval_get(SENSOR_CAPABILITY_PRESSURE));
+  CHECK((SENSOR_CAPABILITY_TEMPERATURE | SENSOR_CAPABILITY_HUMIDITY | SENSOR_CAPABILITY_PRESSURE |
+         SENSOR_CAPABILITY_ACCELERATION) == sensor_pipeline_due());
+
+  // 10 minutes, each channel at its own rate. First sample of all channels at start, deadline
+  // of tick rounded intervals at 10 minutes falls just after the end.
+  uint64_t measuring_us = run_pipeline(600, samples);
+  CHECK(120 == samples[0] && 120 == samples[1]);
+  CHECK(10 == samples[2]);
+  CHECK(468 <= samples[3] && 469 >= samples[3]);
+  // Temperature and pressure deadlines are grouped, BME280 measures pressure only when due
+  uint64_t full_us = (uint64_t)samples[0] * all_channels_us;
+  CHECK(measuring_us < full_us);
+
+  sensor_pipeline_latest(&latest);
+  CHECK(bme280_get_temperature() == latest.temperature);
+  // Pressure is compensated with temperature of its own measurement
+  CHECK(PRESSURE_INVALID != latest.pressure);
+  CHECK(1 == latest.accX);
+
+  // Disabled channels read as invalid, other channels keep being sampled
+  sensor_pipeline_interval_set(SENSOR_CAPABILITY_PRESSURE, 0);
+  sensor_pipeline_latest(&latest);
+  CHECK(PRESSURE_INVALID == latest.pressure);
+  CHECK(NRF_SUCCESS == sensor_pipeline_interval_set(SENSOR_CAPABILITY_TEMPERATURE, 0));
+  uint32_t more_samples[4] = { 0 };
+  run_pipeline(16, more_samples);
+  CHECK(0 == more_samples[0] && 0 < more_samples[1]);
+  sensor_pipeline_latest(&latest);
+  CHECK(TEMPERATURE_INVALID == latest.temperature && HUMIDITY_INVALID != latest.humidity);
+
+  printf("sensor pipeline: %u T, %u P, %u A samples in 10 min, BME280 measuring %u us vs %u us sampling all\n",
+         (unsigned)samples[0], (unsigned)samples[2], (unsigned)samples[3], (unsigned)measuring_us,
+         (unsigned)full_us);
+  bme280_set_mode(BME280_MODE_NORMAL);
+}
+
+int main(int argc, char** argv)
+{
+  int option;
+  while(-1 != (option = getopt(argc, argv, "v")))
+  {
+    if('v' == option) { verbose = true; }
+    else
+    {
+      fprintf(stderr, "Usage: %s [-v]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  const bme280_emulator_environment_t environment = { .noise_t = 16, .noise_p = 16, .noise_h = 1,
+                                                      .drift_t = 2000, .drift_p = 500, .drift_h = 200,
+                                                      .drift_period_s = 3600 };
+  bme280_emulator_init(1, &environment);
+  bme280_init();
+  bme280_set_oversampling_hum(BME280_OVERSAMPLING_1);
+  bme280_set_oversampling_temp(BME280_OVERSAMPLING_1);
+  bme280_set_oversampling_press(BME280_OVERSAMPLING_1);
+  bme280_set_mode(BME280_MODE_NORMAL);
+  bme280_emulator_advance(1000000);
+
+  test_sweep();
+  test_join();
+  test_queue_full();
+  test_start_error();
+  test_hold();
+  test_sensor_sweep();
+  test_sensor_pipeline();
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+/**
+ *  Decoder of libraries/trace binary log.
+ *
+ *  Reads format strings from section trace_strings of the ELF of the firmware build
+ *  which produced the stream, ID of a record is the offset of its string in the
+ *  section. Arguments of %s are read from allocated sections of the same ELF.
+ *  Stream is a sequence of 32-bit little endian words as read from RTT channel
+ *  TRACE_RTT_CHANNEL or from LOG_QUERY replies of TRACE endpoint concatenated.
+ *  TRACE_PADDING words between records are skipped.
+ *
+ *  Output is one line per record: time in seconds, level, sequence and text.
+ *  Records lost on target and gaps in sequence are reported on their own lines.
+ *
+ *  Usage: trace_decoder [-t ticks_per_second] firmware.elf [stream.bin]
+ *  Stream is read from stdin if file is not given.
+ */
+#include <elf.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define DEFAULT_TICKS_PER_SECOND 2048  // RTC1 with RUUVITAG_APP_TIMER_PRESCALER 15
+#define MAX_SECTIONS             64
+#define LINE_SIZE                512
+
+/** Allocated section of ELF, used to resolve %s arguments */
+typedef struct {
+  uint64_t       address;
+  uint64_t       size;
+  const uint8_t* data;
+}section_t;
+
+static uint8_t*  elf_image;
+static size_t    elf_size;
+static section_t sections[MAX_SECTIONS];
+static size_t    section_count;
+static section_t strings;
+
+static const char* level_names[] = { "?", "ERROR", "WARNING", "INFO", "DEBUG", "?", "?", "?" };
+
+static uint8_t* read_file(FILE* file, size_t* p_size)
+{
+  size_t capacity = 4096, size = 0;
+  uint8_t* buffer = malloc(capacity);
+  size_t length;
+  while(buffer && 0 != (length = fread(buffer + size, 1, capacity - size, file)))
+  {
+    size += length;
+    if(size == capacity) { buffer = realloc(buffer, capacity *= 2); }
+  }
+  *p_size = size;
+  return buffer;
+}
+
+/** Add section if it is within file and holds allocated data */
+static void section_add(const char* name, uint32_t type, uint64_t flags, uint64_t address,
+                        uint64_t offset, uint64_t size)
+{
+  if(offset > elf_size || size > elf_size - offset) { return; }
+  section_t section = { address, size, elf_image + offset };
+  if(0 == strcmp(name, "trace_strings")) { strings = section; }
+  if(SHT_PROGBITS == type && (flags & SHF_ALLOC) && MAX_SECTIONS > section_count)
+  {
+    sections[section_count++] = section;
+  }
+}
+
+/** Read section headers of 32- or 64-bit ELF, return false if file is not an ELF */
+#define ELF_LOAD(Ehdr, Shdr)                                                                  \
+  do {                                                                                        \
+    const Ehdr* header = (const Ehdr*)elf_image;                                              \
+    if(elf_size < sizeof(Ehdr) || header->e_shoff > elf_size ||                               \
+       (uint64_t)header->e_shnum * sizeof(Shdr) > elf_size - header->e_shoff) { return false; } \
+    const Shdr* table = (const Shdr*)(elf_image + header->e_shoff);                           \
+    if(header->e_shstrndx >= header->e_shnum) { return false; }                               \
+    const Shdr* names = &table[header->e_shstrndx];                                           \
+    if(names->sh_offset > elf_size || names->sh_size > elf_size - names->sh_offset) { return false; } \
+    for(size_t ii = 0; ii < header->e_shnum; ii++)                                            \
+    {                                                                                         \
+      if(table[ii].sh_name >= names->sh_size) { continue; }                                   \
+      const char* name = (const char*)elf_image + names->sh_offset + table[ii].sh_name;       \
+      section_add(name, table[ii].sh_type, table[ii].sh_flags, table[ii].sh_addr,             \
+                  table[ii].sh_offset, table[ii].sh_size);                                    \
+    }                                                                                         \
+  } while(0)
+
+static bool elf_load(const char* path)
+{
+  FILE* file = fopen(path, "rb");
+  if(NULL == file) { return false; }
+  elf_image = read_file(file, &elf_size);
+  fclose(file);
+  if(NULL == elf_image || elf_size < EI_NIDENT || 0 != memcmp(elf_image, ELFMAG, SELFMAG)) { return false; }
+  // Section headers are read in host byte order, target and host are both little endian
+  if(ELFDATA2LSB != elf_image[EI_DATA]) { return false; }
+
+  if(ELFCLASS32 == elf_image[EI_CLASS])      { ELF_LOAD(Elf32_Ehdr, Elf32_Shdr); }
+  else if(ELFCLASS64 == elf_image[EI_CLASS]) { ELF_LOAD(Elf64_Ehdr, Elf64_Shdr); }
+  else { return false; }
+  return true;
+}
+
+/** Return NUL-terminated string at target address, NULL if address is not in ELF */
+static const char* elf_string(uint32_t address)
+{
+  for(size_t ii = 0; ii < section_count; ii++)
+  {
+    const section_t* section = &sections[ii];
+    if(address < section->address || address - section->address >= section->size) { continue; }
+    const char* string = (const char*)section->data + (address - section->address);
+    size_t left = section->size - (address - section->address);
+    return memchr(string, '\0', left) ? string : NULL;
+  }
+  return NULL;
+}
+
+static void append(char* line, size_t* p_length, const char* text)
+{
+  size_t length = strlen(text);
+  if(length > LINE_SIZE - 1 - *p_length) { length = LINE_SIZE - 1 - *p_length; }
+  memcpy(line + *p_length, text, length);
+  *p_length += length;
+  line[*p_length] = '\0';
+}
+
+/**
+ *  Format record with printf conversions of 32-bit target. Length modifiers are
+ *  ignored as every argument is one word. Returns false if format string consumed
+ *  different number of arguments than record has.
+ */
+static bool format(char* line, const char* fmt, const uint32_t* args, uint8_t nargs)
+{
+  size_t length = 0;
+  uint8_t arg = 0;
+  char spec[32], text[LINE_SIZE];
+  line[0] = '\0';
+
+  while(*fmt)
+  {
+    if('%' != *fmt)
+    {
+      const char* end = strchr(fmt, '%');
+      size_t run = end ? (size_t)(end - fmt) : strlen(fmt);
+      snprintf(text, sizeof(text), "%.*s", (int)run, fmt);
+      append(line, &length, text);
+      fmt += run;
+      continue;
+    }
+
+    // Copy flags, width and precision, skip length modifiers
+    size_t spec_length = 0;
+    spec[spec_length++] = *fmt++;
+    while(*fmt && strchr("-+ #0123456789.", *fmt) && spec_length < sizeof(spec) - 3) { spec[spec_length++] = *fmt++; }
+    while(*fmt && strchr("hlzjt", *fmt)) { fmt++; }
+    char conversion = *fmt;
+    if('\0' == conversion) { break; }
+    fmt++;
+
+    if('%' == conversion) { append(line, &length, "%"); continue; }
+    if(arg >= nargs) { append(line, &length, "<missing>"); continue; }
+    uint32_t value = args[arg++];
+    spec[spec_length++] = conversion;
+    spec[spec_length] = '\0';
+
+    switch(conversion)
+    {
+      case 'd':
+      case 'i':
+        snprintf(text, sizeof(text), spec, (int32_t)value);
+        break;
+
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o':
+      case 'c':
+        snprintf(text, sizeof(text), spec, value);
+        break;
+
+      case 'p':
+        snprintf(text, sizeof(text), "0x%08" PRIx32, value);
+        break;
+
+      case 's':
+      {
+        const char* string = elf_string(value);
+        if(string) { snprintf(text, sizeof(text), spec, string); }
+        else       { snprintf(text, sizeof(text), "<string at 0x%08" PRIx32 ">", value); }
+        break;
+      }
+
+      default:
+        snprintf(text, sizeof(text), "<%%%c 0x%08" PRIx32 ">", conversion, value);
+        break;
+    }
+    append(line, &length, text);
+  }
+
+  // NRF_LOG format strings end with line break, output adds its own
+  while(length && ('\n' == line[length - 1] || '\r' == line[length - 1])) { line[--length] = '\0'; }
+  return arg == nargs;
+}
+
+static bool read_word(FILE* stream, uint32_t* p_word)
+{
+  uint8_t bytes[4];
+  if(sizeof(bytes) != fread(bytes, 1, sizeof(bytes), stream)) { return false; }
+  *p_word = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  double ticks_per_second = DEFAULT_TICKS_PER_SECOND;
+  int option;
+  while(-1 != (option = getopt(argc, argv, "t:")))
+  {
+    if('t' == option) { ticks_per_second = atof(optarg); }
+    else
+    {
+      fprintf(stderr, "Usage: %s [-t ticks_per_second] firmware.elf [stream.bin]\n", argv[0]);
+      return 2;
+    }
+  }
+  if(optind >= argc || 0 >= ticks_per_second)
+  {
+    fprintf(stderr, "Usage: %s [-t ticks_per_second] firmware.elf [stream.bin]\n", argv[0]);
+    return 2;
+  }
+  if(!elf_load(argv[optind]))
+  {
+    fprintf(stderr, "%s: not a readable little endian ELF\n", argv[optind]);
+    return 1;
+  }
+  if(NULL == strings.data)
+  {
+    fprintf(stderr, "%s: no trace_strings section, was firmware built with TRACE_ENABLED?\n", argv[optind]);
+    return 1;
+  }
+
+  FILE* stream = stdin;
+  if(optind + 1 < argc && NULL == (stream = fopen(argv[optind + 1], "rb")))
+  {
+    fprintf(stderr, "%s: %s\n", argv[optind + 1], strerror(errno));
+    return 1;
+  }
+
+  uint32_t header, timestamp, args[TRACE_MAX_ARGS];
+  char line[LINE_SIZE];
+  int expected = -1;
+  unsigned long errors = 0;
+  while(read_word(stream, &header))
+  {
+    if(TRACE_PADDING == header) { continue; }
+    uint16_t id       = header & 0xFFFF;
+    uint8_t  nargs    = (header >> 16) & 0x0F;
+    uint8_t  level    = (header >> 20) & 0x07;
+    uint8_t  sequence = header >> 24;
+    bool complete = nargs <= TRACE_MAX_ARGS && read_word(stream, &timestamp);
+    for(uint8_t ii = 0; complete && ii < nargs; ii++) { complete = read_word(stream, &args[ii]); }
+    if(!complete)
+    {
+      printf("# truncated or invalid record 0x%08" PRIx32 ", stopping\n", header);
+      errors++;
+      break;
+    }
+
+    if(0 <= expected && sequence != expected)
+    {
+      printf("# %d records lost in transport\n", (sequence - expected) & 0xFF);
+    }
+    expected = (sequence + 1) & 0xFF;
+
+    double seconds = timestamp / ticks_per_second;
+    if(TRACE_ID_DROPPED == id)
+    {
+      printf("%12.4f # %" PRIu32 " records dropped on target, ring was full\n", seconds, nargs ? args[0] : 0);
+      continue;
+    }
+    if(id >= strings.size || NULL == memchr(strings.data + id, '\0', strings.size - id))
+    {
+      printf("%12.4f # unknown ID 0x%04x, ELF does not match firmware\n", seconds, id);
+      errors++;
+      continue;
+    }
+    if(!format(line, (const char*)strings.data + id, args, nargs)) { errors++; }
+    printf("%12.4f %-7s %3u %s\n", seconds, level_names[level], sequence, line);
+  }
+
+  if(stdin != stream) { fclose(stream); }
+  free(elf_image);
+  return errors ? 1 : 0;
+}
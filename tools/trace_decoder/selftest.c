@@ -0,0 +1,59 @@
+/**
+ *  Writes a trace stream of libraries/trace to stdout for make test of trace_decoder.
+ *  Built with TRACE_ENABLED and a small ring, the decoder reads format strings from
+ *  the ELF of this program as it would from firmware. Stream is padded to 8-byte
+ *  frames with TRACE_PADDING as LOG_QUERY replies of TRACE endpoint are.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#define NRF_LOG_MODULE_NAME "SELFTEST"
+#include "trace.h"
+
+#define FRAME_SIZE 8
+
+static uint32_t ticks = 0;
+
+static uint32_t time_source(void)
+{
+  return ticks;
+}
+
+static void drain(bool keep)
+{
+  uint8_t buffer[TRACE_BUFFER_WORDS * sizeof(uint32_t) + FRAME_SIZE];
+  size_t length = trace_read(buffer, TRACE_BUFFER_WORDS * sizeof(uint32_t));
+  if(!keep) { return; }
+  while(length % FRAME_SIZE) { memset(&buffer[length], 0xFF, sizeof(uint32_t)); length += sizeof(uint32_t); }
+  fwrite(buffer, 1, length, stdout);
+}
+
+static const char* const state = "idle";
+
+int main(void)
+{
+  trace_init(time_source);
+
+  TRACE_INFO("Started\r\n");
+  ticks = 2048;
+  TRACE_DEBUG("Register %x read of %d bytes started\r\n", 0x28, 6);
+  TRACE_WARNING("Signed %d, unsigned %u, padded %04X, char %c\r\n", -5, 3000000000U, 0xab, 'r');
+  TRACE_ERROR("State %s, %d%% done\r\n", state, 50);
+  TRACE_INFO("Six %d %d %d %d %d %d\r\n", 1, 2, 3, 4, 5, 6);
+  drain(true);
+
+  // Lost RTT frame
+  ticks = 4096;
+  TRACE_INFO("Not seen\r\n");
+  drain(false);
+
+  // Overflow of ring, loss is reported before next stored record
+  ticks = 6144;
+  for(uint8_t ii = 0; ii < 20; ii++) { TRACE_DEBUG("Sample %d\r\n", ii); }
+  drain(true);
+  ticks = 6145;
+  TRACE_INFO("After overflow\r\n");
+  drain(true);
+
+  return 0;
+}
@@ -0,0 +1,337 @@
+/**
+ *  Host benchmark of libraries/dsp/vibration fixed-point spectral analysis.
+ *
+ *  Synthetic traces model a tag on rotating machinery: rotation frequency with
+ *  harmonics on different axes, mains hum, bearing tones, white noise and gravity.
+ *  Samples are quantized to 4 mg as LIS2DH12 gives them at 2 g scale and 10 bits.
+ *  Each block is analysed by the fixed-point code and by a double precision reference
+ *  of the same estimators, report shows error against reference and against the
+ *  known contents of the trace, and host time of analysis.
+ *
+ *  Recorded traces can be analysed with -f, CSV of x,y,z in mg, one sample per line,
+ *  e.g. logged from GATT stream of ACCELERATION endpoint at TRANSMISSION_RATE_SAMPLERATE.
+ *
+ *  Usage: vibration_benchmark [-v] [-f trace.csv -r sample_rate_hz [-t tracked_hz]]
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nrf_error.h"
+#include "vibration.h"
+
+#define AXES        3
+#define BLOCKS      8
+#define MAX_TONES   4
+#define LSB_MG      4.0
+
+typedef struct {
+  double  frequency_hz;
+  double  amplitude_mg;
+  uint8_t axis;
+}tone_t;
+
+typedef struct {
+  const char* name;
+  uint16_t    sample_rate_hz;
+  uint16_t    tracked_hz;
+  tone_t      tones[MAX_TONES];
+  double      noise_mg;         // RMS of white noise on each axis
+  double      peak_hz;          // Expected peak
+}scenario_t;
+
+static const scenario_t scenarios[] = {
+  { "motor 1488 rpm", 400, 25, { { 24.8, 80, 0 }, { 49.6, 30, 1 }, { 74.4, 10, 0 } }, 5, 24.8 },
+  { "pump, bearing tone", 400, 50, { { 50.0, 20, 2 }, { 137.0, 40, 0 }, { 12.5, 15, 1 } }, 10, 137.0 },
+  { "fan 100 Hz ODR", 100, 0, { { 18.3, 25, 1 }, { 36.6, 8, 1 } }, 3, 18.3 },
+  { "idle", 200, 0, { { 0 } }, 2, 0 }
+};
+
+typedef struct {
+  double rms;
+  double peak_hz;
+  double peak_mg;
+  double tracked;
+  double band[VIBRATION_BANDS];
+}reference_t;
+
+static bool     verbose = false;
+static uint32_t failures = 0;
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if(!(condition))                                                       \
+    {                                                                      \
+      printf("FAIL %s:%d: %s\n", __func__, __LINE__, #condition);          \
+      failures++;                                                          \
+    }                                                                      \
+  } while(0)
+
+static double gaussian(void)
+{
+  double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+  double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static int16_t quantize(double mg)
+{
+  double value = round(mg / LSB_MG) * LSB_MG;
+  if(value > INT16_MAX) { value = INT16_MAX; }
+  if(value < INT16_MIN) { value = INT16_MIN; }
+  return (int16_t)value;
+}
+
+static void generate(const scenario_t* p_scenario, uint32_t index, int16_t sample[AXES])
+{
+  double t = (double)index / p_scenario->sample_rate_hz;
+  double axis[AXES] = { 30, -40, 1000 };  // Gravity mostly on z, mounting not level
+  for(uint8_t ii = 0; ii < MAX_TONES; ii++)
+  {
+    const tone_t* p_tone = &p_scenario->tones[ii];
+    if(0 == p_tone->amplitude_mg) { continue; }
+    axis[p_tone->axis] += p_tone->amplitude_mg * sin(2.0 * M_PI * p_tone->frequency_hz * t + ii);
+  }
+  for(uint8_t ii = 0; ii < AXES; ii++) { sample[ii] = quantize(axis[ii] + p_scenario->noise_mg * gaussian()); }
+}
+
+/** Double precision version of the estimators of vibration.c */
+static void reference(const int16_t block[][AXES], uint16_t sample_rate, uint16_t tracked_hz, reference_t* p_ref)
+{
+  const uint16_t n = VIBRATION_BLOCK_LENGTH;
+  static double power[VIBRATION_BLOCK_LENGTH / 2 + 1];
+  double square_sum = 0;
+  double tracked_power = 0;
+  memset(power, 0, sizeof(power));
+  for(uint8_t axis = 0; axis < AXES; axis++)
+  {
+    double mean = 0;
+    for(uint16_t ii = 0; ii < n; ii++) { mean += block[ii][axis]; }
+    mean /= n;
+    double x[VIBRATION_BLOCK_LENGTH];
+    for(uint16_t ii = 0; ii < n; ii++)
+    {
+      double ac = block[ii][axis] - mean;
+      square_sum += ac * ac;
+      x[ii] = ac * 0.5 * (1.0 - cos(2.0 * M_PI * ii / n));
+    }
+    for(uint16_t kk = 0; kk <= n / 2; kk++)
+    {
+      double re = 0, im = 0;
+      for(uint16_t ii = 0; ii < n; ii++)
+      {
+        re += x[ii] * cos(2.0 * M_PI * kk * ii / n);
+        im -= x[ii] * sin(2.0 * M_PI * kk * ii / n);
+      }
+      power[kk] += (re * re + im * im) / ((double)n * n);
+    }
+    if(tracked_hz)
+    {
+      double re = 0, im = 0;
+      for(uint16_t ii = 0; ii < n; ii++)
+      {
+        re += x[ii] * cos(2.0 * M_PI * tracked_hz * ii / sample_rate);
+        im -= x[ii] * sin(2.0 * M_PI * tracked_hz * ii / sample_rate);
+      }
+      tracked_power += re * re + im * im;
+    }
+  }
+  p_ref->rms = sqrt(square_sum / n);
+  p_ref->tracked = 4.0 * sqrt(tracked_power) / n;
+  uint16_t peak = 1;
+  for(uint16_t kk = 2; kk < n / 2; kk++) { if(power[kk] > power[peak]) { peak = kk; } }
+  for(uint8_t band = 0; band < VIBRATION_BANDS; band++)
+  {
+    uint16_t first = band ? ((n / 2) >> (VIBRATION_BANDS - band)) : 1;
+    uint16_t end = (n / 2) >> (VIBRATION_BANDS - 1 - band);
+    double band_power = 0;
+    for(uint16_t kk = first; kk < end; kk++) { band_power += power[kk]; }
+    p_ref->band[band] = sqrt(band_power * 16.0 / 3.0);
+  }
+  double previous = sqrt(power[peak - 1]), current = sqrt(power[peak]), next = sqrt(power[peak + 1]);
+  p_ref->peak_hz = (peak + 2.0 * (next - previous) / (previous + 2.0 * current + next)) * sample_rate / n;
+  p_ref->peak_mg = 4.0 * current;
+}
+
+/** Return true if value is within relative or absolute tolerance of expected */
+static bool close_to(double value, double expected, double relative, double absolute)
+{
+  return fabs(value - expected) <= fmax(relative * fabs(expected), absolute);
+}
+
+static double elapsed_us(const struct timespec* p_start, const struct timespec* p_end)
+{
+  return (p_end->tv_sec - p_start->tv_sec) * 1e6 + (p_end->tv_nsec - p_start->tv_nsec) / 1e3;
+}
+
+/** Feed samples, analyse each completed block. Returns count of analysed blocks. */
+static uint32_t analyse_block(const int16_t block[][AXES], uint16_t sample_rate, uint16_t tracked_hz,
+                              vibration_result_t* p_result, reference_t* p_ref, double* p_time_us)
+{
+  for(uint16_t ii = 0; ii < VIBRATION_BLOCK_LENGTH; ii++)
+  {
+    bool ready = vibration_sample_put(block[ii][0], block[ii][1], block[ii][2]);
+    if(ready != (VIBRATION_BLOCK_LENGTH - 1 == ii)) { return 0; }
+  }
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ret_code_t err_code = vibration_analyse(p_result);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  *p_time_us += elapsed_us(&start, &end);
+  if(NRF_SUCCESS != err_code) { return 0; }
+  reference(block, sample_rate, tracked_hz, p_ref);
+  return 1;
+}
+
+static void print_block(const vibration_result_t* p_result, const reference_t* p_ref)
+{
+  printf("  rms %5u (%7.1f) peak %6.1f Hz (%6.1f) %5u mg (%7.1f) tracked %5u (%7.1f) bands",
+         p_result->rms_mg, p_ref->rms, p_result->peak_frequency_dhz / 10.0, p_ref->peak_hz,
+         p_result->peak_mg, p_ref->peak_mg, p_result->tracked_mg, p_ref->tracked);
+  for(uint8_t band = 0; band < VIBRATION_BANDS; band++)
+  {
+    printf(" %u (%.1f)", p_result->band_mg[band], p_ref->band[band]);
+  }
+  printf("\n");
+}
+
+static void run_scenario(const scenario_t* p_scenario)
+{
+  static int16_t block[VIBRATION_BLOCK_LENGTH][AXES];
+  double time_us = 0;
+  double peak_error = 0, rms_error = 0, band_error = 0;
+  uint32_t analysed = 0;
+  CHECK(NRF_SUCCESS == vibration_init(p_scenario->sample_rate_hz, p_scenario->tracked_hz));
+  for(uint32_t bb = 0; bb < BLOCKS; bb++)
+  {
+    vibration_result_t result;
+    reference_t ref;
+    for(uint16_t ii = 0; ii < VIBRATION_BLOCK_LENGTH; ii++)
+    {
+      generate(p_scenario, bb * VIBRATION_BLOCK_LENGTH + ii, block[ii]);
+    }
+    if(!analyse_block(block, p_scenario->sample_rate_hz, p_scenario->tracked_hz, &result, &ref, &time_us))
+    {
+      CHECK(false);
+      continue;
+    }
+    analysed++;
+    if(verbose) { print_block(&result, &ref); }
+
+    // Fixed point against double precision reference of the same estimators
+    CHECK(close_to(result.rms_mg, ref.rms, 0.01, 1));
+    // Peak of noise only trace is random, amplitude is still checked
+    CHECK(!p_scenario->peak_hz || close_to(result.peak_frequency_dhz / 10.0, ref.peak_hz, 0, 0.2));
+    CHECK(close_to(result.peak_mg, ref.peak_mg, 0.03, 2));
+    CHECK(close_to(result.tracked_mg, ref.tracked, 0.03, 2));
+    for(uint8_t band = 0; band < VIBRATION_BANDS; band++)
+    {
+      CHECK(close_to(result.band_mg[band], ref.band[band], 0.03, 2));
+      band_error = fmax(band_error, fabs(result.band_mg[band] - ref.band[band]));
+    }
+    rms_error = fmax(rms_error, fabs(result.rms_mg - ref.rms));
+
+    // Estimators against contents of the trace
+    if(p_scenario->peak_hz)
+    {
+      double error = fabs(result.peak_frequency_dhz / 10.0 - p_scenario->peak_hz);
+      peak_error = fmax(peak_error, error);
+      CHECK(error < 0.5);
+    }
+    else { CHECK(result.rms_mg < 4 * p_scenario->noise_mg); }
+    CHECK(result.sequence == bb);
+  }
+
+  // RMS of vector: tones add mean square of amplitude^2 / 2, noise adds on all axes
+  double square = AXES * (p_scenario->noise_mg * p_scenario->noise_mg + LSB_MG * LSB_MG / 12);
+  for(uint8_t ii = 0; ii < MAX_TONES; ii++) { square += pow(p_scenario->tones[ii].amplitude_mg, 2) / 2; }
+  printf("%-20s %3u Hz: %u blocks, peak error %.2f Hz, max error vs reference rms %.1f mg, bands %.1f mg, "
+         "expected rms %.1f mg, %.1f us/block\n",
+         p_scenario->name, p_scenario->sample_rate_hz, (unsigned)analysed, peak_error, rms_error, band_error,
+         sqrt(square), analysed ? time_us / analysed : 0);
+}
+
+/** Analyse recorded trace of x,y,z in mg */
+static int run_file(const char* path, uint16_t sample_rate, uint16_t tracked_hz)
+{
+  static int16_t block[VIBRATION_BLOCK_LENGTH][AXES];
+  FILE* p_file = fopen(path, "r");
+  if(NULL == p_file)
+  {
+    perror(path);
+    return 1;
+  }
+  if(NRF_SUCCESS != vibration_init(sample_rate, tracked_hz))
+  {
+    fprintf(stderr, "Invalid sample rate %u or tracked frequency %u\n", sample_rate, tracked_hz);
+    fclose(p_file);
+    return 2;
+  }
+  char line[128];
+  uint16_t count = 0;
+  uint32_t blocks = 0;
+  double time_us = 0;
+  while(fgets(line, sizeof(line), p_file))
+  {
+    int x, y, z;
+    if(3 != sscanf(line, "%d,%d,%d", &x, &y, &z)) { continue; }
+    block[count][0] = x;
+    block[count][1] = y;
+    block[count][2] = z;
+    if(VIBRATION_BLOCK_LENGTH > ++count) { continue; }
+    count = 0;
+    vibration_result_t result;
+    reference_t ref;
+    if(analyse_block(block, sample_rate, tracked_hz, &result, &ref, &time_us))
+    {
+      printf("block %u:", (unsigned)blocks++);
+      print_block(&result, &ref);
+    }
+  }
+  fclose(p_file);
+  printf("%u blocks, %.1f us/block\n", (unsigned)blocks, blocks ? time_us / blocks : 0);
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  const char* path = NULL;
+  uint16_t sample_rate = 0;
+  uint16_t tracked_hz = 0;
+  int option;
+  while(-1 != (option = getopt(argc, argv, "vf:r:t:")))
+  {
+    switch(option)
+    {
+      case 'v': verbose = true; break;
+      case 'f': path = optarg; break;
+      case 'r': sample_rate = atoi(optarg); break;
+      case 't': tracked_hz = atoi(optarg); break;
+      default:
+        fprintf(stderr, "Usage: %s [-v] [-f trace.csv -r sample_rate_hz [-t tracked_hz]]\n", argv[0]);
+        return 2;
+    }
+  }
+  if(path) { return run_file(path, sample_rate, tracked_hz); }
+
+  srand(1);
+  for(size_t ii = 0; ii < sizeof(scenarios) / sizeof(scenarios[0]); ii++) { run_scenario(&scenarios[ii]); }
+
+  // Late analysis drops block being filled, not the one waiting
+  vibration_result_t result;
+  CHECK(NRF_SUCCESS == vibration_init(400, 0));
+  CHECK(NRF_ERROR_INVALID_STATE == vibration_analyse(&result));
+  for(uint32_t ii = 0; ii < 2 * VIBRATION_BLOCK_LENGTH; ii++) { vibration_sample_put(0, 0, 1000); }
+  CHECK(NRF_SUCCESS == vibration_analyse(&result) && 1 == result.blocks_dropped);
+  CHECK(NRF_ERROR_INVALID_STATE == vibration_analyse(&result));
+  CHECK(NRF_ERROR_INVALID_PARAM == vibration_init(400, 200));
+  vibration_stop();
+  CHECK(!vibration_sample_put(0, 0, 1000));
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}